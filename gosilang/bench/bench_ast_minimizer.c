@@ -0,0 +1,200 @@
+// AST hash-consing benchmark: parses many generated expressions drawn
+// from a small vocabulary, collapses identical subtrees into a DAG and
+// compares a bottom-up analysis pass over the trees with the same pass
+// over the DAG. Every tree is checked against its DAG expansion and the
+// reference counts are recomputed; the run fails on a mismatch.
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/parser/expr_parser.h"
+#include "core/ast/minimizer/ast_minimizer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_EXPRESSIONS 200000
+#define MAX_DEPTH 4
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 0x2545F4914F6CDD1Dull;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+// Random expression over eight variables, four constants and a handful
+// of operators, as generated code tends to be
+static size_t generate(char* out, int depth) {
+    static const char* const operators[] = { " + ", " - ", " * ", " << ", " < ", " && ", " & " };
+    if (depth == 0 || next_random() % 4 == 0) {
+        uint32_t pick = next_random() % 12;
+        return pick < 8 ? (size_t)sprintf(out, "v%u", pick) : (size_t)sprintf(out, "%u", pick - 8);
+    }
+    if (next_random() % 6 == 0) {
+        size_t used = (size_t)sprintf(out, "-");
+        return used + generate(out + used, depth - 1);
+    }
+    size_t used = (size_t)sprintf(out, "(");
+    used += generate(out + used, depth - 1);
+    used += (size_t)sprintf(out + used, "%s", operators[next_random() % 7]);
+    used += generate(out + used, depth - 1);
+    return used + (size_t)sprintf(out + used, ")");
+}
+
+// Stand-in for a later pass: per-node size and height, bottom-up
+static double analyse(const AstPool* pool, uint32_t* sizes, uint32_t* heights, uint64_t* checksum) {
+    double start = now_seconds();
+    uint64_t sum = 0;
+    for (AstNodeId id = 0; id < pool->count; id++) {
+        const AstNode* node = &pool->nodes[id];
+        uint32_t size = 1, height = 0;
+        for (uint32_t i = 0; i < node->child_count; i++) {
+            AstNodeId child = pool->children[node->first_child + i];
+            size += sizes[child];
+            if (heights[child] + 1 > height) height = heights[child] + 1;
+        }
+        sizes[id] = size;
+        heights[id] = height;
+        sum += size * 31u + height;
+    }
+    *checksum = sum;
+    return now_seconds() - start;
+}
+
+// Walks an input tree and its DAG node side by side
+static bool same_structure(const AstPool* tree, AstNodeId root, const AstMinimizer* minimizer,
+                           const TokenBuffer* tokens, AstNodeId* stack) {
+    const AstPool* dag = minimizer->dag;
+    uint32_t depth = 0;
+    stack[depth++] = root;
+    stack[depth++] = AstMinimizer_canonical(minimizer, root);
+    while (depth) {
+        AstNodeId d = stack[--depth];
+        AstNodeId t = stack[--depth];
+        const AstNode* a = &tree->nodes[t];
+        const AstNode* b = &dag->nodes[d];
+        if (a->kind != b->kind || a->op != b->op || a->child_count != b->child_count) return false;
+        if (!a->child_count && (tokens->lengths[a->token] != tokens->lengths[b->token] ||
+            memcmp(TokenBuffer_value(tokens, a->token), TokenBuffer_value(tokens, b->token),
+                   tokens->lengths[a->token]) != 0)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < a->child_count; i++) {
+            stack[depth++] = tree->children[a->first_child + i];
+            stack[depth++] = dag->children[b->first_child + i];
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    size_t expressions = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_EXPRESSIONS;
+    if (!expressions) expressions = 1;
+
+    // One statement per expression, each at most a few hundred bytes
+    char* source = (char*)malloc(expressions * 512);
+    if (!source) return 1;
+    size_t used = 0;
+    for (size_t i = 0; i < expressions; i++) {
+        used += generate(source + used, MAX_DEPTH);
+        used += (size_t)sprintf(source + used, ";\n");
+    }
+
+    StringInterner* interner = StringInterner_create();
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    Lexer* lexer = Lexer_createFromBuffer(source, used, "bench");
+    Lexer_setInterner(lexer, interner);
+    Lexer_fillBuffer(lexer, tokens);
+    Lexer_destroy(lexer);
+
+    ExprParser* parser = ExprParser_create();
+    AstPool* pool = AstPool_create(0);
+    AstNodeId* roots = (AstNodeId*)malloc(expressions * sizeof(AstNodeId));
+    if (!parser || !pool || !roots) return 1;
+
+    size_t count = 0;
+    uint32_t begin = 0;
+    for (uint32_t i = 0; i < tokens->count; i++) {
+        if (tokens->types[i] != TOKEN_PUNCT_SEMICOLON) continue;
+        roots[count] = ExprParser_build(parser, tokens, begin, i, pool);
+        if (roots[count] == AST_NODE_NONE) {
+            fprintf(stderr, "expression %zu: %s\n", count, parser->error);
+            return 1;
+        }
+        count++;
+        begin = i + 1;
+    }
+
+    AstMinimizer* minimizer = AstMinimizer_create(tokens);
+    double start = now_seconds();
+    bool ok = minimizer && AstMinimizer_addPool(minimizer, pool);
+    double elapsed = now_seconds() - start;
+    if (!ok) return 1;
+    const AstPool* dag = minimizer->dag;
+
+    size_t tree_bytes = pool->count * sizeof(AstNode) + pool->child_count * sizeof(AstNodeId);
+    size_t dag_bytes = dag->count * sizeof(AstNode) + dag->child_count * sizeof(AstNodeId);
+    printf("AST minimizer benchmark (%zu expressions, depth %d)\n", count, MAX_DEPTH);
+    printf("tree %9u nodes %8zu KB\n", pool->count, tree_bytes / 1024);
+    printf("dag  %9u nodes %8zu KB  (%.1fx fewer nodes)\n", dag->count, dag_bytes / 1024,
+           (double)pool->count / dag->count);
+    printf("hash-consing %8.2f ms  %6.2f ns/node\n", elapsed * 1e3, elapsed * 1e9 / pool->count);
+
+    uint32_t* sizes = (uint32_t*)malloc(pool->count * sizeof(uint32_t));
+    uint32_t* heights = (uint32_t*)malloc(pool->count * sizeof(uint32_t));
+    AstNodeId* stack = (AstNodeId*)malloc(2 * pool->count * sizeof(AstNodeId));
+    uint32_t* references = (uint32_t*)calloc(dag->count, sizeof(uint32_t));
+    if (!sizes || !heights || !stack || !references) return 1;
+
+    uint64_t tree_sum = 0, dag_sum = 0;
+    double tree_time = analyse(pool, sizes, heights, &tree_sum);
+    double dag_time = analyse(dag, sizes, heights, &dag_sum);
+    printf("analysis pass: tree %.2f ms, dag %.2f ms\n", tree_time * 1e3, dag_time * 1e3);
+
+    // Every root's tree must be its DAG node's expansion
+    int status = 0;
+    for (size_t i = 0; i < count && status == 0; i++) {
+        if (!same_structure(pool, roots[i], minimizer, tokens, stack)) {
+            fprintf(stderr, "expression %zu differs from its DAG node\n", i);
+            status = 1;
+        }
+    }
+
+    // References: one per DAG parent plus one per input root
+    for (AstNodeId id = 0; id < dag->count; id++) {
+        const AstNode* node = &dag->nodes[id];
+        for (uint32_t i = 0; i < node->child_count; i++) {
+            references[dag->children[node->first_child + i]]++;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        references[AstMinimizer_canonical(minimizer, roots[i])]++;
+    }
+    for (AstNodeId id = 0; id < dag->count && status == 0; id++) {
+        if (references[id] != AstMinimizer_refCount(minimizer, id)) {
+            fprintf(stderr, "node %u has %u references, counted %u\n", id,
+                    references[id], AstMinimizer_refCount(minimizer, id));
+            status = 1;
+        }
+    }
+
+    free(references);
+    free(stack);
+    free(heights);
+    free(sizes);
+    AstMinimizer_destroy(minimizer);
+    free(roots);
+    AstPool_destroy(pool);
+    ExprParser_destroy(parser);
+    TokenBuffer_destroy(tokens);
+    StringInterner_destroy(interner);
+    free(source);
+    return status;
+}
@@ -0,0 +1,211 @@
+// AST validator benchmark: parses many small generated expressions and
+// a few very large ones, corrupts a known set of nodes and validates the
+// pool serially and on work pools of 1 to 32 threads. Every run must
+// report exactly the injected faults, in the same order as the serial
+// run; the benchmark fails otherwise.
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/parser/expr_parser.h"
+#include "core/ast/validator/ast_validator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_EXPRESSIONS 200000
+#define SMALL_DEPTH 4
+#define LARGE_EXPRESSIONS 32
+#define LARGE_DEPTH 14
+#define LARGE_BYTES (1u << 20)
+#define CORRUPT_EVERY 997
+#define REPEATS 5
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+static size_t generate(char* out, int depth) {
+    static const char* const operators[] = { " + ", " - ", " * ", " << ", " < ", " && ", " = ", " , " };
+    if (depth == 0 || next_random() % 8 == 0) {
+        uint32_t pick = next_random() % 12;
+        return pick < 8 ? (size_t)sprintf(out, "v%u", pick) : (size_t)sprintf(out, "%u", pick - 8);
+    }
+    uint32_t shape = next_random() % 10;
+    if (shape == 0) {
+        size_t used = (size_t)sprintf(out, "!");
+        return used + generate(out + used, depth - 1);
+    }
+    if (shape == 1) {
+        size_t used = (size_t)sprintf(out, "(");
+        used += generate(out + used, depth - 1);
+        used += (size_t)sprintf(out + used, " ? ");
+        used += generate(out + used, depth - 1);
+        used += (size_t)sprintf(out + used, " : ");
+        used += generate(out + used, depth - 1);
+        return used + (size_t)sprintf(out + used, ")");
+    }
+    size_t used = (size_t)sprintf(out, "(");
+    used += generate(out + used, depth - 1);
+    used += (size_t)sprintf(out + used, "%s", operators[next_random() % 8]);
+    used += generate(out + used, depth - 1);
+    return used + (size_t)sprintf(out + used, ")");
+}
+
+// First node of a kind in the tree ending at root, or AST_NODE_NONE.
+// A tree built by ExprParser_build is the run of nodes after the
+// previous root.
+static AstNodeId find_kind(const AstPool* pool, AstNodeId first, AstNodeId root, AstNodeKind kind) {
+    for (AstNodeId id = first; id <= root; id++) {
+        if (pool->nodes[id].kind == kind) return id;
+    }
+    return AST_NODE_NONE;
+}
+
+// Breaks one node in each of a spread of trees, cycling through four
+// faults that each produce exactly one diagnostic
+static uint32_t corrupt(AstPool* pool, const AstNodeId* roots, size_t count) {
+    uint32_t faults = 0;
+    for (size_t i = CORRUPT_EVERY; i < count; i += CORRUPT_EVERY) {
+        AstNodeId first = roots[i - 1] + 1;
+        AstNode* root = &pool->nodes[roots[i]];
+        AstNodeId target;
+
+        switch ((i / CORRUPT_EVERY) % 4) {
+            case 0:
+                target = find_kind(pool, first, roots[i], AST_NODE_BINARY);
+                if (target == AST_NODE_NONE) continue;
+                pool->nodes[target].op = OP_SIZEOF;
+                break;
+            case 1:
+                target = find_kind(pool, first, roots[i], AST_NODE_IDENTIFIER);
+                if (target == AST_NODE_NONE) continue;
+                pool->nodes[target].kind = AST_NODE_LITERAL;
+                break;
+            case 2:
+                if (!root->child_count) continue;
+                pool->children[root->first_child] = roots[i];
+                break;
+            default:
+                // The previous tree gains a second parent
+                if (!root->child_count) continue;
+                pool->children[root->first_child] = roots[i - 1];
+                break;
+        }
+        faults++;
+    }
+    return faults;
+}
+
+static bool same_diagnostics(const AstValidator* a, const AstValidator* b) {
+    return a->diagnostic_count == b->diagnostic_count &&
+           memcmp(a->diagnostics, b->diagnostics, a->diagnostic_count * sizeof(AstDiagnostic)) == 0;
+}
+
+static double best_run(AstValidator* validator, const AstPool* pool, const TokenBuffer* tokens,
+                       const AstNodeId* roots, uint32_t count, bool* ok) {
+    double best = 1e30;
+    for (int r = 0; r < REPEATS; r++) {
+        double start = now_seconds();
+        *ok = AstValidator_run(validator, pool, tokens, roots, count) && *ok;
+        double elapsed = now_seconds() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t expressions = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_EXPRESSIONS;
+    if (!expressions) expressions = 1;
+
+    // Small expressions with the large ones spread among them
+    size_t bytes = expressions * 512 + (size_t)LARGE_EXPRESSIONS * LARGE_BYTES;
+    char* source = (char*)malloc(bytes);
+    if (!source) return 1;
+    size_t used = 0;
+    size_t large_every = expressions / LARGE_EXPRESSIONS + 1;
+    for (size_t i = 0; i < expressions; i++) {
+        used += generate(source + used, i % large_every == large_every / 2 ? LARGE_DEPTH : SMALL_DEPTH);
+        used += (size_t)sprintf(source + used, ";\n");
+    }
+
+    StringInterner* interner = StringInterner_create();
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    Lexer* lexer = Lexer_createFromBuffer(source, used, "bench");
+    Lexer_setInterner(lexer, interner);
+    Lexer_fillBuffer(lexer, tokens);
+    Lexer_destroy(lexer);
+
+    ExprParser* parser = ExprParser_create();
+    AstPool* pool = AstPool_create(0);
+    AstNodeId* roots = (AstNodeId*)malloc(expressions * sizeof(AstNodeId));
+    if (!parser || !pool || !roots) return 1;
+
+    size_t count = 0;
+    uint32_t begin = 0;
+    for (uint32_t i = 0; i < tokens->count; i++) {
+        if (tokens->types[i] != TOKEN_PUNCT_SEMICOLON) continue;
+        roots[count] = ExprParser_build(parser, tokens, begin, i, pool);
+        if (roots[count] == AST_NODE_NONE) {
+            fprintf(stderr, "expression %zu: %s\n", count, parser->error);
+            return 1;
+        }
+        count++;
+        begin = i + 1;
+    }
+
+    printf("AST validator benchmark (%zu expressions, %u nodes)\n", count, pool->count);
+
+    // A clean pool must validate without diagnostics
+    AstValidator* serial = AstValidator_create(NULL);
+    if (!serial || !AstValidator_run(serial, pool, tokens, roots, (uint32_t)count)) return 1;
+    int status = 0;
+    if (serial->diagnostic_count) {
+        fprintf(stderr, "clean pool reported %u diagnostics\n", serial->diagnostic_count);
+        AstValidator_print(serial, tokens, stderr);
+        status = 1;
+    }
+
+    uint32_t faults = corrupt(pool, roots, count);
+    bool ok = true;
+    double serial_time = best_run(serial, pool, tokens, roots, (uint32_t)count, &ok);
+    printf("injected faults %u, reported %u\n", faults, serial->diagnostic_count);
+    printf("serial      %8.2f ms  %6.2f ns/node\n", serial_time * 1e3, serial_time * 1e9 / pool->count);
+    if (!ok || serial->diagnostic_count != faults) status = 1;
+
+    static const uint32_t thread_counts[] = { 1, 2, 4, 8, 16, 32 };
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        WorkPool* workers = WorkPool_create(thread_counts[t]);
+        AstValidator* validator = AstValidator_create(workers);
+        if (!workers || !validator) return 1;
+
+        ok = true;
+        double elapsed = best_run(validator, pool, tokens, roots, (uint32_t)count, &ok);
+        printf("%2u threads  %8.2f ms  %6.2f ns/node  %5.2fx serial\n", WorkPool_threadCount(workers),
+               elapsed * 1e3, elapsed * 1e9 / pool->count, serial_time / elapsed);
+        if (!ok || !same_diagnostics(serial, validator)) {
+            fprintf(stderr, "%u threads: diagnostics differ from the serial run\n", thread_counts[t]);
+            status = 1;
+        }
+        AstValidator_destroy(validator);
+        WorkPool_destroy(workers);
+    }
+
+    AstValidator_destroy(serial);
+    free(roots);
+    AstPool_destroy(pool);
+    ExprParser_destroy(parser);
+    TokenBuffer_destroy(tokens);
+    StringInterner_destroy(interner);
+    free(source);
+    return status;
+}
@@ -0,0 +1,247 @@
+// Token classification benchmark: the table-driven TokenType_* and
+// GetOperatorPrecedence lookups against the strcmp and range-chain
+// versions they replaced, which are kept here as the baseline. The old
+// precedence ranked only + - * / (as 1 and 2), so its checksum differs;
+// the strcmp chain over every operator spelling gives the same PREC_*
+// answers as the table and shows what resolving all of them by string
+// would cost. Pass a small token count, e.g. 2000, to time the lookups
+// with the tokens in cache rather than the stream of 88-byte Tokens.
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/tokenizer/symbols/sym_value.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_TOKEN_COUNT 2000000
+#define CLASSIFY_PASSES 5
+
+static const char* const source_lines[] = {
+    "int compute_value_%d(int alpha, int beta) {\n",
+    "    total_%d = alpha * 4 + beta / 2 - (gamma << 3) + 0x1F;\n",
+    "    if (total >= limit_%d && !done) { return total % 7; }\n",
+    "    ratio = 1.5e-3 * weight_%d + .25 - bias;\n",
+    "}\n",
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Baseline implementations
+static TokenCategory legacy_category(TokenType type) {
+    if (type >= TOKEN_LITERAL_VALUE && type <= TOKEN_LITERAL_ARRAY)
+        return TOKEN_CATEGORY_LITERAL;
+    if (type >= TOKEN_EXPR_BINARY && type <= TOKEN_EXPR_SIZEOF)
+        return TOKEN_CATEGORY_EXPRESSION;
+    if (type >= TOKEN_STMT_IF && type <= TOKEN_STMT_LABEL)
+        return TOKEN_CATEGORY_STATEMENT;
+    if (type >= TOKEN_DECL_VARIABLE && type <= TOKEN_DECL_REGISTER)
+        return TOKEN_CATEGORY_DECLARATION;
+    if (type >= TOKEN_SCOPE_BEGIN && type <= TOKEN_BRACKET_CLOSE)
+        return TOKEN_CATEGORY_SCOPE;
+    if (type >= TOKEN_PUNCT_SEMICOLON && type <= TOKEN_PUNCT_ELLIPSIS)
+        return TOKEN_CATEGORY_PUNCTUATION;
+    if (type >= TOKEN_TYPE_VOID && type <= TOKEN_TYPE_ENUM)
+        return TOKEN_CATEGORY_TYPE;
+    return TOKEN_CATEGORY_SPECIAL;
+}
+
+static int legacy_precedence(const Token* token) {
+    if (!token || token->type != TOKEN_EXPR_BINARY) return -1;
+    if (!token->value) return 0;
+    if (strcmp(token->value, "*") == 0 || strcmp(token->value, "/") == 0) return 2;
+    if (strcmp(token->value, "+") == 0 || strcmp(token->value, "-") == 0) return 1;
+    return 0;
+}
+
+static int strcmp_chain_precedence(const Token* token) {
+    if (!token || token->type != TOKEN_EXPR_BINARY) return -1;
+    if (!token->value) return 0;
+    for (int op = 0; op < OPERATOR_TYPE_COUNT; op++) {
+        if (strcmp(token->value, GetOperatorString((OperatorType)op)) == 0) {
+            return OperatorType_getPrecedence((OperatorType)op);
+        }
+    }
+    return 0;
+}
+
+static const char* legacy_to_string(TokenType type) {
+    switch (type) {
+        case TOKEN_LITERAL_VALUE: return "VALUE";
+        case TOKEN_LITERAL_KEYWORD: return "KEYWORD";
+        case TOKEN_LITERAL_DELIMITER: return "DELIMITER";
+        case TOKEN_LITERAL_OPERATOR: return "OPERATOR";
+        case TOKEN_LITERAL_IDENTIFIER: return "IDENTIFIER";
+        case TOKEN_LITERAL_STRING: return "STRING";
+        case TOKEN_LITERAL_CHAR: return "CHAR";
+        case TOKEN_LITERAL_INTEGER: return "INTEGER";
+        case TOKEN_LITERAL_FLOAT: return "FLOAT";
+        case TOKEN_LITERAL_BOOL: return "BOOL";
+        case TOKEN_LITERAL_NULL: return "NULL";
+        case TOKEN_LITERAL_ARRAY: return "ARRAY";
+        case TOKEN_EXPR_BINARY: return "BINARY_EXPR";
+        case TOKEN_EXPR_UNARY: return "UNARY_EXPR";
+        default: return "UNKNOWN";
+    }
+}
+
+// Lexes generated source into standalone tokens with interned values
+static Token* build_tokens(size_t count, StringInterner* interner) {
+    Token* tokens = (Token*)malloc(count * sizeof(Token));
+    char* data = (char*)malloc(count * 8 + 256);
+    if (!tokens || !data) {
+        free(tokens);
+        free(data);
+        return NULL;
+    }
+
+    size_t used = 0;
+    size_t line_count = sizeof(source_lines) / sizeof(source_lines[0]);
+    for (int i = 0; used < count * 8; i++) {
+        used += (size_t)sprintf(data + used, source_lines[i % line_count], i % 997);
+    }
+
+    Lexer* lexer = Lexer_createFromBuffer(data, used, "bench");
+    Lexer_setInterner(lexer, interner);
+    size_t filled = 0;
+    while (filled < count && Lexer_next(lexer, &tokens[filled]) && tokens[filled].type != TOKEN_EOF) {
+        filled++;
+    }
+    Lexer_destroy(lexer);
+    free(data);
+
+    if (filled < count) {
+        free(tokens);
+        return NULL;
+    }
+    return tokens;
+}
+
+// Type-only lookups run over a packed type column, as the parser sees
+// them through TokenBuffer; value-dependent ones need the Token itself
+typedef struct ClassifyInput {
+    const Token* tokens;
+    const uint8_t* types;
+    const LexemeId* lexemes;
+    size_t count;
+} ClassifyInput;
+
+typedef uint64_t (*ClassifyPass)(const ClassifyInput* in);
+
+static uint64_t pass_legacy_category(const ClassifyInput* in) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < in->count; i++) sum += legacy_category((TokenType)in->types[i]);
+    return sum;
+}
+
+static uint64_t pass_table_category(const ClassifyInput* in) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < in->count; i++) sum += TokenType_getCategory((TokenType)in->types[i]);
+    return sum;
+}
+
+static uint64_t pass_legacy_precedence(const ClassifyInput* in) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < in->count; i++) sum += (uint64_t)(legacy_precedence(&in->tokens[i]) + 1);
+    return sum;
+}
+
+static uint64_t pass_chain_precedence(const ClassifyInput* in) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < in->count; i++) sum += (uint64_t)(strcmp_chain_precedence(&in->tokens[i]) + 1);
+    return sum;
+}
+
+static uint64_t pass_table_precedence(const ClassifyInput* in) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < in->count; i++) sum += (uint64_t)(GetOperatorPrecedence(&in->tokens[i]) + 1);
+    return sum;
+}
+
+static uint64_t pass_column_precedence(const ClassifyInput* in) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < in->count; i++) {
+        OperatorType op;
+        int precedence = -1;
+        if (in->types[i] == TOKEN_EXPR_BINARY) {
+            precedence = Lexeme_toOperator(in->lexemes[i], &op) ? OperatorType_getPrecedence(op) : 0;
+        }
+        sum += (uint64_t)(precedence + 1);
+    }
+    return sum;
+}
+
+static uint64_t pass_legacy_name(const ClassifyInput* in) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < in->count; i++) sum += (unsigned char)legacy_to_string((TokenType)in->types[i])[0];
+    return sum;
+}
+
+static uint64_t pass_table_name(const ClassifyInput* in) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < in->count; i++) sum += (unsigned char)TokenType_toString((TokenType)in->types[i])[0];
+    return sum;
+}
+
+static uint64_t pass_table_closing(const ClassifyInput* in) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < in->count; i++) sum += TokenType_requiresClosing((TokenType)in->types[i]);
+    return sum;
+}
+
+static double run(const char* name, ClassifyPass pass, const ClassifyInput* in) {
+    double best = 1e30;
+    uint64_t checksum = 0;
+    for (int i = 0; i < CLASSIFY_PASSES; i++) {
+        double start = now_seconds();
+        checksum = pass(in);
+        double elapsed = now_seconds() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    printf("%-24s %6.2f ns/token  (checksum %llu)\n",
+           name, best * 1e9 / (double)in->count, (unsigned long long)checksum);
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_TOKEN_COUNT;
+    StringInterner* interner = StringInterner_create();
+    count = count ? count : 1;
+    Token* tokens = build_tokens(count, interner);
+    uint8_t* types = (uint8_t*)malloc(count);
+    LexemeId* lexemes = (LexemeId*)malloc(count * sizeof(LexemeId));
+    if (!tokens || !types || !lexemes) return 1;
+    for (size_t i = 0; i < count; i++) {
+        types[i] = (uint8_t)tokens[i].type;
+        lexemes[i] = tokens[i].lexeme;
+    }
+    ClassifyInput in = { tokens, types, lexemes, count };
+
+    // The tables must classify every type exactly as the range chain did
+    for (int type = 0; type < TOKEN_TYPE_COUNT; type++) {
+        if (TokenType_getCategory((TokenType)type) != legacy_category((TokenType)type)) {
+            fprintf(stderr, "category mismatch for %s\n", TokenType_toString((TokenType)type));
+            return 1;
+        }
+    }
+
+    printf("Token classification benchmark (%zu tokens, best of %d passes)\n", count, CLASSIFY_PASSES);
+    run("category (ranges)", pass_legacy_category, &in);
+    run("category (table)", pass_table_category, &in);
+    run("precedence (strcmp)", pass_legacy_precedence, &in);
+    run("precedence (strcmp all)", pass_chain_precedence, &in);
+    run("precedence (table)", pass_table_precedence, &in);
+    run("precedence (columns)", pass_column_precedence, &in);
+    run("name (switch)", pass_legacy_name, &in);
+    run("name (table)", pass_table_name, &in);
+    run("requiresClosing", pass_table_closing, &in);
+
+    free(lexemes);
+    free(types);
+    free(tokens);
+    StringInterner_destroy(interner);
+    return 0;
+}
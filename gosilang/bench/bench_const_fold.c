@@ -0,0 +1,83 @@
+// Constant folding benchmark: folds a large generated source of
+// 'a * 4 + 16'-style statements and reports the time per node. The
+// values folded are checked by tests/unit/test_const_fold.c; the run
+// only fails when the fold count shows it timed the wrong work.
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/parser/expr_parser.h"
+#include "compiler/optimizer/fold/const_fold.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_STATEMENTS 200000
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void lex(const char* source, size_t length, StringInterner* interner, TokenBuffer* tokens) {
+    TokenBuffer_clear(tokens);
+    Lexer* lexer = Lexer_createFromBuffer(source, length, "bench");
+    Lexer_setInterner(lexer, interner);
+    Lexer_fillBuffer(lexer, tokens);
+    Lexer_destroy(lexer);
+    // Drop the trailing EOF
+    if (tokens->count && tokens->types[tokens->count - 1] == TOKEN_EOF) tokens->count--;
+}
+
+int main(int argc, char** argv) {
+    size_t statements = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_STATEMENTS;
+    if (!statements) statements = 1;
+
+    ExprParser* parser = ExprParser_create();
+    ConstantFolder* folder = ConstantFolder_create();
+    if (!parser || !folder) return 1;
+
+    // Generated code: half the statements fold completely, the other
+    // half keep their variable but lose two constant subtrees
+    char* source = (char*)malloc(statements * 64);
+    if (!source) return 1;
+    size_t used = 0;
+    for (size_t i = 0; i < statements; i++) {
+        unsigned k = (unsigned)(i % 1000);
+        used += (size_t)sprintf(source + used, i % 2 ? "v%u = %u * 4 + 16;\n" : "v%u = a * 4 + 16 * %u - (%u << 2);\n",
+                                k, k, k);
+    }
+
+    StringInterner* interner = StringInterner_create();
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    AstPool* pool = AstPool_create(0);
+    if (!interner || !tokens || !pool) return 1;
+    lex(source, used, interner, tokens);
+
+    uint32_t root_count = 0, start = 0;
+    for (uint32_t i = 0; i < tokens->count; i++) {
+        if (tokens->types[i] != TOKEN_PUNCT_SEMICOLON) continue;
+        if (ExprParser_build(parser, tokens, start, i, pool) != AST_NODE_NONE) root_count++;
+        start = i + 1;
+    }
+
+    double elapsed = now_seconds();
+    bool ran = ConstantFolder_run(folder, pool, tokens);
+    elapsed = now_seconds() - elapsed;
+
+    size_t expected = statements * 2;
+    int status = 0;
+    if (!ran || root_count != statements || folder->folded != expected) {
+        fprintf(stderr, "folded %u of %zu operators\n", folder->folded, expected);
+        status = 1;
+    }
+    printf("%zu statements, %u nodes, %u operators folded  %8.2f ms  %6.1f ns/node\n", statements, pool->count,
+           folder->folded, elapsed * 1e3, elapsed * 1e9 / pool->count);
+
+    AstPool_destroy(pool);
+    TokenBuffer_destroy(tokens);
+    StringInterner_destroy(interner);
+    free(source);
+    ConstantFolder_destroy(folder);
+    ExprParser_destroy(parser);
+    return status;
+}
@@ -0,0 +1,235 @@
+// Compilation driver benchmark: writes a set of generated source files,
+// a few with errors, and compiles them all with 1 to 16 threads. Every
+// run must produce the same totals, diagnostics and global scope as the
+// single-thread run. A second part interns overlapping names from many
+// threads into one SharedInterner, which must hand every name one id;
+// the benchmark fails otherwise.
+#include "compiler/driver/driver.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_FILES 64
+#define LINES_PER_FILE 4000
+#define BAD_FILE_EVERY 16
+#define INTERN_THREADS 8
+#define INTERN_NAMES 200000
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static const char* const source_lines[] = {
+    "total_%d = alpha * %d + beta / 2 - (gamma << 3);\n",
+    "// running total %d %d\n",
+    "flag_%d = (count > limit) ? first : %d;\n",
+    "value_%d += node->next->weight * %d, index++;\n",
+    "shared_%d = %d;\n",
+};
+
+static bool write_file(const char* path, int file, bool bad) {
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+
+    size_t line_count = sizeof(source_lines) / sizeof(source_lines[0]);
+    for (int i = 0; i < LINES_PER_FILE; i++) {
+        // shared_N names repeat across files, the others are per file
+        int name = i % line_count == 4 ? (int)(i / line_count) % 50 : file * LINES_PER_FILE + i;
+        fprintf(out, source_lines[i % line_count], name, i);
+        if (bad && i % 500 == 250) fputs("broken = (a + ;\n", out);
+    }
+    return fclose(out) == 0;
+}
+
+// What one run reports, compared against the single-thread run
+typedef struct RunSummary {
+    uint64_t tokens, statements, errors, globals, folded;
+    uint32_t failed;
+    uint32_t scope_symbols;
+    char* messages;
+} RunSummary;
+
+static bool compile_all(uint32_t threads, const char* const* paths, uint32_t count, RunSummary* summary,
+                        double* seconds) {
+    CompileOptions options = {0};
+    options.threads = threads;
+    options.validate = true;
+    options.fold = true;
+    CompileDriver* driver = CompileDriver_create(&options);
+    if (!driver) return false;
+
+    double start = now_seconds();
+    CompileDriver_run(driver, paths, count);
+    *seconds = now_seconds() - start;
+
+    memset(summary, 0, sizeof(*summary));
+    size_t message_size = 0;
+    for (uint32_t i = 0; i < driver->file_count; i++) {
+        const CompileResult* result = &driver->results[i];
+        summary->tokens += result->tokens;
+        summary->statements += result->statements;
+        summary->errors += result->errors;
+        summary->globals += result->globals;
+        summary->folded += result->folded;
+        summary->failed += !result->ok;
+        if (result->messages) message_size += strlen(result->messages);
+    }
+    summary->scope_symbols = SharedScope_count(driver->globals);
+
+    summary->messages = (char*)calloc(message_size + 1, 1);
+    for (uint32_t i = 0; summary->messages && i < driver->file_count; i++) {
+        if (driver->results[i].messages) strcat(summary->messages, driver->results[i].messages);
+    }
+
+    // Every global must be found again in the shared scope
+    bool ok = summary->messages != NULL && summary->globals == summary->scope_symbols;
+    for (int n = 0; ok && n < 50; n++) {
+        char name[32];
+        int length = snprintf(name, sizeof(name), "shared_%d", n);
+        ok = SharedScope_find(driver->globals, name, (size_t)length, Lexeme_hash(name, (size_t)length)) != NULL;
+    }
+    CompileDriver_destroy(driver);
+    return ok;
+}
+
+static bool same_summary(const RunSummary* a, const RunSummary* b) {
+    return a->tokens == b->tokens && a->statements == b->statements && a->errors == b->errors &&
+           a->globals == b->globals && a->folded == b->folded && a->failed == b->failed &&
+           a->scope_symbols == b->scope_symbols && strcmp(a->messages, b->messages) == 0;
+}
+
+typedef struct InternJob {
+    SharedInterner* interner;
+    uint32_t seed;
+    LexemeId* ids;              // One per name
+    pthread_t thread;
+} InternJob;
+
+static void* intern_names(void* data) {
+    InternJob* job = (InternJob*)data;
+    char name[32];
+    // Each thread walks the names in a different order
+    for (uint32_t i = 0; i < INTERN_NAMES; i++) {
+        uint32_t n = (i * 7919u + job->seed * 104729u) % INTERN_NAMES;
+        int length = snprintf(name, sizeof(name), "name_%u", n);
+        job->ids[n] = SharedInterner_intern(job->interner, name, (size_t)length);
+    }
+    return NULL;
+}
+
+static bool check_interner(void) {
+    SharedInterner* interner = SharedInterner_create();
+    InternJob jobs[INTERN_THREADS];
+    bool ok = interner != NULL;
+    for (int t = 0; ok && t < INTERN_THREADS; t++) {
+        jobs[t].interner = interner;
+        jobs[t].seed = (uint32_t)t;
+        jobs[t].ids = (LexemeId*)malloc(INTERN_NAMES * sizeof(LexemeId));
+        ok = jobs[t].ids != NULL;
+    }
+    if (!ok) return false;
+
+    double start = now_seconds();
+    for (int t = 0; t < INTERN_THREADS; t++) {
+        pthread_create(&jobs[t].thread, NULL, intern_names, &jobs[t]);
+    }
+    for (int t = 0; t < INTERN_THREADS; t++) {
+        pthread_join(jobs[t].thread, NULL);
+    }
+    double elapsed = now_seconds() - start;
+
+    // Ids agree across threads, are dense and read back as their names
+    ok = SharedInterner_count(interner) == LEXEME_RESERVED_COUNT + INTERN_NAMES;
+    char name[32];
+    for (uint32_t n = 0; ok && n < INTERN_NAMES; n++) {
+        for (int t = 1; ok && t < INTERN_THREADS; t++) {
+            ok = jobs[t].ids[n] == jobs[0].ids[n];
+        }
+        snprintf(name, sizeof(name), "name_%u", n);
+        const char* text = SharedInterner_get(interner, jobs[0].ids[n], NULL);
+        ok = ok && jobs[0].ids[n] >= LEXEME_RESERVED_COUNT && text && strcmp(text, name) == 0;
+    }
+    ok = ok && SharedInterner_find(interner, "while", 5) == LEXEME_KEYWORD_FIRST + KW_WHILE;
+
+    printf("shared interner  %u threads x %u names  %8.2f ms  %6.1f ns/intern\n", INTERN_THREADS, INTERN_NAMES,
+           elapsed * 1e3, elapsed * 1e9 / ((double)INTERN_THREADS * INTERN_NAMES));
+    for (int t = 0; t < INTERN_THREADS; t++) {
+        free(jobs[t].ids);
+    }
+    SharedInterner_destroy(interner);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : DEFAULT_FILES;
+    if (!count) count = 1;
+
+    char directory[] = "/tmp/gosi_driver_XXXXXX";
+    if (!mkdtemp(directory)) return 1;
+
+    char** paths = (char**)calloc(count, sizeof(char*));
+    int status = paths ? 0 : 1;
+    for (uint32_t i = 0; !status && i < count; i++) {
+        paths[i] = (char*)malloc(sizeof(directory) + 32);
+        if (!paths[i]) {
+            status = 1;
+            break;
+        }
+        sprintf(paths[i], "%s/unit_%u.gs", directory, i);
+        if (!write_file(paths[i], (int)i, i % BAD_FILE_EVERY == BAD_FILE_EVERY - 1)) status = 1;
+    }
+    if (status) fprintf(stderr, "cannot write sources to %s\n", directory);
+
+    printf("Compilation driver benchmark (%u files, %d lines each, %ld CPUs)\n", count, LINES_PER_FILE,
+           sysconf(_SC_NPROCESSORS_ONLN));
+
+    static const uint32_t thread_counts[] = { 1, 2, 4, 8, 16 };
+    RunSummary serial;
+    memset(&serial, 0, sizeof(serial));
+    double serial_time = 0;
+    for (size_t t = 0; !status && t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        RunSummary summary;
+        double seconds = 0;
+        if (!compile_all(thread_counts[t], (const char* const*)paths, count, &summary, &seconds)) {
+            fprintf(stderr, "%u threads: globals missing from the shared tables\n", thread_counts[t]);
+            status = 1;
+        }
+        if (t == 0) {
+            serial = summary;
+            serial_time = seconds;
+            printf("%llu tokens, %llu statements, %llu errors in %u files, %llu globals\n",
+                   (unsigned long long)serial.tokens, (unsigned long long)serial.statements,
+                   (unsigned long long)serial.errors, serial.failed, (unsigned long long)serial.globals);
+        } else {
+            if (!status && !same_summary(&serial, &summary)) {
+                fprintf(stderr, "%u threads: results differ from the single-thread run\n", thread_counts[t]);
+                status = 1;
+            }
+            free(summary.messages);
+        }
+        printf("%2u threads  %8.2f ms  %7.1f M tokens/s  %5.2fx one thread\n", thread_counts[t], seconds * 1e3,
+               (double)serial.tokens / seconds / 1e6, serial_time / seconds);
+    }
+    if (!status && (serial.failed != count / BAD_FILE_EVERY || serial.errors < serial.failed)) {
+        fprintf(stderr, "expected errors in every %dth file\n", BAD_FILE_EVERY);
+        status = 1;
+    }
+    free(serial.messages);
+
+    if (!status && !check_interner()) {
+        fprintf(stderr, "shared interner handed out inconsistent ids\n");
+        status = 1;
+    }
+
+    for (uint32_t i = 0; paths && i < count; i++) {
+        if (paths[i]) unlink(paths[i]);
+        free(paths[i]);
+    }
+    free(paths);
+    rmdir(directory);
+    return status;
+}
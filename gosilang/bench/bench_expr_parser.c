@@ -0,0 +1,113 @@
+// Expression parser benchmark: ns/token for generated expressions of
+// increasing length, to show the parse is linear and that a warmed-up
+// parser does no further allocation, plus the cost of building the
+// AST into a pool that is cleared between runs.
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/parser/expr_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PARSE_REPEATS 20
+
+// Cycles through every operator class: arithmetic, shifts, comparisons,
+// bitwise, logical, assignment, ternary, unary, postfix and grouping
+static const char* const term_formats[] = {
+    "v%u", " + v%u", " * (v%u", " - v%u)", " << v%u", " < -v%u", " == v%u++",
+    " & ~v%u", " ^ v%u", " | !v%u", " && v%u", " || v%u", " ? v%u", " : v%u",
+    " = v%u", " += *v%u", " , v%u"
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char* generate_expression(size_t terms, size_t* length) {
+    size_t format_count = sizeof(term_formats) / sizeof(term_formats[0]);
+    char* data = (char*)malloc((terms + format_count) * 16 + 64);
+    if (!data) return NULL;
+
+    // Whole cycles only, so every group and ternary is closed
+    size_t cycle = format_count - 1;
+    terms = (terms + cycle - 1) / cycle * cycle;
+
+    size_t used = (size_t)sprintf(data, term_formats[0], 0u);
+    for (size_t i = 0; i < terms; i++) {
+        used += (size_t)sprintf(data + used, term_formats[1 + i % cycle], (unsigned)(i % 1000));
+    }
+    *length = used;
+    return data;
+}
+
+static int bench_terms(ExprParser* parser, AstPool* pool, size_t terms) {
+    size_t length = 0;
+    char* source = generate_expression(terms, &length);
+    if (!source) return 1;
+
+    TokenBuffer* buffer = TokenBuffer_create(0);
+    Lexer* lexer = Lexer_createFromBuffer(source, length, "bench");
+    Lexer_fillBuffer(lexer, buffer);
+    Lexer_destroy(lexer);
+    uint32_t count = buffer->count - 1;   // Without TOKEN_EOF
+
+    // The first parse sizes the scratch; later ones must not grow it
+    int status = 0;
+    if (!ExprParser_parse(parser, buffer, 0, count)) {
+        fprintf(stderr, "%zu terms: %s at token %u\n", terms, parser->error, parser->error_token);
+        status = 1;
+    }
+    uint32_t output_capacity = parser->output_capacity;
+    uint32_t stack_capacity = parser->stack_capacity;
+
+    double best = 1e30;
+    for (int i = 0; status == 0 && i < PARSE_REPEATS; i++) {
+        double start = now_seconds();
+        ExprParser_parse(parser, buffer, 0, count);
+        double elapsed = now_seconds() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    bool grew = parser->output_capacity != output_capacity || parser->stack_capacity != stack_capacity;
+    if (grew) status = 1;
+
+    // Building reuses the pool's storage once it has held the largest tree
+    double best_build = 1e30;
+    for (int i = 0; status == 0 && i < PARSE_REPEATS; i++) {
+        AstPool_clear(pool);
+        double start = now_seconds();
+        AstNodeId root = ExprParser_build(parser, buffer, 0, count, pool);
+        double elapsed = now_seconds() - start;
+        if (root != pool->count - 1) status = 1;
+        if (elapsed < best_build) best_build = elapsed;
+    }
+
+    if (status == 0) {
+        printf("%9zu terms %9u tokens %9.3f ms  %6.2f ns/token  scratch %s  build %6.2f ns/token\n",
+               terms, count, best * 1e3, best * 1e9 / count, grew ? "grew" : "reused",
+               best_build * 1e9 / count);
+    }
+
+    TokenBuffer_destroy(buffer);
+    free(source);
+    return status;
+}
+
+int main(int argc, char** argv) {
+    size_t largest = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    ExprParser* parser = ExprParser_create();
+    AstPool* pool = AstPool_create(0);
+    if (!parser || !pool) return 1;
+
+    printf("Expression parser benchmark (best of %d parses, %zu-byte AST nodes)\n",
+           PARSE_REPEATS, sizeof(AstNode));
+    int status = 0;
+    for (size_t terms = 1000; terms <= largest && status == 0; terms *= 10) {
+        status = bench_terms(parser, pool, terms);
+    }
+
+    AstPool_destroy(pool);
+    ExprParser_destroy(parser);
+    return status;
+}
@@ -0,0 +1,137 @@
+// Formatting benchmark: dumps a lexed token stream with Token_print per
+// token against TokenBuffer_dump, and formats literal values with a
+// strdup per value against FormatValue into one reused buffer. What
+// they print is checked by tests/unit/test_format.c.
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/tokenizer/symbols/sym_format.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_LINES 100000
+#define VALUE_COUNT 1000000
+
+static const char* const source_lines[] = {
+    "int compute_value_%d(int alpha, int beta) {\n",
+    "    total_%d = alpha * 4 + beta / 2 - (gamma << 3) + 0x1F;\n",
+    "    if (total >= limit_%d && !done) { return call(total); }\n",
+    "    ratio = 1.5e-3 * weight_%d + .25;\n",
+    "}\n",
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// The old ValueToString: a snprintf and a strdup per value
+static char* format_with_strdup(const LiteralValue* value) {
+    char buffer[64];
+    if (value->type == VAL_FLOAT) {
+        snprintf(buffer, sizeof(buffer), "%f", value->data.float_val);
+    } else {
+        snprintf(buffer, sizeof(buffer), "%" PRId64, value->data.int_val);
+    }
+    return strdup(buffer);
+}
+
+int main(int argc, char** argv) {
+    int lines = argc > 1 ? atoi(argv[1]) : DEFAULT_LINES;
+    if (lines <= 0) lines = 1;
+
+    size_t capacity = (size_t)lines * 80, used = 0;
+    char* source = (char*)malloc(capacity);
+    if (!source) return 1;
+    size_t line_count = sizeof(source_lines) / sizeof(source_lines[0]);
+    for (int i = 0; i < lines; i++) {
+        used += (size_t)snprintf(source + used, capacity - used, source_lines[i % line_count], i);
+    }
+
+    StringInterner* interner = StringInterner_create();
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    SourceFile* file = SourceFile_fromBuffer(source, used, "bench");
+    Lexer* lexer = Lexer_createFromSource(file);
+    if (!interner || !tokens || !lexer) return 1;
+    Lexer_setInterner(lexer, interner);
+    Lexer_fillBuffer(lexer, tokens);
+    Lexer_destroy(lexer);
+
+    Token token;
+    FILE* null_stream = fopen("/dev/null", "w");
+    if (!null_stream) return 1;
+    double start = now_seconds();
+    for (uint32_t i = 0; i < tokens->count; i++) {
+        TokenBuffer_get(tokens, i, &token);
+        Token_print(&token, null_stream);
+        fputc('\n', null_stream);
+    }
+    fflush(null_stream);
+    double print_time = now_seconds() - start;
+
+    start = now_seconds();
+    TokenBuffer_dump(tokens, fileno(null_stream));
+    double dump_time = now_seconds() - start;
+    fclose(null_stream);
+
+    printf("%u tokens\n", tokens->count);
+    printf("Token_print per token  %8.2f ms  %6.1f ns/token\n", print_time * 1e3, print_time * 1e9 / tokens->count);
+    printf("TokenBuffer_dump       %8.2f ms  %6.1f ns/token  %5.2fx\n", dump_time * 1e3,
+           dump_time * 1e9 / tokens->count, print_time / dump_time);
+
+    // Values: half integers, half floats with a few decimals
+    LiteralValue* values = (LiteralValue*)calloc(VALUE_COUNT, sizeof(LiteralValue));
+    if (!values) return 1;
+    for (int i = 0; i < VALUE_COUNT; i++) {
+        uint64_t r = next_random();
+        values[i].type = i % 2 ? VAL_FLOAT : VAL_INTEGER;
+        if (i % 2) {
+            values[i].data.float_val = (double)(int64_t)(r % 2000001 - 1000000) / 100.0;
+        } else {
+            values[i].data.int_val = (int64_t)r >> (r % 64);
+        }
+    }
+
+    size_t strdup_bytes = 0;
+    start = now_seconds();
+    for (int i = 0; i < VALUE_COUNT; i++) {
+        char* text = format_with_strdup(&values[i]);
+        strdup_bytes += strlen(text);
+        free(text);
+    }
+    double strdup_time = now_seconds() - start;
+
+    StringBuffer buffer;
+    StringBuffer_init(&buffer);
+    start = now_seconds();
+    for (int i = 0; i < VALUE_COUNT; i++) {
+        FormatValue(&buffer, &values[i]);
+        StringBuffer_appendChar(&buffer, '\n');
+    }
+    double format_time = now_seconds() - start;
+    int status = buffer.failed ? 1 : 0;
+
+    printf("%d values, %zu bytes as %%f / %%lld\n", VALUE_COUNT, strdup_bytes);
+    printf("snprintf + strdup      %8.2f ms  %6.1f ns/value\n", strdup_time * 1e3, strdup_time * 1e9 / VALUE_COUNT);
+    printf("FormatValue            %8.2f ms  %6.1f ns/value  %5.2fx\n", format_time * 1e3,
+           format_time * 1e9 / VALUE_COUNT, strdup_time / format_time);
+
+    StringBuffer_free(&buffer);
+    free(values);
+    TokenBuffer_destroy(tokens);
+    SourceFile_close(file);
+    StringInterner_destroy(interner);
+    free(source);
+    return status;
+}
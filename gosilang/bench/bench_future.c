@@ -0,0 +1,144 @@
+// Futures benchmark: measures the cost of spawning and completing a
+// future, from outside the pool and from inside a task, with 1 to 8
+// threads, and the scaling of a recursive Fibonacci split into futures.
+// What futures compute is checked by tests/unit/test_future.c; the run
+// fails only when a batch or a Fibonacci result shows it timed the
+// wrong work.
+#include "runtime/concurrency/futures/future.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DEFAULT_TASKS 1000000
+#define FIB_N 35
+#define FIB_CUTOFF 18
+
+static const uint32_t thread_counts[] = { 1, 2, 4, 8 };
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+#define VALUE(n) ((void*)(uintptr_t)(n))
+#define NUMBER(value) ((uintptr_t)(value))
+
+static FutureResult Nothing(void* data) {
+    return FutureResult_ok(data);
+}
+
+// Spawns count trivial futures and waits for them all; seconds taken
+static double spawn_batch(WorkPool* pool, uint32_t count, bool* ok) {
+    Future** futures = (Future**)malloc(count * sizeof(Future*));
+    if (!futures) {
+        *ok = false;
+        return 0.0;
+    }
+    double start = now_seconds();
+    for (uint32_t i = 0; i < count; i++) {
+        futures[i] = Future_spawn(pool, Nothing, VALUE(i));
+        if (!futures[i]) {
+            *ok = false;
+            count = i;
+            break;
+        }
+    }
+    Future* all = Future_whenAll(pool, futures, count);
+    if (all) {
+        *ok = Future_wait(all).ok && *ok;
+        Future_release(all);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        Future_release(futures[i]);
+    }
+    double elapsed = now_seconds() - start;
+    free(futures);
+    if (!all) *ok = false;
+    return elapsed;
+}
+
+typedef struct SpawnJob {
+    WorkPool* pool;
+    uint32_t count;
+    bool ok;
+} SpawnJob;
+
+// The same from inside a task, so the futures go to a worker's deque
+static FutureResult SpawnInside(void* data) {
+    SpawnJob* job = (SpawnJob*)data;
+    job->ok = true;
+    spawn_batch(job->pool, job->count, &job->ok);
+    return FutureResult_ok(NULL);
+}
+
+typedef struct FibJob {
+    WorkPool* pool;
+    uint32_t n;
+} FibJob;
+
+static uint64_t fib_serial(uint32_t n) {
+    return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+// fib(n - 1) as a future, fib(n - 2) on this thread
+static FutureResult Fib(void* data) {
+    FibJob* job = (FibJob*)data;
+    if (job->n < FIB_CUTOFF) return FutureResult_ok(VALUE(fib_serial(job->n)));
+
+    FibJob left = { job->pool, job->n - 1 };
+    FibJob right = { job->pool, job->n - 2 };
+    Future* future = Future_spawn(job->pool, Fib, &left);
+    if (!future) return FutureResult_error(NULL);
+    FutureResult other = Fib(&right);
+    FutureResult result = Future_wait(future);
+    Future_release(future);
+    if (!result.ok || !other.ok) return FutureResult_error(NULL);
+    return FutureResult_ok(VALUE(NUMBER(result.value) + NUMBER(other.value)));
+}
+
+int main(int argc, char** argv) {
+    int tasks = argc > 1 ? atoi(argv[1]) : DEFAULT_TASKS;
+    if (tasks <= 0) tasks = 1;
+    int status = 0;
+
+    uint64_t fib_expected = fib_serial(FIB_N);
+    double fib_single = 0.0;
+    printf("%d futures per batch, fib(%d) split below %d\n", tasks, FIB_N, FIB_CUTOFF);
+    printf("threads  outside ns/task  inside ns/task    fib ms  speedup\n");
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        WorkPool* pool = WorkPool_create(thread_counts[t]);
+        if (!pool) return 1;
+
+        bool ok = true;
+        double outside = spawn_batch(pool, (uint32_t)tasks, &ok);
+
+        SpawnJob spawn = { pool, (uint32_t)tasks, false };
+        double start = now_seconds();
+        Future* inside = Future_spawn(pool, SpawnInside, &spawn);
+        if (inside) {
+            Future_wait(inside);
+            Future_release(inside);
+        }
+        double inside_time = now_seconds() - start;
+        ok = ok && inside && spawn.ok;
+
+        FibJob fib = { pool, FIB_N };
+        start = now_seconds();
+        FutureResult result = Fib(&fib);
+        double fib_time = now_seconds() - start;
+        if (!result.ok || NUMBER(result.value) != fib_expected) {
+            fprintf(stderr, "fib(%d) with %u threads gave %ju\n", FIB_N, thread_counts[t],
+                    (uintmax_t)NUMBER(result.value));
+            ok = false;
+        }
+        if (t == 0) fib_single = fib_time;
+
+        printf("%7u  %15.1f  %14.1f  %8.2f  %6.2fx\n", WorkPool_threadCount(pool), outside * 1e9 / tasks, inside_time * 1e9 / tasks,
+               fib_time * 1e3, fib_single / fib_time);
+        if (!ok) status = 1;
+        WorkPool_destroy(pool);
+    }
+    return status;
+}
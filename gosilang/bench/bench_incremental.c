@@ -0,0 +1,278 @@
+// Incremental re-lex and re-parse benchmark: builds a document of
+// expression statements and comments, then applies random one-byte
+// inserts, deletes and replacements, timing each edit against a full
+// rebuild. Each edit is timed by the wall clock and by the thread's CPU
+// clock: on a loaded or single-CPU machine the wall time of a few edits
+// includes time the thread spent preempted, which only the second
+// excludes. Then times the worst case, a comment left open in the
+// middle of a document with no other comments. At intervals and at the
+// end, the blocks' tokens, statements and trees must match a fresh lex
+// and parse of the whole text; the benchmark fails otherwise.
+#include "core/parser/incremental_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_LINES 100000
+#define EDITS 20000
+#define CHECK_EVERY 1000
+
+static const char* const source_lines[] = {
+    "total_%d = alpha * 4 + beta / 2 - (gamma << 3) + 0x1F;\n",
+    "// running total %d\n",
+    "flag_%d = (count > limit) ? first : second;\n",
+    "value_%d += node->next->weight * 3, index++;\n",
+    "/* block %d */ ratio = 1.5e-3 * weight + .25;\n",
+    "mask_%d = ~bits & 0xFF | (bits << 2) ^ -shift;\n",
+};
+
+// Bytes an edit may insert or substitute
+static const char edit_bytes[] = "a1 +*;()/\n";
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 0x853C49E6748FEA9Bull;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+static double cpu_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// The whole text lexed and split at every ';', as the blocks do it
+typedef struct Reference {
+    TokenBuffer* tokens;
+    AstPool* pool;
+    ParsedStatement* statements;
+    uint32_t statement_count;
+} Reference;
+
+static bool build_reference(Reference* ref, const char* text, size_t length, ExprParser* parser) {
+    ref->tokens = TokenBuffer_create(0);
+    ref->pool = AstPool_create(0);
+    Lexer* lexer = Lexer_createFromBuffer(text, length, "reference");
+    if (!ref->tokens || !ref->pool || !lexer) return false;
+    lexer->skip_comments = true;
+    Lexer_fillBuffer(lexer, ref->tokens);
+    Lexer_destroy(lexer);
+    ref->tokens->count--;
+
+    ref->statements = (ParsedStatement*)malloc((ref->tokens->count + 1) * sizeof(ParsedStatement));
+    if (!ref->statements) return false;
+    ref->statement_count = 0;
+    uint32_t start = 0;
+    for (uint32_t i = 0; i <= ref->tokens->count; i++) {
+        bool end = i == ref->tokens->count;
+        if (!end && ref->tokens->types[i] != TOKEN_PUNCT_SEMICOLON) continue;
+        if (end && start == i) break;
+
+        ParsedStatement* statement = &ref->statements[ref->statement_count++];
+        statement->begin = start;
+        statement->end = i;
+        statement->root = start < i ? ExprParser_build(parser, ref->tokens, start, i, ref->pool) : AST_NODE_NONE;
+        start = i + 1;
+    }
+    return true;
+}
+
+static void free_reference(Reference* ref) {
+    TokenBuffer_destroy(ref->tokens);
+    AstPool_destroy(ref->pool);
+    free(ref->statements);
+}
+
+static bool same_tree(const AstPool* a, AstNodeId x, uint32_t token_base, const AstPool* b, AstNodeId y) {
+    if ((x == AST_NODE_NONE) != (y == AST_NODE_NONE)) return false;
+    if (x == AST_NODE_NONE) return true;
+
+    const AstNode* p = &a->nodes[x];
+    const AstNode* q = &b->nodes[y];
+    if (p->kind != q->kind || p->op != q->op || p->token + token_base != q->token ||
+        p->child_count != q->child_count) {
+        return false;
+    }
+    for (uint32_t i = 0; i < p->child_count; i++) {
+        if (!same_tree(a, a->children[p->first_child + i], token_base, b, b->children[q->first_child + i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Compares every block with a fresh parse of the whole text
+static bool check_document(const IncrementalParser* doc, const char* text, size_t length, ExprParser* parser) {
+    Reference ref;
+    memset(&ref, 0, sizeof(ref));
+    bool ok = build_reference(&ref, text, length, parser) && doc->length == length;
+
+    uint32_t token_base = 0;
+    uint32_t statement = 0;
+    size_t base = 0;
+    for (uint32_t b = 0; ok && b < doc->block_count; b++) {
+        const SourceBlock* block = doc->blocks[b];
+        const TokenBuffer* tokens = block->tokens;
+        ok = memcmp(block->text, text + base, block->length) == 0 &&
+             token_base + tokens->count <= ref.tokens->count;
+        for (uint32_t i = 0; ok && i < tokens->count; i++) {
+            uint32_t g = token_base + i;
+            ok = tokens->types[i] == ref.tokens->types[g] &&
+                 tokens->offsets[i] + base == ref.tokens->offsets[g] &&
+                 tokens->lengths[i] == ref.tokens->lengths[g] &&
+                 tokens->lexemes[i] == ref.tokens->lexemes[g];
+        }
+        for (uint32_t s = 0; ok && s < block->statement_count; s++, statement++) {
+            const ParsedStatement* mine = &block->statements[s];
+            const ParsedStatement* theirs = &ref.statements[statement];
+            ok = statement < ref.statement_count &&
+                 mine->begin + token_base == theirs->begin && mine->end + token_base == theirs->end &&
+                 same_tree(block->pool, mine->root, token_base, ref.pool, theirs->root);
+        }
+        token_base += tokens->count;
+        base += block->length;
+    }
+    ok = ok && token_base == ref.tokens->count && statement == ref.statement_count;
+    free_reference(&ref);
+    return ok;
+}
+
+// The worst case: in a document without comments, one opened
+// mid-document runs to its end, so every later block is taken over;
+// closing it splits them out again. Both must still match a full parse.
+static bool check_unclosed_comment(size_t lines, ExprParser* parser) {
+    char* text = (char*)malloc(lines * 64 + 3);
+    if (!text) return false;
+    size_t length = 0;
+    for (size_t i = 0; i < lines; i++) {
+        length += (size_t)sprintf(text + length, source_lines[0], (int)(i % 997));
+    }
+    IncrementalParser* doc = IncrementalParser_create(text, length, NULL);
+    const char* newline = (const char*)memchr(text + length / 2, '\n', length - length / 2);
+    size_t middle = newline ? (size_t)(newline - text) + 1 : length;
+    bool ok = doc != NULL;
+
+    double start = now_seconds();
+    ok = ok && IncrementalParser_edit(doc, middle, 0, "/*", 2);
+    double open_time = now_seconds() - start;
+    memmove(text + middle + 2, text + middle, length - middle);
+    memcpy(text + middle, "/*", 2);
+    ok = ok && check_document(doc, text, length + 2, parser);
+    uint32_t open_blocks = ok ? doc->block_count : 0;
+
+    start = now_seconds();
+    ok = ok && IncrementalParser_edit(doc, middle, 2, "", 0);
+    double close_time = now_seconds() - start;
+    memmove(text + middle, text + middle + 2, length - middle);
+    ok = ok && check_document(doc, text, length, parser);
+
+    if (ok) {
+        printf("unclosed /*  %8.2f ms  (%u blocks left)  closing it %8.2f ms  (%u blocks)\n", open_time * 1e3,
+               open_blocks, close_time * 1e3, doc->block_count);
+    } else {
+        fprintf(stderr, "unclosed comment: document differs from a full parse\n");
+    }
+    IncrementalParser_destroy(doc);
+    free(text);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    size_t lines = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_LINES;
+    if (!lines) lines = 1;
+
+    size_t line_count = sizeof(source_lines) / sizeof(source_lines[0]);
+    size_t capacity = lines * 64 + EDITS + 1;
+    char* text = (char*)malloc(capacity);
+    double* latencies = (double*)malloc(EDITS * sizeof(double));
+    double* cpu_times = (double*)malloc(EDITS * sizeof(double));
+    ExprParser* parser = ExprParser_create();
+    if (!text || !latencies || !cpu_times || !parser) return 1;
+
+    size_t length = 0;
+    for (size_t i = 0; i < lines; i++) {
+        length += (size_t)sprintf(text + length, source_lines[i % line_count], (int)(i % 997));
+    }
+
+    double start = now_seconds();
+    IncrementalParser* doc = IncrementalParser_create(text, length, NULL);
+    double build_time = now_seconds() - start;
+    if (!doc) return 1;
+
+    printf("Incremental parser benchmark (%zu lines, %.1f MB, %u blocks)\n", lines,
+           (double)length / (1 << 20), doc->block_count);
+    printf("full build   %8.2f ms\n", build_time * 1e3);
+    int status = check_document(doc, text, length, parser) ? 0 : 1;
+    if (status) fprintf(stderr, "initial build differs from a full parse\n");
+
+    uint64_t relexed = 0, reparsed = 0, rebuilt = 0;
+    for (int e = 0; e < EDITS && !status; e++) {
+        size_t offset = length ? next_random() % length : 0;
+        size_t removed = 0;
+        size_t inserted = 0;
+        char byte = edit_bytes[next_random() % (sizeof(edit_bytes) - 1)];
+        switch (next_random() % 3) {
+            case 0: inserted = 1; break;
+            case 1: removed = length ? 1 : 0; break;
+            default: removed = length ? 1 : 0; inserted = 1; break;
+        }
+
+        double cpu_start = cpu_seconds();
+        start = now_seconds();
+        bool ok = IncrementalParser_edit(doc, offset, removed, &byte, inserted);
+        latencies[e] = now_seconds() - start;
+        cpu_times[e] = cpu_seconds() - cpu_start;
+        relexed += doc->relexed_tokens;
+        reparsed += doc->reparsed_statements;
+        rebuilt += doc->rebuilt_blocks;
+
+        memmove(text + offset + inserted, text + offset + removed, length - offset - removed);
+        if (inserted) text[offset] = byte;
+        length = length - removed + inserted;
+
+        if (!ok || ((e + 1) % CHECK_EVERY == 0 && !check_document(doc, text, length, parser))) {
+            fprintf(stderr, "edit %d at offset %zu: document differs from a full parse\n", e, offset);
+            status = 1;
+        }
+    }
+
+    if (!status) {
+        static const char* const clocks[] = { "wall", "cpu" };
+        double* times[] = { latencies, cpu_times };
+        for (int c = 0; c < 2; c++) {
+            size_t over = 0;
+            for (int e = 0; e < EDITS; e++) over += times[c][e] > 1e-3;
+            qsort(times[c], EDITS, sizeof(double), compare_doubles);
+            printf("edit %-4s   median %8.2f us  p99 %8.2f us  max %8.2f us  (%zu of %d over 1 ms)\n",
+                   clocks[c], times[c][EDITS / 2] * 1e6, times[c][EDITS * 99 / 100] * 1e6,
+                   times[c][EDITS - 1] * 1e6, over, EDITS);
+        }
+        printf("per edit     %8.2f tokens re-lexed  %6.2f statements re-parsed  %6.3f blocks rebuilt\n",
+               (double)relexed / EDITS, (double)reparsed / EDITS, (double)rebuilt / EDITS);
+        printf("blocks       %8u after editing, all match a full parse\n", doc->block_count);
+    }
+    if (!status && !check_unclosed_comment(lines, parser)) status = 1;
+
+    IncrementalParser_destroy(doc);
+    ExprParser_destroy(parser);
+    free(cpu_times);
+    free(latencies);
+    free(text);
+    return status;
+}
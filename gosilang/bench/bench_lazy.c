@@ -0,0 +1,70 @@
+// Lazy benchmark: compares reads of a ready lazy against checking a
+// flag under a mutex. Running once under concurrent first use is
+// checked by tests/unit/test_lazy.c.
+#include "runtime/concurrency/lazy/lazy.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DEFAULT_READS 50000000
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static bool Constant(void* data, void** value) {
+    *value = data;
+    return true;
+}
+
+// The mutex version of a ready lazy
+static pthread_mutex_t locked_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool locked_ready;
+static void* locked_value;
+
+static void* get_locked(void) {
+    pthread_mutex_lock(&locked_lock);
+    if (!locked_ready) {
+        locked_value = (void*)(uintptr_t)42;
+        locked_ready = true;
+    }
+    void* value = locked_value;
+    pthread_mutex_unlock(&locked_lock);
+    return value;
+}
+
+int main(int argc, char** argv) {
+    long reads = argc > 1 ? atol(argv[1]) : DEFAULT_READS;
+    if (reads <= 0) reads = 1;
+    int status = 0;
+
+    static Lazy lazy = LAZY_INIT(Constant, (void*)(uintptr_t)42);
+    // volatile keeps the loop from being folded away
+    volatile uintptr_t sink = 0;
+    double start = now_seconds();
+    for (long i = 0; i < reads; i++) {
+        void* value;
+        Lazy_get(&lazy, &value);
+        sink += (uintptr_t)value;
+    }
+    double lazy_time = now_seconds() - start;
+    if (sink != (uintptr_t)reads * 42) status = 1;
+
+    sink = 0;
+    start = now_seconds();
+    for (long i = 0; i < reads; i++) {
+        sink += (uintptr_t)get_locked();
+    }
+    double locked_time = now_seconds() - start;
+    if (sink != (uintptr_t)reads * 42) status = 1;
+
+    printf("%ld reads of a ready value\n", reads);
+    printf("mutex and flag      %8.2f ms  %6.2f ns/read\n", locked_time * 1e3, locked_time * 1e9 / reads);
+    printf("Lazy_get            %8.2f ms  %6.2f ns/read  %5.2fx\n", lazy_time * 1e3, lazy_time * 1e9 / reads,
+           locked_time / lazy_time);
+    return status;
+}
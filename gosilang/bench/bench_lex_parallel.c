@@ -0,0 +1,202 @@
+// Parallel lexer benchmark: lexes an mmap'd synthetic source serially
+// and on work pools of 1 to 32 threads, both always split into chunks
+// (Lexer_fillBufferChunks) and as Lexer_fillBufferParallel decides,
+// which lexes serially unless two threads can really run at once.
+// The source has large block comments full of quotes, '//' and '/*',
+// continued strings and directives, and stray invalid bytes, so chunk
+// splits land inside comments and speculation goes wrong. Every run
+// must produce the serial token stream and error count, also with
+// interning and with comments skipped; the benchmark fails otherwise.
+#include "core/tokenizer/lexer/lex_parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_SOURCE_MB 64
+#define COMMENT_EVERY (1u << 20)    // Bytes of code between large comments
+#define COMMENT_BYTES (300u * 1024)
+#define REPEATS 3
+
+static const char* const source_lines[] = {
+    "int compute_value_%d(int alpha, int beta) {\n",
+    "    // accumulate the running total for iteration %d\n",
+    "    total_%d = alpha * 4 + beta / 2 - (gamma << 3) + 0x1F;\n",
+    "    if (total >= limit_%d && !done) { return total; }\n",
+    "    /* block comment %d spanning\n       two lines */\n",
+    "    const char* label = \"value %d\\\n continued\";\n",
+    "#define SCALE_%d(x) \\\n    ((x) * 2 + \\\n     1)\n",
+    "    ratio = 1.5e-3 * weight_%d + .25; @\n",
+    "}\n",
+};
+
+// Code-like text that the serial lexer sees inside a comment. A split
+// inside one leaves the speculative lexer in code, a string or a
+// comment of its own when the real comment ends.
+static const char* const comment_lines[] = {
+    "   it's %d \"quoted\" and 'unbalanced\n",
+    "   x = y // not a line comment %d\n",
+    "   ** %d \"string\" and /\\\n",
+    "   #define NOT_A_DIRECTIVE_%d \\\n",
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char* generate_source(size_t target, size_t* length) {
+    size_t line_count = sizeof(source_lines) / sizeof(source_lines[0]);
+    size_t comment_count = sizeof(comment_lines) / sizeof(comment_lines[0]);
+    char* data = (char*)malloc(target + COMMENT_BYTES + 1024);
+    if (!data) return NULL;
+
+    size_t used = 0;
+    size_t next_comment = COMMENT_EVERY;
+    for (int i = 0; used < target || i % (int)line_count != 0; i++) {
+        if (used >= next_comment && i % (int)line_count == 0) {
+            size_t comment_end = used + COMMENT_BYTES;
+            used += (size_t)sprintf(data + used, "/* /* not nested\n");
+            for (int j = 0; used < comment_end; j++) {
+                used += (size_t)sprintf(data + used, comment_lines[j % comment_count], j);
+            }
+            used += (size_t)sprintf(data + used, "   that's all */ int after_comment = 0;\n");
+            next_comment += COMMENT_EVERY;
+        }
+        used += (size_t)sprintf(data + used, source_lines[i % line_count], i % 997);
+    }
+    *length = used;
+    return data;
+}
+
+static bool same_tokens(const TokenBuffer* a, const TokenBuffer* b) {
+    uint32_t n = a->count;
+    return n == b->count &&
+           memcmp(a->types, b->types, n) == 0 &&
+           memcmp(a->categories, b->categories, n) == 0 &&
+           memcmp(a->offsets, b->offsets, n * sizeof(uint32_t)) == 0 &&
+           memcmp(a->lengths, b->lengths, n * sizeof(uint32_t)) == 0 &&
+           memcmp(a->lexemes, b->lexemes, n * sizeof(LexemeId)) == 0 &&
+           memcmp(a->attributes, b->attributes, n * sizeof(uint16_t)) == 0;
+}
+
+// Lexes the whole source; a NULL pool lexes serially, and split
+// forces chunks whatever the CPU count
+static double lex(SourceFile* source, WorkPool* pool, bool split, StringInterner* interner, bool skip_comments,
+                  TokenBuffer* tokens, int* errors) {
+    Lexer* lexer = Lexer_createFromSource(source);
+    Lexer_setInterner(lexer, interner);
+    lexer->skip_comments = skip_comments;
+    TokenBuffer_clear(tokens);
+
+    double start = now_seconds();
+    if (pool && split) {
+        Lexer_fillBufferChunks(lexer, tokens, pool,
+                               (size_t)WorkPool_threadCount(pool) * LEX_PARALLEL_CHUNKS_PER_THREAD);
+    } else if (pool) {
+        Lexer_fillBufferParallel(lexer, tokens, pool);
+    } else {
+        Lexer_fillBuffer(lexer, tokens);
+    }
+    double elapsed = now_seconds() - start;
+
+    *errors = lexer->error_count;
+    Lexer_destroy(lexer);
+    return elapsed;
+}
+
+// Checks one configuration against a fresh serial run
+static bool check_variant(const char* name, SourceFile* source, WorkPool* pool, bool intern,
+                          bool skip_comments) {
+    StringInterner* serial_interner = intern ? StringInterner_create() : NULL;
+    StringInterner* parallel_interner = intern ? StringInterner_create() : NULL;
+    TokenBuffer* expected = TokenBuffer_create(0);
+    TokenBuffer* actual = TokenBuffer_create(0);
+    int expected_errors, actual_errors;
+
+    lex(source, NULL, false, serial_interner, skip_comments, expected, &expected_errors);
+    lex(source, pool, true, parallel_interner, skip_comments, actual, &actual_errors);
+    bool ok = same_tokens(expected, actual) && expected_errors == actual_errors &&
+              (!intern || serial_interner->count == parallel_interner->count);
+    printf("%-22s %s (%u tokens)\n", name, ok ? "matches serial" : "DIFFERS", actual->count);
+
+    TokenBuffer_destroy(actual);
+    TokenBuffer_destroy(expected);
+    StringInterner_destroy(parallel_interner);
+    StringInterner_destroy(serial_interner);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_SOURCE_MB;
+    if (!megabytes) megabytes = 1;
+
+    size_t length;
+    char* data = generate_source(megabytes << 20, &length);
+    if (!data) return 1;
+
+    char path[] = "/tmp/gosilang_bench_lex_parallel_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, data, length) != (ssize_t)length) {
+        free(data);
+        return 1;
+    }
+    close(fd);
+    free(data);
+
+    SourceFile* source = SourceFile_open(path);
+    unlink(path);
+    TokenBuffer* expected = TokenBuffer_create(0);
+    TokenBuffer* actual = TokenBuffer_create(0);
+    if (!source || !expected || !actual) return 1;
+
+    int expected_errors, actual_errors;
+    double serial_time = 1e30;
+    for (int r = 0; r < REPEATS; r++) {
+        double elapsed = lex(source, NULL, false, NULL, false, expected, &expected_errors);
+        if (elapsed < serial_time) serial_time = elapsed;
+    }
+
+    printf("Parallel lexer benchmark (%.1f MB source, %u tokens, %d errors)\n",
+           (double)length / (1 << 20), expected->count, expected_errors);
+    printf("serial      %8.2f ms  %7.1f MB/s\n", serial_time * 1e3, (double)length / serial_time / 1e6);
+    int status = 0;
+
+    static const uint32_t thread_counts[] = { 1, 2, 4, 8, 16, 32 };
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        WorkPool* pool = WorkPool_create(thread_counts[t]);
+        if (!pool) return 1;
+
+        double split = 1e30, chosen = 1e30;
+        bool ok = true;
+        for (int r = 0; r < REPEATS; r++) {
+            double elapsed = lex(source, pool, true, NULL, false, actual, &actual_errors);
+            if (elapsed < split) split = elapsed;
+            ok = ok && same_tokens(expected, actual) && actual_errors == expected_errors;
+            elapsed = lex(source, pool, false, NULL, false, actual, &actual_errors);
+            if (elapsed < chosen) chosen = elapsed;
+            ok = ok && same_tokens(expected, actual) && actual_errors == expected_errors;
+        }
+        printf("%2u threads  split %8.2f ms  %5.2fx serial   chosen %8.2f ms  %5.2fx serial\n",
+               WorkPool_threadCount(pool), split * 1e3, serial_time / split, chosen * 1e3,
+               serial_time / chosen);
+        if (!ok) {
+            fprintf(stderr, "%u threads: tokens differ from the serial lexer\n", thread_counts[t]);
+            status = 1;
+        }
+        WorkPool_destroy(pool);
+    }
+
+    WorkPool* pool = WorkPool_create(8);
+    if (!pool) return 1;
+    if (!check_variant("interned, 8 threads", source, pool, true, false)) status = 1;
+    if (!check_variant("no comments, 8 threads", source, pool, false, true)) status = 1;
+    WorkPool_destroy(pool);
+
+    TokenBuffer_destroy(actual);
+    TokenBuffer_destroy(expected);
+    SourceFile_close(source);
+    return status;
+}
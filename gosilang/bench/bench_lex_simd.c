@@ -0,0 +1,124 @@
+// Scalar vs. vector lexer kernels on comment-heavy and identifier-heavy
+// corpora, measured both in isolation and through the whole lexer.
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/tokenizer/lexer/lex_simd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_CORPUS_MB 32
+#define KERNEL_PASSES 4
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char* generate(const char* const* lines, size_t line_count, size_t target, size_t* length) {
+    char* data = (char*)malloc(target + 512);
+    if (!data) return NULL;
+
+    size_t used = 0;
+    for (int i = 0; used < target; i++) {
+        used += (size_t)sprintf(data + used, lines[i % line_count], i % 9973);
+    }
+    *length = used;
+    return data;
+}
+
+static const char* const comment_lines[] = {
+    "/* The quick brown fox jumps over the lazy dog, entry %d of the log.\n"
+    "   Multi-line commentary keeps going for a while before it closes. */\n",
+    "        // line comment %d explaining the statement that follows it in detail\n",
+    "x = y; /* short %d */\n",
+};
+
+static const char* const identifier_lines[] = {
+    "accumulated_partial_result_%d = previous_iteration_value + scaling_coefficient;\n",
+    "        configuration_manager_instance_%d.initialize_subsystem_handlers(context);\n",
+    "    registerCallbackForEventType%d(onApplicationLifecycleTransition, userDataPointer);\n",
+};
+
+// Kernel-only pass: whitespace, identifiers and comment bodies
+static size_t run_kernels(const LexSimdKernels* k, const char* data, size_t length) {
+    const char* p = data;
+    const char* end = data + length;
+    size_t stops = 0;
+
+    while (p < end) {
+        LexNewlines lines = { 0, NULL };
+        p = k->skipWhitespace(p, end, &lines);
+        if (p >= end) break;
+
+        unsigned char c = (unsigned char)*p;
+        if (c == '_' || (unsigned char)((c | 0x20) - 'a') < 26) {
+            p = k->scanIdentifier(p + 1, end);
+        } else if (c == '/' && p + 1 < end && p[1] == '*') {
+            p = k->findCommentEnd(p + 2, end, &lines);
+            p = p + 2 < end ? p + 2 : end;
+        } else if (c == '/' && p + 1 < end && p[1] == '/') {
+            p = k->findLineEnd(p + 2, end);
+        } else {
+            p++;
+        }
+        stops++;
+    }
+    return stops;
+}
+
+static void bench_corpus(const char* name, const char* data, size_t length) {
+    printf("%s corpus (%.1f MB)\n", name, (double)length / 1e6);
+
+    LexSimdLevel levels[] = { LEX_SIMD_SCALAR, LEX_SIMD_SSE2, LEX_SIMD_AVX2 };
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        const LexSimdKernels* k = LexSimd_getKernels(levels[i]);
+        if (!k) {
+            printf("  %-7s unsupported on this CPU\n", levels[i] == LEX_SIMD_AVX2 ? "avx2" : "sse2");
+            continue;
+        }
+
+        double start = now_seconds();
+        size_t stops = 0;
+        for (int pass = 0; pass < KERNEL_PASSES; pass++) {
+            stops += run_kernels(k, data, length);
+        }
+        double kernel_time = (now_seconds() - start) / KERNEL_PASSES;
+
+        Lexer* lexer = Lexer_createFromBuffer(data, length, name);
+        Lexer_setSimdLevel(lexer, levels[i]);
+        Token token;
+        size_t tokens = 0;
+        start = now_seconds();
+        while (Lexer_next(lexer, &token)) {
+            tokens++;
+        }
+        double lexer_time = now_seconds() - start;
+        Lexer_destroy(lexer);
+
+        printf("  %-7s kernels %8.1f MB/s   lexer %8.1f MB/s  (%zu stops, %zu tokens)\n",
+               k->name, (double)length / kernel_time / 1e6, (double)length / lexer_time / 1e6,
+               stops / KERNEL_PASSES, tokens);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_CORPUS_MB;
+    size_t target = megabytes * 1024 * 1024;
+    size_t length = 0;
+
+    printf("Lexer SIMD benchmark (best available: %s)\n", LexSimd_getKernels(LEX_SIMD_BEST)->name);
+
+    char* comments = generate(comment_lines, sizeof(comment_lines) / sizeof(comment_lines[0]), target, &length);
+    if (!comments) return 1;
+    bench_corpus("comment-heavy", comments, length);
+    free(comments);
+
+    char* identifiers = generate(identifier_lines, sizeof(identifier_lines) / sizeof(identifier_lines[0]), target, &length);
+    if (!identifiers) return 1;
+    bench_corpus("identifier-heavy", identifiers, length);
+    free(identifiers);
+
+    return 0;
+}
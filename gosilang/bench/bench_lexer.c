@@ -0,0 +1,140 @@
+// Lexer throughput benchmark: MB/s and tokens/s over a synthetic source,
+// from memory, a file descriptor and an mmap'd source, with and without
+// interning. The mmap mode emits compact spans instead of full tokens.
+#include "core/tokenizer/lexer/lexer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define DEFAULT_SOURCE_MB 64
+
+static const char* const source_lines[] = {
+    "int compute_value_%d(int alpha, int beta) {\n",
+    "    // accumulate the running total for iteration %d\n",
+    "    total_%d = alpha * 4 + beta / 2 - (gamma << 3) + 0x1F;\n",
+    "    if (total >= limit_%d && !done) { return total; }\n",
+    "    /* block comment %d spanning\n       two lines */\n",
+    "    const char* label = \"value %d\\n\";\n",
+    "    ratio = 1.5e-3 * weight_%d + .25;\n",
+    "}\n",
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char* generate_source(size_t target, size_t* length) {
+    char* data = (char*)malloc(target + 256);
+    if (!data) return NULL;
+
+    size_t used = 0;
+    size_t line_count = sizeof(source_lines) / sizeof(source_lines[0]);
+    for (int i = 0; used < target; i++) {
+        used += (size_t)sprintf(data + used, source_lines[i % line_count], i % 997);
+    }
+    *length = used;
+    return data;
+}
+
+static void report(const char* name, size_t bytes, size_t tokens, double elapsed) {
+    printf("%-22s %8.1f MB/s  %8.2f M tokens/s  (%zu tokens)\n",
+           name, (double)bytes / elapsed / 1e6, (double)tokens / elapsed / 1e6, tokens);
+}
+
+static void bench_buffer(const char* name, const char* data, size_t length, bool intern) {
+    StringInterner* interner = intern ? StringInterner_create() : NULL;
+    Lexer* lexer = Lexer_createFromBuffer(data, length, "bench");
+    Lexer_setInterner(lexer, interner);
+
+    double start = now_seconds();
+    Token token;
+    size_t count = 0;
+    while (Lexer_next(lexer, &token)) {
+        count++;
+    }
+    report(name, length, count, now_seconds() - start);
+
+    Lexer_destroy(lexer);
+    StringInterner_destroy(interner);
+}
+
+static void bench_fd(const char* name, const char* path, size_t length) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+
+    TokenRing* ring = TokenRing_create(1024);
+    StringInterner* interner = StringInterner_create();
+    Lexer* lexer = Lexer_createFromFd(fd, 0, "bench");
+    Lexer_setInterner(lexer, interner);
+
+    double start = now_seconds();
+    size_t count = 0;
+    while (Lexer_fill(lexer, ring) || TokenRing_count(ring)) {
+        while (TokenRing_pop(ring, NULL)) {
+            count++;
+        }
+    }
+    report(name, length, count, now_seconds() - start);
+
+    Lexer_destroy(lexer);
+    StringInterner_destroy(interner);
+    TokenRing_destroy(ring);
+    close(fd);
+}
+
+// Zero-copy: spans over the mapping, resolving one position at the end
+static void bench_mmap(const char* name, const char* path) {
+    SourceFile* source = SourceFile_open(path);
+    if (!source) return;
+
+    StringInterner* interner = StringInterner_create();
+    Lexer* lexer = Lexer_createFromSource(source);
+    Lexer_setInterner(lexer, interner);
+
+    double start = now_seconds();
+    TokenSpan span = { 0, 0, 0, 0 };
+    size_t count = 0;
+    while (Lexer_nextSpan(lexer, &span)) {
+        count++;
+    }
+    report(name, source->size, count, now_seconds() - start);
+
+    int line = 0, column = 0;
+    SourceFile_locate(source, span.offset, &line, &column);
+    printf("%-22s EOF at %d:%d, index built on demand\n", "", line, column);
+
+    Lexer_destroy(lexer);
+    StringInterner_destroy(interner);
+    SourceFile_close(source);
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_SOURCE_MB;
+    size_t length = 0;
+    char* data = generate_source(megabytes * 1024 * 1024, &length);
+    if (!data) return 1;
+
+    char path[] = "/tmp/gosilang_bench_lexer_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, data, length) != (ssize_t)length) {
+        free(data);
+        return 1;
+    }
+    close(fd);
+
+    printf("Lexer benchmark (%.1f MB source)\n", (double)length / 1e6);
+    bench_buffer("buffer", data, length, false);
+    bench_buffer("buffer+intern", data, length, true);
+    bench_fd("fd+ring+intern", path, length);
+    bench_mmap("mmap+span+intern", path);
+    printf("sizeof(Token) = %zu, sizeof(TokenSpan) = %zu\n", sizeof(Token), sizeof(TokenSpan));
+
+    unlink(path);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,305 @@
+// DFA minimizer benchmark: Hopcroft's algorithm against the iterative
+// signature splitting it replaces, on random automata with known
+// redundancy, on chains (the quadratic worst case for signature
+// splitting) and on lexer DFAs built from the reserved lexemes plus
+// generated keywords, with and without byte class compression. Every
+// result is checked; the run fails on a mismatch.
+#include "core/minimizer/minimizer.h"
+#include "core/tokenizer/symbols/sym_intern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define RANDOM_SYMBOLS 16
+#define LEXER_SYMBOLS 128
+#define SPLITTING_STATE_LIMIT 20000     // Beyond this the baseline takes minutes
+#define SPLITTING_CHAIN_LIMIT 1000      // Chains take n rounds; 10000 states takes seconds
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+// Baseline: refine by (class, successor classes) signatures until stable.
+// Each round is a sort, and a chain of n states needs n rounds.
+static uint32_t signature_classes;
+static const uint32_t* signature_rows;
+
+static int CompareSignatures(const void* a, const void* b) {
+    const uint32_t* x = &signature_rows[*(const uint32_t*)a * signature_classes];
+    const uint32_t* y = &signature_rows[*(const uint32_t*)b * signature_classes];
+    return memcmp(x, y, signature_classes * sizeof(uint32_t));
+}
+
+static uint32_t minimize_by_splitting(const Dfa* dfa) {
+    uint32_t n = dfa->state_count + 1;      // Plus a sink for missing transitions
+    uint32_t k = dfa->symbol_count;
+    uint32_t width = k + 1;
+    uint32_t* classes = (uint32_t*)calloc(n, sizeof(uint32_t));
+    uint32_t* rows = (uint32_t*)malloc((size_t)n * width * sizeof(uint32_t));
+    uint32_t* order = (uint32_t*)malloc(n * sizeof(uint32_t));
+    if (!classes || !rows || !order) exit(1);
+
+    for (uint32_t s = 0; s + 1 < n; s++) classes[s] = dfa->accepts[s] + 1;
+    uint32_t count = 0;
+    for (;;) {
+        for (uint32_t s = 0; s < n; s++) {
+            uint32_t* row = &rows[(size_t)s * width];
+            row[0] = classes[s];
+            for (uint32_t a = 0; a < k; a++) {
+                uint32_t to = s + 1 < n ? Dfa_next(dfa, s, a) : DFA_NO_STATE;
+                row[a + 1] = classes[to == DFA_NO_STATE ? n - 1 : to];
+            }
+            order[s] = s;
+        }
+        signature_rows = rows;
+        signature_classes = width;
+        qsort(order, n, sizeof(uint32_t), CompareSignatures);
+
+        uint32_t next_count = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            if (i && CompareSignatures(&order[i - 1], &order[i]) != 0) next_count++;
+            classes[order[i]] = next_count;
+        }
+        if (++next_count == count) break;
+        count = next_count;
+    }
+    free(order);
+    free(rows);
+    free(classes);
+    // The input is fully reachable and has no dead states except the sink
+    return count - 1;
+}
+
+// A random complete automaton copied several times, each transition
+// going to a random copy of its target: equivalent to the original
+static Dfa* random_redundant_dfa(uint32_t states, uint32_t copies, Dfa** base_out) {
+    Dfa* base = Dfa_create(states, RANDOM_SYMBOLS);
+    Dfa* dfa = Dfa_create(states * copies, RANDOM_SYMBOLS);
+    if (!base || !dfa) exit(1);
+
+    for (uint32_t s = 0; s < states; s++) {
+        base->accepts[s] = next_random() % 8 == 0 ? 1 + next_random() % 3 : 0;
+        for (uint32_t a = 0; a < RANDOM_SYMBOLS; a++) {
+            Dfa_setTransition(base, s, a, next_random() % states);
+        }
+    }
+    for (uint32_t c = 0; c < copies; c++) {
+        for (uint32_t s = 0; s < states; s++) {
+            uint32_t copy = c * states + s;
+            dfa->accepts[copy] = base->accepts[s];
+            for (uint32_t a = 0; a < RANDOM_SYMBOLS; a++) {
+                Dfa_setTransition(dfa, copy, a, (next_random() % copies) * states + Dfa_next(base, s, a));
+            }
+        }
+    }
+    *base_out = base;
+    return dfa;
+}
+
+// 0 -> 1 -> ... -> n-1 on symbol 0, only the last state accepting
+static Dfa* chain_dfa(uint32_t states) {
+    Dfa* dfa = Dfa_create(states, 2);
+    if (!dfa) exit(1);
+    for (uint32_t s = 0; s + 1 < states; s++) {
+        Dfa_setTransition(dfa, s, 0, s + 1);
+        Dfa_setTransition(dfa, s, 1, 0);
+    }
+    dfa->accepts[states - 1] = 1;
+    return dfa;
+}
+
+// Trie over ASCII for every reserved lexeme and `extra` generated
+// keywords. Word characters fall through to the identifier state, as a
+// keyword prefix is still an identifier. States accept a token class,
+// not the individual word, so suffixes shared between words merge.
+enum { ACCEPT_IDENTIFIER = 1, ACCEPT_KEYWORD, ACCEPT_OPERATOR, ACCEPT_NUMBER };
+
+static int is_word_char(int c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static Dfa* lexer_dfa(uint32_t extra) {
+    // Upper bound on states: start, identifier, number, plus one per character
+    uint32_t capacity = 3 + extra * 12;
+    for (LexemeId id = 1; id < LEXEME_RESERVED_COUNT; id++) {
+        uint32_t length = 0;
+        if (Lexeme_getReserved(id, &length)) capacity += length;
+    }
+    Dfa* trie = Dfa_create(capacity, LEXER_SYMBOLS);
+    if (!trie) exit(1);
+
+    const uint32_t identifier = 1, number = 2;
+    uint32_t count = 3;
+    trie->accepts[identifier] = ACCEPT_IDENTIFIER;
+    trie->accepts[number] = ACCEPT_NUMBER;
+    for (int c = 0; c < LEXER_SYMBOLS; c++) {
+        if (is_word_char(c)) Dfa_setTransition(trie, identifier, c, identifier);
+        if (c >= '0' && c <= '9') {
+            Dfa_setTransition(trie, number, c, number);
+            Dfa_setTransition(trie, 0, c, number);
+        }
+    }
+
+    char word[16];
+    for (uint32_t w = 0; w + 1 < extra + LEXEME_RESERVED_COUNT; w++) {
+        const char* text = word;
+        uint32_t length = 0;
+        if (w + 1 < LEXEME_RESERVED_COUNT) {
+            text = Lexeme_getReserved(w + 1, &length);
+            if (!text) continue;
+        } else {
+            length = 3 + next_random() % 10;
+            for (uint32_t i = 0; i < length; i++) word[i] = (char)('a' + next_random() % 26);
+        }
+
+        bool keyword = is_word_char((unsigned char)text[0]);
+        uint32_t state = 0;
+        for (uint32_t i = 0; i < length; i++) {
+            uint32_t c = (unsigned char)text[i];
+            uint32_t to = Dfa_next(trie, state, c);
+            if (to == DFA_NO_STATE || to == identifier) {
+                to = count++;
+                Dfa_setTransition(trie, state, c, to);
+                if (keyword) {
+                    trie->accepts[to] = ACCEPT_IDENTIFIER;
+                    for (int d = 0; d < LEXER_SYMBOLS; d++) {
+                        if (is_word_char(d)) Dfa_setTransition(trie, to, d, identifier);
+                    }
+                }
+            }
+            state = to;
+        }
+        trie->accepts[state] = keyword ? ACCEPT_KEYWORD : ACCEPT_OPERATOR;
+    }
+    for (int c = 0; c < LEXER_SYMBOLS; c++) {
+        if (is_word_char(c) && !(c >= '0' && c <= '9') && Dfa_next(trie, 0, c) == DFA_NO_STATE) {
+            Dfa_setTransition(trie, 0, c, identifier);
+        }
+    }
+    trie->state_count = count;
+    return trie;
+}
+
+// Minimized tables are canonical, so equal languages give equal bytes
+static bool same_dfa(const Dfa* a, const Dfa* b) {
+    return a->state_count == b->state_count && a->symbol_count == b->symbol_count &&
+           memcmp(a->accepts, b->accepts, a->state_count * sizeof(uint32_t)) == 0 &&
+           memcmp(a->transitions, b->transitions,
+                  (size_t)a->state_count * a->symbol_count * sizeof(uint32_t)) == 0;
+}
+
+static int report(const char* name, const Dfa* dfa, const Dfa* expected, uint32_t baseline_limit) {
+    double start = now_seconds();
+    Dfa* minimized = Dfa_minimize(dfa, NULL, NULL);
+    double hopcroft = now_seconds() - start;
+    if (!minimized) return 1;
+
+    int status = 0;
+    if (expected && !same_dfa(minimized, expected)) {
+        fprintf(stderr, "%s: minimized automaton differs from the expected one\n", name);
+        status = 1;
+    }
+
+    printf("%-22s %8u -> %7u states  hopcroft %9.2f ms", name, dfa->state_count,
+           minimized->state_count, hopcroft * 1e3);
+    if (dfa->state_count <= baseline_limit) {
+        start = now_seconds();
+        uint32_t classes = minimize_by_splitting(dfa);
+        double splitting = now_seconds() - start;
+        printf("  splitting %9.2f ms", splitting * 1e3);
+        if (classes != minimized->state_count) {
+            fprintf(stderr, "\n%s: splitting found %u states\n", name, classes);
+            status = 1;
+        }
+    }
+    printf("\n");
+    Dfa_destroy(minimized);
+    return status;
+}
+
+// Tokenizes sample text by longest match with the byte automaton, its
+// compressed form and the minimized compressed form; all must agree
+static const char sample_text[] =
+    "int compute_value_7(int alpha, int beta) { total += alpha << 3; "
+    "if (total >= limit && !done) return sizeof total % 0x1F; }";
+
+static int check_matches(const char* name, const Dfa* lexer, const ByteClasses* classes,
+                         const Dfa* compressed, const Dfa* minimized) {
+    size_t length = sizeof(sample_text) - 1;
+    for (size_t at = 0; at < length; ) {
+        uint32_t accepts[3];
+        size_t raw = Dfa_longestMatch(lexer, NULL, sample_text + at, length - at, &accepts[0]);
+        size_t small = Dfa_longestMatch(compressed, classes, sample_text + at, length - at, &accepts[1]);
+        size_t minimal = Dfa_longestMatch(minimized, classes, sample_text + at, length - at, &accepts[2]);
+        if (raw != small || raw != minimal || accepts[0] != accepts[1] || accepts[0] != accepts[2]) {
+            fprintf(stderr, "%s: match at offset %zu differs (%zu, %zu, %zu)\n", name, at, raw, small, minimal);
+            return 1;
+        }
+        at += raw ? raw : 1;
+    }
+    return 0;
+}
+
+static int report_compressed(const char* name, const Dfa* lexer) {
+    ByteClasses classes;
+    double start = now_seconds();
+    if (!ByteClasses_fromDfa(&classes, lexer)) return 1;
+    Dfa* compressed = Dfa_compress(lexer, &classes);
+    double elapsed = now_seconds() - start;
+    if (!compressed) return 1;
+
+    printf("  %u byte classes in %.2f ms, table %zu KB -> %zu KB\n", classes.count, elapsed * 1e3,
+           (size_t)lexer->state_count * lexer->symbol_count * sizeof(uint32_t) / 1024,
+           (size_t)compressed->state_count * compressed->symbol_count * sizeof(uint32_t) / 1024);
+
+    int status = report("  compressed", compressed, NULL, SPLITTING_STATE_LIMIT);
+    Dfa* minimized = Dfa_minimize(compressed, NULL, NULL);
+    status |= !minimized || check_matches(name, lexer, &classes, compressed, minimized);
+    Dfa_destroy(minimized);
+    Dfa_destroy(compressed);
+    return status;
+}
+
+int main(int argc, char** argv) {
+    uint32_t largest = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 100000;
+    int status = 0;
+    char name[48];
+
+    printf("DFA minimizer benchmark\n");
+    for (uint32_t states = 1000; states <= largest && status == 0; states *= 10) {
+        Dfa* base = NULL;
+        Dfa* redundant = random_redundant_dfa(states / 4, 4, &base);
+        Dfa* expected = Dfa_minimize(base, NULL, NULL);
+        snprintf(name, sizeof(name), "random x4 (%u)", states);
+        status |= report(name, redundant, expected, SPLITTING_STATE_LIMIT);
+        Dfa_destroy(expected);
+        Dfa_destroy(redundant);
+        Dfa_destroy(base);
+
+        Dfa* chain = chain_dfa(states);
+        snprintf(name, sizeof(name), "chain (%u)", states);
+        status |= report(name, chain, NULL, SPLITTING_CHAIN_LIMIT);
+        Dfa_destroy(chain);
+    }
+
+    for (uint32_t words = 100; words <= largest / 10 && status == 0; words *= 10) {
+        Dfa* lexer = lexer_dfa(words);
+        snprintf(name, sizeof(name), "lexer +%u words", words);
+        status |= report(name, lexer, NULL, SPLITTING_STATE_LIMIT);
+        status |= report_compressed(name, lexer);
+        Dfa_destroy(lexer);
+    }
+    return status;
+}
@@ -0,0 +1,115 @@
+// Profiler benchmark: times a small function with and without a scoped
+// timer while profiling is off, which should cost next to nothing, and
+// while it is on, then samples a busy loop and times collapsing the
+// stacks. What the profiler records is checked by
+// tests/unit/test_profiler.c.
+#include "runtime/debug/profiler/profiler.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DEFAULT_CALLS 20000000
+#define SAMPLE_THREADS 2
+#define SAMPLE_SECONDS 0.5
+#define SAMPLE_HZ 1000
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static double cpu_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+__attribute__((noinline)) static uint64_t plain_step(uint64_t x) {
+    return x * 6364136223846793005ull + 1442695040888963407ull;
+}
+
+__attribute__((noinline)) static uint64_t scoped_step(uint64_t x) {
+    PROFILE_SCOPE(PROFILE_TIMER_PARSE);
+    return x * 6364136223846793005ull + 1442695040888963407ull;
+}
+
+static double time_calls(uint64_t (*step)(uint64_t), long calls, uint64_t* sink) {
+    uint64_t x = *sink;
+    double start = now_seconds();
+    for (long i = 0; i < calls; i++) x = step(x);
+    *sink = x;
+    return now_seconds() - start;
+}
+
+// Burns CPU where samples can find it by name
+__attribute__((noinline)) uint64_t bench_hot_loop(double seconds) {
+    uint64_t x = 1;
+    double end = cpu_seconds() + seconds;
+    while (cpu_seconds() < end) {
+        for (int i = 0; i < 10000; i++) x = plain_step(x);
+    }
+    return x;
+}
+
+static void* BurnThread(void* argument) {
+    *(uint64_t*)argument = bench_hot_loop(SAMPLE_SECONDS / 2);
+    return NULL;
+}
+
+static bool time_sampling(void) {
+    if (!Profiler_startSampling(SAMPLE_HZ, 0)) {
+        fprintf(stderr, "cannot start sampling\n");
+        return false;
+    }
+    uint64_t results[SAMPLE_THREADS] = {0};
+    pthread_t threads[SAMPLE_THREADS];
+    uint32_t started = 0;
+    for (uint32_t t = 0; t < SAMPLE_THREADS; t++) {
+        if (pthread_create(&threads[t], NULL, BurnThread, &results[t]) == 0) started++;
+    }
+    uint64_t sink = bench_hot_loop(SAMPLE_SECONDS);
+    for (uint32_t t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+        sink += results[t];
+    }
+    Profiler_stopSampling();
+
+    FILE* stream = tmpfile();
+    if (!stream) return false;
+    double start = now_seconds();
+    uint64_t written = Profiler_writeCollapsed(stream);
+    double collapse_time = now_seconds() - start;
+    fclose(stream);
+
+    printf("%llu samples (%llu dropped), %llu collapsed in %.2f ms\n", (unsigned long long)Profiler_samples(),
+           (unsigned long long)Profiler_dropped(), (unsigned long long)written, collapse_time * 1e3);
+    return sink != 0;
+}
+
+int main(int argc, char** argv) {
+    long calls = argc > 1 ? atol(argv[1]) : DEFAULT_CALLS;
+    if (calls <= 0) calls = 1;
+    int status = 0;
+
+    uint64_t sink = 1;
+    time_calls(plain_step, calls / 10, &sink);
+    double plain = time_calls(plain_step, calls, &sink);
+    double off = time_calls(scoped_step, calls, &sink);
+
+    Profiler_setTiming(true);
+    double on = time_calls(scoped_step, calls, &sink);
+    Profiler_setTiming(false);
+
+    printf("%ld calls (%llx)\n", calls, (unsigned long long)sink);
+    printf("no timer            %8.2f ms  %6.2f ns/call\n", plain * 1e3, plain * 1e9 / calls);
+    printf("scoped timer, off   %8.2f ms  %6.2f ns/call  %+5.2f ns\n", off * 1e3, off * 1e9 / calls,
+           (off - plain) * 1e9 / calls);
+    printf("scoped timer, on    %8.2f ms  %6.2f ns/call  %+5.2f ns\n", on * 1e3, on * 1e9 / calls,
+           (on - plain) * 1e9 / calls);
+
+    if (!time_sampling()) status = 1;
+    Profiler_shutdown();
+    return status;
+}
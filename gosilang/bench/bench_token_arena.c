@@ -0,0 +1,127 @@
+// Token allocation benchmark: per-token malloc/strdup vs. TokenArena.
+// Each mode runs in a forked child so peak RSS is measured in isolation.
+#include "core/tokenizer/symbols/sym_type.h"
+#include "core/tokenizer/symbols/sym_arena.h"
+#include "core/tokenizer/symbols/sym_intern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define DEFAULT_TOKEN_COUNT 4000000
+#define DISTINCT_LEXEMES 1024
+
+static char lexemes[DISTINCT_LEXEMES][16];
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static TokenType type_for(size_t i) {
+    return (i & 1) ? TOKEN_EXPR_BINARY : TOKEN_LITERAL_IDENTIFIER;
+}
+
+static double run_heap(size_t count) {
+    Token** tokens = (Token**)malloc(count * sizeof(Token*));
+    if (!tokens) return -1.0;
+
+    double start = now_seconds();
+    for (size_t i = 0; i < count; i++) {
+        tokens[i] = Token_create(type_for(i), lexemes[i % DISTINCT_LEXEMES]);
+    }
+    for (size_t i = 0; i < count; i++) {
+        Token_destroy(tokens[i]);
+    }
+    double elapsed = now_seconds() - start;
+
+    free(tokens);
+    return elapsed;
+}
+
+static double run_arena(size_t count) {
+    Token** tokens = (Token**)malloc(count * sizeof(Token*));
+    TokenArena* arena = TokenArena_create(0);
+    if (!tokens || !arena) return -1.0;
+
+    double start = now_seconds();
+    for (size_t i = 0; i < count; i++) {
+        tokens[i] = Token_createInArena(arena, type_for(i), lexemes[i % DISTINCT_LEXEMES]);
+    }
+    TokenArena_reset(arena);
+    double elapsed = now_seconds() - start;
+
+    TokenArena_destroy(arena);
+    free(tokens);
+    return elapsed;
+}
+
+static double run_interned(size_t count) {
+    Token** tokens = (Token**)malloc(count * sizeof(Token*));
+    StringInterner* interner = StringInterner_create();
+    if (!tokens || !interner) return -1.0;
+
+    double start = now_seconds();
+    for (size_t i = 0; i < count; i++) {
+        const char* lexeme = lexemes[i % DISTINCT_LEXEMES];
+        tokens[i] = Token_createInterned(interner, type_for(i), lexeme, strlen(lexeme));
+    }
+    for (size_t i = 0; i < count; i++) {
+        Token_destroy(tokens[i]);
+    }
+    double elapsed = now_seconds() - start;
+
+    StringInterner_destroy(interner);
+    free(tokens);
+    return elapsed;
+}
+
+// Runs one mode in a child process and reports its time and peak RSS
+static void measure(const char* name, double (*run)(size_t), size_t count) {
+    int fds[2];
+    if (pipe(fds) != 0) return;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        double elapsed = run(count);
+        if (write(fds[1], &elapsed, sizeof(elapsed)) != sizeof(elapsed)) _exit(1);
+        _exit(0);
+    }
+    close(fds[1]);
+
+    double elapsed = -1.0;
+    if (read(fds[0], &elapsed, sizeof(elapsed)) != sizeof(elapsed)) elapsed = -1.0;
+    close(fds[0]);
+
+    int status = 0;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+
+    if (elapsed < 0) {
+        printf("%-6s failed\n", name);
+        return;
+    }
+    // The heap path pays one malloc for the token and one for its value
+    double allocations = (double)count * 2.0;
+    printf("%-6s %10zu tokens  %8.3f s  %8.2f M allocs/s  peak RSS %8ld KiB\n",
+           name, count, elapsed, allocations / elapsed / 1e6, usage.ru_maxrss);
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_TOKEN_COUNT;
+
+    for (int i = 0; i < DISTINCT_LEXEMES; i++) {
+        snprintf(lexemes[i], sizeof(lexemes[i]), "ident_%d", i);
+    }
+
+    printf("Token allocation benchmark\n");
+    measure("heap", run_heap, count);
+    measure("arena", run_arena, count);
+    measure("intern", run_interned, count);
+    return 0;
+}
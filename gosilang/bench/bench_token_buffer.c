@@ -0,0 +1,183 @@
+// Token stream traversal benchmark: a doubly linked Token list (heap and
+// arena allocated) vs. the struct-of-arrays TokenBuffer. Each pass does
+// what a parser's inner loop does: classify every token, look one token
+// ahead and sum lexeme lengths. All layouts must agree on the result.
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/tokenizer/symbols/sym_arena.h"
+#include "core/tokenizer/symbols/sym_buffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_TOKEN_MILLIONS 10
+#define TRAVERSAL_PASSES 5
+
+static const char* const source_lines[] = {
+    "int compute_value_%d(int alpha, int beta) {\n",
+    "    total_%d = alpha * 4 + beta / 2 - (gamma << 3) + 0x1F;\n",
+    "    if (total >= limit_%d && !done) { return call(total); }\n",
+    "    const char* label = \"value %d\\n\";\n",
+    "    ratio = 1.5e-3 * weight_%d + .25;\n",
+    "}\n",
+};
+
+typedef struct TraversalResult {
+    uint64_t categories[TOKEN_CATEGORY_SPECIAL + 1];
+    uint64_t calls;         // Identifier followed by '('
+    uint64_t bytes;
+} TraversalResult;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Generates source until it lexes to at least the requested token count
+static char* generate_source(size_t tokens, size_t* length) {
+    size_t target = tokens * 6;
+    char* data = (char*)malloc(target + 256);
+    if (!data) return NULL;
+
+    size_t used = 0;
+    size_t line_count = sizeof(source_lines) / sizeof(source_lines[0]);
+    for (int i = 0; used < target; i++) {
+        used += (size_t)sprintf(data + used, source_lines[i % line_count], i % 997);
+    }
+    *length = used;
+    return data;
+}
+
+static Token* build_list(const char* data, size_t length, size_t limit, TokenArena* arena) {
+    Lexer* lexer = Lexer_createFromBuffer(data, length, "bench");
+    Token token;
+    Token* head = NULL;
+    Token* tail = NULL;
+    size_t count = 0;
+    while (count < limit && Lexer_next(lexer, &token) && token.type != TOKEN_EOF) {
+        Token* copy = arena ? Token_copyInArena(arena, &token) : Token_copy(&token);
+        if (!copy) break;
+        copy->prev = tail;
+        if (tail) tail->next = copy; else head = copy;
+        tail = copy;
+        count++;
+    }
+    Lexer_destroy(lexer);
+    return head;
+}
+
+static void destroy_list(Token* head) {
+    while (head) {
+        Token* next = head->next;
+        Token_destroy(head);
+        head = next;
+    }
+}
+
+static void traverse_list(const Token* head, TraversalResult* result) {
+    memset(result, 0, sizeof(*result));
+    for (const Token* token = head; token; token = token->next) {
+        result->categories[token->category]++;
+        result->bytes += token->length;
+        if (token->type == TOKEN_LITERAL_IDENTIFIER && token->next &&
+            token->next->type == TOKEN_PAREN_OPEN) {
+            result->calls++;
+        }
+    }
+}
+
+static void traverse_buffer(const TokenBuffer* buffer, TraversalResult* result) {
+    memset(result, 0, sizeof(*result));
+    for (uint32_t i = 0; i < buffer->count; i++) {
+        result->categories[buffer->categories[i]]++;
+        result->bytes += buffer->lengths[i];
+        if (buffer->types[i] == TOKEN_LITERAL_IDENTIFIER &&
+            TokenBuffer_type(buffer, i + 1) == TOKEN_PAREN_OPEN) {
+            result->calls++;
+        }
+    }
+}
+
+static void traverse_context(TokenContext* context, TraversalResult* result) {
+    memset(result, 0, sizeof(*result));
+    const TokenBuffer* buffer = context->tokens;
+    context->position = 0;
+    do {
+        uint32_t i = context->position;
+        result->categories[buffer->categories[i]]++;
+        result->bytes += buffer->lengths[i];
+        if (TokenContext_peek(context, 0) == TOKEN_LITERAL_IDENTIFIER &&
+            TokenContext_peek(context, 1) == TOKEN_PAREN_OPEN) {
+            result->calls++;
+        }
+    } while (TokenContext_advance(context));
+}
+
+static void report(const char* name, size_t count, double best, size_t bytes_per_token) {
+    printf("%-16s %7.2f ms/pass  %6.2f ns/token  %3zu bytes/token\n",
+           name, best * 1e3, best * 1e9 / (double)count, bytes_per_token);
+}
+
+int main(int argc, char** argv) {
+    size_t millions = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_TOKEN_MILLIONS;
+    size_t target = (millions ? millions : 1) * 1000000;
+    size_t length = 0;
+    char* data = generate_source(target, &length);
+    if (!data) return 1;
+
+    // The buffer is lexed directly; the lists are built token by token
+    TokenBuffer* buffer = TokenBuffer_create(0);
+    Lexer* lexer = Lexer_createFromBuffer(data, length, "bench");
+    Lexer_fillBuffer(lexer, buffer);
+    Lexer_destroy(lexer);
+    if (buffer->count && buffer->types[buffer->count - 1] == TOKEN_EOF) buffer->count--;
+    if (buffer->count > target) buffer->count = (uint32_t)target;
+    size_t count = buffer->count;
+
+    TokenArena* arena = TokenArena_create(0);
+    Token* heap_list = build_list(data, length, count, NULL);
+    Token* arena_list = build_list(data, length, count, arena);
+    TokenContext* context = TokenContext_create(buffer);
+
+    printf("Token traversal benchmark (%zu tokens, best of %d passes)\n", count, TRAVERSAL_PASSES);
+
+    TraversalResult expected, result;
+    traverse_buffer(buffer, &expected);
+
+    const char* names[] = { "list (heap)", "list (arena)", "buffer (index)", "buffer (context)" };
+    size_t sizes[] = {
+        sizeof(Token), sizeof(Token),
+        2 * sizeof(uint8_t) + 3 * sizeof(uint32_t) + sizeof(uint16_t),
+        2 * sizeof(uint8_t) + 3 * sizeof(uint32_t) + sizeof(uint16_t)
+    };
+    int status = 0;
+    for (int mode = 0; mode < 4; mode++) {
+        double best = 1e30;
+        for (int pass = 0; pass < TRAVERSAL_PASSES; pass++) {
+            double start = now_seconds();
+            switch (mode) {
+                case 0: traverse_list(heap_list, &result); break;
+                case 1: traverse_list(arena_list, &result); break;
+                case 2: traverse_buffer(buffer, &result); break;
+                default: traverse_context(context, &result); break;
+            }
+            double elapsed = now_seconds() - start;
+            if (elapsed < best) best = elapsed;
+        }
+        report(names[mode], count, best, sizes[mode]);
+        if (memcmp(&result, &expected, sizeof(result)) != 0) {
+            fprintf(stderr, "%s: traversal result mismatch\n", names[mode]);
+            status = 1;
+        }
+    }
+    printf("identifier calls: %llu, lexeme bytes: %llu\n",
+           (unsigned long long)expected.calls, (unsigned long long)expected.bytes);
+
+    TokenContext_destroy(context);
+    destroy_list(heap_list);
+    TokenArena_destroy(arena);
+    TokenBuffer_destroy(buffer);
+    free(data);
+    return status;
+}
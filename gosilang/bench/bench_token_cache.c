@@ -0,0 +1,257 @@
+// Token cache benchmark: lexes a synthetic source and collects its
+// symbol tables (functions, structs, enums and globals), writes them to
+// a cache directory, then times a hit (key hash, mapping and the checks
+// on open) against lexing and collecting again. What an entry holds and
+// which entries are refused is tested in tests/unit/test_token_cache.c.
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/tokenizer/symbols/sym_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_SOURCE_MB 16
+#define REPEATS 5
+#define OPTIONS (TOKEN_CACHE_SKIP_COMMENTS | TOKEN_CACHE_INTERNED)
+
+static const char* const source_lines[] = {
+    "int compute_%d(int alpha, int beta, float scale);\n",
+    "struct node_%d { int weight; float ratio; int next; };\n",
+    "// running total %d\n",
+    "enum color_%d { RED_%d, GREEN_%d, BLUE_%d };\n",
+    "total_%d = alpha * 4 + beta / 2 - (gamma << 3) + 0x1F;\n",
+    "/* block %d */ ratio = 1.5e-3 * weight + .25;\n",
+    "flag_%d = (count > limit) ? first_%d : second;\n",
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char* generate_source(size_t target, size_t* length) {
+    size_t line_count = sizeof(source_lines) / sizeof(source_lines[0]);
+    char* data = (char*)malloc(target + 256);
+    if (!data) return NULL;
+
+    size_t used = 0;
+    for (size_t i = 0; used < target; i++) {
+        int n = (int)(i % 4999);
+        used += (size_t)sprintf(data + used, source_lines[i % line_count], n, n, n, n);
+    }
+    *length = used;
+    return data;
+}
+
+// What symbol collection produces for one source
+typedef struct Collected {
+    StringInterner* interner;
+    TokenBuffer* tokens;
+    ScopeLevel** scopes;            // Global scope first, then one per function
+    FunctionSignature** functions;
+    StructDefinition** structs;
+    EnumDefinition** enums;
+    SymbolTables tables;
+} Collected;
+
+static bool is_type(const TokenBuffer* tokens, uint32_t i) {
+    TokenType type = TokenBuffer_type(tokens, i);
+    return type >= TOKEN_TYPE_VOID && type <= TOKEN_TYPE_DOUBLE;
+}
+
+static bool declare(ScopeLevel* scope, const char* name, TokenType type, int64_t value) {
+    if (FindLocalSymbol(scope, name)) return true;
+
+    SymbolTableEntry* symbol = CreateSymbol(name, type);
+    if (!symbol) return false;
+    symbol->value.type = VAL_INTEGER;
+    symbol->value.data.int_val = value;
+    if (!AddSymbol(scope, symbol)) {
+        DestroySymbol(symbol);
+        return false;
+    }
+    return true;
+}
+
+// A declaration-level pass over the token stream, standing in for the
+// analyzer's symbol collection. Later declarations of a name are skipped.
+static bool collect_symbols(Collected* c) {
+    const TokenBuffer* tokens = c->tokens;
+    uint32_t n = tokens->count;
+    SymbolTables* t = &c->tables;
+    c->scopes = (ScopeLevel**)calloc(n + 1, sizeof(ScopeLevel*));
+    c->functions = (FunctionSignature**)calloc(n + 1, sizeof(FunctionSignature*));
+    c->structs = (StructDefinition**)calloc(n + 1, sizeof(StructDefinition*));
+    c->enums = (EnumDefinition**)calloc(n + 1, sizeof(EnumDefinition*));
+    if (!c->scopes || !c->functions || !c->structs || !c->enums) return false;
+
+    ScopeLevel* global = CreateScope(NULL);
+    if (!global) return false;
+    c->scopes[t->scope_count++] = global;
+
+    for (uint32_t i = 0; i < n; i++) {
+        TokenType type = TokenBuffer_type(tokens, i);
+        const char* name = TokenBuffer_value(tokens, i + 1);
+        bool declares = TokenBuffer_type(tokens, i + 1) == TOKEN_LITERAL_IDENTIFIER &&
+                        !FindLocalSymbol(global, name);
+
+        if ((type == TOKEN_TYPE_STRUCT || type == TOKEN_TYPE_ENUM) && declares &&
+            TokenBuffer_type(tokens, i + 2) == TOKEN_BLOCK_BEGIN) {
+            StructDefinition* def = type == TOKEN_TYPE_STRUCT ? CreateStruct(name, false) : NULL;
+            EnumDefinition* values = type == TOKEN_TYPE_ENUM ? CreateEnum(name) : NULL;
+            if (!def && !values) return false;
+            if (def) c->structs[t->struct_count++] = def;
+            else c->enums[t->enum_count++] = values;
+            if (!declare(global, name, type, 0)) return false;
+
+            for (i += 3; i < n && TokenBuffer_type(tokens, i) != TOKEN_BLOCK_END; i++) {
+                if (TokenBuffer_type(tokens, i) != TOKEN_LITERAL_IDENTIFIER) continue;
+                const char* field = TokenBuffer_value(tokens, i);
+                if (def) {
+                    StructMember* member = AddStructMember(def, field, TokenBuffer_type(tokens, i - 1));
+                    if (!member) return false;
+                    member->offset = def->total_size;
+                    def->total_size += 4;
+                } else {
+                    int value = values->last_value + 1;
+                    if (!AddEnumValue(values, field, value) || !declare(global, field, TOKEN_LITERAL_INTEGER, value)) {
+                        return false;
+                    }
+                }
+            }
+        } else if (is_type(tokens, i) && declares && TokenBuffer_type(tokens, i + 2) == TOKEN_PAREN_OPEN) {
+            FunctionSignature* func = CreateFunction(name, type);
+            ScopeLevel* scope = func ? CreateScope(global) : NULL;
+            if (!scope) {
+                DestroyFunction(func);
+                return false;
+            }
+            func->scope = scope;
+            c->functions[t->function_count++] = func;
+            c->scopes[t->scope_count++] = scope;
+            if (!declare(global, name, TOKEN_LITERAL_IDENTIFIER, i)) return false;
+
+            for (i += 3; i < n && TokenBuffer_type(tokens, i) != TOKEN_PAREN_CLOSE; i++) {
+                if (TokenBuffer_type(tokens, i) != TOKEN_LITERAL_IDENTIFIER || !is_type(tokens, i - 1)) continue;
+                const char* param = TokenBuffer_value(tokens, i);
+                TokenType param_type = TokenBuffer_type(tokens, i - 1);
+                if (!AddParameter(func, param, param_type) || !declare(scope, param, param_type, i)) return false;
+            }
+        } else if (type == TOKEN_LITERAL_IDENTIFIER) {
+            if (!declare(global, TokenBuffer_value(tokens, i), TOKEN_LITERAL_IDENTIFIER, i)) return false;
+        }
+    }
+
+    t->scopes = c->scopes;
+    t->functions = c->functions;
+    t->structs = c->structs;
+    t->enums = c->enums;
+    return true;
+}
+
+static void free_collected(Collected* c) {
+    for (uint32_t i = 0; i < c->tables.function_count; i++) DestroyFunction(c->functions[i]);
+    for (uint32_t i = 0; i < c->tables.struct_count; i++) DestroyStruct(c->structs[i]);
+    for (uint32_t i = 0; i < c->tables.enum_count; i++) DestroyEnum(c->enums[i]);
+    if (c->tables.scope_count) DestroyScope(c->scopes[0]);  // Function scopes went with their functions
+    free(c->scopes);
+    free(c->functions);
+    free(c->structs);
+    free(c->enums);
+    TokenBuffer_destroy(c->tokens);
+    StringInterner_destroy(c->interner);
+    memset(c, 0, sizeof(*c));
+}
+
+// The cold path a hit replaces
+static bool lex_and_collect(const char* text, size_t length, Collected* c) {
+    memset(c, 0, sizeof(*c));
+    c->interner = StringInterner_create();
+    c->tokens = TokenBuffer_create(0);
+    Lexer* lexer = Lexer_createFromBuffer(text, length, "<bench>");
+    if (!c->interner || !c->tokens || !lexer) return false;
+
+    lexer->skip_comments = true;
+    lexer->track_lines = false;
+    Lexer_setInterner(lexer, c->interner);
+    Lexer_fillBuffer(lexer, c->tokens);
+    Lexer_destroy(lexer);
+    return collect_symbols(c);
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_SOURCE_MB;
+    if (!megabytes) megabytes = 1;
+
+    size_t length;
+    char* text = generate_source(megabytes << 20, &length);
+    char directory[] = "/tmp/gosilang_bench_token_cache_XXXXXX";
+    if (!text || !mkdtemp(directory)) return 1;
+
+    int status = 0;
+
+    // Cold: lex, collect and write
+    Collected collected;
+    double start = now_seconds();
+    uint64_t key = TokenCache_key(text, length, OPTIONS);
+    double key_time = now_seconds() - start;
+    start = now_seconds();
+    if (!lex_and_collect(text, length, &collected)) return 1;
+    double cold_time = now_seconds() - start;
+    start = now_seconds();
+    bool written = TokenCache_write(directory, key, collected.tokens, collected.interner, &collected.tables);
+    double write_time = now_seconds() - start;
+    if (!written) {
+        fprintf(stderr, "writing the cache entry failed\n");
+        return 1;
+    }
+
+    // Warm: hash the source and map the entry, best of REPEATS
+    double hit_time = 1e9;
+    for (int r = 0; r < REPEATS && !status; r++) {
+        start = now_seconds();
+        TokenCache* cache = TokenCache_open(directory, TokenCache_key(text, length, OPTIONS), text, length);
+        double elapsed = now_seconds() - start;
+        if (elapsed < hit_time) hit_time = elapsed;
+
+        if (!cache || cache->tokens.count != collected.tokens->count) {
+            fprintf(stderr, "cache hit %d was refused\n", r);
+            status = 1;
+        }
+        TokenCache_close(cache);
+    }
+
+    char path[sizeof(directory) + 64];
+    snprintf(path, sizeof(path), "%s/%016llx%s", directory, (unsigned long long)key, TOKEN_CACHE_EXTENSION);
+    FILE* file = fopen(path, "rb");
+    long file_size = 0;
+    if (file) {
+        fseek(file, 0, SEEK_END);
+        file_size = ftell(file);
+        fclose(file);
+    }
+    unlink(path);
+    rmdir(directory);
+
+    if (!status) {
+        const SymbolTables* t = &collected.tables;
+        uint32_t symbols = 0;
+        for (uint32_t i = 0; i < t->scope_count; i++) symbols += t->scopes[i]->symbol_count;
+        printf("Token cache benchmark (%.1f MB source, %u tokens, %u lexemes)\n", (double)length / (1 << 20),
+               collected.tokens->count, collected.interner->count);
+        printf("symbols      %u in %u scopes, %u functions, %u structs, %u enums\n", symbols,
+               t->scope_count, t->function_count, t->struct_count, t->enum_count);
+        printf("entry        %8.1f MB\n", (double)file_size / (1 << 20));
+        printf("content key  %8.2f ms  (%.2f GB/s)\n", key_time * 1e3, (double)length / key_time / 1e9);
+        printf("lex+collect  %8.2f ms\n", cold_time * 1e3);
+        printf("write        %8.2f ms\n", write_time * 1e3);
+        printf("hit          %8.2f ms  (key + map + checks, %.1fx faster than lex+collect)\n", hit_time * 1e3,
+               cold_time / hit_time);
+    }
+
+    free_collected(&collected);
+    free(text);
+    return status;
+}
@@ -0,0 +1,142 @@
+// Token transition gate benchmark: lexes a synthetic source into a
+// TokenBuffer and checks every adjacent pair of significant tokens
+// against the transition matrix, in one batch pass and pair by pair
+// through TokenType_isValidTransition. The clean stream must pass; after
+// random token types are overwritten, the batch pass must report the
+// same positions as the pairwise reference, and a capped scan its first
+// entries. The run fails on any mismatch.
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/tokenizer/symbols/sym_transition.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_SOURCE_MB 64
+#define CORRUPT_EVERY 4093
+#define CAPPED_POSITIONS 16
+
+static const char* const source_lines[] = {
+    "int compute_value_%d(int alpha, int beta) {\n",
+    "    // accumulate the running total for iteration %d\n",
+    "    total_%d = alpha * 4 + beta / 2 - (gamma << 3) + 0x1F;\n",
+    "    if (total >= limit_%d && !done) { return total; }\n",
+    "    /* block comment %d spanning\n       two lines */\n",
+    "    const char* label = \"value %d\\n\";\n",
+    "    ratio = 1.5e-3 * weight_%d + .25;\n",
+    "    while (node_%d->next != NULL) { node = node->next; count++; }\n",
+    "}\n",
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 0x2545F4914F6CDD1Dull;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+// Whole functions only, so the stream ends where C allows it to
+static char* generate_source(size_t target, size_t* length) {
+    size_t line_count = sizeof(source_lines) / sizeof(source_lines[0]);
+    char* data = (char*)malloc(target + line_count * 128);
+    if (!data) return NULL;
+
+    size_t used = 0;
+    for (int i = 0; used < target || i % (int)line_count != 0; i++) {
+        used += (size_t)sprintf(data + used, source_lines[i % line_count], i % 997);
+    }
+    *length = used;
+    return data;
+}
+
+// The same check, one TokenType_isValidTransition call per pair
+static uint32_t check_pairwise(const TokenBuffer* tokens, uint32_t* positions, uint32_t max_positions) {
+    const TokenTransitions* transitions = TokenTransitions_get();
+    TokenType previous = TOKEN_PUNCT_SEMICOLON;
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < tokens->count && found < max_positions; i++) {
+        TokenType type = (TokenType)tokens->types[i];
+        if (!TokenType_isValidTransition(previous, type)) positions[found++] = i;
+        if (!TokenTransitions_isTransparent(transitions, type)) previous = type;
+    }
+    if (found < max_positions && !TokenType_isValidTransition(previous, TOKEN_EOF)) {
+        positions[found++] = tokens->count;
+    }
+    return found;
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_SOURCE_MB;
+    if (!megabytes) megabytes = 1;
+
+    size_t length;
+    char* source = generate_source(megabytes << 20, &length);
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    if (!source || !tokens) return 1;
+
+    Lexer* lexer = Lexer_createFromBuffer(source, length, "bench");
+    Lexer_fillBuffer(lexer, tokens);
+    Lexer_destroy(lexer);
+
+    uint32_t count = tokens->count;
+    uint32_t max_positions = count / CORRUPT_EVERY + 2;
+    uint32_t* batch = (uint32_t*)malloc(max_positions * sizeof(uint32_t));
+    uint32_t* reference = (uint32_t*)malloc(max_positions * sizeof(uint32_t));
+    if (!batch || !reference) return 1;
+
+    printf("Token transition benchmark (%.1f MB source, %u tokens)\n", (double)length / (1 << 20), count);
+    int status = 0;
+
+    // Clean input: both passes scan everything and find nothing
+    double start = now_seconds();
+    uint32_t found = TokenBuffer_checkTransitions(tokens, 0, count, batch, 1);
+    double batch_time = now_seconds() - start;
+    start = now_seconds();
+    uint32_t expected = check_pairwise(tokens, reference, 1);
+    double pairwise_time = now_seconds() - start;
+
+    printf("batch       %8.2f ms  %6.3f ns/token  %7.2f GB/s of types\n", batch_time * 1e3,
+           batch_time * 1e9 / count, (double)count / batch_time / 1e9);
+    printf("pairwise    %8.2f ms  %6.3f ns/token  (%.1fx slower)\n", pairwise_time * 1e3,
+           pairwise_time * 1e9 / count, pairwise_time / batch_time);
+    if (found || expected) {
+        fprintf(stderr, "clean stream rejected at token %u\n", found ? batch[0] : reference[0]);
+        status = 1;
+    }
+
+    // Garbage: overwrite a spread of token types with random ones
+    for (uint32_t i = next_random() % CORRUPT_EVERY; i < count; i += CORRUPT_EVERY) {
+        tokens->types[i] = (uint8_t)(next_random() % TOKEN_TYPE_COUNT);
+    }
+    found = TokenBuffer_checkTransitions(tokens, 0, count, batch, max_positions);
+    expected = check_pairwise(tokens, reference, max_positions);
+    printf("corrupted   %u of %u overwritten tokens rejected\n", found, count / CORRUPT_EVERY);
+    if (found != expected || memcmp(batch, reference, found * sizeof(uint32_t)) != 0) {
+        fprintf(stderr, "batch positions differ from the pairwise check\n");
+        status = 1;
+    }
+
+    start = now_seconds();
+    uint32_t capped = TokenBuffer_checkTransitions(tokens, 0, count, batch, CAPPED_POSITIONS);
+    double capped_time = now_seconds() - start;
+    printf("first %-4u  %8.3f ms to reject\n", CAPPED_POSITIONS, capped_time * 1e3);
+    if (capped != (expected < CAPPED_POSITIONS ? expected : CAPPED_POSITIONS) ||
+        memcmp(batch, reference, capped * sizeof(uint32_t)) != 0) {
+        fprintf(stderr, "capped scan differs from the first positions\n");
+        status = 1;
+    }
+
+    free(reference);
+    free(batch);
+    TokenBuffer_destroy(tokens);
+    free(source);
+    return status;
+}
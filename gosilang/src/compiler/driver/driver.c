@@ -0,0 +1,732 @@
+#include "driver.h"
+#include "compiler/optimizer/fold/const_fold.h"
+#include "core/ast/validator/ast_validator.h"
+#include "core/parser/expr_parser.h"
+#include "core/tokenizer/lexer/lex_parallel.h"
+#include "core/tokenizer/symbols/sym_cache.h"
+#include "runtime/debug/profiler/profiler.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define COMPILE_CACHE_OPTIONS (TOKEN_CACHE_SKIP_COMMENTS | TOKEN_CACHE_INTERNED)
+#define COMPILE_MESSAGE_SIZE 512
+
+static const char* const compile_phase_names[COMPILE_PHASE_COUNT] = {
+#define X(phase, name) [phase] = name,
+    COMPILE_PHASE_LIST(X)
+#undef X
+};
+
+// Profiler timer each phase's time is also charged to
+static const ProfileTimer compile_phase_timers[COMPILE_PHASE_COUNT] = {
+    [COMPILE_PHASE_READ] = PROFILE_TIMER_READ,
+    [COMPILE_PHASE_LEX] = PROFILE_TIMER_LEX,
+    [COMPILE_PHASE_PARSE] = PROFILE_TIMER_PARSE,
+    [COMPILE_PHASE_FOLD] = PROFILE_TIMER_FOLD,
+    [COMPILE_PHASE_VALIDATE] = PROFILE_TIMER_VALIDATE,
+    [COMPILE_PHASE_SYMBOLS] = PROFILE_TIMER_SYMBOLS,
+};
+
+typedef struct CompileRun CompileRun;
+
+// One file's task
+typedef struct CompileTask {
+    WorkTask task;
+    CompileRun* run;
+    uint32_t index;
+} CompileTask;
+
+// State shared by the tasks of one CompileDriver_run. max_in_flight
+// tasks are submitted up front and each one that finishes submits the
+// next file's, so no more files than that are ever open.
+struct CompileRun {
+    CompileDriver* driver;
+    CompileTask* tasks;         // One per file
+    WorkGroup group;
+    atomic_uint next;           // Next file to submit
+    atomic_bool failed;         // Memory ran out
+};
+
+// A file being compiled; everything but the result is released when
+// the file is done
+typedef struct CompileUnit {
+    CompileDriver* driver;
+    CompileResult* result;
+    SourceFile* source;
+    StringInterner* interner;   // Owned unless the tokens are cached
+    TokenBuffer* tokens;        // Owned unless the tokens are cached
+    TokenCache* cache;
+    uint64_t cache_key;
+    ScopeLevel* declared;       // Globals this file declares, first of each name
+    AstPool* ast;
+    AstNodeId* roots;           // Statements that parsed
+    ConstantFolder* folder;     // Values of the folded pool, NULL if not folded
+    uint32_t root_count;
+    size_t first_skipped;       // Offset of the first thing ParseFile passed over
+    size_t message_size;
+    size_t message_capacity;
+    uint32_t message_count;
+    uint32_t message_kept;      // Messages in result->messages
+    size_t message_offsets[COMPILE_MAX_MESSAGES];   // Source offset of each kept message
+    size_t message_starts[COMPILE_MAX_MESSAGES];    // Where each starts in result->messages
+    uint64_t nested_ns;         // Spent on other files in a nested wait
+} CompileUnit;
+
+// File being compiled by this thread. Waiting for its lexing or
+// validation jobs may run another file's task on the same thread; that
+// file's time is not charged to this one's phases.
+static _Thread_local CompileUnit* current_unit;
+
+const char* CompilePhase_toString(CompilePhase phase) {
+    return (unsigned)phase < COMPILE_PHASE_COUNT ? compile_phase_names[phase] : "unknown";
+}
+
+static uint64_t NowNanoseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Charges the time since start to phase and returns the current time
+static uint64_t EndPhase(CompileUnit* unit, CompilePhase phase, uint64_t start) {
+    uint64_t now = NowNanoseconds();
+    uint64_t spent = now - start - unit->nested_ns;
+    unit->result->phase_ns[phase] += spent;
+    PROFILE_TIME(compile_phase_timers[phase], spent);
+    unit->nested_ns = 0;
+    return now;
+}
+
+static bool AppendMessage(CompileUnit* unit, const char* line, int length) {
+    CompileResult* result = unit->result;
+    if (length < 0) return false;
+    if (length >= COMPILE_MESSAGE_SIZE) length = COMPILE_MESSAGE_SIZE - 1;
+
+    if (unit->message_size + (size_t)length + 1 > unit->message_capacity) {
+        size_t capacity = unit->message_capacity ? unit->message_capacity * 2 : COMPILE_MESSAGE_SIZE * 4;
+        char* messages = (char*)realloc(result->messages, capacity);
+        if (!messages) return false;
+        result->messages = messages;
+        unit->message_capacity = capacity;
+    }
+    memcpy(result->messages + unit->message_size, line, (size_t)length);
+    unit->message_size += (size_t)length;
+    result->messages[unit->message_size] = '\0';
+    return true;
+}
+
+// Keeps a message if the file has room for it. offset locates it in the
+// source; SIZE_MAX reports it against the file.
+static void AddMessage(CompileUnit* unit, const char* severity, size_t offset, const char* format, va_list args) {
+    const char* path = unit->result->path;
+    if (unit->message_count >= COMPILE_MAX_MESSAGES) return;
+    unit->message_count++;
+
+    char text[COMPILE_MESSAGE_SIZE / 2];
+    vsnprintf(text, sizeof(text), format, args);
+
+    char line[COMPILE_MESSAGE_SIZE];
+    int line_number, column, length;
+    if (offset != SIZE_MAX && SourceFile_locate(unit->source, offset, &line_number, &column)) {
+        length = snprintf(line, sizeof(line), "%s:%d:%d: %s: %s\n", path, line_number, column, severity, text);
+    } else {
+        offset = SIZE_MAX;
+        length = snprintf(line, sizeof(line), "%s: %s: %s\n", path, severity, text);
+    }
+    size_t start = unit->message_size;
+    if (AppendMessage(unit, line, length)) {
+        unit->message_offsets[unit->message_kept] = offset;
+        unit->message_starts[unit->message_kept] = start;
+        unit->message_kept++;
+    }
+}
+
+// Puts the file's messages in source order, which for one file is line
+// and column order; messages about the whole file come first. Phases
+// report as they run, so a lexer error can precede a syntax error above
+// it, and the note on passed-over declarations follows them all.
+static void SortMessages(CompileUnit* unit) {
+    uint32_t count = unit->message_kept;
+    uint32_t order[COMPILE_MAX_MESSAGES];
+    bool sorted = true;
+    for (uint32_t i = 0; i < count; i++) {
+        // Insertion sort keeps messages at one position in report order
+        size_t key = unit->message_offsets[i] + 1;  // SIZE_MAX wraps to 0
+        uint32_t j = i;
+        for (; j > 0 && unit->message_offsets[order[j - 1]] + 1 > key; j--) order[j] = order[j - 1];
+        order[j] = i;
+        sorted = sorted && j == i;
+    }
+    if (sorted) return;
+
+    char* messages = (char*)malloc(unit->message_capacity);
+    if (!messages) return;
+    size_t used = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t m = order[i];
+        size_t start = unit->message_starts[m];
+        size_t end = m + 1 < count ? unit->message_starts[m + 1] : unit->message_size;
+        memcpy(messages + used, unit->result->messages + start, end - start);
+        used += end - start;
+    }
+    messages[used] = '\0';
+    free(unit->result->messages);
+    unit->result->messages = messages;
+}
+
+// Counts an error and keeps its message
+static void Report(CompileUnit* unit, size_t offset, const char* format, ...) {
+    unit->result->errors++;
+    va_list args;
+    va_start(args, format);
+    AddMessage(unit, "error", offset, format, args);
+    va_end(args);
+}
+
+// Keeps a message that does not fail the file
+static void Note(CompileUnit* unit, size_t offset, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    AddMessage(unit, "note", offset, format, args);
+    va_end(args);
+}
+
+static size_t TokenOffset(const CompileUnit* unit, uint32_t token) {
+    return token < unit->tokens->count ? unit->tokens->offsets[token] : unit->source->size;
+}
+
+// Tokens come from the cache when an entry for the file's contents
+// exists; otherwise the file is lexed and DeclareGlobals writes an entry
+static bool LexFile(CompileUnit* unit, WorkPool* pool) {
+    const CompileOptions* options = &unit->driver->options;
+    SourceFile* source = unit->source;
+    if (options->cache_dir) {
+        uint32_t cache_options = COMPILE_CACHE_OPTIONS | (options->fold ? TOKEN_CACHE_FOLDED : 0);
+        unit->cache_key = TokenCache_key(source->data, source->size, cache_options);
+        unit->cache = TokenCache_open(options->cache_dir, unit->cache_key, source->data, source->size);
+        if (unit->cache) {
+            unit->tokens = &unit->cache->tokens;
+            unit->result->cached = true;
+            return true;
+        }
+    }
+
+    unit->interner = StringInterner_create();
+    unit->tokens = TokenBuffer_create(0);
+    Lexer* lexer = unit->interner && unit->tokens ? Lexer_createFromSource(source) : NULL;
+    if (!lexer) return false;
+
+    lexer->skip_comments = true;
+    lexer->quiet = true;        // Invalid tokens are reported below
+    Lexer_setInterner(lexer, unit->interner);
+    Lexer_fillBufferParallel(lexer, unit->tokens, pool);
+    Lexer_destroy(lexer);
+
+    // Statements end at ';' or the end of the file, not at TOKEN_EOF
+    TokenBuffer* tokens = unit->tokens;
+    if (tokens->count && tokens->types[tokens->count - 1] == TOKEN_EOF) tokens->count--;
+    return true;
+}
+
+static const StringInterner* UnitInterner(const CompileUnit* unit) {
+    return unit->cache ? &unit->cache->interner : unit->interner;
+}
+
+// Whether the statement starting at token begin declares or defines
+// something rather than computing a value: it starts with a type,
+// storage class or qualifier; with a typedef'd name or an attribute,
+// 'name' or 'name(...)', followed by a name or one of those; or with
+// 'name *name' followed by what a declarator can be. A lone 'a * b;' is
+// read as the pointer declaration it nearly always is.
+static bool StartsDeclaration(const TokenBuffer* tokens, uint32_t begin) {
+    TokenType type = (TokenType)tokens->types[begin];
+    if (TokenType_isType(type) || TokenType_isDeclaration(type) || type == TOKEN_LITERAL_KEYWORD) return true;
+    if (type != TOKEN_LITERAL_IDENTIFIER) return false;
+
+    uint32_t i = begin + 1;
+    if (i < tokens->count && tokens->types[i] == TOKEN_PAREN_OPEN) {
+        uint32_t depth = 0;
+        for (; i < tokens->count; i++) {
+            if (tokens->types[i] == TOKEN_PAREN_OPEN) depth++;
+            if (tokens->types[i] == TOKEN_PAREN_CLOSE && !--depth) break;
+        }
+        i++;
+    }
+    if (i < tokens->count) {
+        TokenType next = (TokenType)tokens->types[i];
+        if (next == TOKEN_LITERAL_IDENTIFIER || TokenType_isType(next) || TokenType_isDeclaration(next) ||
+            next == TOKEN_LITERAL_KEYWORD) {
+            return true;
+        }
+    }
+    if (i != begin + 1) return false;
+    bool pointer = false;
+    for (; i < tokens->count && tokens->types[i] == TOKEN_EXPR_BINARY && tokens->lexemes[i] == LEXEME_STAR; i++) {
+        pointer = true;
+    }
+    if (!pointer || i + 1 >= tokens->count || tokens->types[i] != TOKEN_LITERAL_IDENTIFIER) return false;
+
+    switch ((TokenType)tokens->types[i + 1]) {
+        case TOKEN_PUNCT_SEMICOLON:
+        case TOKEN_PUNCT_COMMA:
+        case TOKEN_EXPR_ASSIGNMENT:
+        case TOKEN_BRACKET_OPEN:
+        case TOKEN_PAREN_OPEN:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Last token of the declaration starting at begin: its ';' outside any
+// brackets, or the '}' that closes a function body, which has none
+static uint32_t DeclarationEnd(const TokenBuffer* tokens, uint32_t begin) {
+    uint32_t depth = 0;
+    bool body = false;
+    for (uint32_t i = begin; i < tokens->count; i++) {
+        switch ((TokenType)tokens->types[i]) {
+            case TOKEN_BLOCK_BEGIN:
+            case TOKEN_SCOPE_BEGIN:
+                if (!depth && i > begin && tokens->types[i - 1] == TOKEN_PAREN_CLOSE) body = true;
+                depth++;
+                break;
+            case TOKEN_PAREN_OPEN:
+            case TOKEN_BRACKET_OPEN:
+                depth++;
+                break;
+            case TOKEN_BLOCK_END:
+            case TOKEN_SCOPE_END:
+                if (depth && !--depth && body) return i;
+                break;
+            case TOKEN_PAREN_CLOSE:
+            case TOKEN_BRACKET_CLOSE:
+                if (depth) depth--;
+                break;
+            case TOKEN_PUNCT_SEMICOLON:
+                if (!depth) return i;
+                break;
+            default:
+                break;
+        }
+    }
+    return tokens->count - 1;
+}
+
+static void Skip(CompileUnit* unit, uint32_t token) {
+    if (!unit->result->skipped++) unit->first_skipped = unit->tokens->offsets[token];
+}
+
+// Splits the tokens at ';' and parses each expression statement into one
+// pool; declarations and directives are passed over
+static bool ParseFile(CompileUnit* unit, ExprParser* parser) {
+    const TokenBuffer* tokens = unit->tokens;
+    unit->ast = AstPool_create(tokens->count + 1);
+    unit->roots = (AstNodeId*)malloc((tokens->count + 1) * sizeof(AstNodeId));
+    if (!unit->ast || !unit->roots) return false;
+
+    uint32_t start = 0;
+    for (uint32_t i = 0; i <= tokens->count; i++) {
+        if (i == start && i < tokens->count) {
+            if (tokens->types[i] == TOKEN_PREPROCESSOR) {
+                Skip(unit, i);
+                start = i + 1;
+                continue;
+            }
+            if (StartsDeclaration(tokens, i)) {
+                Skip(unit, i);
+                i = DeclarationEnd(tokens, i);
+                start = i + 1;
+                continue;
+            }
+        }
+        bool end = i == tokens->count;
+        if (!end && tokens->types[i] != TOKEN_PUNCT_SEMICOLON) continue;
+        if (end && start == i) break;
+
+        unit->result->statements++;
+        if (start < i) {
+            AstNodeId root = ExprParser_build(parser, tokens, start, i, unit->ast);
+            if (root != AST_NODE_NONE) {
+                unit->roots[unit->root_count++] = root;
+            } else {
+                Report(unit, TokenOffset(unit, parser->error_token), "%s",
+                       parser->error ? parser->error : "syntax error");
+            }
+        }
+        start = i + 1;
+    }
+    if (unit->result->skipped) {
+        Note(unit, unit->first_skipped, "passed over %u declarations, definitions and directives; only "
+             "expression statements are compiled", unit->result->skipped);
+    }
+    return true;
+}
+
+static bool FoldFile(CompileUnit* unit, ConstantFolder* folder) {
+    if (!ConstantFolder_run(folder, unit->ast, unit->tokens)) return false;
+    unit->folder = folder;
+    unit->result->folded = folder->folded;
+    return true;
+}
+
+static TokenType ValueTokenType(ValueType type) {
+    switch (type) {
+        case VAL_INTEGER: return TOKEN_LITERAL_INTEGER;
+        case VAL_FLOAT: return TOKEN_LITERAL_FLOAT;
+        case VAL_CHAR: return TOKEN_LITERAL_CHAR;
+        case VAL_STRING: return TOKEN_LITERAL_STRING;
+        case VAL_BOOL: return TOKEN_LITERAL_BOOL;
+        case VAL_NULL: return TOKEN_LITERAL_NULL;
+        default: return TOKEN_LITERAL_VALUE;
+    }
+}
+
+static bool ValidateFile(CompileUnit* unit, AstValidator* validator) {
+    if (!AstValidator_run(validator, unit->ast, unit->tokens, unit->roots, unit->root_count)) return false;
+
+    for (uint32_t i = 0; i < validator->diagnostic_count; i++) {
+        const AstDiagnostic* diagnostic = &validator->diagnostics[i];
+        size_t offset = diagnostic->token == UINT32_MAX ? SIZE_MAX : TokenOffset(unit, diagnostic->token);
+        Report(unit, offset, "%s", AstDiagnosticCode_toString((AstDiagnosticCode)diagnostic->code));
+    }
+    return true;
+}
+
+static SymbolTableEntry* CopySymbol(const SymbolTableEntry* symbol) {
+    SymbolTableEntry* copy = CreateSymbol(symbol->name, symbol->token_type);
+    if (!copy) return NULL;
+
+    copy->attributes = symbol->attributes;
+    copy->value = symbol->value;
+    if (symbol->value.type == VAL_STRING && symbol->value.data.string_val) {
+        copy->value.data.string_val = strdup(symbol->value.data.string_val);
+        if (!copy->value.data.string_val) {
+            copy->value.type = VAL_NULL;
+            DestroySymbol(copy);
+            return NULL;
+        }
+    }
+    return copy;
+}
+
+// Offers a symbol to the global scope, which keeps the first file's
+static bool OfferGlobal(CompileUnit* unit, SymbolTableEntry* symbol) {
+    if (!symbol) return false;
+    if (SharedScope_add(unit->driver->globals, symbol)) {
+        unit->result->globals++;
+    } else {
+        DestroySymbol(symbol);  // Another file declared it first
+    }
+    return true;
+}
+
+// The file's declarations as its cache entry stored them
+static bool DeclareCached(CompileUnit* unit) {
+    const TokenCache* cache = unit->cache;
+    const CachedScope* scope = &cache->scopes[0];
+    for (uint32_t i = 0; i < scope->symbol_count; i++) {
+        const CachedSymbol* cached = &cache->symbols[scope->first_symbol + i];
+        const char* name = TokenCache_string(cache, cached->name);
+        if (SharedScope_find(unit->driver->globals, name, cached->name.length, cached->name_hash)) continue;
+        if (!OfferGlobal(unit, TokenCache_loadSymbol(cache, cached))) return false;
+    }
+    return true;
+}
+
+// The target of every top-level 'name = ...' statement, the first one
+// of each name, collected into the file's own scope
+static bool CollectDeclarations(CompileUnit* unit) {
+    const StringInterner* interner = UnitInterner(unit);
+    const TokenBuffer* tokens = unit->tokens;
+    unit->declared = CreateScope(NULL);
+    if (!unit->declared) return false;
+
+    for (uint32_t r = 0; r < unit->root_count; r++) {
+        const AstNode* root = AstPool_node(unit->ast, unit->roots[r]);
+        if (root->kind != AST_NODE_BINARY || root->op != OP_ASSIGN) continue;
+
+        const AstNode* target = AstPool_node(unit->ast, AstPool_child(unit->ast, unit->roots[r], 0));
+        if (!target || target->kind != AST_NODE_IDENTIFIER) continue;
+
+        LexemeId lexeme = tokens->lexemes[target->token];
+        uint32_t length;
+        const char* name = StringInterner_get(interner, lexeme, &length);
+        if (!name) continue;
+
+        if (FindSymbolHashed(unit->declared, name, length, interner->hashes[lexeme])) continue;
+
+        // A literal value gives the symbol its type, a constant also its value
+        AstNodeId value_id = AstPool_child(unit->ast, unit->roots[r], 1);
+        const AstNode* value = AstPool_node(unit->ast, value_id);
+        const LiteralValue* constant = unit->folder ? ConstantFolder_value(unit->folder, value_id) : NULL;
+        TokenType type = TOKEN_LITERAL_IDENTIFIER;
+        if (constant) {
+            type = ValueTokenType(constant->type);
+        } else if (value && value->kind == AST_NODE_LITERAL) {
+            type = (TokenType)tokens->types[value->token];
+        }
+        SymbolTableEntry* symbol = CreateSymbol(name, type);
+        if (!symbol) return false;
+        if (constant) symbol->value = *constant;
+        if (!AddSymbol(unit->declared, symbol)) {
+            DestroySymbol(symbol);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Declares the file's globals in the scope every file shares, unless
+// another file already did. A cached file's declarations come from its
+// entry; otherwise they are collected from the trees and written to a
+// new entry with the tokens.
+static bool DeclareGlobals(CompileUnit* unit) {
+    CompileDriver* driver = unit->driver;
+    if (unit->cache && unit->cache->scope_count) return DeclareCached(unit);
+    if (!CollectDeclarations(unit)) return false;
+
+    for (const SymbolTableEntry* symbol = unit->declared->symbols; symbol; symbol = symbol->next) {
+        if (SharedScope_find(driver->globals, symbol->name, strlen(symbol->name), symbol->name_hash)) continue;
+        if (!OfferGlobal(unit, CopySymbol(symbol))) return false;
+    }
+
+    if (driver->options.cache_dir && !unit->cache) {
+        SymbolTables tables = { .scopes = &unit->declared, .scope_count = 1 };
+        TokenCache_write(driver->options.cache_dir, unit->cache_key, unit->tokens, unit->interner, &tables);
+    }
+    return true;
+}
+
+static void ReleaseUnit(CompileUnit* unit) {
+    DestroyScope(unit->declared);
+    free(unit->roots);
+    AstPool_destroy(unit->ast);
+    if (unit->cache) {
+        TokenCache_close(unit->cache);
+    } else {
+        TokenBuffer_destroy(unit->tokens);
+        StringInterner_destroy(unit->interner);
+    }
+    SourceFile_close(unit->source);
+}
+
+static bool CompileFile(CompileDriver* driver, CompileResult* result) {
+    CompileUnit unit;
+    memset(&unit, 0, sizeof(unit));
+    unit.driver = driver;
+    unit.result = result;
+
+    CompileUnit* outer = current_unit;
+    current_unit = &unit;
+    uint64_t begin = NowNanoseconds();
+    uint64_t time = begin;
+
+    ExprParser* parser = ExprParser_create();
+    AstValidator* validator = AstValidator_create(driver->pool);
+    ConstantFolder* folder = driver->options.fold ? ConstantFolder_create() : NULL;
+    bool ok = parser && validator && (folder || !driver->options.fold);
+    unit.source = ok ? SourceFile_open(result->path) : NULL;
+    if (unit.source) {
+        result->bytes = unit.source->size;
+    } else if (ok) {
+        Report(&unit, SIZE_MAX, "cannot read file");
+    }
+    time = EndPhase(&unit, COMPILE_PHASE_READ, time);
+
+    if (unit.source) {
+        ok = LexFile(&unit, driver->pool);
+        if (ok) {
+            result->tokens = unit.tokens->count;
+            for (uint32_t i = 0; i < unit.tokens->count; i++) {
+                if (unit.tokens->types[i] == TOKEN_ERROR) Report(&unit, unit.tokens->offsets[i], "invalid token");
+            }
+        }
+        time = EndPhase(&unit, COMPILE_PHASE_LEX, time);
+
+        ok = ok && ParseFile(&unit, parser);
+        time = EndPhase(&unit, COMPILE_PHASE_PARSE, time);
+
+        if (folder) {
+            ok = ok && FoldFile(&unit, folder);
+            time = EndPhase(&unit, COMPILE_PHASE_FOLD, time);
+        }
+
+        if (driver->options.validate) {
+            ok = ok && ValidateFile(&unit, validator);
+            time = EndPhase(&unit, COMPILE_PHASE_VALIDATE, time);
+        }
+
+        ok = ok && DeclareGlobals(&unit);
+        EndPhase(&unit, COMPILE_PHASE_SYMBOLS, time);
+    }
+
+    SortMessages(&unit);
+    if (result->errors > unit.message_count) {
+        char line[COMPILE_MESSAGE_SIZE];
+        AppendMessage(&unit, line, snprintf(line, sizeof(line), "%s: note: %u more errors not shown\n",
+                                            result->path, result->errors - unit.message_count));
+    }
+    result->ok = ok && result->errors == 0;
+    if (Profiler_isTiming()) {
+        Profiler_addCount(PROFILE_COUNTER_FILES, 1);
+        Profiler_addCount(PROFILE_COUNTER_BYTES, result->bytes);
+        Profiler_addCount(PROFILE_COUNTER_TOKENS, result->tokens);
+        Profiler_addCount(PROFILE_COUNTER_STATEMENTS, result->statements);
+        Profiler_addCount(PROFILE_COUNTER_FOLDED, result->folded);
+    }
+
+    ReleaseUnit(&unit);
+    ConstantFolder_destroy(folder);
+    AstValidator_destroy(validator);
+    ExprParser_destroy(parser);
+
+    current_unit = outer;
+    if (outer) outer->nested_ns += NowNanoseconds() - begin;
+    return ok;
+}
+
+static void CompileTaskRun(void* data) {
+    CompileTask* task = (CompileTask*)data;
+    CompileRun* run = task->run;
+    CompileDriver* driver = run->driver;
+
+    if (!CompileFile(driver, &driver->results[task->index])) {
+        atomic_store(&run->failed, true);
+    }
+
+    uint32_t next = atomic_fetch_add_explicit(&run->next, 1, memory_order_relaxed);
+    if (next < driver->file_count) {
+        WorkPool_submit(driver->pool, &run->group, &run->tasks[next].task);
+    }
+}
+
+// Driver lifetime
+CompileDriver* CompileDriver_create(const CompileOptions* options) {
+    CompileDriver* driver = (CompileDriver*)calloc(1, sizeof(CompileDriver));
+    if (!driver) return NULL;
+
+    if (options) {
+        driver->options = *options;
+    } else {
+        driver->options.validate = true;
+        driver->options.fold = true;
+    }
+    driver->pool = WorkPool_create(driver->options.threads);
+    driver->globals = SharedScope_create();
+    if (!driver->pool || !driver->globals) {
+        CompileDriver_destroy(driver);
+        return NULL;
+    }
+
+    if (!driver->options.max_in_flight) {
+        driver->options.max_in_flight = WorkPool_threadCount(driver->pool) * COMPILE_IN_FLIGHT_PER_THREAD;
+    }
+    return driver;
+}
+
+static void ClearResults(CompileDriver* driver) {
+    for (uint32_t i = 0; i < driver->file_count; i++) {
+        free(driver->results[i].messages);
+    }
+    free(driver->results);
+    driver->results = NULL;
+    driver->file_count = 0;
+}
+
+void CompileDriver_destroy(CompileDriver* driver) {
+    if (!driver) return;
+
+    ClearResults(driver);
+    SharedScope_destroy(driver->globals);
+    WorkPool_destroy(driver->pool);
+    free(driver);
+}
+
+bool CompileDriver_run(CompileDriver* driver, const char* const* paths, uint32_t count) {
+    if (!driver || (!paths && count)) return false;
+
+    ClearResults(driver);
+    driver->results = (CompileResult*)calloc(count ? count : 1, sizeof(CompileResult));
+    if (!driver->results) return false;
+    for (uint32_t i = 0; i < count; i++) {
+        driver->results[i].path = paths[i];
+    }
+    driver->file_count = count;
+
+    CompileRun run;
+    run.driver = driver;
+    run.tasks = (CompileTask*)malloc((count ? count : 1) * sizeof(CompileTask));
+    if (!run.tasks) return false;
+    for (uint32_t i = 0; i < count; i++) {
+        run.tasks[i].run = &run;
+        run.tasks[i].index = i;
+        WorkTask_init(&run.tasks[i].task, CompileTaskRun, &run.tasks[i]);
+    }
+    WorkGroup_init(&run.group);
+    atomic_init(&run.failed, false);
+
+    uint32_t in_flight = driver->options.max_in_flight < count ? driver->options.max_in_flight : count;
+    atomic_init(&run.next, in_flight);
+
+    uint64_t start = NowNanoseconds();
+    for (uint32_t i = 0; i < in_flight; i++) {
+        WorkPool_submit(driver->pool, &run.group, &run.tasks[i].task);
+    }
+    WorkPool_wait(driver->pool, &run.group);
+    driver->wall_seconds = (double)(NowNanoseconds() - start) / 1e9;
+    free(run.tasks);
+
+    bool ok = !atomic_load(&run.failed);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        ok = driver->results[i].ok;
+    }
+    return ok;
+}
+
+void CompileDriver_printMessages(const CompileDriver* driver, FILE* stream) {
+    if (!driver || !stream) return;
+
+    for (uint32_t i = 0; i < driver->file_count; i++) {
+        if (driver->results[i].messages) fputs(driver->results[i].messages, stream);
+    }
+}
+
+void CompileDriver_printReport(const CompileDriver* driver, FILE* stream) {
+    if (!driver || !stream) return;
+
+    uint64_t bytes = 0, tokens = 0, statements = 0, skipped = 0, errors = 0, globals = 0, folded = 0;
+    uint32_t cached = 0, failed = 0;
+    uint64_t phase_ns[COMPILE_PHASE_COUNT] = {0};
+    uint64_t total_ns = 0;
+    for (uint32_t i = 0; i < driver->file_count; i++) {
+        const CompileResult* result = &driver->results[i];
+        bytes += result->bytes;
+        tokens += result->tokens;
+        statements += result->statements;
+        skipped += result->skipped;
+        errors += result->errors;
+        globals += result->globals;
+        folded += result->folded;
+        cached += result->cached;
+        failed += !result->ok;
+        for (int p = 0; p < COMPILE_PHASE_COUNT; p++) {
+            phase_ns[p] += result->phase_ns[p];
+            total_ns += result->phase_ns[p];
+        }
+    }
+
+    double wall = driver->wall_seconds > 0 ? driver->wall_seconds : 1e-9;
+    fprintf(stream, "%u files (%u failed, %u cached), %.2f MB, %llu tokens, %llu statements (%llu passed over), "
+            "%llu errors\n", driver->file_count, failed, cached, (double)bytes / (1 << 20), (unsigned long long)tokens,
+            (unsigned long long)statements, (unsigned long long)skipped, (unsigned long long)errors);
+    fprintf(stream, "%llu globals, %llu operators folded\n", (unsigned long long)globals,
+            (unsigned long long)folded);
+    for (int p = 0; p < COMPILE_PHASE_COUNT; p++) {
+        fprintf(stream, "  %-10s %10.2f ms  %5.1f%%\n", compile_phase_names[p], (double)phase_ns[p] / 1e6,
+                total_ns ? 100.0 * (double)phase_ns[p] / (double)total_ns : 0.0);
+    }
+    fprintf(stream, "wall %.2f ms on %u threads, %.1f MB/s, busy %.2fx\n", wall * 1e3,
+            WorkPool_threadCount(driver->pool), (double)bytes / (1 << 20) / wall, (double)total_ns / 1e9 / wall);
+}
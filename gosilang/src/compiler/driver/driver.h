@@ -0,0 +1,93 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include "core/tokenizer/symbols/sym_shared.h"
+#include "runtime/concurrency/pool/work_pool.h"
+#include <stdio.h>
+
+// Files compiled at once per thread when no limit is given
+#define COMPILE_IN_FLIGHT_PER_THREAD 2
+// Diagnostics kept per file; the rest are only counted
+#define COMPILE_MAX_MESSAGES 20
+
+// X(phase, "name"), in the order a file goes through them
+#define COMPILE_PHASE_LIST(X) \
+    X(COMPILE_PHASE_READ, "read") \
+    X(COMPILE_PHASE_LEX, "lex") \
+    X(COMPILE_PHASE_PARSE, "parse") \
+    X(COMPILE_PHASE_FOLD, "fold") \
+    X(COMPILE_PHASE_VALIDATE, "validate") \
+    X(COMPILE_PHASE_SYMBOLS, "symbols")
+
+typedef enum CompilePhase {
+#define X(phase, name) phase,
+    COMPILE_PHASE_LIST(X)
+#undef X
+    COMPILE_PHASE_COUNT
+} CompilePhase;
+
+typedef struct CompileOptions {
+    uint32_t threads;       // 0 = one per online CPU
+    uint32_t max_in_flight; // Files open at once; 0 = COMPILE_IN_FLIGHT_PER_THREAD per thread
+    const char* cache_dir;  // Token and declaration cache directory, NULL for none
+    bool validate;          // Check every tree with an AstValidator
+    bool fold;              // Fold constant expressions with a ConstantFolder
+} CompileOptions;
+
+// What is kept of a file once it is compiled; its source, tokens and
+// trees are released as soon as it is done
+typedef struct CompileResult {
+    const char* path;       // Borrowed from the caller
+    bool ok;
+    bool cached;            // Tokens came from the token cache
+    uint64_t bytes;
+    uint32_t tokens;
+    uint32_t statements;    // Expression statements
+    uint32_t skipped;       // Declarations, definitions and directives passed over
+    uint32_t errors;        // Lexer, syntax and validator errors
+    uint32_t folded;        // Operators replaced by their constant value
+    uint32_t globals;       // Names this file declared first
+    uint64_t phase_ns[COMPILE_PHASE_COUNT];
+    char* messages;         // "path:line:column: error: ..." lines, or NULL
+} CompileResult;
+
+// Compiles many files on one work pool. Each file is lexed, split into
+// ';'-terminated statements, parsed, constant folded, validated and has
+// its top-level assignments declared into a global scope shared by every
+// file, with the value of those assigned a constant. Only expression
+// statements are compiled: declarations, function and struct
+// definitions and preprocessor directives are passed over whole, with
+// one note per file saying how many, and are not errors. Files
+// do not depend on each other, so at most max_in_flight of them are
+// worked on at once, each by one task; lexing and validation of a large
+// file also spread over idle threads.
+//
+// Every file interns into a private StringInterner, so its lexeme ids
+// mean nothing outside it; globals are shared by name.
+typedef struct CompileDriver {
+    CompileOptions options;
+    WorkPool* pool;
+    SharedScope* globals;
+
+    CompileResult* results; // One per file, in input order
+    uint32_t file_count;
+    double wall_seconds;
+} CompileDriver;
+
+// Driver lifetime
+CompileDriver* CompileDriver_create(const CompileOptions* options);
+void CompileDriver_destroy(CompileDriver* driver);
+
+// Compiles paths, replacing the results of an earlier run. Returns
+// false if any file failed or memory ran out.
+bool CompileDriver_run(CompileDriver* driver, const char* const* paths, uint32_t count);
+
+// Diagnostics of every file, in input order, and of each file by line
+// and column
+void CompileDriver_printMessages(const CompileDriver* driver, FILE* stream);
+// Totals and the time spent in each phase, summed over threads
+void CompileDriver_printReport(const CompileDriver* driver, FILE* stream);
+
+const char* CompilePhase_toString(CompilePhase phase);
+
+#endif // DRIVER_H
@@ -0,0 +1,392 @@
+#include "const_fold.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Where literal spellings come from: a token buffer or a token array
+typedef struct FoldTokens {
+    const TokenBuffer* buffer;
+    Token* const* array;
+    uint32_t count;
+} FoldTokens;
+
+// An integer operand after promotion, sign- or zero-extended to 64 bits
+typedef struct FoldInteger {
+    int64_t bits;
+    int width;
+    bool is_unsigned;
+} FoldInteger;
+
+// Folder lifetime
+ConstantFolder* ConstantFolder_create(void) {
+    return (ConstantFolder*)calloc(1, sizeof(ConstantFolder));
+}
+
+void ConstantFolder_destroy(ConstantFolder* folder) {
+    if (!folder) return;
+    free(folder->values);
+    free(folder->node_values);
+    free(folder);
+}
+
+static bool ReserveNodes(ConstantFolder* folder, uint32_t count) {
+    if (count <= folder->node_capacity) return true;
+
+    uint32_t capacity = folder->node_capacity ? folder->node_capacity : AST_POOL_INITIAL_CAPACITY;
+    while (capacity < count) {
+        capacity = capacity > UINT32_MAX / 2 ? count : capacity * 2;
+    }
+    uint32_t* grown = (uint32_t*)realloc(folder->node_values, capacity * sizeof(uint32_t));
+    if (!grown) return false;
+
+    folder->node_values = grown;
+    folder->node_capacity = capacity;
+    return true;
+}
+
+static bool SetValue(ConstantFolder* folder, AstNodeId node, const LiteralValue* value) {
+    if (folder->value_count == folder->value_capacity) {
+        uint32_t capacity = folder->value_capacity ? folder->value_capacity * 2 : CONST_FOLD_INITIAL_VALUES;
+        LiteralValue* grown = (LiteralValue*)realloc(folder->values, capacity * sizeof(LiteralValue));
+        if (!grown) return false;
+        folder->values = grown;
+        folder->value_capacity = capacity;
+    }
+    folder->values[folder->value_count] = *value;
+    folder->node_values[node] = folder->value_count++;
+    return true;
+}
+
+static bool ValueOf(const ConstantFolder* folder, const AstPool* ast, AstNodeId node, uint32_t index,
+                    LiteralValue* value) {
+    const LiteralValue* found = ConstantFolder_value(folder, AstPool_child(ast, node, index));
+    if (found) *value = *found;
+    return found != NULL;
+}
+
+// Reads a leaf literal's token; strings are not constants
+static bool ParseLeaf(const FoldTokens* tokens, uint32_t token, LiteralValue* value) {
+    if (token >= tokens->count) return false;
+
+    TokenType type;
+    const char* text;
+    uint32_t length;
+    if (tokens->buffer) {
+        type = (TokenType)tokens->buffer->types[token];
+        text = TokenBuffer_value(tokens->buffer, token);
+        length = tokens->buffer->lengths[token];
+    } else {
+        type = tokens->array[token]->type;
+        text = tokens->array[token]->value;
+        length = tokens->array[token]->length;
+    }
+    if (!text || type == TOKEN_LITERAL_STRING) return false;
+
+    memset(value, 0, sizeof(*value));
+    return ParseLiteralValue(value, type, text, length);
+}
+
+// Operand conversions
+
+static bool Truth(const LiteralValue* value, bool* truth) {
+    switch (value->type) {
+        case VAL_INTEGER: *truth = value->data.int_val != 0; return true;
+        case VAL_FLOAT: *truth = value->data.float_val != 0.0; return true;
+        case VAL_CHAR: *truth = value->data.char_val != '\0'; return true;
+        case VAL_BOOL: *truth = value->data.bool_val; return true;
+        case VAL_NULL: *truth = false; return true;
+        default: return false;
+    }
+}
+
+// Integer promotion: chars, bools and integers narrower than 32 bits
+// become a signed 32-bit int
+static bool Promote(const LiteralValue* value, FoldInteger* out) {
+    out->width = 32;
+    out->is_unsigned = false;
+    switch (value->type) {
+        case VAL_INTEGER: {
+            int width = value->bit_width > 0 && value->bit_width < 64 ? value->bit_width : 64;
+            out->bits = WrapIntegerValue((uint64_t)value->data.int_val, width, value->is_unsigned);
+            if (width >= 32) {
+                out->width = width;
+                out->is_unsigned = value->is_unsigned;
+            }
+            return true;
+        }
+        case VAL_CHAR:
+            out->bits = value->data.char_val;
+            return true;
+        case VAL_BOOL:
+            out->bits = value->data.bool_val;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool ToDouble(const LiteralValue* value, double* out) {
+    FoldInteger integer;
+    if (value->type == VAL_FLOAT) {
+        *out = value->data.float_val;
+    } else if (Promote(value, &integer)) {
+        *out = integer.is_unsigned ? (double)(uint64_t)integer.bits : (double)integer.bits;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Usual arithmetic conversions of two promoted integers: the wider type,
+// unsigned at equal width
+static void CommonInteger(const FoldInteger* a, const FoldInteger* b, int* width, bool* is_unsigned) {
+    *width = a->width > b->width ? a->width : b->width;
+    *is_unsigned = (a->width == *width && a->is_unsigned) || (b->width == *width && b->is_unsigned);
+}
+
+static void SetInteger(LiteralValue* value, uint64_t bits, int width, bool is_unsigned) {
+    memset(value, 0, sizeof(*value));
+    value->type = VAL_INTEGER;
+    value->data.int_val = WrapIntegerValue(bits, width, is_unsigned);
+    value->bit_width = width;
+    value->is_unsigned = is_unsigned;
+}
+
+// Comparisons and logical operators give an int
+static void SetTruth(LiteralValue* value, bool truth) {
+    SetInteger(value, truth, 32, false);
+}
+
+static bool SetFloat(LiteralValue* value, double d) {
+    if (d != d || d - d != 0.0) return false;   // NaN or infinite
+    memset(value, 0, sizeof(*value));
+    value->type = VAL_FLOAT;
+    value->data.float_val = d;
+    return true;
+}
+
+// Operators
+
+static bool FoldPrefix(OperatorType op, const LiteralValue* a, LiteralValue* result) {
+    FoldInteger x;
+    bool truth;
+    switch (op) {
+        case OP_LOGICAL_NOT:
+            if (!Truth(a, &truth)) return false;
+            SetTruth(result, !truth);
+            return true;
+        case OP_ADD:
+        case OP_SUBTRACT:
+            if (a->type == VAL_FLOAT) {
+                return SetFloat(result, op == OP_ADD ? a->data.float_val : -a->data.float_val);
+            }
+            if (!Promote(a, &x)) return false;
+            SetInteger(result, op == OP_ADD ? (uint64_t)x.bits : 0 - (uint64_t)x.bits, x.width, x.is_unsigned);
+            return true;
+        case OP_BITWISE_NOT:
+            if (!Promote(a, &x)) return false;
+            SetInteger(result, ~(uint64_t)x.bits, x.width, x.is_unsigned);
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool FoldFloat(OperatorType op, double x, double y, LiteralValue* result) {
+    switch (op) {
+        case OP_ADD: return SetFloat(result, x + y);
+        case OP_SUBTRACT: return SetFloat(result, x - y);
+        case OP_MULTIPLY: return SetFloat(result, x * y);
+        case OP_DIVIDE: return y != 0.0 && SetFloat(result, x / y);
+        case OP_EQUAL: SetTruth(result, x == y); return true;
+        case OP_NOT_EQUAL: SetTruth(result, x != y); return true;
+        case OP_LESS: SetTruth(result, x < y); return true;
+        case OP_GREATER: SetTruth(result, x > y); return true;
+        case OP_LESS_EQUAL: SetTruth(result, x <= y); return true;
+        case OP_GREATER_EQUAL: SetTruth(result, x >= y); return true;
+        default: return false;
+    }
+}
+
+// The result has the promoted left operand's type; counts outside it
+// are undefined
+static bool FoldShift(OperatorType op, const FoldInteger* x, const FoldInteger* count, LiteralValue* result) {
+    if ((!count->is_unsigned && count->bits < 0) || (uint64_t)count->bits >= (uint64_t)x->width) return false;
+
+    uint64_t bits;
+    if (op == OP_SHIFT_LEFT) {
+        bits = (uint64_t)x->bits << count->bits;
+    } else {
+        bits = x->is_unsigned ? (uint64_t)x->bits >> count->bits : (uint64_t)(x->bits >> count->bits);
+    }
+    SetInteger(result, bits, x->width, x->is_unsigned);
+    return true;
+}
+
+static bool FoldBinary(OperatorType op, const LiteralValue* a, const LiteralValue* b, LiteralValue* result) {
+    bool left, right;
+    if (op == OP_LOGICAL_AND || op == OP_LOGICAL_OR) {
+        if (!Truth(a, &left) || !Truth(b, &right)) return false;
+        SetTruth(result, op == OP_LOGICAL_AND ? left && right : left || right);
+        return true;
+    }
+
+    if (a->type == VAL_FLOAT || b->type == VAL_FLOAT) {
+        double x, y;
+        return ToDouble(a, &x) && ToDouble(b, &y) && FoldFloat(op, x, y, result);
+    }
+
+    FoldInteger ia, ib;
+    if (!Promote(a, &ia) || !Promote(b, &ib)) return false;
+    if (op == OP_SHIFT_LEFT || op == OP_SHIFT_RIGHT) return FoldShift(op, &ia, &ib, result);
+
+    int width;
+    bool is_unsigned;
+    CommonInteger(&ia, &ib, &width, &is_unsigned);
+    int64_t x = WrapIntegerValue((uint64_t)ia.bits, width, is_unsigned);
+    int64_t y = WrapIntegerValue((uint64_t)ib.bits, width, is_unsigned);
+    uint64_t ux = (uint64_t)x, uy = (uint64_t)y;
+
+    uint64_t bits;
+    switch (op) {
+        case OP_ADD: bits = ux + uy; break;
+        case OP_SUBTRACT: bits = ux - uy; break;
+        case OP_MULTIPLY: bits = ux * uy; break;
+        case OP_DIVIDE:
+        case OP_MODULO:
+            if (y == 0) return false;
+            if (is_unsigned) {
+                bits = op == OP_DIVIDE ? ux / uy : ux % uy;
+            } else {
+                if (y == -1 && x == WrapIntegerValue(UINT64_C(1) << (width - 1), width, false)) return false;
+                bits = (uint64_t)(op == OP_DIVIDE ? x / y : x % y);
+            }
+            break;
+        case OP_BITWISE_AND: bits = ux & uy; break;
+        case OP_BITWISE_OR: bits = ux | uy; break;
+        case OP_BITWISE_XOR: bits = ux ^ uy; break;
+        case OP_EQUAL: SetTruth(result, x == y); return true;
+        case OP_NOT_EQUAL: SetTruth(result, x != y); return true;
+        case OP_LESS: SetTruth(result, is_unsigned ? ux < uy : x < y); return true;
+        case OP_GREATER: SetTruth(result, is_unsigned ? ux > uy : x > y); return true;
+        case OP_LESS_EQUAL: SetTruth(result, is_unsigned ? ux <= uy : x <= y); return true;
+        case OP_GREATER_EQUAL: SetTruth(result, is_unsigned ? ux >= uy : x >= y); return true;
+        default: return false;
+    }
+    SetInteger(result, bits, width, is_unsigned);
+    return true;
+}
+
+// The value of 'c ? x : y' when c picks selected: it has the type both
+// arms convert to, so '1 ? 2 : 3.0' is the double 2.0. Arms that are not
+// both arithmetic must have one type.
+static bool FoldConditional(const LiteralValue* selected, const LiteralValue* other, LiteralValue* result) {
+    FoldInteger x, y;
+    double d, unused;
+    if (selected->type == VAL_FLOAT || other->type == VAL_FLOAT) {
+        return ToDouble(selected, &d) && ToDouble(other, &unused) && SetFloat(result, d);
+    }
+    if (Promote(selected, &x) && Promote(other, &y)) {
+        int width;
+        bool is_unsigned;
+        CommonInteger(&x, &y, &width, &is_unsigned);
+        SetInteger(result, (uint64_t)x.bits, width, is_unsigned);
+        return true;
+    }
+    if (selected->type != other->type) return false;
+    *result = *selected;
+    return true;
+}
+
+// Rewrites
+
+static bool Replace(ConstantFolder* folder, AstPool* ast, AstNodeId id, const LiteralValue* value) {
+    if (!SetValue(folder, id, value)) return false;
+
+    AstNode* node = &ast->nodes[id];
+    node->kind = AST_NODE_LITERAL;
+    node->op = 0;
+    node->child_count = 0;
+    node->flags |= AST_FLAG_FOLDED;
+    folder->folded++;
+    return true;
+}
+
+// The node takes the place of its child, which is left unreachable
+static void Select(ConstantFolder* folder, AstPool* ast, AstNodeId id, uint32_t index) {
+    AstNodeId child = AstPool_child(ast, id, index);
+    ast->nodes[id] = ast->nodes[child];
+    folder->node_values[id] = folder->node_values[child];
+    folder->folded++;
+}
+
+static bool FoldNode(ConstantFolder* folder, AstPool* ast, const FoldTokens* tokens, AstNodeId id) {
+    AstNode* node = &ast->nodes[id];
+    OperatorType op = (OperatorType)node->op;
+    LiteralValue a, b, result;
+    bool truth;
+
+    switch (node->kind) {
+        case AST_NODE_LITERAL:
+            // A literal folded by an earlier run has no spelling to read
+            if (node->flags & AST_FLAG_FOLDED) return true;
+            return !ParseLeaf(tokens, node->token, &a) || SetValue(folder, id, &a);
+        case AST_NODE_PREFIX:
+            if (!ValueOf(folder, ast, id, 0, &a) || !FoldPrefix(op, &a, &result)) return true;
+            return Replace(folder, ast, id, &result);
+        case AST_NODE_BINARY:
+            if (!ValueOf(folder, ast, id, 0, &a)) return true;
+            if (op == OP_COMMA) {
+                Select(folder, ast, id, 1);
+                return true;
+            }
+            // A deciding left operand of && or || drops the right one
+            if ((op == OP_LOGICAL_AND || op == OP_LOGICAL_OR) && Truth(&a, &truth) &&
+                truth == (op == OP_LOGICAL_OR)) {
+                SetTruth(&result, truth);
+                return Replace(folder, ast, id, &result);
+            }
+            if (!ValueOf(folder, ast, id, 1, &b) || !FoldBinary(op, &a, &b, &result)) return true;
+            return Replace(folder, ast, id, &result);
+        case AST_NODE_CONDITIONAL:
+            // Without both arms' values the result's type is not known
+            if (!ValueOf(folder, ast, id, 0, &result) || !Truth(&result, &truth) ||
+                !ValueOf(folder, ast, id, 1, &a) || !ValueOf(folder, ast, id, 2, &b) ||
+                !FoldConditional(truth ? &a : &b, truth ? &b : &a, &result)) {
+                return true;
+            }
+            return Replace(folder, ast, id, &result);
+        default:
+            return true;
+    }
+}
+
+static bool FoldPool(ConstantFolder* folder, AstPool* ast, const FoldTokens* tokens) {
+    folder->value_count = 0;
+    folder->node_count = 0;
+    folder->folded = 0;
+    if (!ast) return false;
+    if (!ReserveNodes(folder, ast->count)) return false;
+
+    folder->node_count = ast->count;
+    for (AstNodeId id = 0; id < ast->count; id++) {
+        folder->node_values[id] = CONST_FOLD_NONE;
+    }
+    for (AstNodeId id = 0; id < ast->count; id++) {
+        if (!FoldNode(folder, ast, tokens, id)) return false;
+    }
+    return true;
+}
+
+bool ConstantFolder_run(ConstantFolder* folder, AstPool* ast, const TokenBuffer* tokens) {
+    if (!folder || !tokens) return false;
+
+    FoldTokens source = { tokens, NULL, tokens->count };
+    return FoldPool(folder, ast, &source);
+}
+
+bool ConstantFolder_runTokens(ConstantFolder* folder, AstPool* ast, Token* tokens[], uint32_t count) {
+    if (!folder || !tokens) return false;
+
+    FoldTokens source = { NULL, tokens, count };
+    return FoldPool(folder, ast, &source);
+}
@@ -0,0 +1,65 @@
+#ifndef CONST_FOLD_H
+#define CONST_FOLD_H
+
+#include "core/ast/ast.h"
+#include "core/tokenizer/symbols/sym_buffer.h"
+#include "core/tokenizer/symbols/sym_value.h"
+
+#define CONST_FOLD_INITIAL_VALUES 64
+// Node has no constant value
+#define CONST_FOLD_NONE UINT32_MAX
+
+// Evaluates operators whose operands are constants and rewrites each
+// such subtree's root, in place, into an AST_NODE_LITERAL flagged
+// AST_FLAG_FOLDED. The folded node keeps the operator's token, so its
+// value is only available from the folder, not from the token stream.
+//
+// Arithmetic follows C: operands narrower than int are promoted to a
+// 32-bit int, the usual arithmetic conversions pick the wider type and
+// unsigned at equal width, and integer results wrap to their type's
+// bit_width. Subtrees whose result C leaves undefined (division by
+// zero, INT_MIN / -1, shift counts outside the type) are kept as they
+// are, as are assignments, increments, member access, address-of,
+// dereference and sizeof.
+//
+// A constant left operand of && or || that decides the result drops the
+// right one, which need not be constant. A conditional folds only when
+// its condition and both arms are constants: the result has the arms'
+// common type, so '1 ? 2 : 3.0' is the double 2.0, and an arm that is
+// not constant leaves that type unknown. Strings are never constants.
+//
+// Children always precede their parents, so the pool is folded in one
+// bottom-up scan and every root stays where it was.
+typedef struct ConstantFolder {
+    LiteralValue* values;   // Constants of the last run
+    uint32_t value_count;
+    uint32_t value_capacity;
+
+    uint32_t* node_values;  // Per node: index into values or CONST_FOLD_NONE
+    uint32_t node_count;
+    uint32_t node_capacity;
+
+    uint32_t folded;        // Operator nodes replaced by the last run
+} ConstantFolder;
+
+// Folder lifetime
+ConstantFolder* ConstantFolder_create(void);
+void ConstantFolder_destroy(ConstantFolder* folder);
+
+// Folds every tree of ast. Literal spellings are read from tokens, the
+// buffer the pool's trees were built from. Returns false only if memory
+// ran out, in which case the pool may be partly folded but stays valid.
+// A pool is folded once: its folded literals are opaque to a later run.
+bool ConstantFolder_run(ConstantFolder* folder, AstPool* ast, const TokenBuffer* tokens);
+
+// The same for a pool from ParseExpression, whose nodes index tokens
+bool ConstantFolder_runTokens(ConstantFolder* folder, AstPool* ast, Token* tokens[], uint32_t count);
+
+// Value of a node after the last run, NULL if it is not a constant. The
+// value is owned by the folder and valid until its next run.
+static inline const LiteralValue* ConstantFolder_value(const ConstantFolder* folder, AstNodeId node) {
+    if (node >= folder->node_count || folder->node_values[node] == CONST_FOLD_NONE) return NULL;
+    return &folder->values[folder->node_values[node]];
+}
+
+#endif // CONST_FOLD_H
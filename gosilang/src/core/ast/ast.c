@@ -0,0 +1,142 @@
+#include "ast.h"
+#include "core/tokenizer/symbols/sym_value.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const ast_node_kind_names[AST_NODE_KIND_COUNT] = {
+#define X(kind, name) [kind] = name,
+    AST_NODE_KIND_LIST(X)
+#undef X
+};
+
+// Pool lifetime
+AstPool* AstPool_create(uint32_t capacity) {
+    AstPool* pool = (AstPool*)calloc(1, sizeof(AstPool));
+    if (!pool) return NULL;
+
+    capacity = capacity ? capacity : AST_POOL_INITIAL_CAPACITY;
+    if (!AstPool_reserve(pool, capacity, capacity)) {
+        AstPool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void AstPool_destroy(AstPool* pool) {
+    if (!pool) return;
+    free(pool->nodes);
+    free(pool->children);
+    free(pool);
+}
+
+// Drops every tree but keeps the storage for the next parse
+void AstPool_clear(AstPool* pool) {
+    if (!pool) return;
+    pool->count = 0;
+    pool->child_count = 0;
+}
+
+bool AstPool_reserve(AstPool* pool, uint32_t nodes, uint32_t children) {
+    if (!pool) return false;
+
+    if (nodes > pool->capacity) {
+        AstNode* resized = (AstNode*)realloc(pool->nodes, nodes * sizeof(AstNode));
+        if (!resized) return false;
+        pool->nodes = resized;
+        pool->capacity = nodes;
+    }
+    if (children > pool->child_capacity) {
+        AstNodeId* resized = (AstNodeId*)realloc(pool->children, children * sizeof(AstNodeId));
+        if (!resized) return false;
+        pool->children = resized;
+        pool->child_capacity = children;
+    }
+    return true;
+}
+
+// Doubles a capacity until it covers needed; 0 if that overflows
+static uint32_t GrowCapacity(uint32_t capacity, uint32_t needed) {
+    uint32_t grown = capacity ? capacity : AST_POOL_INITIAL_CAPACITY;
+    while (grown < needed) {
+        if (grown > UINT32_MAX / 2) return needed;
+        grown *= 2;
+    }
+    return grown;
+}
+
+AstNodeId AstPool_add(AstPool* pool, AstNodeKind kind, uint8_t op, uint32_t token,
+                      const AstNodeId* children, uint32_t child_count) {
+    if (!pool || (child_count && !children)) return AST_NODE_NONE;
+    if (pool->count == AST_NODE_NONE || child_count > UINT32_MAX - pool->child_count) {
+        return AST_NODE_NONE;
+    }
+
+    uint32_t nodes_needed = pool->count + 1;
+    uint32_t children_needed = pool->child_count + child_count;
+    if (nodes_needed > pool->capacity || children_needed > pool->child_capacity) {
+        uint32_t nodes = nodes_needed > pool->capacity ? GrowCapacity(pool->capacity, nodes_needed) : pool->capacity;
+        uint32_t child_slots = children_needed > pool->child_capacity
+            ? GrowCapacity(pool->child_capacity, children_needed) : pool->child_capacity;
+        if (!AstPool_reserve(pool, nodes, child_slots)) return AST_NODE_NONE;
+    }
+
+    AstNodeId id = pool->count++;
+    AstNode* node = &pool->nodes[id];
+    node->kind = (uint8_t)kind;
+    node->op = op;
+    node->flags = 0;
+    node->token = token;
+    node->first_child = pool->child_count;
+    node->child_count = child_count;
+
+    if (child_count) {
+        memcpy(&pool->children[pool->child_count], children, child_count * sizeof(AstNodeId));
+        pool->child_count += child_count;
+    }
+    return id;
+}
+
+const char* AstNodeKind_toString(AstNodeKind kind) {
+    return (unsigned)kind < AST_NODE_KIND_COUNT ? ast_node_kind_names[kind] : "UNKNOWN";
+}
+
+// Writes the tree as an s-expression: operators by spelling, other
+// nodes by kind, leaves by token index. Walks with an explicit stack,
+// so arbitrarily deep trees print without recursion.
+void AstPool_print(const AstPool* pool, AstNodeId root, FILE* stream) {
+    if (!pool || !stream || !AstPool_node(pool, root)) return;
+
+    typedef struct { AstNodeId id; uint32_t next; } Frame;
+    Frame* stack = (Frame*)malloc(pool->count * sizeof(Frame));
+    if (!stack) return;
+
+    uint32_t depth = 0;
+    stack[depth++] = (Frame){ root, 0 };
+    while (depth) {
+        Frame* frame = &stack[depth - 1];
+        const AstNode* node = &pool->nodes[frame->id];
+
+        if (frame->next == 0) {
+            if (frame != stack) fputc(' ', stream);
+            if (!node->child_count) {
+                fprintf(stream, "%s#%u", AstNodeKind_toString((AstNodeKind)node->kind), node->token);
+                depth--;
+                continue;
+            }
+            bool is_operator = node->kind >= AST_NODE_PREFIX && node->kind <= AST_NODE_CONDITIONAL;
+            fprintf(stream, "(%s", is_operator ? GetOperatorString((OperatorType)node->op)
+                                               : AstNodeKind_toString((AstNodeKind)node->kind));
+        }
+
+        if (frame->next == node->child_count) {
+            fputc(')', stream);
+            depth--;
+            continue;
+        }
+
+        AstNodeId child = pool->children[node->first_child + frame->next++];
+        if (child >= pool->count || depth == pool->count) break;
+        stack[depth++] = (Frame){ child, 0 };
+    }
+    free(stack);
+}
@@ -0,0 +1,86 @@
+#ifndef AST_H
+#define AST_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define AST_POOL_INITIAL_CAPACITY 256
+
+// Nodes are addressed by index into their pool, never by pointer
+typedef uint32_t AstNodeId;
+#define AST_NODE_NONE UINT32_MAX
+
+// X(kind, "NAME")
+#define AST_NODE_KIND_LIST(X) \
+    X(AST_NODE_IDENTIFIER, "IDENTIFIER") \
+    X(AST_NODE_LITERAL, "LITERAL") \
+    X(AST_NODE_PREFIX, "PREFIX")                /* -x, *p, &v, sizeof x */ \
+    X(AST_NODE_POSTFIX, "POSTFIX")              /* x++ and x-- */ \
+    X(AST_NODE_BINARY, "BINARY")                /* Includes assignment, comma and member access */ \
+    X(AST_NODE_CONDITIONAL, "CONDITIONAL")      /* Children: condition, then, else */ \
+    X(AST_NODE_EXPRESSION_STMT, "EXPRESSION_STMT") \
+    X(AST_NODE_BLOCK, "BLOCK")                  /* Any number of statements */ \
+    X(AST_NODE_DECLARATION, "DECLARATION")
+
+typedef enum AstNodeKind {
+#define X(kind, name) kind,
+    AST_NODE_KIND_LIST(X)
+#undef X
+    AST_NODE_KIND_COUNT
+} AstNodeKind;
+
+// AstNode.flags. The parser leaves them clear; the minimizer compares
+// them, so nodes that differ in a flag are never merged.
+#define AST_FLAG_FOLDED 0x0001      // Literal computed by constant folding, see ConstantFolder
+
+// A node is 16 bytes. Children are not stored in the node but as a run
+// of ids in the pool's child array, so a node may have any number.
+typedef struct AstNode {
+    uint8_t kind;           // AstNodeKind
+    uint8_t op;             // OperatorType, for operator nodes
+    uint16_t flags;         // AST_FLAG_* bits set by later passes
+    uint32_t token;         // Index of the node's token in its token stream
+    uint32_t first_child;   // Index into AstPool.children
+    uint32_t child_count;
+} AstNode;
+
+// Contiguous storage for every node of one or more trees. Children are
+// always added before their parent, so a tree occupies a run of nodes
+// ending at its root and a linear scan visits it bottom-up. Clearing or
+// destroying the pool frees every tree in one operation.
+typedef struct AstPool {
+    AstNode* nodes;
+    uint32_t count;
+    uint32_t capacity;
+    AstNodeId* children;
+    uint32_t child_count;
+    uint32_t child_capacity;
+} AstPool;
+
+// Pool lifetime
+AstPool* AstPool_create(uint32_t capacity);
+void AstPool_destroy(AstPool* pool);
+void AstPool_clear(AstPool* pool);
+bool AstPool_reserve(AstPool* pool, uint32_t nodes, uint32_t children);
+
+// Adds a node whose children are already in the pool; returns its id
+// or AST_NODE_NONE on failure
+AstNodeId AstPool_add(AstPool* pool, AstNodeKind kind, uint8_t op, uint32_t token,
+                      const AstNodeId* children, uint32_t child_count);
+
+// Access
+static inline const AstNode* AstPool_node(const AstPool* pool, AstNodeId id) {
+    return id < pool->count ? &pool->nodes[id] : NULL;
+}
+
+static inline AstNodeId AstPool_child(const AstPool* pool, AstNodeId id, uint32_t index) {
+    const AstNode* node = AstPool_node(pool, id);
+    if (!node || index >= node->child_count) return AST_NODE_NONE;
+    return pool->children[node->first_child + index];
+}
+
+const char* AstNodeKind_toString(AstNodeKind kind);
+void AstPool_print(const AstPool* pool, AstNodeId root, FILE* stream);
+
+#endif // AST_H
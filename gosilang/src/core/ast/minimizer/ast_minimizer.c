@@ -0,0 +1,262 @@
+#include "ast_minimizer.h"
+#include "core/minimizer/bitset.h"
+#include "runtime/debug/profiler/profiler.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Minimizer lifetime
+AstMinimizer* AstMinimizer_create(const TokenBuffer* tokens) {
+    AstMinimizer* minimizer = (AstMinimizer*)calloc(1, sizeof(AstMinimizer));
+    if (!minimizer) return NULL;
+
+    minimizer->tokens = tokens;
+    minimizer->dag = AstPool_create(0);
+    minimizer->bucket_count = AST_MINIMIZER_INITIAL_BUCKETS;
+    minimizer->buckets = (AstMinimizerBucket*)malloc(minimizer->bucket_count * sizeof(AstMinimizerBucket));
+    if (!minimizer->dag || !minimizer->buckets) {
+        AstMinimizer_destroy(minimizer);
+        return NULL;
+    }
+    memset(minimizer->buckets, 0xFF, minimizer->bucket_count * sizeof(AstMinimizerBucket));
+    return minimizer;
+}
+
+void AstMinimizer_destroy(AstMinimizer* minimizer) {
+    if (!minimizer) return;
+    AstPool_destroy(minimizer->dag);
+    free(minimizer->ref_counts);
+    free(minimizer->buckets);
+    free(minimizer->canonical);
+    free(minimizer);
+}
+
+// Operators are identified by op; every other node by its token's value
+static inline bool HasValue(const AstNode* node) {
+    return node->kind < AST_NODE_PREFIX || node->kind > AST_NODE_CONDITIONAL;
+}
+
+static inline uint64_t Mix(uint64_t hash, uint64_t value) {
+    hash = (hash ^ value) * 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 29);
+}
+
+// Interned or reserved tokens hash by lexeme id, others by spelling.
+// A buffer is lexed one way throughout, so equal values hash alike.
+static uint64_t HashValue(const TokenBuffer* tokens, uint32_t token) {
+    if (!tokens || token >= tokens->count) return 0;
+
+    uint64_t hash = Mix(14695981039346656037ull, tokens->types[token]);
+    const char* value = tokens->lexemes[token] ? NULL : TokenBuffer_value(tokens, token);
+    if (!value) return Mix(hash, tokens->lexemes[token]);
+
+    for (uint32_t i = 0; i < tokens->lengths[token]; i++) {
+        hash = (hash ^ (unsigned char)value[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static bool SameValue(const TokenBuffer* tokens, uint32_t a, uint32_t b) {
+    if (a == b) return true;
+    if (!tokens || a >= tokens->count || b >= tokens->count) return false;
+    if (tokens->types[a] != tokens->types[b] || tokens->lengths[a] != tokens->lengths[b]) return false;
+    if (tokens->lexemes[a] && tokens->lexemes[b]) return tokens->lexemes[a] == tokens->lexemes[b];
+
+    const char* x = TokenBuffer_value(tokens, a);
+    const char* y = TokenBuffer_value(tokens, b);
+    if (!x || !y) return tokens->lexemes[a] == tokens->lexemes[b];
+    return memcmp(x, y, tokens->lengths[a]) == 0;
+}
+
+// Children are compared by DAG id, so equal ids mean equal subtrees
+static bool SameNode(const AstMinimizer* minimizer, AstNodeId candidate, const AstNode* node,
+                     const AstNodeId* children) {
+    const AstNode* other = &minimizer->dag->nodes[candidate];
+    if (other->kind != node->kind || other->op != node->op || other->flags != node->flags ||
+        other->child_count != node->child_count) {
+        return false;
+    }
+    if (memcmp(&minimizer->dag->children[other->first_child], children,
+               node->child_count * sizeof(AstNodeId)) != 0) {
+        return false;
+    }
+    // A folded literal's value is not its token's, so only its own token matches
+    if (node->flags & AST_FLAG_FOLDED) return other->token == node->token;
+    return !HasValue(node) || SameValue(minimizer->tokens, other->token, node->token);
+}
+
+static bool GrowBuckets(AstMinimizer* minimizer) {
+    uint32_t count = minimizer->bucket_count * 2;
+    AstMinimizerBucket* buckets = (AstMinimizerBucket*)malloc(count * sizeof(AstMinimizerBucket));
+    if (!buckets) return false;
+
+    memset(buckets, 0xFF, count * sizeof(AstMinimizerBucket));
+    for (uint32_t i = 0; i < minimizer->bucket_count; i++) {
+        AstMinimizerBucket entry = minimizer->buckets[i];
+        if (entry.node == AST_NODE_NONE) continue;
+
+        uint32_t slot = entry.hash & (count - 1);
+        while (buckets[slot].node != AST_NODE_NONE) slot = (slot + 1) & (count - 1);
+        buckets[slot] = entry;
+    }
+    free(minimizer->buckets);
+    minimizer->buckets = buckets;
+    minimizer->bucket_count = count;
+    return true;
+}
+
+static bool ReserveNodes(AstMinimizer* minimizer, uint32_t needed) {
+    if (needed <= minimizer->ref_capacity) return true;
+
+    uint32_t capacity = minimizer->ref_capacity ? minimizer->ref_capacity : AST_POOL_INITIAL_CAPACITY;
+    while (capacity < needed) {
+        capacity = capacity > UINT32_MAX / 2 ? needed : capacity * 2;
+    }
+    uint32_t* ref_counts = (uint32_t*)realloc(minimizer->ref_counts, capacity * sizeof(uint32_t));
+    if (!ref_counts) return false;
+    minimizer->ref_counts = ref_counts;
+    minimizer->ref_capacity = capacity;
+    return true;
+}
+
+// Returns the DAG node equal to node, whose children are already
+// mapped to DAG ids, adding it if it is new
+static AstNodeId Intern(AstMinimizer* minimizer, const AstNode* node, const AstNodeId* children) {
+    uint64_t full = Mix(Mix(node->kind, node->op), node->child_count);
+    for (uint32_t i = 0; i < node->child_count; i++) {
+        full = Mix(full, children[i]);
+    }
+    if (HasValue(node)) full = Mix(full, HashValue(minimizer->tokens, node->token));
+    uint32_t hash = (uint32_t)(full ^ (full >> 32));
+
+    uint32_t mask = minimizer->bucket_count - 1;
+    uint32_t slot = hash & mask;
+    for (; minimizer->buckets[slot].node != AST_NODE_NONE; slot = (slot + 1) & mask) {
+        AstMinimizerBucket entry = minimizer->buckets[slot];
+        if (entry.hash == hash && SameNode(minimizer, entry.node, node, children)) {
+            return entry.node;
+        }
+    }
+
+    if (!ReserveNodes(minimizer, minimizer->dag->count + 1)) return AST_NODE_NONE;
+    AstNodeId id = AstPool_add(minimizer->dag, (AstNodeKind)node->kind, node->op, node->token,
+                               children, node->child_count);
+    if (id == AST_NODE_NONE) return AST_NODE_NONE;
+    minimizer->dag->nodes[id].flags = node->flags;
+
+    minimizer->ref_counts[id] = 0;
+    for (uint32_t i = 0; i < node->child_count; i++) {
+        minimizer->ref_counts[children[i]]++;
+    }
+    minimizer->buckets[slot] = (AstMinimizerBucket){ id, hash };
+    if (minimizer->dag->count * 2 > minimizer->bucket_count && !GrowBuckets(minimizer)) {
+        return AST_NODE_NONE;
+    }
+    return id;
+}
+
+// Empties a slot without breaking later probe runs: entries that
+// probed past it move back unless that would put them before their
+// home slot
+static void RemoveBucket(AstMinimizer* minimizer, uint32_t slot) {
+    uint32_t mask = minimizer->bucket_count - 1;
+    for (uint32_t next = (slot + 1) & mask; minimizer->buckets[next].node != AST_NODE_NONE;
+         next = (next + 1) & mask) {
+        uint32_t home = minimizer->buckets[next].hash & mask;
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            minimizer->buckets[slot] = minimizer->buckets[next];
+            slot = next;
+        }
+    }
+    minimizer->buckets[slot].node = AST_NODE_NONE;
+}
+
+// Undoes a failed addPool: drops the DAG nodes it added, their table
+// entries and the references they held on older nodes
+static void Rollback(AstMinimizer* minimizer, uint32_t dag_count, uint32_t child_count) {
+    AstPool* dag = minimizer->dag;
+    for (AstNodeId id = dag_count; id < dag->count; id++) {
+        const AstNode* node = &dag->nodes[id];
+        for (uint32_t i = 0; i < node->child_count; i++) {
+            AstNodeId child = dag->children[node->first_child + i];
+            if (child < dag_count) minimizer->ref_counts[child]--;
+        }
+    }
+
+    // A removal can pull a later entry back into the slot, so it is checked again
+    for (uint32_t slot = 0; slot < minimizer->bucket_count; slot++) {
+        while (minimizer->buckets[slot].node != AST_NODE_NONE && minimizer->buckets[slot].node >= dag_count) {
+            RemoveBucket(minimizer, slot);
+        }
+    }
+    dag->count = dag_count;
+    dag->child_count = child_count;
+}
+
+// Input nodes always follow their children, so one forward pass sees
+// every child's DAG id before its parent is hashed
+bool AstMinimizer_addPool(AstMinimizer* minimizer, const AstPool* input) {
+    if (!minimizer || !input) return false;
+    PROFILE_SCOPE(PROFILE_TIMER_MINIMIZE);
+    uint32_t dag_count = minimizer->dag->count;
+    uint32_t child_count = minimizer->dag->child_count;
+
+    if (input->count > minimizer->canonical_capacity) {
+        AstNodeId* canonical = (AstNodeId*)realloc(minimizer->canonical, input->count * sizeof(AstNodeId));
+        if (!canonical) return false;
+        minimizer->canonical = canonical;
+        minimizer->canonical_capacity = input->count;
+    }
+    minimizer->input_count = 0;
+
+    // Mapped children are written over a scratch run in the input's
+    // child order; the largest child list bounds its size
+    uint32_t widest = 0;
+    for (AstNodeId id = 0; id < input->count; id++) {
+        if (input->nodes[id].child_count > widest) widest = input->nodes[id].child_count;
+    }
+    AstNodeId* children = (AstNodeId*)malloc((widest ? widest : 1) * sizeof(AstNodeId));
+    Bitset* has_parent = Bitset_create(input->count);
+    bool ok = children && has_parent;
+
+    for (AstNodeId id = 0; ok && id < input->count; id++) {
+        const AstNode* node = &input->nodes[id];
+        for (uint32_t i = 0; i < node->child_count; i++) {
+            AstNodeId child = input->children[node->first_child + i];
+            if (child >= id) {
+                ok = false;
+                break;
+            }
+            children[i] = minimizer->canonical[child];
+            Bitset_set(has_parent, child);
+        }
+        if (!ok) break;
+
+        AstNodeId canonical = Intern(minimizer, node, children);
+        ok = canonical != AST_NODE_NONE;
+        minimizer->canonical[id] = canonical;
+    }
+
+    if (ok) {
+        minimizer->input_count = input->count;
+        for (AstNodeId id = 0; id < input->count; id++) {
+            if (!Bitset_test(has_parent, id)) minimizer->ref_counts[minimizer->canonical[id]]++;
+        }
+    } else {
+        Rollback(minimizer, dag_count, child_count);
+    }
+    Bitset_destroy(has_parent);
+    free(children);
+    PROFILE_COUNT(PROFILE_COUNTER_DAG_NODES, minimizer->dag->count - dag_count);
+    return ok;
+}
+
+// Reference counting
+void AstMinimizer_retain(AstMinimizer* minimizer, AstNodeId node) {
+    if (minimizer && node < minimizer->dag->count) minimizer->ref_counts[node]++;
+}
+
+void AstMinimizer_release(AstMinimizer* minimizer, AstNodeId node) {
+    if (minimizer && node < minimizer->dag->count && minimizer->ref_counts[node]) {
+        minimizer->ref_counts[node]--;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef AST_MINIMIZER_H
+#define AST_MINIMIZER_H
+
+#include "core/ast/ast.h"
+#include "core/tokenizer/symbols/sym_buffer.h"
+
+#define AST_MINIMIZER_INITIAL_BUCKETS 1024
+
+// Hash-consing: structurally identical subtrees (same kind, operator,
+// leaf value and children) become one node of a DAG. Pools added to a
+// minimizer must index the token buffer it was created with, since leaf
+// values are compared through it.
+//
+// Each DAG node counts its references: one per parent in the DAG plus
+// one per input tree whose root it is. A node with more than one
+// reference stands for several subtrees of the input, so a pass that
+// rewrites it in place must copy it first.
+
+// Hash table slot; the hash is kept beside the id so a probe reads
+// the DAG only on a likely match
+typedef struct AstMinimizerBucket {
+    AstNodeId node;         // AST_NODE_NONE when empty
+    uint32_t hash;
+} AstMinimizerBucket;
+
+typedef struct AstMinimizer {
+    AstPool* dag;           // Unique nodes; children refer to this pool
+    uint32_t* ref_counts;   // Per DAG node
+    uint32_t ref_capacity;
+
+    AstMinimizerBucket* buckets;    // Open addressing with linear probing
+    uint32_t bucket_count;  // A power of two, kept at most half full
+
+    AstNodeId* canonical;   // Last added pool: input node -> DAG node
+    uint32_t canonical_capacity;
+    uint32_t input_count;
+
+    const TokenBuffer* tokens;
+} AstMinimizer;
+
+// Minimizer lifetime
+AstMinimizer* AstMinimizer_create(const TokenBuffer* tokens);
+void AstMinimizer_destroy(AstMinimizer* minimizer);
+
+// Adds every tree of input to the DAG, bottom-up in one pass. On failure
+// the DAG, reference counts and hash table are as they were before the
+// call and no pool is mapped, so the minimizer stays usable.
+bool AstMinimizer_addPool(AstMinimizer* minimizer, const AstPool* input);
+
+// The DAG node an input node of the last added pool collapsed into
+static inline AstNodeId AstMinimizer_canonical(const AstMinimizer* minimizer, AstNodeId input) {
+    return input < minimizer->input_count ? minimizer->canonical[input] : AST_NODE_NONE;
+}
+
+static inline uint32_t AstMinimizer_refCount(const AstMinimizer* minimizer, AstNodeId node) {
+    return node < minimizer->dag->count ? minimizer->ref_counts[node] : 0;
+}
+
+static inline bool AstMinimizer_isShared(const AstMinimizer* minimizer, AstNodeId node) {
+    return AstMinimizer_refCount(minimizer, node) > 1;
+}
+
+// Reference counting for passes that hold on to or drop DAG nodes
+void AstMinimizer_retain(AstMinimizer* minimizer, AstNodeId node);
+void AstMinimizer_release(AstMinimizer* minimizer, AstNodeId node);
+
+#endif // AST_MINIMIZER_H
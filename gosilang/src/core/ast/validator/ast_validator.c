@@ -0,0 +1,348 @@
+#include "ast_validator.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const ast_diagnostic_messages[AST_DIAGNOSTIC_COUNT] = {
+#define X(code, message) [code] = message,
+    AST_DIAGNOSTIC_LIST(X)
+#undef X
+};
+
+// State shared by every job of one AstValidator_run
+typedef struct ValidationRun {
+    const AstPool* ast;
+    const TokenBuffer* tokens;
+    WorkPool* pool;
+    WorkGroup group;
+    bool allow_shared;
+    atomic_uint_fast64_t* visited;      // One bit per node
+    _Atomic(struct ValidationJob*) jobs;
+    atomic_bool failed;
+} ValidationRun;
+
+// Either a run of roots or, once split off, a single subtree. Jobs are
+// kept on run->jobs after they finish so their diagnostics can be merged.
+typedef struct ValidationJob {
+    WorkTask task;
+    ValidationRun* run;
+    const AstNodeId* roots;
+    uint32_t root_count;
+    AstNodeId subtree;
+    AstDiagnostic* diagnostics;
+    uint32_t diagnostic_count;
+    uint32_t diagnostic_capacity;
+    struct ValidationJob* next;
+} ValidationJob;
+
+// Validator lifetime
+AstValidator* AstValidator_create(WorkPool* pool) {
+    AstValidator* validator = (AstValidator*)calloc(1, sizeof(AstValidator));
+    if (!validator) return NULL;
+    validator->pool = pool;
+    return validator;
+}
+
+void AstValidator_destroy(AstValidator* validator) {
+    if (!validator) return;
+    free(validator->diagnostics);
+    free(validator);
+}
+
+const char* AstDiagnosticCode_toString(AstDiagnosticCode code) {
+    return (unsigned)code < AST_DIAGNOSTIC_COUNT ? ast_diagnostic_messages[code] : "unknown diagnostic";
+}
+
+// Node checks
+
+static void Report(ValidationJob* job, AstNodeId node, uint32_t token, AstDiagnosticCode code) {
+    if (job->diagnostic_count == job->diagnostic_capacity) {
+        uint32_t capacity = job->diagnostic_capacity ? job->diagnostic_capacity * 2 : 16;
+        AstDiagnostic* grown = (AstDiagnostic*)realloc(job->diagnostics, capacity * sizeof(AstDiagnostic));
+        if (!grown) {
+            atomic_store(&job->run->failed, true);
+            return;
+        }
+        job->diagnostics = grown;
+        job->diagnostic_capacity = capacity;
+    }
+    job->diagnostics[job->diagnostic_count++] = (AstDiagnostic){ node, token, (uint32_t)code };
+}
+
+// Marks node visited; false if some job got there first
+static inline bool Visit(ValidationRun* run, AstNodeId node) {
+    uint64_t bit = 1ull << (node & 63);
+    return !(atomic_fetch_or_explicit(&run->visited[node >> 6], bit, memory_order_relaxed) & bit);
+}
+
+static bool ArityMatches(AstNodeKind kind, uint32_t child_count) {
+    switch (kind) {
+        case AST_NODE_IDENTIFIER:
+        case AST_NODE_LITERAL:
+            return child_count == 0;
+        case AST_NODE_PREFIX:
+        case AST_NODE_POSTFIX:
+        case AST_NODE_EXPRESSION_STMT:
+            return child_count == 1;
+        case AST_NODE_BINARY:
+            return child_count == 2;
+        case AST_NODE_CONDITIONAL:
+            return child_count == 3;
+        default:
+            return true;
+    }
+}
+
+static bool IsLiteral(TokenType type) {
+    switch (type) {
+        case TOKEN_LITERAL_VALUE:
+        case TOKEN_LITERAL_STRING:
+        case TOKEN_LITERAL_CHAR:
+        case TOKEN_LITERAL_INTEGER:
+        case TOKEN_LITERAL_FLOAT:
+        case TOKEN_LITERAL_BOOL:
+        case TOKEN_LITERAL_NULL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool OperatorFits(AstNodeKind kind, OperatorType op) {
+    switch (kind) {
+        case AST_NODE_PREFIX: return OperatorType_hasForm(op, OP_FORM_PREFIX);
+        case AST_NODE_POSTFIX: return OperatorType_hasForm(op, OP_FORM_POSTFIX);
+        case AST_NODE_CONDITIONAL: return OperatorType_hasForm(op, OP_FORM_TERNARY);
+        default: return OperatorType_hasForm(op, OP_FORM_INFIX);
+    }
+}
+
+// The operator the parser would have read from the token, with * and &
+// in prefix position read as dereference and address-of
+static bool TokenReadsAs(const TokenBuffer* tokens, uint32_t token, AstNodeKind kind, OperatorType op) {
+    if (op == OP_SIZEOF) return tokens->types[token] == TOKEN_EXPR_SIZEOF;
+
+    OperatorType read;
+    if (!Lexeme_toOperator(tokens->lexemes[token], &read)) return false;
+    if (kind == AST_NODE_PREFIX) {
+        if (read == OP_MULTIPLY) read = OP_DEREFERENCE;
+        if (read == OP_BITWISE_AND) read = OP_ADDRESS_OF;
+    }
+    return read == op;
+}
+
+static void CheckToken(ValidationJob* job, AstNodeId id, const AstNode* node) {
+    const TokenBuffer* tokens = job->run->tokens;
+    AstNodeKind kind = (AstNodeKind)node->kind;
+    bool is_operator = kind >= AST_NODE_PREFIX && kind <= AST_NODE_CONDITIONAL;
+
+    if (is_operator && (node->op >= OPERATOR_TYPE_COUNT || !OperatorFits(kind, (OperatorType)node->op))) {
+        Report(job, id, node->token, AST_DIAG_OPERATOR);
+        return;
+    }
+    if (!is_operator && kind != AST_NODE_IDENTIFIER && kind != AST_NODE_LITERAL) return;
+    if (!tokens) return;
+    if (node->token >= tokens->count) {
+        Report(job, id, node->token, AST_DIAG_TOKEN_RANGE);
+        return;
+    }
+
+    TokenType type = (TokenType)tokens->types[node->token];
+    if (kind == AST_NODE_IDENTIFIER && type != TOKEN_LITERAL_IDENTIFIER) {
+        Report(job, id, node->token, AST_DIAG_TOKEN_KIND);
+    } else if (kind == AST_NODE_LITERAL && !(node->flags & AST_FLAG_FOLDED) && !IsLiteral(type)) {
+        Report(job, id, node->token, AST_DIAG_TOKEN_KIND);
+    } else if (is_operator && !TokenReadsAs(tokens, node->token, kind, (OperatorType)node->op)) {
+        Report(job, id, node->token, AST_DIAG_OPERATOR_TOKEN);
+    }
+}
+
+// Checks one node; returns whether its children can be followed
+static bool CheckNode(ValidationJob* job, AstNodeId id, const AstNode* node) {
+    const AstPool* ast = job->run->ast;
+    if (node->kind >= AST_NODE_KIND_COUNT) {
+        Report(job, id, node->token, AST_DIAG_UNKNOWN_KIND);
+    } else {
+        if (!ArityMatches((AstNodeKind)node->kind, node->child_count)) {
+            Report(job, id, node->token, AST_DIAG_ARITY);
+        }
+        CheckToken(job, id, node);
+    }
+
+    if (node->first_child > ast->child_count || node->child_count > ast->child_count - node->first_child) {
+        Report(job, id, node->token, AST_DIAG_CHILD_RANGE);
+        return false;
+    }
+    return true;
+}
+
+// Jobs
+
+static void RunJob(void* data);
+
+static ValidationJob* Spawn(ValidationRun* run, const AstNodeId* roots, uint32_t root_count, AstNodeId subtree) {
+    ValidationJob* job = (ValidationJob*)calloc(1, sizeof(ValidationJob));
+    if (!job) {
+        atomic_store(&run->failed, true);
+        return NULL;
+    }
+    job->run = run;
+    job->subtree = subtree;
+    job->roots = roots ? roots : &job->subtree;
+    job->root_count = roots ? root_count : 1;
+    WorkTask_init(&job->task, RunJob, job);
+
+    job->next = atomic_load_explicit(&run->jobs, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&run->jobs, &job->next, job,
+                                                  memory_order_release, memory_order_relaxed)) {
+    }
+    if (run->pool) WorkPool_submit(run->pool, &run->group, &job->task);
+    return job;
+}
+
+// Depth-first over each root. Children are pushed last first so they
+// are checked in order; after every AST_VALIDATOR_SPLIT_NODES nodes the
+// oldest pending subtree, usually the largest, becomes its own job.
+static void RunJob(void* data) {
+    ValidationJob* job = (ValidationJob*)data;
+    ValidationRun* run = job->run;
+    const AstPool* ast = run->ast;
+
+    // Halving leaves the upper roots for idle threads to steal
+    while (run->pool && job->root_count > AST_VALIDATOR_ROOT_GRAIN) {
+        uint32_t half = job->root_count / 2;
+        job->root_count -= half;
+        Spawn(run, job->roots + job->root_count, half, AST_NODE_NONE);
+    }
+
+    AstNodeId* stack = NULL;
+    uint32_t bottom = 0, top = 0, capacity = 0, checked = 0;
+    for (uint32_t r = 0; r < job->root_count; r++) {
+        AstNodeId root = job->roots[r];
+        if (root >= ast->count) {
+            Report(job, root, UINT32_MAX, AST_DIAG_NODE_RANGE);
+            continue;
+        }
+
+        bottom = top = 0;
+        AstNodeId id = root;
+        for (;;) {
+            const AstNode* node = &ast->nodes[id];
+            if (!Visit(run, id)) {
+                if (!run->allow_shared) Report(job, id, node->token, AST_DIAG_SHARED);
+            } else if (CheckNode(job, id, node) && node->child_count) {
+                if (top + node->child_count > capacity) {
+                    uint32_t grown = capacity ? capacity : 64;
+                    while (grown < top + node->child_count) grown *= 2;
+                    AstNodeId* resized = (AstNodeId*)realloc(stack, grown * sizeof(AstNodeId));
+                    if (!resized) {
+                        atomic_store(&run->failed, true);
+                        break;
+                    }
+                    stack = resized;
+                    capacity = grown;
+                }
+                for (uint32_t i = node->child_count; i-- > 0;) {
+                    AstNodeId child = ast->children[node->first_child + i];
+                    if (child >= id) {
+                        Report(job, id, node->token, AST_DIAG_CHILD_ORDER);
+                    } else {
+                        stack[top++] = child;
+                    }
+                }
+            }
+
+            if (++checked >= AST_VALIDATOR_SPLIT_NODES && run->pool && top - bottom > 1) {
+                Spawn(run, NULL, 0, stack[bottom++]);
+                checked = 0;
+            }
+            if (top == bottom) break;
+            id = stack[--top];
+        }
+    }
+    free(stack);
+}
+
+static int CompareDiagnostics(const void* a, const void* b) {
+    const AstDiagnostic* x = (const AstDiagnostic*)a;
+    const AstDiagnostic* y = (const AstDiagnostic*)b;
+    if (x->node != y->node) return x->node < y->node ? -1 : 1;
+    if (x->code != y->code) return x->code < y->code ? -1 : 1;
+    return 0;
+}
+
+// Concatenates every job's diagnostics and sorts them. Each node is
+// checked exactly once and each extra parent of a node reports it once,
+// so the sorted list does not depend on which thread ran what.
+static bool Merge(AstValidator* validator, ValidationJob* jobs) {
+    uint64_t total = 0;
+    for (ValidationJob* job = jobs; job; job = job->next) {
+        total += job->diagnostic_count;
+    }
+    if (total > UINT32_MAX) return false;
+    if (total > validator->diagnostic_capacity) {
+        AstDiagnostic* grown = (AstDiagnostic*)realloc(validator->diagnostics, total * sizeof(AstDiagnostic));
+        if (!grown) return false;
+        validator->diagnostics = grown;
+        validator->diagnostic_capacity = (uint32_t)total;
+    }
+
+    uint32_t count = 0;
+    for (ValidationJob* job = jobs; job; job = job->next) {
+        if (!job->diagnostic_count) continue;
+        memcpy(&validator->diagnostics[count], job->diagnostics, job->diagnostic_count * sizeof(AstDiagnostic));
+        count += job->diagnostic_count;
+    }
+    if (count) qsort(validator->diagnostics, count, sizeof(AstDiagnostic), CompareDiagnostics);
+    validator->diagnostic_count = count;
+    return true;
+}
+
+bool AstValidator_run(AstValidator* validator, const AstPool* ast, const TokenBuffer* tokens,
+                      const AstNodeId* roots, uint32_t root_count) {
+    if (!validator || !ast || (!roots && root_count)) return false;
+    validator->diagnostic_count = 0;
+    if (!root_count) return true;
+
+    // A pool of one thread would only add scheduling to a serial run
+    WorkPool* pool = WorkPool_threadCount(validator->pool) > 1 ? validator->pool : NULL;
+    ValidationRun run = { .ast = ast, .tokens = tokens, .pool = pool,
+                          .allow_shared = validator->allow_shared };
+    WorkGroup_init(&run.group);
+    atomic_init(&run.jobs, NULL);
+    atomic_init(&run.failed, false);
+    run.visited = (atomic_uint_fast64_t*)calloc((ast->count + 63) / 64 + 1, sizeof(atomic_uint_fast64_t));
+    if (!run.visited) return false;
+
+    ValidationJob* first = Spawn(&run, roots, root_count, AST_NODE_NONE);
+    if (run.pool) {
+        WorkPool_wait(run.pool, &run.group);
+    } else if (first) {
+        RunJob(first);
+    }
+
+    ValidationJob* jobs = atomic_load(&run.jobs);
+    bool ok = !atomic_load(&run.failed) && Merge(validator, jobs);
+    while (jobs) {
+        ValidationJob* next = jobs->next;
+        free(jobs->diagnostics);
+        free(jobs);
+        jobs = next;
+    }
+    free((void*)run.visited);
+    if (!ok) validator->diagnostic_count = 0;
+    return ok;
+}
+
+void AstValidator_print(const AstValidator* validator, const TokenBuffer* tokens, FILE* stream) {
+    if (!validator || !stream) return;
+
+    for (uint32_t i = 0; i < validator->diagnostic_count; i++) {
+        const AstDiagnostic* diagnostic = &validator->diagnostics[i];
+        fprintf(stream, "node %u", diagnostic->node);
+        if (tokens && diagnostic->token < tokens->count) {
+            fprintf(stream, " (token %u at offset %u)", diagnostic->token, tokens->offsets[diagnostic->token]);
+        }
+        fprintf(stream, ": %s\n", AstDiagnosticCode_toString((AstDiagnosticCode)diagnostic->code));
+    }
+}
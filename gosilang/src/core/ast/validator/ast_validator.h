@@ -0,0 +1,69 @@
+#ifndef AST_VALIDATOR_H
+#define AST_VALIDATOR_H
+
+#include "core/ast/ast.h"
+#include "core/tokenizer/symbols/sym_buffer.h"
+#include "runtime/concurrency/pool/work_pool.h"
+
+// Roots per job before a job hands half of its roots to another
+#define AST_VALIDATOR_ROOT_GRAIN 32
+// Nodes a job checks before it offers a pending subtree to other threads
+#define AST_VALIDATOR_SPLIT_NODES 2048
+
+// X(code, "message")
+#define AST_DIAGNOSTIC_LIST(X) \
+    X(AST_DIAG_NODE_RANGE, "node id outside the pool") \
+    X(AST_DIAG_UNKNOWN_KIND, "unknown node kind") \
+    X(AST_DIAG_ARITY, "wrong number of children for the node kind") \
+    X(AST_DIAG_CHILD_RANGE, "children outside the pool's child array") \
+    X(AST_DIAG_CHILD_ORDER, "child does not precede its parent") \
+    X(AST_DIAG_SHARED, "node has more than one parent") \
+    X(AST_DIAG_TOKEN_RANGE, "token index outside the token stream") \
+    X(AST_DIAG_TOKEN_KIND, "token does not match the node kind") \
+    X(AST_DIAG_OPERATOR, "operator not valid for the node kind") \
+    X(AST_DIAG_OPERATOR_TOKEN, "operator does not match its token")
+
+typedef enum AstDiagnosticCode {
+#define X(code, message) code,
+    AST_DIAGNOSTIC_LIST(X)
+#undef X
+    AST_DIAGNOSTIC_COUNT
+} AstDiagnosticCode;
+
+typedef struct AstDiagnostic {
+    AstNodeId node;
+    uint32_t token;         // The node's token, UINT32_MAX if the node has none
+    uint32_t code;          // AstDiagnosticCode
+} AstDiagnostic;
+
+// Checks that trees agree with the token stream they were parsed from:
+// every node has a known kind and the arity that kind requires,
+// children precede their parents, leaves carry identifier or literal
+// tokens and operator nodes carry a token that reads as their operator.
+//
+// Each root is an independent job on the work pool, and a job that
+// runs long hands pending subtrees to idle threads. Diagnostics are
+// sorted by node and code once every job is done, so the output is the
+// same for any number of threads.
+typedef struct AstValidator {
+    WorkPool* pool;         // Not owned; NULL validates on the calling thread
+    bool allow_shared;      // Accept DAGs, such as an AstMinimizer's
+
+    AstDiagnostic* diagnostics;
+    uint32_t diagnostic_count;
+    uint32_t diagnostic_capacity;
+} AstValidator;
+
+// Validator lifetime
+AstValidator* AstValidator_create(WorkPool* pool);
+void AstValidator_destroy(AstValidator* validator);
+
+// Validates the trees under roots, replacing earlier diagnostics.
+// Returns false only if memory ran out.
+bool AstValidator_run(AstValidator* validator, const AstPool* ast, const TokenBuffer* tokens,
+                      const AstNodeId* roots, uint32_t root_count);
+
+const char* AstDiagnosticCode_toString(AstDiagnosticCode code);
+void AstValidator_print(const AstValidator* validator, const TokenBuffer* tokens, FILE* stream);
+
+#endif // AST_VALIDATOR_H
@@ -0,0 +1,140 @@
+#include "bitset.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Set lifetime
+Bitset* Bitset_create(uint32_t size) {
+    Bitset* set = (Bitset*)calloc(1, sizeof(Bitset));
+    if (!set) return NULL;
+
+    uint32_t blocks = (uint32_t)(((uint64_t)size + BITSET_BLOCK_BITS - 1) / BITSET_BLOCK_BITS);
+    set->size = size;
+    set->word_count = (blocks ? blocks : 1) * BITSET_BLOCK_WORDS;
+    set->words = (uint64_t*)aligned_alloc(32, set->word_count * sizeof(uint64_t));
+    if (!set->words) {
+        free(set);
+        return NULL;
+    }
+    Bitset_clear(set);
+    return set;
+}
+
+void Bitset_destroy(Bitset* set) {
+    if (!set) return;
+    free(set->words);
+    free(set);
+}
+
+Bitset* Bitset_clone(const Bitset* set) {
+    if (!set) return NULL;
+
+    Bitset* clone = Bitset_create(set->size);
+    if (clone) Bitset_copy(clone, set);
+    return clone;
+}
+
+// Whole-set operations. The loops step a block at a time so the
+// compiler turns each into full-width vector code.
+void Bitset_clear(Bitset* set) {
+    memset(set->words, 0, set->word_count * sizeof(uint64_t));
+}
+
+void Bitset_fill(Bitset* set) {
+    memset(set->words, 0xFF, set->word_count * sizeof(uint64_t));
+
+    // Keep the padding clear so counts and comparisons stay exact
+    uint32_t used = set->size >> 6;
+    if (set->size & 63) set->words[used++] = (1ull << (set->size & 63)) - 1;
+    memset(set->words + used, 0, (set->word_count - used) * sizeof(uint64_t));
+}
+
+void Bitset_copy(Bitset* dst, const Bitset* src) {
+    memcpy(dst->words, src->words, dst->word_count * sizeof(uint64_t));
+}
+
+void Bitset_union(Bitset* dst, const Bitset* src) {
+    uint64_t* restrict d = dst->words;
+    const uint64_t* restrict s = src->words;
+    for (uint32_t i = 0; i < dst->word_count; i += BITSET_BLOCK_WORDS) {
+        d[i] |= s[i];
+        d[i + 1] |= s[i + 1];
+        d[i + 2] |= s[i + 2];
+        d[i + 3] |= s[i + 3];
+    }
+}
+
+void Bitset_intersect(Bitset* dst, const Bitset* src) {
+    uint64_t* restrict d = dst->words;
+    const uint64_t* restrict s = src->words;
+    for (uint32_t i = 0; i < dst->word_count; i += BITSET_BLOCK_WORDS) {
+        d[i] &= s[i];
+        d[i + 1] &= s[i + 1];
+        d[i + 2] &= s[i + 2];
+        d[i + 3] &= s[i + 3];
+    }
+}
+
+void Bitset_subtract(Bitset* dst, const Bitset* src) {
+    uint64_t* restrict d = dst->words;
+    const uint64_t* restrict s = src->words;
+    for (uint32_t i = 0; i < dst->word_count; i += BITSET_BLOCK_WORDS) {
+        d[i] &= ~s[i];
+        d[i + 1] &= ~s[i + 1];
+        d[i + 2] &= ~s[i + 2];
+        d[i + 3] &= ~s[i + 3];
+    }
+}
+
+// Queries
+bool Bitset_isEmpty(const Bitset* set) {
+    const uint64_t* w = set->words;
+    for (uint32_t i = 0; i < set->word_count; i += BITSET_BLOCK_WORDS) {
+        if (w[i] | w[i + 1] | w[i + 2] | w[i + 3]) return false;
+    }
+    return true;
+}
+
+bool Bitset_equals(const Bitset* a, const Bitset* b) {
+    return a->size == b->size &&
+           memcmp(a->words, b->words, a->word_count * sizeof(uint64_t)) == 0;
+}
+
+bool Bitset_intersects(const Bitset* a, const Bitset* b) {
+    const uint64_t* x = a->words;
+    const uint64_t* y = b->words;
+    for (uint32_t i = 0; i < a->word_count; i += BITSET_BLOCK_WORDS) {
+        if ((x[i] & y[i]) | (x[i + 1] & y[i + 1]) | (x[i + 2] & y[i + 2]) | (x[i + 3] & y[i + 3])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t Bitset_count(const Bitset* set) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < set->word_count; i++) {
+        count += (uint32_t)__builtin_popcountll(set->words[i]);
+    }
+    return count;
+}
+
+uint32_t Bitset_next(const Bitset* set, uint32_t from) {
+    if (from >= set->size) return BITSET_NONE;
+
+    uint32_t i = from >> 6;
+    uint64_t word = set->words[i] & (~0ull << (from & 63));
+    while (!word) {
+        if (++i == set->word_count) return BITSET_NONE;
+        word = set->words[i];
+    }
+    return (i << 6) + (uint32_t)__builtin_ctzll(word);
+}
+
+// FNV-1a over the words; equal sets always hash equal
+uint64_t Bitset_hash(const Bitset* set) {
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t i = 0; i < set->word_count; i++) {
+        hash = (hash ^ set->words[i]) * 1099511628211ull;
+    }
+    return hash;
+}
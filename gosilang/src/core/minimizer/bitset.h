@@ -0,0 +1,56 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define BITSET_NONE UINT32_MAX
+
+// Words are allocated in 256-bit blocks, 32-byte aligned, so every bulk
+// operation runs over whole blocks with no scalar tail and vectorizes.
+#define BITSET_BLOCK_WORDS 4
+#define BITSET_BLOCK_BITS (64 * BITSET_BLOCK_WORDS)
+
+// Fixed-size set of states 0..size-1. Bits past size are always clear.
+typedef struct Bitset {
+    uint64_t* words;
+    uint32_t size;
+    uint32_t word_count;    // A multiple of BITSET_BLOCK_WORDS
+} Bitset;
+
+// Set lifetime
+Bitset* Bitset_create(uint32_t size);
+void Bitset_destroy(Bitset* set);
+Bitset* Bitset_clone(const Bitset* set);
+
+// Single bits
+static inline void Bitset_set(Bitset* set, uint32_t bit) {
+    set->words[bit >> 6] |= 1ull << (bit & 63);
+}
+
+static inline void Bitset_reset(Bitset* set, uint32_t bit) {
+    set->words[bit >> 6] &= ~(1ull << (bit & 63));
+}
+
+static inline bool Bitset_test(const Bitset* set, uint32_t bit) {
+    return (set->words[bit >> 6] >> (bit & 63)) & 1;
+}
+
+// Whole-set operations. Binary operations require equal sizes.
+void Bitset_clear(Bitset* set);
+void Bitset_fill(Bitset* set);
+void Bitset_copy(Bitset* dst, const Bitset* src);
+void Bitset_union(Bitset* dst, const Bitset* src);
+void Bitset_intersect(Bitset* dst, const Bitset* src);
+void Bitset_subtract(Bitset* dst, const Bitset* src);
+
+// Queries
+bool Bitset_isEmpty(const Bitset* set);
+bool Bitset_equals(const Bitset* a, const Bitset* b);
+bool Bitset_intersects(const Bitset* a, const Bitset* b);
+uint32_t Bitset_count(const Bitset* set);
+uint32_t Bitset_next(const Bitset* set, uint32_t from);    // BITSET_NONE past the last
+uint64_t Bitset_hash(const Bitset* set);                   // For keying sets in hash tables
+
+#endif // BITSET_H
@@ -0,0 +1,137 @@
+#include "dfa.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Automaton lifetime
+Dfa* Dfa_create(uint32_t state_count, uint32_t symbol_count) {
+    if (state_count == 0 || state_count == DFA_NO_STATE) return NULL;
+    if (symbol_count && state_count > SIZE_MAX / sizeof(uint32_t) / symbol_count) return NULL;
+
+    Dfa* dfa = (Dfa*)calloc(1, sizeof(Dfa));
+    if (!dfa) return NULL;
+
+    size_t cells = (size_t)state_count * symbol_count;
+    dfa->state_count = state_count;
+    dfa->symbol_count = symbol_count;
+    dfa->transitions = (uint32_t*)malloc((cells ? cells : 1) * sizeof(uint32_t));
+    dfa->accepts = (uint32_t*)calloc(state_count, sizeof(uint32_t));
+    if (!dfa->transitions || !dfa->accepts) {
+        Dfa_destroy(dfa);
+        return NULL;
+    }
+    memset(dfa->transitions, 0xFF, cells * sizeof(uint32_t));
+    return dfa;
+}
+
+void Dfa_destroy(Dfa* dfa) {
+    if (!dfa) return;
+    free(dfa->transitions);
+    free(dfa->accepts);
+    free(dfa);
+}
+
+// Byte classes
+void ByteClasses_identity(ByteClasses* classes) {
+    if (!classes) return;
+    for (int b = 0; b < DFA_BYTE_SYMBOLS; b++) {
+        classes->map[b] = (uint8_t)b;
+        classes->representative[b] = (uint8_t)b;
+    }
+    classes->count = DFA_BYTE_SYMBOLS;
+}
+
+// Symbols past the automaton's alphabet have no transitions anywhere
+static inline uint32_t ByteTarget(const Dfa* dfa, uint32_t state, uint32_t byte) {
+    return byte < dfa->symbol_count ? Dfa_next(dfa, state, byte) : DFA_NO_STATE;
+}
+
+static bool SameColumn(const Dfa* dfa, uint32_t a, uint32_t b) {
+    for (uint32_t s = 0; s < dfa->state_count; s++) {
+        if (ByteTarget(dfa, s, a) != ByteTarget(dfa, s, b)) return false;
+    }
+    return true;
+}
+
+// Groups bytes by column hash, comparing whole columns only if verify
+static void AssignClasses(ByteClasses* classes, const Dfa* dfa, const uint64_t* hashes, bool verify) {
+    classes->count = 0;
+    for (uint32_t b = 0; b < DFA_BYTE_SYMBOLS; b++) {
+        uint32_t c = 0;
+        while (c < classes->count) {
+            uint32_t other = classes->representative[c];
+            if (hashes[other] == hashes[b] && (!verify || SameColumn(dfa, other, b))) break;
+            c++;
+        }
+        if (c == classes->count) classes->representative[classes->count++] = (uint8_t)b;
+        classes->map[b] = (uint8_t)c;
+    }
+}
+
+// Two bytes share a class when their columns of the transition table
+// are identical. Columns are hashed in one row-order pass, bytes are
+// grouped by hash and a second row-order pass confirms each group; a
+// hash collision falls back to comparing columns directly.
+bool ByteClasses_fromDfa(ByteClasses* classes, const Dfa* dfa) {
+    if (!classes || !dfa || dfa->symbol_count > DFA_BYTE_SYMBOLS) return false;
+
+    uint64_t hashes[DFA_BYTE_SYMBOLS];
+    for (int b = 0; b < DFA_BYTE_SYMBOLS; b++) {
+        hashes[b] = 14695981039346656037ull;
+    }
+    for (uint32_t s = 0; s < dfa->state_count; s++) {
+        for (uint32_t b = 0; b < DFA_BYTE_SYMBOLS; b++) {
+            hashes[b] = (hashes[b] ^ ByteTarget(dfa, s, b)) * 1099511628211ull;
+        }
+    }
+    AssignClasses(classes, dfa, hashes, false);
+
+    for (uint32_t s = 0; s < dfa->state_count; s++) {
+        for (uint32_t b = 0; b < DFA_BYTE_SYMBOLS; b++) {
+            uint32_t representative = classes->representative[classes->map[b]];
+            if (ByteTarget(dfa, s, b) != ByteTarget(dfa, s, representative)) {
+                AssignClasses(classes, dfa, hashes, true);
+                return true;
+            }
+        }
+    }
+    return true;
+}
+
+// Keeps one column per class
+Dfa* Dfa_compress(const Dfa* dfa, const ByteClasses* classes) {
+    if (!dfa || !classes || !classes->count) return NULL;
+
+    Dfa* compressed = Dfa_create(dfa->state_count, classes->count);
+    if (!compressed) return NULL;
+
+    compressed->start = dfa->start;
+    memcpy(compressed->accepts, dfa->accepts, dfa->state_count * sizeof(uint32_t));
+    for (uint32_t s = 0; s < dfa->state_count; s++) {
+        for (uint32_t c = 0; c < classes->count; c++) {
+            Dfa_setTransition(compressed, s, c, ByteTarget(dfa, s, classes->representative[c]));
+        }
+    }
+    return compressed;
+}
+
+size_t Dfa_longestMatch(const Dfa* dfa, const ByteClasses* classes, const char* text,
+                        size_t length, uint32_t* accepts) {
+    if (accepts) *accepts = 0;
+    if (!dfa || !text) return 0;
+
+    const unsigned char* bytes = (const unsigned char*)text;
+    uint32_t state = dfa->start;
+    size_t matched = 0;
+    for (size_t i = 0; i < length; i++) {
+        uint32_t symbol = classes ? classes->map[bytes[i]] : bytes[i];
+        if (symbol >= dfa->symbol_count) break;
+
+        state = Dfa_next(dfa, state, symbol);
+        if (state == DFA_NO_STATE) break;
+        if (dfa->accepts[state]) {
+            matched = i + 1;
+            if (accepts) *accepts = dfa->accepts[state];
+        }
+    }
+    return matched;
+}
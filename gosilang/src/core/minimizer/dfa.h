@@ -0,0 +1,53 @@
+#ifndef DFA_H
+#define DFA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define DFA_NO_STATE UINT32_MAX
+#define DFA_BYTE_SYMBOLS 256
+
+// Deterministic automaton over symbols 0..symbol_count-1 with a flat
+// transition table. Missing transitions are DFA_NO_STATE, so partial
+// automata such as lexer DFAs need no explicit error state.
+typedef struct Dfa {
+    uint32_t state_count;
+    uint32_t symbol_count;
+    uint32_t start;
+    uint32_t* transitions;  // [state * symbol_count + symbol]
+    uint32_t* accepts;      // 0 for non-accepting, otherwise what is accepted
+} Dfa;
+
+// Alphabet compression: bytes that every state treats alike share a
+// class, so a byte automaton's rows shrink from 256 entries to a few
+// dozen and the table fits in cache.
+typedef struct ByteClasses {
+    uint8_t map[DFA_BYTE_SYMBOLS];              // Byte -> class
+    uint8_t representative[DFA_BYTE_SYMBOLS];   // Lowest byte of each class
+    uint32_t count;
+} ByteClasses;
+
+// Automaton lifetime
+Dfa* Dfa_create(uint32_t state_count, uint32_t symbol_count);
+void Dfa_destroy(Dfa* dfa);
+
+static inline uint32_t Dfa_next(const Dfa* dfa, uint32_t state, uint32_t symbol) {
+    return dfa->transitions[(size_t)state * dfa->symbol_count + symbol];
+}
+
+static inline void Dfa_setTransition(Dfa* dfa, uint32_t from, uint32_t symbol, uint32_t to) {
+    dfa->transitions[(size_t)from * dfa->symbol_count + symbol] = to;
+}
+
+// Byte classes
+void ByteClasses_identity(ByteClasses* classes);
+bool ByteClasses_fromDfa(ByteClasses* classes, const Dfa* dfa);
+Dfa* Dfa_compress(const Dfa* dfa, const ByteClasses* classes);
+
+// Runs a byte automaton, or a compressed one when classes is not NULL,
+// and returns the length of the longest accepted prefix (0 if none)
+size_t Dfa_longestMatch(const Dfa* dfa, const ByteClasses* classes, const char* text,
+                        size_t length, uint32_t* accepts);
+
+#endif // DFA_H
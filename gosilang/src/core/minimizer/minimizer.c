@@ -0,0 +1,357 @@
+#include "minimizer.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Working state for one minimization. The reachable states are renumbered
+// 0..count-2 in breadth-first order and state count-1 is an added sink,
+// which completes the automaton: every missing transition goes there.
+typedef struct Refinement {
+    uint32_t count;         // Reachable states plus the sink
+    uint32_t symbols;
+    uint32_t* delta;        // Complete table over local states
+    uint32_t* inverse_start;// [symbol * count + target], count * symbols + 1 entries
+    uint32_t* inverse;      // Predecessors grouped by (symbol, target)
+
+    // Refinable partition: each block is a run of elements
+    uint32_t* elements;
+    uint32_t* location;     // Index of each state in elements
+    uint32_t* block_of;
+    uint32_t* block_start;
+    uint32_t* block_end;
+    uint32_t* block_marked; // Marked states sit at the front of their block
+    uint32_t block_count;
+
+    uint32_t* worklist;
+    uint8_t* in_worklist;
+    uint32_t worklist_count;
+    uint32_t* touched;      // Blocks with marked states
+    uint32_t* splitter;     // Copy of the block being split by
+} Refinement;
+
+// Initial blocks group states by what they accept and their signature
+typedef struct StateKey {
+    uint32_t accepts;
+    uint32_t signature;
+    uint32_t state;
+} StateKey;
+
+static int CompareKeys(const void* a, const void* b) {
+    const StateKey* x = (const StateKey*)a;
+    const StateKey* y = (const StateKey*)b;
+    if (x->accepts != y->accepts) return x->accepts < y->accepts ? -1 : 1;
+    if (x->signature != y->signature) return x->signature < y->signature ? -1 : 1;
+    return x->state < y->state ? -1 : x->state > y->state;
+}
+
+static void Refinement_free(Refinement* r) {
+    free(r->delta);
+    free(r->inverse_start);
+    free(r->inverse);
+    free(r->elements);
+    free(r->location);
+    free(r->block_of);
+    free(r->block_start);
+    free(r->block_end);
+    free(r->block_marked);
+    free(r->worklist);
+    free(r->in_worklist);
+    free(r->touched);
+    free(r->splitter);
+}
+
+static bool Refinement_alloc(Refinement* r) {
+    size_t n = r->count;
+    size_t cells = n * r->symbols;
+
+    r->delta = (uint32_t*)malloc((cells ? cells : 1) * sizeof(uint32_t));
+    r->inverse_start = (uint32_t*)calloc(cells + 1, sizeof(uint32_t));
+    r->inverse = (uint32_t*)malloc((cells ? cells : 1) * sizeof(uint32_t));
+    r->elements = (uint32_t*)malloc(n * sizeof(uint32_t));
+    r->location = (uint32_t*)malloc(n * sizeof(uint32_t));
+    r->block_of = (uint32_t*)malloc(n * sizeof(uint32_t));
+    r->block_start = (uint32_t*)malloc(n * sizeof(uint32_t));
+    r->block_end = (uint32_t*)malloc(n * sizeof(uint32_t));
+    r->block_marked = (uint32_t*)calloc(n, sizeof(uint32_t));
+    r->worklist = (uint32_t*)malloc(n * sizeof(uint32_t));
+    r->in_worklist = (uint8_t*)calloc(n, 1);
+    r->touched = (uint32_t*)malloc(n * sizeof(uint32_t));
+    r->splitter = (uint32_t*)malloc(n * sizeof(uint32_t));
+
+    return r->delta && r->inverse_start && r->inverse && r->elements && r->location &&
+           r->block_of && r->block_start && r->block_end && r->block_marked &&
+           r->worklist && r->in_worklist && r->touched && r->splitter;
+}
+
+// Predecessors by (symbol, target) as a counting sort of the table
+static void BuildInverse(Refinement* r) {
+    uint32_t n = r->count;
+    for (uint32_t s = 0; s < n; s++) {
+        for (uint32_t a = 0; a < r->symbols; a++) {
+            r->inverse_start[(size_t)a * n + r->delta[(size_t)s * r->symbols + a] + 1]++;
+        }
+    }
+    size_t cells = (size_t)n * r->symbols;
+    for (size_t i = 0; i < cells; i++) {
+        r->inverse_start[i + 1] += r->inverse_start[i];
+    }
+    // Fill using the starts as cursors, then shift them back
+    for (uint32_t s = 0; s < n; s++) {
+        for (uint32_t a = 0; a < r->symbols; a++) {
+            size_t slot = (size_t)a * n + r->delta[(size_t)s * r->symbols + a];
+            r->inverse[r->inverse_start[slot]++] = s;
+        }
+    }
+    for (size_t i = cells; i > 0; i--) {
+        r->inverse_start[i] = r->inverse_start[i - 1];
+    }
+    r->inverse_start[0] = 0;
+}
+
+// Marks the states that can reach an accepting state, searching
+// backwards from every accepting state over the inverse table
+static void MarkLive(const Refinement* r, const StateKey* keys, uint8_t* live, uint32_t* queue) {
+    uint32_t queued = 0;
+    for (uint32_t s = 0; s < r->count; s++) {
+        if (keys[s].accepts) {
+            live[s] = 1;
+            queue[queued++] = s;
+        }
+    }
+    for (uint32_t i = 0; i < queued; i++) {
+        uint32_t target = queue[i];
+        for (uint32_t a = 0; a < r->symbols; a++) {
+            size_t slot = (size_t)a * r->count + target;
+            for (uint32_t p = r->inverse_start[slot]; p < r->inverse_start[slot + 1]; p++) {
+                uint32_t from = r->inverse[p];
+                if (!live[from]) {
+                    live[from] = 1;
+                    queue[queued++] = from;
+                }
+            }
+        }
+    }
+}
+
+static void PushWork(Refinement* r, uint32_t block) {
+    if (r->in_worklist[block]) return;
+    r->in_worklist[block] = 1;
+    r->worklist[r->worklist_count++] = block;
+}
+
+static void InitialPartition(Refinement* r, const StateKey* keys) {
+    for (uint32_t i = 0; i < r->count; i++) {
+        uint32_t s = keys[i].state;
+        if (i == 0 || keys[i].accepts != keys[i - 1].accepts ||
+            keys[i].signature != keys[i - 1].signature) {
+            if (i) r->block_end[r->block_count - 1] = i;
+            r->block_start[r->block_count++] = i;
+        }
+        r->elements[i] = s;
+        r->location[s] = i;
+        r->block_of[s] = r->block_count - 1;
+    }
+    r->block_end[r->block_count - 1] = r->count;
+
+    // Splitting by all blocks but the largest is enough
+    uint32_t largest = 0;
+    for (uint32_t b = 1; b < r->block_count; b++) {
+        if (r->block_end[b] - r->block_start[b] > r->block_end[largest] - r->block_start[largest]) {
+            largest = b;
+        }
+    }
+    for (uint32_t b = 0; b < r->block_count; b++) {
+        if (b != largest) PushWork(r, b);
+    }
+}
+
+static inline void Mark(Refinement* r, uint32_t state, uint32_t* touched_count) {
+    uint32_t block = r->block_of[state];
+    uint32_t front = r->block_start[block] + r->block_marked[block];
+    uint32_t at = r->location[state];
+    if (at < front) return;
+
+    uint32_t other = r->elements[front];
+    r->elements[front] = state;
+    r->location[state] = front;
+    r->elements[at] = other;
+    r->location[other] = at;
+    if (r->block_marked[block]++ == 0) r->touched[(*touched_count)++] = block;
+}
+
+// Splits every touched block into its marked and unmarked states
+static void SplitTouched(Refinement* r, uint32_t touched_count) {
+    for (uint32_t t = 0; t < touched_count; t++) {
+        uint32_t block = r->touched[t];
+        uint32_t marked = r->block_marked[block];
+        uint32_t size = r->block_end[block] - r->block_start[block];
+        r->block_marked[block] = 0;
+        if (marked == size) continue;
+
+        // The marked front becomes a new block; relabelling it costs no
+        // more than marking it did
+        uint32_t split = r->block_count++;
+        r->block_start[split] = r->block_start[block];
+        r->block_end[split] = r->block_start[block] + marked;
+        r->block_start[block] += marked;
+        for (uint32_t i = r->block_start[split]; i < r->block_end[split]; i++) {
+            r->block_of[r->elements[i]] = split;
+        }
+
+        if (r->in_worklist[block]) {
+            PushWork(r, split);
+        } else {
+            PushWork(r, marked <= size - marked ? split : block);
+        }
+    }
+}
+
+static void Refine(Refinement* r) {
+    while (r->worklist_count) {
+        uint32_t block = r->worklist[--r->worklist_count];
+        r->in_worklist[block] = 0;
+
+        // The splitter may itself split while it is being used
+        uint32_t size = r->block_end[block] - r->block_start[block];
+        memcpy(r->splitter, &r->elements[r->block_start[block]], size * sizeof(uint32_t));
+
+        for (uint32_t a = 0; a < r->symbols; a++) {
+            const uint32_t* starts = &r->inverse_start[(size_t)a * r->count];
+            uint32_t touched_count = 0;
+            for (uint32_t i = 0; i < size; i++) {
+                uint32_t target = r->splitter[i];
+                for (uint32_t p = starts[target]; p < starts[target + 1]; p++) {
+                    Mark(r, r->inverse[p], &touched_count);
+                }
+            }
+            SplitTouched(r, touched_count);
+        }
+    }
+}
+
+Dfa* Dfa_minimize(const Dfa* dfa, const uint32_t* signatures, uint32_t* state_map) {
+    if (!dfa || !dfa->state_count || dfa->start >= dfa->state_count) return NULL;
+
+    uint32_t n = dfa->state_count;
+    uint32_t k = dfa->symbol_count;
+    Dfa* result = NULL;
+    Refinement r = { 0 };
+    StateKey* keys = NULL;
+    uint32_t* local = (uint32_t*)malloc(n * sizeof(uint32_t));
+    uint32_t* order = (uint32_t*)malloc(n * sizeof(uint32_t));
+    if (!local || !order) goto cleanup;
+
+    // Reachable states in breadth-first order
+    memset(local, 0xFF, n * sizeof(uint32_t));
+    uint32_t reached = 0;
+    local[dfa->start] = reached;
+    order[reached++] = dfa->start;
+    for (uint32_t i = 0; i < reached; i++) {
+        const uint32_t* row = &dfa->transitions[(size_t)order[i] * k];
+        for (uint32_t a = 0; a < k; a++) {
+            uint32_t to = row[a];
+            if (to < n && local[to] == DFA_NO_STATE) {
+                local[to] = reached;
+                order[reached++] = to;
+            }
+        }
+    }
+
+    r.count = reached + 1;
+    r.symbols = k;
+    uint32_t sink = reached;
+    if (k && (size_t)r.count > SIZE_MAX / sizeof(uint32_t) / k) goto cleanup;
+    keys = (StateKey*)malloc(r.count * sizeof(StateKey));
+    if (!keys || !Refinement_alloc(&r)) goto cleanup;
+
+    for (uint32_t s = 0; s < reached; s++) {
+        const uint32_t* row = &dfa->transitions[(size_t)order[s] * k];
+        uint32_t* local_row = &r.delta[(size_t)s * k];
+        for (uint32_t a = 0; a < k; a++) {
+            local_row[a] = row[a] < n ? local[row[a]] : sink;
+        }
+        keys[s].accepts = dfa->accepts[order[s]];
+        keys[s].signature = signatures ? signatures[order[s]] : 0;
+        keys[s].state = s;
+    }
+    for (uint32_t a = 0; a < k; a++) {
+        r.delta[(size_t)sink * k + a] = sink;
+    }
+    keys[sink] = (StateKey){ 0, 0, sink };
+
+    // Dead states drop their signature so they all start in the sink's
+    // block; otherwise a signature would keep one apart from the sink
+    // and its block would survive as a live state
+    BuildInverse(&r);
+    if (signatures) {
+        uint8_t* live = r.in_worklist;      // Reused: cleared again below
+        MarkLive(&r, keys, live, r.touched);
+        for (uint32_t s = 0; s < reached; s++) {
+            if (!live[s]) keys[s].signature = 0;
+        }
+        memset(live, 0, r.count);
+    }
+    qsort(keys, r.count, sizeof(StateKey), CompareKeys);
+    InitialPartition(&r, keys);
+    Refine(&r);
+
+    // Number the live blocks breadth-first from the start block. The
+    // sink's block holds every dead state and is dropped.
+    uint32_t dead = r.block_of[sink];
+    uint32_t* numbering = r.touched;    // Reused: block -> minimized state
+    uint32_t* queue = r.worklist;       // Reused: minimized state -> block
+    memset(numbering, 0xFF, r.block_count * sizeof(uint32_t));
+    uint32_t minimized = 0;
+    uint32_t start_block = r.block_of[0];
+    if (start_block != dead) {
+        numbering[start_block] = minimized;
+        queue[minimized++] = start_block;
+        for (uint32_t i = 0; i < minimized; i++) {
+            uint32_t representative = r.elements[r.block_start[queue[i]]];
+            for (uint32_t a = 0; a < k; a++) {
+                uint32_t to = r.block_of[r.delta[(size_t)representative * k + a]];
+                if (to != dead && numbering[to] == DFA_NO_STATE) {
+                    numbering[to] = minimized;
+                    queue[minimized++] = to;
+                }
+            }
+        }
+    }
+
+    // An empty language still minimizes to a single rejecting state
+    result = Dfa_create(minimized ? minimized : 1, k);
+    if (!result) goto cleanup;
+    result->start = 0;
+    for (uint32_t m = 0; m < minimized; m++) {
+        uint32_t representative = r.elements[r.block_start[queue[m]]];
+        result->accepts[m] = dfa->accepts[order[representative]];
+        for (uint32_t a = 0; a < k; a++) {
+            uint32_t to = r.block_of[r.delta[(size_t)representative * k + a]];
+            if (to != dead) Dfa_setTransition(result, m, a, numbering[to]);
+        }
+    }
+
+    if (state_map) {
+        for (uint32_t s = 0; s < n; s++) {
+            state_map[s] = local[s] == DFA_NO_STATE ? DFA_NO_STATE : numbering[r.block_of[local[s]]];
+        }
+    }
+
+cleanup:
+    Refinement_free(&r);
+    free(keys);
+    free(order);
+    free(local);
+    return result;
+}
+
+uint32_t Minimizer_astSignature(const AstPool* pool, AstNodeId node) {
+    const AstNode* entry = pool ? AstPool_node(pool, node) : NULL;
+    if (!entry) return 0;
+
+    uint32_t kinds = 0;
+    for (uint32_t i = 0; i < entry->child_count; i++) {
+        const AstNode* child = AstPool_node(pool, pool->children[entry->first_child + i]);
+        if (child) kinds |= 1u << child->kind;
+    }
+    return kinds;
+}
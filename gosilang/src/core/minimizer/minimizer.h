@@ -0,0 +1,24 @@
+#ifndef MINIMIZER_H
+#define MINIMIZER_H
+
+#include "dfa.h"
+#include "core/ast/ast.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Hopcroft partition refinement, O(|Q||Σ| log |Q|). Unreachable and
+// dead states are dropped and the result is numbered breadth-first from
+// its start state, so equivalent automata minimize to identical tables.
+//
+// signatures, if not NULL, gives each state an extra label that states
+// must share to be merged: the AST-aware refinement, where a state's
+// signature describes the AST node it corresponds to. Dead states are
+// dropped whatever their signature. state_map, if not
+// NULL, receives each input state's minimized state or DFA_NO_STATE.
+Dfa* Dfa_minimize(const Dfa* dfa, const uint32_t* signatures, uint32_t* state_map);
+
+// The set of child kinds of an AST node, as a signature for Dfa_minimize
+uint32_t Minimizer_astSignature(const AstPool* pool, AstNodeId node);
+
+#endif // MINIMIZER_H
@@ -0,0 +1,315 @@
+#include "expr_parser.h"
+#include "core/tokenizer/symbols/sym_intern.h"
+#include "core/trace/trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Parser lifetime
+ExprParser* ExprParser_create(void) {
+    return (ExprParser*)calloc(1, sizeof(ExprParser));
+}
+
+void ExprParser_destroy(ExprParser* parser) {
+    if (!parser) return;
+    free(parser->output);
+    free(parser->stack);
+    free(parser->operands);
+    free(parser);
+}
+
+// Neither the output nor the stack can outgrow the input, so both are
+// sized once per parse and the token loop never checks capacity.
+static bool ReserveItems(ExprItem** items, uint32_t* capacity, uint32_t needed) {
+    if (needed <= *capacity) return true;
+
+    uint32_t grown = *capacity ? *capacity : EXPR_PARSER_INITIAL_CAPACITY;
+    while (grown < needed) {
+        grown = grown > UINT32_MAX / 2 ? needed : grown * 2;
+    }
+    ExprItem* resized = (ExprItem*)realloc(*items, grown * sizeof(ExprItem));
+    if (!resized) return false;
+
+    *items = resized;
+    *capacity = grown;
+    return true;
+}
+
+static bool Fail(ExprParser* parser, const char* message, uint32_t token) {
+    parser->error = message;
+    parser->error_token = token;
+    TRACE(TRACE_PARSER, "parse failed: %s at token %u", message, token);
+    return false;
+}
+
+static inline void Push(ExprParser* parser, ExprItemKind kind, uint32_t token, OperatorType op, int precedence) {
+    ExprItem* item = &parser->stack[parser->stack_count++];
+    item->token = token;
+    item->kind = (uint8_t)kind;
+    item->op = (uint8_t)op;
+    item->precedence = (uint8_t)precedence;
+    item->pending = kind == EXPR_ITEM_CONDITIONAL;
+}
+
+static inline void Emit(ExprParser* parser, ExprItemKind kind, uint32_t token, OperatorType op) {
+    ExprItem* item = &parser->output[parser->output_count++];
+    item->token = token;
+    item->kind = (uint8_t)kind;
+    item->op = (uint8_t)op;
+    item->precedence = 0;
+    item->pending = 0;
+}
+
+// Moves operators that bind at least as tightly as an incoming one to
+// the output. Groups and ternaries still waiting for ':' are barriers.
+static inline void Reduce(ExprParser* parser, int precedence, bool right) {
+    while (parser->stack_count) {
+        const ExprItem* top = &parser->stack[parser->stack_count - 1];
+        if (top->kind == EXPR_ITEM_GROUP || top->pending) break;
+        if (top->precedence < precedence || (top->precedence == precedence && right)) break;
+
+        parser->output[parser->output_count++] = *top;
+        parser->stack_count--;
+    }
+}
+
+static inline bool IsOperand(TokenType type) {
+    switch (type) {
+        case TOKEN_LITERAL_VALUE:
+        case TOKEN_LITERAL_IDENTIFIER:
+        case TOKEN_LITERAL_STRING:
+        case TOKEN_LITERAL_CHAR:
+        case TOKEN_LITERAL_INTEGER:
+        case TOKEN_LITERAL_FLOAT:
+        case TOKEN_LITERAL_BOOL:
+        case TOKEN_LITERAL_NULL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Operators in operand position: * and & become dereference and address-of
+static inline bool PrefixOperator(TokenType type, LexemeId lexeme, OperatorType* op) {
+    if (type == TOKEN_EXPR_SIZEOF) {
+        *op = OP_SIZEOF;
+        return true;
+    }
+    if (type != TOKEN_EXPR_BINARY && type != TOKEN_EXPR_UNARY) return false;
+    if (!Lexeme_toOperator(lexeme, op)) return false;
+
+    if (*op == OP_MULTIPLY) *op = OP_DEREFERENCE;
+    if (*op == OP_BITWISE_AND) *op = OP_ADDRESS_OF;
+    return OperatorType_hasForm(*op, OP_FORM_PREFIX);
+}
+
+// Operators after an operand: binary, assignment, postfix, '?', ',' and member access
+static inline bool InfixOperator(TokenType type, LexemeId lexeme, OperatorType* op) {
+    switch (type) {
+        case TOKEN_EXPR_BINARY:
+        case TOKEN_EXPR_ASSIGNMENT:
+        case TOKEN_EXPR_CONDITIONAL:
+        case TOKEN_PUNCT_COMMA:
+        case TOKEN_PUNCT_DOT:
+        case TOKEN_PUNCT_ARROW:
+            return Lexeme_toOperator(lexeme, op);
+        case TOKEN_EXPR_UNARY:
+            return Lexeme_toOperator(lexeme, op) && OperatorType_hasForm(*op, OP_FORM_POSTFIX);
+        default:
+            return false;
+    }
+}
+
+// Parses tokens [begin, end) into postfix order. On failure parser->error
+// names the problem and parser->error_token the offending token index.
+bool ExprParser_parse(ExprParser* parser, const TokenBuffer* tokens, uint32_t begin, uint32_t end) {
+    if (!parser) return false;
+
+    parser->output_count = 0;
+    parser->stack_count = 0;
+    parser->error = NULL;
+    parser->error_token = begin;
+    if (!tokens || begin > end || end > tokens->count) {
+        return Fail(parser, "invalid token range", begin);
+    }
+    if (begin == end) return Fail(parser, "empty expression", begin);
+    if (!ReserveItems(&parser->output, &parser->output_capacity, end - begin) ||
+        !ReserveItems(&parser->stack, &parser->stack_capacity, end - begin)) {
+        return Fail(parser, "out of memory", begin);
+    }
+
+    bool expect_operand = true;
+    for (uint32_t i = begin; i < end; i++) {
+        TokenType type = (TokenType)tokens->types[i];
+        LexemeId lexeme = tokens->lexemes[i];
+        OperatorType op;
+
+        if (expect_operand) {
+            if (IsOperand(type)) {
+                Emit(parser, EXPR_ITEM_OPERAND, i, 0);
+                expect_operand = false;
+            } else if (type == TOKEN_PAREN_OPEN) {
+                Push(parser, EXPR_ITEM_GROUP, i, 0, 0);
+            } else if (PrefixOperator(type, lexeme, &op)) {
+                Push(parser, EXPR_ITEM_PREFIX, i, op, PREC_PREFIX);
+            } else {
+                return Fail(parser, "expected an operand", i);
+            }
+            continue;
+        }
+
+        if (type == TOKEN_PAREN_CLOSE) {
+            Reduce(parser, 0, false);
+            if (!parser->stack_count) return Fail(parser, "unbalanced ')'", i);
+            if (parser->stack[parser->stack_count - 1].pending) return Fail(parser, "expected ':'", i);
+            parser->stack_count--;
+            continue;
+        }
+
+        if (type == TOKEN_PUNCT_COLON) {
+            Reduce(parser, 0, false);
+            if (!parser->stack_count || !parser->stack[parser->stack_count - 1].pending) {
+                return Fail(parser, "':' without '?'", i);
+            }
+            // The ternary now waits for its else branch like a right-associative operator
+            parser->stack[parser->stack_count - 1].pending = 0;
+            expect_operand = true;
+            continue;
+        }
+
+        if (!InfixOperator(type, lexeme, &op)) return Fail(parser, "expected an operator", i);
+
+        int precedence = OperatorType_getPrecedence(op);
+        if (OperatorType_hasForm(op, OP_FORM_POSTFIX)) {
+            // Postfix binds tighter than anything pending except member access
+            Reduce(parser, precedence, false);
+            Emit(parser, EXPR_ITEM_POSTFIX, i, op);
+            continue;
+        }
+
+        Reduce(parser, precedence, OperatorType_isRightAssociative(op));
+        Push(parser, op == OP_CONDITIONAL ? EXPR_ITEM_CONDITIONAL : EXPR_ITEM_BINARY, i, op, precedence);
+        expect_operand = true;
+    }
+
+    if (expect_operand) return Fail(parser, "expected an operand", end - 1);
+
+    while (parser->stack_count) {
+        const ExprItem* top = &parser->stack[--parser->stack_count];
+        if (top->kind == EXPR_ITEM_GROUP) return Fail(parser, "unclosed '('", top->token);
+        if (top->pending) return Fail(parser, "expected ':'", top->token);
+        parser->output[parser->output_count++] = *top;
+    }
+    TRACE(TRACE_PARSER, "parsed tokens %u..%u into %u postfix items", begin, end, parser->output_count);
+    return true;
+}
+
+// Tree building
+
+static AstNodeKind OperandKind(TokenType type) {
+    return type == TOKEN_LITERAL_IDENTIFIER ? AST_NODE_IDENTIFIER : AST_NODE_LITERAL;
+}
+
+// Evaluates the postfix output into pool. Operands wait on a stack of
+// node ids; an operator's children are the top entries of that stack,
+// in source order, and are copied straight into the pool's child array.
+AstNodeId ExprParser_build(ExprParser* parser, const TokenBuffer* tokens, uint32_t begin,
+                           uint32_t end, AstPool* pool) {
+    if (!pool) {
+        if (parser) Fail(parser, "no AST pool", begin);
+        return AST_NODE_NONE;
+    }
+    if (!ExprParser_parse(parser, tokens, begin, end)) return AST_NODE_NONE;
+
+    uint32_t items = parser->output_count;
+    if (items > parser->operands_capacity) {
+        AstNodeId* resized = (AstNodeId*)realloc(parser->operands, items * sizeof(AstNodeId));
+        if (!resized) {
+            Fail(parser, "out of memory", begin);
+            return AST_NODE_NONE;
+        }
+        parser->operands = resized;
+        parser->operands_capacity = items;
+    }
+    // Every item becomes one node with at most one child link per item
+    if (!AstPool_reserve(pool, pool->count + items, pool->child_count + items)) {
+        Fail(parser, "out of memory", begin);
+        return AST_NODE_NONE;
+    }
+
+    AstNodeId* operands = parser->operands;
+    uint32_t depth = 0;
+    for (uint32_t i = 0; i < items; i++) {
+        const ExprItem* item = &parser->output[i];
+        AstNodeKind kind;
+        uint32_t arity;
+
+        switch (item->kind) {
+            case EXPR_ITEM_OPERAND:
+                kind = OperandKind((TokenType)tokens->types[item->token]);
+                arity = 0;
+                break;
+            case EXPR_ITEM_PREFIX:
+                kind = AST_NODE_PREFIX;
+                arity = 1;
+                break;
+            case EXPR_ITEM_POSTFIX:
+                kind = AST_NODE_POSTFIX;
+                arity = 1;
+                break;
+            case EXPR_ITEM_CONDITIONAL:
+                kind = AST_NODE_CONDITIONAL;
+                arity = 3;
+                break;
+            default:
+                kind = AST_NODE_BINARY;
+                arity = 2;
+                break;
+        }
+
+        depth -= arity;
+        AstNodeId node = AstPool_add(pool, kind, item->op, item->token, &operands[depth], arity);
+        if (node == AST_NODE_NONE) {
+            Fail(parser, "out of memory", item->token);
+            return AST_NODE_NONE;
+        }
+        operands[depth++] = node;
+    }
+
+    // A successful parse always leaves exactly one tree
+    if (depth != 1) {
+        Fail(parser, "malformed expression", begin);
+        return AST_NODE_NONE;
+    }
+    TRACE(TRACE_PARSER, "built %u AST nodes, root %u", items, operands[0]);
+    return operands[0];
+}
+
+// Legacy interface
+
+// Hand-built tokens may carry no lexeme id, so operators are looked up
+// by spelling once before parsing. Any NULL entry fails the parse.
+AstNodeId ParseExpression(Token* tokens[], int count, AstPool* pool) {
+    if (!tokens || count <= 0 || !pool) return AST_NODE_NONE;
+
+    AstNodeId root = AST_NODE_NONE;
+    TokenBuffer* buffer = TokenBuffer_create((uint32_t)count);
+    ExprParser* parser = ExprParser_create();
+    if (!buffer || !parser) goto cleanup;
+
+    for (int i = 0; i < count; i++) {
+        Token* token = tokens[i];
+        uint32_t index = TokenBuffer_push(buffer, token);
+        if (index == UINT32_MAX) goto cleanup;
+        if (!token->lexeme && token->value && token->category != TOKEN_CATEGORY_LITERAL) {
+            buffer->lexemes[index] = Lexeme_findReserved(token->value, token->length);
+        }
+    }
+
+    TRACE(TRACE_PARSER, "building expression tree from %u tokens", buffer->count);
+    root = ExprParser_build(parser, buffer, 0, buffer->count, pool);
+
+cleanup:
+    ExprParser_destroy(parser);
+    TokenBuffer_destroy(buffer);
+    return root;
+}
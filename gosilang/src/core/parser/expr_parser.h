@@ -0,0 +1,62 @@
+#ifndef EXPR_PARSER_H
+#define EXPR_PARSER_H
+
+#include "core/tokenizer/symbols/sym_type.h"
+#include "core/tokenizer/symbols/sym_value.h"
+#include "core/tokenizer/symbols/sym_buffer.h"
+#include "core/ast/ast.h"
+
+#define EXPR_PARSER_INITIAL_CAPACITY 64
+
+// Role of an entry in the postfix output
+typedef enum ExprItemKind {
+    EXPR_ITEM_OPERAND,      // Identifier or literal
+    EXPR_ITEM_PREFIX,       // Unary operator before its operand
+    EXPR_ITEM_POSTFIX,      // x++ and x--
+    EXPR_ITEM_BINARY,       // Includes assignment, comma and member access
+    EXPR_ITEM_CONDITIONAL,  // c ? a : b, consumes three operands
+    EXPR_ITEM_GROUP         // Open parenthesis; only on the operator stack
+} ExprItemKind;
+
+// One postfix (RPN) entry. Tokens are referenced by index, never copied.
+typedef struct ExprItem {
+    uint32_t token;         // Operand or operator token; '?' for ternaries
+    uint8_t kind;           // ExprItemKind
+    uint8_t op;             // OperatorType, for operators
+    uint8_t precedence;     // Binding power, used while parsing
+    uint8_t pending;        // Ternary awaiting its ':', while parsing
+} ExprItem;
+
+// Re-entrant shunting-yard parser. The output and operator stack are
+// grown by doubling and reused across calls, so once warmed up a parse
+// performs no heap allocation. One parser per thread.
+typedef struct ExprParser {
+    ExprItem* output;       // Postfix order
+    uint32_t output_count;
+    uint32_t output_capacity;
+    ExprItem* stack;        // Pending operators and groups
+    uint32_t stack_count;
+    uint32_t stack_capacity;
+    AstNodeId* operands;    // Subtrees awaiting their operator, while building
+    uint32_t operands_capacity;
+
+    const char* error;      // Static message, NULL on success
+    uint32_t error_token;
+} ExprParser;
+
+// Parser lifetime
+ExprParser* ExprParser_create(void);
+void ExprParser_destroy(ExprParser* parser);
+
+// Parses tokens [begin, end) of the buffer into parser->output
+bool ExprParser_parse(ExprParser* parser, const TokenBuffer* tokens, uint32_t begin, uint32_t end);
+
+// Parses tokens [begin, end) and adds the expression's nodes to pool.
+// Returns the root, or AST_NODE_NONE with parser->error set.
+AstNodeId ExprParser_build(ExprParser* parser, const TokenBuffer* tokens, uint32_t begin,
+                           uint32_t end, AstPool* pool);
+
+// Parses an array of standalone tokens into pool; node tokens index the array
+AstNodeId ParseExpression(Token* tokens[], int count, AstPool* pool);
+
+#endif // EXPR_PARSER_H
@@ -0,0 +1,529 @@
+#include "incremental_parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_TEXT_MIN_CAPACITY 64
+
+// Block lifetime
+static SourceBlock* CreateBlock(const char* text, size_t length) {
+    SourceBlock* block = (SourceBlock*)calloc(1, sizeof(SourceBlock));
+    if (!block) return NULL;
+
+    block->capacity = length > BLOCK_TEXT_MIN_CAPACITY ? (uint32_t)length : BLOCK_TEXT_MIN_CAPACITY;
+    block->text = (char*)malloc(block->capacity);
+    block->tokens = TokenBuffer_create(0);
+    block->pool = AstPool_create(0);
+    if (!block->text || !block->tokens || !block->pool) {
+        free(block->text);
+        TokenBuffer_destroy(block->tokens);
+        AstPool_destroy(block->pool);
+        free(block);
+        return NULL;
+    }
+    if (length) memcpy(block->text, text, length);
+    block->length = (uint32_t)length;
+    return block;
+}
+
+static void DestroyBlock(SourceBlock* block) {
+    if (!block) return;
+    free(block->text);
+    TokenBuffer_destroy(block->tokens);
+    AstPool_destroy(block->pool);
+    free(block->statements);
+    free(block);
+}
+
+static bool ReserveText(SourceBlock* block, size_t length) {
+    if (length <= block->capacity) return true;
+    if (length >= UINT32_MAX) return false;
+
+    size_t capacity = (size_t)block->capacity * 2;
+    if (capacity < length) capacity = length;
+    if (capacity >= UINT32_MAX) capacity = UINT32_MAX - 1;
+    char* text = (char*)realloc(block->text, capacity);
+    if (!text) return false;
+
+    block->text = text;
+    block->capacity = (uint32_t)capacity;
+    return true;
+}
+
+// Applies a block-relative edit to the block's text
+static bool EditText(SourceBlock* block, const TextEdit* edit, const char* inserted) {
+    size_t length = block->length - edit->removed + edit->inserted;
+    if (!ReserveText(block, length)) return false;
+
+    char* at = block->text + edit->offset;
+    memmove(at + edit->inserted, at + edit->removed, block->length - edit->offset - edit->removed);
+    if (edit->inserted) memcpy(at, inserted, edit->inserted);
+    block->length = (uint32_t)length;
+    return true;
+}
+
+// Every block is lexed the same way: comments skipped, so a statement
+// is an unbroken run of expression tokens
+static Lexer* CreateBlockLexer(const IncrementalParser* parser, const SourceBlock* block) {
+    Lexer* lexer = Lexer_createFromBuffer(block->text, block->length, "<buffer>");
+    if (!lexer) return NULL;
+
+    lexer->skip_comments = true;
+    lexer->track_lines = false;
+    Lexer_setInterner(lexer, parser->interner);
+    return lexer;
+}
+
+// Statements
+
+static bool ReserveStatements(ParsedStatement** statements, uint32_t* capacity, uint32_t needed) {
+    if (needed <= *capacity) return true;
+
+    uint32_t grown = *capacity ? *capacity * 2 : 16;
+    if (grown < needed) grown = needed;
+    ParsedStatement* resized = (ParsedStatement*)realloc(*statements, grown * sizeof(ParsedStatement));
+    if (!resized) return false;
+
+    *statements = resized;
+    *capacity = grown;
+    return true;
+}
+
+// Parses tokens [begin, end) into the block's pool and queues the
+// statement on the parser's scratch list. An empty or malformed
+// expression is kept as a statement without a tree.
+static bool AddStatement(IncrementalParser* parser, SourceBlock* block, uint32_t begin, uint32_t end) {
+    if (!ReserveStatements(&parser->scratch, &parser->scratch_capacity, parser->scratch_count + 1)) {
+        return false;
+    }
+
+    ParsedStatement* statement = &parser->scratch[parser->scratch_count++];
+    statement->begin = begin;
+    statement->end = end;
+    statement->first_node = block->pool->count;
+    statement->root = AST_NODE_NONE;
+    if (begin < end) {
+        statement->root = ExprParser_build(parser->parser, block->tokens, begin, end, block->pool);
+        if (statement->root == AST_NODE_NONE) block->dead_nodes += block->pool->count - statement->first_node;
+    }
+    parser->reparsed_statements++;
+    return true;
+}
+
+// Splits the block's tokens from begin on at every ';' into scratch
+// statements, stopping after the first ';' at or past until. Returns
+// that ';', the token count if the tokens ran out, or UINT32_MAX.
+static uint32_t SplitStatements(IncrementalParser* parser, SourceBlock* block, uint32_t begin, uint32_t until) {
+    const TokenBuffer* tokens = block->tokens;
+    uint32_t start = begin;
+
+    for (uint32_t i = begin; i < tokens->count; i++) {
+        if (tokens->types[i] != TOKEN_PUNCT_SEMICOLON) continue;
+        if (!AddStatement(parser, block, start, i)) return UINT32_MAX;
+        if (i >= until) return i;
+        start = i + 1;
+    }
+    if (start < tokens->count && !AddStatement(parser, block, start, tokens->count)) return UINT32_MAX;
+    return tokens->count;
+}
+
+// Replaces statements [low, high) of the block with the scratch list
+static bool ReplaceStatements(IncrementalParser* parser, SourceBlock* block, uint32_t low, uint32_t high) {
+    uint32_t count = block->statement_count - (high - low) + parser->scratch_count;
+    if (!ReserveStatements(&block->statements, &block->statement_capacity, count)) return false;
+
+    for (uint32_t i = low; i < high; i++) {
+        const ParsedStatement* statement = &block->statements[i];
+        if (statement->root != AST_NODE_NONE) block->dead_nodes += statement->root - statement->first_node + 1;
+    }
+    memmove(&block->statements[low + parser->scratch_count], &block->statements[high],
+            (block->statement_count - high) * sizeof(ParsedStatement));
+    memcpy(&block->statements[low], parser->scratch, parser->scratch_count * sizeof(ParsedStatement));
+    block->statement_count = count;
+    return true;
+}
+
+// First statement whose end is at or after token
+static uint32_t FindStatement(const SourceBlock* block, uint32_t token) {
+    uint32_t low = 0;
+    uint32_t high = block->statement_count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (block->statements[mid].end < token) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// Appends tokens [first, first + count) of another buffer, their
+// offsets moved by shift
+static bool AppendTokens(TokenBuffer* buffer, const TokenBuffer* source, uint32_t first, uint32_t count,
+                         int64_t shift) {
+    if (!TokenBuffer_reserve(buffer, buffer->count + count)) return false;
+
+    uint32_t at = buffer->count;
+    memcpy(buffer->types + at, source->types + first, count);
+    memcpy(buffer->categories + at, source->categories + first, count);
+    memcpy(buffer->lengths + at, source->lengths + first, count * sizeof(uint32_t));
+    memcpy(buffer->lexemes + at, source->lexemes + first, count * sizeof(LexemeId));
+    memcpy(buffer->attributes + at, source->attributes + first, count * sizeof(uint16_t));
+    for (uint32_t i = 0; i < count; i++) {
+        buffer->offsets[at + i] = (uint32_t)(source->offsets[first + i] + shift);
+    }
+    buffer->count += count;
+    return true;
+}
+
+// Copies the statements' trees from one pool to the end of another and
+// points the statements at the copies, moving node tokens by
+// token_shift. A tree is a run of nodes ending at its root whose child
+// links are a run of the child array, so moving one only offsets its ids.
+static bool CopyTrees(const AstPool* from, AstPool* to, ParsedStatement* statements, uint32_t count,
+                      int64_t token_shift) {
+    uint32_t nodes = to->count;
+    uint32_t children = to->child_count;
+    for (uint32_t i = 0; i < count; i++) {
+        const ParsedStatement* statement = &statements[i];
+        if (statement->root == AST_NODE_NONE) continue;
+        const AstNode* root = &from->nodes[statement->root];
+        nodes += statement->root - statement->first_node + 1;
+        children += root->first_child + root->child_count - from->nodes[statement->first_node].first_child;
+    }
+    if (!AstPool_reserve(to, nodes, children)) return false;
+
+    for (uint32_t i = 0; i < count; i++) {
+        ParsedStatement* statement = &statements[i];
+        if (statement->root == AST_NODE_NONE) continue;
+
+        uint32_t first = statement->first_node;
+        uint32_t node_count = statement->root - first + 1;
+        uint32_t child_first = from->nodes[first].first_child;
+        uint32_t child_count = from->nodes[statement->root].first_child +
+                               from->nodes[statement->root].child_count - child_first;
+        AstNodeId base = to->count;
+        uint32_t child_base = to->child_count;
+
+        memcpy(&to->nodes[base], &from->nodes[first], node_count * sizeof(AstNode));
+        for (uint32_t n = 0; n < node_count; n++) {
+            AstNode* node = &to->nodes[base + n];
+            node->first_child = node->first_child - child_first + child_base;
+            node->token = (uint32_t)(node->token + token_shift);
+        }
+        for (uint32_t c = 0; c < child_count; c++) {
+            to->children[child_base + c] = from->children[child_first + c] - first + base;
+        }
+        to->count += node_count;
+        to->child_count += child_count;
+        statement->first_node = base;
+        statement->root = base + node_count - 1;
+    }
+    return true;
+}
+
+// Appends statements [first, first + count) of another block, moved by
+// token_shift, with copies of their trees
+static bool AppendStatements(SourceBlock* block, const SourceBlock* source, uint32_t first, uint32_t count,
+                             int64_t token_shift) {
+    uint32_t at = block->statement_count;
+    if (!ReserveStatements(&block->statements, &block->statement_capacity, at + count)) return false;
+
+    ParsedStatement* moved = &block->statements[at];
+    memcpy(moved, &source->statements[first], count * sizeof(ParsedStatement));
+    for (uint32_t i = 0; i < count; i++) {
+        moved[i].begin = (uint32_t)(moved[i].begin + token_shift);
+        moved[i].end = (uint32_t)(moved[i].end + token_shift);
+    }
+    if (!CopyTrees(source->pool, block->pool, moved, count, token_shift)) return false;
+    block->statement_count += count;
+    return true;
+}
+
+// Copies the live trees into a fresh pool
+static bool CompactBlock(SourceBlock* block) {
+    AstPool* pool = AstPool_create(0);
+    if (!pool || !CopyTrees(block->pool, pool, block->statements, block->statement_count, 0)) {
+        AstPool_destroy(pool);
+        return false;
+    }
+
+    AstPool_destroy(block->pool);
+    block->pool = pool;
+    block->dead_nodes = 0;
+    return true;
+}
+
+// Block updates
+
+static bool RebuildBlock(IncrementalParser* parser, SourceBlock* block) {
+    Lexer* lexer = CreateBlockLexer(parser, block);
+    if (!lexer) return false;
+
+    TokenBuffer* tokens = block->tokens;
+    TokenBuffer_clear(tokens);
+    Lexer_fillBuffer(lexer, tokens);
+    Lexer_destroy(lexer);
+    if (!tokens->count || tokens->types[tokens->count - 1] != TOKEN_EOF) return false;
+    tokens->count--;
+
+    AstPool_clear(block->pool);
+    block->dead_nodes = 0;
+    block->statement_count = 0;
+    parser->scratch_count = 0;
+    if (SplitStatements(parser, block, 0, UINT32_MAX) == UINT32_MAX ||
+        !ReplaceStatements(parser, block, 0, 0)) {
+        return false;
+    }
+
+    parser->relexed_tokens += tokens->count;
+    parser->rebuilt_blocks++;
+    return true;
+}
+
+// Re-lexes the damaged tokens and re-parses the statements holding
+// them, from the statement the first changed token falls in to the
+// first ';' after the new tokens, which was also a statement end
+// before the edit. Later statements keep their trees. Unless seam is
+// UINT32_MAX, it is the first token of a block appended to this one:
+// the statements either side of it are re-split as well, since the
+// last statement before it may run on into the appended block.
+static bool UpdateBlock(IncrementalParser* parser, SourceBlock* block, const TextEdit* edit, uint32_t seam) {
+    Lexer* lexer = CreateBlockLexer(parser, block);
+    TokenEdit change;
+    bool relexed = lexer && Lexer_relexBuffer(lexer, block->tokens, edit, &change);
+    Lexer_destroy(lexer);
+    if (!relexed) return false;
+
+    parser->relexed_tokens += change.inserted;
+    int64_t shift = (int64_t)change.inserted - (int64_t)change.removed;
+    uint32_t from = change.first;
+    uint32_t until = change.first + change.inserted;
+    if (seam != UINT32_MAX) {
+        if (seam < from) from = seam;
+        if (seam >= change.first + change.removed && seam + shift > until) until = (uint32_t)(seam + shift);
+    } else if (!change.removed && !change.inserted) {
+        return true;
+    }
+
+    uint32_t low = FindStatement(block, from);
+    uint32_t begin = low ? block->statements[low - 1].end + 1 : 0;
+
+    parser->scratch_count = 0;
+    uint32_t stop = SplitStatements(parser, block, begin, until);
+    if (stop == UINT32_MAX) return false;
+
+    // The statement ending at the old position of that ';' is the last
+    // one replaced; by then the token counts agree again
+    uint32_t high = block->statement_count;
+    if (stop < block->tokens->count) high = FindStatement(block, (uint32_t)(stop - shift + 1));
+    if (!ReplaceStatements(parser, block, low, high)) return false;
+
+    if (shift) {
+        for (uint32_t i = low + parser->scratch_count; i < block->statement_count; i++) {
+            ParsedStatement* statement = &block->statements[i];
+            statement->begin = (uint32_t)(statement->begin + shift);
+            statement->end = (uint32_t)(statement->end + shift);
+            if (statement->root == AST_NODE_NONE) continue;
+            for (AstNodeId n = statement->first_node; n <= statement->root; n++) {
+                block->pool->nodes[n].token = (uint32_t)(block->pool->nodes[n].token + shift);
+            }
+        }
+    }
+
+    if (block->dead_nodes > INCREMENTAL_MIN_DEAD_NODES && block->dead_nodes > block->pool->count / 2) {
+        return CompactBlock(block);
+    }
+    return true;
+}
+
+// The serial lexer starts a fresh scan after the block only if its last
+// token is a ';' followed by a newline; anything else may run on
+static bool IsSelfContained(const SourceBlock* block) {
+    if (!block->length || block->text[block->length - 1] != '\n') return false;
+    const TokenBuffer* tokens = block->tokens;
+    return !tokens->count || tokens->types[tokens->count - 1] == TOKEN_PUNCT_SEMICOLON;
+}
+
+static bool InsertBlock(IncrementalParser* parser, uint32_t index, SourceBlock* block) {
+    if (parser->block_count == parser->block_capacity) {
+        uint32_t capacity = parser->block_capacity ? parser->block_capacity * 2 : 16;
+        SourceBlock** blocks = (SourceBlock**)realloc(parser->blocks, capacity * sizeof(SourceBlock*));
+        if (!blocks) return false;
+        parser->blocks = blocks;
+        parser->block_capacity = capacity;
+    }
+    memmove(&parser->blocks[index + 1], &parser->blocks[index],
+            (parser->block_count - index) * sizeof(SourceBlock*));
+    parser->blocks[index] = block;
+    parser->block_count++;
+    return true;
+}
+
+// Appends the next block to block index and drops it. Its tokens and
+// trees move over; the tokens about the seam are lexed again, since the
+// serial lexer may scan across it, and the statements about it re-split.
+static bool JoinNext(IncrementalParser* parser, uint32_t index) {
+    SourceBlock* block = parser->blocks[index];
+    SourceBlock* next = parser->blocks[index + 1];
+    uint32_t seam = block->length;
+    uint32_t seam_token = block->tokens->count;
+    if (!ReserveText(block, (size_t)block->length + next->length)) return false;
+
+    memcpy(block->text + block->length, next->text, next->length);
+    block->length += next->length;
+    bool moved = AppendTokens(block->tokens, next->tokens, 0, next->tokens->count, seam) &&
+                 AppendStatements(block, next, 0, next->statement_count, seam_token);
+    DestroyBlock(next);
+    memmove(&parser->blocks[index + 1], &parser->blocks[index + 2],
+            (parser->block_count - index - 2) * sizeof(SourceBlock*));
+    parser->block_count--;
+
+    TextEdit edit = { seam, 0, 0 };
+    if (moved && UpdateBlock(parser, block, &edit, seam_token)) return true;
+    return RebuildBlock(parser, block);
+}
+
+// Just past the newline ending the line at pos, if only blanks precede it
+static size_t LineEndAfter(const char* text, size_t length, size_t pos) {
+    while (pos < length && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r')) pos++;
+    return pos < length && text[pos] == '\n' ? pos + 1 : 0;
+}
+
+// Splits an oversized block after the first ';' past its middle that
+// ends a line, so both halves are self-contained. The tail takes the
+// tokens and trees after the cut; neither half is lexed again.
+static bool SplitBlock(IncrementalParser* parser, uint32_t index) {
+    SourceBlock* block = parser->blocks[index];
+    const TokenBuffer* tokens = block->tokens;
+
+    size_t cut = 0;
+    uint32_t last = 0;
+    for (; last < tokens->count; last++) {
+        if (tokens->types[last] != TOKEN_PUNCT_SEMICOLON || tokens->offsets[last] < block->length / 2) continue;
+        cut = LineEndAfter(block->text, block->length, (size_t)tokens->offsets[last] + 1);
+        if (cut) break;
+    }
+    if (!cut || cut == block->length) return true;
+
+    uint32_t token = last + 1;
+    uint32_t statement = FindStatement(block, last) + 1;
+    SourceBlock* tail = CreateBlock(block->text + cut, block->length - cut);
+    if (!tail) return false;
+    if (!AppendTokens(tail->tokens, tokens, token, tokens->count - token, -(int64_t)cut) ||
+        !AppendStatements(tail, block, statement, block->statement_count - statement, -(int64_t)token) ||
+        !InsertBlock(parser, index + 1, tail)) {
+        DestroyBlock(tail);
+        return false;
+    }
+    tail->tokens->text = tail->text;
+
+    block->length = (uint32_t)cut;
+    block->tokens->count = token;
+    block->statement_count = statement;
+    return CompactBlock(block);
+}
+
+// Parser lifetime
+
+IncrementalParser* IncrementalParser_create(const char* text, size_t length, StringInterner* interner) {
+    if (!text && length) return NULL;
+
+    IncrementalParser* parser = (IncrementalParser*)calloc(1, sizeof(IncrementalParser));
+    if (!parser) return NULL;
+    parser->interner = interner;
+    parser->length = length;
+    parser->parser = ExprParser_create();
+
+    // Cut at the first line-ending ';' after every INCREMENTAL_BLOCK_SIZE bytes
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    Lexer* lexer = Lexer_createFromBuffer(text, length, "<buffer>");
+    bool ok = parser->parser && tokens && lexer;
+    if (ok) {
+        lexer->skip_comments = true;
+        lexer->track_lines = false;
+        Lexer_fillBuffer(lexer, tokens);
+    }
+
+    size_t start = 0;
+    for (uint32_t i = 0; ok && i < tokens->count; i++) {
+        size_t end = (size_t)tokens->offsets[i] + 1;
+        if (tokens->types[i] != TOKEN_PUNCT_SEMICOLON || end - start < INCREMENTAL_BLOCK_SIZE) continue;
+
+        size_t cut = LineEndAfter(text, length, end);
+        if (!cut || cut == length) continue;
+        SourceBlock* block = CreateBlock(text + start, cut - start);
+        ok = block && InsertBlock(parser, parser->block_count, block);
+        if (block && !ok) DestroyBlock(block);
+        start = cut;
+    }
+    Lexer_destroy(lexer);
+    TokenBuffer_destroy(tokens);
+
+    if (ok) {
+        SourceBlock* block = CreateBlock(text + start, length - start);
+        ok = block && InsertBlock(parser, parser->block_count, block);
+        if (block && !ok) DestroyBlock(block);
+    }
+    for (uint32_t i = 0; ok && i < parser->block_count; i++) {
+        ok = RebuildBlock(parser, parser->blocks[i]);
+    }
+    if (!ok) {
+        IncrementalParser_destroy(parser);
+        return NULL;
+    }
+    return parser;
+}
+
+void IncrementalParser_destroy(IncrementalParser* parser) {
+    if (!parser) return;
+    for (uint32_t i = 0; i < parser->block_count; i++) {
+        DestroyBlock(parser->blocks[i]);
+    }
+    free(parser->blocks);
+    free(parser->scratch);
+    ExprParser_destroy(parser->parser);
+    free(parser);
+}
+
+uint32_t IncrementalParser_findBlock(const IncrementalParser* parser, size_t offset, size_t* base) {
+    size_t start = 0;
+    uint32_t index = 0;
+    while (index + 1 < parser->block_count && offset >= start + parser->blocks[index]->length) {
+        start += parser->blocks[index]->length;
+        index++;
+    }
+    if (base) *base = start;
+    return index;
+}
+
+// Editing
+
+bool IncrementalParser_edit(IncrementalParser* parser, size_t offset, size_t removed,
+                            const char* inserted, size_t inserted_length) {
+    if (!parser || offset > parser->length || removed > parser->length - offset) return false;
+    if (!inserted && inserted_length) return false;
+
+    parser->relexed_tokens = 0;
+    parser->reparsed_statements = 0;
+    parser->rebuilt_blocks = 0;
+
+    // An edit that reaches into later blocks first takes them over
+    size_t base;
+    uint32_t index = IncrementalParser_findBlock(parser, offset, &base);
+    while (index + 1 < parser->block_count && offset + removed > base + parser->blocks[index]->length) {
+        if (!JoinNext(parser, index)) return false;
+    }
+
+    SourceBlock* block = parser->blocks[index];
+    TextEdit edit = { offset - base, removed, inserted_length };
+    if (!EditText(block, &edit, inserted)) return false;
+    parser->length = parser->length - removed + inserted_length;
+
+    if (!UpdateBlock(parser, block, &edit, UINT32_MAX) && !RebuildBlock(parser, block)) return false;
+
+    // Keep blocks self-contained and near their intended size
+    while (index + 1 < parser->block_count &&
+           (!IsSelfContained(block) || block->length < INCREMENTAL_BLOCK_SIZE / 4)) {
+        if (!JoinNext(parser, index)) return false;
+    }
+    if (block->length > 2 * INCREMENTAL_BLOCK_SIZE) return SplitBlock(parser, index);
+    return true;
+}
@@ -0,0 +1,78 @@
+#ifndef INCREMENTAL_PARSER_H
+#define INCREMENTAL_PARSER_H
+
+#include "expr_parser.h"
+#include "core/tokenizer/lexer/lex_incremental.h"
+
+// Text bytes a block is built around; blocks split at twice this and
+// merge into the next block below a quarter of it
+#define INCREMENTAL_BLOCK_SIZE (8 * 1024)
+// Dead nodes a block tolerates before its pool is compacted
+#define INCREMENTAL_MIN_DEAD_NODES 256
+
+// A top-level statement: the expression in tokens [begin, end) of its
+// block, ended by the ';' at end or by the end of the block
+typedef struct ParsedStatement {
+    uint32_t begin;
+    uint32_t end;
+    AstNodeId root;         // AST_NODE_NONE if the expression did not parse
+    AstNodeId first_node;   // Start of the tree's run of nodes
+} ParsedStatement;
+
+// A run of whole statements that lexes and parses on its own. Unless
+// it is the document's last block, it ends with a newline after its
+// last token, a ';', so the serial lexer starts a fresh scan where the
+// next block starts. Token offsets and node tokens are block-relative.
+typedef struct SourceBlock {
+    char* text;
+    uint32_t length;
+    uint32_t capacity;
+    TokenBuffer* tokens;    // Comments skipped, no TOKEN_EOF
+    AstPool* pool;
+    ParsedStatement* statements;
+    uint32_t statement_count;
+    uint32_t statement_capacity;
+    uint32_t dead_nodes;    // Nodes of replaced trees
+} SourceBlock;
+
+// Lexed and parsed source that follows edits. An edit re-lexes its
+// block from the first token it can have changed until the token stream
+// falls back in step, and re-parses only the statements whose tokens
+// changed; every other statement keeps its tree, whose node tokens are
+// shifted when the edit changed the token count. No edit touches more
+// than the blocks it falls in, so its cost does not grow with the
+// document. A block that stops being self-contained, for instance
+// because a comment now runs past its end, takes over the next one,
+// whose tokens and trees are kept but for those about the seam. That
+// is the exception to the bound: a comment opened with no '*/' after it
+// takes over every later block, and closing it splits them out again,
+// each at a cost that grows with the rest of the document.
+typedef struct IncrementalParser {
+    SourceBlock** blocks;
+    uint32_t block_count;
+    uint32_t block_capacity;
+    size_t length;
+    ExprParser* parser;
+    StringInterner* interner;   // Not owned; NULL leaves lexemes unset
+    ParsedStatement* scratch;   // Statements being re-parsed
+    uint32_t scratch_count;
+    uint32_t scratch_capacity;
+
+    // Work done by the last edit
+    uint32_t relexed_tokens;
+    uint32_t reparsed_statements;
+    uint32_t rebuilt_blocks;
+} IncrementalParser;
+
+// Parser lifetime; the text is copied
+IncrementalParser* IncrementalParser_create(const char* text, size_t length, StringInterner* interner);
+void IncrementalParser_destroy(IncrementalParser* parser);
+
+// Replaces bytes [offset, offset + removed) with inserted_length bytes
+bool IncrementalParser_edit(IncrementalParser* parser, size_t offset, size_t removed,
+                            const char* inserted, size_t inserted_length);
+
+// Block holding a document offset; *base receives the block's start
+uint32_t IncrementalParser_findBlock(const IncrementalParser* parser, size_t offset, size_t* base);
+
+#endif // INCREMENTAL_PARSER_H
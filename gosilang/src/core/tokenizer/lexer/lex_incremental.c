@@ -0,0 +1,93 @@
+#include "lex_incremental.h"
+#include <string.h>
+
+// First token whose scan may have read a byte at or after offset
+static uint32_t FirstAffected(const TokenBuffer* buffer, size_t offset) {
+    uint32_t low = 0;
+    uint32_t high = buffer->count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        size_t end = (size_t)buffer->offsets[mid] + buffer->lengths[mid] + LEX_INCREMENTAL_LOOKAHEAD;
+        if (end < offset) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// Moves the tokens from index 'from' on to index 'to', in every column
+static void MoveTokens(TokenBuffer* buffer, uint32_t to, uint32_t from) {
+    uint32_t count = buffer->count - from;
+    memmove(buffer->types + to, buffer->types + from, count);
+    memmove(buffer->categories + to, buffer->categories + from, count);
+    memmove(buffer->offsets + to, buffer->offsets + from, count * sizeof(uint32_t));
+    memmove(buffer->lengths + to, buffer->lengths + from, count * sizeof(uint32_t));
+    memmove(buffer->lexemes + to, buffer->lexemes + from, count * sizeof(LexemeId));
+    memmove(buffer->attributes + to, buffer->attributes + from, count * sizeof(uint16_t));
+}
+
+static void CopyTokens(TokenBuffer* buffer, uint32_t at, const TokenBuffer* source) {
+    uint32_t count = source->count;
+    memcpy(buffer->types + at, source->types, count);
+    memcpy(buffer->categories + at, source->categories, count);
+    memcpy(buffer->offsets + at, source->offsets, count * sizeof(uint32_t));
+    memcpy(buffer->lengths + at, source->lengths, count * sizeof(uint32_t));
+    memcpy(buffer->lexemes + at, source->lexemes, count * sizeof(LexemeId));
+    memcpy(buffer->attributes + at, source->attributes, count * sizeof(uint16_t));
+}
+
+bool Lexer_relexBuffer(Lexer* lexer, TokenBuffer* buffer, const TextEdit* edit, TokenEdit* result) {
+    if (!lexer || !buffer || !edit || !result || lexer->fd >= 0) return false;
+    if (edit->offset + edit->inserted > lexer->length) return false;
+
+    size_t removed_end = edit->offset + edit->removed;
+    int64_t delta = (int64_t)edit->inserted - (int64_t)edit->removed;
+    uint32_t first = FirstAffected(buffer, edit->offset);
+
+    TokenBuffer* fresh = TokenBuffer_create(0);
+    if (!fresh) return false;
+
+    // Tokens before first end before the edit, so the scan resumes
+    // where the last of them ends
+    lexer->pos = first ? (size_t)buffer->offsets[first - 1] + buffer->lengths[first - 1] : 0;
+    lexer->done = false;
+
+    uint32_t next = first;
+    TokenSpan span;
+    while (Lexer_nextSpan(lexer, &span)) {
+        // Old tokens that overlap the removed bytes or start before the
+        // new token can no longer match
+        while (next < buffer->count &&
+               (buffer->offsets[next] < removed_end || buffer->offsets[next] + delta < span.offset)) {
+            next++;
+        }
+        if (next < buffer->count && buffer->offsets[next] + delta == span.offset) break;
+
+        // A buffer that ends in TOKEN_EOF always matches on it
+        if (span.type == TOKEN_EOF) break;
+        if (TokenBuffer_append(fresh, (TokenType)span.type, span.offset, span.length,
+                               span.lexeme) == UINT32_MAX) {
+            TokenBuffer_destroy(fresh);
+            return false;
+        }
+    }
+
+    uint64_t count = (uint64_t)buffer->count - (next - first) + fresh->count;
+    if (count >= UINT32_MAX || !TokenBuffer_reserve(buffer, (uint32_t)count)) {
+        TokenBuffer_destroy(fresh);
+        return false;
+    }
+
+    MoveTokens(buffer, first + fresh->count, next);
+    CopyTokens(buffer, first, fresh);
+    buffer->count = (uint32_t)count;
+    for (uint32_t i = first + fresh->count; i < buffer->count; i++) {
+        buffer->offsets[i] = (uint32_t)(buffer->offsets[i] + delta);
+    }
+    buffer->text = lexer->data;
+
+    result->first = first;
+    result->removed = next - first;
+    result->inserted = fresh->count;
+    TokenBuffer_destroy(fresh);
+    return true;
+}
@@ -0,0 +1,35 @@
+#ifndef LEX_INCREMENTAL_H
+#define LEX_INCREMENTAL_H
+
+#include "lexer.h"
+
+// Bytes past a token's end that scanning it may read ('<' looks two
+// bytes ahead for '<<='), so an edit that close can change the token
+#define LEX_INCREMENTAL_LOOKAHEAD 2
+
+// Bytes [offset, offset + removed) of a text were replaced by inserted bytes
+typedef struct TextEdit {
+    size_t offset;
+    size_t removed;
+    size_t inserted;
+} TextEdit;
+
+// Tokens [first, first + removed) of a buffer were replaced by
+// [first, first + inserted); tokens after them moved by the difference
+typedef struct TokenEdit {
+    uint32_t first;
+    uint32_t removed;
+    uint32_t inserted;
+} TokenEdit;
+
+// Brings a buffer that Lexer_fillBuffer filled from the whole old text
+// up to date with the edited text the buffer lexer reads, with the same
+// options. Lexing restarts at the first token the edit can have
+// changed and stops at the first new token that starts where an old
+// token after the edit, moved by the edit's length change, started:
+// from there the old tokens are still right, since a token depends only
+// on the bytes from its start. The rest of the buffer is shifted, not
+// lexed again. Returns false, leaving the buffer as it was, on failure.
+bool Lexer_relexBuffer(Lexer* lexer, TokenBuffer* buffer, const TextEdit* edit, TokenEdit* result);
+
+#endif // LEX_INCREMENTAL_H
@@ -0,0 +1,272 @@
+#define _GNU_SOURCE
+#include "lex_parallel.h"
+#include "core/trace/trace.h"
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// A slice of the input; tokens starting in [begin, end) belong to it.
+// The last chunk ends one past the input so that it owns TOKEN_EOF.
+typedef struct LexChunk {
+    const Lexer* lexer;         // Input and options
+    size_t begin;
+    size_t end;
+    TokenBuffer* tokens;        // Lexed as if the chunk began in code
+    TokenBuffer* relexed;       // Lexed again while stitching, NULL if none
+    uint32_t first;             // First speculative token that is kept
+    uint32_t output;            // Index of the chunk's first token in the result
+    uint32_t errors;
+    TokenBuffer* target;
+    bool failed;
+    WorkTask task;
+} LexChunk;
+
+// A lexer over the same input and options, starting at pos. Errors are
+// counted once the stream is final, not while speculating.
+static Lexer* CreateChunkLexer(const Lexer* lexer, size_t pos) {
+    Lexer* chunk_lexer = Lexer_createFromBuffer(lexer->data, lexer->length, lexer->file_name);
+    if (!chunk_lexer) return NULL;
+
+    chunk_lexer->simd = lexer->simd;
+    chunk_lexer->skip_comments = lexer->skip_comments;
+    chunk_lexer->track_lines = false;
+    chunk_lexer->quiet = true;
+    chunk_lexer->pos = pos;
+    return chunk_lexer;
+}
+
+// First line start at or after pos whose previous line does not end in
+// a backslash, or length if there is none
+static size_t NextSplit(const char* data, size_t length, size_t pos) {
+    while (pos < length) {
+        const char* newline = (const char*)memchr(data + pos, '\n', length - pos);
+        if (!newline) return length;
+
+        const char* last = newline;
+        if (last > data && last[-1] == '\r') last--;
+        if (last == data || last[-1] != '\\') return (size_t)(newline - data) + 1;
+        pos = (size_t)(newline - data) + 1;
+    }
+    return length;
+}
+
+static void LexChunkTask(void* data) {
+    LexChunk* chunk = (LexChunk*)data;
+    Lexer* lexer = CreateChunkLexer(chunk->lexer, chunk->begin);
+    chunk->tokens = TokenBuffer_create((uint32_t)((chunk->end - chunk->begin) / 8) + 16);
+    if (!lexer || !chunk->tokens) {
+        Lexer_destroy(lexer);
+        chunk->failed = true;
+        return;
+    }
+
+    TokenSpan span;
+    while (Lexer_nextSpan(lexer, &span) && span.offset < chunk->end) {
+        if (TokenBuffer_append(chunk->tokens, (TokenType)span.type, span.offset,
+                               span.length, span.lexeme) == UINT32_MAX) {
+            chunk->failed = true;
+            break;
+        }
+    }
+    Lexer_destroy(lexer);
+}
+
+// Continues the serial stream into the chunk. Tokens are lexed again
+// until one starts where a speculative token does; from there on the
+// chunk's tokens are what the serial lexer would produce, since a
+// token depends only on where it starts. A token that starts past the
+// chunk is left pending for the next one.
+static bool StitchChunk(Lexer* serial, LexChunk* chunk, TokenSpan* pending, bool* has_pending) {
+    const TokenBuffer* tokens = chunk->tokens;
+    uint32_t i = 0;
+    chunk->first = tokens->count;
+
+    for (;;) {
+        if (!*has_pending) {
+            if (!Lexer_nextSpan(serial, pending)) return true;
+            *has_pending = true;
+        }
+        if (pending->offset >= chunk->end) return true;
+
+        while (i < tokens->count && tokens->offsets[i] < pending->offset) i++;
+        if (i < tokens->count && tokens->offsets[i] == pending->offset) {
+            uint32_t last = tokens->count - 1;
+            chunk->first = i;
+            serial->pos = (size_t)tokens->offsets[last] + tokens->lengths[last];
+            *has_pending = false;
+            return true;
+        }
+
+        if (!chunk->relexed && !(chunk->relexed = TokenBuffer_create(0))) return false;
+        if (TokenBuffer_append(chunk->relexed, (TokenType)pending->type, pending->offset,
+                               pending->length, pending->lexeme) == UINT32_MAX) {
+            return false;
+        }
+        *has_pending = false;
+    }
+}
+
+// Copies count tokens from source[first] to target[at]; returns the
+// number of error tokens among them
+static uint32_t CopyTokens(TokenBuffer* target, uint32_t at, const TokenBuffer* source,
+                           uint32_t first, uint32_t count) {
+    memcpy(target->types + at, source->types + first, count);
+    memcpy(target->categories + at, source->categories + first, count);
+    memcpy(target->offsets + at, source->offsets + first, count * sizeof(uint32_t));
+    memcpy(target->lengths + at, source->lengths + first, count * sizeof(uint32_t));
+    memcpy(target->lexemes + at, source->lexemes + first, count * sizeof(LexemeId));
+    memcpy(target->attributes + at, source->attributes + first, count * sizeof(uint16_t));
+
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        errors += source->types[first + i] == TOKEN_ERROR;
+    }
+    return errors;
+}
+
+static void CopyChunkTask(void* data) {
+    LexChunk* chunk = (LexChunk*)data;
+    uint32_t at = chunk->output;
+
+    if (chunk->relexed) {
+        chunk->errors += CopyTokens(chunk->target, at, chunk->relexed, 0, chunk->relexed->count);
+        at += chunk->relexed->count;
+    }
+    chunk->errors += CopyTokens(chunk->target, at, chunk->tokens, chunk->first,
+                                chunk->tokens->count - chunk->first);
+}
+
+static void RunChunks(WorkPool* pool, LexChunk* chunks, size_t count, WorkFunction function) {
+    WorkGroup group;
+    WorkGroup_init(&group);
+    for (size_t i = 0; i < count; i++) {
+        WorkTask_init(&chunks[i].task, function, &chunks[i]);
+        WorkPool_submit(pool, &group, &chunks[i].task);
+    }
+    WorkPool_wait(pool, &group);
+}
+
+// Serial lexing interns in token order; doing the same here gives the
+// same ids
+static void InternTokens(StringInterner* interner, TokenBuffer* buffer, uint32_t first) {
+    for (uint32_t i = first; i < buffer->count; i++) {
+        TokenType type = (TokenType)buffer->types[i];
+        if (buffer->lexemes[i] || type == TOKEN_EOF ||
+            type == TOKEN_COMMENT_SINGLE || type == TOKEN_COMMENT_MULTI) {
+            continue;
+        }
+        buffer->lexemes[i] = StringInterner_intern(interner, buffer->text + buffer->offsets[i],
+                                                   buffer->lengths[i]);
+    }
+}
+
+static void TraceErrors(const Lexer* lexer, const TokenBuffer* buffer, uint32_t first) {
+    for (uint32_t i = first; i < buffer->count; i++) {
+        if (buffer->types[i] != TOKEN_ERROR) continue;
+        TRACE(TRACE_LEXER, "%s: offset %u: invalid token '%.*s'", lexer->file_name,
+              buffer->offsets[i], (int)buffer->lengths[i], lexer->data + buffer->offsets[i]);
+    }
+    (void)lexer;
+}
+
+static void FreeChunks(LexChunk* chunks, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        TokenBuffer_destroy(chunks[i].tokens);
+        TokenBuffer_destroy(chunks[i].relexed);
+    }
+    free(chunks);
+}
+
+// CPUs this process may run on; a pool with more threads than that
+// only takes turns
+static uint32_t UsableCpus(void) {
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0) return (uint32_t)CPU_COUNT(&set);
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (uint32_t)online : 1;
+}
+
+size_t Lexer_fillBufferParallel(Lexer* lexer, TokenBuffer* buffer, WorkPool* pool) {
+    if (!lexer || !buffer) return 0;
+
+    uint32_t threads = pool ? WorkPool_threadCount(pool) : 1;
+    size_t remaining = lexer->pos < lexer->length ? lexer->length - lexer->pos : 0;
+    if (threads < 2 || remaining < LEX_PARALLEL_MIN_INPUT) return Lexer_fillBuffer(lexer, buffer);
+
+    uint32_t cpus = UsableCpus();
+    if (cpus < threads) threads = cpus;
+    if (threads < 2) return Lexer_fillBuffer(lexer, buffer);
+    return Lexer_fillBufferChunks(lexer, buffer, pool, (size_t)threads * LEX_PARALLEL_CHUNKS_PER_THREAD);
+}
+
+size_t Lexer_fillBufferChunks(Lexer* lexer, TokenBuffer* buffer, WorkPool* pool, size_t chunk_count) {
+    if (!lexer || !buffer) return 0;
+
+    size_t start = lexer->pos;
+    size_t remaining = lexer->pos < lexer->length ? lexer->length - start : 0;
+    if (chunk_count > remaining / LEX_PARALLEL_MIN_CHUNK) chunk_count = remaining / LEX_PARALLEL_MIN_CHUNK;
+    if (lexer->fd >= 0 || lexer->done || !pool || chunk_count < 2) {
+        return Lexer_fillBuffer(lexer, buffer);
+    }
+
+    LexChunk* chunks = (LexChunk*)calloc(chunk_count, sizeof(LexChunk));
+    if (!chunks) return Lexer_fillBuffer(lexer, buffer);
+
+    size_t used = 0;
+    size_t step = remaining / chunk_count;
+    for (size_t begin = start; begin <= lexer->length; used++) {
+        size_t end = used + 1 < chunk_count ? NextSplit(lexer->data, lexer->length, begin + step)
+                                            : lexer->length;
+        if (end >= lexer->length) end = lexer->length + 1;
+        chunks[used].lexer = lexer;
+        chunks[used].begin = begin;
+        chunks[used].end = end;
+        chunks[used].target = buffer;
+        begin = end;
+    }
+
+    RunChunks(pool, chunks, used, LexChunkTask);
+
+    // Stitch in order, then size the result
+    Lexer* serial = CreateChunkLexer(lexer, start);
+    bool ok = serial != NULL;
+    TokenSpan pending;
+    bool has_pending = false;
+    for (size_t i = 0; i < used && ok; i++) {
+        ok = !chunks[i].failed && StitchChunk(serial, &chunks[i], &pending, &has_pending);
+    }
+    Lexer_destroy(serial);
+
+    uint32_t first = buffer->count;
+    size_t total = first;
+    for (size_t i = 0; i < used && ok; i++) {
+        chunks[i].output = (uint32_t)total;
+        total += chunks[i].tokens->count - chunks[i].first;
+        if (chunks[i].relexed) total += chunks[i].relexed->count;
+        ok = total < UINT32_MAX;
+    }
+    if (!ok || !TokenBuffer_reserve(buffer, (uint32_t)total)) {
+        FreeChunks(chunks, used);
+        return Lexer_fillBuffer(lexer, buffer);
+    }
+
+    buffer->text = lexer->data;
+    buffer->interner = lexer->interner;
+    buffer->source = lexer->source;
+    RunChunks(pool, chunks, used, CopyChunkTask);
+    buffer->count = (uint32_t)total;
+
+    uint32_t errors = 0;
+    for (size_t i = 0; i < used; i++) {
+        errors += chunks[i].errors;
+    }
+    FreeChunks(chunks, used);
+
+    if (lexer->interner) InternTokens(lexer->interner, buffer, first);
+    if (errors && Trace_isEnabled(TRACE_LEXER)) TraceErrors(lexer, buffer, first);
+    lexer->error_count += (int)errors;
+    lexer->pos = lexer->length;
+    lexer->done = true;
+    return total - first;
+}
@@ -0,0 +1,40 @@
+#ifndef LEX_PARALLEL_H
+#define LEX_PARALLEL_H
+
+#include "lexer.h"
+#include "runtime/concurrency/pool/work_pool.h"
+
+// Smallest chunk worth a task of its own
+#define LEX_PARALLEL_MIN_CHUNK (256 * 1024)
+// Chunks per thread, so threads that finish early pick up more
+#define LEX_PARALLEL_CHUNKS_PER_THREAD 4
+// Smaller input is lexed serially. Splitting adds a copy pass,
+// stitching and thread wake-ups, about half again the serial time, and
+// below a few MB that is not won back.
+#define LEX_PARALLEL_MIN_INPUT (4u * 1024 * 1024)
+
+// Parallel Lexer_fillBuffer for buffer and source lexers. The remaining
+// input is split after newlines that no backslash continues, so no
+// string, line comment or directive crosses a split; each chunk is then
+// lexed on the pool as if it began in code. A chunk that really begins
+// inside a block comment is repaired when the chunks are stitched: from
+// where the previous chunk's last token ends, tokens are lexed again
+// until one starts where a speculative token does, and the chunk's
+// tokens from there on are kept.
+//
+// The buffer receives the same tokens the serial lexer produces, with
+// the same interned lexeme ids; interning runs after stitching, in
+// token order. Falls back to Lexer_fillBuffer for descriptor input,
+// input under LEX_PARALLEL_MIN_INPUT, and when fewer than two of the
+// pool's threads can run at once: a NULL or single-thread pool, or a
+// process allowed on a single CPU, where the extra pass only makes
+// lexing slower. Returns the number of tokens appended.
+size_t Lexer_fillBufferParallel(Lexer* lexer, TokenBuffer* buffer, WorkPool* pool);
+
+// Lexes in up to chunk_count chunks of at least LEX_PARALLEL_MIN_CHUNK
+// bytes whatever the input size and CPU count, so tests and benchmarks
+// can exercise stitching anywhere. Falls back to Lexer_fillBuffer only
+// for descriptor input, a NULL pool or fewer than two chunks.
+size_t Lexer_fillBufferChunks(Lexer* lexer, TokenBuffer* buffer, WorkPool* pool, size_t chunk_count);
+
+#endif // LEX_PARALLEL_H
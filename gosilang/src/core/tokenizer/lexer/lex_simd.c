@@ -0,0 +1,290 @@
+#include "lex_simd.h"
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LEX_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+static inline bool IsWhitespace(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline bool IsIdentChar(unsigned char c) {
+    return (unsigned char)((c | 0x20) - 'a') < 26 ||
+           (unsigned char)(c - '0') < 10 ||
+           c == '_';
+}
+
+// Folds a bitmask of newline positions relative to p into lines
+static inline void CountNewlines(LexNewlines* lines, const char* p, uint32_t mask) {
+    if (!mask) return;
+    lines->count += __builtin_popcount(mask);
+    lines->last = p + (31 - __builtin_clz(mask)) + 1;
+}
+
+// Scalar kernels, also used for the tails of the vector kernels
+static const char* SkipWhitespaceScalar(const char* p, const char* end, LexNewlines* lines) {
+    for (; p < end && IsWhitespace((unsigned char)*p); p++) {
+        if (*p == '\n') {
+            lines->count++;
+            lines->last = p + 1;
+        }
+    }
+    return p;
+}
+
+static const char* ScanIdentifierScalar(const char* p, const char* end) {
+    while (p < end && IsIdentChar((unsigned char)*p)) {
+        p++;
+    }
+    return p;
+}
+
+static const char* FindCommentEndScalar(const char* p, const char* end, LexNewlines* lines) {
+    for (; p < end; p++) {
+        if (*p == '*' && p + 1 < end && p[1] == '/') return p;
+        if (*p == '\n') {
+            lines->count++;
+            lines->last = p + 1;
+        }
+    }
+    return end;
+}
+
+static const char* FindLineEndScalar(const char* p, const char* end) {
+    const char* newline = (const char*)memchr(p, '\n', (size_t)(end - p));
+    return newline ? newline : end;
+}
+
+static const LexSimdKernels scalar_kernels = {
+    "scalar",
+    LEX_SIMD_SCALAR,
+    SkipWhitespaceScalar,
+    ScanIdentifierScalar,
+    FindCommentEndScalar,
+    FindLineEndScalar
+};
+
+#ifdef LEX_SIMD_X86
+
+// (v - lo) <= (hi - lo) as unsigned bytes
+#define SSE2_IN_RANGE(v, lo, hi) \
+    _mm_cmpeq_epi8(_mm_min_epu8(_mm_sub_epi8((v), _mm_set1_epi8((char)(lo))), \
+                                _mm_set1_epi8((char)((hi) - (lo)))), \
+                   _mm_sub_epi8((v), _mm_set1_epi8((char)(lo))))
+
+#define SSE2_TARGET __attribute__((target("sse2")))
+
+SSE2_TARGET
+static const char* SkipWhitespaceSse2(const char* p, const char* end, LexNewlines* lines) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        uint32_t ws = (uint32_t)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, space), SSE2_IN_RANGE(v, '\t', '\r')));
+        uint32_t nl = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        if (ws != 0xFFFF) {
+            uint32_t stop = (uint32_t)__builtin_ctz(~ws);
+            CountNewlines(lines, p, nl & ((1u << stop) - 1));
+            return p + stop;
+        }
+        CountNewlines(lines, p, nl);
+        p += 16;
+    }
+    return SkipWhitespaceScalar(p, end, lines);
+}
+
+SSE2_TARGET
+static const char* ScanIdentifierSse2(const char* p, const char* end) {
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i underscore = _mm_set1_epi8('_');
+
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i alpha = SSE2_IN_RANGE(_mm_or_si128(v, lower), 'a', 'z');
+        __m128i digit = SSE2_IN_RANGE(v, '0', '9');
+        __m128i ident = _mm_or_si128(_mm_or_si128(alpha, digit), _mm_cmpeq_epi8(v, underscore));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(ident);
+        if (mask != 0xFFFF) return p + __builtin_ctz(~mask);
+        p += 16;
+    }
+    return ScanIdentifierScalar(p, end);
+}
+
+SSE2_TARGET
+static const char* FindCommentEndSse2(const char* p, const char* end, LexNewlines* lines) {
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    // The second load covers the byte after each candidate '*'
+    while (end - p >= 17) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i next = _mm_loadu_si128((const __m128i*)(p + 1));
+        uint32_t close = (uint32_t)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(v, star), _mm_cmpeq_epi8(next, slash)));
+        uint32_t nl = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        if (close) {
+            uint32_t stop = (uint32_t)__builtin_ctz(close);
+            CountNewlines(lines, p, nl & ((1u << stop) - 1));
+            return p + stop;
+        }
+        CountNewlines(lines, p, nl);
+        p += 16;
+    }
+    return FindCommentEndScalar(p, end, lines);
+}
+
+SSE2_TARGET
+static const char* FindLineEndSse2(const char* p, const char* end) {
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return FindLineEndScalar(p, end);
+}
+
+static const LexSimdKernels sse2_kernels = {
+    "sse2",
+    LEX_SIMD_SSE2,
+    SkipWhitespaceSse2,
+    ScanIdentifierSse2,
+    FindCommentEndSse2,
+    FindLineEndSse2
+};
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+#define AVX2_IN_RANGE(v, lo, hi) \
+    _mm256_cmpeq_epi8(_mm256_min_epu8(_mm256_sub_epi8((v), _mm256_set1_epi8((char)(lo))), \
+                                      _mm256_set1_epi8((char)((hi) - (lo)))), \
+                      _mm256_sub_epi8((v), _mm256_set1_epi8((char)(lo))))
+
+AVX2_TARGET
+static const char* SkipWhitespaceAvx2(const char* p, const char* end, LexNewlines* lines) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        uint32_t ws = (uint32_t)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, space), AVX2_IN_RANGE(v, '\t', '\r')));
+        uint32_t nl = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+        if (ws != 0xFFFFFFFFu) {
+            uint32_t stop = (uint32_t)__builtin_ctz(~ws);
+            CountNewlines(lines, p, stop ? nl & (0xFFFFFFFFu >> (32 - stop)) : 0);
+            return p + stop;
+        }
+        CountNewlines(lines, p, nl);
+        p += 32;
+    }
+    return SkipWhitespaceSse2(p, end, lines);
+}
+
+AVX2_TARGET
+static const char* ScanIdentifierAvx2(const char* p, const char* end) {
+    const __m256i lower = _mm256_set1_epi8(0x20);
+    const __m256i underscore = _mm256_set1_epi8('_');
+
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        __m256i alpha = AVX2_IN_RANGE(_mm256_or_si256(v, lower), 'a', 'z');
+        __m256i digit = AVX2_IN_RANGE(v, '0', '9');
+        __m256i ident = _mm256_or_si256(_mm256_or_si256(alpha, digit),
+                                        _mm256_cmpeq_epi8(v, underscore));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(ident);
+        if (mask != 0xFFFFFFFFu) return p + __builtin_ctz(~mask);
+        p += 32;
+    }
+    return ScanIdentifierSse2(p, end);
+}
+
+AVX2_TARGET
+static const char* FindCommentEndAvx2(const char* p, const char* end, LexNewlines* lines) {
+    const __m256i star = _mm256_set1_epi8('*');
+    const __m256i slash = _mm256_set1_epi8('/');
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    while (end - p >= 33) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        __m256i next = _mm256_loadu_si256((const __m256i*)(p + 1));
+        uint32_t close = (uint32_t)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(v, star), _mm256_cmpeq_epi8(next, slash)));
+        uint32_t nl = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+        if (close) {
+            uint32_t stop = (uint32_t)__builtin_ctz(close);
+            CountNewlines(lines, p, stop ? nl & (0xFFFFFFFFu >> (32 - stop)) : 0);
+            return p + stop;
+        }
+        CountNewlines(lines, p, nl);
+        p += 32;
+    }
+    return FindCommentEndSse2(p, end, lines);
+}
+
+AVX2_TARGET
+static const char* FindLineEndAvx2(const char* p, const char* end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return FindLineEndSse2(p, end);
+}
+
+static const LexSimdKernels avx2_kernels = {
+    "avx2",
+    LEX_SIMD_AVX2,
+    SkipWhitespaceAvx2,
+    ScanIdentifierAvx2,
+    FindCommentEndAvx2,
+    FindLineEndAvx2
+};
+
+#endif // LEX_SIMD_X86
+
+bool LexSimd_isSupported(LexSimdLevel level) {
+    switch (level) {
+        case LEX_SIMD_SCALAR:
+        case LEX_SIMD_BEST:
+            return true;
+#ifdef LEX_SIMD_X86
+        case LEX_SIMD_SSE2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+        case LEX_SIMD_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+const LexSimdKernels* LexSimd_getKernels(LexSimdLevel level) {
+    if (level == LEX_SIMD_BEST) {
+        if (LexSimd_isSupported(LEX_SIMD_AVX2)) return LexSimd_getKernels(LEX_SIMD_AVX2);
+        if (LexSimd_isSupported(LEX_SIMD_SSE2)) return LexSimd_getKernels(LEX_SIMD_SSE2);
+        return &scalar_kernels;
+    }
+    if (!LexSimd_isSupported(level)) return NULL;
+
+    switch (level) {
+#ifdef LEX_SIMD_X86
+        case LEX_SIMD_SSE2: return &sse2_kernels;
+        case LEX_SIMD_AVX2: return &avx2_kernels;
+#endif
+        default: return &scalar_kernels;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef LEX_SIMD_H
+#define LEX_SIMD_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Instruction set used by the lexer's scanning kernels
+typedef enum {
+    LEX_SIMD_SCALAR,
+    LEX_SIMD_SSE2,
+    LEX_SIMD_AVX2,
+    LEX_SIMD_BEST       // Widest level supported by the running CPU
+} LexSimdLevel;
+
+// Newlines crossed by a kernel, so the lexer can keep line numbers
+typedef struct LexNewlines {
+    int count;
+    const char* last;   // Just past the last newline, NULL if none
+} LexNewlines;
+
+// Scanning kernels. Each returns the first byte in [p, end) that stops
+// the scan, or end. Kernels never read outside [p, end).
+typedef struct LexSimdKernels {
+    const char* name;
+    LexSimdLevel level;
+    const char* (*skipWhitespace)(const char* p, const char* end, LexNewlines* lines);
+    const char* (*scanIdentifier)(const char* p, const char* end);
+    const char* (*findCommentEnd)(const char* p, const char* end, LexNewlines* lines);
+    const char* (*findLineEnd)(const char* p, const char* end);
+} LexSimdKernels;
+
+// Kernel selection; returns NULL when the CPU lacks the requested level
+const LexSimdKernels* LexSimd_getKernels(LexSimdLevel level);
+bool LexSimd_isSupported(LexSimdLevel level);
+
+#endif // LEX_SIMD_H
@@ -0,0 +1,752 @@
+#include "lexer.h"
+#include "core/trace/trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+// Character classes driving the scanner
+enum {
+    CC_SPACE,
+    CC_NEWLINE,
+    CC_OTHER,
+    CC_IDENT,
+    CC_DIGIT,
+    CC_DQUOTE,
+    CC_SQUOTE,
+    CC_SLASH,
+    CC_HASH,
+    CC_DOT,
+    CC_PUNCT
+};
+
+#define X CC_OTHER
+#define S CC_SPACE
+#define N CC_NEWLINE
+#define I CC_IDENT
+#define D CC_DIGIT
+#define Q CC_DQUOTE
+#define A CC_SQUOTE
+#define L CC_SLASH
+#define H CC_HASH
+#define P CC_DOT
+#define O CC_PUNCT
+static const uint8_t char_classes[256] = {
+    X, X, X, X, X, X, X, X, X, S, N, S, S, S, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    S, O, Q, H, X, O, O, A, O, O, O, O, O, O, P, L,
+    D, D, D, D, D, D, D, D, D, D, O, O, O, O, O, O,
+    X, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, O, X, O, O, I,
+    X, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, O, O, O, O, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+};
+#undef X
+#undef S
+#undef N
+#undef I
+#undef D
+#undef Q
+#undef A
+#undef L
+#undef H
+#undef P
+#undef O
+
+// Identifier continuation characters
+static const uint8_t ident_chars[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1,
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+// Token type of each keyword
+static const TokenType keyword_token_types[KEYWORD_TYPE_COUNT] = {
+#define X(kw, spelling, type) [kw] = type,
+    KEYWORD_TYPE_LIST(X)
+#undef X
+};
+
+// Result of scanning one token from the start of a byte range
+typedef struct ScanResult {
+    TokenType type;
+    LexemeId lexeme;        // Reserved lexeme, or LEXEME_NONE
+    size_t length;
+    int newlines;           // Newlines inside the token
+    size_t line_start;      // Offset just past the token's last newline
+} ScanResult;
+
+static TokenType ReservedWordType(LexemeId lexeme) {
+    if (lexeme >= LEXEME_KEYWORD_FIRST && lexeme <= LEXEME_KEYWORD_LAST) {
+        return keyword_token_types[lexeme - LEXEME_KEYWORD_FIRST];
+    }
+    if (lexeme == LEXEME_TRUE || lexeme == LEXEME_FALSE) return TOKEN_LITERAL_BOOL;
+    if (lexeme == LEXEME_NULL) return TOKEN_LITERAL_NULL;
+    return TOKEN_LITERAL_IDENTIFIER;
+}
+
+static void ScanIdentifier(const char* p, const char* end, const Lexer* lexer, ScanResult* r) {
+    const char* q = p + 1;
+    if (q < end && ident_chars[(unsigned char)*q]) {
+        q = lexer->simd->scanIdentifier(q + 1, end);
+    }
+    r->length = (size_t)(q - p);
+    r->lexeme = ReservedTable_find(lexer->reserved, p, r->length);
+    r->type = ReservedWordType(r->lexeme);
+}
+
+// Scans a preprocessing number: digits, dots, exponents and suffixes
+static void ScanNumber(const char* p, const char* end, ScanResult* r) {
+    const char* q = p;
+    bool hex = (end - p) > 1 && p[0] == '0' && (p[1] | 0x20) == 'x';
+    bool is_float = false;
+
+    if (hex) q += 2;
+    while (q < end) {
+        unsigned char c = (unsigned char)*q;
+        if (c == '.') {
+            is_float = true;
+        } else if (!ident_chars[c]) {
+            break;
+        } else if ((!hex && (c | 0x20) == 'e') || (hex && (c | 0x20) == 'p')) {
+            is_float = true;
+            if (q + 1 < end && (q[1] == '+' || q[1] == '-')) q++;
+        }
+        q++;
+    }
+
+    r->type = is_float ? TOKEN_LITERAL_FLOAT : TOKEN_LITERAL_INTEGER;
+    r->length = (size_t)(q - p);
+}
+
+// Scans a string or character literal; unterminated literals end at the newline
+static void ScanQuoted(const char* p, const char* end, char quote, ScanResult* r) {
+    const char* q = p + 1;
+    r->type = TOKEN_ERROR;
+
+    while (q < end) {
+        char c = *q;
+        if (c == quote) {
+            q++;
+            r->type = quote == '"' ? TOKEN_LITERAL_STRING : TOKEN_LITERAL_CHAR;
+            break;
+        }
+        if (c == '\n') break;
+        if (c == '\\') {
+            if (q + 1 >= end) {
+                q = end;
+                break;
+            }
+            if (q[1] == '\n') {
+                r->newlines++;
+                r->line_start = (size_t)(q + 2 - p);
+            }
+            q += 2;
+            continue;
+        }
+        q++;
+    }
+    r->length = (size_t)(q - p);
+}
+
+static void ScanLineComment(const char* p, const char* end, const LexSimdKernels* simd, ScanResult* r) {
+    r->type = TOKEN_COMMENT_SINGLE;
+    r->length = (size_t)(simd->findLineEnd(p + 2, end) - p);
+}
+
+static void ScanBlockComment(const char* p, const char* end, const LexSimdKernels* simd, ScanResult* r) {
+    LexNewlines lines = { 0, NULL };
+    const char* q = simd->findCommentEnd(p + 2, end, &lines);
+
+    if (q < end) {
+        q += 2;
+        r->type = TOKEN_COMMENT_MULTI;
+    } else {
+        r->type = TOKEN_ERROR;
+    }
+    r->length = (size_t)(q - p);
+    r->newlines = lines.count;
+    if (lines.count) r->line_start = (size_t)(lines.last - p);
+}
+
+// A directive runs to the end of the line, following backslash continuations
+static void ScanPreprocessor(const char* p, const char* end, ScanResult* r) {
+    const char* q = p + 1;
+    r->type = TOKEN_PREPROCESSOR;
+
+    for (;;) {
+        const char* newline = (const char*)memchr(q, '\n', (size_t)(end - q));
+        if (!newline) {
+            q = end;
+            break;
+        }
+        const char* last = newline[-1] == '\r' && newline - 1 > p ? newline - 2 : newline - 1;
+        if (*last != '\\') {
+            q = newline;
+            break;
+        }
+        r->newlines++;
+        r->line_start = (size_t)(newline + 1 - p);
+        q = newline + 1;
+    }
+    r->length = (size_t)(q - p);
+}
+
+static void SetPunct(ScanResult* r, TokenType type, LexemeId lexeme, size_t length) {
+    r->type = type;
+    r->lexeme = lexeme;
+    r->length = length;
+}
+
+// Operators and punctuation by maximal munch
+static void ScanPunct(const char* p, const char* end, ScanResult* r) {
+    char c1 = p + 1 < end ? p[1] : '\0';
+    char c2 = p + 2 < end ? p[2] : '\0';
+
+    switch (*p) {
+        case '+':
+            if (c1 == '+') SetPunct(r, TOKEN_EXPR_UNARY, LEXEME_INCREMENT, 2);
+            else if (c1 == '=') SetPunct(r, TOKEN_EXPR_ASSIGNMENT, LEXEME_PLUS_ASSIGN, 2);
+            else SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_PLUS, 1);
+            break;
+        case '-':
+            if (c1 == '-') SetPunct(r, TOKEN_EXPR_UNARY, LEXEME_DECREMENT, 2);
+            else if (c1 == '=') SetPunct(r, TOKEN_EXPR_ASSIGNMENT, LEXEME_MINUS_ASSIGN, 2);
+            else if (c1 == '>') SetPunct(r, TOKEN_PUNCT_ARROW, LEXEME_ARROW, 2);
+            else SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_MINUS, 1);
+            break;
+        case '*':
+            if (c1 == '=') SetPunct(r, TOKEN_EXPR_ASSIGNMENT, LEXEME_STAR_ASSIGN, 2);
+            else SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_STAR, 1);
+            break;
+        case '/':
+            if (c1 == '=') SetPunct(r, TOKEN_EXPR_ASSIGNMENT, LEXEME_SLASH_ASSIGN, 2);
+            else SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_SLASH, 1);
+            break;
+        case '%':
+            if (c1 == '=') SetPunct(r, TOKEN_EXPR_ASSIGNMENT, LEXEME_PERCENT_ASSIGN, 2);
+            else SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_PERCENT, 1);
+            break;
+        case '=':
+            if (c1 == '=') SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_EQUAL, 2);
+            else SetPunct(r, TOKEN_EXPR_ASSIGNMENT, LEXEME_ASSIGN, 1);
+            break;
+        case '&':
+            if (c1 == '&') SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_AMP_AMP, 2);
+            else if (c1 == '=') SetPunct(r, TOKEN_EXPR_ASSIGNMENT, LEXEME_AMP_ASSIGN, 2);
+            else SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_AMP, 1);
+            break;
+        case '|':
+            if (c1 == '|') SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_PIPE_PIPE, 2);
+            else if (c1 == '=') SetPunct(r, TOKEN_EXPR_ASSIGNMENT, LEXEME_PIPE_ASSIGN, 2);
+            else SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_PIPE, 1);
+            break;
+        case '^':
+            if (c1 == '=') SetPunct(r, TOKEN_EXPR_ASSIGNMENT, LEXEME_CARET_ASSIGN, 2);
+            else SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_CARET, 1);
+            break;
+        case '~':
+            SetPunct(r, TOKEN_EXPR_UNARY, LEXEME_TILDE, 1);
+            break;
+        case '!':
+            if (c1 == '=') SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_NOT_EQUAL, 2);
+            else SetPunct(r, TOKEN_EXPR_UNARY, LEXEME_BANG, 1);
+            break;
+        case '<':
+            if (c1 == '<' && c2 == '=') SetPunct(r, TOKEN_EXPR_ASSIGNMENT, LEXEME_SHL_ASSIGN, 3);
+            else if (c1 == '<') SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_SHL, 2);
+            else if (c1 == '=') SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_LESS_EQUAL, 2);
+            else SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_LESS, 1);
+            break;
+        case '>':
+            if (c1 == '>' && c2 == '=') SetPunct(r, TOKEN_EXPR_ASSIGNMENT, LEXEME_SHR_ASSIGN, 3);
+            else if (c1 == '>') SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_SHR, 2);
+            else if (c1 == '=') SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_GREATER_EQUAL, 2);
+            else SetPunct(r, TOKEN_EXPR_BINARY, LEXEME_GREATER, 1);
+            break;
+        case '.':
+            if (c1 == '.' && c2 == '.') SetPunct(r, TOKEN_PUNCT_ELLIPSIS, LEXEME_ELLIPSIS, 3);
+            else SetPunct(r, TOKEN_PUNCT_DOT, LEXEME_DOT, 1);
+            break;
+        case '?': SetPunct(r, TOKEN_EXPR_CONDITIONAL, LEXEME_QUESTION, 1); break;
+        case ':': SetPunct(r, TOKEN_PUNCT_COLON, LEXEME_COLON, 1); break;
+        case ',': SetPunct(r, TOKEN_PUNCT_COMMA, LEXEME_COMMA, 1); break;
+        case ';': SetPunct(r, TOKEN_PUNCT_SEMICOLON, LEXEME_SEMICOLON, 1); break;
+        case '(': SetPunct(r, TOKEN_PAREN_OPEN, LEXEME_PAREN_OPEN, 1); break;
+        case ')': SetPunct(r, TOKEN_PAREN_CLOSE, LEXEME_PAREN_CLOSE, 1); break;
+        case '[': SetPunct(r, TOKEN_BRACKET_OPEN, LEXEME_BRACKET_OPEN, 1); break;
+        case ']': SetPunct(r, TOKEN_BRACKET_CLOSE, LEXEME_BRACKET_CLOSE, 1); break;
+        case '{': SetPunct(r, TOKEN_BLOCK_BEGIN, LEXEME_BRACE_OPEN, 1); break;
+        case '}': SetPunct(r, TOKEN_BLOCK_END, LEXEME_BRACE_CLOSE, 1); break;
+        default: SetPunct(r, TOKEN_ERROR, LEXEME_NONE, 1); break;
+    }
+}
+
+// Scans the token starting at p; p < end
+static void ScanToken(const char* p, const char* end, const Lexer* lexer, ScanResult* r) {
+    r->lexeme = LEXEME_NONE;
+    r->newlines = 0;
+    r->line_start = 0;
+
+    switch (char_classes[(unsigned char)*p]) {
+        case CC_IDENT:
+            ScanIdentifier(p, end, lexer, r);
+            break;
+        case CC_DIGIT:
+            ScanNumber(p, end, r);
+            break;
+        case CC_DQUOTE:
+            ScanQuoted(p, end, '"', r);
+            break;
+        case CC_SQUOTE:
+            ScanQuoted(p, end, '\'', r);
+            break;
+        case CC_SLASH:
+            if (p + 1 < end && p[1] == '/') ScanLineComment(p, end, lexer->simd, r);
+            else if (p + 1 < end && p[1] == '*') ScanBlockComment(p, end, lexer->simd, r);
+            else ScanPunct(p, end, r);
+            break;
+        case CC_HASH:
+            ScanPreprocessor(p, end, r);
+            break;
+        case CC_DOT:
+            if (p + 1 < end && char_classes[(unsigned char)p[1]] == CC_DIGIT) ScanNumber(p, end, r);
+            else ScanPunct(p, end, r);
+            break;
+        case CC_PUNCT:
+            ScanPunct(p, end, r);
+            break;
+        default:
+            r->type = TOKEN_ERROR;
+            r->length = 1;
+            break;
+    }
+}
+
+// Moves unread input to the front of the window and reads more.
+// Returns false once no further input can arrive.
+static bool RefillWindow(Lexer* lexer) {
+    if (lexer->eof) return false;
+
+    size_t keep = lexer->length - lexer->pos;
+    memmove(lexer->window, lexer->window + lexer->pos, keep);
+    lexer->base_offset += lexer->pos;
+    lexer->length = keep;
+    lexer->pos = 0;
+
+    // A single token larger than the window forces it to grow
+    if (keep == lexer->capacity) {
+        size_t capacity = lexer->capacity * 2;
+        char* window = (char*)realloc(lexer->window, capacity);
+        if (!window) {
+            lexer->eof = true;
+            return false;
+        }
+        lexer->window = window;
+        lexer->capacity = capacity;
+        TRACE(TRACE_LEXER, "%s: window grown to %zu bytes", lexer->file_name, capacity);
+    }
+    lexer->data = lexer->window;
+
+    for (;;) {
+        ssize_t n = read(lexer->fd, lexer->window + keep, lexer->capacity - keep);
+        if (n > 0) {
+            lexer->length += (size_t)n;
+            return true;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            TRACE(TRACE_LEXER, "%s: read failed: %s", lexer->file_name, strerror(errno));
+            lexer->error_count++;
+        }
+        lexer->eof = true;
+        return true;
+    }
+}
+
+// Lexer lifetime
+static Lexer* CreateLexer(const char* file_name) {
+    Lexer* lexer = (Lexer*)calloc(1, sizeof(Lexer));
+    if (!lexer) return NULL;
+
+    lexer->fd = -1;
+    lexer->line = 1;
+    lexer->track_lines = true;
+    lexer->simd = LexSimd_getKernels(LEX_SIMD_BEST);
+    lexer->reserved = ReservedTable_get();
+    lexer->file_name = file_name;
+    return lexer;
+}
+
+Lexer* Lexer_createFromBuffer(const char* data, size_t length, const char* file_name) {
+    if (!data && length) return NULL;
+
+    Lexer* lexer = CreateLexer(file_name);
+    if (!lexer) return NULL;
+
+    lexer->data = data;
+    lexer->length = length;
+    lexer->capacity = length;
+    lexer->eof = true;
+    return lexer;
+}
+
+// Zero-copy lexing of a mapped source. Token values point into the
+// mapping and positions are left for SourceFile_locate to resolve.
+Lexer* Lexer_createFromSource(SourceFile* source) {
+    if (!source) return NULL;
+
+    Lexer* lexer = Lexer_createFromBuffer(source->data, source->size, source->path);
+    if (!lexer) return NULL;
+
+    lexer->source = source;
+    lexer->track_lines = false;
+    return lexer;
+}
+
+Lexer* Lexer_createFromFd(int fd, size_t chunk_size, const char* file_name) {
+    if (fd < 0) return NULL;
+
+    Lexer* lexer = CreateLexer(file_name);
+    if (!lexer) return NULL;
+
+    lexer->capacity = chunk_size ? chunk_size : LEXER_DEFAULT_CHUNK_SIZE;
+    lexer->window = (char*)malloc(lexer->capacity);
+    if (!lexer->window) {
+        free(lexer);
+        return NULL;
+    }
+    lexer->data = lexer->window;
+    lexer->fd = fd;
+    return lexer;
+}
+
+void Lexer_destroy(Lexer* lexer) {
+    if (!lexer) return;
+    free(lexer->window);
+    free(lexer);
+}
+
+void Lexer_setInterner(Lexer* lexer, StringInterner* interner) {
+    if (lexer) lexer->interner = interner;
+}
+
+bool Lexer_setSimdLevel(Lexer* lexer, LexSimdLevel level) {
+    const LexSimdKernels* simd = LexSimd_getKernels(level);
+    if (!lexer || !simd) return false;
+
+    lexer->simd = simd;
+    return true;
+}
+
+// Token production
+
+// Scans the next token, skipping whitespace and, optionally, comments.
+// The token's position is left in token_offset/token_line/token_column.
+static bool ScanNext(Lexer* lexer, ScanResult* r) {
+    if (lexer->done) return false;
+
+    for (;;) {
+        // Skip whitespace, tracking line starts. A lone space before a
+        // token is the common case and skips the kernel call.
+        const char* p = lexer->data + lexer->pos;
+        const char* end = lexer->data + lexer->length;
+        if (p < end && char_classes[(unsigned char)*p] <= CC_NEWLINE) {
+            if (*p == ' ' && p + 1 < end && char_classes[(unsigned char)p[1]] > CC_NEWLINE) {
+                p++;
+            } else {
+                LexNewlines lines = { 0, NULL };
+                p = lexer->simd->skipWhitespace(p, end, &lines);
+                if (lines.count) {
+                    lexer->line += lines.count;
+                    lexer->line_start = lexer->base_offset + (size_t)(lines.last - lexer->data);
+                }
+            }
+        }
+        lexer->pos = (size_t)(p - lexer->data);
+
+        // Keep enough input buffered for three-character operators
+        if (lexer->length - lexer->pos < 4 && !lexer->eof) {
+            RefillWindow(lexer);
+            continue;
+        }
+
+        lexer->token_offset = lexer->base_offset + lexer->pos;
+        lexer->token_line = lexer->line;
+        lexer->token_column = (int)(lexer->token_offset - lexer->line_start) + 1;
+
+        if (lexer->pos == lexer->length) {
+            r->type = TOKEN_EOF;
+            r->lexeme = LEXEME_NONE;
+            r->length = 0;
+            lexer->done = true;
+            return true;
+        }
+
+        ScanToken(lexer->data + lexer->pos, end, lexer, r);
+
+        // A token touching the end of the window may continue past it
+        if (lexer->pos + r->length == lexer->length && !lexer->eof) {
+            RefillWindow(lexer);
+            continue;
+        }
+
+        lexer->pos += r->length;
+        if (r->newlines) {
+            lexer->line += r->newlines;
+            lexer->line_start = lexer->token_offset + r->line_start;
+        }
+
+        if (r->type == TOKEN_ERROR && !lexer->quiet) {
+            TRACE(TRACE_LEXER, "%s:%d:%d: invalid token '%.*s'", lexer->file_name,
+                  lexer->token_line, lexer->token_column, (int)r->length,
+                  lexer->data + (lexer->token_offset - lexer->base_offset));
+            lexer->error_count++;
+        }
+        if (lexer->skip_comments &&
+            (r->type == TOKEN_COMMENT_SINGLE || r->type == TOKEN_COMMENT_MULTI)) {
+            continue;
+        }
+        return true;
+    }
+}
+
+// Interns the scanned lexeme when an interner is attached. Comments are
+// never interned; they are large and unique.
+static LexemeId ResolveLexeme(const Lexer* lexer, const ScanResult* r, const char* start) {
+    if (r->lexeme || !lexer->interner || r->type == TOKEN_EOF ||
+        r->type == TOKEN_COMMENT_SINGLE || r->type == TOKEN_COMMENT_MULTI) {
+        return r->lexeme;
+    }
+    return StringInterner_intern(lexer->interner, start, r->length);
+}
+
+bool Lexer_next(Lexer* lexer, Token* token) {
+    if (!lexer || !token) return false;
+
+    ScanResult r;
+    if (!ScanNext(lexer, &r)) return false;
+
+    const char* start = lexer->data + (lexer->token_offset - lexer->base_offset);
+    token->type = r.type;
+    token->category = TokenType_getCategory(r.type);
+    token->length = (uint32_t)r.length;
+    token->lexeme = ResolveLexeme(lexer, &r, start);
+    token->offset = (uint32_t)lexer->token_offset;
+    token->line_number = lexer->track_lines ? lexer->token_line : 0;
+    token->column_number = lexer->track_lines ? lexer->token_column : 0;
+    token->file_name = lexer->file_name;
+    token->source = lexer->source;
+    memset(&token->attributes, 0, sizeof(TokenAttributes));
+    token->next = NULL;
+    token->prev = NULL;
+
+    if (r.type == TOKEN_EOF) {
+        token->value = NULL;
+    } else if (r.lexeme) {
+        token->value = (char*)Lexeme_getReserved(r.lexeme, NULL);
+    } else if (token->lexeme) {
+        token->value = (char*)StringInterner_get(lexer->interner, token->lexeme, NULL);
+    } else {
+        token->value = (char*)start;
+    }
+    return true;
+}
+
+// Compact variant: no value pointer and no line tracking in the token
+bool Lexer_nextSpan(Lexer* lexer, TokenSpan* span) {
+    if (!lexer || !span) return false;
+
+    ScanResult r;
+    if (!ScanNext(lexer, &r)) return false;
+
+    const char* start = lexer->data + (lexer->token_offset - lexer->base_offset);
+    span->offset = (uint32_t)lexer->token_offset;
+    span->length = (uint32_t)r.length;
+    span->lexeme = ResolveLexeme(lexer, &r, start);
+    span->type = (uint8_t)r.type;
+    return true;
+}
+
+// Materialises a span as a Token whose value points into the source and
+// whose line and column are resolved lazily.
+void TokenSpan_toToken(const TokenSpan* span, SourceFile* source, Token* token) {
+    if (!span || !token) return;
+
+    token->type = (TokenType)span->type;
+    token->category = TokenType_getCategory(token->type);
+    token->length = span->length;
+    token->lexeme = span->lexeme;
+    token->offset = span->offset;
+    token->line_number = 0;
+    token->column_number = 0;
+    token->file_name = source ? source->path : NULL;
+    token->source = source;
+    memset(&token->attributes, 0, sizeof(TokenAttributes));
+    token->next = NULL;
+    token->prev = NULL;
+
+    if (token->type == TOKEN_EOF) {
+        token->value = NULL;
+    } else if (span->lexeme && span->lexeme < LEXEME_RESERVED_COUNT) {
+        token->value = (char*)Lexeme_getReserved(span->lexeme, NULL);
+    } else {
+        token->value = source ? (char*)source->data + span->offset : NULL;
+    }
+}
+
+size_t Lexer_run(Lexer* lexer, LexerTokenCallback callback, void* user_data) {
+    if (!lexer || !callback) return 0;
+
+    size_t count = 0;
+    Token token;
+    while (Lexer_next(lexer, &token)) {
+        count++;
+        if (!callback(&token, user_data)) break;
+    }
+    return count;
+}
+
+// Copies a value out of a descriptor lexer's window into the slot's own
+// storage, which is reused by every token that lands in the slot
+static bool KeepValue(TokenRing* ring, uint32_t slot, Token* token) {
+    if (token->length >= ring->text_capacity[slot]) {
+        uint32_t capacity = ring->text_capacity[slot] ? ring->text_capacity[slot] : 32;
+        while (capacity <= token->length) capacity *= 2;
+        char* text = (char*)realloc(ring->text[slot], capacity);
+        if (!text) return false;
+        ring->text[slot] = text;
+        ring->text_capacity[slot] = capacity;
+    }
+    memcpy(ring->text[slot], token->value, token->length);
+    ring->text[slot][token->length] = '\0';
+    token->value = ring->text[slot];
+    return true;
+}
+
+// Lexes directly into the ring until it is full or the input ends. A
+// later token may refill the window, so values still pointing into it
+// are copied into the ring.
+size_t Lexer_fill(Lexer* lexer, TokenRing* ring) {
+    if (!lexer || !ring) return 0;
+
+    size_t count = 0;
+    while (!TokenRing_isFull(ring)) {
+        uint32_t slot = ring->tail & ring->mask;
+        Token* token = &ring->items[slot];
+        if (!Lexer_next(lexer, token)) break;
+        if (lexer->fd >= 0 && token->value >= lexer->window &&
+            token->value < lexer->window + lexer->capacity && !KeepValue(ring, slot, token)) {
+            break;
+        }
+        ring->tail++;
+        count++;
+    }
+    return count;
+}
+
+// Lexes the remaining input into a struct-of-arrays buffer. Values of a
+// buffer or source lexer stay readable through the input text; an fd
+// lexer's window moves, so only reserved and interned values survive.
+size_t Lexer_fillBuffer(Lexer* lexer, TokenBuffer* buffer) {
+    if (!lexer || !buffer) return 0;
+
+    buffer->text = lexer->fd < 0 ? lexer->data : NULL;
+    buffer->interner = lexer->interner;
+    buffer->source = lexer->source;
+
+    size_t count = 0;
+    TokenSpan span;
+    while (Lexer_nextSpan(lexer, &span)) {
+        if (TokenBuffer_append(buffer, (TokenType)span.type, span.offset,
+                               span.length, span.lexeme) == UINT32_MAX) {
+            break;
+        }
+        count++;
+    }
+    return count;
+}
+
+// Token ring operations
+TokenRing* TokenRing_create(uint32_t capacity) {
+    if (capacity == 0 || capacity > (1u << 31)) return NULL;
+
+    uint32_t size = 1;
+    while (size < capacity) size <<= 1;
+
+    TokenRing* ring = (TokenRing*)malloc(sizeof(TokenRing));
+    if (!ring) return NULL;
+
+    ring->mask = size - 1;
+    ring->items = (Token*)malloc(size * sizeof(Token));
+    ring->text = (char**)calloc(size, sizeof(char*));
+    ring->text_capacity = (uint32_t*)calloc(size, sizeof(uint32_t));
+    if (!ring->items || !ring->text || !ring->text_capacity) {
+        TokenRing_destroy(ring);
+        return NULL;
+    }
+    ring->head = 0;
+    ring->tail = 0;
+    return ring;
+}
+
+void TokenRing_destroy(TokenRing* ring) {
+    if (!ring) return;
+    if (ring->text) {
+        for (uint32_t i = 0; i <= ring->mask; i++) free(ring->text[i]);
+    }
+    free(ring->text);
+    free(ring->text_capacity);
+    free(ring->items);
+    free(ring);
+}
+
+uint32_t TokenRing_count(const TokenRing* ring) {
+    return ring ? ring->tail - ring->head : 0;
+}
+
+bool TokenRing_isFull(const TokenRing* ring) {
+    return !ring || ring->tail - ring->head > ring->mask;
+}
+
+bool TokenRing_push(TokenRing* ring, const Token* token) {
+    if (!token || TokenRing_isFull(ring)) return false;
+
+    ring->items[ring->tail & ring->mask] = *token;
+    ring->tail++;
+    return true;
+}
+
+bool TokenRing_pop(TokenRing* ring, Token* token) {
+    if (!ring || ring->head == ring->tail) return false;
+
+    if (token) *token = ring->items[ring->head & ring->mask];
+    ring->head++;
+    return true;
+}
+
+const Token* TokenRing_peek(const TokenRing* ring, uint32_t ahead) {
+    if (!ring || ahead >= ring->tail - ring->head) return NULL;
+    return &ring->items[(ring->head + ahead) & ring->mask];
+}
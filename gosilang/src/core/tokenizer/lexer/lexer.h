@@ -0,0 +1,109 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include "core/tokenizer/symbols/sym_type.h"
+#include "core/tokenizer/symbols/sym_intern.h"
+#include "core/tokenizer/symbols/sym_buffer.h"
+#include "lex_simd.h"
+#include "core/tokenizer/source/source_file.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Default read size for file descriptor input
+#define LEXER_DEFAULT_CHUNK_SIZE (64 * 1024)
+
+// Streaming lexer over an in-memory buffer or a file descriptor.
+//
+// Tokens are written into caller storage and are not linked. Reserved
+// lexemes (operators, punctuation, keywords) always carry their static
+// spelling and lexeme id. Other values point into the input window and
+// stay valid until the next call for descriptor input, unless an
+// interner is attached, in which case every token except comments
+// borrows its value from the interner. Lexer_fill copies window values
+// into the ring; see TokenRing.
+typedef struct Lexer {
+    // Input window
+    char* window;           // Owned read buffer (descriptor input only)
+    const char* data;       // Start of the current window
+    size_t length;          // Bytes available in the window
+    size_t pos;             // Scan position within the window
+    size_t capacity;
+    size_t base_offset;     // Absolute offset of data[0]
+    int fd;                 // -1 for buffer input
+    bool eof;               // No input beyond the window
+    bool done;              // TOKEN_EOF has been produced
+
+    // Position tracking
+    int line;
+    size_t line_start;      // Absolute offset of the current line
+    const char* file_name;
+    SourceFile* source;     // Set for zero-copy source input
+    bool track_lines;       // Store line/column in tokens eagerly
+
+    // Options and state
+    const LexSimdKernels* simd;
+    const ReservedTable* reserved;  // Keyword lookup
+    StringInterner* interner;
+    bool skip_comments;
+    bool quiet;             // Errors are neither counted nor traced
+    int error_count;
+    size_t token_offset;    // Absolute offset of the last token
+    int token_line;
+    int token_column;
+} Lexer;
+
+// Compact token: a span of the source plus its type and lexeme.
+// A quarter the size of Token; positions come from the SourceFile.
+typedef struct TokenSpan {
+    uint32_t offset;
+    uint32_t length;
+    LexemeId lexeme;        // Reserved or interned lexeme, 0 otherwise
+    uint8_t type;           // TokenType
+} TokenSpan;
+
+// Caller-side queue of lexed tokens, so a parser can look ahead while
+// the lexer keeps producing into bounded memory.
+//
+// Lexer_fill lexes many tokens in one call, so a descriptor lexer's
+// window may move under the ones already queued. Values that would
+// point into it are copied into storage owned by the slot instead: a
+// queued token's value stays valid while it is in the ring, and a
+// popped one's until the next Lexer_fill. Tokens added by
+// TokenRing_push keep the caller's value pointer as it is.
+typedef struct TokenRing {
+    Token* items;
+    char** text;            // Per slot: copy of a window value, or NULL
+    uint32_t* text_capacity;
+    uint32_t mask;          // Capacity - 1, capacity is a power of two
+    uint32_t head;          // Next token to pop
+    uint32_t tail;          // Next free slot
+} TokenRing;
+
+typedef bool (*LexerTokenCallback)(const Token* token, void* user_data);
+
+// Lexer lifetime
+Lexer* Lexer_createFromBuffer(const char* data, size_t length, const char* file_name);
+Lexer* Lexer_createFromSource(SourceFile* source);
+Lexer* Lexer_createFromFd(int fd, size_t chunk_size, const char* file_name);
+void Lexer_destroy(Lexer* lexer);
+void Lexer_setInterner(Lexer* lexer, StringInterner* interner);
+bool Lexer_setSimdLevel(Lexer* lexer, LexSimdLevel level);
+
+// Token production
+bool Lexer_next(Lexer* lexer, Token* token);
+bool Lexer_nextSpan(Lexer* lexer, TokenSpan* span);
+void TokenSpan_toToken(const TokenSpan* span, SourceFile* source, Token* token);
+size_t Lexer_run(Lexer* lexer, LexerTokenCallback callback, void* user_data);
+size_t Lexer_fill(Lexer* lexer, TokenRing* ring);
+size_t Lexer_fillBuffer(Lexer* lexer, TokenBuffer* buffer);
+
+// Token ring operations
+TokenRing* TokenRing_create(uint32_t capacity);
+void TokenRing_destroy(TokenRing* ring);
+uint32_t TokenRing_count(const TokenRing* ring);
+bool TokenRing_isFull(const TokenRing* ring);
+bool TokenRing_push(TokenRing* ring, const Token* token);
+bool TokenRing_pop(TokenRing* ring, Token* token);
+const Token* TokenRing_peek(const TokenRing* ring, uint32_t ahead);
+
+#endif // LEXER_H
@@ -0,0 +1,200 @@
+#include "source_file.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define LINE_INDEX_INITIAL_CAPACITY 1024
+#define READ_CHUNK_SIZE (64 * 1024)
+
+static SourceFile* CreateSource(const char* name) {
+    SourceFile* source = (SourceFile*)calloc(1, sizeof(SourceFile));
+    if (!source) return NULL;
+
+    source->path = strdup(name ? name : "<buffer>");
+    if (!source->path) {
+        free(source);
+        return NULL;
+    }
+    return source;
+}
+
+// Fallback for pipes and other inputs that cannot be mapped
+static bool ReadWholeFile(SourceFile* source, int fd) {
+    size_t capacity = READ_CHUNK_SIZE;
+    size_t size = 0;
+    char* data = (char*)malloc(capacity);
+    if (!data) return false;
+
+    for (;;) {
+        if (size == capacity) {
+            char* grown = (char*)realloc(data, capacity * 2);
+            if (!grown) {
+                free(data);
+                return false;
+            }
+            data = grown;
+            capacity *= 2;
+        }
+        ssize_t n = read(fd, data + size, capacity - size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            free(data);
+            return false;
+        }
+        if (n == 0) break;
+        size += (size_t)n;
+    }
+
+    if (size > SOURCE_FILE_MAX_SIZE) {
+        free(data);
+        return false;
+    }
+    source->owned = data;
+    source->data = data;
+    source->size = size;
+    return true;
+}
+
+// Source lifetime
+SourceFile* SourceFile_open(const char* path) {
+    if (!path) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    SourceFile* source = CreateSource(path);
+    if (!source) {
+        close(fd);
+        return NULL;
+    }
+
+    struct stat st;
+    bool ok;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        if ((size_t)st.st_size > SOURCE_FILE_MAX_SIZE) {
+            ok = false;
+        } else if (st.st_size == 0) {
+            source->data = "";
+            ok = true;
+        } else {
+            void* mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ok = mapping != MAP_FAILED;
+            if (ok) {
+                madvise(mapping, (size_t)st.st_size, MADV_SEQUENTIAL);
+                source->data = (const char*)mapping;
+                source->size = (size_t)st.st_size;
+                source->mapped = true;
+            } else {
+                ok = ReadWholeFile(source, fd);
+            }
+        }
+    } else {
+        ok = ReadWholeFile(source, fd);
+    }
+    close(fd);
+
+    if (!ok) {
+        SourceFile_close(source);
+        return NULL;
+    }
+    return source;
+}
+
+// Wraps caller-owned text; the buffer must outlive the source
+SourceFile* SourceFile_fromBuffer(const char* data, size_t size, const char* name) {
+    if ((!data && size) || size > SOURCE_FILE_MAX_SIZE) return NULL;
+
+    SourceFile* source = CreateSource(name);
+    if (!source) return NULL;
+
+    source->data = data ? data : "";
+    source->size = size;
+    return source;
+}
+
+void SourceFile_close(SourceFile* source) {
+    if (!source) return;
+
+    if (source->mapped) {
+        munmap((void*)source->data, source->size);
+    }
+    free(source->owned);
+    free(source->line_starts);
+    free(source->path);
+    free(source);
+}
+
+// Positions
+bool SourceFile_buildLineIndex(SourceFile* source) {
+    if (!source) return false;
+    if (source->line_starts) return true;
+
+    uint32_t capacity = LINE_INDEX_INITIAL_CAPACITY;
+    uint32_t count = 0;
+    uint32_t* starts = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    if (!starts) return false;
+
+    const char* p = source->data;
+    const char* end = source->data + source->size;
+    starts[count++] = 0;
+    while (p < end) {
+        const char* newline = (const char*)memchr(p, '\n', (size_t)(end - p));
+        if (!newline) break;
+
+        if (count == capacity) {
+            uint32_t* grown = (uint32_t*)realloc(starts, capacity * 2 * sizeof(uint32_t));
+            if (!grown) {
+                free(starts);
+                return false;
+            }
+            starts = grown;
+            capacity *= 2;
+        }
+        p = newline + 1;
+        starts[count++] = (uint32_t)(p - source->data);
+    }
+
+    source->line_starts = starts;
+    source->line_count = count;
+    return true;
+}
+
+// Converts a byte offset to a 1-based line and column
+bool SourceFile_locate(SourceFile* source, size_t offset, int* line, int* column) {
+    if (!source || offset > source->size || !SourceFile_buildLineIndex(source)) {
+        return false;
+    }
+
+    // Last line start <= offset
+    uint32_t low = 0;
+    uint32_t high = source->line_count;
+    while (high - low > 1) {
+        uint32_t mid = low + (high - low) / 2;
+        if (source->line_starts[mid] <= offset) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (line) *line = (int)low + 1;
+    if (column) *column = (int)(offset - source->line_starts[low]) + 1;
+    return true;
+}
+
+// Text of a 1-based line without its newline, for diagnostics
+const char* SourceFile_lineText(SourceFile* source, int line, size_t* length) {
+    if (!source || line < 1 || !SourceFile_buildLineIndex(source) ||
+        (uint32_t)line > source->line_count) {
+        return NULL;
+    }
+
+    size_t start = source->line_starts[line - 1];
+    size_t end = (uint32_t)line < source->line_count ? source->line_starts[line] - 1 : source->size;
+    if (length) *length = end - start;
+    return source->data + start;
+}
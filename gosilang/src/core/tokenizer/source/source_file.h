@@ -0,0 +1,35 @@
+#ifndef SOURCE_FILE_H
+#define SOURCE_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Largest source the 32-bit token offsets can address
+#define SOURCE_FILE_MAX_SIZE ((size_t)UINT32_MAX)
+
+// Read-only source text. Files are memory-mapped so tokens can refer to
+// (offset, length) spans of the mapping instead of copying lexemes.
+// Line starts are indexed lazily, the first time a position is needed.
+typedef struct SourceFile {
+    char* path;
+    const char* data;
+    size_t size;
+    bool mapped;            // data is an mmap of the file
+    char* owned;            // Heap copy when the input cannot be mapped
+    uint32_t* line_starts;  // Offset of each line, built on demand
+    uint32_t line_count;
+} SourceFile;
+
+// Source lifetime
+SourceFile* SourceFile_open(const char* path);
+SourceFile* SourceFile_fromBuffer(const char* data, size_t size, const char* name);
+void SourceFile_close(SourceFile* source);
+
+// Positions. Building the index is not thread-safe; call
+// SourceFile_buildLineIndex before sharing a source between threads.
+bool SourceFile_buildLineIndex(SourceFile* source);
+bool SourceFile_locate(SourceFile* source, size_t offset, int* line, int* column);
+const char* SourceFile_lineText(SourceFile* source, int line, size_t* length);
+
+#endif // SOURCE_FILE_H
@@ -0,0 +1,149 @@
+#include "sym_arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+static TokenArenaBlock* CreateArenaBlock(size_t size) {
+    TokenArenaBlock* block = (TokenArenaBlock*)malloc(sizeof(TokenArenaBlock) + size);
+    if (!block) return NULL;
+
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+// Arena lifetime
+TokenArena* TokenArena_create(size_t block_size) {
+    TokenArena* arena = (TokenArena*)malloc(sizeof(TokenArena));
+    if (!arena) return NULL;
+
+    arena->block_size = block_size ? block_size : TOKEN_ARENA_DEFAULT_BLOCK_SIZE;
+    arena->head = CreateArenaBlock(arena->block_size);
+    if (!arena->head) {
+        free(arena);
+        return NULL;
+    }
+    arena->current = arena->head;
+    arena->token_count = 0;
+    arena->bytes_reserved = arena->block_size;
+
+    return arena;
+}
+
+void TokenArena_destroy(TokenArena* arena) {
+    if (!arena) return;
+
+    TokenArenaBlock* block = arena->head;
+    while (block) {
+        TokenArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+// Releases every allocation at once. Blocks stay chained so the next
+// compilation unit reuses them; their fill level is cleared lazily
+// when the bump pointer moves onto them.
+void TokenArena_reset(TokenArena* arena) {
+    if (!arena) return;
+
+    arena->current = arena->head;
+    arena->current->used = 0;
+    arena->token_count = 0;
+}
+
+void* TokenArena_alloc(TokenArena* arena, size_t size, size_t align) {
+    if (!arena || size == 0) return NULL;
+    if (align == 0) align = 1;
+
+    TokenArenaBlock* block = arena->current;
+    for (;;) {
+        uintptr_t base = (uintptr_t)block->data;
+        uintptr_t start = (base + block->used + (align - 1)) & ~(uintptr_t)(align - 1);
+        size_t end = (size_t)(start - base) + size;
+        if (end <= block->size) {
+            block->used = end;
+            arena->current = block;
+            return (void*)start;
+        }
+
+        // Move on to the next retained block, or chain a new one
+        if (block->next) {
+            block = block->next;
+            block->used = 0;
+            continue;
+        }
+
+        size_t needed = size + align;
+        size_t new_size = needed > arena->block_size ? needed : arena->block_size;
+        TokenArenaBlock* fresh = CreateArenaBlock(new_size);
+        if (!fresh) return NULL;
+
+        block->next = fresh;
+        arena->bytes_reserved += new_size;
+        block = fresh;
+    }
+}
+
+char* TokenArena_strndup(TokenArena* arena, const char* value, size_t length) {
+    if (!value) return NULL;
+
+    char* copy = (char*)TokenArena_alloc(arena, length + 1, 1);
+    if (!copy) return NULL;
+
+    memcpy(copy, value, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+// Arena-aware token creation
+Token* Token_createInArena(TokenArena* arena, TokenType type, const char* value) {
+    Token* token = (Token*)TokenArena_alloc(arena, sizeof(Token), _Alignof(Token));
+    if (!token) return NULL;
+
+    token->type = type;
+    token->category = TokenType_getCategory(type);
+    token->length = value ? (uint32_t)strlen(value) : 0;
+    token->value = value ? TokenArena_strndup(arena, value, token->length) : NULL;
+    token->lexeme = 0;
+    if (value && !token->value) return NULL;
+    token->offset = 0;
+    token->line_number = 0;
+    token->column_number = 0;
+    token->file_name = NULL;
+    token->source = NULL;
+    token->next = NULL;
+    token->prev = NULL;
+    memset(&token->attributes, 0, sizeof(TokenAttributes));
+
+    arena->token_count++;
+    return token;
+}
+
+Token* Token_copyInArena(TokenArena* arena, const Token* source) {
+    if (!source) return NULL;
+
+    Token* copy = Token_createInArena(arena, source->type, NULL);
+    if (!copy) return NULL;
+
+    // Interned lexemes are shared, anything else is copied into the arena
+    if (source->lexeme) {
+        copy->value = source->value;
+    } else if (source->value) {
+        copy->value = TokenArena_strndup(arena, source->value, source->length);
+        if (!copy->value) return NULL;
+    }
+    copy->length = source->length;
+    copy->lexeme = source->lexeme;
+    copy->category = source->category;
+    copy->offset = source->offset;
+    copy->line_number = source->line_number;
+    copy->column_number = source->column_number;
+    copy->file_name = source->file_name;
+    copy->source = source->source;
+    copy->attributes = source->attributes;
+
+    return copy;
+}
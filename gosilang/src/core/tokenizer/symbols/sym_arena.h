@@ -0,0 +1,42 @@
+#ifndef SYM_ARENA_H
+#define SYM_ARENA_H
+
+#include "sym_type.h"
+#include <stddef.h>
+
+// Default size of a single arena block (tokens and lexemes share blocks)
+#define TOKEN_ARENA_DEFAULT_BLOCK_SIZE (1024 * 1024)
+
+// A block of arena memory; blocks are chained and reused after a reset
+typedef struct TokenArenaBlock {
+    struct TokenArenaBlock* next;
+    size_t size;
+    size_t used;
+    unsigned char data[];
+} TokenArenaBlock;
+
+// Bump allocator owning every token of a compilation unit.
+// Tokens allocated from an arena must not be passed to Token_destroy;
+// they are released together by TokenArena_reset or TokenArena_destroy.
+typedef struct TokenArena {
+    TokenArenaBlock* head;      // First block in the chain
+    TokenArenaBlock* current;   // Block currently being bumped
+    size_t block_size;
+    size_t token_count;         // Tokens allocated since the last reset
+    size_t bytes_reserved;      // Total size of all blocks
+} TokenArena;
+
+// Arena lifetime
+TokenArena* TokenArena_create(size_t block_size);
+void TokenArena_destroy(TokenArena* arena);
+void TokenArena_reset(TokenArena* arena);
+
+// Raw allocation
+void* TokenArena_alloc(TokenArena* arena, size_t size, size_t align);
+char* TokenArena_strndup(TokenArena* arena, const char* value, size_t length);
+
+// Arena-aware token creation
+Token* Token_createInArena(TokenArena* arena, TokenType type, const char* value);
+Token* Token_copyInArena(TokenArena* arena, const Token* token);
+
+#endif // SYM_ARENA_H
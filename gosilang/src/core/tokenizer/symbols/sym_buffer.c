@@ -0,0 +1,213 @@
+#include "sym_buffer.h"
+#include "core/tokenizer/source/source_file.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Buffer lifetime
+TokenBuffer* TokenBuffer_create(uint32_t capacity) {
+    TokenBuffer* buffer = (TokenBuffer*)calloc(1, sizeof(TokenBuffer));
+    if (!buffer) return NULL;
+
+    if (!TokenBuffer_reserve(buffer, capacity ? capacity : TOKEN_BUFFER_INITIAL_CAPACITY)) {
+        TokenBuffer_destroy(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+void TokenBuffer_destroy(TokenBuffer* buffer) {
+    if (!buffer) return;
+
+    free(buffer->types);
+    free(buffer->categories);
+    free(buffer->offsets);
+    free(buffer->lengths);
+    free(buffer->lexemes);
+    free(buffer->attributes);
+    free(buffer);
+}
+
+void TokenBuffer_clear(TokenBuffer* buffer) {
+    if (buffer) buffer->count = 0;
+}
+
+// Grows every column to hold at least capacity tokens
+bool TokenBuffer_reserve(TokenBuffer* buffer, uint32_t capacity) {
+    if (!buffer) return false;
+    if (capacity <= buffer->capacity) return true;
+
+    uint8_t* types = (uint8_t*)realloc(buffer->types, capacity);
+    if (!types) return false;
+    buffer->types = types;
+
+    uint8_t* categories = (uint8_t*)realloc(buffer->categories, capacity);
+    if (!categories) return false;
+    buffer->categories = categories;
+
+    uint32_t* offsets = (uint32_t*)realloc(buffer->offsets, capacity * sizeof(uint32_t));
+    if (!offsets) return false;
+    buffer->offsets = offsets;
+
+    uint32_t* lengths = (uint32_t*)realloc(buffer->lengths, capacity * sizeof(uint32_t));
+    if (!lengths) return false;
+    buffer->lengths = lengths;
+
+    LexemeId* lexemes = (LexemeId*)realloc(buffer->lexemes, capacity * sizeof(LexemeId));
+    if (!lexemes) return false;
+    buffer->lexemes = lexemes;
+
+    uint16_t* attributes = (uint16_t*)realloc(buffer->attributes, capacity * sizeof(uint16_t));
+    if (!attributes) return false;
+    buffer->attributes = attributes;
+
+    buffer->capacity = capacity;
+    return true;
+}
+
+// Appending
+uint32_t TokenBuffer_append(TokenBuffer* buffer, TokenType type, uint32_t offset,
+                            uint32_t length, LexemeId lexeme) {
+    if (!buffer) return UINT32_MAX;
+    if (buffer->count == buffer->capacity) {
+        if (buffer->capacity > UINT32_MAX / 2) return UINT32_MAX;
+        if (!TokenBuffer_reserve(buffer, buffer->capacity * 2)) return UINT32_MAX;
+    }
+
+    uint32_t index = buffer->count++;
+    buffer->types[index] = (uint8_t)type;
+    buffer->categories[index] = (uint8_t)TokenType_getCategory(type);
+    buffer->offsets[index] = offset;
+    buffer->lengths[index] = length;
+    buffer->lexemes[index] = lexeme;
+    buffer->attributes[index] = 0;
+    return index;
+}
+
+// Copies a heap or arena token; its value must be resolvable through
+// the buffer's text or interner later, as the pointer is not kept.
+uint32_t TokenBuffer_push(TokenBuffer* buffer, const Token* token) {
+    if (!token) return UINT32_MAX;
+
+    uint32_t index = TokenBuffer_append(buffer, token->type, token->offset,
+                                        token->length, token->lexeme);
+    if (index != UINT32_MAX) {
+        buffer->attributes[index] = TokenAttributes_pack(&token->attributes);
+    }
+    return index;
+}
+
+// Appends a whole next-linked list; returns the number of tokens added
+uint32_t TokenBuffer_pushList(TokenBuffer* buffer, const Token* head) {
+    uint32_t added = 0;
+    for (const Token* token = head; token; token = token->next) {
+        if (TokenBuffer_push(buffer, token) == UINT32_MAX) break;
+        added++;
+    }
+    return added;
+}
+
+// Access
+const char* TokenBuffer_value(const TokenBuffer* buffer, uint32_t index) {
+    if (!buffer || index >= buffer->count) return NULL;
+
+    LexemeId lexeme = buffer->lexemes[index];
+    if (lexeme && lexeme < LEXEME_RESERVED_COUNT) return Lexeme_getReserved(lexeme, NULL);
+    if (lexeme && buffer->interner) return StringInterner_get(buffer->interner, lexeme, NULL);
+    if (buffer->text && buffer->types[index] != TOKEN_EOF) return buffer->text + buffer->offsets[index];
+    return NULL;
+}
+
+// Materialises a token for code that still works on Token. The value
+// is borrowed and positions are resolved lazily through the source.
+bool TokenBuffer_get(const TokenBuffer* buffer, uint32_t index, Token* token) {
+    if (!buffer || !token || index >= buffer->count) return false;
+
+    token->type = (TokenType)buffer->types[index];
+    token->category = (TokenCategory)buffer->categories[index];
+    token->value = (char*)TokenBuffer_value(buffer, index);
+    token->length = buffer->lengths[index];
+    token->lexeme = buffer->lexemes[index];
+    token->offset = buffer->offsets[index];
+    token->line_number = 0;
+    token->column_number = 0;
+    token->file_name = buffer->source ? buffer->source->path : NULL;
+    token->source = buffer->source;
+    TokenAttributes_unpack(buffer->attributes[index], &token->attributes);
+    token->next = NULL;
+    token->prev = NULL;
+    return true;
+}
+
+// Attribute packing
+static uint16_t ClampDepth(int depth) {
+    if (depth < 0) return 0;
+    return depth > TOKEN_ATTR_DEPTH_MASK ? TOKEN_ATTR_DEPTH_MASK : (uint16_t)depth;
+}
+
+uint16_t TokenAttributes_pack(const TokenAttributes* attrs) {
+    if (!attrs) return 0;
+
+    uint16_t bits = 0;
+    if (attrs->is_const) bits |= TOKEN_ATTR_CONST;
+    if (attrs->is_volatile) bits |= TOKEN_ATTR_VOLATILE;
+    if (attrs->is_static) bits |= TOKEN_ATTR_STATIC;
+    if (attrs->is_extern) bits |= TOKEN_ATTR_EXTERN;
+    if (!attrs->is_signed) bits |= TOKEN_ATTR_UNSIGNED;
+    bits |= (uint16_t)(ClampDepth(attrs->pointer_level) << TOKEN_ATTR_POINTER_SHIFT);
+    bits |= (uint16_t)(ClampDepth(attrs->array_dimensions) << TOKEN_ATTR_ARRAY_SHIFT);
+    return bits;
+}
+
+void TokenAttributes_unpack(uint16_t bits, TokenAttributes* attrs) {
+    if (!attrs) return;
+
+    attrs->is_const = (bits & TOKEN_ATTR_CONST) != 0;
+    attrs->is_volatile = (bits & TOKEN_ATTR_VOLATILE) != 0;
+    attrs->is_static = (bits & TOKEN_ATTR_STATIC) != 0;
+    attrs->is_extern = (bits & TOKEN_ATTR_EXTERN) != 0;
+    attrs->is_signed = (bits & TOKEN_ATTR_UNSIGNED) == 0;
+    attrs->pointer_level = (bits >> TOKEN_ATTR_POINTER_SHIFT) & TOKEN_ATTR_DEPTH_MASK;
+    attrs->array_dimensions = (bits >> TOKEN_ATTR_ARRAY_SHIFT) & TOKEN_ATTR_DEPTH_MASK;
+}
+
+// Context management: a cursor over a TokenBuffer
+TokenContext* TokenContext_create(const TokenBuffer* tokens) {
+    TokenContext* context = (TokenContext*)calloc(1, sizeof(TokenContext));
+    if (!context) return NULL;
+
+    context->tokens = tokens;
+    return context;
+}
+
+void TokenContext_destroy(TokenContext* context) {
+    if (!context) return;
+    free(context->error_message);
+    free(context);
+}
+
+bool TokenContext_advance(TokenContext* context) {
+    if (!context || !context->tokens) return false;
+    if (context->position >= context->tokens->count) return false;
+
+    context->position++;
+    return context->position < context->tokens->count;
+}
+
+// Lookahead is a plain index; past the end reads as TOKEN_EOF
+TokenType TokenContext_peek(const TokenContext* context, int ahead) {
+    if (!context || !context->tokens || ahead < 0) return TOKEN_EOF;
+    return TokenBuffer_type(context->tokens, context->position + (uint32_t)ahead);
+}
+
+bool TokenContext_current(const TokenContext* context, Token* token) {
+    if (!context) return false;
+    return TokenBuffer_get(context->tokens, context->position, token);
+}
+
+void TokenContext_setError(TokenContext* context, const char* message) {
+    if (!context) return;
+
+    context->error_count++;
+    free(context->error_message);
+    context->error_message = message ? strdup(message) : NULL;
+}
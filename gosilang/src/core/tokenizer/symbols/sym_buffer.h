@@ -0,0 +1,61 @@
+#ifndef SYM_BUFFER_H
+#define SYM_BUFFER_H
+
+#include "sym_type.h"
+#include "sym_intern.h"
+
+#define TOKEN_BUFFER_INITIAL_CAPACITY 1024
+
+// Packed TokenAttributes: five flags plus pointer and array depth
+#define TOKEN_ATTR_CONST        0x0001
+#define TOKEN_ATTR_VOLATILE     0x0002
+#define TOKEN_ATTR_STATIC       0x0004
+#define TOKEN_ATTR_EXTERN       0x0008
+#define TOKEN_ATTR_UNSIGNED     0x0010  // Clear means signed, the default
+#define TOKEN_ATTR_POINTER_SHIFT 8
+#define TOKEN_ATTR_ARRAY_SHIFT  12
+#define TOKEN_ATTR_DEPTH_MASK   0xF     // Depths saturate at 15
+
+// Struct-of-arrays token stream. Each field lives in its own packed
+// array so a scan over types touches one byte per token instead of a
+// whole Token; tokens are addressed by index, not by next/prev links.
+typedef struct TokenBuffer {
+    uint8_t* types;         // TokenType
+    uint8_t* categories;    // TokenCategory
+    uint32_t* offsets;      // Byte offset of each lexeme in text
+    uint32_t* lengths;
+    LexemeId* lexemes;      // Reserved or interned lexeme, 0 otherwise
+    uint16_t* attributes;   // TOKEN_ATTR_* bits
+    uint32_t count;
+    uint32_t capacity;
+
+    // Where values come from when a token is materialised (borrowed)
+    const char* text;
+    const StringInterner* interner;
+    struct SourceFile* source;
+} TokenBuffer;
+
+// Buffer lifetime
+TokenBuffer* TokenBuffer_create(uint32_t capacity);
+void TokenBuffer_destroy(TokenBuffer* buffer);
+void TokenBuffer_clear(TokenBuffer* buffer);
+bool TokenBuffer_reserve(TokenBuffer* buffer, uint32_t capacity);
+
+// Appending; both return the new token's index or UINT32_MAX on failure
+uint32_t TokenBuffer_append(TokenBuffer* buffer, TokenType type, uint32_t offset,
+                            uint32_t length, LexemeId lexeme);
+uint32_t TokenBuffer_push(TokenBuffer* buffer, const Token* token);
+uint32_t TokenBuffer_pushList(TokenBuffer* buffer, const Token* head);
+
+// Access
+static inline TokenType TokenBuffer_type(const TokenBuffer* buffer, uint32_t index) {
+    return index < buffer->count ? (TokenType)buffer->types[index] : TOKEN_EOF;
+}
+const char* TokenBuffer_value(const TokenBuffer* buffer, uint32_t index);
+bool TokenBuffer_get(const TokenBuffer* buffer, uint32_t index, Token* token);
+
+// Attribute packing
+uint16_t TokenAttributes_pack(const TokenAttributes* attrs);
+void TokenAttributes_unpack(uint16_t bits, TokenAttributes* attrs);
+
+#endif // SYM_BUFFER_H
@@ -0,0 +1,824 @@
+#include "sym_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Sections start on this boundary so every column can be read in place
+#define CACHE_SECTION_ALIGN 8
+#define CACHE_MIN_SCOPE_SLOTS 8
+
+static const size_t section_element_sizes[TOKEN_CACHE_SECTION_COUNT] = {
+#define X(section, type) [TOKEN_CACHE_##section] = sizeof(type),
+    TOKEN_CACHE_SECTION_LIST(X)
+#undef X
+};
+
+// XXH64
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ull
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define XXH_PRIME64_3 0x165667B19E3779F9ull
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ull
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ull
+
+static inline uint64_t Rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Little-endian loads; cache files are not shared across architectures
+static inline uint64_t Read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t Read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t XxhRound(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME64_2;
+    acc = Rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t XxhMerge(uint64_t acc, uint64_t lane) {
+    acc ^= XxhRound(0, lane);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+uint64_t TokenCache_hash(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = seed + XXH_PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME64_1;
+        const uint8_t* limit = end - 32;
+        do {
+            v1 = XxhRound(v1, Read64(p));
+            v2 = XxhRound(v2, Read64(p + 8));
+            v3 = XxhRound(v3, Read64(p + 16));
+            v4 = XxhRound(v4, Read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = Rotl64(v1, 1) + Rotl64(v2, 7) + Rotl64(v3, 12) + Rotl64(v4, 18);
+        h = XxhMerge(h, v1);
+        h = XxhMerge(h, v2);
+        h = XxhMerge(h, v3);
+        h = XxhMerge(h, v4);
+    } else {
+        h = seed + XXH_PRIME64_5;
+    }
+    h += (uint64_t)size;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= XxhRound(0, Read64(p));
+        h = Rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)Read32(p) * XXH_PRIME64_1;
+        h = Rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= *p * XXH_PRIME64_5;
+        h = Rotl64(h, 11) * XXH_PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t TokenCache_key(const char* text, size_t size, uint32_t options) {
+    // Everything besides the text that decides what an entry holds
+    const uint64_t build[] = { TOKEN_CACHE_FORMAT, TOKEN_TYPE_COUNT, LEXEME_RESERVED_COUNT, options };
+    uint64_t seed = TokenCache_hash(build, sizeof(build), 0);
+    seed = TokenCache_hash(GOSI_VERSION, strlen(GOSI_VERSION), seed);
+    return TokenCache_hash(text, size, seed);
+}
+
+static void EntryPath(char* path, size_t size, const char* directory, uint64_t key) {
+    snprintf(path, size, "%s/%016llx%s", directory, (unsigned long long)key, TOKEN_CACHE_EXTENSION);
+}
+
+// Writing
+
+// Names of the symbol tables, NUL-terminated; offset 0 is the empty name
+typedef struct CacheStrings {
+    char* data;
+    uint32_t size;
+    uint32_t capacity;
+} CacheStrings;
+
+static bool AddString(CacheStrings* strings, const char* str, CachedName* name) {
+    name->offset = 0;
+    name->length = 0;
+    if (!str || !*str) return true;
+
+    size_t length = strlen(str);
+    if (length >= UINT32_MAX - strings->size - 1) return false;
+    if (strings->size + length + 1 > strings->capacity) {
+        size_t capacity = (size_t)strings->capacity * 2;
+        while (capacity < strings->size + length + 1) capacity *= 2;
+        if (capacity >= UINT32_MAX) capacity = UINT32_MAX - 1;
+        char* data = (char*)realloc(strings->data, capacity);
+        if (!data) return false;
+        strings->data = data;
+        strings->capacity = (uint32_t)capacity;
+    }
+
+    name->offset = strings->size;
+    name->length = (uint32_t)length;
+    memcpy(strings->data + strings->size, str, length + 1);
+    strings->size += (uint32_t)length + 1;
+    return true;
+}
+
+// Scopes sorted by address, to turn parent and function scope pointers
+// into indices
+typedef struct ScopeIndex {
+    const ScopeLevel* scope;
+    uint32_t index;
+} ScopeIndex;
+
+static int CompareScopeIndex(const void* a, const void* b) {
+    uintptr_t x = (uintptr_t)((const ScopeIndex*)a)->scope;
+    uintptr_t y = (uintptr_t)((const ScopeIndex*)b)->scope;
+    return (x > y) - (x < y);
+}
+
+// Flat copies of the symbol tables, staged before the file is written
+typedef struct CacheSymbols {
+    CacheStrings strings;
+    ScopeIndex* scope_index;
+    CachedScope* scopes;
+    CachedSymbol* symbols;
+    uint32_t symbol_count;
+    uint32_t* scope_slots;
+    uint32_t scope_slot_count;
+    CachedFunction* functions;
+    CachedParameter* parameters;
+    uint32_t parameter_count;
+    CachedStruct* structs;
+    CachedMember* members;
+    uint32_t member_count;
+    CachedEnum* enums;
+    CachedEnumValue* enum_values;
+    uint32_t enum_value_count;
+} CacheSymbols;
+
+static void FreeCacheSymbols(CacheSymbols* staged) {
+    free(staged->strings.data);
+    free(staged->scope_index);
+    free(staged->scopes);
+    free(staged->symbols);
+    free(staged->scope_slots);
+    free(staged->functions);
+    free(staged->parameters);
+    free(staged->structs);
+    free(staged->members);
+    free(staged->enums);
+    free(staged->enum_values);
+}
+
+static uint32_t FindScopeIndex(const CacheSymbols* staged, uint32_t count, const ScopeLevel* scope) {
+    ScopeIndex key = { scope, 0 };
+    const ScopeIndex* found = (const ScopeIndex*)bsearch(&key, staged->scope_index, count, sizeof(ScopeIndex),
+                                                         CompareScopeIndex);
+    return found ? found->index : TOKEN_CACHE_NONE;
+}
+
+static uint32_t ScopeSlotCount(uint32_t symbol_count) {
+    if (!symbol_count) return 0;
+
+    uint32_t slots = CACHE_MIN_SCOPE_SLOTS;
+    while (slots < symbol_count * 2) slots *= 2;
+    return slots;
+}
+
+static bool StoreSymbol(CacheStrings* strings, const SymbolTableEntry* entry, CachedSymbol* out) {
+    memset(out, 0, sizeof(*out));
+    if (!AddString(strings, entry->name, &out->name)) return false;
+
+    out->name_hash = entry->name_hash;
+    out->token_type = (uint8_t)entry->token_type;
+    out->attributes = TokenAttributes_pack(&entry->attributes);
+    out->value_type = (uint8_t)entry->value.type;
+    out->is_unsigned = entry->value.is_unsigned;
+    out->bit_width = (uint8_t)entry->value.bit_width;
+
+    switch (entry->value.type) {
+        case VAL_INTEGER: out->value.int_val = entry->value.data.int_val; break;
+        case VAL_FLOAT: out->value.float_val = entry->value.data.float_val; break;
+        case VAL_CHAR: out->value.int_val = entry->value.data.char_val; break;
+        case VAL_BOOL: out->value.int_val = entry->value.data.bool_val; break;
+        case VAL_STRING: return AddString(strings, entry->value.data.string_val, &out->value.string_val);
+        case VAL_NULL: break;
+        default: return false;
+    }
+    return true;
+}
+
+static bool StoreScopes(CacheSymbols* staged, const SymbolTables* tables) {
+    uint32_t symbols = 0;
+    uint32_t slots = 0;
+    for (uint32_t i = 0; i < tables->scope_count; i++) {
+        symbols += tables->scopes[i]->symbol_count;
+        slots += ScopeSlotCount(tables->scopes[i]->symbol_count);
+    }
+
+    staged->scope_index = (ScopeIndex*)malloc((tables->scope_count + 1) * sizeof(ScopeIndex));
+    staged->scopes = (CachedScope*)calloc(tables->scope_count + 1, sizeof(CachedScope));
+    staged->symbols = (CachedSymbol*)calloc(symbols + 1, sizeof(CachedSymbol));
+    staged->scope_slots = (uint32_t*)calloc(slots + 1, sizeof(uint32_t));
+    if (!staged->scope_index || !staged->scopes || !staged->symbols || !staged->scope_slots) return false;
+
+    for (uint32_t i = 0; i < tables->scope_count; i++) {
+        staged->scope_index[i].scope = tables->scopes[i];
+        staged->scope_index[i].index = i;
+    }
+    qsort(staged->scope_index, tables->scope_count, sizeof(ScopeIndex), CompareScopeIndex);
+
+    for (uint32_t i = 0; i < tables->scope_count; i++) {
+        const ScopeLevel* scope = tables->scopes[i];
+        CachedScope* out = &staged->scopes[i];
+        out->parent = TOKEN_CACHE_NONE;
+        if (scope->parent) {
+            out->parent = FindScopeIndex(staged, tables->scope_count, scope->parent);
+            if (out->parent >= i) return false;
+        }
+        out->level = scope->level;
+        out->first_symbol = staged->symbol_count;
+        out->first_slot = staged->scope_slot_count;
+
+        uint32_t slot_count = ScopeSlotCount(scope->symbol_count);
+        out->slot_mask = slot_count ? slot_count - 1 : 0;
+        for (const SymbolTableEntry* entry = scope->symbols; entry; entry = entry->next) {
+            if (out->symbol_count == scope->symbol_count) return false;
+
+            uint32_t index = staged->symbol_count++;
+            if (!StoreSymbol(&staged->strings, entry, &staged->symbols[index])) return false;
+            out->symbol_count++;
+
+            uint32_t* table = &staged->scope_slots[out->first_slot];
+            uint32_t slot = entry->name_hash & out->slot_mask;
+            while (table[slot]) slot = (slot + 1) & out->slot_mask;
+            table[slot] = index + 1;
+        }
+        staged->scope_slot_count += slot_count;
+    }
+    return true;
+}
+
+static bool StoreFunctions(CacheSymbols* staged, const SymbolTables* tables) {
+    uint32_t parameters = 0;
+    for (uint32_t i = 0; i < tables->function_count; i++) {
+        for (const FunctionParameter* p = tables->functions[i]->parameters; p; p = p->next) parameters++;
+    }
+
+    staged->functions = (CachedFunction*)calloc(tables->function_count + 1, sizeof(CachedFunction));
+    staged->parameters = (CachedParameter*)calloc(parameters + 1, sizeof(CachedParameter));
+    if (!staged->functions || !staged->parameters) return false;
+
+    for (uint32_t i = 0; i < tables->function_count; i++) {
+        const FunctionSignature* func = tables->functions[i];
+        CachedFunction* out = &staged->functions[i];
+        if (!AddString(&staged->strings, func->name, &out->name)) return false;
+        out->return_type = (uint8_t)func->return_type;
+        out->is_variadic = func->is_variadic;
+        out->return_attributes = TokenAttributes_pack(&func->return_attributes);
+        out->first_parameter = staged->parameter_count;
+        out->scope = TOKEN_CACHE_NONE;
+        if (func->scope) {
+            out->scope = FindScopeIndex(staged, tables->scope_count, func->scope);
+            if (out->scope == TOKEN_CACHE_NONE) return false;
+        }
+
+        for (const FunctionParameter* p = func->parameters; p; p = p->next) {
+            CachedParameter* param = &staged->parameters[staged->parameter_count++];
+            if (!AddString(&staged->strings, p->name, &param->name)) return false;
+            param->param_type = (uint8_t)p->param_type;
+            param->attributes = TokenAttributes_pack(&p->attributes);
+            out->parameter_count++;
+        }
+    }
+    return true;
+}
+
+static bool StoreStructs(CacheSymbols* staged, const SymbolTables* tables) {
+    uint32_t members = 0;
+    for (uint32_t i = 0; i < tables->struct_count; i++) {
+        for (const StructMember* m = tables->structs[i]->members; m; m = m->next) members++;
+    }
+
+    staged->structs = (CachedStruct*)calloc(tables->struct_count + 1, sizeof(CachedStruct));
+    staged->members = (CachedMember*)calloc(members + 1, sizeof(CachedMember));
+    if (!staged->structs || !staged->members) return false;
+
+    for (uint32_t i = 0; i < tables->struct_count; i++) {
+        const StructDefinition* def = tables->structs[i];
+        CachedStruct* out = &staged->structs[i];
+        if (!AddString(&staged->strings, def->name, &out->name)) return false;
+        out->first_member = staged->member_count;
+        out->total_size = def->total_size;
+        out->alignment = def->alignment;
+        out->is_union = def->is_union;
+
+        for (const StructMember* m = def->members; m; m = m->next) {
+            CachedMember* member = &staged->members[staged->member_count++];
+            if (!AddString(&staged->strings, m->name, &member->name)) return false;
+            member->member_type = (uint8_t)m->member_type;
+            member->attributes = TokenAttributes_pack(&m->attributes);
+            member->offset = m->offset;
+            out->member_count++;
+        }
+    }
+    return true;
+}
+
+static bool StoreEnums(CacheSymbols* staged, const SymbolTables* tables) {
+    uint32_t values = 0;
+    for (uint32_t i = 0; i < tables->enum_count; i++) {
+        for (const EnumValue* v = tables->enums[i]->values; v; v = v->next) values++;
+    }
+
+    staged->enums = (CachedEnum*)calloc(tables->enum_count + 1, sizeof(CachedEnum));
+    staged->enum_values = (CachedEnumValue*)calloc(values + 1, sizeof(CachedEnumValue));
+    if (!staged->enums || !staged->enum_values) return false;
+
+    for (uint32_t i = 0; i < tables->enum_count; i++) {
+        const EnumDefinition* def = tables->enums[i];
+        CachedEnum* out = &staged->enums[i];
+        if (!AddString(&staged->strings, def->name, &out->name)) return false;
+        out->first_value = staged->enum_value_count;
+        out->last_value = def->last_value;
+
+        for (const EnumValue* v = def->values; v; v = v->next) {
+            CachedEnumValue* value = &staged->enum_values[staged->enum_value_count++];
+            if (!AddString(&staged->strings, v->name, &value->name)) return false;
+            value->value = v->value;
+            out->value_count++;
+        }
+    }
+    return true;
+}
+
+static bool StoreSymbolTables(CacheSymbols* staged, const SymbolTables* tables) {
+    static const SymbolTables none = { 0 };
+    if (!tables) tables = &none;
+
+    // Offset 0 holds the empty name
+    staged->strings.data = (char*)malloc(4096);
+    if (!staged->strings.data) return false;
+    staged->strings.data[0] = '\0';
+    staged->strings.size = 1;
+    staged->strings.capacity = 4096;
+
+    return StoreScopes(staged, tables) && StoreFunctions(staged, tables) &&
+           StoreStructs(staged, tables) && StoreEnums(staged, tables);
+}
+
+// The interner's lexeme text, NUL-terminated, and where each one starts
+static char* StoreLexemes(const StringInterner* interner, uint32_t* offsets, size_t* size) {
+    size_t total = 0;
+    for (uint32_t id = 0; id < interner->count; id++) total += (size_t)interner->lengths[id] + 1;
+    if (total >= UINT32_MAX) return NULL;
+
+    char* text = (char*)malloc(total ? total : 1);
+    if (!text) return NULL;
+
+    size_t at = 0;
+    for (uint32_t id = 0; id < interner->count; id++) {
+        offsets[id] = (uint32_t)at;
+        memcpy(text + at, interner->strings[id], interner->lengths[id]);
+        at += interner->lengths[id];
+        text[at++] = '\0';
+    }
+    *size = total;
+    return text;
+}
+
+static bool WriteAll(FILE* file, const void* data, size_t size) {
+    return !size || fwrite(data, 1, size, file) == size;
+}
+
+// Writes to a descriptor it takes ownership of
+static bool WriteEntry(int fd, TokenCacheHeader* header, const void* const* sections) {
+    static const char padding[CACHE_SECTION_ALIGN] = { 0 };
+
+    FILE* file = fdopen(fd, "wb");
+    if (!file) {
+        close(fd);
+        return false;
+    }
+
+    bool ok = WriteAll(file, header, sizeof(*header));
+    uint64_t at = sizeof(*header);
+    for (int s = 0; ok && s < TOKEN_CACHE_SECTION_COUNT; s++) {
+        ok = WriteAll(file, padding, header->sections[s].offset - at) &&
+             WriteAll(file, sections[s], header->sections[s].size);
+        at = header->sections[s].offset + header->sections[s].size;
+    }
+    ok = fclose(file) == 0 && ok;
+    return ok;
+}
+
+bool TokenCache_write(const char* directory, uint64_t key, const TokenBuffer* tokens,
+                      const StringInterner* interner, const SymbolTables* symbols) {
+    if (!directory || !tokens) return false;
+    if (mkdir(directory, 0777) != 0 && errno != EEXIST) return false;
+
+    CacheSymbols staged;
+    memset(&staged, 0, sizeof(staged));
+    uint32_t lexeme_count = interner ? interner->count : 0;
+    uint32_t* lexeme_offsets = (uint32_t*)malloc((lexeme_count + 1) * sizeof(uint32_t));
+    size_t lexeme_text_size = 0;
+    char* lexeme_text = NULL;
+    bool ok = lexeme_offsets && StoreSymbolTables(&staged, symbols);
+    if (ok && interner) ok = (lexeme_text = StoreLexemes(interner, lexeme_offsets, &lexeme_text_size)) != NULL;
+
+    TokenCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TOKEN_CACHE_MAGIC, sizeof(TOKEN_CACHE_MAGIC));
+    header.format = TOKEN_CACHE_FORMAT;
+    header.header_size = sizeof(header);
+    header.key = key;
+    header.lexeme_slot_mask = interner ? interner->slot_mask : 0;
+
+    const void* sections[TOKEN_CACHE_SECTION_COUNT] = {
+        [TOKEN_CACHE_TOKEN_TYPES] = tokens->types,
+        [TOKEN_CACHE_TOKEN_CATEGORIES] = tokens->categories,
+        [TOKEN_CACHE_TOKEN_OFFSETS] = tokens->offsets,
+        [TOKEN_CACHE_TOKEN_LENGTHS] = tokens->lengths,
+        [TOKEN_CACHE_TOKEN_LEXEMES] = tokens->lexemes,
+        [TOKEN_CACHE_TOKEN_ATTRIBUTES] = tokens->attributes,
+        [TOKEN_CACHE_LEXEME_OFFSETS] = lexeme_offsets,
+        [TOKEN_CACHE_LEXEME_LENGTHS] = interner ? interner->lengths : NULL,
+        [TOKEN_CACHE_LEXEME_HASHES] = interner ? interner->hashes : NULL,
+        [TOKEN_CACHE_LEXEME_SLOTS] = interner ? interner->slots : NULL,
+        [TOKEN_CACHE_LEXEME_TEXT] = lexeme_text,
+        [TOKEN_CACHE_SCOPES] = staged.scopes,
+        [TOKEN_CACHE_SYMBOLS] = staged.symbols,
+        [TOKEN_CACHE_SCOPE_SLOTS] = staged.scope_slots,
+        [TOKEN_CACHE_FUNCTIONS] = staged.functions,
+        [TOKEN_CACHE_PARAMETERS] = staged.parameters,
+        [TOKEN_CACHE_STRUCTS] = staged.structs,
+        [TOKEN_CACHE_MEMBERS] = staged.members,
+        [TOKEN_CACHE_ENUMS] = staged.enums,
+        [TOKEN_CACHE_ENUM_VALUES] = staged.enum_values,
+        [TOKEN_CACHE_STRINGS] = staged.strings.data,
+    };
+    const uint64_t counts[TOKEN_CACHE_SECTION_COUNT] = {
+        [TOKEN_CACHE_TOKEN_TYPES] = tokens->count,
+        [TOKEN_CACHE_TOKEN_CATEGORIES] = tokens->count,
+        [TOKEN_CACHE_TOKEN_OFFSETS] = tokens->count,
+        [TOKEN_CACHE_TOKEN_LENGTHS] = tokens->count,
+        [TOKEN_CACHE_TOKEN_LEXEMES] = tokens->count,
+        [TOKEN_CACHE_TOKEN_ATTRIBUTES] = tokens->count,
+        [TOKEN_CACHE_LEXEME_OFFSETS] = lexeme_count,
+        [TOKEN_CACHE_LEXEME_LENGTHS] = lexeme_count,
+        [TOKEN_CACHE_LEXEME_HASHES] = lexeme_count,
+        [TOKEN_CACHE_LEXEME_SLOTS] = interner ? (uint64_t)interner->slot_mask + 1 : 0,
+        [TOKEN_CACHE_LEXEME_TEXT] = lexeme_text_size,
+        [TOKEN_CACHE_SCOPES] = symbols ? symbols->scope_count : 0,
+        [TOKEN_CACHE_SYMBOLS] = staged.symbol_count,
+        [TOKEN_CACHE_SCOPE_SLOTS] = staged.scope_slot_count,
+        [TOKEN_CACHE_FUNCTIONS] = symbols ? symbols->function_count : 0,
+        [TOKEN_CACHE_PARAMETERS] = staged.parameter_count,
+        [TOKEN_CACHE_STRUCTS] = symbols ? symbols->struct_count : 0,
+        [TOKEN_CACHE_MEMBERS] = staged.member_count,
+        [TOKEN_CACHE_ENUMS] = symbols ? symbols->enum_count : 0,
+        [TOKEN_CACHE_ENUM_VALUES] = staged.enum_value_count,
+        [TOKEN_CACHE_STRINGS] = staged.strings.size,
+    };
+
+    uint64_t at = sizeof(header);
+    for (int s = 0; s < TOKEN_CACHE_SECTION_COUNT; s++) {
+        at = (at + CACHE_SECTION_ALIGN - 1) & ~(uint64_t)(CACHE_SECTION_ALIGN - 1);
+        header.sections[s].offset = at;
+        header.sections[s].size = counts[s] * section_element_sizes[s];
+        at += header.sections[s].size;
+    }
+    header.file_size = at;
+
+    // Written under a name no other writer, thread or process, can pick,
+    // then renamed into place. mkstemp creates it private; entries are
+    // readable by everyone sharing the directory.
+    char path[4096];
+    char temp[4096 + 16];
+    EntryPath(path, sizeof(path), directory, key);
+    snprintf(temp, sizeof(temp), "%s.XXXXXX", path);
+    if (ok) {
+        int fd = mkstemp(temp);
+        ok = fd >= 0;
+        if (ok) {
+            ok = fchmod(fd, 0644) == 0 && WriteEntry(fd, &header, sections) && rename(temp, path) == 0;
+            if (!ok) unlink(temp);
+        }
+    }
+
+    free(lexeme_offsets);
+    free(lexeme_text);
+    FreeCacheSymbols(&staged);
+    return ok;
+}
+
+// Reading
+
+static bool ValidName(const TokenCache* cache, CachedName name) {
+    return name.offset < cache->string_size && name.length < cache->string_size - name.offset &&
+           cache->strings[name.offset + name.length] == '\0';
+}
+
+static bool ValidRun(uint32_t first, uint32_t count, uint32_t total) {
+    return first <= total && count <= total - first;
+}
+
+// Section bounds and counts; the lexeme and symbol checks follow
+static bool MapSections(TokenCache* cache, const TokenCacheHeader* header) {
+    const uint8_t* base = (const uint8_t*)cache->map;
+    const void* at[TOKEN_CACHE_SECTION_COUNT];
+    uint64_t counts[TOKEN_CACHE_SECTION_COUNT];
+
+    for (int s = 0; s < TOKEN_CACHE_SECTION_COUNT; s++) {
+        uint64_t offset = header->sections[s].offset;
+        uint64_t size = header->sections[s].size;
+        if (offset % CACHE_SECTION_ALIGN || offset < sizeof(*header) || offset > cache->map_size ||
+            size > cache->map_size - offset || size % section_element_sizes[s]) {
+            return false;
+        }
+        counts[s] = size / section_element_sizes[s];
+        if (counts[s] >= UINT32_MAX) return false;
+        at[s] = base + offset;
+    }
+
+    uint64_t tokens = counts[TOKEN_CACHE_TOKEN_TYPES];
+    uint64_t lexemes = counts[TOKEN_CACHE_LEXEME_OFFSETS];
+    for (int s = TOKEN_CACHE_TOKEN_TYPES; s <= TOKEN_CACHE_TOKEN_ATTRIBUTES; s++) {
+        if (counts[s] != tokens) return false;
+    }
+    if (counts[TOKEN_CACHE_LEXEME_LENGTHS] != lexemes || counts[TOKEN_CACHE_LEXEME_HASHES] != lexemes) {
+        return false;
+    }
+    uint64_t slots = counts[TOKEN_CACHE_LEXEME_SLOTS];
+    if (lexemes && (lexemes < LEXEME_RESERVED_COUNT || slots != (uint64_t)header->lexeme_slot_mask + 1 ||
+                    (slots & (slots - 1)) || slots < lexemes)) {
+        return false;
+    }
+
+    TokenBuffer* buffer = &cache->tokens;
+    buffer->types = (uint8_t*)at[TOKEN_CACHE_TOKEN_TYPES];
+    buffer->categories = (uint8_t*)at[TOKEN_CACHE_TOKEN_CATEGORIES];
+    buffer->offsets = (uint32_t*)at[TOKEN_CACHE_TOKEN_OFFSETS];
+    buffer->lengths = (uint32_t*)at[TOKEN_CACHE_TOKEN_LENGTHS];
+    buffer->lexemes = (LexemeId*)at[TOKEN_CACHE_TOKEN_LEXEMES];
+    buffer->attributes = (uint16_t*)at[TOKEN_CACHE_TOKEN_ATTRIBUTES];
+    buffer->count = (uint32_t)tokens;
+    buffer->capacity = (uint32_t)tokens;
+
+    StringInterner* interner = &cache->interner;
+    interner->lengths = (uint32_t*)at[TOKEN_CACHE_LEXEME_LENGTHS];
+    interner->hashes = (uint32_t*)at[TOKEN_CACHE_LEXEME_HASHES];
+    interner->slots = (uint32_t*)at[TOKEN_CACHE_LEXEME_SLOTS];
+    interner->slot_mask = header->lexeme_slot_mask;
+    interner->count = (uint32_t)lexemes;
+    interner->capacity = (uint32_t)lexemes;
+
+    cache->scopes = (const CachedScope*)at[TOKEN_CACHE_SCOPES];
+    cache->scope_count = (uint32_t)counts[TOKEN_CACHE_SCOPES];
+    cache->symbols = (const CachedSymbol*)at[TOKEN_CACHE_SYMBOLS];
+    cache->symbol_count = (uint32_t)counts[TOKEN_CACHE_SYMBOLS];
+    cache->scope_slots = (const uint32_t*)at[TOKEN_CACHE_SCOPE_SLOTS];
+    cache->scope_slot_count = (uint32_t)counts[TOKEN_CACHE_SCOPE_SLOTS];
+    cache->functions = (const CachedFunction*)at[TOKEN_CACHE_FUNCTIONS];
+    cache->function_count = (uint32_t)counts[TOKEN_CACHE_FUNCTIONS];
+    cache->parameters = (const CachedParameter*)at[TOKEN_CACHE_PARAMETERS];
+    cache->parameter_count = (uint32_t)counts[TOKEN_CACHE_PARAMETERS];
+    cache->structs = (const CachedStruct*)at[TOKEN_CACHE_STRUCTS];
+    cache->struct_count = (uint32_t)counts[TOKEN_CACHE_STRUCTS];
+    cache->members = (const CachedMember*)at[TOKEN_CACHE_MEMBERS];
+    cache->member_count = (uint32_t)counts[TOKEN_CACHE_MEMBERS];
+    cache->enums = (const CachedEnum*)at[TOKEN_CACHE_ENUMS];
+    cache->enum_count = (uint32_t)counts[TOKEN_CACHE_ENUMS];
+    cache->enum_values = (const CachedEnumValue*)at[TOKEN_CACHE_ENUM_VALUES];
+    cache->enum_value_count = (uint32_t)counts[TOKEN_CACHE_ENUM_VALUES];
+    cache->strings = (const char*)at[TOKEN_CACHE_STRINGS];
+    cache->string_size = (uint32_t)counts[TOKEN_CACHE_STRINGS];
+
+    // Lexeme text is only reached through the string pointers below
+    const uint32_t* offsets = (const uint32_t*)at[TOKEN_CACHE_LEXEME_OFFSETS];
+    const char* text = (const char*)at[TOKEN_CACHE_LEXEME_TEXT];
+    uint64_t text_size = counts[TOKEN_CACHE_LEXEME_TEXT];
+    if (!lexemes) return true;
+
+    interner->strings = (const char**)malloc(lexemes * sizeof(char*));
+    if (!interner->strings) return false;
+    for (uint32_t id = 0; id < lexemes; id++) {
+        if (offsets[id] >= text_size || interner->lengths[id] >= text_size - offsets[id] ||
+            text[offsets[id] + interner->lengths[id]] != '\0') {
+            return false;
+        }
+        interner->strings[id] = text + offsets[id];
+    }
+    // Lookups probe until an empty slot, so a full table would never end one
+    uint64_t empty = 0;
+    for (uint64_t slot = 0; slot < slots; slot++) {
+        if (interner->slots[slot] >= lexemes) return false;
+        empty += interner->slots[slot] == LEXEME_NONE;
+    }
+    return empty != 0;
+}
+
+// Every token has a known type, a lexeme the entry's interner or the
+// reserved table holds, and a span inside the source
+static bool CheckTokens(const TokenCache* cache, size_t text_size) {
+    const TokenBuffer* tokens = &cache->tokens;
+    uint32_t lexemes = cache->interner.count ? cache->interner.count : LEXEME_RESERVED_COUNT;
+    bool bad = false;
+    for (uint32_t i = 0; i < tokens->count; i++) {
+        bad |= tokens->types[i] >= TOKEN_TYPE_COUNT;
+        bad |= tokens->lexemes[i] >= lexemes;
+        bad |= tokens->offsets[i] > text_size;
+        bad |= tokens->lengths[i] > text_size - tokens->offsets[i];
+    }
+    return !bad;
+}
+
+// Links and names of the symbol records, so lookups stay in bounds
+static bool CheckSymbols(const TokenCache* cache) {
+    if (cache->string_size && cache->strings[cache->string_size - 1] != '\0') return false;
+
+    for (uint32_t i = 0; i < cache->scope_count; i++) {
+        const CachedScope* scope = &cache->scopes[i];
+        if ((scope->parent != TOKEN_CACHE_NONE && scope->parent >= i) ||
+            !ValidRun(scope->first_symbol, scope->symbol_count, cache->symbol_count)) {
+            return false;
+        }
+        if (!scope->symbol_count) continue;
+
+        // Tables are written at most half full; lookups probe until an
+        // empty slot, so a table without one is refused
+        uint64_t slots = (uint64_t)scope->slot_mask + 1;
+        if ((slots & (slots - 1)) || slots < (uint64_t)scope->symbol_count * 2 ||
+            !ValidRun(scope->first_slot, (uint32_t)slots, cache->scope_slot_count)) {
+            return false;
+        }
+        const uint32_t* table = cache->scope_slots + scope->first_slot;
+        uint32_t empty = 0;
+        for (uint32_t slot = 0; slot < slots; slot++) {
+            if (table[slot] && (table[slot] <= scope->first_symbol ||
+                                table[slot] > scope->first_symbol + scope->symbol_count)) {
+                return false;
+            }
+            empty += !table[slot];
+        }
+        if (!empty) return false;
+    }
+
+    for (uint32_t i = 0; i < cache->symbol_count; i++) {
+        const CachedSymbol* symbol = &cache->symbols[i];
+        if (!ValidName(cache, symbol->name)) return false;
+        if (symbol->value_type == VAL_STRING && !ValidName(cache, symbol->value.string_val)) return false;
+    }
+    for (uint32_t i = 0; i < cache->function_count; i++) {
+        const CachedFunction* func = &cache->functions[i];
+        if (!ValidName(cache, func->name) ||
+            !ValidRun(func->first_parameter, func->parameter_count, cache->parameter_count) ||
+            (func->scope != TOKEN_CACHE_NONE && func->scope >= cache->scope_count)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < cache->parameter_count; i++) {
+        if (!ValidName(cache, cache->parameters[i].name)) return false;
+    }
+    for (uint32_t i = 0; i < cache->struct_count; i++) {
+        const CachedStruct* def = &cache->structs[i];
+        if (!ValidName(cache, def->name) || !ValidRun(def->first_member, def->member_count, cache->member_count)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < cache->member_count; i++) {
+        if (!ValidName(cache, cache->members[i].name)) return false;
+    }
+    for (uint32_t i = 0; i < cache->enum_count; i++) {
+        const CachedEnum* def = &cache->enums[i];
+        if (!ValidName(cache, def->name) || !ValidRun(def->first_value, def->value_count, cache->enum_value_count)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < cache->enum_value_count; i++) {
+        if (!ValidName(cache, cache->enum_values[i].name)) return false;
+    }
+    return true;
+}
+
+TokenCache* TokenCache_open(const char* directory, uint64_t key, const char* text, size_t size) {
+    if (!directory || (!text && size)) return NULL;
+
+    char path[4096];
+    EntryPath(path, sizeof(path), directory, key);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    TokenCache* cache = NULL;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(TokenCacheHeader)) {
+        void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            cache = (TokenCache*)calloc(1, sizeof(TokenCache));
+            if (cache) {
+                cache->map = map;
+                cache->map_size = (size_t)st.st_size;
+            } else {
+                munmap(map, (size_t)st.st_size);
+            }
+        }
+    }
+    close(fd);
+    if (!cache) return NULL;
+
+    const TokenCacheHeader* header = (const TokenCacheHeader*)cache->map;
+    bool ok = memcmp(header->magic, TOKEN_CACHE_MAGIC, sizeof(TOKEN_CACHE_MAGIC)) == 0 &&
+              header->format == TOKEN_CACHE_FORMAT && header->header_size == sizeof(*header) &&
+              header->key == key && header->file_size == cache->map_size &&
+              MapSections(cache, header) && CheckTokens(cache, size) && CheckSymbols(cache);
+    if (!ok) {
+        TokenCache_close(cache);
+        return NULL;
+    }
+
+    cache->tokens.text = text;
+    cache->tokens.interner = cache->interner.count ? &cache->interner : NULL;
+    return cache;
+}
+
+void TokenCache_close(TokenCache* cache) {
+    if (!cache) return;
+    if (cache->map) munmap(cache->map, cache->map_size);
+    free((void*)cache->interner.strings);
+    free(cache);
+}
+
+const CachedSymbol* TokenCache_findSymbol(const TokenCache* cache, uint32_t scope, const char* name,
+                                          size_t length) {
+    if (!cache || !name) return NULL;
+
+    uint32_t hash = Lexeme_hash(name, length);
+    while (scope < cache->scope_count) {
+        const CachedScope* level = &cache->scopes[scope];
+        const uint32_t* table = cache->scope_slots + level->first_slot;
+        for (uint32_t slot = hash & level->slot_mask; level->symbol_count && table[slot];
+             slot = (slot + 1) & level->slot_mask) {
+            const CachedSymbol* symbol = &cache->symbols[table[slot] - 1];
+            if (symbol->name_hash == hash && symbol->name.length == length &&
+                memcmp(cache->strings + symbol->name.offset, name, length) == 0) {
+                return symbol;
+            }
+        }
+        scope = level->parent;
+    }
+    return NULL;
+}
+
+SymbolTableEntry* TokenCache_loadSymbol(const TokenCache* cache, const CachedSymbol* symbol) {
+    if (!cache || !symbol) return NULL;
+
+    SymbolTableEntry* entry = CreateSymbol(TokenCache_string(cache, symbol->name), (TokenType)symbol->token_type);
+    if (!entry) return NULL;
+
+    TokenAttributes_unpack(symbol->attributes, &entry->attributes);
+    entry->value.is_unsigned = symbol->is_unsigned;
+    entry->value.bit_width = symbol->bit_width;
+    switch (symbol->value_type) {
+        case VAL_INTEGER: entry->value.data.int_val = symbol->value.int_val; break;
+        case VAL_FLOAT: entry->value.data.float_val = symbol->value.float_val; break;
+        case VAL_CHAR: entry->value.data.char_val = (char)symbol->value.int_val; break;
+        case VAL_BOOL: entry->value.data.bool_val = symbol->value.int_val != 0; break;
+        case VAL_STRING:
+            entry->value.data.string_val = strdup(TokenCache_string(cache, symbol->value.string_val));
+            if (!entry->value.data.string_val) {
+                DestroySymbol(entry);
+                return NULL;
+            }
+            break;
+        default: return entry;  // VAL_NULL, or a type entries never hold
+    }
+    entry->value.type = (ValueType)symbol->value_type;
+    return entry;
+}
@@ -0,0 +1,230 @@
+#ifndef SYM_CACHE_H
+#define SYM_CACHE_H
+
+#include "sym_buffer.h"
+#include "sym_value.h"
+
+// Compiler build the cache entries belong to; release builds should
+// pass their own, e.g. -DGOSI_VERSION="\"$(git describe)\""
+#ifndef GOSI_VERSION
+#define GOSI_VERSION "0.1.0-dev"
+#endif
+
+// Bumped whenever the file layout below changes
+#define TOKEN_CACHE_FORMAT 1
+#define TOKEN_CACHE_MAGIC "GOSITOK"
+#define TOKEN_CACHE_EXTENSION ".gtc"
+
+// Lexer options that change the token stream, mixed into the key
+#define TOKEN_CACHE_SKIP_COMMENTS 0x1
+#define TOKEN_CACHE_INTERNED      0x2
+// Symbol values are folded constants
+#define TOKEN_CACHE_FOLDED        0x4
+
+// X(section, element type): the sections of a cache file, in file order
+#define TOKEN_CACHE_SECTION_LIST(X) \
+    X(TOKEN_TYPES, uint8_t) \
+    X(TOKEN_CATEGORIES, uint8_t) \
+    X(TOKEN_OFFSETS, uint32_t) \
+    X(TOKEN_LENGTHS, uint32_t) \
+    X(TOKEN_LEXEMES, LexemeId) \
+    X(TOKEN_ATTRIBUTES, uint16_t) \
+    X(LEXEME_OFFSETS, uint32_t)     /* Into LEXEME_TEXT */ \
+    X(LEXEME_LENGTHS, uint32_t) \
+    X(LEXEME_HASHES, uint32_t) \
+    X(LEXEME_SLOTS, uint32_t) \
+    X(LEXEME_TEXT, char) \
+    X(SCOPES, CachedScope) \
+    X(SYMBOLS, CachedSymbol) \
+    X(SCOPE_SLOTS, uint32_t) \
+    X(FUNCTIONS, CachedFunction) \
+    X(PARAMETERS, CachedParameter) \
+    X(STRUCTS, CachedStruct) \
+    X(MEMBERS, CachedMember) \
+    X(ENUMS, CachedEnum) \
+    X(ENUM_VALUES, CachedEnumValue) \
+    X(STRINGS, char)
+
+typedef enum TokenCacheSection {
+#define X(section, type) TOKEN_CACHE_##section,
+    TOKEN_CACHE_SECTION_LIST(X)
+#undef X
+    TOKEN_CACHE_SECTION_COUNT
+} TokenCacheSection;
+
+#define TOKEN_CACHE_NONE UINT32_MAX
+
+// Symbol tables are stored flat so they are read straight from the
+// mapping: names are NUL-terminated spans of the STRINGS section and
+// links are indices into the other sections.
+typedef struct CachedName {
+    uint32_t offset;
+    uint32_t length;
+} CachedName;
+
+typedef struct CachedScope {
+    uint32_t parent;        // Earlier scope, or TOKEN_CACHE_NONE
+    int32_t level;
+    uint32_t first_symbol;  // Run of SYMBOLS, newest first as in ScopeLevel
+    uint32_t symbol_count;
+    uint32_t first_slot;    // Open addressing table in SCOPE_SLOTS holding
+    uint32_t slot_mask;     // symbol index + 1, 0 = empty
+} CachedScope;
+
+typedef struct CachedSymbol {
+    CachedName name;
+    uint32_t name_hash;     // Lexeme_hash of the name
+    uint8_t token_type;
+    uint8_t value_type;     // ValueType
+    uint16_t attributes;    // TOKEN_ATTR_* bits
+    uint8_t is_unsigned;
+    uint8_t bit_width;
+    uint16_t reserved;
+    union {
+        int64_t int_val;    // Also holds char and bool values
+        double float_val;
+        CachedName string_val;
+    } value;
+} CachedSymbol;
+
+typedef struct CachedParameter {
+    CachedName name;        // Length 0 for an unnamed parameter
+    uint8_t param_type;
+    uint8_t reserved;
+    uint16_t attributes;
+} CachedParameter;
+
+typedef struct CachedFunction {
+    CachedName name;
+    uint8_t return_type;
+    uint8_t is_variadic;
+    uint16_t return_attributes;
+    uint32_t first_parameter;
+    uint32_t parameter_count;
+    uint32_t scope;         // TOKEN_CACHE_NONE if it has none
+} CachedFunction;
+
+typedef struct CachedMember {
+    CachedName name;
+    uint8_t member_type;
+    uint8_t reserved;
+    uint16_t attributes;
+    int32_t offset;
+} CachedMember;
+
+typedef struct CachedStruct {
+    CachedName name;
+    uint32_t first_member;
+    uint32_t member_count;
+    int32_t total_size;
+    int32_t alignment;
+    uint32_t is_union;
+} CachedStruct;
+
+typedef struct CachedEnumValue {
+    CachedName name;
+    int32_t value;
+} CachedEnumValue;
+
+typedef struct CachedEnum {
+    CachedName name;
+    uint32_t first_value;
+    uint32_t value_count;
+    int32_t last_value;
+} CachedEnum;
+
+// Symbol tables of one source, as symbol collection leaves them. A
+// scope's parent must be listed before it; a function's scope must be
+// listed. Compound values cannot be cached.
+typedef struct SymbolTables {
+    ScopeLevel** scopes;
+    uint32_t scope_count;
+    FunctionSignature** functions;
+    uint32_t function_count;
+    StructDefinition** structs;
+    uint32_t struct_count;
+    EnumDefinition** enums;
+    uint32_t enum_count;
+} SymbolTables;
+
+typedef struct TokenCacheHeader {
+    char magic[8];
+    uint32_t format;
+    uint32_t header_size;
+    uint64_t key;
+    uint64_t file_size;
+    uint32_t lexeme_slot_mask;
+    uint32_t reserved;
+    struct {
+        uint64_t offset;
+        uint64_t size;      // Bytes
+    } sections[TOKEN_CACHE_SECTION_COUNT];
+} TokenCacheHeader;
+
+// A cache entry mapped read-only. Nothing is decoded on open: the token
+// columns, the interner tables and the symbol records point into the
+// mapping, and only the interner's string pointers are filled in. Every
+// token's type, lexeme id and span is checked on open, so a damaged
+// entry is refused rather than read out of bounds later. The views must
+// not be modified, appended to or destroyed; they live as long as the
+// cache.
+typedef struct TokenCache {
+    void* map;
+    size_t map_size;
+    TokenBuffer tokens;         // Interned tokens read through interner
+    StringInterner interner;    // Lexemes of the interner the tokens used
+    const CachedScope* scopes;
+    uint32_t scope_count;
+    const CachedSymbol* symbols;
+    uint32_t symbol_count;
+    const uint32_t* scope_slots;
+    uint32_t scope_slot_count;
+    const CachedFunction* functions;
+    uint32_t function_count;
+    const CachedParameter* parameters;
+    uint32_t parameter_count;
+    const CachedStruct* structs;
+    uint32_t struct_count;
+    const CachedMember* members;
+    uint32_t member_count;
+    const CachedEnum* enums;
+    uint32_t enum_count;
+    const CachedEnumValue* enum_values;
+    uint32_t enum_value_count;
+    const char* strings;
+    uint32_t string_size;
+} TokenCache;
+
+// XXH64 of a byte range
+uint64_t TokenCache_hash(const void* data, size_t size, uint64_t seed);
+
+// Key of a source's entry: its contents, the lexer options and the
+// compiler build (GOSI_VERSION and the token and lexeme tables)
+uint64_t TokenCache_key(const char* text, size_t size, uint32_t options);
+
+// Writes an entry atomically, so concurrent writers sharing a directory,
+// in one process or several, never see a partial file. interner and
+// symbols may be NULL.
+bool TokenCache_write(const char* directory, uint64_t key, const TokenBuffer* tokens,
+                      const StringInterner* interner, const SymbolTables* symbols);
+
+// Maps the entry for key; NULL on a miss or an entry that fails its
+// checks. text and size, which produced the key, are what token spans
+// refer to and are checked against.
+TokenCache* TokenCache_open(const char* directory, uint64_t key, const char* text, size_t size);
+void TokenCache_close(TokenCache* cache);
+
+// Access
+static inline const char* TokenCache_string(const TokenCache* cache, CachedName name) {
+    return cache->strings + name.offset;
+}
+
+// Looks a name up from a scope outwards, as FindSymbolHashed does
+const CachedSymbol* TokenCache_findSymbol(const TokenCache* cache, uint32_t scope, const char* name,
+                                          size_t length);
+
+// A symbol table entry holding a copy of a cached symbol, for
+// DestroySymbol to free
+SymbolTableEntry* TokenCache_loadSymbol(const TokenCache* cache, const CachedSymbol* symbol);
+
+#endif // SYM_CACHE_H
@@ -0,0 +1,395 @@
+#include "sym_format.h"
+#include "core/tokenizer/source/source_file.h"
+#include <errno.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Fractional digits the exact decimal path of FormatDouble tries
+#define FORMAT_EXACT_DIGITS 15
+
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const double powers_of_ten[FORMAT_EXACT_DIGITS + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+};
+
+// Lengths of token_type_names, so a dump never measures them
+static const uint8_t token_type_name_lengths[TOKEN_TYPE_COUNT] = {
+#define X(type, name, category, precedence, closing) [type] = sizeof(name) - 1,
+    TOKEN_TYPE_LIST(X)
+#undef X
+};
+
+// Buffer lifetime
+void StringBuffer_init(StringBuffer* buffer) {
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+void StringBuffer_initWith(StringBuffer* buffer, char* storage, size_t capacity) {
+    StringBuffer_init(buffer);
+    if (!storage || !capacity) return;
+    buffer->data = storage;
+    buffer->capacity = capacity;
+    storage[0] = '\0';
+}
+
+void StringBuffer_free(StringBuffer* buffer) {
+    if (!buffer) return;
+    if (buffer->heap) free(buffer->data);
+    StringBuffer_init(buffer);
+}
+
+void StringBuffer_clear(StringBuffer* buffer) {
+    buffer->length = 0;
+    buffer->failed = false;
+    if (buffer->data) buffer->data[0] = '\0';
+}
+
+bool StringBuffer_reserve(StringBuffer* buffer, size_t extra) {
+    if (buffer->failed) return false;
+    // One byte more for the terminator
+    if (extra < buffer->capacity - buffer->length) return true;
+    if (extra > SIZE_MAX / 2 - buffer->length) {
+        buffer->failed = true;
+        return false;
+    }
+
+    size_t needed = buffer->length + extra + 1;
+    size_t capacity = buffer->capacity ? buffer->capacity : STRING_BUFFER_INITIAL_CAPACITY;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+
+    char* grown = (char*)(buffer->heap ? realloc(buffer->data, capacity) : malloc(capacity));
+    if (!grown) {
+        buffer->failed = true;
+        return false;
+    }
+    if (!buffer->heap && buffer->length) memcpy(grown, buffer->data, buffer->length);
+    if (!buffer->heap) grown[buffer->length] = '\0';
+    buffer->data = grown;
+    buffer->capacity = capacity;
+    buffer->heap = true;
+    return true;
+}
+
+char* StringBuffer_detach(StringBuffer* buffer) {
+    if (buffer->failed) return NULL;
+
+    char* text;
+    if (buffer->heap) {
+        text = buffer->data;
+    } else {
+        text = (char*)malloc(buffer->length + 1);
+        if (!text) return NULL;
+        memcpy(text, buffer->data ? buffer->data : "", buffer->length);
+        text[buffer->length] = '\0';
+    }
+    StringBuffer_init(buffer);
+    return text;
+}
+
+// Appending
+size_t StringBuffer_append(StringBuffer* buffer, const char* text, size_t length) {
+    if (!StringBuffer_reserve(buffer, length)) return 0;
+    memcpy(buffer->data + buffer->length, text, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+    return length;
+}
+
+size_t StringBuffer_appendString(StringBuffer* buffer, const char* text) {
+    return StringBuffer_append(buffer, text, strlen(text));
+}
+
+size_t StringBuffer_appendChar(StringBuffer* buffer, char c) {
+    if (!StringBuffer_reserve(buffer, 1)) return 0;
+    buffer->data[buffer->length++] = c;
+    buffer->data[buffer->length] = '\0';
+    return 1;
+}
+
+size_t StringBuffer_appendInt(StringBuffer* buffer, int64_t value) {
+    if (!StringBuffer_reserve(buffer, FORMAT_INT_MAX)) return 0;
+    size_t length = FormatInt64(buffer->data + buffer->length, value);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+    return length;
+}
+
+size_t StringBuffer_appendUint(StringBuffer* buffer, uint64_t value) {
+    if (!StringBuffer_reserve(buffer, FORMAT_INT_MAX)) return 0;
+    size_t length = FormatUint64(buffer->data + buffer->length, value);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+    return length;
+}
+
+size_t StringBuffer_appendDouble(StringBuffer* buffer, double value) {
+    if (!StringBuffer_reserve(buffer, FORMAT_DOUBLE_MAX)) return 0;
+    size_t length = FormatDouble(buffer->data + buffer->length, value);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+    return length;
+}
+
+bool StringBuffer_write(const StringBuffer* buffer, int fd) {
+    if (buffer->failed) return false;
+
+    const char* p = buffer->data;
+    size_t left = buffer->length;
+    while (left) {
+        ssize_t written = write(fd, p, left);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        p += written;
+        left -= (size_t)written;
+    }
+    return true;
+}
+
+// Numbers
+
+// Digits are produced two at a time from the end
+size_t FormatUint64(char* out, uint64_t value) {
+    char digits[FORMAT_INT_MAX];
+    char* p = digits + FORMAT_INT_MAX;
+    while (value >= 100) {
+        unsigned pair = (unsigned)(value % 100) * 2;
+        value /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        unsigned pair = (unsigned)value * 2;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    } else {
+        *--p = (char)('0' + value);
+    }
+
+    size_t length = (size_t)(digits + FORMAT_INT_MAX - p);
+    memcpy(out, p, length);
+    return length;
+}
+
+size_t FormatInt64(char* out, int64_t value) {
+    if (value >= 0) return FormatUint64(out, (uint64_t)value);
+    out[0] = '-';
+    return 1 + FormatUint64(out + 1, 0 - (uint64_t)value);
+}
+
+static inline bool SignBit(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits >> 63;
+}
+
+// A double with at most FORMAT_EXACT_DIGITS fractional digits and 15
+// significant ones is n / 10^k for the smallest k at which n / 10^k,
+// a correctly rounded division, gives the double back
+static size_t FormatExactDecimal(char* out, double value) {
+    double magnitude = value < 0 ? -value : value;
+    if (!(magnitude < 1e15) || (magnitude < 1e-5 && magnitude != 0)) return 0;
+
+    for (int k = 0; k <= FORMAT_EXACT_DIGITS; k++) {
+        double scaled = magnitude * powers_of_ten[k];
+        if (scaled >= 1e15) return 0;
+
+        uint64_t n = (uint64_t)(scaled + 0.5);
+        if ((double)n / powers_of_ten[k] != magnitude) continue;
+
+        char digits[FORMAT_INT_MAX];
+        size_t count = FormatUint64(digits, n);
+        size_t length = 0;
+        if (SignBit(value)) out[length++] = '-';
+        if (count <= (size_t)k) {
+            // 0.00ddd
+            out[length++] = '0';
+            out[length++] = '.';
+            memset(out + length, '0', (size_t)k - count);
+            length += (size_t)k - count;
+            memcpy(out + length, digits, count);
+            return length + count;
+        }
+
+        size_t whole = count - (size_t)k;
+        memcpy(out + length, digits, whole);
+        length += whole;
+        out[length++] = '.';
+        if (k == 0) {
+            out[length++] = '0';
+        } else {
+            memcpy(out + length, digits + whole, (size_t)k);
+            length += (size_t)k;
+        }
+        return length;
+    }
+    return 0;
+}
+
+size_t FormatDouble(char* out, double value) {
+    if (value != value) {
+        memcpy(out, "nan", 3);
+        return 3;
+    }
+    if (value - value != 0.0) {
+        if (value < 0) {
+            memcpy(out, "-inf", 4);
+            return 4;
+        }
+        memcpy(out, "inf", 3);
+        return 3;
+    }
+
+    size_t length = FormatExactDecimal(out, value);
+    if (length) return length;
+
+    // Fifteen digits always read back as the decimal they came from,
+    // so the first precision that round-trips is the shortest. Subnormals
+    // carry fewer bits and may need fewer digits.
+    char text[FORMAT_DOUBLE_MAX + 1];
+    double magnitude = value < 0 ? -value : value;
+    for (int precision = magnitude < DBL_MIN ? 1 : 15; precision <= 17; precision++) {
+        length = (size_t)snprintf(text, sizeof(text), "%.*g", precision, value);
+        if (precision == 17 || strtod(text, NULL) == value) break;
+    }
+    memcpy(out, text, length);
+    if (!memchr(text, '.', length) && !memchr(text, 'e', length)) {
+        memcpy(out + length, ".0", 2);
+        length += 2;
+    }
+    return length;
+}
+
+// Values and tokens
+
+size_t FormatValue(StringBuffer* buffer, const LiteralValue* value) {
+    if (!value) return 0;
+
+    switch (value->type) {
+        case VAL_INTEGER:
+            return value->is_unsigned ? StringBuffer_appendUint(buffer, (uint64_t)value->data.int_val)
+                                      : StringBuffer_appendInt(buffer, value->data.int_val);
+        case VAL_FLOAT:
+            return StringBuffer_appendDouble(buffer, value->data.float_val);
+        case VAL_CHAR: {
+            char quoted[3] = { '\'', value->data.char_val, '\'' };
+            return StringBuffer_append(buffer, quoted, 3);
+        }
+        case VAL_STRING:
+            return value->data.string_val ? StringBuffer_appendString(buffer, value->data.string_val) : 0;
+        case VAL_BOOL:
+            return value->data.bool_val ? StringBuffer_append(buffer, "true", 4)
+                                        : StringBuffer_append(buffer, "false", 5);
+        case VAL_NULL:
+            return StringBuffer_append(buffer, "null", 4);
+        default:
+            return StringBuffer_append(buffer, "unknown", 7);
+    }
+}
+
+// One reservation per token; the pieces are copied in directly
+static size_t AppendToken(StringBuffer* buffer, TokenType type, const char* value, uint32_t length, int line,
+                          int column) {
+    const char* name = TokenType_toString(type);
+    size_t name_length = (unsigned)type < TOKEN_TYPE_COUNT ? token_type_name_lengths[type] : strlen(name);
+    if (!value) {
+        value = "null";
+        length = 4;
+    }
+    if (!StringBuffer_reserve(buffer, name_length + length + 2 * FORMAT_INT_MAX + 40)) return 0;
+
+    char* start = buffer->data + buffer->length;
+    char* p = start;
+    memcpy(p, "Token{type=", 11);
+    p += 11;
+    memcpy(p, name, name_length);
+    p += name_length;
+    memcpy(p, ", value='", 9);
+    p += 9;
+    memcpy(p, value, length);
+    p += length;
+    memcpy(p, "', line=", 8);
+    p += 8;
+    p += FormatInt64(p, line);
+    memcpy(p, ", col=", 6);
+    p += 6;
+    p += FormatInt64(p, column);
+    *p++ = '}';
+    *p = '\0';
+
+    buffer->length += (size_t)(p - start);
+    return (size_t)(p - start);
+}
+
+size_t Token_format(const Token* token, StringBuffer* buffer) {
+    if (!token || !buffer) return 0;
+
+    // Span tokens resolve their position only when printed
+    int line = token->line_number;
+    int column = token->column_number;
+    if (!line && token->source) {
+        SourceFile_locate(token->source, token->offset, &line, &column);
+    }
+    return AppendToken(buffer, token->type, token->value, token->length, line, column);
+}
+
+size_t TokenBuffer_format(const TokenBuffer* tokens, uint32_t begin, uint32_t end, StringBuffer* buffer) {
+    if (!tokens || !buffer) return 0;
+    if (end > tokens->count) end = tokens->count;
+
+    SourceFile* source = tokens->source;
+    bool located = source && SourceFile_buildLineIndex(source);
+    size_t start = buffer->length;
+    uint32_t line = 0;
+    for (uint32_t i = begin; i < end && !buffer->failed; i++) {
+        int line_number = 0, column = 0;
+        uint32_t offset = tokens->offsets[i];
+        if (located && offset <= source->size) {
+            // Offsets rise through a stream, so after one search the line
+            // only moves forward
+            if (i == begin || offset < source->line_starts[line]) {
+                SourceFile_locate(source, offset, &line_number, NULL);
+                line = (uint32_t)line_number - 1;
+            }
+            while (line + 1 < source->line_count && source->line_starts[line + 1] <= offset) {
+                line++;
+            }
+            line_number = (int)line + 1;
+            column = (int)(offset - source->line_starts[line]) + 1;
+        }
+
+        const char* value = TokenBuffer_value(tokens, i);
+        AppendToken(buffer, TokenBuffer_type(tokens, i), value, tokens->lengths[i], line_number, column);
+        StringBuffer_appendChar(buffer, '\n');
+    }
+    return buffer->failed ? 0 : buffer->length - start;
+}
+
+bool TokenBuffer_dump(const TokenBuffer* tokens, int fd) {
+    if (!tokens) return false;
+
+    // Formatted a chunk at a time, so the text stays in cache and memory
+    // does not grow with the stream
+    StringBuffer buffer;
+    StringBuffer_init(&buffer);
+    StringBuffer_reserve(&buffer, TOKEN_DUMP_CHUNK_TOKENS * 64);
+    bool ok = true;
+    for (uint32_t begin = 0; ok && begin < tokens->count;) {
+        uint32_t end = tokens->count - begin > TOKEN_DUMP_CHUNK_TOKENS ? begin + TOKEN_DUMP_CHUNK_TOKENS
+                                                                       : tokens->count;
+        StringBuffer_clear(&buffer);
+        TokenBuffer_format(tokens, begin, end, &buffer);
+        begin = end;
+        ok = StringBuffer_write(&buffer, fd);
+    }
+    StringBuffer_free(&buffer);
+    return ok;
+}
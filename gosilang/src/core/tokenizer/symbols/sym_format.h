@@ -0,0 +1,76 @@
+#ifndef SYM_FORMAT_H
+#define SYM_FORMAT_H
+
+#include "sym_type.h"
+#include "sym_buffer.h"
+#include "sym_value.h"
+#include <stddef.h>
+
+#define STRING_BUFFER_INITIAL_CAPACITY 256
+// Longest output of FormatInt64/FormatUint64 and of FormatDouble
+#define FORMAT_INT_MAX 20
+#define FORMAT_DOUBLE_MAX 32
+// Tokens TokenBuffer_dump formats per write
+#define TOKEN_DUMP_CHUNK_TOKENS 4096
+
+// Growable text buffer that formatting appends to. It may start in
+// caller storage, such as a stack array, and moves to the heap only
+// once it outgrows it. The text is always NUL terminated.
+//
+// Appends return the bytes appended. One that runs out of memory sets
+// failed and appends nothing, as do all after it, so a long run of
+// appends needs to be checked only once at the end.
+typedef struct StringBuffer {
+    char* data;
+    size_t length;
+    size_t capacity;
+    bool heap;              // data was allocated by the buffer
+    bool failed;
+} StringBuffer;
+
+// Buffer lifetime; a zeroed StringBuffer is an empty one
+void StringBuffer_init(StringBuffer* buffer);
+void StringBuffer_initWith(StringBuffer* buffer, char* storage, size_t capacity);
+void StringBuffer_free(StringBuffer* buffer);
+void StringBuffer_clear(StringBuffer* buffer);
+bool StringBuffer_reserve(StringBuffer* buffer, size_t extra);
+
+// The text as a heap string the caller frees, leaving the buffer empty
+char* StringBuffer_detach(StringBuffer* buffer);
+
+// Appending
+size_t StringBuffer_append(StringBuffer* buffer, const char* text, size_t length);
+size_t StringBuffer_appendString(StringBuffer* buffer, const char* text);
+size_t StringBuffer_appendChar(StringBuffer* buffer, char c);
+size_t StringBuffer_appendInt(StringBuffer* buffer, int64_t value);
+size_t StringBuffer_appendUint(StringBuffer* buffer, uint64_t value);
+size_t StringBuffer_appendDouble(StringBuffer* buffer, double value);
+
+// Writes the whole text to fd, in one write call unless the kernel
+// takes less. Output already buffered in a FILE* on the same descriptor
+// must be flushed first.
+bool StringBuffer_write(const StringBuffer* buffer, int fd);
+
+// Number formatting into arrays of at least FORMAT_INT_MAX and
+// FORMAT_DOUBLE_MAX bytes; none of them NUL terminates.
+// FormatDouble gives the shortest text that reads back as the same
+// double, with a '.' or exponent so it reads back as a float.
+size_t FormatUint64(char* out, uint64_t value);
+size_t FormatInt64(char* out, int64_t value);
+size_t FormatDouble(char* out, double value);
+
+// Formats as ValueToString does
+size_t FormatValue(StringBuffer* buffer, const LiteralValue* value);
+
+// "Token{type=..., value='...', line=..., col=...}", as Token_print
+size_t Token_format(const Token* token, StringBuffer* buffer);
+
+// Tokens [begin, end) one per line in the Token_format layout. Lines are
+// found with a cursor over the source's line index, not a search per token.
+size_t TokenBuffer_format(const TokenBuffer* tokens, uint32_t begin, uint32_t end, StringBuffer* buffer);
+
+// Writes the whole stream to fd as TokenBuffer_format lays it out, one
+// write per TOKEN_DUMP_CHUNK_TOKENS tokens
+bool TokenBuffer_dump(const TokenBuffer* tokens, int fd);
+
+#endif // SYM_FORMAT_H
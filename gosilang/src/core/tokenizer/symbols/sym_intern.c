@@ -0,0 +1,350 @@
+#include "sym_intern.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERNER_INITIAL_CAPACITY 1024
+#define INTERNER_STORAGE_BLOCK (64 * 1024)
+
+// Spellings of the reserved lexemes, indexed by ReservedLexeme
+static const char* const reserved_spellings[LEXEME_RESERVED_COUNT] = {
+    [LEXEME_NONE] = "",
+#define X(lexeme, spelling) [lexeme] = spelling,
+    RESERVED_SYMBOL_LIST(X)
+    RESERVED_CONSTANT_LIST(X)
+#undef X
+#define X(kw, spelling, type) [LEXEME_KEYWORD_FIRST + kw] = spelling,
+    KEYWORD_TYPE_LIST(X)
+#undef X
+};
+
+// Lexeme of each operator
+static const LexemeId operator_lexemes[OPERATOR_TYPE_COUNT] = {
+    [OP_ADD] = LEXEME_PLUS,
+    [OP_SUBTRACT] = LEXEME_MINUS,
+    [OP_MULTIPLY] = LEXEME_STAR,
+    [OP_DIVIDE] = LEXEME_SLASH,
+    [OP_MODULO] = LEXEME_PERCENT,
+    [OP_ASSIGN] = LEXEME_ASSIGN,
+    [OP_ADD_ASSIGN] = LEXEME_PLUS_ASSIGN,
+    [OP_SUB_ASSIGN] = LEXEME_MINUS_ASSIGN,
+    [OP_MUL_ASSIGN] = LEXEME_STAR_ASSIGN,
+    [OP_DIV_ASSIGN] = LEXEME_SLASH_ASSIGN,
+    [OP_MOD_ASSIGN] = LEXEME_PERCENT_ASSIGN,
+    [OP_AND_ASSIGN] = LEXEME_AMP_ASSIGN,
+    [OP_OR_ASSIGN] = LEXEME_PIPE_ASSIGN,
+    [OP_XOR_ASSIGN] = LEXEME_CARET_ASSIGN,
+    [OP_SHL_ASSIGN] = LEXEME_SHL_ASSIGN,
+    [OP_SHR_ASSIGN] = LEXEME_SHR_ASSIGN,
+    [OP_BITWISE_AND] = LEXEME_AMP,
+    [OP_BITWISE_OR] = LEXEME_PIPE,
+    [OP_BITWISE_XOR] = LEXEME_CARET,
+    [OP_BITWISE_NOT] = LEXEME_TILDE,
+    [OP_SHIFT_LEFT] = LEXEME_SHL,
+    [OP_SHIFT_RIGHT] = LEXEME_SHR,
+    [OP_LOGICAL_AND] = LEXEME_AMP_AMP,
+    [OP_LOGICAL_OR] = LEXEME_PIPE_PIPE,
+    [OP_LOGICAL_NOT] = LEXEME_BANG,
+    [OP_EQUAL] = LEXEME_EQUAL,
+    [OP_NOT_EQUAL] = LEXEME_NOT_EQUAL,
+    [OP_LESS] = LEXEME_LESS,
+    [OP_GREATER] = LEXEME_GREATER,
+    [OP_LESS_EQUAL] = LEXEME_LESS_EQUAL,
+    [OP_GREATER_EQUAL] = LEXEME_GREATER_EQUAL,
+    [OP_INCREMENT] = LEXEME_INCREMENT,
+    [OP_DECREMENT] = LEXEME_DECREMENT,
+    [OP_MEMBER_DOT] = LEXEME_DOT,
+    [OP_MEMBER_ARROW] = LEXEME_ARROW,
+    [OP_ADDRESS_OF] = LEXEME_AMP,
+    [OP_DEREFERENCE] = LEXEME_STAR,
+    [OP_SIZEOF] = LEXEME_KEYWORD_FIRST + KW_SIZEOF,
+    [OP_COMMA] = LEXEME_COMMA,
+    [OP_CONDITIONAL] = LEXEME_QUESTION
+};
+
+// Default (binary or postfix) reading of each operator lexeme
+#define LEXEME_OPERATOR_LIST(X) \
+    X(LEXEME_PLUS, OP_ADD) \
+    X(LEXEME_MINUS, OP_SUBTRACT) \
+    X(LEXEME_STAR, OP_MULTIPLY) \
+    X(LEXEME_SLASH, OP_DIVIDE) \
+    X(LEXEME_PERCENT, OP_MODULO) \
+    X(LEXEME_ASSIGN, OP_ASSIGN) \
+    X(LEXEME_PLUS_ASSIGN, OP_ADD_ASSIGN) \
+    X(LEXEME_MINUS_ASSIGN, OP_SUB_ASSIGN) \
+    X(LEXEME_STAR_ASSIGN, OP_MUL_ASSIGN) \
+    X(LEXEME_SLASH_ASSIGN, OP_DIV_ASSIGN) \
+    X(LEXEME_PERCENT_ASSIGN, OP_MOD_ASSIGN) \
+    X(LEXEME_AMP_ASSIGN, OP_AND_ASSIGN) \
+    X(LEXEME_PIPE_ASSIGN, OP_OR_ASSIGN) \
+    X(LEXEME_CARET_ASSIGN, OP_XOR_ASSIGN) \
+    X(LEXEME_SHL_ASSIGN, OP_SHL_ASSIGN) \
+    X(LEXEME_SHR_ASSIGN, OP_SHR_ASSIGN) \
+    X(LEXEME_AMP, OP_BITWISE_AND) \
+    X(LEXEME_PIPE, OP_BITWISE_OR) \
+    X(LEXEME_CARET, OP_BITWISE_XOR) \
+    X(LEXEME_TILDE, OP_BITWISE_NOT) \
+    X(LEXEME_SHL, OP_SHIFT_LEFT) \
+    X(LEXEME_SHR, OP_SHIFT_RIGHT) \
+    X(LEXEME_AMP_AMP, OP_LOGICAL_AND) \
+    X(LEXEME_PIPE_PIPE, OP_LOGICAL_OR) \
+    X(LEXEME_BANG, OP_LOGICAL_NOT) \
+    X(LEXEME_EQUAL, OP_EQUAL) \
+    X(LEXEME_NOT_EQUAL, OP_NOT_EQUAL) \
+    X(LEXEME_LESS, OP_LESS) \
+    X(LEXEME_GREATER, OP_GREATER) \
+    X(LEXEME_LESS_EQUAL, OP_LESS_EQUAL) \
+    X(LEXEME_GREATER_EQUAL, OP_GREATER_EQUAL) \
+    X(LEXEME_INCREMENT, OP_INCREMENT) \
+    X(LEXEME_DECREMENT, OP_DECREMENT) \
+    X(LEXEME_DOT, OP_MEMBER_DOT) \
+    X(LEXEME_ARROW, OP_MEMBER_ARROW) \
+    X(LEXEME_KEYWORD_FIRST + KW_SIZEOF, OP_SIZEOF) \
+    X(LEXEME_COMMA, OP_COMMA) \
+    X(LEXEME_QUESTION, OP_CONDITIONAL)
+
+// Operator of each lexeme, stored as op + 1
+const uint8_t lexeme_operators[LEXEME_RESERVED_COUNT] = {
+#define X(lexeme, op) [lexeme] = op + 1,
+    LEXEME_OPERATOR_LIST(X)
+#undef X
+};
+
+// Precedence of each lexeme's operator, so GetOperatorPrecedence is one
+// load; every other id reads 0
+_Static_assert(LEXEME_RESERVED_COUNT <= OPERATOR_LEXEME_LIMIT, "reserved lexemes must fit lexeme_binary_precedence");
+const int8_t lexeme_binary_precedence[OPERATOR_LEXEME_LIMIT] = {
+#define X(lexeme, op) [lexeme] = op##_PRECEDENCE,
+    LEXEME_OPERATOR_LIST(X)
+#undef X
+};
+
+// FNV-1a; lexemes are short so a byte loop is cheap
+uint32_t Lexeme_hash(const char* str, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static bool GrowEntries(StringInterner* interner) {
+    if (interner->capacity > UINT32_MAX / 2) return false;
+    uint32_t capacity = interner->capacity * 2;
+    const char** strings = (const char**)realloc((void*)interner->strings, capacity * sizeof(char*));
+    if (!strings) return false;
+    interner->strings = strings;
+
+    uint32_t* lengths = (uint32_t*)realloc(interner->lengths, capacity * sizeof(uint32_t));
+    if (!lengths) return false;
+    interner->lengths = lengths;
+
+    uint32_t* hashes = (uint32_t*)realloc(interner->hashes, capacity * sizeof(uint32_t));
+    if (!hashes) return false;
+    interner->hashes = hashes;
+
+    interner->capacity = capacity;
+    return true;
+}
+
+static bool GrowSlots(StringInterner* interner) {
+    if (interner->slot_mask >= UINT32_MAX / 2) return false;
+    uint32_t slot_count = (interner->slot_mask + 1) * 2;
+    uint32_t* slots = (uint32_t*)calloc(slot_count, sizeof(uint32_t));
+    if (!slots) return false;
+
+    uint32_t mask = slot_count - 1;
+    for (uint32_t id = 1; id < interner->count; id++) {
+        uint32_t slot = interner->hashes[id] & mask;
+        while (slots[slot]) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id;
+    }
+
+    free(interner->slots);
+    interner->slots = slots;
+    interner->slot_mask = mask;
+    return true;
+}
+
+// Returns the slot holding the lexeme, or the empty slot where it belongs
+static uint32_t FindSlot(const StringInterner* interner, const char* str, size_t length, uint32_t hash) {
+    uint32_t slot = hash & interner->slot_mask;
+    for (;;) {
+        uint32_t id = interner->slots[slot];
+        if (!id) return slot;
+        if (interner->hashes[id] == hash &&
+            interner->lengths[id] == length &&
+            memcmp(interner->strings[id], str, length) == 0) {
+            return slot;
+        }
+        slot = (slot + 1) & interner->slot_mask;
+    }
+}
+
+StringInterner* StringInterner_create(void) {
+    StringInterner* interner = (StringInterner*)calloc(1, sizeof(StringInterner));
+    if (!interner) return NULL;
+
+    interner->storage = TokenArena_create(INTERNER_STORAGE_BLOCK);
+    interner->capacity = INTERNER_INITIAL_CAPACITY;
+    interner->strings = (const char**)malloc(interner->capacity * sizeof(char*));
+    interner->lengths = (uint32_t*)malloc(interner->capacity * sizeof(uint32_t));
+    interner->hashes = (uint32_t*)malloc(interner->capacity * sizeof(uint32_t));
+    interner->slot_mask = INTERNER_INITIAL_CAPACITY * 2 - 1;
+    interner->slots = (uint32_t*)calloc(interner->slot_mask + 1, sizeof(uint32_t));
+
+    if (!interner->storage || !interner->strings || !interner->lengths ||
+        !interner->hashes || !interner->slots) {
+        StringInterner_destroy(interner);
+        return NULL;
+    }
+
+    // Slot 0 is LEXEME_NONE
+    interner->strings[0] = "";
+    interner->lengths[0] = 0;
+    interner->hashes[0] = 0;
+    interner->count = 1;
+
+    // Seed reserved lexemes in ReservedLexeme order
+    for (int id = 1; id < LEXEME_RESERVED_COUNT; id++) {
+        StringInterner_intern(interner, reserved_spellings[id], strlen(reserved_spellings[id]));
+    }
+
+    return interner;
+}
+
+void StringInterner_destroy(StringInterner* interner) {
+    if (!interner) return;
+
+    TokenArena_destroy(interner->storage);
+    free((void*)interner->strings);
+    free(interner->lengths);
+    free(interner->hashes);
+    free(interner->slots);
+    free(interner);
+}
+
+LexemeId StringInterner_intern(StringInterner* interner, const char* str, size_t length) {
+    if (!interner || !str || length > UINT32_MAX) return LEXEME_NONE;
+
+    uint32_t hash = Lexeme_hash(str, length);
+    uint32_t slot = FindSlot(interner, str, length, hash);
+    if (interner->slots[slot]) {
+        return interner->slots[slot];
+    }
+
+    if (interner->count == interner->capacity && !GrowEntries(interner)) {
+        return LEXEME_NONE;
+    }
+
+    // Keep the load factor at or below one half. The table grows before
+    // the insert, so when it cannot grow the lexeme is refused and the
+    // table is left as it was rather than filling up.
+    if ((interner->count + 1) * 2 > interner->slot_mask + 1) {
+        if (!GrowSlots(interner)) return LEXEME_NONE;
+        slot = FindSlot(interner, str, length, hash);
+    }
+
+    char* copy = TokenArena_strndup(interner->storage, str, length);
+    if (!copy) return LEXEME_NONE;
+
+    LexemeId id = interner->count++;
+    interner->strings[id] = copy;
+    interner->lengths[id] = (uint32_t)length;
+    interner->hashes[id] = hash;
+    interner->slots[slot] = id;
+    return id;
+}
+
+LexemeId StringInterner_find(const StringInterner* interner, const char* str, size_t length) {
+    if (!interner || !str) return LEXEME_NONE;
+
+    uint32_t slot = FindSlot(interner, str, length, Lexeme_hash(str, length));
+    return interner->slots[slot];
+}
+
+const char* StringInterner_get(const StringInterner* interner, LexemeId id, uint32_t* length) {
+    if (!interner || id == LEXEME_NONE || id >= interner->count) return NULL;
+
+    if (length) *length = interner->lengths[id];
+    return interner->strings[id];
+}
+
+// Reserved lexeme classification
+
+// Static spelling of a reserved lexeme, usable without an interner
+// Ids are stored in a byte, and a table at most half full keeps probes short
+_Static_assert(LEXEME_RESERVED_COUNT * 2 <= RESERVED_TABLE_SIZE, "reserved lexemes must fit ReservedTable");
+static ReservedTable reserved_table;
+static pthread_once_t reserved_table_once = PTHREAD_ONCE_INIT;
+
+static void BuildReservedTable(void) {
+    for (LexemeId id = 1; id < LEXEME_RESERVED_COUNT; id++) {
+        const char* spelling = reserved_spellings[id];
+        size_t length = strlen(spelling);
+        reserved_table.spellings[id] = spelling;
+        reserved_table.lengths[id] = (uint8_t)length;
+
+        uint32_t slot = ReservedTable_slot(spelling, length);
+        while (reserved_table.slots[slot]) slot = (slot + 1) & (RESERVED_TABLE_SIZE - 1);
+        reserved_table.slots[slot] = (uint8_t)id;
+    }
+    reserved_table.spellings[LEXEME_NONE] = "";
+}
+
+const ReservedTable* ReservedTable_get(void) {
+    pthread_once(&reserved_table_once, BuildReservedTable);
+    return &reserved_table;
+}
+
+const char* Lexeme_getReserved(LexemeId id, uint32_t* length) {
+    if (id == LEXEME_NONE || id >= LEXEME_RESERVED_COUNT) return NULL;
+
+    if (length) *length = (uint32_t)strlen(reserved_spellings[id]);
+    return reserved_spellings[id];
+}
+
+LexemeId Lexeme_fromOperator(OperatorType op) {
+    if ((unsigned)op >= OPERATOR_TYPE_COUNT) return LEXEME_NONE;
+    return operator_lexemes[op];
+}
+
+bool Lexeme_toKeyword(LexemeId id, KeywordType* kw) {
+    if (id < LEXEME_KEYWORD_FIRST || id > LEXEME_KEYWORD_LAST) return false;
+
+    if (kw) *kw = (KeywordType)(id - LEXEME_KEYWORD_FIRST);
+    return true;
+}
+
+// Linear lookup by spelling, for tokens built by hand rather than lexed
+LexemeId Lexeme_findReserved(const char* str, size_t length) {
+    if (!str) return LEXEME_NONE;
+    return ReservedTable_find(ReservedTable_get(), str, length);
+}
+
+// Interned token creation
+Token* Token_createInterned(StringInterner* interner, TokenType type, const char* value, size_t length) {
+    Token* token = Token_create(type, NULL);
+    if (!token) return NULL;
+
+    if (value) {
+        token->lexeme = StringInterner_intern(interner, value, length);
+        if (!token->lexeme) {
+            Token_destroy(token);
+            return NULL;
+        }
+        token->value = (char*)StringInterner_get(interner, token->lexeme, &token->length);
+    }
+    return token;
+}
+
+bool Token_lexemeEquals(const Token* a, const Token* b) {
+    if (!a || !b) return false;
+    if (a->lexeme && b->lexeme) return a->lexeme == b->lexeme;
+    if (a->length != b->length) return false;
+    if (!a->value || !b->value) return a->value == b->value;
+    return memcmp(a->value, b->value, a->length) == 0;
+}
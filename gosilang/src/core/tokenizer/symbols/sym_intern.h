@@ -0,0 +1,162 @@
+#ifndef SYM_INTERN_H
+#define SYM_INTERN_H
+
+#include "sym_type.h"
+#include "sym_value.h"
+#include "sym_arena.h"
+#include <stdint.h>
+
+typedef uint32_t LexemeId;
+
+// Operator and punctuation lexemes with their spellings, in id order
+#define RESERVED_SYMBOL_LIST(X) \
+    /* Operators */ \
+    X(LEXEME_PLUS, "+") \
+    X(LEXEME_MINUS, "-") \
+    X(LEXEME_STAR, "*") \
+    X(LEXEME_SLASH, "/") \
+    X(LEXEME_PERCENT, "%") \
+    X(LEXEME_ASSIGN, "=") \
+    X(LEXEME_PLUS_ASSIGN, "+=") \
+    X(LEXEME_MINUS_ASSIGN, "-=") \
+    X(LEXEME_STAR_ASSIGN, "*=") \
+    X(LEXEME_SLASH_ASSIGN, "/=") \
+    X(LEXEME_PERCENT_ASSIGN, "%=") \
+    X(LEXEME_AMP_ASSIGN, "&=") \
+    X(LEXEME_PIPE_ASSIGN, "|=") \
+    X(LEXEME_CARET_ASSIGN, "^=") \
+    X(LEXEME_SHL_ASSIGN, "<<=") \
+    X(LEXEME_SHR_ASSIGN, ">>=") \
+    X(LEXEME_AMP, "&") \
+    X(LEXEME_PIPE, "|") \
+    X(LEXEME_CARET, "^") \
+    X(LEXEME_TILDE, "~") \
+    X(LEXEME_SHL, "<<") \
+    X(LEXEME_SHR, ">>") \
+    X(LEXEME_AMP_AMP, "&&") \
+    X(LEXEME_PIPE_PIPE, "||") \
+    X(LEXEME_BANG, "!") \
+    X(LEXEME_EQUAL, "==") \
+    X(LEXEME_NOT_EQUAL, "!=") \
+    X(LEXEME_LESS, "<") \
+    X(LEXEME_GREATER, ">") \
+    X(LEXEME_LESS_EQUAL, "<=") \
+    X(LEXEME_GREATER_EQUAL, ">=") \
+    X(LEXEME_INCREMENT, "++") \
+    X(LEXEME_DECREMENT, "--") \
+    X(LEXEME_DOT, ".") \
+    X(LEXEME_ARROW, "->") \
+    X(LEXEME_QUESTION, "?") \
+    X(LEXEME_COLON, ":") \
+    X(LEXEME_COMMA, ",") \
+    /* Punctuation */ \
+    X(LEXEME_PAREN_OPEN, "(") \
+    X(LEXEME_PAREN_CLOSE, ")") \
+    X(LEXEME_BRACKET_OPEN, "[") \
+    X(LEXEME_BRACKET_CLOSE, "]") \
+    X(LEXEME_BRACE_OPEN, "{") \
+    X(LEXEME_BRACE_CLOSE, "}") \
+    X(LEXEME_SEMICOLON, ";") \
+    X(LEXEME_ELLIPSIS, "...")
+
+// Words other than keywords that every StringInterner reserves
+#define RESERVED_CONSTANT_LIST(X) \
+    X(LEXEME_TRUE, "true") \
+    X(LEXEME_FALSE, "false") \
+    X(LEXEME_NULL, "null")
+
+// Lexemes pre-interned by every StringInterner, so operator and keyword
+// ids are identical across interners and can be compared as constants.
+// Generated from RESERVED_SYMBOL_LIST, KEYWORD_TYPE_LIST and
+// RESERVED_CONSTANT_LIST, which are also the only copy of their
+// spellings.
+typedef enum {
+    LEXEME_NONE = 0,
+#define X(lexeme, spelling) lexeme,
+    RESERVED_SYMBOL_LIST(X)
+#undef X
+
+    // Keywords, in KeywordType order
+    LEXEME_KEYWORD_FIRST,
+    LEXEME_KEYWORD_LAST = LEXEME_KEYWORD_FIRST + KEYWORD_TYPE_COUNT - 1,
+#define X(lexeme, spelling) lexeme,
+    RESERVED_CONSTANT_LIST(X)
+#undef X
+
+    LEXEME_RESERVED_COUNT
+} ReservedLexeme;
+
+// Per-compilation string interner. Lexeme text is stored once, NUL
+// terminated and never moves, so ids and pointers stay valid until
+// the interner is destroyed.
+typedef struct StringInterner {
+    TokenArena* storage;    // Backing store for lexeme text
+    const char** strings;   // Indexed by LexemeId
+    uint32_t* lengths;
+    uint32_t* hashes;
+    uint32_t count;         // Includes the LEXEME_NONE slot
+    uint32_t capacity;
+    uint32_t* slots;        // Open addressing table of ids, 0 = empty
+    uint32_t slot_mask;
+} StringInterner;
+
+// Hash shared by the interner and the symbol table
+uint32_t Lexeme_hash(const char* str, size_t length);
+
+// Interner lifetime and lookup
+StringInterner* StringInterner_create(void);
+void StringInterner_destroy(StringInterner* interner);
+LexemeId StringInterner_intern(StringInterner* interner, const char* str, size_t length);
+LexemeId StringInterner_find(const StringInterner* interner, const char* str, size_t length);
+const char* StringInterner_get(const StringInterner* interner, LexemeId id, uint32_t* length);
+
+// Open addressing table of the reserved spellings, keyed by length and
+// first and last byte, so a lookup is a hash and usually one compare.
+// Built once, on first use.
+#define RESERVED_TABLE_SIZE 256
+#define RESERVED_MAX_LENGTH 14  // _Static_assert
+
+typedef struct ReservedTable {
+    uint8_t slots[RESERVED_TABLE_SIZE];     // LexemeId, LEXEME_NONE = empty
+    uint8_t lengths[LEXEME_RESERVED_COUNT];
+    const char* spellings[LEXEME_RESERVED_COUNT];
+} ReservedTable;
+
+const ReservedTable* ReservedTable_get(void);
+
+static inline uint32_t ReservedTable_slot(const char* str, size_t length) {
+    uint32_t key = (unsigned char)str[0] * 7u + (unsigned char)str[length - 1] * 3u + (uint32_t)length;
+    return key & (RESERVED_TABLE_SIZE - 1);
+}
+
+static inline LexemeId ReservedTable_find(const ReservedTable* table, const char* str, size_t length) {
+    if (length == 0 || length > RESERVED_MAX_LENGTH) return LEXEME_NONE;
+
+    for (uint32_t slot = ReservedTable_slot(str, length);; slot = (slot + 1) & (RESERVED_TABLE_SIZE - 1)) {
+        LexemeId id = table->slots[slot];
+        if (id == LEXEME_NONE) return LEXEME_NONE;
+        if (table->lengths[id] == length && memcmp(table->spellings[id], str, length) == 0) return id;
+    }
+}
+
+// Reserved lexeme classification
+const char* Lexeme_getReserved(LexemeId id, uint32_t* length);
+LexemeId Lexeme_fromOperator(OperatorType op);
+bool Lexeme_toKeyword(LexemeId id, KeywordType* kw);
+LexemeId Lexeme_findReserved(const char* str, size_t length);
+
+// Operator reading of each reserved lexeme, stored as op + 1
+extern const uint8_t lexeme_operators[LEXEME_RESERVED_COUNT];
+
+static inline bool Lexeme_toOperator(LexemeId id, OperatorType* op) {
+    if (id >= LEXEME_RESERVED_COUNT || !lexeme_operators[id]) return false;
+
+    if (op) *op = (OperatorType)(lexeme_operators[id] - 1);
+    return true;
+}
+
+// Interned token creation; the token borrows its value from the interner
+Token* Token_createInterned(StringInterner* interner, TokenType type, const char* value, size_t length);
+bool Token_lexemeEquals(const Token* a, const Token* b);
+
+#endif // SYM_INTERN_H
@@ -0,0 +1,292 @@
+#include "sym_shared.h"
+#include <stdlib.h>
+#include <string.h>
+
+static inline uint32_t InternerShardOf(uint32_t hash) {
+    return hash >> (32 - SHARED_INTERNER_SHARD_BITS);
+}
+
+static inline uint32_t ScopeShardOf(uint32_t hash) {
+    return hash >> (32 - SHARED_SCOPE_SHARD_BITS);
+}
+
+static inline SharedLexeme* Entry(const SharedInterner* interner, LexemeId id) {
+    SharedLexeme* segment = atomic_load_explicit(&interner->segments[id >> SHARED_INTERNER_SEGMENT_BITS],
+                                                 memory_order_acquire);
+    return segment ? &segment[id & (SHARED_INTERNER_SEGMENT_SIZE - 1)] : NULL;
+}
+
+// Entry for a new id, allocating its segment if no other thread has
+static SharedLexeme* ReserveEntry(SharedInterner* interner, LexemeId id) {
+    if (id >= SHARED_INTERNER_MAX_SEGMENTS * SHARED_INTERNER_SEGMENT_SIZE) return NULL;
+
+    _Atomic(SharedLexeme*)* cell = &interner->segments[id >> SHARED_INTERNER_SEGMENT_BITS];
+    SharedLexeme* segment = atomic_load_explicit(cell, memory_order_acquire);
+    if (!segment) {
+        SharedLexeme* fresh = (SharedLexeme*)calloc(SHARED_INTERNER_SEGMENT_SIZE, sizeof(SharedLexeme));
+        if (!fresh) return NULL;
+        if (atomic_compare_exchange_strong_explicit(cell, &segment, fresh, memory_order_acq_rel,
+                                                    memory_order_acquire)) {
+            segment = fresh;
+        } else {
+            free(fresh);
+        }
+    }
+    return &segment[id & (SHARED_INTERNER_SEGMENT_SIZE - 1)];
+}
+
+// Returns the slot holding the lexeme, or the empty slot where it belongs
+static uint32_t FindShardSlot(const SharedInterner* interner, const SharedInternerShard* shard,
+                              const char* str, size_t length, uint32_t hash) {
+    uint32_t slot = hash & shard->slot_mask;
+    for (;;) {
+        uint32_t id = shard->slots[slot];
+        if (!id) return slot;
+
+        const SharedLexeme* entry = Entry(interner, id);
+        if (entry->hash == hash && entry->length == length && memcmp(entry->string, str, length) == 0) {
+            return slot;
+        }
+        slot = (slot + 1) & shard->slot_mask;
+    }
+}
+
+static bool GrowShardSlots(const SharedInterner* interner, SharedInternerShard* shard) {
+    uint32_t slot_count = (shard->slot_mask + 1) * 2;
+    uint32_t* slots = (uint32_t*)calloc(slot_count, sizeof(uint32_t));
+    if (!slots) return false;
+
+    uint32_t mask = slot_count - 1;
+    for (uint32_t i = 0; i <= shard->slot_mask; i++) {
+        uint32_t id = shard->slots[i];
+        if (!id) continue;
+
+        uint32_t slot = Entry(interner, id)->hash & mask;
+        while (slots[slot]) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id;
+    }
+
+    free(shard->slots);
+    shard->slots = slots;
+    shard->slot_mask = mask;
+    return true;
+}
+
+// Called with the shard's lock held
+static LexemeId InternLocked(SharedInterner* interner, SharedInternerShard* shard, const char* str,
+                             size_t length, uint32_t hash) {
+    uint32_t slot = FindShardSlot(interner, shard, str, length, hash);
+    if (shard->slots[slot]) {
+        return shard->slots[slot];
+    }
+
+    char* copy = TokenArena_strndup(shard->storage, str, length);
+    if (!copy) return LEXEME_NONE;
+
+    LexemeId id = atomic_fetch_add_explicit(&interner->count, 1, memory_order_relaxed);
+    SharedLexeme* entry = ReserveEntry(interner, id);
+    if (!entry) return LEXEME_NONE;
+
+    entry->string = copy;
+    entry->length = (uint32_t)length;
+    entry->hash = hash;
+    shard->slots[slot] = id;
+    shard->count++;
+
+    // Keep the load factor at or below one half
+    if (shard->count * 2 > shard->slot_mask + 1) {
+        GrowShardSlots(interner, shard);
+    }
+    return id;
+}
+
+SharedInterner* SharedInterner_create(void) {
+    SharedInterner* interner = (SharedInterner*)calloc(1, sizeof(SharedInterner));
+    if (!interner) return NULL;
+
+    for (uint32_t s = 0; s < SHARED_INTERNER_SHARDS; s++) {
+        SharedInternerShard* shard = &interner->shards[s];
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->storage = TokenArena_create(SHARED_INTERNER_STORAGE_BLOCK);
+        shard->slot_mask = SHARED_INTERNER_INITIAL_SLOTS - 1;
+        shard->slots = (uint32_t*)calloc(SHARED_INTERNER_INITIAL_SLOTS, sizeof(uint32_t));
+        if (!shard->storage || !shard->slots) {
+            SharedInterner_destroy(interner);
+            return NULL;
+        }
+    }
+
+    // Id 0 is LEXEME_NONE
+    SharedLexeme* none = ReserveEntry(interner, LEXEME_NONE);
+    if (!none) {
+        SharedInterner_destroy(interner);
+        return NULL;
+    }
+    none->string = "";
+    atomic_init(&interner->count, 1);
+
+    // Seed reserved lexemes in ReservedLexeme order
+    for (LexemeId id = 1; id < LEXEME_RESERVED_COUNT; id++) {
+        uint32_t length;
+        const char* spelling = Lexeme_getReserved(id, &length);
+        if (SharedInterner_intern(interner, spelling, length) != id) {
+            SharedInterner_destroy(interner);
+            return NULL;
+        }
+    }
+    return interner;
+}
+
+void SharedInterner_destroy(SharedInterner* interner) {
+    if (!interner) return;
+
+    for (uint32_t s = 0; s < SHARED_INTERNER_SHARDS; s++) {
+        SharedInternerShard* shard = &interner->shards[s];
+        pthread_mutex_destroy(&shard->lock);
+        TokenArena_destroy(shard->storage);
+        free(shard->slots);
+    }
+    for (uint32_t i = 0; i < SHARED_INTERNER_MAX_SEGMENTS; i++) {
+        free(atomic_load_explicit(&interner->segments[i], memory_order_relaxed));
+    }
+    free(interner);
+}
+
+LexemeId SharedInterner_intern(SharedInterner* interner, const char* str, size_t length) {
+    if (!interner || !str || length > UINT32_MAX) return LEXEME_NONE;
+
+    uint32_t hash = Lexeme_hash(str, length);
+    SharedInternerShard* shard = &interner->shards[InternerShardOf(hash)];
+    pthread_mutex_lock(&shard->lock);
+    LexemeId id = InternLocked(interner, shard, str, length, hash);
+    pthread_mutex_unlock(&shard->lock);
+    return id;
+}
+
+LexemeId SharedInterner_find(SharedInterner* interner, const char* str, size_t length) {
+    if (!interner || !str) return LEXEME_NONE;
+
+    uint32_t hash = Lexeme_hash(str, length);
+    SharedInternerShard* shard = &interner->shards[InternerShardOf(hash)];
+    pthread_mutex_lock(&shard->lock);
+    LexemeId id = shard->slots[FindShardSlot(interner, shard, str, length, hash)];
+    pthread_mutex_unlock(&shard->lock);
+    return id;
+}
+
+bool SharedInterner_publish(SharedInterner* interner, const StringInterner* local, LexemeId* map) {
+    if (!interner || !local || !map) return false;
+
+    // Reserved lexemes have the same ids everywhere
+    uint32_t count = local->count;
+    uint32_t reserved = count < LEXEME_RESERVED_COUNT ? count : LEXEME_RESERVED_COUNT;
+    for (LexemeId id = 0; id < reserved; id++) {
+        map[id] = id;
+    }
+    if (count == reserved) return true;
+
+    // Bucket the rest by shard, so each shard is locked once
+    uint32_t* order = (uint32_t*)malloc((count - reserved) * sizeof(uint32_t));
+    if (!order) return false;
+
+    uint32_t starts[SHARED_INTERNER_SHARDS + 1] = {0};
+    for (LexemeId id = reserved; id < count; id++) {
+        starts[InternerShardOf(local->hashes[id]) + 1]++;
+    }
+    for (uint32_t s = 0; s < SHARED_INTERNER_SHARDS; s++) {
+        starts[s + 1] += starts[s];
+    }
+    uint32_t fill[SHARED_INTERNER_SHARDS];
+    memcpy(fill, starts, sizeof(fill));
+    for (LexemeId id = reserved; id < count; id++) {
+        order[fill[InternerShardOf(local->hashes[id])]++] = id;
+    }
+
+    bool ok = true;
+    for (uint32_t s = 0; s < SHARED_INTERNER_SHARDS; s++) {
+        if (starts[s] == starts[s + 1]) continue;
+
+        SharedInternerShard* shard = &interner->shards[s];
+        pthread_mutex_lock(&shard->lock);
+        for (uint32_t i = starts[s]; i < starts[s + 1]; i++) {
+            LexemeId id = order[i];
+            map[id] = InternLocked(interner, shard, local->strings[id], local->lengths[id], local->hashes[id]);
+            ok = ok && map[id] != LEXEME_NONE;
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    free(order);
+    return ok;
+}
+
+const char* SharedInterner_get(const SharedInterner* interner, LexemeId id, uint32_t* length) {
+    if (!interner || id == LEXEME_NONE || id >= SharedInterner_count(interner)) return NULL;
+
+    const SharedLexeme* entry = Entry(interner, id);
+    if (!entry || !entry->string) return NULL;
+
+    if (length) *length = entry->length;
+    return entry->string;
+}
+
+// Shared scope
+
+SharedScope* SharedScope_create(void) {
+    SharedScope* scope = (SharedScope*)calloc(1, sizeof(SharedScope));
+    if (!scope) return NULL;
+
+    for (uint32_t s = 0; s < SHARED_SCOPE_SHARDS; s++) {
+        pthread_rwlock_init(&scope->shards[s].lock, NULL);
+        scope->shards[s].scope = CreateScope(NULL);
+        if (!scope->shards[s].scope) {
+            SharedScope_destroy(scope);
+            return NULL;
+        }
+    }
+    return scope;
+}
+
+void SharedScope_destroy(SharedScope* scope) {
+    if (!scope) return;
+
+    for (uint32_t s = 0; s < SHARED_SCOPE_SHARDS; s++) {
+        pthread_rwlock_destroy(&scope->shards[s].lock);
+        DestroyScope(scope->shards[s].scope);
+    }
+    free(scope);
+}
+
+bool SharedScope_add(SharedScope* scope, SymbolTableEntry* symbol) {
+    if (!scope || !symbol) return false;
+
+    SharedScopeShard* shard = &scope->shards[ScopeShardOf(symbol->name_hash)];
+    pthread_rwlock_wrlock(&shard->lock);
+    bool added = AddSymbol(shard->scope, symbol);
+    pthread_rwlock_unlock(&shard->lock);
+    return added;
+}
+
+SymbolTableEntry* SharedScope_find(SharedScope* scope, const char* name, size_t length, uint32_t hash) {
+    if (!scope || !name) return NULL;
+
+    SharedScopeShard* shard = &scope->shards[ScopeShardOf(hash)];
+    pthread_rwlock_rdlock(&shard->lock);
+    SymbolTableEntry* entry = FindSymbolHashed(shard->scope, name, length, hash);
+    pthread_rwlock_unlock(&shard->lock);
+    return entry;
+}
+
+uint32_t SharedScope_count(SharedScope* scope) {
+    if (!scope) return 0;
+
+    uint32_t count = 0;
+    for (uint32_t s = 0; s < SHARED_SCOPE_SHARDS; s++) {
+        pthread_rwlock_rdlock(&scope->shards[s].lock);
+        count += scope->shards[s].scope->symbol_count;
+        pthread_rwlock_unlock(&scope->shards[s].lock);
+    }
+    return count;
+}
@@ -0,0 +1,93 @@
+#ifndef SYM_SHARED_H
+#define SYM_SHARED_H
+
+#include "sym_intern.h"
+#include "sym_value.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Shards are picked by the top bits of Lexeme_hash, slots by the low bits
+#define SHARED_INTERNER_SHARD_BITS 4
+#define SHARED_INTERNER_SHARDS (1u << SHARED_INTERNER_SHARD_BITS)
+#define SHARED_INTERNER_INITIAL_SLOTS 1024
+#define SHARED_INTERNER_STORAGE_BLOCK (64 * 1024)
+// Entries live in fixed segments so a lookup by id never takes a lock
+#define SHARED_INTERNER_SEGMENT_BITS 12
+#define SHARED_INTERNER_SEGMENT_SIZE (1u << SHARED_INTERNER_SEGMENT_BITS)
+#define SHARED_INTERNER_MAX_SEGMENTS 4096
+
+#define SHARED_SCOPE_SHARD_BITS 4
+#define SHARED_SCOPE_SHARDS (1u << SHARED_SCOPE_SHARD_BITS)
+
+typedef struct SharedLexeme {
+    const char* string;     // NUL terminated, never moves
+    uint32_t length;
+    uint32_t hash;
+} SharedLexeme;
+
+typedef struct SharedInternerShard {
+    pthread_mutex_t lock;
+    TokenArena* storage;    // Text of the shard's lexemes
+    uint32_t* slots;        // Open addressing table of ids, 0 = empty
+    uint32_t slot_mask;
+    uint32_t count;
+} SharedInternerShard;
+
+// String interner shared by every compilation of a build. Interning
+// locks one of SHARED_INTERNER_SHARDS shards; ids are drawn from one
+// counter and reading an id's text takes no lock. Reserved lexemes get
+// the same ids as in a StringInterner.
+//
+// Threads that lex on their own should intern into a private
+// StringInterner and publish it once, which takes each shard's lock
+// once per file rather than once per lexeme.
+typedef struct SharedInterner {
+    SharedInternerShard shards[SHARED_INTERNER_SHARDS];
+    _Atomic(SharedLexeme*) segments[SHARED_INTERNER_MAX_SEGMENTS];
+    atomic_uint count;      // Ids handed out, including LEXEME_NONE
+} SharedInterner;
+
+// Interner lifetime
+SharedInterner* SharedInterner_create(void);
+void SharedInterner_destroy(SharedInterner* interner);
+
+// Interning; returns LEXEME_NONE on failure
+LexemeId SharedInterner_intern(SharedInterner* interner, const char* str, size_t length);
+LexemeId SharedInterner_find(SharedInterner* interner, const char* str, size_t length);
+
+// Interns every lexeme of local and stores its shared id in
+// map[local id], so map must hold local->count ids
+bool SharedInterner_publish(SharedInterner* interner, const StringInterner* local, LexemeId* map);
+
+// Text of an id this thread was handed, by interning or from another
+// thread through a lock or an acquire
+const char* SharedInterner_get(const SharedInterner* interner, LexemeId id, uint32_t* length);
+
+static inline uint32_t SharedInterner_count(const SharedInterner* interner) {
+    return atomic_load_explicit(&interner->count, memory_order_relaxed);
+}
+
+typedef struct SharedScopeShard {
+    pthread_rwlock_t lock;
+    ScopeLevel* scope;
+} SharedScopeShard;
+
+// Global scope several compilations declare into at once. Names are
+// spread over SHARED_SCOPE_SHARDS scopes by hash, each behind a
+// readers-writer lock. Entries are never removed, so a found entry
+// stays valid until the scope is destroyed; it must not be modified.
+typedef struct SharedScope {
+    SharedScopeShard shards[SHARED_SCOPE_SHARDS];
+} SharedScope;
+
+// Scope lifetime
+SharedScope* SharedScope_create(void);
+void SharedScope_destroy(SharedScope* scope);
+
+// Takes ownership of symbol on success; false on redeclaration, as
+// AddSymbol, in which case the caller still owns it
+bool SharedScope_add(SharedScope* scope, SymbolTableEntry* symbol);
+SymbolTableEntry* SharedScope_find(SharedScope* scope, const char* name, size_t length, uint32_t hash);
+uint32_t SharedScope_count(SharedScope* scope);
+
+#endif // SYM_SHARED_H
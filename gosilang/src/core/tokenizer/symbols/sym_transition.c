@@ -0,0 +1,254 @@
+#include "sym_transition.h"
+#include <pthread.h>
+
+// Token types grouped by how they combine with their neighbours. Types
+// the lexer never produces are ROLE_ANY, which accepts everything.
+typedef enum {
+    ROLE_ANY,
+    ROLE_IDENTIFIER,
+    ROLE_CONSTANT,          // Numbers, characters, true/false, null
+    ROLE_STRING,
+    ROLE_OPERATOR,          // Binary, or prefix for + - * &
+    ROLE_ASSIGN,
+    ROLE_UNARY,             // ! ~ and ++ -- on either side
+    ROLE_QUESTION,
+    ROLE_SIZEOF,
+    ROLE_CONTROL,           // if, while, for, switch
+    ROLE_DO_ELSE,
+    ROLE_RETURN,
+    ROLE_JUMP,              // break, continue
+    ROLE_GOTO,
+    ROLE_CASE,
+    ROLE_DEFAULT,
+    ROLE_SPECIFIER,         // Storage classes and qualifiers
+    ROLE_TYPE,
+    ROLE_TAG,               // struct, union, enum
+    ROLE_OPEN_PAREN,
+    ROLE_CLOSE_PAREN,
+    ROLE_OPEN_BRACKET,
+    ROLE_CLOSE_BRACKET,
+    ROLE_OPEN_BRACE,
+    ROLE_CLOSE_BRACE,
+    ROLE_SEMICOLON,
+    ROLE_COMMA,
+    ROLE_MEMBER,            // . and ->
+    ROLE_COLON,
+    ROLE_ELLIPSIS,
+    ROLE_TRANSPARENT,       // Comments and preprocessor lines
+    ROLE_ERROR,
+    ROLE_END,
+    ROLE_COUNT
+} TokenRole;
+
+#define R(role) (1ull << (role))
+
+static TokenRole RoleOf(TokenType type) {
+    switch (type) {
+        case TOKEN_LITERAL_IDENTIFIER: return ROLE_IDENTIFIER;
+        case TOKEN_LITERAL_VALUE:
+        case TOKEN_LITERAL_CHAR:
+        case TOKEN_LITERAL_INTEGER:
+        case TOKEN_LITERAL_FLOAT:
+        case TOKEN_LITERAL_BOOL:
+        case TOKEN_LITERAL_NULL: return ROLE_CONSTANT;
+        case TOKEN_LITERAL_STRING: return ROLE_STRING;
+        case TOKEN_LITERAL_KEYWORD: return ROLE_SPECIFIER;
+        case TOKEN_EXPR_BINARY: return ROLE_OPERATOR;
+        case TOKEN_EXPR_ASSIGNMENT: return ROLE_ASSIGN;
+        case TOKEN_EXPR_UNARY: return ROLE_UNARY;
+        case TOKEN_EXPR_CONDITIONAL: return ROLE_QUESTION;
+        case TOKEN_EXPR_SIZEOF: return ROLE_SIZEOF;
+        case TOKEN_STMT_IF:
+        case TOKEN_STMT_WHILE:
+        case TOKEN_STMT_FOR:
+        case TOKEN_STMT_SWITCH: return ROLE_CONTROL;
+        case TOKEN_STMT_DO:
+        case TOKEN_STMT_ELSE: return ROLE_DO_ELSE;
+        case TOKEN_STMT_RETURN: return ROLE_RETURN;
+        case TOKEN_STMT_BREAK:
+        case TOKEN_STMT_CONTINUE: return ROLE_JUMP;
+        case TOKEN_STMT_GOTO: return ROLE_GOTO;
+        case TOKEN_STMT_CASE: return ROLE_CASE;
+        case TOKEN_STMT_DEFAULT: return ROLE_DEFAULT;
+        case TOKEN_TYPE_STRUCT:
+        case TOKEN_TYPE_UNION:
+        case TOKEN_TYPE_ENUM: return ROLE_TAG;
+        case TOKEN_PAREN_OPEN: return ROLE_OPEN_PAREN;
+        case TOKEN_PAREN_CLOSE: return ROLE_CLOSE_PAREN;
+        case TOKEN_BRACKET_OPEN: return ROLE_OPEN_BRACKET;
+        case TOKEN_BRACKET_CLOSE: return ROLE_CLOSE_BRACKET;
+        case TOKEN_SCOPE_BEGIN:
+        case TOKEN_BLOCK_BEGIN: return ROLE_OPEN_BRACE;
+        case TOKEN_SCOPE_END:
+        case TOKEN_BLOCK_END: return ROLE_CLOSE_BRACE;
+        case TOKEN_PUNCT_SEMICOLON: return ROLE_SEMICOLON;
+        case TOKEN_PUNCT_COMMA: return ROLE_COMMA;
+        case TOKEN_PUNCT_DOT:
+        case TOKEN_PUNCT_ARROW: return ROLE_MEMBER;
+        case TOKEN_PUNCT_COLON: return ROLE_COLON;
+        case TOKEN_PUNCT_ELLIPSIS: return ROLE_ELLIPSIS;
+        case TOKEN_COMMENT_SINGLE:
+        case TOKEN_COMMENT_MULTI:
+        case TOKEN_PREPROCESSOR: return ROLE_TRANSPARENT;
+        case TOKEN_ERROR: return ROLE_ERROR;
+        case TOKEN_EOF: return ROLE_END;
+        default:
+            if (TokenType_isDeclaration(type)) return ROLE_SPECIFIER;
+            if (TokenType_isType(type)) return ROLE_TYPE;
+            return ROLE_ANY;
+    }
+}
+
+// Roles that may begin an operand, including prefix operators
+#define OPERAND_START (R(ROLE_IDENTIFIER) | R(ROLE_CONSTANT) | R(ROLE_STRING) | R(ROLE_OPERATOR) | \
+                       R(ROLE_UNARY) | R(ROLE_SIZEOF) | R(ROLE_OPEN_PAREN))
+
+// Roles that may follow a complete operand
+#define AFTER_OPERAND (R(ROLE_OPERATOR) | R(ROLE_ASSIGN) | R(ROLE_UNARY) | R(ROLE_QUESTION) | \
+                       R(ROLE_OPEN_PAREN) | R(ROLE_OPEN_BRACKET) | R(ROLE_CLOSE_PAREN) | \
+                       R(ROLE_CLOSE_BRACKET) | R(ROLE_CLOSE_BRACE) | R(ROLE_SEMICOLON) | \
+                       R(ROLE_COMMA) | R(ROLE_MEMBER) | R(ROLE_COLON))
+
+// Roles that may begin a statement or declaration, or end a block
+#define STATEMENT_START (OPERAND_START | R(ROLE_CONTROL) | R(ROLE_DO_ELSE) | R(ROLE_RETURN) | \
+                         R(ROLE_JUMP) | R(ROLE_GOTO) | R(ROLE_CASE) | R(ROLE_DEFAULT) | \
+                         R(ROLE_SPECIFIER) | R(ROLE_TYPE) | R(ROLE_TAG) | R(ROLE_OPEN_BRACE) | \
+                         R(ROLE_CLOSE_BRACE) | R(ROLE_SEMICOLON))
+
+#define EVERY_ROLE (R(ROLE_COUNT) - 1)
+
+// Roles that may follow each role. ROLE_ANY and ROLE_TRANSPARENT are
+// added to every row and ROLE_ERROR removed when the matrix is built.
+static const uint64_t role_follows[ROLE_COUNT] = {
+    [ROLE_ANY] = EVERY_ROLE,
+    // Also T x for typedef names, attribute macros before types, T const
+    // and trailing macro calls
+    [ROLE_IDENTIFIER] = AFTER_OPERAND | R(ROLE_IDENTIFIER) | R(ROLE_STRING) | R(ROLE_SPECIFIER) |
+                        R(ROLE_TYPE) | R(ROLE_TAG) | R(ROLE_OPEN_BRACE) | R(ROLE_END),
+    [ROLE_CONSTANT] = AFTER_OPERAND & ~(R(ROLE_OPEN_PAREN) | R(ROLE_MEMBER)),
+    // "a" "b", "%" PRIu64 and extern "C" linkage blocks
+    [ROLE_STRING] = (AFTER_OPERAND & ~(R(ROLE_OPEN_PAREN) | R(ROLE_MEMBER))) | R(ROLE_STRING) |
+                    R(ROLE_IDENTIFIER) | R(ROLE_TYPE) | R(ROLE_TAG) | R(ROLE_SPECIFIER) |
+                    R(ROLE_OPEN_BRACE),
+    // int *p, (char *), f(void *, int), int *const, int *[], a[*]
+    [ROLE_OPERATOR] = OPERAND_START | R(ROLE_CLOSE_PAREN) | R(ROLE_COMMA) | R(ROLE_SPECIFIER) |
+                      R(ROLE_OPEN_BRACKET) | R(ROLE_CLOSE_BRACKET),
+    [ROLE_ASSIGN] = OPERAND_START | R(ROLE_OPEN_BRACE),
+    [ROLE_UNARY] = OPERAND_START | AFTER_OPERAND,
+    [ROLE_QUESTION] = OPERAND_START | R(ROLE_COLON),
+    [ROLE_SIZEOF] = OPERAND_START,
+    [ROLE_CONTROL] = R(ROLE_OPEN_PAREN),
+    [ROLE_DO_ELSE] = STATEMENT_START & ~R(ROLE_CLOSE_BRACE),
+    [ROLE_RETURN] = OPERAND_START | R(ROLE_SEMICOLON),
+    [ROLE_JUMP] = R(ROLE_SEMICOLON),
+    [ROLE_GOTO] = R(ROLE_IDENTIFIER) | R(ROLE_OPERATOR),
+    [ROLE_CASE] = OPERAND_START,
+    [ROLE_DEFAULT] = R(ROLE_COLON),
+    [ROLE_SPECIFIER] = R(ROLE_IDENTIFIER) | R(ROLE_TYPE) | R(ROLE_TAG) | R(ROLE_SPECIFIER) |
+                       R(ROLE_OPERATOR) | R(ROLE_OPEN_PAREN) | R(ROLE_CLOSE_PAREN) |
+                       R(ROLE_OPEN_BRACKET) | R(ROLE_CLOSE_BRACKET) | R(ROLE_COMMA) |
+                       R(ROLE_SEMICOLON) | R(ROLE_STRING),
+    [ROLE_TYPE] = R(ROLE_IDENTIFIER) | R(ROLE_TYPE) | R(ROLE_SPECIFIER) | R(ROLE_OPERATOR) |
+                  R(ROLE_OPEN_PAREN) | R(ROLE_CLOSE_PAREN) | R(ROLE_OPEN_BRACKET) |
+                  R(ROLE_COMMA) | R(ROLE_SEMICOLON) | R(ROLE_COLON),
+    [ROLE_TAG] = R(ROLE_IDENTIFIER) | R(ROLE_OPEN_BRACE),
+    [ROLE_OPEN_PAREN] = OPERAND_START | R(ROLE_CLOSE_PAREN) | R(ROLE_TYPE) | R(ROLE_TAG) |
+                        R(ROLE_SPECIFIER) | R(ROLE_SEMICOLON) | R(ROLE_OPEN_BRACE) | R(ROLE_ELLIPSIS),
+    [ROLE_CLOSE_PAREN] = EVERY_ROLE & ~R(ROLE_ELLIPSIS),
+    [ROLE_OPEN_BRACKET] = OPERAND_START | R(ROLE_CLOSE_BRACKET) | R(ROLE_SPECIFIER),
+    [ROLE_CLOSE_BRACKET] = AFTER_OPERAND | R(ROLE_END),
+    // Blocks and initializers, with designators
+    [ROLE_OPEN_BRACE] = STATEMENT_START | R(ROLE_MEMBER) | R(ROLE_OPEN_BRACKET),
+    [ROLE_CLOSE_BRACE] = EVERY_ROLE & ~R(ROLE_ELLIPSIS),
+    [ROLE_SEMICOLON] = STATEMENT_START | R(ROLE_CLOSE_PAREN) | R(ROLE_END),
+    [ROLE_COMMA] = OPERAND_START | R(ROLE_TYPE) | R(ROLE_TAG) | R(ROLE_SPECIFIER) |
+                   R(ROLE_OPEN_BRACE) | R(ROLE_CLOSE_BRACE) | R(ROLE_MEMBER) |
+                   R(ROLE_OPEN_BRACKET) | R(ROLE_ELLIPSIS),
+    [ROLE_MEMBER] = R(ROLE_IDENTIFIER),
+    [ROLE_COLON] = STATEMENT_START,
+    // f(int, ...) and GNU case ranges
+    [ROLE_ELLIPSIS] = R(ROLE_CLOSE_PAREN) | R(ROLE_CONSTANT) | R(ROLE_IDENTIFIER),
+    [ROLE_TRANSPARENT] = EVERY_ROLE,
+    // An error is reported where it appears, not again after it
+    [ROLE_ERROR] = EVERY_ROLE,
+    [ROLE_END] = EVERY_ROLE,
+};
+
+static TokenTransitions token_transitions;
+static pthread_once_t token_transitions_once = PTHREAD_ONCE_INIT;
+
+static void BuildTransitions(void) {
+    TokenRole roles[TOKEN_TYPE_COUNT];
+    for (int type = 0; type < TOKEN_TYPE_COUNT; type++) {
+        roles[type] = RoleOf((TokenType)type);
+        if (roles[type] == ROLE_TRANSPARENT) {
+            token_transitions.transparent[type >> 6] |= 1ull << (type & 63);
+        }
+    }
+
+    for (int from = 0; from < TOKEN_TYPE_COUNT; from++) {
+        uint64_t follows = role_follows[roles[from]] | R(ROLE_ANY) | R(ROLE_TRANSPARENT);
+        follows &= ~R(ROLE_ERROR);
+        for (int to = 0; to < TOKEN_TYPE_COUNT; to++) {
+            if (follows & R(roles[to])) {
+                token_transitions.rows[from][to >> 6] |= 1ull << (to & 63);
+            }
+        }
+    }
+}
+
+const TokenTransitions* TokenTransitions_get(void) {
+    pthread_once(&token_transitions_once, BuildTransitions);
+    return &token_transitions;
+}
+
+bool TokenType_isValidTransition(TokenType from, TokenType to) {
+    if ((unsigned)from >= TOKEN_TYPE_COUNT || (unsigned)to >= TOKEN_TYPE_COUNT) return false;
+    return TokenTransitions_allows(TokenTransitions_get(), from, to);
+}
+
+// One step of the DFA: whether type may follow state, and the next state
+static inline uint64_t Step(const TokenTransitions* transitions, uint32_t* state, uint32_t type) {
+    if (type >= TOKEN_TYPE_COUNT) type = TOKEN_ERROR;
+    uint64_t allowed = transitions->rows[*state][type >> 6] >> (type & 63);
+    uint64_t transparent = transitions->transparent[type >> 6] >> (type & 63);
+    *state = (transparent & 1) ? *state : type;
+    return allowed & 1;
+}
+
+// Blocks are scanned without branching on the result, accumulating
+// rejects into one flag; the state update is a conditional move, so
+// the loop carries a single register and the row loads overlap. Only a
+// block with a reject is scanned again to record where.
+uint32_t TokenBuffer_checkTransitions(const TokenBuffer* tokens, uint32_t begin, uint32_t end,
+                                      uint32_t* positions, uint32_t max_positions) {
+    if (!tokens || !positions || !max_positions) return 0;
+    if (end > tokens->count) end = tokens->count;
+
+    const TokenTransitions* transitions = TokenTransitions_get();
+    const uint8_t* types = tokens->types;
+    uint32_t found = 0;
+    uint32_t state = TOKEN_PUNCT_SEMICOLON;
+
+    for (uint32_t block = begin; block < end; block += TOKEN_TRANSITION_BLOCK) {
+        uint32_t block_end = end - block > TOKEN_TRANSITION_BLOCK ? block + TOKEN_TRANSITION_BLOCK : end;
+        uint32_t block_state = state;
+        uint64_t accepted = 1;
+        for (uint32_t i = block; i < block_end; i++) {
+            accepted &= Step(transitions, &state, types[i]);
+        }
+        if (accepted) continue;
+
+        state = block_state;
+        for (uint32_t i = block; i < block_end; i++) {
+            if (Step(transitions, &state, types[i])) continue;
+            positions[found++] = i;
+            if (found == max_positions) return found;
+        }
+    }
+
+    if (end == tokens->count && !TokenTransitions_allows(transitions, (TokenType)state, TOKEN_EOF)) {
+        positions[found++] = end;
+    }
+    return found;
+}
@@ -0,0 +1,42 @@
+#ifndef SYM_TRANSITION_H
+#define SYM_TRANSITION_H
+
+#include "sym_type.h"
+#include "sym_buffer.h"
+
+#define TOKEN_TRANSITION_WORDS ((TOKEN_TYPE_COUNT + 63) / 64)
+#define TOKEN_TRANSITION_BLOCK 64       // Tokens checked between branches
+
+// Which token types may follow which, one bit per pair: bit 'to' of
+// row 'from'. Read as a DFA, the state is the last significant token
+// type and a missing bit is the reject transition. Comments and
+// preprocessor lines are transparent: they may appear anywhere and do
+// not change the state. The relation is a coarse, lexical view of C; it
+// rejects what can never be well formed (1 2, x ., if x, a + ;) and
+// accepts anything a macro or extension could make valid.
+typedef struct TokenTransitions {
+    uint64_t rows[TOKEN_TYPE_COUNT][TOKEN_TRANSITION_WORDS];
+    uint64_t transparent[TOKEN_TRANSITION_WORDS];
+} TokenTransitions;
+
+// Built once, on first use, from the rules in sym_transition.c
+const TokenTransitions* TokenTransitions_get(void);
+
+static inline bool TokenTransitions_allows(const TokenTransitions* transitions, TokenType from, TokenType to) {
+    return (transitions->rows[from][to >> 6] >> (to & 63)) & 1;
+}
+
+static inline bool TokenTransitions_isTransparent(const TokenTransitions* transitions, TokenType type) {
+    return (transitions->transparent[type >> 6] >> (type & 63)) & 1;
+}
+
+// Checks tokens [begin, end) of the buffer in one pass, as if preceded
+// by a ';' and, when end is the buffer's count, followed by TOKEN_EOF.
+// Writes the index of each token that cannot follow the significant
+// token before it, or count for an input that cannot end where it does,
+// up to max_positions. Returns the number written; the scan stops once
+// max_positions are found, so 1 makes it a pass/fail gate.
+uint32_t TokenBuffer_checkTransitions(const TokenBuffer* tokens, uint32_t begin, uint32_t end,
+                                      uint32_t* positions, uint32_t max_positions);
+
+#endif // SYM_TRANSITION_H
@@ -5,9 +5,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 struct Token;
 struct TokenContext;
+struct TokenBuffer;
+struct SourceFile;
 
 // Token stack definition
 #define MAX_STACK_SIZE 100
@@ -28,103 +31,125 @@ typedef enum {
     TOKEN_CATEGORY_SPECIAL
 } TokenCategory;
 
+// Binding power of operators, as in C; higher binds tighter
+#define PREC_NONE           -1
+#define PREC_COMMA          1
+#define PREC_ASSIGNMENT     2
+#define PREC_CONDITIONAL    3
+#define PREC_LOGICAL_OR     4
+#define PREC_LOGICAL_AND    5
+#define PREC_BITWISE_OR     6
+#define PREC_BITWISE_XOR    7
+#define PREC_BITWISE_AND    8
+#define PREC_EQUALITY       9
+#define PREC_RELATIONAL     10
+#define PREC_SHIFT          11
+#define PREC_ADDITIVE       12
+#define PREC_MULTIPLICATIVE 13
+#define PREC_PREFIX         14
+#define PREC_POSTFIX        15
+
+// Every token type with its name, category, fixed precedence (when the
+// type alone determines it) and the type that closes it. This list is
+// the single source for the enum and all TokenType_* lookup tables.
+#define TOKEN_NO_CLOSING TOKEN_ERROR
+#define TOKEN_TYPE_LIST(X) \
+    /* Literals */ \
+    X(TOKEN_LITERAL_VALUE, "VALUE", LITERAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_LITERAL_KEYWORD, "KEYWORD", LITERAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_LITERAL_DELIMITER, "DELIMITER", LITERAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_LITERAL_OPERATOR, "OPERATOR", LITERAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_LITERAL_IDENTIFIER, "IDENTIFIER", LITERAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_LITERAL_STRING, "STRING", LITERAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_LITERAL_CHAR, "CHAR", LITERAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_LITERAL_INTEGER, "INTEGER", LITERAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_LITERAL_FLOAT, "FLOAT", LITERAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_LITERAL_BOOL, "BOOL", LITERAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_LITERAL_NULL, "NULL", LITERAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_LITERAL_ARRAY, "ARRAY", LITERAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    /* Expressions */ \
+    X(TOKEN_EXPR_BINARY, "BINARY_EXPR", EXPRESSION, PREC_NONE, TOKEN_NO_CLOSING)      /* Precedence depends on the operator */ \
+    X(TOKEN_EXPR_UNARY, "UNARY_EXPR", EXPRESSION, PREC_PREFIX, TOKEN_NO_CLOSING) \
+    X(TOKEN_EXPR_ASSIGNMENT, "ASSIGNMENT_EXPR", EXPRESSION, PREC_ASSIGNMENT, TOKEN_NO_CLOSING) \
+    X(TOKEN_EXPR_FUNCTION_CALL, "FUNCTION_CALL_EXPR", EXPRESSION, PREC_POSTFIX, TOKEN_NO_CLOSING) \
+    X(TOKEN_EXPR_ARRAY_ACCESS, "ARRAY_ACCESS_EXPR", EXPRESSION, PREC_POSTFIX, TOKEN_NO_CLOSING) \
+    X(TOKEN_EXPR_MEMBER_ACCESS, "MEMBER_ACCESS_EXPR", EXPRESSION, PREC_POSTFIX, TOKEN_NO_CLOSING) \
+    X(TOKEN_EXPR_CONDITIONAL, "CONDITIONAL_EXPR", EXPRESSION, PREC_CONDITIONAL, TOKEN_NO_CLOSING) /* Ternary operator */ \
+    X(TOKEN_EXPR_COMMA, "COMMA_EXPR", EXPRESSION, PREC_COMMA, TOKEN_NO_CLOSING) \
+    X(TOKEN_EXPR_CAST, "CAST_EXPR", EXPRESSION, PREC_PREFIX, TOKEN_NO_CLOSING) \
+    X(TOKEN_EXPR_SIZEOF, "SIZEOF_EXPR", EXPRESSION, PREC_PREFIX, TOKEN_NO_CLOSING) \
+    /* Statements */ \
+    X(TOKEN_STMT_IF, "IF_STMT", STATEMENT, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_STMT_ELSE, "ELSE_STMT", STATEMENT, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_STMT_WHILE, "WHILE_STMT", STATEMENT, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_STMT_FOR, "FOR_STMT", STATEMENT, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_STMT_DO, "DO_STMT", STATEMENT, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_STMT_SWITCH, "SWITCH_STMT", STATEMENT, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_STMT_CASE, "CASE_STMT", STATEMENT, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_STMT_DEFAULT, "DEFAULT_STMT", STATEMENT, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_STMT_RETURN, "RETURN_STMT", STATEMENT, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_STMT_BREAK, "BREAK_STMT", STATEMENT, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_STMT_CONTINUE, "CONTINUE_STMT", STATEMENT, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_STMT_GOTO, "GOTO_STMT", STATEMENT, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_STMT_LABEL, "LABEL_STMT", STATEMENT, PREC_NONE, TOKEN_NO_CLOSING) \
+    /* Declarations */ \
+    X(TOKEN_DECL_VARIABLE, "VARIABLE_DECL", DECLARATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_DECL_FUNCTION, "FUNCTION_DECL", DECLARATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_DECL_STRUCT, "STRUCT_DECL", DECLARATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_DECL_UNION, "UNION_DECL", DECLARATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_DECL_ENUM, "ENUM_DECL", DECLARATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_DECL_TYPEDEF, "TYPEDEF_DECL", DECLARATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_DECL_EXTERN, "EXTERN_DECL", DECLARATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_DECL_STATIC, "STATIC_DECL", DECLARATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_DECL_AUTO, "AUTO_DECL", DECLARATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_DECL_REGISTER, "REGISTER_DECL", DECLARATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    /* Scope and blocks */ \
+    X(TOKEN_SCOPE_BEGIN, "SCOPE_BEGIN", SCOPE, PREC_NONE, TOKEN_SCOPE_END) \
+    X(TOKEN_SCOPE_END, "SCOPE_END", SCOPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_BLOCK_BEGIN, "BLOCK_BEGIN", SCOPE, PREC_NONE, TOKEN_BLOCK_END) \
+    X(TOKEN_BLOCK_END, "BLOCK_END", SCOPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_PAREN_OPEN, "PAREN_OPEN", SCOPE, PREC_NONE, TOKEN_PAREN_CLOSE) \
+    X(TOKEN_PAREN_CLOSE, "PAREN_CLOSE", SCOPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_BRACKET_OPEN, "BRACKET_OPEN", SCOPE, PREC_NONE, TOKEN_BRACKET_CLOSE) \
+    X(TOKEN_BRACKET_CLOSE, "BRACKET_CLOSE", SCOPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    /* Punctuation */ \
+    X(TOKEN_PUNCT_SEMICOLON, "SEMICOLON", PUNCTUATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_PUNCT_COMMA, "COMMA", PUNCTUATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_PUNCT_DOT, "DOT", PUNCTUATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_PUNCT_COLON, "COLON", PUNCTUATION, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_PUNCT_ARROW, "ARROW", PUNCTUATION, PREC_NONE, TOKEN_NO_CLOSING)           /* -> */ \
+    X(TOKEN_PUNCT_ELLIPSIS, "ELLIPSIS", PUNCTUATION, PREC_NONE, TOKEN_NO_CLOSING)     /* ... */ \
+    /* Types */ \
+    X(TOKEN_TYPE_VOID, "VOID_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_TYPE_CHAR, "CHAR_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_TYPE_SHORT, "SHORT_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_TYPE_INT, "INT_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_TYPE_LONG, "LONG_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_TYPE_FLOAT, "FLOAT_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_TYPE_DOUBLE, "DOUBLE_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_TYPE_SIGNED, "SIGNED_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_TYPE_UNSIGNED, "UNSIGNED_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_TYPE_BOOL, "BOOL_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_TYPE_COMPLEX, "COMPLEX_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_TYPE_STRUCT, "STRUCT_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_TYPE_UNION, "UNION_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_TYPE_ENUM, "ENUM_TYPE", TYPE, PREC_NONE, TOKEN_NO_CLOSING) \
+    /* Special */ \
+    X(TOKEN_EOF, "EOF", SPECIAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_ERROR, "ERROR", SPECIAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_COMMENT_SINGLE, "COMMENT_SINGLE", SPECIAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_COMMENT_MULTI, "COMMENT_MULTI", SPECIAL, PREC_NONE, TOKEN_NO_CLOSING) \
+    X(TOKEN_PREPROCESSOR, "PREPROCESSOR", SPECIAL, PREC_NONE, TOKEN_NO_CLOSING)
+
 // Expanded token types for more precise parsing
 typedef enum TokenType {
-    // Literals
-    TOKEN_LITERAL_VALUE,
-    TOKEN_LITERAL_KEYWORD,
-    TOKEN_LITERAL_DELIMITER,
-    TOKEN_LITERAL_OPERATOR,
-    TOKEN_LITERAL_IDENTIFIER,
-    TOKEN_LITERAL_STRING,
-    TOKEN_LITERAL_CHAR,
-    TOKEN_LITERAL_INTEGER,
-    TOKEN_LITERAL_FLOAT,
-    TOKEN_LITERAL_BOOL,
-    TOKEN_LITERAL_NULL,
-    TOKEN_LITERAL_ARRAY,
-
-    // Expressions
-    TOKEN_EXPR_BINARY,
-    TOKEN_EXPR_UNARY,
-    TOKEN_EXPR_ASSIGNMENT,
-    TOKEN_EXPR_FUNCTION_CALL,
-    TOKEN_EXPR_ARRAY_ACCESS,
-    TOKEN_EXPR_MEMBER_ACCESS,
-    TOKEN_EXPR_CONDITIONAL,  // Ternary operator
-    TOKEN_EXPR_COMMA,
-    TOKEN_EXPR_CAST,
-    TOKEN_EXPR_SIZEOF,
-
-    // Statements
-    TOKEN_STMT_IF,
-    TOKEN_STMT_ELSE,
-    TOKEN_STMT_WHILE,
-    TOKEN_STMT_FOR,
-    TOKEN_STMT_DO,
-    TOKEN_STMT_SWITCH,
-    TOKEN_STMT_CASE,
-    TOKEN_STMT_DEFAULT,
-    TOKEN_STMT_RETURN,
-    TOKEN_STMT_BREAK,
-    TOKEN_STMT_CONTINUE,
-    TOKEN_STMT_GOTO,
-    TOKEN_STMT_LABEL,
-
-    // Declarations
-    TOKEN_DECL_VARIABLE,
-    TOKEN_DECL_FUNCTION,
-    TOKEN_DECL_STRUCT,
-    TOKEN_DECL_UNION,
-    TOKEN_DECL_ENUM,
-    TOKEN_DECL_TYPEDEF,
-    TOKEN_DECL_EXTERN,
-    TOKEN_DECL_STATIC,
-    TOKEN_DECL_AUTO,
-    TOKEN_DECL_REGISTER,
-
-    // Scope and blocks
-    TOKEN_SCOPE_BEGIN,
-    TOKEN_SCOPE_END,
-    TOKEN_BLOCK_BEGIN,
-    TOKEN_BLOCK_END,
-    TOKEN_PAREN_OPEN,
-    TOKEN_PAREN_CLOSE,
-    TOKEN_BRACKET_OPEN,
-    TOKEN_BRACKET_CLOSE,
-
-    // Punctuation
-    TOKEN_PUNCT_SEMICOLON,
-    TOKEN_PUNCT_COMMA,
-    TOKEN_PUNCT_DOT,
-    TOKEN_PUNCT_COLON,
-    TOKEN_PUNCT_ARROW,      // ->
-    TOKEN_PUNCT_ELLIPSIS,   // ...
-
-    // Types
-    TOKEN_TYPE_VOID,
-    TOKEN_TYPE_CHAR,
-    TOKEN_TYPE_SHORT,
-    TOKEN_TYPE_INT,
-    TOKEN_TYPE_LONG,
-    TOKEN_TYPE_FLOAT,
-    TOKEN_TYPE_DOUBLE,
-    TOKEN_TYPE_SIGNED,
-    TOKEN_TYPE_UNSIGNED,
-    TOKEN_TYPE_BOOL,
-    TOKEN_TYPE_COMPLEX,
-    TOKEN_TYPE_STRUCT,
-    TOKEN_TYPE_UNION,
-    TOKEN_TYPE_ENUM,
-
-    // Special
-    TOKEN_EOF,
-    TOKEN_ERROR,
-    TOKEN_COMMENT_SINGLE,
-    TOKEN_COMMENT_MULTI,
-    TOKEN_PREPROCESSOR
+#define X(type, name, category, precedence, closing) type,
+    TOKEN_TYPE_LIST(X)
+#undef X
 } TokenType;
 
+#define TOKEN_TYPE_COUNT (TOKEN_PREPROCESSOR + 1)
+
 
 // Token attributes for additional type information
 typedef struct TokenAttributes {
@@ -142,17 +167,22 @@ typedef struct Token {
     TokenType type;
     TokenCategory category;
     char* value;
-    int line_number;
+    uint32_t length;        // Lexeme length in bytes
+    uint32_t lexeme;        // Interned lexeme id, 0 when value is owned
+    uint32_t offset;        // Byte offset of the lexeme in its source
+    int line_number;        // 0 when resolved lazily through source
     int column_number;
     const char* file_name;
+    struct SourceFile* source; // Source the offset refers to, if any
     TokenAttributes attributes;
     struct Token* next;     // For linked list implementation
     struct Token* prev;     // For bidirectional traversal
 } Token;
-// Context structure for token processing
+
+// Context structure for token processing: a cursor over a TokenBuffer
 typedef struct TokenContext {
-    Token* current;
-    Token* peek;
+    const struct TokenBuffer* tokens;
+    uint32_t position;      // Index of the current token
     int depth;              // For nested structures
     int error_count;
     char* error_message;
@@ -167,21 +197,77 @@ bool IsStackEmpty(const TokenStack* stack);
 bool PushToken(TokenStack* stack, struct Token* token);
 struct Token* PopToken(TokenStack* stack);
 struct Token* PeekToken(TokenStack* stack);
-int GetOperatorPrecedence(const struct Token* token);
-
-// Function declarations for token type operations
-const char* TokenType_toString(TokenType type);
-TokenCategory TokenType_getCategory(TokenType type);
-bool TokenType_isLiteral(TokenType type);
-bool TokenType_isExpression(TokenType type);
-bool TokenType_isStatement(TokenType type);
-bool TokenType_isDeclaration(TokenType type);
-bool TokenType_isType(TokenType type);
-bool TokenType_isScope(TokenType type);
-bool TokenType_isPunctuation(TokenType type);
-int TokenType_getOperatorPrecedence(TokenType type);
-bool TokenType_requiresClosing(TokenType type);
-TokenType TokenType_getClosingType(TokenType type);
+
+// Binary precedence (PREC_*) of each reserved lexeme id and 0 for every
+// other id, generated in sym_intern.c from the operator lists
+#define OPERATOR_LEXEME_LIMIT 256
+extern const int8_t lexeme_binary_precedence[OPERATOR_LEXEME_LIMIT];
+
+// PREC_* binding power of a binary expression token, 0 when its lexeme
+// is not an operator and -1 for other tokens. Higher binds tighter.
+static inline int GetOperatorPrecedence(const Token* token) {
+    if (!token || token->type != TOKEN_EXPR_BINARY) return -1;
+    return token->lexeme < OPERATOR_LEXEME_LIMIT ? lexeme_binary_precedence[token->lexeme] : 0;
+}
+
+// Token type operations are single loads from tables generated from
+// TOKEN_TYPE_LIST
+extern const char* const token_type_names[TOKEN_TYPE_COUNT];
+extern const uint8_t token_type_categories[TOKEN_TYPE_COUNT];
+extern const int8_t token_type_precedence[TOKEN_TYPE_COUNT];
+extern const uint8_t token_type_closing[TOKEN_TYPE_COUNT];
+
+static inline const char* TokenType_toString(TokenType type) {
+    return (unsigned)type < TOKEN_TYPE_COUNT ? token_type_names[type] : "UNKNOWN";
+}
+
+static inline TokenCategory TokenType_getCategory(TokenType type) {
+    return (unsigned)type < TOKEN_TYPE_COUNT ? (TokenCategory)token_type_categories[type]
+                                             : TOKEN_CATEGORY_SPECIAL;
+}
+
+static inline bool TokenType_isLiteral(TokenType type) {
+    return TokenType_getCategory(type) == TOKEN_CATEGORY_LITERAL;
+}
+
+static inline bool TokenType_isExpression(TokenType type) {
+    return TokenType_getCategory(type) == TOKEN_CATEGORY_EXPRESSION;
+}
+
+static inline bool TokenType_isStatement(TokenType type) {
+    return TokenType_getCategory(type) == TOKEN_CATEGORY_STATEMENT;
+}
+
+static inline bool TokenType_isDeclaration(TokenType type) {
+    return TokenType_getCategory(type) == TOKEN_CATEGORY_DECLARATION;
+}
+
+static inline bool TokenType_isType(TokenType type) {
+    return TokenType_getCategory(type) == TOKEN_CATEGORY_TYPE;
+}
+
+static inline bool TokenType_isScope(TokenType type) {
+    return TokenType_getCategory(type) == TOKEN_CATEGORY_SCOPE;
+}
+
+static inline bool TokenType_isPunctuation(TokenType type) {
+    return TokenType_getCategory(type) == TOKEN_CATEGORY_PUNCTUATION;
+}
+
+// Precedence when the type alone fixes it; PREC_NONE otherwise
+static inline int TokenType_getOperatorPrecedence(TokenType type) {
+    return (unsigned)type < TOKEN_TYPE_COUNT ? token_type_precedence[type] : PREC_NONE;
+}
+
+// The matching closer, or TOKEN_NO_CLOSING for types that open nothing
+static inline TokenType TokenType_getClosingType(TokenType type) {
+    return (unsigned)type < TOKEN_TYPE_COUNT ? (TokenType)token_type_closing[type] : TOKEN_NO_CLOSING;
+}
+
+static inline bool TokenType_requiresClosing(TokenType type) {
+    return TokenType_getClosingType(type) != TOKEN_NO_CLOSING;
+}
+
 bool TokenType_isValidTransition(TokenType from, TokenType to);
 
 // Token creation and management functions
@@ -189,13 +275,13 @@ Token* Token_create(TokenType type, const char* value);
 void Token_destroy(Token* token);
 void Token_print(const Token* token, FILE* stream);
 Token* Token_copy(const Token* token);
-Token* ParseExpression(Token* tokens[], int count);
 
 // Context management functions
-TokenContext* TokenContext_create(void);
+TokenContext* TokenContext_create(const struct TokenBuffer* tokens);
 void TokenContext_destroy(TokenContext* context);
 bool TokenContext_advance(TokenContext* context);
-Token* TokenContext_peek(TokenContext* context, int ahead);
+TokenType TokenContext_peek(const TokenContext* context, int ahead);
+bool TokenContext_current(const TokenContext* context, Token* token);
 void TokenContext_setError(TokenContext* context, const char* message);
 
 // Attribute management functions
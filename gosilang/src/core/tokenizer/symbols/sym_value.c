@@ -1,8 +1,15 @@
 #include "sym_value.h"
+#include "sym_intern.h"
+#include "sym_format.h"
+#include "core/trace/trace.h"
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
+// Slots allocated by a scope's first insert
+#define SCOPE_INITIAL_SLOTS 8
+
 // Value Management Functions
 LiteralValue* CreateLiteralValue(ValueType type) {
     LiteralValue* value = (LiteralValue*)malloc(sizeof(LiteralValue));
@@ -47,14 +54,67 @@ void DestroyLiteralValue(LiteralValue* value) {
     free(value);
 }
 
+// Operator lookup tables, generated from OPERATOR_TYPE_LIST
+static const char* const operator_strings[OPERATOR_TYPE_COUNT] = {
+#define X(op, spelling, precedence, associativity, category, forms) [op] = spelling,
+    OPERATOR_TYPE_LIST(X)
+#undef X
+};
+
+const uint8_t operator_precedence[OPERATOR_TYPE_COUNT] = {
+#define X(op, spelling, precedence, associativity, category, forms) [op] = precedence,
+    OPERATOR_TYPE_LIST(X)
+#undef X
+};
+
+const bool operator_right_associative[OPERATOR_TYPE_COUNT] = {
+#define X(op, spelling, precedence, associativity, category, forms) [op] = associativity == ASSOC_RIGHT,
+    OPERATOR_TYPE_LIST(X)
+#undef X
+};
+
+const uint8_t operator_categories[OPERATOR_TYPE_COUNT] = {
+#define X(op, spelling, precedence, associativity, category, forms) [op] = OP_CATEGORY_##category,
+    OPERATOR_TYPE_LIST(X)
+#undef X
+};
+
+const uint8_t operator_forms[OPERATOR_TYPE_COUNT] = {
+#define X(op, spelling, precedence, associativity, category, forms) [op] = forms,
+    OPERATOR_TYPE_LIST(X)
+#undef X
+};
+
+static const char* const keyword_strings[KEYWORD_TYPE_COUNT] = {
+#define X(kw, spelling, type) [kw] = spelling,
+    KEYWORD_TYPE_LIST(X)
+#undef X
+};
+
+const char* GetOperatorString(OperatorType op) {
+    if ((unsigned)op >= OPERATOR_TYPE_COUNT) return "unknown";
+    return operator_strings[op];
+}
+
+const char* GetKeywordString(KeywordType kw) {
+    if ((unsigned)kw >= KEYWORD_TYPE_COUNT) return "unknown";
+    return keyword_strings[kw];
+}
+
 // Symbol Table Management
 SymbolTableEntry* CreateSymbol(const char* name, TokenType type) {
     SymbolTableEntry* symbol = (SymbolTableEntry*)malloc(sizeof(SymbolTableEntry));
     if (!symbol) return NULL;
 
     symbol->name = strdup(name);
+    if (!symbol->name) {
+        free(symbol);
+        return NULL;
+    }
+    symbol->name_hash = Lexeme_hash(name, strlen(name));
     symbol->token_type = type;
     TokenAttributes_init(&symbol->attributes);
+    memset(&symbol->value, 0, sizeof(symbol->value));
     symbol->value.type = VAL_NULL;
     symbol->next = NULL;
 
@@ -76,6 +136,9 @@ ScopeLevel* CreateScope(ScopeLevel* parent) {
     if (!scope) return NULL;
 
     scope->symbols = NULL;
+    scope->slots = NULL;
+    scope->slot_mask = 0;
+    scope->symbol_count = 0;
     scope->parent = parent;
     scope->level = parent ? parent->level + 1 : 0;
 
@@ -92,33 +155,98 @@ void DestroyScope(ScopeLevel* scope) {
         current = next;
     }
 
+    free(scope->slots);
     free(scope);
 }
 
+// Probes one scope's table; returns the matching entry's slot or the empty slot
+static uint32_t FindScopeSlot(const ScopeLevel* scope, const char* name, size_t length, uint32_t hash) {
+    uint32_t slot = hash & scope->slot_mask;
+    for (;;) {
+        SymbolTableEntry* entry = scope->slots[slot];
+        if (!entry) return slot;
+        if (entry->name_hash == hash &&
+            strncmp(entry->name, name, length) == 0 &&
+            entry->name[length] == '\0') {
+            return slot;
+        }
+        slot = (slot + 1) & scope->slot_mask;
+    }
+}
+
+static bool GrowScopeSlots(ScopeLevel* scope) {
+    uint32_t slot_count = scope->slots ? (scope->slot_mask + 1) * 2 : SCOPE_INITIAL_SLOTS;
+    SymbolTableEntry** slots = (SymbolTableEntry**)calloc(slot_count, sizeof(SymbolTableEntry*));
+    if (!slots) return false;
+
+    uint32_t mask = slot_count - 1;
+    for (SymbolTableEntry* entry = scope->symbols; entry; entry = entry->next) {
+        uint32_t slot = entry->name_hash & mask;
+        while (slots[slot]) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = entry;
+    }
+
+    free(scope->slots);
+    scope->slots = slots;
+    scope->slot_mask = mask;
+    return true;
+}
+
+// Redeclaration is only an error within the same scope; inner scopes may shadow
 bool AddSymbol(ScopeLevel* scope, SymbolTableEntry* symbol) {
     if (!scope || !symbol) return false;
 
-    if (FindSymbol(scope, symbol->name)) {
+    // Keep the load factor at or below one half
+    if ((scope->symbol_count + 1) * 2 > (scope->slots ? scope->slot_mask + 1 : 0) &&
+        !GrowScopeSlots(scope)) {
+        return false;
+    }
+
+    uint32_t slot = FindScopeSlot(scope, symbol->name, strlen(symbol->name), symbol->name_hash);
+    if (scope->slots[slot]) {
+        TRACE(TRACE_SYMBOLS, "redeclaration of '%s' in scope %d", symbol->name, scope->level);
         return false;
     }
 
+    scope->slots[slot] = symbol;
     symbol->next = scope->symbols;
     scope->symbols = symbol;
+    scope->symbol_count++;
+    TRACE(TRACE_SYMBOLS, "add '%s' (%s) to scope %d",
+          symbol->name, TokenType_toString(symbol->token_type), scope->level);
     return true;
 }
 
-SymbolTableEntry* FindSymbol(ScopeLevel* scope, const char* name) {
-    if (!scope || !name) return NULL;
+SymbolTableEntry* FindSymbolHashed(ScopeLevel* scope, const char* name, size_t length, uint32_t hash) {
+    if (!name) return NULL;
 
-    SymbolTableEntry* current = scope->symbols;
-    while (current) {
-        if (strcmp(current->name, name) == 0) {
-            return current;
+    for (; scope; scope = scope->parent) {
+        if (!scope->slots) continue;
+
+        SymbolTableEntry* entry = scope->slots[FindScopeSlot(scope, name, length, hash)];
+        if (entry) {
+            TRACE(TRACE_SYMBOLS, "found '%.*s' in scope %d", (int)length, name, scope->level);
+            return entry;
         }
-        current = current->next;
     }
+    TRACE(TRACE_SYMBOLS, "'%.*s' not found", (int)length, name);
+    return NULL;
+}
+
+SymbolTableEntry* FindSymbol(ScopeLevel* scope, const char* name) {
+    if (!scope || !name) return NULL;
 
-    return scope->parent ? FindSymbol(scope->parent, name) : NULL;
+    size_t length = strlen(name);
+    return FindSymbolHashed(scope, name, length, Lexeme_hash(name, length));
+}
+
+SymbolTableEntry* FindLocalSymbol(ScopeLevel* scope, const char* name) {
+    if (!scope || !name || !scope->slots) return NULL;
+
+    size_t length = strlen(name);
+    return scope->slots[FindScopeSlot(scope, name, length, Lexeme_hash(name, length))];
 }
 
 bool IsValidValue(const LiteralValue* value) {
@@ -142,29 +270,469 @@ bool IsValidValue(const LiteralValue* value) {
     }
 }
 
+// Formats into a stack buffer; the only allocation is the result
 char* ValueToString(const LiteralValue* value) {
     if (!value) return NULL;
 
-    char buffer[64];
+    char storage[64];
+    StringBuffer buffer;
+    StringBuffer_initWith(&buffer, storage, sizeof(storage));
+    FormatValue(&buffer, value);
+    return StringBuffer_detach(&buffer);
+}
+
+static bool ValueIsTrue(const LiteralValue* value) {
+    switch (value->type) {
+        case VAL_INTEGER: return value->data.int_val != 0;
+        case VAL_FLOAT: return value->data.float_val != 0.0;
+        case VAL_CHAR: return value->data.char_val != '\0';
+        case VAL_STRING: return value->data.string_val != NULL;
+        case VAL_BOOL: return value->data.bool_val;
+        default: return false;
+    }
+}
+
+// Integer reading of a char, bool or null value
+static bool SmallIntegerOf(const LiteralValue* value, int64_t* result) {
     switch (value->type) {
+        case VAL_CHAR: *result = value->data.char_val; return true;
+        case VAL_BOOL: *result = value->data.bool_val; return true;
+        case VAL_NULL: *result = 0; return true;
+        default: return false;
+    }
+}
+
+// Whether a float truncates to an integer of the given width
+static bool FloatFits(double d, int bit_width, bool is_unsigned) {
+    int width = bit_width > 0 && bit_width < 64 ? bit_width : 64;
+    double limit = (double)(UINT64_C(1) << (width - 1));    // 2^(width - 1), exact
+    if (is_unsigned) return d > -1.0 && d < limit * 2.0;
+    return d > -limit - 1.0 && d < limit;
+}
+
+// Conversions follow C: numbers convert by value, integers take the
+// value's own bit_width and is_unsigned, and anything converts to bool
+// by comparing with zero. Strings convert only to bool, anything but a
+// compound converts to a string, and only integer zero becomes null.
+// Fails, leaving value unchanged, when the result cannot hold the value.
+bool ConvertValue(LiteralValue* value, ValueType target_type) {
+    if (!IsValidValue(value)) return false;
+    if (value->type == target_type) return true;
+    if (value->type == VAL_COMPOUND) return false;
+
+    LiteralValue result = *value;
+    result.type = target_type;
+    int64_t integer;
+    switch (target_type) {
         case VAL_INTEGER:
-            snprintf(buffer, sizeof(buffer), "%ld", value->data.int_val);
+            if (value->type == VAL_FLOAT) {
+                double d = value->data.float_val;
+                if (!FloatFits(d, value->bit_width, value->is_unsigned)) return false;
+                result.data.int_val = value->is_unsigned ? (int64_t)(uint64_t)d : (int64_t)d;
+            } else if (SmallIntegerOf(value, &integer)) {
+                result.data.int_val = WrapIntegerValue((uint64_t)integer, value->bit_width, value->is_unsigned);
+            } else {
+                return false;
+            }
             break;
         case VAL_FLOAT:
-            snprintf(buffer, sizeof(buffer), "%f", value->data.float_val);
+            if (value->type == VAL_INTEGER) {
+                result.data.float_val = value->is_unsigned ? (double)(uint64_t)value->data.int_val
+                                                           : (double)value->data.int_val;
+            } else if (value->type != VAL_NULL && SmallIntegerOf(value, &integer)) {
+                result.data.float_val = (double)integer;
+            } else {
+                return false;
+            }
             break;
         case VAL_CHAR:
-            snprintf(buffer, sizeof(buffer), "'%c'", value->data.char_val);
+            if (value->type == VAL_INTEGER) {
+                result.data.char_val = (char)WrapIntegerValue((uint64_t)value->data.int_val, CHAR_BIT, CHAR_MIN == 0);
+            } else if (value->type == VAL_FLOAT) {
+                double d = value->data.float_val;
+                if (!(d > CHAR_MIN - 1.0 && d < CHAR_MAX + 1.0)) return false;
+                result.data.char_val = (char)d;
+            } else if (value->type == VAL_BOOL) {
+                result.data.char_val = (char)value->data.bool_val;
+            } else {
+                return false;
+            }
             break;
-        case VAL_STRING:
-            return value->data.string_val ? strdup(value->data.string_val) : strdup("");
         case VAL_BOOL:
-            return strdup(value->data.bool_val ? "true" : "false");
+            result.data.bool_val = ValueIsTrue(value);
+            break;
+        case VAL_STRING:
+            result.data.string_val = ValueToString(value);
+            if (!result.data.string_val) return false;
+            break;
         case VAL_NULL:
-            return strdup("null");
+            if (value->type != VAL_INTEGER || value->data.int_val != 0) return false;
+            result.data.compound_val = NULL;
+            break;
         default:
-            return strdup("unknown");
+            return false;
+    }
+
+    if (value->type == VAL_STRING) free(value->data.string_val);
+    *value = result;
+    return true;
+}
+
+// Literal spellings
+
+static int DigitValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return 99;
+}
+
+// An integer takes the first of int, unsigned int, long and unsigned
+// long (32 and 64 bits) that holds it, as C11 6.4.4.1 orders them: the
+// unsigned types only for hex, octal and binary spellings or a 'u'
+// suffix, the 32-bit ones only without an 'l' suffix.
+static bool ParseInteger(LiteralValue* value, const char* p, size_t length) {
+    const char* end = p + length;
+    unsigned base = 10;
+    bool digits = false;
+    if (length > 1 && p[0] == '0') {
+        char prefix = (char)(p[1] | 0x20);
+        if (prefix == 'x' || prefix == 'b') {
+            base = prefix == 'x' ? 16 : 2;
+            p += 2;
+        } else {
+            base = 8;
+            digits = true;  // The leading 0
+            p++;
+        }
+    }
+
+    uint64_t bits = 0;
+    for (; p < end; p++) {
+        unsigned digit = (unsigned)DigitValue(*p);
+        if (digit >= base) break;
+        if (bits > (UINT64_MAX - digit) / base) return false;
+        bits = bits * base + digit;
+        digits = true;
+    }
+    if (!digits) return false;
+
+    bool is_unsigned = false;
+    int longs = 0;
+    while (p < end) {
+        char c = (char)(*p | 0x20);
+        if (c == 'u' && !is_unsigned) {
+            is_unsigned = true;
+            p++;
+        } else if (c == 'l' && !longs) {
+            longs = p + 1 < end && p[1] == p[0] ? 2 : 1;
+            p += longs;
+        } else {
+            return false;
+        }
+    }
+
+    bool may_be_unsigned = is_unsigned || base != 10;
+    int bit_width = longs ? 64 : 32;
+    if (bit_width == 32 && bits > (is_unsigned ? UINT32_MAX : INT32_MAX)) {
+        if (may_be_unsigned && bits <= UINT32_MAX) {
+            is_unsigned = true;
+        } else {
+            bit_width = 64;
+        }
+    }
+    if (bit_width == 64 && !is_unsigned && bits > INT64_MAX) {
+        if (!may_be_unsigned) return false;
+        is_unsigned = true;
+    }
+
+    value->type = VAL_INTEGER;
+    value->data.int_val = (int64_t)bits;
+    value->is_unsigned = is_unsigned;
+    value->bit_width = bit_width;
+    return true;
+}
+
+static bool ParseFloat(LiteralValue* value, const char* text, size_t length) {
+    char buffer[64];
+    if (length == 0 || length >= sizeof(buffer)) return false;
+
+    memcpy(buffer, text, length);
+    char suffix = (char)(buffer[length - 1] | 0x20);
+    // In a hex float 'f' is a digit, and a suffix only after the exponent
+    bool hex = length > 1 && buffer[0] == '0' && (buffer[1] | 0x20) == 'x';
+    bool exponent = memchr(buffer, 'p', length) || memchr(buffer, 'P', length);
+    if (suffix == 'l' || (suffix == 'f' && (!hex || exponent))) length--;
+    buffer[length] = '\0';
+
+    char* end;
+    double d = strtod(buffer, &end);
+    if (end != buffer + length || d != d || d - d != 0.0) return false; // Malformed, NaN or infinite
+
+    value->type = VAL_FLOAT;
+    value->data.float_val = d;
+    return true;
+}
+
+// Decodes one character of a quoted literal, escapes included
+static bool DecodeQuotedChar(const char** position, const char* end, char* out) {
+    const char* p = *position;
+    if (p >= end) return false;
+    if (*p != '\\') {
+        *out = *p;
+        *position = p + 1;
+        return true;
+    }
+    if (++p >= end) return false;
+
+    char c = *p++;
+    switch (c) {
+        case 'n': *out = '\n'; break;
+        case 't': *out = '\t'; break;
+        case 'r': *out = '\r'; break;
+        case 'a': *out = '\a'; break;
+        case 'b': *out = '\b'; break;
+        case 'f': *out = '\f'; break;
+        case 'v': *out = '\v'; break;
+        case '\\': case '\'': case '"': case '?': *out = c; break;
+        case 'x': {
+            unsigned code = 0;
+            int count = 0;
+            while (p < end && DigitValue(*p) < 16) {
+                code = code * 16 + (unsigned)DigitValue(*p++);
+                if (++count > 2) return false;
+            }
+            if (!count) return false;
+            *out = (char)code;
+            break;
+        }
+        default: {
+            if (c < '0' || c > '7') return false;
+            unsigned code = (unsigned)(c - '0');
+            for (int count = 1; count < 3 && p < end && *p >= '0' && *p <= '7'; count++) {
+                code = code * 8 + (unsigned)(*p++ - '0');
+            }
+            if (code > 0xFF) return false;
+            *out = (char)code;
+            break;
+        }
+    }
+    *position = p;
+    return true;
+}
+
+static bool ParseQuoted(LiteralValue* value, TokenType type, const char* text, size_t length) {
+    char quote = type == TOKEN_LITERAL_CHAR ? '\'' : '"';
+    if (length < 2 || text[0] != quote || text[length - 1] != quote) return false;
+
+    const char* p = text + 1;
+    const char* end = text + length - 1;
+    if (type == TOKEN_LITERAL_CHAR) {
+        char c;
+        if (!DecodeQuotedChar(&p, end, &c) || p != end) return false;
+        value->type = VAL_CHAR;
+        value->data.char_val = c;
+        return true;
+    }
+
+    char* string = (char*)malloc(length - 1);
+    if (!string) return false;
+
+    size_t count = 0;
+    while (p < end) {
+        if (!DecodeQuotedChar(&p, end, &string[count++])) {
+            free(string);
+            return false;
+        }
+    }
+    string[count] = '\0';
+    value->type = VAL_STRING;
+    value->data.string_val = string;
+    return true;
+}
+
+bool ParseLiteralValue(LiteralValue* value, TokenType type, const char* text, size_t length) {
+    if (!value || !text) return false;
+
+    switch (type) {
+        case TOKEN_LITERAL_INTEGER:
+            return ParseInteger(value, text, length);
+        case TOKEN_LITERAL_FLOAT:
+            return ParseFloat(value, text, length);
+        case TOKEN_LITERAL_CHAR:
+        case TOKEN_LITERAL_STRING:
+            return ParseQuoted(value, type, text, length);
+        case TOKEN_LITERAL_BOOL:
+            if (length == 4 && memcmp(text, "true", 4) == 0) {
+                value->data.bool_val = true;
+            } else if (length == 5 && memcmp(text, "false", 5) == 0) {
+                value->data.bool_val = false;
+            } else {
+                return false;
+            }
+            value->type = VAL_BOOL;
+            return true;
+        case TOKEN_LITERAL_NULL:
+            value->type = VAL_NULL;
+            value->data.compound_val = NULL;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Type-specific functions. A function owns its parameters and scope; a
+// definition owns its members or enumerators.
+FunctionSignature* CreateFunction(const char* name, TokenType return_type) {
+    if (!name) return NULL;
+
+    FunctionSignature* func = (FunctionSignature*)calloc(1, sizeof(FunctionSignature));
+    if (!func) return NULL;
+
+    func->name = strdup(name);
+    if (!func->name) {
+        free(func);
+        return NULL;
+    }
+    func->return_type = return_type;
+    TokenAttributes_init(&func->return_attributes);
+    return func;
+}
+
+void DestroyFunction(FunctionSignature* func) {
+    if (!func) return;
+
+    FunctionParameter* param = func->parameters;
+    while (param) {
+        FunctionParameter* next = param->next;
+        free(param->name);
+        free(param);
+        param = next;
+    }
+    DestroyScope(func->scope);
+    free(func->name);
+    free(func);
+}
+
+StructDefinition* CreateStruct(const char* name, bool is_union) {
+    if (!name) return NULL;
+
+    StructDefinition* struct_def = (StructDefinition*)calloc(1, sizeof(StructDefinition));
+    if (!struct_def) return NULL;
+
+    struct_def->name = strdup(name);
+    if (!struct_def->name) {
+        free(struct_def);
+        return NULL;
+    }
+    struct_def->is_union = is_union;
+    struct_def->alignment = 1;
+    return struct_def;
+}
+
+void DestroyStruct(StructDefinition* struct_def) {
+    if (!struct_def) return;
+
+    StructMember* member = struct_def->members;
+    while (member) {
+        StructMember* next = member->next;
+        free(member->name);
+        free(member);
+        member = next;
+    }
+    free(struct_def->name);
+    free(struct_def);
+}
+
+EnumDefinition* CreateEnum(const char* name) {
+    if (!name) return NULL;
+
+    EnumDefinition* enum_def = (EnumDefinition*)calloc(1, sizeof(EnumDefinition));
+    if (!enum_def) return NULL;
+
+    enum_def->name = strdup(name);
+    if (!enum_def->name) {
+        free(enum_def);
+        return NULL;
+    }
+    enum_def->last_value = -1;
+    return enum_def;
+}
+
+void DestroyEnum(EnumDefinition* enum_def) {
+    if (!enum_def) return;
+
+    EnumValue* value = enum_def->values;
+    while (value) {
+        EnumValue* next = value->next;
+        free(value->name);
+        free(value);
+        value = next;
+    }
+    free(enum_def->name);
+    free(enum_def);
+}
+
+FunctionParameter* AddParameter(FunctionSignature* func, const char* name, TokenType type) {
+    if (!func) return NULL;
+
+    FunctionParameter* param = (FunctionParameter*)calloc(1, sizeof(FunctionParameter));
+    if (!param) return NULL;
+
+    // Unnamed parameters are allowed in declarations
+    param->name = name ? strdup(name) : NULL;
+    if (name && !param->name) {
+        free(param);
+        return NULL;
+    }
+    param->param_type = type;
+    TokenAttributes_init(&param->attributes);
+
+    FunctionParameter** tail = &func->parameters;
+    while (*tail) tail = &(*tail)->next;
+    *tail = param;
+    return param;
+}
+
+// The member's offset is left for layout to fill in
+StructMember* AddStructMember(StructDefinition* struct_def, const char* name, TokenType type) {
+    if (!struct_def || !name) return NULL;
+
+    StructMember* member = (StructMember*)calloc(1, sizeof(StructMember));
+    if (!member) return NULL;
+
+    member->name = strdup(name);
+    if (!member->name) {
+        free(member);
+        return NULL;
+    }
+    member->member_type = type;
+    member->offset = -1;
+    TokenAttributes_init(&member->attributes);
+
+    StructMember** tail = &struct_def->members;
+    while (*tail) tail = &(*tail)->next;
+    *tail = member;
+    return member;
+}
+
+// An enumerator without an initializer takes enum_def->last_value + 1
+EnumValue* AddEnumValue(EnumDefinition* enum_def, const char* name, int value) {
+    if (!enum_def || !name) return NULL;
+
+    EnumValue* enumerator = (EnumValue*)calloc(1, sizeof(EnumValue));
+    if (!enumerator) return NULL;
+
+    enumerator->name = strdup(name);
+    if (!enumerator->name) {
+        free(enumerator);
+        return NULL;
     }
+    enumerator->value = value;
+    enum_def->last_value = value;
 
-    return strdup(buffer);
+    EnumValue** tail = &enum_def->values;
+    while (*tail) tail = &(*tail)->next;
+    *tail = enumerator;
+    return enumerator;
 }
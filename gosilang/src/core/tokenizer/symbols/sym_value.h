@@ -4,116 +4,156 @@
 #include "sym_type.h"
 #include <stdint.h>
 
+// Operator associativity
+typedef enum {
+    ASSOC_LEFT,
+    ASSOC_RIGHT
+} OperatorAssociativity;
+
+// Operator groups, the category column of OPERATOR_TYPE_LIST
+typedef enum {
+    OP_CATEGORY_ARITHMETIC,
+    OP_CATEGORY_ASSIGNMENT,
+    OP_CATEGORY_BITWISE,
+    OP_CATEGORY_LOGICAL,
+    OP_CATEGORY_COMPARISON,
+    OP_CATEGORY_INCREMENT,
+    OP_CATEGORY_MEMBER,
+    OP_CATEGORY_OTHER
+} OperatorCategory;
+
+// Positions an operator can be written in, relative to its operands
+#define OP_FORM_PREFIX  0x1
+#define OP_FORM_INFIX   0x2
+#define OP_FORM_POSTFIX 0x4
+#define OP_FORM_TERNARY 0x8
+
+// Every operator with its spelling, precedence, associativity, category
+// and forms. The single source for the enum and the OperatorType_*
+// lookup tables.
+#define OPERATOR_TYPE_LIST(X) \
+    /* Arithmetic operators */ \
+    X(OP_ADD, "+", PREC_ADDITIVE, ASSOC_LEFT, ARITHMETIC, OP_FORM_INFIX | OP_FORM_PREFIX) \
+    X(OP_SUBTRACT, "-", PREC_ADDITIVE, ASSOC_LEFT, ARITHMETIC, OP_FORM_INFIX | OP_FORM_PREFIX) \
+    X(OP_MULTIPLY, "*", PREC_MULTIPLICATIVE, ASSOC_LEFT, ARITHMETIC, OP_FORM_INFIX) \
+    X(OP_DIVIDE, "/", PREC_MULTIPLICATIVE, ASSOC_LEFT, ARITHMETIC, OP_FORM_INFIX) \
+    X(OP_MODULO, "%", PREC_MULTIPLICATIVE, ASSOC_LEFT, ARITHMETIC, OP_FORM_INFIX) \
+    /* Assignment operators */ \
+    X(OP_ASSIGN, "=", PREC_ASSIGNMENT, ASSOC_RIGHT, ASSIGNMENT, OP_FORM_INFIX) \
+    X(OP_ADD_ASSIGN, "+=", PREC_ASSIGNMENT, ASSOC_RIGHT, ASSIGNMENT, OP_FORM_INFIX) \
+    X(OP_SUB_ASSIGN, "-=", PREC_ASSIGNMENT, ASSOC_RIGHT, ASSIGNMENT, OP_FORM_INFIX) \
+    X(OP_MUL_ASSIGN, "*=", PREC_ASSIGNMENT, ASSOC_RIGHT, ASSIGNMENT, OP_FORM_INFIX) \
+    X(OP_DIV_ASSIGN, "/=", PREC_ASSIGNMENT, ASSOC_RIGHT, ASSIGNMENT, OP_FORM_INFIX) \
+    X(OP_MOD_ASSIGN, "%=", PREC_ASSIGNMENT, ASSOC_RIGHT, ASSIGNMENT, OP_FORM_INFIX) \
+    X(OP_AND_ASSIGN, "&=", PREC_ASSIGNMENT, ASSOC_RIGHT, ASSIGNMENT, OP_FORM_INFIX) \
+    X(OP_OR_ASSIGN, "|=", PREC_ASSIGNMENT, ASSOC_RIGHT, ASSIGNMENT, OP_FORM_INFIX) \
+    X(OP_XOR_ASSIGN, "^=", PREC_ASSIGNMENT, ASSOC_RIGHT, ASSIGNMENT, OP_FORM_INFIX) \
+    X(OP_SHL_ASSIGN, "<<=", PREC_ASSIGNMENT, ASSOC_RIGHT, ASSIGNMENT, OP_FORM_INFIX) \
+    X(OP_SHR_ASSIGN, ">>=", PREC_ASSIGNMENT, ASSOC_RIGHT, ASSIGNMENT, OP_FORM_INFIX) \
+    /* Bitwise operators */ \
+    X(OP_BITWISE_AND, "&", PREC_BITWISE_AND, ASSOC_LEFT, BITWISE, OP_FORM_INFIX) \
+    X(OP_BITWISE_OR, "|", PREC_BITWISE_OR, ASSOC_LEFT, BITWISE, OP_FORM_INFIX) \
+    X(OP_BITWISE_XOR, "^", PREC_BITWISE_XOR, ASSOC_LEFT, BITWISE, OP_FORM_INFIX) \
+    X(OP_BITWISE_NOT, "~", PREC_PREFIX, ASSOC_RIGHT, BITWISE, OP_FORM_PREFIX) \
+    X(OP_SHIFT_LEFT, "<<", PREC_SHIFT, ASSOC_LEFT, BITWISE, OP_FORM_INFIX) \
+    X(OP_SHIFT_RIGHT, ">>", PREC_SHIFT, ASSOC_LEFT, BITWISE, OP_FORM_INFIX) \
+    /* Logical operators */ \
+    X(OP_LOGICAL_AND, "&&", PREC_LOGICAL_AND, ASSOC_LEFT, LOGICAL, OP_FORM_INFIX) \
+    X(OP_LOGICAL_OR, "||", PREC_LOGICAL_OR, ASSOC_LEFT, LOGICAL, OP_FORM_INFIX) \
+    X(OP_LOGICAL_NOT, "!", PREC_PREFIX, ASSOC_RIGHT, LOGICAL, OP_FORM_PREFIX) \
+    /* Comparison operators */ \
+    X(OP_EQUAL, "==", PREC_EQUALITY, ASSOC_LEFT, COMPARISON, OP_FORM_INFIX) \
+    X(OP_NOT_EQUAL, "!=", PREC_EQUALITY, ASSOC_LEFT, COMPARISON, OP_FORM_INFIX) \
+    X(OP_LESS, "<", PREC_RELATIONAL, ASSOC_LEFT, COMPARISON, OP_FORM_INFIX) \
+    X(OP_GREATER, ">", PREC_RELATIONAL, ASSOC_LEFT, COMPARISON, OP_FORM_INFIX) \
+    X(OP_LESS_EQUAL, "<=", PREC_RELATIONAL, ASSOC_LEFT, COMPARISON, OP_FORM_INFIX) \
+    X(OP_GREATER_EQUAL, ">=", PREC_RELATIONAL, ASSOC_LEFT, COMPARISON, OP_FORM_INFIX) \
+    /* Increment/Decrement; precedence of the postfix form */ \
+    X(OP_INCREMENT, "++", PREC_POSTFIX, ASSOC_LEFT, INCREMENT, OP_FORM_PREFIX | OP_FORM_POSTFIX) \
+    X(OP_DECREMENT, "--", PREC_POSTFIX, ASSOC_LEFT, INCREMENT, OP_FORM_PREFIX | OP_FORM_POSTFIX) \
+    /* Member access */ \
+    X(OP_MEMBER_DOT, ".", PREC_POSTFIX, ASSOC_LEFT, MEMBER, OP_FORM_INFIX) \
+    X(OP_MEMBER_ARROW, "->", PREC_POSTFIX, ASSOC_LEFT, MEMBER, OP_FORM_INFIX) \
+    /* Other operators */ \
+    X(OP_ADDRESS_OF, "&", PREC_PREFIX, ASSOC_RIGHT, OTHER, OP_FORM_PREFIX) \
+    X(OP_DEREFERENCE, "*", PREC_PREFIX, ASSOC_RIGHT, OTHER, OP_FORM_PREFIX) \
+    X(OP_SIZEOF, "sizeof", PREC_PREFIX, ASSOC_RIGHT, OTHER, OP_FORM_PREFIX) \
+    X(OP_COMMA, ",", PREC_COMMA, ASSOC_LEFT, OTHER, OP_FORM_INFIX) \
+    X(OP_CONDITIONAL, "?:", PREC_CONDITIONAL, ASSOC_RIGHT, OTHER, OP_FORM_TERNARY)
+
 // Operator types
 typedef enum {
-    // Arithmetic operators
-    OP_ADD,          // +
-    OP_SUBTRACT,     // -
-    OP_MULTIPLY,     // *
-    OP_DIVIDE,       // /
-    OP_MODULO,       // %
-
-    // Assignment operators
-    OP_ASSIGN,       // =
-    OP_ADD_ASSIGN,   // +=
-    OP_SUB_ASSIGN,   // -=
-    OP_MUL_ASSIGN,   // *=
-    OP_DIV_ASSIGN,   // /=
-    OP_MOD_ASSIGN,   // %=
-    OP_AND_ASSIGN,   // &=
-    OP_OR_ASSIGN,    // |=
-    OP_XOR_ASSIGN,   // ^=
-    OP_SHL_ASSIGN,   // <<=
-    OP_SHR_ASSIGN,   // >>=
-
-    // Bitwise operators
-    OP_BITWISE_AND,  // &
-    OP_BITWISE_OR,   // |
-    OP_BITWISE_XOR,  // ^
-    OP_BITWISE_NOT,  // ~
-    OP_SHIFT_LEFT,   // <<
-    OP_SHIFT_RIGHT,  // >>
-
-    // Logical operators
-    OP_LOGICAL_AND,  // &&
-    OP_LOGICAL_OR,   // ||
-    OP_LOGICAL_NOT,  // !
-
-    // Comparison operators
-    OP_EQUAL,        // ==
-    OP_NOT_EQUAL,    // !=
-    OP_LESS,         // <
-    OP_GREATER,      // >
-    OP_LESS_EQUAL,   // <=
-    OP_GREATER_EQUAL,// >=
-
-    // Increment/Decrement
-    OP_INCREMENT,    // ++
-    OP_DECREMENT,    // --
-
-    // Member access
-    OP_MEMBER_DOT,   // .
-    OP_MEMBER_ARROW, // ->
-
-    // Other operators
-    OP_ADDRESS_OF,   // &
-    OP_DEREFERENCE,  // *
-    OP_SIZEOF,       // sizeof
-    OP_COMMA,        // ,
-    OP_CONDITIONAL   // ? :
+#define X(op, spelling, precedence, associativity, category, forms) op,
+    OPERATOR_TYPE_LIST(X)
+#undef X
 } OperatorType;
 
+#define OPERATOR_TYPE_COUNT (OP_CONDITIONAL + 1)
+
+// Each operator's precedence as a constant, for tables that are indexed
+// by something other than OperatorType
+enum {
+#define X(op, spelling, precedence, associativity, category, forms) op##_PRECEDENCE = precedence,
+    OPERATOR_TYPE_LIST(X)
+#undef X
+};
+
+// Every keyword with its spelling and the token type the lexer gives
+// it. The single source for the enum, the keyword spellings and the
+// reserved lexemes.
+#define KEYWORD_TYPE_LIST(X) \
+    /* Control flow */ \
+    X(KW_IF, "if", TOKEN_STMT_IF) \
+    X(KW_ELSE, "else", TOKEN_STMT_ELSE) \
+    X(KW_WHILE, "while", TOKEN_STMT_WHILE) \
+    X(KW_FOR, "for", TOKEN_STMT_FOR) \
+    X(KW_DO, "do", TOKEN_STMT_DO) \
+    X(KW_SWITCH, "switch", TOKEN_STMT_SWITCH) \
+    X(KW_CASE, "case", TOKEN_STMT_CASE) \
+    X(KW_DEFAULT, "default", TOKEN_STMT_DEFAULT) \
+    X(KW_BREAK, "break", TOKEN_STMT_BREAK) \
+    X(KW_CONTINUE, "continue", TOKEN_STMT_CONTINUE) \
+    X(KW_RETURN, "return", TOKEN_STMT_RETURN) \
+    X(KW_GOTO, "goto", TOKEN_STMT_GOTO) \
+    /* Type keywords */ \
+    X(KW_VOID, "void", TOKEN_TYPE_VOID) \
+    X(KW_CHAR, "char", TOKEN_TYPE_CHAR) \
+    X(KW_SHORT, "short", TOKEN_TYPE_SHORT) \
+    X(KW_INT, "int", TOKEN_TYPE_INT) \
+    X(KW_LONG, "long", TOKEN_TYPE_LONG) \
+    X(KW_FLOAT, "float", TOKEN_TYPE_FLOAT) \
+    X(KW_DOUBLE, "double", TOKEN_TYPE_DOUBLE) \
+    X(KW_SIGNED, "signed", TOKEN_TYPE_SIGNED) \
+    X(KW_UNSIGNED, "unsigned", TOKEN_TYPE_UNSIGNED) \
+    /* Type qualifiers */ \
+    X(KW_CONST, "const", TOKEN_LITERAL_KEYWORD) \
+    X(KW_VOLATILE, "volatile", TOKEN_LITERAL_KEYWORD) \
+    X(KW_RESTRICT, "restrict", TOKEN_LITERAL_KEYWORD) \
+    /* Storage classes */ \
+    X(KW_AUTO, "auto", TOKEN_DECL_AUTO) \
+    X(KW_REGISTER, "register", TOKEN_DECL_REGISTER) \
+    X(KW_STATIC, "static", TOKEN_DECL_STATIC) \
+    X(KW_EXTERN, "extern", TOKEN_DECL_EXTERN) \
+    X(KW_TYPEDEF, "typedef", TOKEN_DECL_TYPEDEF) \
+    /* Structure/Union */ \
+    X(KW_STRUCT, "struct", TOKEN_TYPE_STRUCT) \
+    X(KW_UNION, "union", TOKEN_TYPE_UNION) \
+    X(KW_ENUM, "enum", TOKEN_TYPE_ENUM) \
+    /* Other */ \
+    X(KW_SIZEOF, "sizeof", TOKEN_EXPR_SIZEOF) \
+    X(KW_ALIGNOF, "_Alignof", TOKEN_LITERAL_KEYWORD) \
+    X(KW_INLINE, "inline", TOKEN_LITERAL_KEYWORD) \
+    X(KW_STATIC_ASSERT, "_Static_assert", TOKEN_LITERAL_KEYWORD)
+
 // Keyword types
 typedef enum {
-    // Control flow
-    KW_IF,
-    KW_ELSE,
-    KW_WHILE,
-    KW_FOR,
-    KW_DO,
-    KW_SWITCH,
-    KW_CASE,
-    KW_DEFAULT,
-    KW_BREAK,
-    KW_CONTINUE,
-    KW_RETURN,
-    KW_GOTO,
-
-    // Type keywords
-    KW_VOID,
-    KW_CHAR,
-    KW_SHORT,
-    KW_INT,
-    KW_LONG,
-    KW_FLOAT,
-    KW_DOUBLE,
-    KW_SIGNED,
-    KW_UNSIGNED,
-
-    // Type qualifiers
-    KW_CONST,
-    KW_VOLATILE,
-    KW_RESTRICT,
-
-    // Storage classes
-    KW_AUTO,
-    KW_REGISTER,
-    KW_STATIC,
-    KW_EXTERN,
-    KW_TYPEDEF,
-
-    // Structure/Union
-    KW_STRUCT,
-    KW_UNION,
-    KW_ENUM,
-
-    // Other
-    KW_SIZEOF,
-    KW_ALIGNOF,
-    KW_INLINE,
-    KW_STATIC_ASSERT
+#define X(kw, spelling, type) kw,
+    KEYWORD_TYPE_LIST(X)
+#undef X
 } KeywordType;
 
+#define KEYWORD_TYPE_COUNT (KW_STATIC_ASSERT + 1)
+
 // Literal value types that can be stored
 typedef enum {
     VAL_INTEGER,
@@ -146,6 +186,7 @@ typedef struct {
 // Structure for symbol table entries
 typedef struct SymbolTableEntry {
     char* name;
+    uint32_t name_hash;     // Lexeme_hash of name, computed once
     TokenType token_type;
     TokenAttributes attributes;
     LiteralValue value;
@@ -154,7 +195,10 @@ typedef struct SymbolTableEntry {
 
 // Structure for tracking scope
 typedef struct ScopeLevel {
-    SymbolTableEntry* symbols;
+    SymbolTableEntry* symbols;      // Owned entries, newest first
+    SymbolTableEntry** slots;       // Open addressing table, allocated on first insert
+    uint32_t slot_mask;
+    uint32_t symbol_count;
     struct ScopeLevel* parent;
     int level;
 } ScopeLevel;
@@ -224,6 +268,45 @@ bool IsValidValue(const LiteralValue* value);
 char* ValueToString(const LiteralValue* value);
 bool ConvertValue(LiteralValue* value, ValueType target_type);
 
+// Reads a literal token's spelling into value: integers take the C type
+// their digits and suffix give them, strings are unescaped into a new
+// allocation. False if the spelling is malformed or does not fit.
+bool ParseLiteralValue(LiteralValue* value, TokenType type, const char* text, size_t length);
+
+// Two's complement wrap of an integer to bit_width bits, sign- or
+// zero-extended back to 64
+static inline int64_t WrapIntegerValue(uint64_t bits, int bit_width, bool is_unsigned) {
+    if (bit_width <= 0 || bit_width >= 64) return (int64_t)bits;
+
+    uint64_t mask = (UINT64_C(1) << bit_width) - 1;
+    bits &= mask;
+    if (!is_unsigned && (bits >> (bit_width - 1))) bits |= ~mask;
+    return (int64_t)bits;
+}
+
+// Operator binding and classification, generated from OPERATOR_TYPE_LIST
+extern const uint8_t operator_precedence[OPERATOR_TYPE_COUNT];
+extern const bool operator_right_associative[OPERATOR_TYPE_COUNT];
+extern const uint8_t operator_categories[OPERATOR_TYPE_COUNT];
+extern const uint8_t operator_forms[OPERATOR_TYPE_COUNT];
+
+static inline int OperatorType_getPrecedence(OperatorType op) {
+    return (unsigned)op < OPERATOR_TYPE_COUNT ? operator_precedence[op] : PREC_NONE;
+}
+
+static inline bool OperatorType_isRightAssociative(OperatorType op) {
+    return (unsigned)op < OPERATOR_TYPE_COUNT && operator_right_associative[op];
+}
+
+static inline OperatorCategory OperatorType_getCategory(OperatorType op) {
+    return (unsigned)op < OPERATOR_TYPE_COUNT ? (OperatorCategory)operator_categories[op] : OP_CATEGORY_OTHER;
+}
+
+// Whether op can be written in form, one of OP_FORM_*
+static inline bool OperatorType_hasForm(OperatorType op, unsigned form) {
+    return (unsigned)op < OPERATOR_TYPE_COUNT && (operator_forms[op] & form) != 0;
+}
+
 // Symbol table functions
 SymbolTableEntry* CreateSymbol(const char* name, TokenType type);
 void DestroySymbol(SymbolTableEntry* symbol);
@@ -231,6 +314,8 @@ ScopeLevel* CreateScope(ScopeLevel* parent);
 void DestroyScope(ScopeLevel* scope);
 bool AddSymbol(ScopeLevel* scope, SymbolTableEntry* symbol);
 SymbolTableEntry* FindSymbol(ScopeLevel* scope, const char* name);
+SymbolTableEntry* FindLocalSymbol(ScopeLevel* scope, const char* name);
+SymbolTableEntry* FindSymbolHashed(ScopeLevel* scope, const char* name, size_t length, uint32_t hash);
 
 // Type-specific functions
 FunctionSignature* CreateFunction(const char* name, TokenType return_type);
@@ -240,4 +325,9 @@ void DestroyStruct(StructDefinition* struct_def);
 EnumDefinition* CreateEnum(const char* name);
 void DestroyEnum(EnumDefinition* enum_def);
 
+// Parameters, members and enumerators are kept in declaration order
+FunctionParameter* AddParameter(FunctionSignature* func, const char* name, TokenType type);
+StructMember* AddStructMember(StructDefinition* struct_def, const char* name, TokenType type);
+EnumValue* AddEnumValue(EnumDefinition* enum_def, const char* name, int value);
+
 #endif // SYM_VALUE_H
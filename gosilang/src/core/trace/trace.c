@@ -0,0 +1,225 @@
+#include "trace.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+uint32_t trace_mask = 0;
+
+// Sink state, shared by every thread. A file or stderr write can block,
+// so the lock is a mutex that parks waiters rather than a spin lock;
+// holding it across the write keeps lines whole and stops a sink change
+// from closing a stream under a writer.
+static struct {
+    TraceSinkKind kind;
+    FILE* stream;
+    bool owns_stream;
+    char* ring;
+    size_t ring_size;
+    size_t ring_written;    // Total bytes ever written to the ring
+    pthread_mutex_t lock;
+} trace_sink = { TRACE_SINK_STDERR, NULL, false, NULL, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+
+static void LockSink(void) {
+    pthread_mutex_lock(&trace_sink.lock);
+}
+
+static void UnlockSink(void) {
+    pthread_mutex_unlock(&trace_sink.lock);
+}
+
+// Releases the current sink; called with the lock held
+static void CloseSink(void) {
+    if (trace_sink.owns_stream && trace_sink.stream) fclose(trace_sink.stream);
+    free(trace_sink.ring);
+    trace_sink.kind = TRACE_SINK_STDERR;
+    trace_sink.stream = NULL;
+    trace_sink.owns_stream = false;
+    trace_sink.ring = NULL;
+    trace_sink.ring_size = 0;
+    trace_sink.ring_written = 0;
+}
+
+// Configuration
+void Trace_enable(uint32_t channels) {
+    __atomic_or_fetch(&trace_mask, channels, __ATOMIC_RELAXED);
+}
+
+void Trace_disable(uint32_t channels) {
+    __atomic_and_fetch(&trace_mask, ~channels, __ATOMIC_RELAXED);
+}
+
+// Sends messages to stderr or to a stream the caller keeps open
+bool Trace_setSink(TraceSinkKind kind, FILE* stream) {
+    if (kind == TRACE_SINK_RING) return Trace_setRing(TRACE_RING_DEFAULT_SIZE);
+    if (kind == TRACE_SINK_FILE && !stream) return false;
+
+    LockSink();
+    CloseSink();
+    trace_sink.kind = kind;
+    trace_sink.stream = kind == TRACE_SINK_FILE ? stream : NULL;
+    UnlockSink();
+    return true;
+}
+
+bool Trace_openFile(const char* path) {
+    FILE* stream = path ? fopen(path, "w") : NULL;
+    if (!stream) return false;
+
+    LockSink();
+    CloseSink();
+    trace_sink.kind = TRACE_SINK_FILE;
+    trace_sink.stream = stream;
+    trace_sink.owns_stream = true;
+    UnlockSink();
+    return true;
+}
+
+bool Trace_setRing(size_t capacity) {
+    char* ring = (char*)malloc(capacity ? capacity : TRACE_RING_DEFAULT_SIZE);
+    if (!ring) return false;
+
+    LockSink();
+    CloseSink();
+    trace_sink.kind = TRACE_SINK_RING;
+    trace_sink.ring = ring;
+    trace_sink.ring_size = capacity ? capacity : TRACE_RING_DEFAULT_SIZE;
+    UnlockSink();
+    return true;
+}
+
+static uint32_t ParseChannels(const char* spec) {
+    static const struct { const char* name; uint32_t mask; } names[] = {
+        { "all", TRACE_ALL },
+        { "lexer", TRACE_LEXER },
+        { "parser", TRACE_PARSER },
+        { "symbols", TRACE_SYMBOLS }
+    };
+
+    uint32_t mask = 0;
+    while (*spec) {
+        size_t length = strcspn(spec, ",");
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (strlen(names[i].name) == length && strncmp(names[i].name, spec, length) == 0) {
+                mask |= names[i].mask;
+            }
+        }
+        spec += length;
+        if (*spec == ',') spec++;
+    }
+    return mask;
+}
+
+// GOSILANG_TRACE selects channels ("all" or e.g. "parser,symbols") and
+// GOSILANG_TRACE_SINK the sink ("stderr", "ring", "ring:BYTES" or a
+// file path). Returns true when any channel was enabled.
+bool Trace_configureFromEnv(void) {
+    const char* channels = getenv("GOSILANG_TRACE");
+    if (!channels || !*channels) return false;
+
+    const char* sink = getenv("GOSILANG_TRACE_SINK");
+    if (sink && strncmp(sink, "ring", 4) == 0 && (sink[4] == '\0' || sink[4] == ':')) {
+        Trace_setRing(sink[4] == ':' ? strtoull(sink + 5, NULL, 10) : 0);
+    } else if (sink && *sink && strcmp(sink, "stderr") != 0) {
+        if (!Trace_openFile(sink)) {
+            fprintf(stderr, "trace: cannot open '%s', using stderr\n", sink);
+        }
+    }
+
+    uint32_t mask = ParseChannels(channels);
+    Trace_enable(mask);
+    return mask != 0;
+}
+
+void Trace_shutdown(void) {
+    Trace_disable(TRACE_ALL);
+    LockSink();
+    CloseSink();
+    UnlockSink();
+}
+
+// Emission
+static void WriteRing(const char* text, size_t length) {
+    size_t size = trace_sink.ring_size;
+    if (length > size) {
+        text += length - size;
+        length = size;
+    }
+
+    size_t at = trace_sink.ring_written % size;
+    size_t first = length < size - at ? length : size - at;
+    memcpy(trace_sink.ring + at, text, first);
+    memcpy(trace_sink.ring, text + first, length - first);
+    trace_sink.ring_written += length;
+}
+
+void Trace_emit(TraceChannel channel, const char* format, ...) {
+    char message[TRACE_MESSAGE_SIZE];
+    int prefix = snprintf(message, sizeof(message), "[%s] ", TraceChannel_toString(channel));
+
+    va_list args;
+    va_start(args, format);
+    int body = vsnprintf(message + prefix, sizeof(message) - (size_t)prefix - 1, format, args);
+    va_end(args);
+
+    // Truncated messages still end in a newline
+    size_t length = (size_t)prefix + (body < 0 ? 0 : (size_t)body);
+    if (length > sizeof(message) - 2) length = sizeof(message) - 2;
+    message[length++] = '\n';
+    message[length] = '\0';
+
+    LockSink();
+    switch (trace_sink.kind) {
+        case TRACE_SINK_RING:
+            WriteRing(message, length);
+            break;
+        case TRACE_SINK_FILE:
+            fwrite(message, 1, length, trace_sink.stream);
+            break;
+        default:
+            fwrite(message, 1, length, stderr);
+            break;
+    }
+    UnlockSink();
+}
+
+// Writes the ring's complete lines, oldest first; returns bytes written
+size_t Trace_dumpRing(FILE* stream) {
+    if (!stream) return 0;
+
+    LockSink();
+    size_t written = 0;
+    if (trace_sink.kind == TRACE_SINK_RING && trace_sink.ring_written) {
+        size_t size = trace_sink.ring_size;
+        size_t start = 0;
+        size_t length = trace_sink.ring_written;
+        if (length > size) {
+            // Skip the partly overwritten oldest line
+            start = trace_sink.ring_written % size;
+            length = size;
+            while (length && trace_sink.ring[start] != '\n') {
+                start = (start + 1) % size;
+                length--;
+            }
+            if (length) {
+                start = (start + 1) % size;
+                length--;
+            }
+        }
+
+        size_t first = length < size - start ? length : size - start;
+        written += fwrite(trace_sink.ring + start, 1, first, stream);
+        written += fwrite(trace_sink.ring, 1, length - first, stream);
+    }
+    UnlockSink();
+    return written;
+}
+
+const char* TraceChannel_toString(TraceChannel channel) {
+    switch (channel) {
+        case TRACE_LEXER: return "lexer";
+        case TRACE_PARSER: return "parser";
+        case TRACE_SYMBOLS: return "symbols";
+        default: return "trace";
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Trace points compile to nothing when disabled. They follow NDEBUG, so
+// 'make release' and the benchmarks drop them; pass TRACE=1 to keep them.
+#ifndef GOSI_TRACE_ENABLED
+#ifdef NDEBUG
+#define GOSI_TRACE_ENABLED 0
+#else
+#define GOSI_TRACE_ENABLED 1
+#endif
+#endif
+
+#define TRACE_MESSAGE_SIZE 512
+#define TRACE_RING_DEFAULT_SIZE (64 * 1024)
+
+// Subsystems that emit trace messages; selected at runtime as a mask
+typedef enum TraceChannel {
+    TRACE_LEXER = 1 << 0,
+    TRACE_PARSER = 1 << 1,
+    TRACE_SYMBOLS = 1 << 2,
+    TRACE_ALL = TRACE_LEXER | TRACE_PARSER | TRACE_SYMBOLS
+} TraceChannel;
+
+// Where enabled messages go
+typedef enum TraceSinkKind {
+    TRACE_SINK_STDERR,
+    TRACE_SINK_FILE,        // Caller's stream, or a file opened by path
+    TRACE_SINK_RING         // In-memory ring, oldest lines overwritten
+} TraceSinkKind;
+
+// Enabled channels; every trace point tests this before formatting
+extern uint32_t trace_mask;
+
+// Configuration
+void Trace_enable(uint32_t channels);
+void Trace_disable(uint32_t channels);
+bool Trace_setSink(TraceSinkKind kind, FILE* stream);
+bool Trace_openFile(const char* path);
+bool Trace_setRing(size_t capacity);
+bool Trace_configureFromEnv(void);
+void Trace_shutdown(void);
+
+// Emission and ring access
+void Trace_emit(TraceChannel channel, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+size_t Trace_dumpRing(FILE* stream);
+const char* TraceChannel_toString(TraceChannel channel);
+
+static inline bool Trace_isEnabled(TraceChannel channel) {
+    return (__atomic_load_n(&trace_mask, __ATOMIC_RELAXED) & channel) != 0;
+}
+
+#if GOSI_TRACE_ENABLED
+#define TRACE(channel, ...) \
+    do { \
+        if (Trace_isEnabled(channel)) Trace_emit(channel, __VA_ARGS__); \
+    } while (0)
+#else
+#define TRACE(channel, ...) do { } while (0)
+#endif
+
+#endif // TRACE_H
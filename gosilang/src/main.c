@@ -1,6 +1,12 @@
 #include "core/tokenizer/symbols/sym_type.h"
 #include "core/tokenizer/symbols/sym_value.h"
+#include "core/parser/expr_parser.h"
+#include "core/trace/trace.h"
+#include "compiler/driver/driver.h"
+#include "runtime/debug/profiler/profiler.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 // Forward declarations of all demonstration functions
 void demonstrate_tokens(void);
@@ -41,11 +47,19 @@ void demonstrate_symbol_table(void) {
     // Create and add symbols
     SymbolTableEntry* var1 = CreateSymbol("x", TOKEN_LITERAL_INTEGER);
     SymbolTableEntry* var2 = CreateSymbol("y", TOKEN_LITERAL_FLOAT);
+    SymbolTableEntry* shadow = CreateSymbol("x", TOKEN_LITERAL_FLOAT);
 
     printf("Adding symbols to scopes...\n");
     AddSymbol(global_scope, var1);
     AddSymbol(local_scope, var2);
 
+    // Inner scopes may shadow outer declarations
+    if (AddSymbol(local_scope, shadow)) {
+        printf("Local 'x' shadows global 'x'\n");
+    } else {
+        DestroySymbol(shadow);
+    }
+
     // Demonstrate symbol lookup
     const char* symbols_to_find[] = {"x", "y", "z"};
     for (int i = 0; i < 3; i++) {
@@ -82,16 +96,19 @@ void demonstrate_expression_parsing(void) {
     }
 
     printf("\nParsing expression: a + b * c\n");
-    Token* result = ParseExpression(tokens, 5);
+    AstPool* pool = AstPool_create(0);
+    AstNodeId root = pool ? ParseExpression(tokens, 5, pool) : AST_NODE_NONE;
 
-    if (result) {
+    if (root != AST_NODE_NONE) {
         printf("Expression parsed successfully:\n");
-        Token_print(result, stdout);
+        Token_print(tokens[AstPool_node(pool, root)->token], stdout);
+        printf("\n");
+        AstPool_print(pool, root, stdout);
         printf("\n");
-        Token_destroy(result);
     } else {
         printf("Failed to parse expression\n");
     }
+    AstPool_destroy(pool);
 
     // Clean up input tokens
     for (int i = 0; i < 5; i++) {
@@ -123,6 +140,13 @@ void demonstrate_value_handling(void) {
     printf("Float value: %s\n", float_str);
     printf("String value: %s\n", str_str);
 
+    // Conversions follow C
+    if (ConvertValue(float_val, VAL_INTEGER)) {
+        char* converted = ValueToString(float_val);
+        printf("Float converted to integer: %s\n", converted);
+        free(converted);
+    }
+
     // Clean up
     free(int_str);
     free(float_str);
@@ -132,7 +156,7 @@ void demonstrate_value_handling(void) {
     DestroyLiteralValue(str_val);
 }
 
-int main(void) {
+static int run_demonstrations(void) {
     printf("Gosilang Symbol System Demonstration\n");
     printf("===================================\n\n");
 
@@ -144,3 +168,111 @@ int main(void) {
     printf("\nDemonstration complete.\n");
     return 0;
 }
+
+static void print_usage(FILE* stream) {
+    fprintf(stream,
+            "usage: gosilang [options] file...\n"
+            "       gosilang --demo\n"
+            "  -j N               threads, including this one (default: one per CPU)\n"
+            "  --max-in-flight N  files open at once (default: %d per thread)\n"
+            "  --cache DIR        reuse tokens and declarations cached in DIR\n"
+            "  --no-validate      skip AST validation\n"
+            "  --no-fold          skip constant folding\n"
+            "  -q                 no timing report\n"
+            "  --demo             run the symbol system demonstration\n"
+            "Only expression statements are compiled; declarations, definitions and\n"
+            "preprocessor directives are passed over with a note.\n"
+            "Exit status: 0 if every file compiled, 1 if one failed, 2 for a usage\n"
+            "error, including no files.\n",
+            COMPILE_IN_FLIGHT_PER_THREAD);
+}
+
+static bool parse_count(const char* text, uint32_t* count) {
+    char* end;
+    unsigned long value = text ? strtoul(text, &end, 10) : 0;
+    if (!text || !*text || *end || value > UINT32_MAX) return false;
+
+    *count = (uint32_t)value;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    // GOSILANG_TRACE=parser,symbols traces this run without a rebuild,
+    // as GOSILANG_PROFILE=timers,samples profiles it
+    Trace_configureFromEnv();
+    Profiler_configureFromEnv();
+
+    CompileOptions options = {0};
+    options.validate = true;
+    options.fold = true;
+    bool demo = false;
+    bool report = true;
+    bool options_done = false;
+    const char** files = (const char**)malloc((size_t)argc * sizeof(char*));
+    uint32_t file_count = 0;
+    if (!files) return 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool ok = true;
+        if (options_done || arg[0] != '-' || arg[1] == '\0') {
+            files[file_count++] = arg;
+        } else if (strcmp(arg, "--") == 0) {
+            options_done = true;
+        } else if (strcmp(arg, "-j") == 0) {
+            ok = parse_count(++i < argc ? argv[i] : NULL, &options.threads);
+        } else if (strncmp(arg, "-j", 2) == 0) {
+            ok = parse_count(arg + 2, &options.threads);
+        } else if (strcmp(arg, "--max-in-flight") == 0) {
+            ok = parse_count(++i < argc ? argv[i] : NULL, &options.max_in_flight);
+        } else if (strcmp(arg, "--cache") == 0) {
+            options.cache_dir = ++i < argc ? argv[i] : NULL;
+            ok = options.cache_dir != NULL;
+        } else if (strcmp(arg, "--no-validate") == 0) {
+            options.validate = false;
+        } else if (strcmp(arg, "--no-fold") == 0) {
+            options.fold = false;
+        } else if (strcmp(arg, "-q") == 0) {
+            report = false;
+        } else if (strcmp(arg, "--demo") == 0) {
+            demo = true;
+        } else if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            print_usage(stdout);
+            free(files);
+            return 0;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "gosilang: bad option '%s'\n", arg);
+            print_usage(stderr);
+            free(files);
+            return 2;
+        }
+    }
+
+    int status;
+    if (demo) {
+        status = run_demonstrations();
+    } else if (!file_count) {
+        print_usage(stderr);
+        status = 2;
+    } else {
+        CompileDriver* driver = CompileDriver_create(&options);
+        bool ok = driver && CompileDriver_run(driver, files, file_count);
+        if (driver) {
+            CompileDriver_printMessages(driver, stderr);
+            if (report) CompileDriver_printReport(driver, stdout);
+            CompileDriver_destroy(driver);
+        } else {
+            fprintf(stderr, "gosilang: cannot start the compiler\n");
+        }
+        status = ok ? 0 : 1;
+    }
+    free(files);
+
+    Profiler_shutdown();
+    Trace_dumpRing(stderr);
+    Trace_shutdown();
+    return status;
+}
@@ -0,0 +1,205 @@
+#include "future.h"
+#include <stdlib.h>
+
+// links once the future has completed
+#define LINKS_CLOSED ((FutureLink*)(uintptr_t)1)
+
+static void Complete(Future* future, FutureResult result);
+
+static void RunTask(void* data) {
+    Future* future = (Future*)data;
+    FutureResult result;
+    if (future->kind == FUTURE_KIND_THEN) {
+        Future* antecedent = future->antecedent;
+        future->antecedent = NULL;
+        result = future->continuation(antecedent->result, future->data);
+        Future_release(antecedent);
+    } else {
+        result = future->function(future->data);
+    }
+    // Drops the reference the task held while it was queued and ran
+    Complete(future, result);
+    Future_release(future);
+}
+
+static Future* Create(WorkPool* pool, FutureKind kind, uint32_t references) {
+    Future* future = (Future*)calloc(1, sizeof(Future));
+    if (!future) return NULL;
+
+    future->pool = pool;
+    future->kind = kind;
+    future->task.function = RunTask;
+    future->task.data = future;
+    WorkGroup_init(&future->done);
+    WorkGroup_add(&future->done, 1);
+    atomic_init(&future->references, references);
+    atomic_init(&future->links, NULL);
+    atomic_init(&future->remaining, 0);
+    atomic_init(&future->claimed, false);
+    future->winner = FUTURE_NO_WINNER;
+    return future;
+}
+
+// Tells link's target that antecedent has completed
+static void Fire(FutureLink* link, Future* antecedent) {
+    Future* target = link->target;
+    switch (target->kind) {
+        case FUTURE_KIND_THEN:
+            WorkPool_detach(target->pool, &target->task);
+            break;
+        case FUTURE_KIND_ALL:
+            if (!antecedent->result.ok) {
+                atomic_store_explicit(&target->claimed, true, memory_order_relaxed);
+            }
+            if (atomic_fetch_sub_explicit(&target->remaining, 1, memory_order_acq_rel) == 1) {
+                bool failed = atomic_load_explicit(&target->claimed, memory_order_relaxed);
+                Complete(target, (FutureResult){ NULL, !failed });
+                Future_release(target);
+            }
+            break;
+        case FUTURE_KIND_ANY: {
+            bool claimed = false;
+            if (atomic_compare_exchange_strong_explicit(&target->claimed, &claimed, true,
+                                                        memory_order_acq_rel, memory_order_relaxed)) {
+                target->winner = link->index;
+                Complete(target, antecedent->result);
+            }
+            // The links live in the target, which stays until all fired
+            if (atomic_fetch_sub_explicit(&target->remaining, 1, memory_order_acq_rel) == 1) {
+                Future_release(target);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Sets the result, then fires every waiting future, so that each sees
+// this one as ready. The caller holds a reference, since firing may
+// release the last one anybody else has.
+static void Complete(Future* future, FutureResult result) {
+    future->result = result;
+    FutureLink* link = atomic_exchange_explicit(&future->links, LINKS_CLOSED, memory_order_acq_rel);
+    WorkPool_done(future->pool, &future->done);
+    while (link) {
+        // Firing may free the link along with its target
+        FutureLink* next = link->next;
+        Fire(link, future);
+        link = next;
+    }
+}
+
+// Adds link to antecedent's waiters, or fires it if antecedent is done
+static void Link(Future* antecedent, FutureLink* link) {
+    FutureLink* head = atomic_load_explicit(&antecedent->links, memory_order_acquire);
+    do {
+        if (head == LINKS_CLOSED) {
+            Fire(link, antecedent);
+            return;
+        }
+        link->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&antecedent->links, &head, link,
+                                                    memory_order_release, memory_order_acquire));
+}
+
+static void Destroy(Future* future) {
+    if (future->antecedent) Future_release(future->antecedent);
+    for (uint32_t i = 0; i < future->input_count; i++) {
+        Future_release(future->inputs[i]);
+    }
+    free(future->inputs);
+    free(future->input_links);
+    free(future);
+}
+
+// Creation
+Future* Future_spawn(WorkPool* pool, FutureFunction function, void* data) {
+    // One reference for the caller, one for the task
+    Future* future = Create(pool, FUTURE_KIND_TASK, 2);
+    if (!future) return NULL;
+
+    future->function = function;
+    future->data = data;
+    WorkPool_detach(pool, &future->task);
+    return future;
+}
+
+Future* Future_then(Future* future, FutureContinuation continuation, void* data) {
+    Future* next = Create(future->pool, FUTURE_KIND_THEN, 2);
+    if (!next) return NULL;
+
+    next->continuation = continuation;
+    next->data = data;
+    next->antecedent = Future_retain(future);
+    next->link.target = next;
+    Link(future, &next->link);
+    return next;
+}
+
+// whenAll and whenAny. The target holds one reference of its own until
+// every input link has fired.
+static Future* Combine(WorkPool* pool, FutureKind kind, Future* const futures[], uint32_t count) {
+    Future* target = Create(pool, kind, count ? 2 : 1);
+    if (!target) return NULL;
+    if (count == 0) {
+        Complete(target, (FutureResult){ NULL, kind == FUTURE_KIND_ALL });
+        return target;
+    }
+
+    target->inputs = (Future**)malloc(count * sizeof(Future*));
+    target->input_links = (FutureLink*)malloc(count * sizeof(FutureLink));
+    if (!target->inputs || !target->input_links) {
+        free(target->inputs);
+        free(target->input_links);
+        free(target);
+        return NULL;
+    }
+    target->input_count = count;
+    atomic_init(&target->remaining, count);
+
+    // Every input is held before the first link can fire
+    for (uint32_t i = 0; i < count; i++) {
+        target->inputs[i] = Future_retain(futures[i]);
+        target->input_links[i].target = target;
+        target->input_links[i].index = i;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        Link(futures[i], &target->input_links[i]);
+    }
+    return target;
+}
+
+Future* Future_whenAll(WorkPool* pool, Future* const futures[], uint32_t count) {
+    return Combine(pool, FUTURE_KIND_ALL, futures, count);
+}
+
+Future* Future_whenAny(WorkPool* pool, Future* const futures[], uint32_t count) {
+    return Combine(pool, FUTURE_KIND_ANY, futures, count);
+}
+
+Future* Future_promise(WorkPool* pool) {
+    return Create(pool, FUTURE_KIND_PROMISE, 1);
+}
+
+void Future_resolve(Future* promise, FutureResult result) {
+    Complete(promise, result);
+}
+
+// Reference counting
+Future* Future_retain(Future* future) {
+    atomic_fetch_add_explicit(&future->references, 1, memory_order_relaxed);
+    return future;
+}
+
+void Future_release(Future* future) {
+    if (future && atomic_fetch_sub_explicit(&future->references, 1, memory_order_acq_rel) == 1) {
+        Destroy(future);
+    }
+}
+
+// Waiting
+FutureResult Future_wait(Future* future) {
+    WorkPool_wait(future->pool, &future->done);
+    return future->result;
+}
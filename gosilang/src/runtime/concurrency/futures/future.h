@@ -0,0 +1,122 @@
+#ifndef FUTURE_H
+#define FUTURE_H
+
+#include "runtime/concurrency/pool/work_pool.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Future_winner of a future that is not a finished Future_whenAny
+#define FUTURE_NO_WINNER UINT32_MAX
+
+// What a future completes with: a value and whether it succeeded. A
+// failed result's value is whatever the producer uses to say why.
+typedef struct FutureResult {
+    void* value;
+    bool ok;
+} FutureResult;
+
+static inline FutureResult FutureResult_ok(void* value) {
+    return (FutureResult){ value, true };
+}
+
+static inline FutureResult FutureResult_error(void* value) {
+    return (FutureResult){ value, false };
+}
+
+typedef FutureResult (*FutureFunction)(void* data);
+// Runs once its input has completed, whether or not that succeeded
+typedef FutureResult (*FutureContinuation)(FutureResult input, void* data);
+
+typedef enum FutureKind {
+    FUTURE_KIND_PROMISE,
+    FUTURE_KIND_TASK,
+    FUTURE_KIND_THEN,
+    FUTURE_KIND_ALL,
+    FUTURE_KIND_ANY
+} FutureKind;
+
+typedef struct Future Future;
+
+// A future waiting on another one, as a node in that one's links
+typedef struct FutureLink {
+    Future* target;
+    struct FutureLink* next;
+    uint32_t index;             // Position among the target's inputs
+} FutureLink;
+
+// A result that becomes available once, computed by a task on a
+// WorkPool, by a continuation of another future, from a set of futures,
+// or set by hand as a promise.
+//
+// Futures that wait on this one are linked into links with a CAS. On
+// completion the list is swapped for a closed marker, so each waiter is
+// either taken from the list or sees the marker and starts at once.
+// Continuations run as detached pool tasks; nothing on the way from
+// spawn to completion takes a lock unless a pool thread is asleep.
+//
+// Futures are reference counted. Every function returning one gives
+// the caller a reference to release; the runtime holds its own for as
+// long as it needs the future, so a future may be released at any time.
+struct Future {
+    WorkTask task;              // Runs the function or continuation
+    WorkPool* pool;
+    WorkGroup done;             // One pending unit until completion
+    atomic_uint references;
+    _Atomic(FutureLink*) links; // Waiting futures, newest first
+    FutureResult result;        // Set before completion
+    FutureKind kind;
+
+    union {
+        FutureFunction function;
+        FutureContinuation continuation;
+    };
+    void* data;
+    Future* antecedent;         // THEN: input until the continuation runs
+    FutureLink link;            // THEN: entry in the antecedent's links
+
+    Future** inputs;            // ALL, ANY
+    FutureLink* input_links;
+    uint32_t input_count;
+    atomic_uint remaining;      // Input links not yet fired
+    atomic_bool claimed;        // ALL: an input failed; ANY: an input won
+    uint32_t winner;            // ANY: index of the input that won
+};
+
+// Runs function(data) on pool and completes with what it returns
+Future* Future_spawn(WorkPool* pool, FutureFunction function, void* data);
+
+// Completes with continuation(result of future, data), run on the
+// future's pool once future has completed
+Future* Future_then(Future* future, FutureContinuation continuation, void* data);
+
+// Completes once every one of futures has, succeeding if all of them
+// did; the value is NULL and each input keeps its own result. No inputs
+// complete at once.
+Future* Future_whenAll(WorkPool* pool, Future* const futures[], uint32_t count);
+
+// Completes with the result of the first of futures to complete, whose
+// index Future_winner gives. No inputs complete at once, failed.
+Future* Future_whenAny(WorkPool* pool, Future* const futures[], uint32_t count);
+
+// A future completed by Future_resolve, exactly once
+Future* Future_promise(WorkPool* pool);
+void Future_resolve(Future* promise, FutureResult result);
+
+// Reference counting
+Future* Future_retain(Future* future);
+void Future_release(Future* future);
+
+// Waits for the result, running pool tasks meanwhile; may be called
+// from inside a task
+FutureResult Future_wait(Future* future);
+
+static inline bool Future_isReady(Future* future) {
+    return WorkGroup_pending(&future->done) == 0;
+}
+
+static inline uint32_t Future_winner(Future* future) {
+    return Future_isReady(future) ? future->winner : FUTURE_NO_WINNER;
+}
+
+#endif // FUTURE_H
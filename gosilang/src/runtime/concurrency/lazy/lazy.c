@@ -0,0 +1,73 @@
+#include "lazy.h"
+#include <limits.h>
+#include <stddef.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <sched.h>
+#endif
+
+// Parking. FUTEX_WAIT returns at once if the word no longer holds
+// expected, so a wake between the caller's check and the wait is not
+// lost; spurious returns are fine, since callers reload the state.
+static void Park(atomic_uint* word, unsigned expected) {
+#ifdef __linux__
+    syscall(SYS_futex, (unsigned*)word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#else
+    if (atomic_load_explicit(word, memory_order_relaxed) == expected) sched_yield();
+#endif
+}
+
+static void WakeAll(atomic_uint* word) {
+#ifdef __linux__
+    syscall(SYS_futex, (unsigned*)word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    (void)word;
+#endif
+}
+
+void Lazy_init(Lazy* lazy, LazyFunction function, void* data) {
+    atomic_init(&lazy->state, LAZY_UNINITIALIZED);
+    lazy->value = NULL;
+    lazy->function = function;
+    lazy->data = data;
+}
+
+bool Lazy_force(Lazy* lazy, void** value) {
+    unsigned state = atomic_load_explicit(&lazy->state, memory_order_acquire);
+    for (;;) {
+        if (state == LAZY_READY) {
+            *value = lazy->value;
+            return true;
+        }
+
+        if (state == LAZY_UNINITIALIZED) {
+            if (!atomic_compare_exchange_weak_explicit(&lazy->state, &state, LAZY_RUNNING,
+                                                       memory_order_acquire, memory_order_acquire)) {
+                continue;
+            }
+            void* result = NULL;
+            bool ok = lazy->function(lazy->data, &result);
+            if (ok) lazy->value = result;
+
+            // Publishes the value; only a parked thread needs the syscall
+            unsigned previous = atomic_exchange_explicit(&lazy->state, ok ? LAZY_READY : LAZY_UNINITIALIZED,
+                                                         memory_order_release);
+            if (previous == LAZY_WAITING) WakeAll(&lazy->state);
+            if (ok) *value = result;
+            return ok;
+        }
+
+        // Running elsewhere: mark the word as waited on, then park
+        if (state == LAZY_RUNNING &&
+            !atomic_compare_exchange_weak_explicit(&lazy->state, &state, LAZY_WAITING,
+                                                   memory_order_acquire, memory_order_acquire)) {
+            continue;
+        }
+        Park(&lazy->state, LAZY_WAITING);
+        state = atomic_load_explicit(&lazy->state, memory_order_acquire);
+    }
+}
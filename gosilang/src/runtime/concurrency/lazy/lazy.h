@@ -0,0 +1,54 @@
+#ifndef LAZY_H
+#define LAZY_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Lazy states. WAITING is RUNNING with at least one thread parked on
+// the state word, which the running thread wakes when it finishes.
+#define LAZY_UNINITIALIZED 0u
+#define LAZY_RUNNING 1u
+#define LAZY_WAITING 2u
+#define LAZY_READY 3u
+
+// Computes the value into *value; false if it could not
+typedef bool (*LazyFunction)(void* data, void** value);
+
+// A value computed on first use, at most once. The first thread to
+// find it uninitialised moves the state word to RUNNING with a CAS and
+// runs the function; threads arriving meanwhile park on the state word
+// with a futex until it leaves RUNNING. Once READY a read is a single
+// acquire load, with no lock or read-modify-write.
+//
+// A function that fails leaves the lazy uninitialised, so the next
+// access, including one of the threads that waited, runs it again. The
+// function must not force its own lazy.
+typedef struct Lazy {
+    atomic_uint state;
+    void* value;
+    LazyFunction function;
+    void* data;
+} Lazy;
+
+// Static initialiser, for lazies with static storage
+#define LAZY_INIT(function, data) { LAZY_UNINITIALIZED, NULL, (function), (data) }
+
+void Lazy_init(Lazy* lazy, LazyFunction function, void* data);
+
+// Slow path of Lazy_get: runs the function or waits for it
+bool Lazy_force(Lazy* lazy, void** value);
+
+// The value, computing it on first use; false if the function failed
+static inline bool Lazy_get(Lazy* lazy, void** value) {
+    if (atomic_load_explicit(&lazy->state, memory_order_acquire) == LAZY_READY) {
+        *value = lazy->value;
+        return true;
+    }
+    return Lazy_force(lazy, value);
+}
+
+static inline bool Lazy_isReady(Lazy* lazy) {
+    return atomic_load_explicit(&lazy->state, memory_order_acquire) == LAZY_READY;
+}
+
+#endif // LAZY_H
@@ -0,0 +1,390 @@
+#include "work_pool.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+// The worker running on this thread, NULL outside any pool
+static _Thread_local WorkWorker* current_worker;
+
+// Deques
+
+static WorkDequeArray* CreateArray(int64_t capacity) {
+    WorkDequeArray* array = (WorkDequeArray*)malloc(sizeof(WorkDequeArray) +
+                                                    (size_t)capacity * sizeof(WorkTask*));
+    if (!array) return NULL;
+    array->capacity = capacity;
+    array->previous = NULL;
+    return array;
+}
+
+bool WorkDeque_init(WorkDeque* deque, int64_t capacity) {
+    int64_t rounded = 1;
+    while (rounded < capacity) rounded *= 2;
+
+    WorkDequeArray* array = CreateArray(rounded);
+    if (!array) return false;
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    atomic_init(&deque->array, array);
+    return true;
+}
+
+void WorkDeque_destroy(WorkDeque* deque) {
+    WorkDequeArray* array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+    while (array) {
+        WorkDequeArray* previous = array->previous;
+        free(array);
+        array = previous;
+    }
+    atomic_store_explicit(&deque->array, NULL, memory_order_relaxed);
+}
+
+static inline WorkTask* Slot(WorkDequeArray* array, int64_t index) {
+    return atomic_load_explicit(&array->slots[index & (array->capacity - 1)], memory_order_relaxed);
+}
+
+static inline void SetSlot(WorkDequeArray* array, int64_t index, WorkTask* task) {
+    atomic_store_explicit(&array->slots[index & (array->capacity - 1)], task, memory_order_relaxed);
+}
+
+// Owner only: copies the live range [top, bottom) into twice the room
+static WorkDequeArray* Grow(WorkDeque* deque, WorkDequeArray* array, int64_t top, int64_t bottom) {
+    WorkDequeArray* grown = CreateArray(array->capacity * 2);
+    if (!grown) return NULL;
+
+    for (int64_t i = top; i < bottom; i++) {
+        SetSlot(grown, i, Slot(array, i));
+    }
+    grown->previous = array;
+    atomic_store_explicit(&deque->array, grown, memory_order_release);
+    return grown;
+}
+
+bool WorkDeque_push(WorkDeque* deque, WorkTask* task) {
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    WorkDequeArray* array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+
+    if (bottom - top > array->capacity - 1) {
+        array = Grow(deque, array, top, bottom);
+        if (!array) return false;
+    }
+    // Publishes the task, and what its submitter wrote, to thieves
+    SetSlot(array, bottom, task);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+    return true;
+}
+
+// Takes the newest task. Only the last task can race with a thief,
+// which is settled by a CAS on top.
+WorkTask* WorkDeque_pop(WorkDeque* deque) {
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    WorkDequeArray* array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    WorkTask* task = Slot(array, bottom);
+    if (top == bottom) {
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed)) {
+            task = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+// Takes the oldest task; NULL if the deque is empty or another thread won it
+WorkTask* WorkDeque_steal(WorkDeque* deque) {
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) return NULL;
+
+    WorkDequeArray* array = atomic_load_explicit(&deque->array, memory_order_acquire);
+    WorkTask* task = Slot(array, top);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return task;
+}
+
+// Scheduling
+
+static void Wake(WorkPool* pool, bool everyone) {
+    pthread_mutex_lock(&pool->sleep_lock);
+    if (everyone) {
+        pthread_cond_broadcast(&pool->wake);
+    } else {
+        pthread_cond_signal(&pool->wake);
+    }
+    pthread_mutex_unlock(&pool->sleep_lock);
+}
+
+// Pushes the chain first..last on the injection stack. Only whole
+// stacks are ever taken off it, so a push cannot suffer ABA.
+static void Inject(WorkPool* pool, WorkTask* first, WorkTask* last) {
+    WorkTask* head = atomic_load_explicit(&pool->injected, memory_order_relaxed);
+    do {
+        last->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&pool->injected, &head, first,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+// Takes the whole injection stack. A worker runs its oldest task and
+// moves the rest to its deque, where other workers can steal it. An
+// outside thread has no deque: it runs the newest task and puts the
+// rest back, in one CAS unless more was pushed meanwhile.
+static WorkTask* TakeInjected(WorkPool* pool, WorkWorker* worker) {
+    if (!atomic_load_explicit(&pool->injected, memory_order_relaxed)) return NULL;
+    WorkTask* task = atomic_exchange_explicit(&pool->injected, NULL, memory_order_acquire);
+    if (!task || !task->next) return task;
+
+    WorkTask* rest = NULL;
+    WorkTask* rest_tail = NULL;
+    if (!worker) {
+        rest = task->next;
+        WorkTask* empty = NULL;
+        if (atomic_compare_exchange_strong_explicit(&pool->injected, &empty, rest,
+                                                    memory_order_release, memory_order_relaxed)) {
+            return task;
+        }
+        for (rest_tail = rest; rest_tail->next; rest_tail = rest_tail->next) {}
+        Inject(pool, rest, rest_tail);
+        return task;
+    }
+
+    // Newest first, which is the order that leaves the oldest on the
+    // bottom of the deque, where its owner pops next. Tasks the deque
+    // has no room for go back on the stack.
+    while (task->next) {
+        WorkTask* next = task->next;
+        if (!WorkDeque_push(&worker->deque, task)) {
+            task->next = NULL;
+            if (rest_tail) {
+                rest_tail->next = task;
+            } else {
+                rest = task;
+            }
+            rest_tail = task;
+        }
+        task = next;
+    }
+    if (rest) Inject(pool, rest, rest_tail);
+    return task;
+}
+
+// Next task for worker, or for an outside thread if worker is NULL:
+// its own deque first, then the injection stack, then the other deques
+static WorkTask* FindTask(WorkPool* pool, WorkWorker* worker) {
+    WorkTask* task = worker ? WorkDeque_pop(&worker->deque) : NULL;
+    if (!task) task = TakeInjected(pool, worker);
+
+    uint32_t start = worker ? worker->victim : 0;
+    for (uint32_t i = 0; !task && i < pool->worker_count; i++) {
+        uint32_t victim = (start + i) % pool->worker_count;
+        if (worker && victim == worker->index) continue;
+
+        task = WorkDeque_steal(&pool->workers[victim].deque);
+        if (task && worker) worker->victim = victim;
+    }
+    if (task) atomic_fetch_sub_explicit(&pool->queued, 1, memory_order_relaxed);
+    return task;
+}
+
+// Takes the last unit of a group a waiter sleeps on. Under the lock
+// that waiter cannot be between its check of pending and its wait, and
+// it cannot return before the count reaches zero here, so the pool
+// outlives the broadcast.
+static void FinishLast(WorkPool* pool, WorkGroup* group) {
+    pthread_mutex_lock(&pool->sleep_lock);
+    unsigned pending = atomic_load_explicit(&group->pending, memory_order_relaxed);
+    unsigned left;
+    do {
+        // Work may have been added since the caller looked
+        left = (pending & ~WORK_GROUP_SLEEPER) - 1;
+    } while (!atomic_compare_exchange_weak_explicit(&group->pending, &pending,
+                                                    left ? left | WORK_GROUP_SLEEPER : 0,
+                                                    memory_order_acq_rel, memory_order_relaxed));
+    if (!left) pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->sleep_lock);
+}
+
+// Finishes a unit of group. Whether a waiter sleeps is read in the same
+// word as the count, before the decrement: a waiter that is not asleep
+// may return and destroy the pool as soon as the count reaches zero, so
+// a finish that decrements on its own never touches the pool after.
+static void Finish(WorkPool* pool, WorkGroup* group) {
+    unsigned pending = atomic_load_explicit(&group->pending, memory_order_relaxed);
+    for (;;) {
+        if (pending == (WORK_GROUP_SLEEPER | 1)) {
+            FinishLast(pool, group);
+            return;
+        }
+        if (atomic_compare_exchange_weak_explicit(&group->pending, &pending, pending - 1,
+                                                  memory_order_acq_rel, memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+static void Run(WorkPool* pool, WorkTask* task) {
+    // The task may be reused or freed once its function returns
+    WorkGroup* group = task->group;
+    task->function(task->data);
+    Finish(pool, group);
+}
+
+// Sleeps until work is queued, group (if any) finishes or the pool
+// stops. sleepers is raised before queued is read, and submitters
+// change queued before reading sleepers, so one of them sees the other.
+// A group is marked in its own count, which Finish reads atomically
+// with its decrement.
+static void Sleep(WorkPool* pool, WorkGroup* group) {
+    pthread_mutex_lock(&pool->sleep_lock);
+    atomic_fetch_add(&pool->sleepers, 1);
+    if (group) atomic_fetch_or(&group->pending, WORK_GROUP_SLEEPER);
+    while (!pool->stopping && !atomic_load(&pool->queued) && (!group || WorkGroup_pending(group))) {
+        pthread_cond_wait(&pool->wake, &pool->sleep_lock);
+    }
+    atomic_fetch_sub(&pool->sleepers, 1);
+    // A finished group drops the mark, so reusing it does not lock
+    if (group) {
+        unsigned finished = WORK_GROUP_SLEEPER;
+        atomic_compare_exchange_strong(&group->pending, &finished, 0);
+    }
+    pthread_mutex_unlock(&pool->sleep_lock);
+}
+
+static void* WorkerMain(void* argument) {
+    WorkWorker* worker = (WorkWorker*)argument;
+    WorkPool* pool = worker->pool;
+    current_worker = worker;
+
+    for (;;) {
+        WorkTask* task = FindTask(pool, worker);
+        if (task) {
+            Run(pool, task);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->sleep_lock);
+        bool stopping = pool->stopping;
+        pthread_mutex_unlock(&pool->sleep_lock);
+        if (stopping) break;
+        Sleep(pool, NULL);
+    }
+    current_worker = NULL;
+    return NULL;
+}
+
+// Pool lifetime
+WorkPool* WorkPool_create(uint32_t threads) {
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (uint32_t)online : 1;
+    }
+
+    WorkPool* pool = (WorkPool*)calloc(1, sizeof(WorkPool));
+    if (!pool) return NULL;
+
+    pool->workers = (WorkWorker*)calloc(threads, sizeof(WorkWorker));
+    if (!pool->workers) {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->sleep_lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    atomic_init(&pool->injected, NULL);
+    WorkGroup_init(&pool->detached);
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->sleepers, 0);
+
+    // Deques exist before any thread starts, since every worker steals
+    // from all of them
+    for (uint32_t i = 0; i + 1 < threads; i++) {
+        WorkWorker* worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->index = i;
+        worker->victim = i + 1;
+        if (!WorkDeque_init(&worker->deque, WORK_DEQUE_INITIAL_CAPACITY)) break;
+        pool->worker_count++;
+    }
+    uint32_t started = 0;
+    while (started < pool->worker_count &&
+           pthread_create(&pool->workers[started].thread, NULL, WorkerMain, &pool->workers[started]) == 0) {
+        started++;
+    }
+
+    // A pool short of threads still works, with fewer of them
+    if (started < pool->worker_count) {
+        for (uint32_t i = started; i < pool->worker_count; i++) {
+            WorkDeque_destroy(&pool->workers[i].deque);
+        }
+        pool->worker_count = started;
+    }
+    return pool;
+}
+
+void WorkPool_destroy(WorkPool* pool) {
+    if (!pool) return;
+
+    WorkPool_wait(pool, &pool->detached);
+    pthread_mutex_lock(&pool->sleep_lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->sleep_lock);
+
+    for (uint32_t i = 0; i < pool->worker_count; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+        WorkDeque_destroy(&pool->workers[i].deque);
+    }
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->sleep_lock);
+    free(pool->workers);
+    free(pool);
+}
+
+uint32_t WorkPool_threadCount(const WorkPool* pool) {
+    return pool ? pool->worker_count + 1 : 0;
+}
+
+// Submission
+void WorkPool_submit(WorkPool* pool, WorkGroup* group, WorkTask* task) {
+    task->group = group;
+    task->next = NULL;
+    atomic_fetch_add_explicit(&group->pending, 1, memory_order_relaxed);
+
+    // Counted before it can be taken, so queued never drops below zero
+    atomic_fetch_add(&pool->queued, 1);
+    WorkWorker* worker = current_worker;
+    if (!worker || worker->pool != pool || !WorkDeque_push(&worker->deque, task)) {
+        Inject(pool, task, task);
+    }
+    if (atomic_load(&pool->sleepers)) Wake(pool, false);
+}
+
+void WorkPool_done(WorkPool* pool, WorkGroup* group) {
+    Finish(pool, group);
+}
+
+// The waiting thread helps rather than blocking while tasks are queued.
+// A worker that waits keeps running its own tasks first.
+void WorkPool_wait(WorkPool* pool, WorkGroup* group) {
+    WorkWorker* worker = current_worker && current_worker->pool == pool ? current_worker : NULL;
+
+    while (WorkGroup_pending(group)) {
+        WorkTask* task = FindTask(pool, worker);
+        if (task) {
+            Run(pool, task);
+        } else {
+            Sleep(pool, group);
+        }
+    }
+}
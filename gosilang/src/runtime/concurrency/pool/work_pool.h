@@ -0,0 +1,135 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define WORK_DEQUE_INITIAL_CAPACITY 256
+// Bit of WorkGroup.pending set by a thread sleeping until the group finishes
+#define WORK_GROUP_SLEEPER 0x80000000u
+
+typedef void (*WorkFunction)(void* data);
+
+// Tasks that are waited for together. pending counts tasks submitted
+// to the group and not yet finished, below WORK_GROUP_SLEEPER. A waiter
+// sets that bit before it sleeps, so the finish that reads it with the
+// last unit wakes the waiter, and every other finish touches only the
+// group: once the count reaches zero the waiter may free the pool.
+typedef struct WorkGroup {
+    atomic_uint pending;
+} WorkGroup;
+
+// A unit of work. Tasks are owned by the submitter and must stay valid
+// until their group has been waited for; the pool never allocates them.
+typedef struct WorkTask {
+    WorkFunction function;
+    void* data;
+    WorkGroup* group;
+    struct WorkTask* next;      // Injection stack link
+} WorkTask;
+
+// Slots of a Chase-Lev deque. Grown arrays stay alive, linked through
+// previous, until the deque is destroyed, since a thief may still be
+// reading from one.
+typedef struct WorkDequeArray {
+    int64_t capacity;           // A power of two
+    struct WorkDequeArray* previous;
+    _Atomic(WorkTask*) slots[];
+} WorkDequeArray;
+
+// Chase-Lev work-stealing deque: its owner pushes and pops at the
+// bottom, other threads steal from the top
+typedef struct WorkDeque {
+    atomic_int_fast64_t top;
+    atomic_int_fast64_t bottom;
+    _Atomic(WorkDequeArray*) array;
+} WorkDeque;
+
+typedef struct WorkPool WorkPool;
+
+typedef struct WorkWorker {
+    WorkPool* pool;
+    uint32_t index;
+    uint32_t victim;            // Next worker to steal from
+    WorkDeque deque;
+    pthread_t thread;
+} WorkWorker;
+
+// Worker threads run tasks from their own deque newest first and, when
+// it is empty, take from the injection stack or steal the oldest task
+// of another worker. A task submitted from a worker goes to that
+// worker's deque; other threads push it on the injection stack, which
+// the next thread looking for work takes whole, moving the rest of it
+// to its deque. Neither path takes a lock unless a thread is asleep.
+// Idle workers sleep until work is queued.
+struct WorkPool {
+    WorkWorker* workers;
+    uint32_t worker_count;
+
+    _Atomic(WorkTask*) injected; // Newest first
+
+    WorkGroup detached;         // Tasks nobody waits for, see WorkPool_detach
+    atomic_uint queued;         // Tasks submitted and not yet taken
+    atomic_uint sleepers;
+    pthread_mutex_t sleep_lock;
+    pthread_cond_t wake;
+    bool stopping;
+};
+
+// Pool lifetime. threads counts the thread that waits on groups, which
+// runs tasks too, so threads - 1 workers are started; 0 means one
+// thread per online CPU. Groups must be waited for before destroying;
+// detached tasks are waited for by WorkPool_destroy.
+WorkPool* WorkPool_create(uint32_t threads);
+void WorkPool_destroy(WorkPool* pool);
+
+// Threads that run tasks, including the waiting thread
+uint32_t WorkPool_threadCount(const WorkPool* pool);
+
+static inline void WorkTask_init(WorkTask* task, WorkFunction function, void* data) {
+    task->function = function;
+    task->data = data;
+    task->group = NULL;
+    task->next = NULL;
+}
+
+static inline void WorkGroup_init(WorkGroup* group) {
+    atomic_init(&group->pending, 0);
+}
+
+// Tasks and units of group not yet finished
+static inline uint32_t WorkGroup_pending(WorkGroup* group) {
+    return atomic_load_explicit(&group->pending, memory_order_acquire) & ~WORK_GROUP_SLEEPER;
+}
+
+// Counts work of group that is not a submitted task, such as a result
+// another task will produce; each unit is finished by WorkPool_done
+static inline void WorkGroup_add(WorkGroup* group, uint32_t count) {
+    atomic_fetch_add_explicit(&group->pending, count, memory_order_relaxed);
+}
+
+// Queues task as part of group; may be called from inside a task
+void WorkPool_submit(WorkPool* pool, WorkGroup* group, WorkTask* task);
+
+// Queues a task no caller waits for. The task must stay valid until it
+// has run, and may free itself from its function.
+static inline void WorkPool_detach(WorkPool* pool, WorkTask* task) {
+    WorkPool_submit(pool, &pool->detached, task);
+}
+
+// Finishes one unit counted by WorkGroup_add
+void WorkPool_done(WorkPool* pool, WorkGroup* group);
+
+// Runs queued tasks until every task of group has finished
+void WorkPool_wait(WorkPool* pool, WorkGroup* group);
+
+// Deque operations; push and pop only from the owning thread
+bool WorkDeque_init(WorkDeque* deque, int64_t capacity);
+void WorkDeque_destroy(WorkDeque* deque);
+bool WorkDeque_push(WorkDeque* deque, WorkTask* task);
+WorkTask* WorkDeque_pop(WorkDeque* deque);
+WorkTask* WorkDeque_steal(WorkDeque* deque);
+
+#endif // WORK_POOL_H
@@ -0,0 +1,453 @@
+#define _GNU_SOURCE
+#include "profiler.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <ucontext.h>
+
+// How far above the interrupted stack pointer a frame may lie
+#define PROFILE_STACK_SPAN (1u << 20)
+#define PROFILE_DEFAULT_OUT "gosilang.folded"
+
+bool profiler_timing = false;
+
+static const char* const profile_timer_names[PROFILE_TIMER_COUNT] = {
+#define X(timer, name) [timer] = name,
+    PROFILE_TIMER_LIST(X)
+#undef X
+};
+
+static const char* const profile_counter_names[PROFILE_COUNTER_COUNT] = {
+#define X(counter, name) [counter] = name,
+    PROFILE_COUNTER_LIST(X)
+#undef X
+};
+
+// One thread's timers and counters. Only its thread writes them, with
+// relaxed stores so readers summing them see whole values.
+typedef struct ProfileThread {
+    uint64_t timer_ns[PROFILE_TIMER_COUNT];
+    uint64_t timer_calls[PROFILE_TIMER_COUNT];
+    uint64_t counters[PROFILE_COUNTER_COUNT];
+    struct ProfileThread* next;
+} ProfileThread;
+
+static _Thread_local ProfileThread* profile_thread;
+static ProfileThread* profile_threads;  // Every block, kept for the process's life
+
+// Sample ring, written by the SIGPROF handler on any thread and read by
+// one thread at a time. head and tail count words ever reserved and
+// consumed; a slot is zero until its sample's header is stored.
+static struct {
+    uintptr_t* words;
+    size_t mask;
+    uint64_t head;
+    uint64_t tail;
+    uint64_t samples;
+    uint64_t dropped;
+    uint32_t active;        // Handlers running
+    bool sampling;
+    bool installed;
+} profile_ring;
+
+// What GOSILANG_PROFILE asked Profiler_shutdown to write
+static struct {
+    bool timers;
+    bool samples;
+    char* out;
+} profile_env;
+
+const char* ProfileTimer_toString(ProfileTimer timer) {
+    return (unsigned)timer < PROFILE_TIMER_COUNT ? profile_timer_names[timer] : "unknown";
+}
+
+const char* ProfileCounter_toString(ProfileCounter counter) {
+    return (unsigned)counter < PROFILE_COUNTER_COUNT ? profile_counter_names[counter] : "unknown";
+}
+
+// Timers and counters
+void Profiler_setTiming(bool enabled) {
+    __atomic_store_n(&profiler_timing, enabled, __ATOMIC_RELAXED);
+}
+
+uint64_t Profiler_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// This thread's block, created and published on first use
+static ProfileThread* ThreadBlock(void) {
+    ProfileThread* block = profile_thread;
+    if (block) return block;
+
+    block = (ProfileThread*)calloc(1, sizeof(ProfileThread));
+    if (!block) return NULL;
+    block->next = __atomic_load_n(&profile_threads, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&profile_threads, &block->next, block, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    profile_thread = block;
+    return block;
+}
+
+static inline void Add(uint64_t* slot, uint64_t amount) {
+    __atomic_store_n(slot, *slot + amount, __ATOMIC_RELAXED);
+}
+
+void Profiler_addTime(ProfileTimer timer, uint64_t ns) {
+    ProfileThread* block = ThreadBlock();
+    if (!block || (unsigned)timer >= PROFILE_TIMER_COUNT) return;
+    Add(&block->timer_ns[timer], ns);
+    Add(&block->timer_calls[timer], 1);
+}
+
+void Profiler_addCount(ProfileCounter counter, uint64_t count) {
+    ProfileThread* block = ThreadBlock();
+    if (!block || (unsigned)counter >= PROFILE_COUNTER_COUNT) return;
+    Add(&block->counters[counter], count);
+}
+
+void Profiler_totals(ProfileTotals* totals) {
+    memset(totals, 0, sizeof(*totals));
+    for (ProfileThread* block = __atomic_load_n(&profile_threads, __ATOMIC_ACQUIRE); block; block = block->next) {
+        for (int t = 0; t < PROFILE_TIMER_COUNT; t++) {
+            totals->timer_ns[t] += __atomic_load_n(&block->timer_ns[t], __ATOMIC_RELAXED);
+            totals->timer_calls[t] += __atomic_load_n(&block->timer_calls[t], __ATOMIC_RELAXED);
+        }
+        for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+            totals->counters[c] += __atomic_load_n(&block->counters[c], __ATOMIC_RELAXED);
+        }
+        totals->threads++;
+    }
+}
+
+void Profiler_writeReport(FILE* stream) {
+    if (!stream) return;
+
+    ProfileTotals totals;
+    Profiler_totals(&totals);
+    fprintf(stream, "profile: %u threads recorded\n", totals.threads);
+    for (int t = 0; t < PROFILE_TIMER_COUNT; t++) {
+        fprintf(stream, "  %-10s %10.2f ms  %10llu calls\n", profile_timer_names[t],
+                (double)totals.timer_ns[t] / 1e6, (unsigned long long)totals.timer_calls[t]);
+    }
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+        fprintf(stream, "  %-10s %13llu\n", profile_counter_names[c], (unsigned long long)totals.counters[c]);
+    }
+    if (profile_ring.words) {
+        fprintf(stream, "  %llu samples, %llu dropped\n", (unsigned long long)Profiler_samples(),
+                (unsigned long long)Profiler_dropped());
+    }
+}
+
+// Sampling
+
+// The interrupted thread's pc, frame pointer and stack pointer
+static bool InterruptedFrame(void* context, uintptr_t* pc, uintptr_t* fp, uintptr_t* sp) {
+#if defined(__x86_64__)
+    const greg_t* registers = ((ucontext_t*)context)->uc_mcontext.gregs;
+    *pc = (uintptr_t)registers[REG_RIP];
+    *fp = (uintptr_t)registers[REG_RBP];
+    *sp = (uintptr_t)registers[REG_RSP];
+    return true;
+#elif defined(__aarch64__)
+    const mcontext_t* registers = &((ucontext_t*)context)->uc_mcontext;
+    *pc = (uintptr_t)registers->pc;
+    *fp = (uintptr_t)registers->regs[29];
+    *sp = (uintptr_t)registers->sp;
+    return true;
+#else
+    (void)context;
+    (void)pc;
+    (void)fp;
+    (void)sp;
+    return false;
+#endif
+}
+
+// Walks the frame pointer chain out from the interrupted frame. Each
+// frame holds its caller's frame pointer and then its return address,
+// on x86-64 and AArch64 alike. A frame must lie above the previous one,
+// within PROFILE_STACK_SPAN of the stack pointer and on a 16-byte
+// boundary, which stops the walk at the outermost frame (a zero frame
+// pointer) or at a register that code built without frame pointers
+// reused. Plain loads only, so it is async-signal-safe.
+__attribute__((no_sanitize_address))
+static uint32_t WalkFrames(void* context, uintptr_t* frames) {
+    uintptr_t pc, fp, sp;
+    if (!InterruptedFrame(context, &pc, &fp, &sp) || !pc) return 0;
+
+    uint32_t depth = 0;
+    frames[depth++] = pc;
+    uintptr_t limit = sp + PROFILE_STACK_SPAN < sp ? UINTPTR_MAX : sp + PROFILE_STACK_SPAN;
+    while (depth < PROFILER_MAX_DEPTH && fp >= sp && fp < limit - 2 * sizeof(uintptr_t) && fp % 16 == 0) {
+        const uintptr_t* frame = (const uintptr_t*)fp;
+        uintptr_t caller = frame[0];
+        uintptr_t return_address = frame[1];
+        if (!return_address) break;
+        frames[depth++] = return_address;
+        if (caller <= fp) break;
+        fp = caller;
+    }
+    return depth;
+}
+
+// Records the interrupted thread's stack, from the interrupted frame
+// out. Runs in the signal handler: no locks, no allocation.
+static void Capture(void* context) {
+    uintptr_t frames[PROFILER_MAX_DEPTH];
+    uint64_t count = WalkFrames(context, frames);
+    if (count == 0) return;
+
+    uint64_t head = __atomic_load_n(&profile_ring.head, __ATOMIC_RELAXED);
+    do {
+        uint64_t tail = __atomic_load_n(&profile_ring.tail, __ATOMIC_ACQUIRE);
+        if (head + count + 1 - tail > profile_ring.mask + 1) {
+            __atomic_add_fetch(&profile_ring.dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&profile_ring.head, &head, head + count + 1, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    for (uint64_t i = 0; i < count; i++) {
+        __atomic_store_n(&profile_ring.words[(head + 1 + i) & profile_ring.mask], frames[i], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&profile_ring.words[head & profile_ring.mask], (uintptr_t)(count << 1) | 1,
+                     __ATOMIC_RELEASE);
+    __atomic_add_fetch(&profile_ring.samples, 1, __ATOMIC_RELAXED);
+}
+
+// Stays installed once sampling has started, since a SIGPROF already
+// pending when the timer stops must not reach the default action
+static void OnProfileSignal(int signal, siginfo_t* info, void* context) {
+    (void)signal;
+    (void)info;
+    int saved_errno = errno;
+    __atomic_add_fetch(&profile_ring.active, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&profile_ring.sampling, __ATOMIC_SEQ_CST)) Capture(context);
+    __atomic_sub_fetch(&profile_ring.active, 1, __ATOMIC_RELEASE);
+    errno = saved_errno;
+}
+
+static bool SetTimer(uint32_t hz) {
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    if (hz) {
+        timer.it_interval.tv_usec = hz > 1000000 ? 1 : 1000000 / hz;
+        timer.it_value = timer.it_interval;
+    }
+    return setitimer(ITIMER_PROF, &timer, NULL) == 0;
+}
+
+bool Profiler_startSampling(uint32_t hz, size_t ring_words) {
+    if (__atomic_load_n(&profile_ring.sampling, __ATOMIC_RELAXED)) return false;
+
+    // A ring left from an earlier run keeps its samples and its size
+    if (!profile_ring.words) {
+        size_t words = 2;
+        size_t wanted = ring_words ? ring_words : PROFILER_RING_DEFAULT_WORDS;
+        while (words < wanted) words *= 2;
+        profile_ring.words = (uintptr_t*)calloc(words, sizeof(uintptr_t));
+        if (!profile_ring.words) return false;
+        profile_ring.mask = words - 1;
+    }
+
+    if (!profile_ring.installed) {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = OnProfileSignal;
+        action.sa_flags = SA_RESTART | SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGPROF, &action, NULL) != 0) return false;
+        profile_ring.installed = true;
+    }
+
+    __atomic_store_n(&profile_ring.sampling, true, __ATOMIC_SEQ_CST);
+    if (!SetTimer(hz ? hz : PROFILER_DEFAULT_HZ)) {
+        __atomic_store_n(&profile_ring.sampling, false, __ATOMIC_SEQ_CST);
+        return false;
+    }
+    return true;
+}
+
+void Profiler_stopSampling(void) {
+    if (!__atomic_load_n(&profile_ring.sampling, __ATOMIC_RELAXED)) return;
+    SetTimer(0);
+    __atomic_store_n(&profile_ring.sampling, false, __ATOMIC_SEQ_CST);
+}
+
+uint64_t Profiler_samples(void) {
+    return __atomic_load_n(&profile_ring.samples, __ATOMIC_RELAXED);
+}
+
+uint64_t Profiler_dropped(void) {
+    return __atomic_load_n(&profile_ring.dropped, __ATOMIC_RELAXED);
+}
+
+// Collapsed stacks
+
+// Drained samples, each as its depth followed by its frames
+typedef struct SampleList {
+    uintptr_t* words;
+    size_t count;
+    size_t capacity;
+    const uintptr_t** samples;
+    size_t sample_count;
+} SampleList;
+
+static bool AppendWord(SampleList* list, uintptr_t word) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 1024;
+        uintptr_t* words = (uintptr_t*)realloc(list->words, capacity * sizeof(uintptr_t));
+        if (!words) return false;
+        list->words = words;
+        list->capacity = capacity;
+    }
+    list->words[list->count++] = word;
+    return true;
+}
+
+// Moves every completed sample out of the ring, freeing its space
+static bool DrainRing(SampleList* list) {
+    if (!profile_ring.words) return true;
+
+    uint64_t tail = __atomic_load_n(&profile_ring.tail, __ATOMIC_RELAXED);
+    uint64_t head = __atomic_load_n(&profile_ring.head, __ATOMIC_ACQUIRE);
+    bool ok = true;
+    while (ok && tail < head) {
+        uintptr_t* slot = &profile_ring.words[tail & profile_ring.mask];
+        uintptr_t header = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+        if (!header) break;     // Still being written
+
+        uint64_t depth = header >> 1;
+        ok = AppendWord(list, (uintptr_t)depth);
+        for (uint64_t i = 0; i < depth; i++) {
+            uintptr_t* frame = &profile_ring.words[(tail + 1 + i) & profile_ring.mask];
+            ok = ok && AppendWord(list, __atomic_load_n(frame, __ATOMIC_RELAXED));
+            __atomic_store_n(frame, 0, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(slot, 0, __ATOMIC_RELAXED);
+        tail += depth + 1;
+    }
+    __atomic_store_n(&profile_ring.tail, tail, __ATOMIC_RELEASE);
+    return ok;
+}
+
+static int CompareSamples(const void* a, const void* b) {
+    const uintptr_t* left = *(const uintptr_t* const*)a;
+    const uintptr_t* right = *(const uintptr_t* const*)b;
+    uintptr_t depth = left[0] < right[0] ? left[0] : right[0];
+    for (uintptr_t i = 1; i <= depth; i++) {
+        if (left[i] != right[i]) return left[i] < right[i] ? -1 : 1;
+    }
+    return left[0] < right[0] ? -1 : left[0] > right[0];
+}
+
+// Frame name as collapsed stacks take it; return addresses are moved
+// back into their call instruction first
+static void WriteFrame(FILE* stream, uintptr_t address, bool return_address) {
+    if (return_address) address--;
+    Dl_info info;
+    if (!dladdr((void*)address, &info) || !info.dli_fname) {
+        fprintf(stream, "0x%lx", (unsigned long)address);
+    } else if (info.dli_sname) {
+        fputs(info.dli_sname, stream);
+    } else {
+        const char* module = strrchr(info.dli_fname, '/');
+        fprintf(stream, "%s+0x%lx", module ? module + 1 : info.dli_fname,
+                (unsigned long)(address - (uintptr_t)info.dli_fbase));
+    }
+}
+
+uint64_t Profiler_writeCollapsed(FILE* stream) {
+    SampleList list;
+    memset(&list, 0, sizeof(list));
+    bool ok = stream && DrainRing(&list);
+
+    // Index the samples, then sort them so equal stacks are adjacent
+    for (size_t i = 0; ok && i < list.count; i += list.words[i] + 1) list.sample_count++;
+    list.samples = ok && list.sample_count ? (const uintptr_t**)malloc(list.sample_count * sizeof(uintptr_t*)) : NULL;
+    uint64_t written = 0;
+    if (list.samples) {
+        size_t n = 0;
+        for (size_t i = 0; i < list.count; i += list.words[i] + 1) list.samples[n++] = &list.words[i];
+        qsort(list.samples, list.sample_count, sizeof(uintptr_t*), CompareSamples);
+
+        for (size_t i = 0; i < list.sample_count;) {
+            size_t run = 1;
+            while (i + run < list.sample_count && CompareSamples(&list.samples[i], &list.samples[i + run]) == 0) {
+                run++;
+            }
+            const uintptr_t* sample = list.samples[i];
+            for (uintptr_t f = sample[0]; f > 0; f--) {
+                WriteFrame(stream, sample[f], f > 1);
+                if (f > 1) fputc(';', stream);
+            }
+            fprintf(stream, " %zu\n", run);
+            written += run;
+            i += run;
+        }
+    }
+    free(list.samples);
+    free(list.words);
+    return written;
+}
+
+// Environment
+
+bool Profiler_configureFromEnv(void) {
+    const char* spec = getenv("GOSILANG_PROFILE");
+    if (!spec || !*spec) return false;
+
+    uint32_t hz = 0;
+    while (*spec) {
+        size_t length = strcspn(spec, ",");
+        bool all = length == 3 && strncmp(spec, "all", 3) == 0;
+        if (all || (length == 6 && strncmp(spec, "timers", 6) == 0)) profile_env.timers = true;
+        if (all || (length >= 7 && strncmp(spec, "samples", 7) == 0 && (length == 7 || spec[7] == ':'))) {
+            profile_env.samples = true;
+            if (!all && length > 8) hz = (uint32_t)strtoul(spec + 8, NULL, 10);
+        }
+        spec += length;
+        if (*spec == ',') spec++;
+    }
+
+    if (profile_env.samples) {
+        const char* out = getenv("GOSILANG_PROFILE_OUT");
+        profile_env.out = strdup(out && *out ? out : PROFILE_DEFAULT_OUT);
+        profile_env.samples = profile_env.out && Profiler_startSampling(hz, 0);
+    }
+    if (profile_env.timers) Profiler_setTiming(true);
+    return profile_env.timers || profile_env.samples;
+}
+
+void Profiler_shutdown(void) {
+    Profiler_stopSampling();
+    if (profile_env.timers) Profiler_writeReport(stderr);
+    if (profile_env.samples) {
+        FILE* stream = fopen(profile_env.out, "w");
+        if (stream) {
+            uint64_t written = Profiler_writeCollapsed(stream);
+            fclose(stream);
+            fprintf(stderr, "profile: %llu samples written to %s\n", (unsigned long long)written, profile_env.out);
+        } else {
+            fprintf(stderr, "profile: cannot write %s\n", profile_env.out);
+        }
+    }
+    free(profile_env.out);
+    memset(&profile_env, 0, sizeof(profile_env));
+    Profiler_setTiming(false);
+
+    // A handler that saw sampling still on may be writing to the ring
+    while (__atomic_load_n(&profile_ring.active, __ATOMIC_ACQUIRE)) sched_yield();
+    free(profile_ring.words);
+    profile_ring.words = NULL;
+    profile_ring.mask = 0;
+    profile_ring.head = profile_ring.tail = 0;
+}
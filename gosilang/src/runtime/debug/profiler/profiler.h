@@ -0,0 +1,141 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define PROFILER_DEFAULT_HZ 997     // Off any round rate, so as not to sample in step
+#define PROFILER_RING_DEFAULT_WORDS (1u << 20)
+#define PROFILER_MAX_DEPTH 64
+
+// X(timer, "name"): time spent in a compiler phase, summed over threads
+#define PROFILE_TIMER_LIST(X) \
+    X(PROFILE_TIMER_READ, "read") \
+    X(PROFILE_TIMER_LEX, "lex") \
+    X(PROFILE_TIMER_PARSE, "parse") \
+    X(PROFILE_TIMER_FOLD, "fold") \
+    X(PROFILE_TIMER_VALIDATE, "validate") \
+    X(PROFILE_TIMER_SYMBOLS, "symbols") \
+    X(PROFILE_TIMER_MINIMIZE, "minimize")
+
+// X(counter, "name"): events counted on hot paths
+#define PROFILE_COUNTER_LIST(X) \
+    X(PROFILE_COUNTER_FILES, "files") \
+    X(PROFILE_COUNTER_BYTES, "bytes") \
+    X(PROFILE_COUNTER_TOKENS, "tokens") \
+    X(PROFILE_COUNTER_STATEMENTS, "statements") \
+    X(PROFILE_COUNTER_FOLDED, "folded") \
+    X(PROFILE_COUNTER_DAG_NODES, "dag nodes")
+
+typedef enum ProfileTimer {
+#define X(timer, name) timer,
+    PROFILE_TIMER_LIST(X)
+#undef X
+    PROFILE_TIMER_COUNT
+} ProfileTimer;
+
+typedef enum ProfileCounter {
+#define X(counter, name) counter,
+    PROFILE_COUNTER_LIST(X)
+#undef X
+    PROFILE_COUNTER_COUNT
+} ProfileCounter;
+
+// Timers and counters summed over every thread that recorded any
+typedef struct ProfileTotals {
+    uint64_t timer_ns[PROFILE_TIMER_COUNT];
+    uint64_t timer_calls[PROFILE_TIMER_COUNT];
+    uint64_t counters[PROFILE_COUNTER_COUNT];
+    uint32_t threads;
+} ProfileTotals;
+
+// Timers and counters record only while this is set. Every recording
+// point tests it first, so when profiling is off each costs one branch
+// the predictor always gets right.
+extern bool profiler_timing;
+
+static inline bool Profiler_isTiming(void) {
+    return __builtin_expect(__atomic_load_n(&profiler_timing, __ATOMIC_RELAXED), 0);
+}
+
+// Timers and counters. Each thread records into its own block, so
+// recording takes no lock and shares no cache line; blocks outlive
+// their threads and are summed when read.
+void Profiler_setTiming(bool enabled);
+uint64_t Profiler_now(void);
+void Profiler_addTime(ProfileTimer timer, uint64_t ns);
+void Profiler_addCount(ProfileCounter counter, uint64_t count);
+void Profiler_totals(ProfileTotals* totals);
+void Profiler_writeReport(FILE* stream);
+const char* ProfileTimer_toString(ProfileTimer timer);
+const char* ProfileCounter_toString(ProfileCounter counter);
+
+#define PROFILE_TIME(timer, ns) \
+    do { \
+        if (Profiler_isTiming()) Profiler_addTime(timer, ns); \
+    } while (0)
+
+#define PROFILE_COUNT(counter, count) \
+    do { \
+        if (Profiler_isTiming()) Profiler_addCount(counter, count); \
+    } while (0)
+
+// A timer running until the end of the enclosing block
+typedef struct ProfileScope {
+    ProfileTimer timer;
+    uint64_t start;         // 0 if timing was off on entry
+} ProfileScope;
+
+static inline ProfileScope ProfileScope_begin(ProfileTimer timer) {
+    ProfileScope scope = { timer, 0 };
+    if (Profiler_isTiming()) scope.start = Profiler_now();
+    return scope;
+}
+
+static inline void ProfileScope_end(ProfileScope* scope) {
+    if (__builtin_expect(scope->start != 0, 0)) Profiler_addTime(scope->timer, Profiler_now() - scope->start);
+}
+
+#define PROFILE_SCOPE_NAME(line) PROFILE_SCOPE_NAME_(line)
+#define PROFILE_SCOPE_NAME_(line) profile_scope_##line
+#define PROFILE_SCOPE(timer) \
+    ProfileScope PROFILE_SCOPE_NAME(__LINE__) __attribute__((cleanup(ProfileScope_end))) = \
+        ProfileScope_begin(timer)
+
+// Sampling. SIGPROF fires hz times per second of CPU time used by the
+// process, on whichever thread is running; the handler captures that
+// thread's stack into a ring of words shared by all threads. A sample
+// is a header word ((depth << 1) | 1) and depth return addresses, leaf
+// first. Space is reserved with a CAS and the header is stored last,
+// so a reader stops at the first sample still being written; when the
+// ring is full, new samples are dropped and counted.
+//
+// Stacks are captured by walking frame pointers from the interrupted
+// registers, which is async-signal-safe where backtrace() is not; the
+// build keeps them with -fno-omit-frame-pointer. Code built without
+// them, such as the C library, ends the walk or hides its caller.
+bool Profiler_startSampling(uint32_t hz, size_t ring_words);
+void Profiler_stopSampling(void);
+uint64_t Profiler_samples(void);
+uint64_t Profiler_dropped(void);
+
+// Drains the ring into collapsed stacks for flame graphs, one
+// "outer;...;leaf count" line per distinct stack. Frames are named by
+// dladdr, which sees the executable's functions when it is linked with
+// -rdynamic; others are written as module+0xoffset for addr2line.
+// Returns the samples written.
+uint64_t Profiler_writeCollapsed(FILE* stream);
+
+// GOSILANG_PROFILE selects what to record: "timers", "samples",
+// "samples:HZ" or "all", comma separated. GOSILANG_PROFILE_OUT names
+// the collapsed stack file, gosilang.folded by default. Returns true
+// when anything was enabled.
+bool Profiler_configureFromEnv(void);
+
+// Stops sampling, writes what GOSILANG_PROFILE asked for (the timer
+// report to stderr, the stacks to their file) and frees the ring
+void Profiler_shutdown(void);
+
+#endif // PROFILER_H
@@ -0,0 +1,46 @@
+#ifndef GOSI_UNIT_TEST_H
+#define GOSI_UNIT_TEST_H
+
+// Minimal harness shared by the unit tests. Each tests/unit/test_*.c
+// builds into its own executable; CHECK reports a failed condition and
+// carries on, so one run lists every failure, and TEST_RUN names the
+// test that failed. main() returns Test_finish().
+#include <stdio.h>
+#include <string.h>
+
+static int test_failures;
+static int test_count;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_STR(actual, expected) \
+    do { \
+        const char* check_actual_ = (actual); \
+        const char* check_expected_ = (expected); \
+        if (!check_actual_ || strcmp(check_actual_, check_expected_) != 0) { \
+            fprintf(stderr, "%s:%d: expected \"%s\", got \"%s\"\n", __FILE__, __LINE__, check_expected_, \
+                    check_actual_ ? check_actual_ : "(null)"); \
+            test_failures++; \
+        } \
+    } while (0)
+
+#define TEST_RUN(test) \
+    do { \
+        int failures_before_ = test_failures; \
+        test(); \
+        test_count++; \
+        if (test_failures != failures_before_) fprintf(stderr, "FAILED %s\n", #test); \
+    } while (0)
+
+static inline int Test_finish(const char* suite) {
+    printf("%-20s %d tests, %d failed checks\n", suite, test_count, test_failures);
+    return test_failures ? 1 : 0;
+}
+
+#endif // GOSI_UNIT_TEST_H
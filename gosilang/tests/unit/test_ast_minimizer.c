@@ -0,0 +1,311 @@
+// AstMinimizer: which subtrees collapse and which stay apart, reference
+// counts, pools added one after another, malformed input, random
+// expressions expanded back out of the DAG, and a failed add leaving
+// the minimizer as it was.
+#include "core/ast/minimizer/ast_minimizer.h"
+#include "core/parser/expr_parser.h"
+#include "core/tokenizer/lexer/lexer.h"
+#include "test.h"
+#include <stdlib.h>
+
+#define MAX_ROOTS 64
+
+// Statements separated by ';', each parsed into one pool
+typedef struct Parsed {
+    TokenBuffer* tokens;
+    AstPool* pool;
+    AstNodeId roots[MAX_ROOTS];
+    uint32_t count;
+} Parsed;
+
+static void Parse(Parsed* parsed, const char* text) {
+    Lexer* lexer = Lexer_createFromBuffer(text, strlen(text), "minimizer");
+    parsed->tokens = TokenBuffer_create(0);
+    Lexer_fillBuffer(lexer, parsed->tokens);
+    Lexer_destroy(lexer);
+
+    parsed->pool = AstPool_create(0);
+    parsed->count = 0;
+    ExprParser* parser = ExprParser_create();
+    uint32_t begin = 0;
+    for (uint32_t i = 0; i < parsed->tokens->count && parsed->count < MAX_ROOTS; i++) {
+        if (parsed->tokens->types[i] != TOKEN_PUNCT_SEMICOLON) continue;
+        parsed->roots[parsed->count] = ExprParser_build(parser, parsed->tokens, begin, i, parsed->pool);
+        CHECK(parsed->roots[parsed->count] != AST_NODE_NONE);
+        parsed->count++;
+        begin = i + 1;
+    }
+    ExprParser_destroy(parser);
+}
+
+static void Parsed_free(Parsed* parsed) {
+    AstPool_destroy(parsed->pool);
+    TokenBuffer_destroy(parsed->tokens);
+}
+
+static AstNodeId RootOf(const AstMinimizer* minimizer, const Parsed* parsed, uint32_t statement) {
+    return AstMinimizer_canonical(minimizer, parsed->roots[statement]);
+}
+
+static void test_identical_subtrees_collapse(void) {
+    Parsed parsed;
+    Parse(&parsed, "a + b; (a + b) * (a + b); a + b;");
+    AstMinimizer* minimizer = AstMinimizer_create(parsed.tokens);
+    CHECK(AstMinimizer_addPool(minimizer, parsed.pool));
+
+    // a, b, a + b and the product
+    CHECK(minimizer->dag->count == 4);
+    AstNodeId sum = RootOf(minimizer, &parsed, 0);
+    AstNodeId product = RootOf(minimizer, &parsed, 1);
+    CHECK(RootOf(minimizer, &parsed, 2) == sum);
+    CHECK(AstPool_child(minimizer->dag, product, 0) == sum);
+    CHECK(AstPool_child(minimizer->dag, product, 1) == sum);
+
+    // Two roots and both operands of the product
+    CHECK(AstMinimizer_refCount(minimizer, sum) == 4);
+    CHECK(AstMinimizer_refCount(minimizer, product) == 1);
+    CHECK(AstMinimizer_isShared(minimizer, sum) && !AstMinimizer_isShared(minimizer, product));
+
+    // Every input node maps somewhere, and leaves keep their spelling
+    for (AstNodeId id = 0; id < parsed.pool->count; id++) {
+        CHECK(AstMinimizer_canonical(minimizer, id) < minimizer->dag->count);
+    }
+    CHECK(AstMinimizer_canonical(minimizer, parsed.pool->count) == AST_NODE_NONE);
+
+    AstMinimizer_destroy(minimizer);
+    Parsed_free(&parsed);
+}
+
+static void test_different_subtrees_stay_apart(void) {
+    Parsed parsed;
+    Parse(&parsed, "a + b; a - b; b + a; a + c; 1 + 2; 1 + 3; -a; a++; c ? a : b; c ? b : a;");
+    AstMinimizer* minimizer = AstMinimizer_create(parsed.tokens);
+    CHECK(AstMinimizer_addPool(minimizer, parsed.pool));
+
+    uint32_t distinct = 0;
+    for (uint32_t i = 0; i < parsed.count; i++) {
+        bool repeated = false;
+        for (uint32_t j = 0; j < i; j++) {
+            if (RootOf(minimizer, &parsed, i) == RootOf(minimizer, &parsed, j)) repeated = true;
+        }
+        if (!repeated) distinct++;
+    }
+    CHECK(distinct == parsed.count);
+
+    // The leaves a, b, c, 1, 2 and 3 appear once each
+    uint32_t leaves = 0;
+    for (AstNodeId id = 0; id < minimizer->dag->count; id++) {
+        if (minimizer->dag->nodes[id].child_count == 0) leaves++;
+    }
+    CHECK(leaves == 6);
+    AstMinimizer_destroy(minimizer);
+    Parsed_free(&parsed);
+}
+
+static void test_pools_share_one_dag(void) {
+    // Both pools index one token buffer, as leaf values are read from it
+    Parsed parsed;
+    Parse(&parsed, "x * y + 1; x * y + 1; x * y;");
+    AstPool* second = AstPool_create(0);
+    ExprParser* parser = ExprParser_create();
+    uint32_t semicolon = 5;
+    CHECK(parsed.tokens->types[semicolon] == TOKEN_PUNCT_SEMICOLON);
+    AstNodeId again = ExprParser_build(parser, parsed.tokens, semicolon + 1, semicolon + 6, second);
+    AstNodeId product = ExprParser_build(parser, parsed.tokens, semicolon + 7, semicolon + 10, second);
+    CHECK(again != AST_NODE_NONE && product != AST_NODE_NONE);
+
+    AstPool* first = AstPool_create(0);
+    AstNodeId root = ExprParser_build(parser, parsed.tokens, 0, semicolon, first);
+    AstMinimizer* minimizer = AstMinimizer_create(parsed.tokens);
+    CHECK(AstMinimizer_addPool(minimizer, first));
+    AstNodeId dag_root = AstMinimizer_canonical(minimizer, root);
+    uint32_t count = minimizer->dag->count;
+    CHECK(count == 5);
+
+    CHECK(AstMinimizer_addPool(minimizer, second));
+    CHECK(minimizer->dag->count == count);
+    CHECK(AstMinimizer_canonical(minimizer, again) == dag_root);
+    CHECK(AstMinimizer_canonical(minimizer, product) == AstPool_child(minimizer->dag, dag_root, 0));
+    CHECK(AstMinimizer_refCount(minimizer, dag_root) == 2);
+    CHECK(AstMinimizer_refCount(minimizer, AstMinimizer_canonical(minimizer, product)) == 2);
+
+    // Canonical ids now describe the last pool only
+    CHECK(minimizer->input_count == second->count);
+    AstMinimizer_destroy(minimizer);
+    ExprParser_destroy(parser);
+    AstPool_destroy(first);
+    AstPool_destroy(second);
+    Parsed_free(&parsed);
+}
+
+static void test_retain_release_and_bad_input(void) {
+    Parsed parsed;
+    Parse(&parsed, "a;");
+    AstMinimizer* minimizer = AstMinimizer_create(parsed.tokens);
+    CHECK(AstMinimizer_addPool(minimizer, parsed.pool));
+    AstNodeId a = RootOf(minimizer, &parsed, 0);
+    CHECK(AstMinimizer_refCount(minimizer, a) == 1);
+
+    AstMinimizer_retain(minimizer, a);
+    CHECK(AstMinimizer_refCount(minimizer, a) == 2);
+    AstMinimizer_release(minimizer, a);
+    AstMinimizer_release(minimizer, a);
+    AstMinimizer_release(minimizer, a);
+    CHECK(AstMinimizer_refCount(minimizer, a) == 0);
+    AstMinimizer_retain(minimizer, 99);
+    CHECK(AstMinimizer_refCount(minimizer, 99) == 0);
+
+    // A child that does not come before its parent is refused
+    AstPool* bad = AstPool_create(0);
+    AstNodeId leaf = AstPool_add(bad, AST_NODE_IDENTIFIER, 0, 0, NULL, 0);
+    AstPool_add(bad, AST_NODE_PREFIX, OP_SUBTRACT, 0, &leaf, 1);
+    bad->children[0] = 1;
+    CHECK(!AstMinimizer_addPool(minimizer, bad));
+    CHECK(minimizer->input_count == 0);
+    CHECK(!AstMinimizer_addPool(minimizer, NULL));
+    CHECK(!AstMinimizer_addPool(NULL, bad));
+
+    AstPool_destroy(bad);
+    AstMinimizer_destroy(minimizer);
+    Parsed_free(&parsed);
+}
+
+// Walks an input tree and its DAG node side by side
+static bool SameStructure(const AstPool* tree, AstNodeId t, const AstPool* dag, AstNodeId d,
+                          const TokenBuffer* tokens) {
+    const AstNode* a = &tree->nodes[t];
+    const AstNode* b = &dag->nodes[d];
+    if (a->kind != b->kind || a->op != b->op || a->child_count != b->child_count) return false;
+    if (!a->child_count && (tokens->lengths[a->token] != tokens->lengths[b->token] ||
+        memcmp(TokenBuffer_value(tokens, a->token), TokenBuffer_value(tokens, b->token),
+               tokens->lengths[a->token]) != 0)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < a->child_count; i++) {
+        if (!SameStructure(tree, AstPool_child(tree, t, i), dag, AstPool_child(dag, d, i), tokens)) return false;
+    }
+    return true;
+}
+
+static size_t Generate(char* out, int depth) {
+    static const char* const operators[] = { " + ", " * ", " < ", " && " };
+    if (depth == 0 || rand() % 3 == 0) return (size_t)sprintf(out, "%c", "abc12"[rand() % 5]);
+    size_t used = (size_t)sprintf(out, "(");
+    used += Generate(out + used, depth - 1);
+    used += (size_t)sprintf(out + used, "%s", operators[rand() % 4]);
+    used += Generate(out + used, depth - 1);
+    return used + (size_t)sprintf(out + used, ")");
+}
+
+static void test_random_expressions_expand_back(void) {
+    srand(14);
+    char source[MAX_ROOTS * 160];
+    size_t used = 0;
+    for (int i = 0; i < MAX_ROOTS; i++) {
+        used += Generate(source + used, 4);
+        used += (size_t)sprintf(source + used, ";");
+    }
+    Parsed parsed;
+    Parse(&parsed, source);
+    CHECK(parsed.count == MAX_ROOTS);
+
+    AstMinimizer* minimizer = AstMinimizer_create(parsed.tokens);
+    CHECK(AstMinimizer_addPool(minimizer, parsed.pool));
+    CHECK(minimizer->dag->count < parsed.pool->count);
+    for (uint32_t i = 0; i < parsed.count; i++) {
+        CHECK(SameStructure(parsed.pool, parsed.roots[i], minimizer->dag, RootOf(minimizer, &parsed, i),
+                            parsed.tokens));
+    }
+
+    // No two DAG nodes are equal: same kind, operator, value and children
+    const AstPool* dag = minimizer->dag;
+    uint32_t duplicates = 0;
+    for (AstNodeId x = 0; x < dag->count; x++) {
+        for (AstNodeId y = x + 1; y < dag->count; y++) {
+            const AstNode* a = &dag->nodes[x];
+            const AstNode* b = &dag->nodes[y];
+            if (a->kind != b->kind || a->op != b->op || a->child_count != b->child_count) continue;
+            bool same = true;
+            for (uint32_t i = 0; i < a->child_count; i++) {
+                same = same && AstPool_child(dag, x, i) == AstPool_child(dag, y, i);
+            }
+            if (!a->child_count) {
+                same = parsed.tokens->lengths[a->token] == parsed.tokens->lengths[b->token] &&
+                       memcmp(TokenBuffer_value(parsed.tokens, a->token), TokenBuffer_value(parsed.tokens, b->token),
+                              parsed.tokens->lengths[a->token]) == 0;
+            }
+            if (same) duplicates++;
+        }
+    }
+    CHECK(duplicates == 0);
+
+    AstMinimizer_destroy(minimizer);
+    Parsed_free(&parsed);
+}
+
+static void test_failed_add_rolls_back(void) {
+    srand(15);
+    char source[MAX_ROOTS * 160];
+    size_t used = 0;
+    for (int i = 0; i < MAX_ROOTS; i++) {
+        used += Generate(source + used, 4);
+        used += (size_t)sprintf(source + used, ";");
+    }
+    Parsed parsed;
+    Parse(&parsed, source);
+
+    // The first statement alone, then the whole pool on top of it
+    uint32_t semicolon = 0;
+    while (parsed.tokens->types[semicolon] != TOKEN_PUNCT_SEMICOLON) semicolon++;
+    AstPool* first = AstPool_create(0);
+    ExprParser* parser = ExprParser_create();
+    CHECK(ExprParser_build(parser, parsed.tokens, 0, semicolon, first) != AST_NODE_NONE);
+    AstMinimizer* minimizer = AstMinimizer_create(parsed.tokens);
+    AstMinimizer* fresh = AstMinimizer_create(parsed.tokens);
+    CHECK(AstMinimizer_addPool(minimizer, first) && AstMinimizer_addPool(fresh, first));
+
+    uint32_t count = minimizer->dag->count;
+    uint32_t child_count = minimizer->dag->child_count;
+    uint32_t refs[64];
+    CHECK(count <= 64);
+    memcpy(refs, minimizer->ref_counts, count * sizeof(uint32_t));
+
+    // The last operator node refers to itself, so the add fails after
+    // nearly every other node is in the DAG
+    AstNodeId last = parsed.pool->count - 1;
+    while (!parsed.pool->nodes[last].child_count) last--;
+    AstNodeId* slot = &parsed.pool->children[parsed.pool->nodes[last].first_child];
+    AstNodeId child = *slot;
+    *slot = last;
+    CHECK(!AstMinimizer_addPool(minimizer, parsed.pool));
+    CHECK(minimizer->dag->count == count && minimizer->dag->child_count == child_count);
+    CHECK(memcmp(refs, minimizer->ref_counts, count * sizeof(uint32_t)) == 0);
+    CHECK(minimizer->input_count == 0);
+
+    // Adding the repaired pool gives the DAG a minimizer that never failed builds
+    *slot = child;
+    CHECK(AstMinimizer_addPool(minimizer, parsed.pool) && AstMinimizer_addPool(fresh, parsed.pool));
+    CHECK(minimizer->dag->count == fresh->dag->count);
+    CHECK(memcmp(minimizer->ref_counts, fresh->ref_counts, fresh->dag->count * sizeof(uint32_t)) == 0);
+    uint32_t moved = 0;
+    for (AstNodeId id = 0; id < parsed.pool->count; id++) {
+        if (AstMinimizer_canonical(minimizer, id) != AstMinimizer_canonical(fresh, id)) moved++;
+    }
+    CHECK(moved == 0);
+
+    AstMinimizer_destroy(fresh);
+    AstMinimizer_destroy(minimizer);
+    ExprParser_destroy(parser);
+    AstPool_destroy(first);
+    Parsed_free(&parsed);
+}
+
+int main(void) {
+    TEST_RUN(test_identical_subtrees_collapse);
+    TEST_RUN(test_different_subtrees_stay_apart);
+    TEST_RUN(test_pools_share_one_dag);
+    TEST_RUN(test_retain_release_and_bad_input);
+    TEST_RUN(test_random_expressions_expand_back);
+    TEST_RUN(test_failed_add_rolls_back);
+    return Test_finish("ast_minimizer");
+}
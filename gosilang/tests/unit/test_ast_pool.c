@@ -0,0 +1,124 @@
+// AstPool: child runs, growth and clearing, and the trees the
+// expression parser builds into a pool.
+#include "core/ast/ast.h"
+#include "core/parser/expr_parser.h"
+#include "core/tokenizer/lexer/lexer.h"
+#include "test.h"
+
+static void test_add_and_children(void) {
+    AstPool* pool = AstPool_create(2);
+    AstNodeId a = AstPool_add(pool, AST_NODE_IDENTIFIER, 0, 0, NULL, 0);
+    AstNodeId b = AstPool_add(pool, AST_NODE_LITERAL, 0, 2, NULL, 0);
+    AstNodeId pair[] = { a, b };
+    AstNodeId sum = AstPool_add(pool, AST_NODE_BINARY, OP_ADD, 1, pair, 2);
+    CHECK(a == 0 && b == 1 && sum == 2);
+
+    const AstNode* node = AstPool_node(pool, sum);
+    CHECK(node->kind == AST_NODE_BINARY && node->op == OP_ADD && node->token == 1 && node->child_count == 2);
+    CHECK(AstPool_child(pool, sum, 0) == a && AstPool_child(pool, sum, 1) == b);
+    CHECK(AstPool_child(pool, sum, 2) == AST_NODE_NONE);
+    CHECK(AstPool_child(pool, a, 0) == AST_NODE_NONE);
+    CHECK(AstPool_node(pool, 3) == NULL);
+
+    // Children may be shared and repeated
+    AstNodeId twice[] = { sum, sum, a };
+    AstNodeId block = AstPool_add(pool, AST_NODE_BLOCK, 0, 0, twice, 3);
+    CHECK(AstPool_child(pool, block, 1) == sum && AstPool_child(pool, block, 2) == a);
+
+    CHECK(AstPool_add(pool, AST_NODE_BLOCK, 0, 0, NULL, 1) == AST_NODE_NONE);
+    CHECK(AstPool_add(NULL, AST_NODE_BLOCK, 0, 0, NULL, 0) == AST_NODE_NONE);
+    AstPool_destroy(pool);
+}
+
+static void test_growth_and_clear(void) {
+    AstPool* pool = AstPool_create(1);
+    AstNodeId previous = AstPool_add(pool, AST_NODE_LITERAL, 0, 0, NULL, 0);
+    for (uint32_t i = 1; i < 10000; i++) {
+        AstNodeId id = AstPool_add(pool, AST_NODE_PREFIX, OP_SUBTRACT, i, &previous, 1);
+        CHECK(id == i);
+        previous = id;
+    }
+    CHECK(pool->count == 10000 && pool->child_count == 9999);
+
+    // Every parent follows its child, so a scan runs bottom-up
+    uint32_t out_of_order = 0;
+    for (AstNodeId id = 1; id < pool->count; id++) {
+        if (AstPool_child(pool, id, 0) >= id) out_of_order++;
+    }
+    CHECK(out_of_order == 0);
+
+    uint32_t capacity = pool->capacity;
+    AstPool_clear(pool);
+    CHECK(pool->count == 0 && pool->child_count == 0 && pool->capacity == capacity);
+    CHECK(AstPool_add(pool, AST_NODE_LITERAL, 0, 0, NULL, 0) == 0);
+    AstPool_destroy(pool);
+}
+
+// Renders a tree as nested (kind children...) with leaves as their text
+static size_t Render(const AstPool* pool, const TokenBuffer* tokens, AstNodeId id, char* out, size_t size) {
+    const AstNode* node = AstPool_node(pool, id);
+    if (!node) return (size_t)snprintf(out, size, "?");
+    if (node->child_count == 0) {
+        return (size_t)snprintf(out, size, "%.*s", (int)tokens->lengths[node->token],
+                                TokenBuffer_value(tokens, node->token));
+    }
+    size_t used = (size_t)snprintf(out, size, "(%.*s", (int)tokens->lengths[node->token],
+                                   TokenBuffer_value(tokens, node->token));
+    for (uint32_t i = 0; i < node->child_count && used < size; i++) {
+        used += (size_t)snprintf(out + used, size - used, " ");
+        used += Render(pool, tokens, AstPool_child(pool, id, i), out + used, size - used);
+    }
+    if (used < size) used += (size_t)snprintf(out + used, size - used, ")");
+    return used;
+}
+
+static void CheckTree(const char* text, const char* expected) {
+    Lexer* lexer = Lexer_createFromBuffer(text, strlen(text), "tree");
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    Lexer_fillBuffer(lexer, tokens);
+    AstPool* pool = AstPool_create(0);
+    ExprParser* parser = ExprParser_create();
+
+    AstNodeId root = ExprParser_build(parser, tokens, 0, tokens->count - 1, pool);
+    char out[256] = "";
+    if (root != AST_NODE_NONE) Render(pool, tokens, root, out, sizeof(out));
+    CHECK_STR(out, expected);
+    CHECK(root == pool->count - 1);
+
+    ExprParser_destroy(parser);
+    AstPool_destroy(pool);
+    TokenBuffer_destroy(tokens);
+    Lexer_destroy(lexer);
+}
+
+static void test_built_trees(void) {
+    CheckTree("a + b * c", "(+ a (* b c))");
+    CheckTree("-x", "(- x)");
+    CheckTree("c ? 1 : 2", "(? c 1 2)");
+    CheckTree("x = y = 3", "(= x (= y 3))");
+    CheckTree("p->next++", "(++ (-> p next))");
+}
+
+static void test_parse_standalone_tokens(void) {
+    Token* tokens[3] = {
+        Token_create(TOKEN_LITERAL_INTEGER, "2"),
+        Token_create(TOKEN_EXPR_BINARY, "*"),
+        Token_create(TOKEN_LITERAL_INTEGER, "3"),
+    };
+    AstPool* pool = AstPool_create(0);
+    AstNodeId root = ParseExpression(tokens, 3, pool);
+    const AstNode* node = AstPool_node(pool, root);
+    CHECK(node && node->kind == AST_NODE_BINARY && node->op == OP_MULTIPLY && node->token == 1);
+    CHECK(ParseExpression(tokens, 2, pool) == AST_NODE_NONE);
+    CHECK(ParseExpression(tokens, 0, pool) == AST_NODE_NONE);
+    for (int i = 0; i < 3; i++) Token_destroy(tokens[i]);
+    AstPool_destroy(pool);
+}
+
+int main(void) {
+    TEST_RUN(test_add_and_children);
+    TEST_RUN(test_growth_and_clear);
+    TEST_RUN(test_built_trees);
+    TEST_RUN(test_parse_standalone_tokens);
+    return Test_finish("ast_pool");
+}
@@ -0,0 +1,225 @@
+// AstValidator: parsed trees are clean, each diagnostic code is raised
+// by the fault it names, and a pool of any size reports the same sorted
+// diagnostics as a serial run.
+#include "core/ast/validator/ast_validator.h"
+#include "core/parser/expr_parser.h"
+#include "core/tokenizer/lexer/lexer.h"
+#include "test.h"
+#include <stdlib.h>
+
+static TokenBuffer* Lex(const char* text) {
+    Lexer* lexer = Lexer_createFromBuffer(text, strlen(text), "validator");
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    Lexer_fillBuffer(lexer, tokens);
+    Lexer_destroy(lexer);
+    return tokens;
+}
+
+// Statements separated by ';' parsed into pool; returns the root count
+static uint32_t ParseAll(const TokenBuffer* tokens, AstPool* pool, AstNodeId* roots, uint32_t max) {
+    ExprParser* parser = ExprParser_create();
+    uint32_t count = 0, begin = 0;
+    for (uint32_t i = 0; i < tokens->count && count < max; i++) {
+        if (tokens->types[i] != TOKEN_PUNCT_SEMICOLON) continue;
+        roots[count] = ExprParser_build(parser, tokens, begin, i, pool);
+        CHECK(roots[count] != AST_NODE_NONE);
+        count++;
+        begin = i + 1;
+    }
+    ExprParser_destroy(parser);
+    return count;
+}
+
+static void test_parsed_trees_are_clean(void) {
+    TokenBuffer* tokens = Lex("a + b * c; -x; p->next++; c ? 1 : 2.5; *p = &q; sizeof x; !a && ~b; s = \"t\";");
+    AstPool* pool = AstPool_create(0);
+    AstNodeId roots[16];
+    uint32_t count = ParseAll(tokens, pool, roots, 16);
+    CHECK(count == 8);
+
+    AstValidator* validator = AstValidator_create(NULL);
+    CHECK(AstValidator_run(validator, pool, tokens, roots, count));
+    CHECK(validator->diagnostic_count == 0);
+    AstValidator_print(validator, tokens, stderr);
+
+    // No roots is trivially clean; roots without a count is an error
+    CHECK(AstValidator_run(validator, pool, tokens, roots, 0));
+    CHECK(!AstValidator_run(validator, pool, tokens, NULL, 1));
+    CHECK(!AstValidator_run(validator, NULL, tokens, roots, count));
+    AstValidator_destroy(validator);
+    AstPool_destroy(pool);
+    TokenBuffer_destroy(tokens);
+}
+
+// Validates the tree at root alone and checks it raised only code
+static void ExpectOnly(AstValidator* validator, const AstPool* pool, const TokenBuffer* tokens,
+                       AstNodeId root, AstDiagnosticCode code, AstNodeId at) {
+    CHECK(AstValidator_run(validator, pool, tokens, &root, 1));
+    CHECK(validator->diagnostic_count == 1);
+    if (validator->diagnostic_count != 1) {
+        AstValidator_print(validator, tokens, stderr);
+        return;
+    }
+    CHECK(validator->diagnostics[0].code == code);
+    CHECK(validator->diagnostics[0].node == at);
+}
+
+static void test_each_fault_is_reported(void) {
+    // Tokens: a + b - 7
+    TokenBuffer* tokens = Lex("a + b - 7");
+    AstPool* pool = AstPool_create(0);
+    AstValidator* validator = AstValidator_create(NULL);
+
+    AstNodeId a = AstPool_add(pool, AST_NODE_IDENTIFIER, 0, 0, NULL, 0);
+    AstNodeId b = AstPool_add(pool, AST_NODE_IDENTIFIER, 0, 2, NULL, 0);
+    AstNodeId pair[] = { a, b };
+    AstNodeId sum = AstPool_add(pool, AST_NODE_BINARY, OP_ADD, 1, pair, 2);
+    CHECK(AstValidator_run(validator, pool, tokens, &sum, 1) && validator->diagnostic_count == 0);
+
+    AstNodeId outside = 99;
+    CHECK(AstValidator_run(validator, pool, tokens, &outside, 1));
+    CHECK(validator->diagnostic_count == 1 && validator->diagnostics[0].code == AST_DIAG_NODE_RANGE &&
+          validator->diagnostics[0].token == UINT32_MAX);
+
+    AstNodeId strange = AstPool_add(pool, AST_NODE_IDENTIFIER, 0, 0, NULL, 0);
+    pool->nodes[strange].kind = 200;
+    ExpectOnly(validator, pool, tokens, strange, AST_DIAG_UNKNOWN_KIND, strange);
+
+    AstNodeId lonely = AstPool_add(pool, AST_NODE_BINARY, OP_ADD, 1, &a, 1);
+    ExpectOnly(validator, pool, tokens, lonely, AST_DIAG_ARITY, lonely);
+
+    AstNodeId stray = AstPool_add(pool, AST_NODE_PREFIX, OP_SUBTRACT, 3, &b, 1);
+    pool->nodes[stray].first_child = pool->child_count;
+    ExpectOnly(validator, pool, tokens, stray, AST_DIAG_CHILD_RANGE, stray);
+
+    AstNodeId loop = AstPool_add(pool, AST_NODE_PREFIX, OP_SUBTRACT, 3, &b, 1);
+    pool->children[pool->nodes[loop].first_child] = loop;
+    ExpectOnly(validator, pool, tokens, loop, AST_DIAG_CHILD_ORDER, loop);
+
+    AstNodeId far = AstPool_add(pool, AST_NODE_IDENTIFIER, 0, 50, NULL, 0);
+    ExpectOnly(validator, pool, tokens, far, AST_DIAG_TOKEN_RANGE, far);
+
+    AstNodeId misread = AstPool_add(pool, AST_NODE_IDENTIFIER, 0, 4, NULL, 0);
+    ExpectOnly(validator, pool, tokens, misread, AST_DIAG_TOKEN_KIND, misread);
+    AstNodeId number = AstPool_add(pool, AST_NODE_LITERAL, 0, 0, NULL, 0);
+    ExpectOnly(validator, pool, tokens, number, AST_DIAG_TOKEN_KIND, number);
+
+    AstNodeId wrong_kind = AstPool_add(pool, AST_NODE_PREFIX, OP_MULTIPLY, 1, &a, 1);
+    ExpectOnly(validator, pool, tokens, wrong_kind, AST_DIAG_OPERATOR, wrong_kind);
+    AstNodeId postfix = AstPool_add(pool, AST_NODE_POSTFIX, OP_ADD, 1, &a, 1);
+    ExpectOnly(validator, pool, tokens, postfix, AST_DIAG_OPERATOR, postfix);
+
+    AstNodeId swapped = AstPool_add(pool, AST_NODE_BINARY, OP_SUBTRACT, 1, pair, 2);
+    ExpectOnly(validator, pool, tokens, swapped, AST_DIAG_OPERATOR_TOKEN, swapped);
+
+    // Without tokens only the structure is checked
+    CHECK(AstValidator_run(validator, pool, NULL, &swapped, 1) && validator->diagnostic_count == 0);
+
+    AstValidator_destroy(validator);
+    AstPool_destroy(pool);
+    TokenBuffer_destroy(tokens);
+}
+
+static void test_shared_nodes(void) {
+    TokenBuffer* tokens = Lex("a + a");
+    AstPool* pool = AstPool_create(0);
+    AstNodeId a = AstPool_add(pool, AST_NODE_IDENTIFIER, 0, 0, NULL, 0);
+    AstNodeId twice[] = { a, a };
+    AstNodeId sum = AstPool_add(pool, AST_NODE_BINARY, OP_ADD, 1, twice, 2);
+    AstValidator* validator = AstValidator_create(NULL);
+
+    ExpectOnly(validator, pool, tokens, sum, AST_DIAG_SHARED, a);
+
+    // Two roots over one leaf: the second visit is the extra parent
+    AstNodeId roots[] = { sum, a };
+    CHECK(AstValidator_run(validator, pool, tokens, roots, 2));
+    CHECK(validator->diagnostic_count == 2);
+
+    validator->allow_shared = true;
+    CHECK(AstValidator_run(validator, pool, tokens, roots, 2));
+    CHECK(validator->diagnostic_count == 0);
+    AstValidator_destroy(validator);
+    AstPool_destroy(pool);
+    TokenBuffer_destroy(tokens);
+}
+
+// Many small trees with a fault in every seventh, and one long chain
+// that jobs split between them, validated serially and on pools of
+// several sizes
+static void test_same_output_for_any_thread_count(void) {
+    enum { STATEMENTS = 2000 };
+    char* source = (char*)malloc(STATEMENTS * 64 + 200000);
+    size_t used = 0;
+    for (int i = 0; i < STATEMENTS; i++) {
+        used += (size_t)sprintf(source + used, "(a%d + b) * (c - %d) < d && !e;", i % 50, i);
+    }
+    // One long chain, deep enough to be split between jobs
+    for (int i = 0; i < 10000; i++) used += (size_t)sprintf(source + used, "x + ");
+    used += (size_t)sprintf(source + used, "y;");
+    source[used] = '\0';
+
+    TokenBuffer* tokens = Lex(source);
+    AstPool* pool = AstPool_create(0);
+    AstNodeId* roots = (AstNodeId*)malloc((STATEMENTS + 1) * sizeof(AstNodeId));
+    uint32_t count = ParseAll(tokens, pool, roots, STATEMENTS + 1);
+    CHECK(count == STATEMENTS + 1);
+
+    uint32_t faults = 0;
+    for (uint32_t i = 7; i < STATEMENTS; i += 7) {
+        AstNode* root = &pool->nodes[roots[i]];
+        if (i % 2) {
+            root->op = OP_SIZEOF;
+        } else {
+            pool->children[root->first_child] = roots[i - 1];
+        }
+        faults++;
+    }
+    // and one deep inside the chain, which another job may check
+    AstNodeId deep = roots[STATEMENTS];
+    for (int i = 0; i < 5000; i++) deep = AstPool_child(pool, deep, 0);
+    pool->nodes[deep].op = OP_MULTIPLY;
+    faults++;
+
+    AstValidator* serial = AstValidator_create(NULL);
+    CHECK(AstValidator_run(serial, pool, tokens, roots, count));
+    CHECK(serial->diagnostic_count == faults);
+    uint32_t unsorted = 0;
+    for (uint32_t i = 1; i < serial->diagnostic_count; i++) {
+        if (serial->diagnostics[i - 1].node > serial->diagnostics[i].node) unsorted++;
+    }
+    CHECK(unsorted == 0);
+
+    static const uint32_t thread_counts[] = { 1, 2, 4, 8 };
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        WorkPool* workers = WorkPool_create(thread_counts[t]);
+        AstValidator* validator = AstValidator_create(workers);
+        for (int repeat = 0; repeat < 3; repeat++) {
+            CHECK(AstValidator_run(validator, pool, tokens, roots, count));
+            CHECK(validator->diagnostic_count == serial->diagnostic_count);
+            CHECK(memcmp(validator->diagnostics, serial->diagnostics,
+                         serial->diagnostic_count * sizeof(AstDiagnostic)) == 0);
+        }
+        AstValidator_destroy(validator);
+        WorkPool_destroy(workers);
+    }
+
+    AstValidator_destroy(serial);
+    free(roots);
+    AstPool_destroy(pool);
+    TokenBuffer_destroy(tokens);
+    free(source);
+}
+
+static void test_messages(void) {
+    CHECK_STR(AstDiagnosticCode_toString(AST_DIAG_SHARED), "node has more than one parent");
+    CHECK(AstDiagnosticCode_toString(AST_DIAGNOSTIC_COUNT) != NULL);
+}
+
+int main(void) {
+    TEST_RUN(test_parsed_trees_are_clean);
+    TEST_RUN(test_each_fault_is_reported);
+    TEST_RUN(test_shared_nodes);
+    TEST_RUN(test_same_output_for_any_thread_count);
+    TEST_RUN(test_messages);
+    return Test_finish("ast_validator");
+}
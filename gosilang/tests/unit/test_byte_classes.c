@@ -0,0 +1,203 @@
+// Bitset operations against a bool-array model at sizes around word
+// and block boundaries, and byte classes: grouping, compression and
+// matching that agrees with the uncompressed automaton.
+#include "core/minimizer/bitset.h"
+#include "core/minimizer/dfa.h"
+#include "test.h"
+#include <stdlib.h>
+
+static uint32_t random_state = 7;
+
+static uint32_t NextRandom(uint32_t bound) {
+    random_state = random_state * 1103515245u + 12345u;
+    return (random_state >> 8) % bound;
+}
+
+static void RandomFill(Bitset* set, bool* model) {
+    Bitset_clear(set);
+    for (uint32_t i = 0; i < set->size; i++) {
+        model[i] = NextRandom(3) == 0;
+        if (model[i]) Bitset_set(set, i);
+    }
+}
+
+static bool Matches(const Bitset* set, const bool* model) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < set->size; i++) {
+        if (Bitset_test(set, i) != model[i]) return false;
+        count += model[i];
+    }
+    // Padding past size stays clear
+    for (uint32_t i = set->size; i < set->word_count * 64; i++) {
+        if (Bitset_test(set, i)) return false;
+    }
+    return Bitset_count(set) == count && Bitset_isEmpty(set) == (count == 0);
+}
+
+static void test_bitset_operations(void) {
+    static const uint32_t sizes[] = { 0, 1, 63, 64, 65, 255, 256, 257, 1000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        uint32_t size = sizes[i];
+        Bitset* a = Bitset_create(size);
+        Bitset* b = Bitset_create(size);
+        bool* ma = (bool*)calloc(size + 1, sizeof(bool));
+        bool* mb = (bool*)calloc(size + 1, sizeof(bool));
+        CHECK(a && a->word_count % BITSET_BLOCK_WORDS == 0 && ((uintptr_t)a->words & 31) == 0);
+        CHECK(Matches(a, ma));
+
+        Bitset_fill(a);
+        for (uint32_t j = 0; j < size; j++) ma[j] = true;
+        CHECK(Matches(a, ma));
+
+        for (int round = 0; round < 20; round++) {
+            RandomFill(a, ma);
+            RandomFill(b, mb);
+            bool intersects = false;
+            for (uint32_t j = 0; j < size; j++) intersects = intersects || (ma[j] && mb[j]);
+            CHECK(Bitset_intersects(a, b) == intersects);
+
+            Bitset* u = Bitset_clone(a);
+            Bitset_union(u, b);
+            Bitset* n = Bitset_clone(a);
+            Bitset_intersect(n, b);
+            Bitset* d = Bitset_clone(a);
+            Bitset_subtract(d, b);
+            bool* mu = (bool*)calloc(size + 1, sizeof(bool));
+            bool* mn = (bool*)calloc(size + 1, sizeof(bool));
+            bool* md = (bool*)calloc(size + 1, sizeof(bool));
+            for (uint32_t j = 0; j < size; j++) {
+                mu[j] = ma[j] || mb[j];
+                mn[j] = ma[j] && mb[j];
+                md[j] = ma[j] && !mb[j];
+            }
+            CHECK(Matches(u, mu) && Matches(n, mn) && Matches(d, md));
+
+            // Iteration visits exactly the members, in order
+            uint32_t expected = 0, visited = 0;
+            bool ordered = true;
+            for (uint32_t bit = Bitset_next(a, 0); bit != BITSET_NONE; bit = Bitset_next(a, bit + 1)) {
+                while (expected < size && !ma[expected]) expected++;
+                ordered = ordered && bit == expected;
+                expected++;
+                visited++;
+            }
+            CHECK(ordered && visited == Bitset_count(a));
+
+            Bitset_copy(u, a);
+            CHECK(Bitset_equals(u, a) && Bitset_hash(u) == Bitset_hash(a));
+
+            Bitset_destroy(u);
+            Bitset_destroy(n);
+            Bitset_destroy(d);
+            free(mu);
+            free(mn);
+            free(md);
+        }
+        CHECK(Bitset_next(a, size) == BITSET_NONE);
+        free(ma);
+        free(mb);
+        Bitset_destroy(a);
+        Bitset_destroy(b);
+    }
+}
+
+// Identifiers [A-Za-z_][A-Za-z0-9_]* (accept 1) and integers [0-9]+
+// (accept 2) over all 256 bytes
+static Dfa* IdentifierDfa(void) {
+    Dfa* dfa = Dfa_create(3, DFA_BYTE_SYMBOLS);
+    for (uint32_t s = 0; s < 3; s++) {
+        for (uint32_t b = 0; b < DFA_BYTE_SYMBOLS; b++) Dfa_setTransition(dfa, s, b, DFA_NO_STATE);
+    }
+    for (uint32_t b = 0; b < DFA_BYTE_SYMBOLS; b++) {
+        bool letter = (b >= 'a' && b <= 'z') || (b >= 'A' && b <= 'Z') || b == '_';
+        bool digit = b >= '0' && b <= '9';
+        if (letter) Dfa_setTransition(dfa, 0, b, 1);
+        if (letter || digit) Dfa_setTransition(dfa, 1, b, 1);
+        if (digit) {
+            Dfa_setTransition(dfa, 0, b, 2);
+            Dfa_setTransition(dfa, 2, b, 2);
+        }
+    }
+    dfa->accepts[1] = 1;
+    dfa->accepts[2] = 2;
+    return dfa;
+}
+
+static void test_byte_classes(void) {
+    Dfa* dfa = IdentifierDfa();
+    ByteClasses classes;
+    CHECK(ByteClasses_fromDfa(&classes, dfa));
+
+    // Letters, digits and everything else
+    CHECK(classes.count == 3);
+    CHECK(classes.map['a'] == classes.map['Z'] && classes.map['a'] == classes.map['_']);
+    CHECK(classes.map['0'] == classes.map['9'] && classes.map['0'] != classes.map['a']);
+    CHECK(classes.map[' '] == classes.map[0xFF] && classes.map[' '] != classes.map['0']);
+    for (uint32_t c = 0; c < classes.count; c++) {
+        CHECK(classes.map[classes.representative[c]] == c);
+    }
+
+    Dfa* compressed = Dfa_compress(dfa, &classes);
+    CHECK(compressed && compressed->symbol_count == 3);
+
+    static const char* inputs[] = { "name_42 rest", "123abc", "", "!x", "_", "9", "a\xff" };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        uint32_t accept_full, accept_compressed;
+        size_t length = strlen(inputs[i]);
+        size_t full = Dfa_longestMatch(dfa, NULL, inputs[i], length, &accept_full);
+        size_t small = Dfa_longestMatch(compressed, &classes, inputs[i], length, &accept_compressed);
+        CHECK(full == small && accept_full == accept_compressed);
+    }
+    uint32_t accepts;
+    CHECK(Dfa_longestMatch(dfa, NULL, "name_42 rest", 12, &accepts) == 7 && accepts == 1);
+    CHECK(Dfa_longestMatch(dfa, NULL, "123abc", 6, &accepts) == 3 && accepts == 2);
+    CHECK(Dfa_longestMatch(dfa, NULL, "!x", 2, &accepts) == 0 && accepts == 0);
+
+    Dfa_destroy(compressed);
+    Dfa_destroy(dfa);
+}
+
+static void test_random_classes(void) {
+    // Random automata over a few bytes: compression never changes a match
+    uint32_t mismatches = 0;
+    for (int round = 0; round < 200; round++) {
+        uint32_t states = 1 + NextRandom(6);
+        uint32_t symbols = 1 + NextRandom(DFA_BYTE_SYMBOLS);
+        Dfa* dfa = Dfa_create(states, symbols);
+        for (uint32_t s = 0; s < states; s++) {
+            dfa->accepts[s] = NextRandom(2);
+            for (uint32_t b = 0; b < symbols; b++) {
+                // Few distinct columns so classes are shared
+                uint32_t target = (b * 7 + s) % 5 == 0 ? DFA_NO_STATE : (b % 4 + s) % states;
+                Dfa_setTransition(dfa, s, b, target);
+            }
+        }
+        ByteClasses classes;
+        ByteClasses_fromDfa(&classes, dfa);
+        Dfa* compressed = Dfa_compress(dfa, &classes);
+
+        unsigned char text[32];
+        for (int t = 0; t < 20; t++) {
+            for (size_t i = 0; i < sizeof(text); i++) text[i] = (unsigned char)NextRandom(DFA_BYTE_SYMBOLS);
+            uint32_t a, b;
+            size_t full = Dfa_longestMatch(dfa, NULL, (const char*)text, sizeof(text), &a);
+            size_t small = Dfa_longestMatch(compressed, &classes, (const char*)text, sizeof(text), &b);
+            if (full != small || a != b) mismatches++;
+        }
+        Dfa_destroy(compressed);
+        Dfa_destroy(dfa);
+    }
+    CHECK(mismatches == 0);
+
+    ByteClasses identity;
+    ByteClasses_identity(&identity);
+    CHECK(identity.count == DFA_BYTE_SYMBOLS && identity.map[200] == 200);
+    CHECK(!ByteClasses_fromDfa(&identity, NULL));
+}
+
+int main(void) {
+    TEST_RUN(test_bitset_operations);
+    TEST_RUN(test_byte_classes);
+    TEST_RUN(test_random_classes);
+    return Test_finish("byte_classes");
+}
@@ -0,0 +1,113 @@
+// Generated classification tables: operator precedence by lexeme,
+// operator categories and forms, token categories, names and closing
+// types.
+#include "core/tokenizer/symbols/sym_intern.h"
+#include "core/tokenizer/symbols/sym_value.h"
+#include "test.h"
+
+static Token BinaryToken(LexemeId lexeme) {
+    Token token;
+    memset(&token, 0, sizeof(token));
+    token.type = TOKEN_EXPR_BINARY;
+    token.lexeme = lexeme;
+    return token;
+}
+
+static void test_precedence_matches_operators(void) {
+    // Every lexeme with an operator reading ranks as that operator does
+    int checked = 0;
+    for (LexemeId id = 1; id < LEXEME_RESERVED_COUNT; id++) {
+        OperatorType op;
+        Token token = BinaryToken(id);
+        if (Lexeme_toOperator(id, &op)) {
+            CHECK(GetOperatorPrecedence(&token) == OperatorType_getPrecedence(op));
+            checked++;
+        } else {
+            CHECK(GetOperatorPrecedence(&token) == 0);
+        }
+    }
+    CHECK(checked >= 38);
+
+    // The old scale's order survives: * and / above + and -
+    Token star = BinaryToken(LEXEME_STAR), slash = BinaryToken(LEXEME_SLASH);
+    Token plus = BinaryToken(LEXEME_PLUS), minus = BinaryToken(LEXEME_MINUS);
+    CHECK(GetOperatorPrecedence(&star) == PREC_MULTIPLICATIVE);
+    CHECK(GetOperatorPrecedence(&slash) == PREC_MULTIPLICATIVE);
+    CHECK(GetOperatorPrecedence(&plus) == PREC_ADDITIVE && GetOperatorPrecedence(&minus) == PREC_ADDITIVE);
+    CHECK(PREC_MULTIPLICATIVE > PREC_ADDITIVE && PREC_ADDITIVE > PREC_SHIFT);
+}
+
+static void test_precedence_edges(void) {
+    CHECK(GetOperatorPrecedence(NULL) == -1);
+
+    // Not a binary expression token
+    Token token = BinaryToken(LEXEME_PLUS);
+    token.type = TOKEN_LITERAL_IDENTIFIER;
+    CHECK(GetOperatorPrecedence(&token) == -1);
+
+    // Binary tokens without an operator lexeme, including interned ids
+    // past the table
+    token = BinaryToken(LEXEME_NONE);
+    CHECK(GetOperatorPrecedence(&token) == 0);
+    token = BinaryToken(OPERATOR_LEXEME_LIMIT + 5);
+    CHECK(GetOperatorPrecedence(&token) == 0);
+    token = BinaryToken(LEXEME_SEMICOLON);
+    CHECK(GetOperatorPrecedence(&token) == 0);
+
+    // Tokens created from a spelling find their lexeme
+    Token* shift = Token_create(TOKEN_EXPR_BINARY, "<<");
+    CHECK(GetOperatorPrecedence(shift) == PREC_SHIFT);
+    Token_destroy(shift);
+}
+
+static void test_operator_tables(void) {
+    CHECK(OperatorType_getCategory(OP_MODULO) == OP_CATEGORY_ARITHMETIC);
+    CHECK(OperatorType_getCategory(OP_SHL_ASSIGN) == OP_CATEGORY_ASSIGNMENT);
+    CHECK(OperatorType_getCategory(OP_SHIFT_RIGHT) == OP_CATEGORY_BITWISE);
+    CHECK(OperatorType_getCategory(OP_LOGICAL_NOT) == OP_CATEGORY_LOGICAL);
+    CHECK(OperatorType_getCategory(OP_GREATER_EQUAL) == OP_CATEGORY_COMPARISON);
+    CHECK(OperatorType_getCategory(OP_DECREMENT) == OP_CATEGORY_INCREMENT);
+    CHECK(OperatorType_getCategory(OP_MEMBER_ARROW) == OP_CATEGORY_MEMBER);
+    CHECK(OperatorType_getCategory(OP_CONDITIONAL) == OP_CATEGORY_OTHER);
+
+    // The forms the parser and validator accept
+    uint32_t prefix = 0, postfix = 0, ternary = 0, infix = 0;
+    for (int op = 0; op < OPERATOR_TYPE_COUNT; op++) {
+        CHECK(OperatorType_hasForm((OperatorType)op, OP_FORM_PREFIX | OP_FORM_INFIX | OP_FORM_POSTFIX | OP_FORM_TERNARY));
+        prefix += OperatorType_hasForm((OperatorType)op, OP_FORM_PREFIX);
+        postfix += OperatorType_hasForm((OperatorType)op, OP_FORM_POSTFIX);
+        ternary += OperatorType_hasForm((OperatorType)op, OP_FORM_TERNARY);
+        infix += OperatorType_hasForm((OperatorType)op, OP_FORM_INFIX);
+    }
+    CHECK(prefix == 9 && postfix == 2 && ternary == 1);
+    CHECK(infix == OPERATOR_TYPE_COUNT - 8);
+    CHECK(OperatorType_hasForm(OP_SUBTRACT, OP_FORM_PREFIX) && OperatorType_hasForm(OP_SUBTRACT, OP_FORM_INFIX));
+    CHECK(OperatorType_hasForm(OP_INCREMENT, OP_FORM_POSTFIX) && !OperatorType_hasForm(OP_INCREMENT, OP_FORM_INFIX));
+    CHECK(!OperatorType_hasForm(OP_SIZEOF, OP_FORM_INFIX));
+    CHECK(!OperatorType_hasForm(OP_COMMA, OP_FORM_PREFIX));
+}
+
+static void test_token_type_tables(void) {
+    CHECK(TokenType_getCategory(TOKEN_LITERAL_INTEGER) == TOKEN_CATEGORY_LITERAL);
+    CHECK(TokenType_getCategory(TOKEN_EXPR_BINARY) == TOKEN_CATEGORY_EXPRESSION);
+    CHECK(TokenType_getCategory(TOKEN_PUNCT_SEMICOLON) == TOKEN_CATEGORY_PUNCTUATION);
+    CHECK(TokenType_getCategory(TOKEN_TYPE_INT) == TOKEN_CATEGORY_TYPE);
+    CHECK(TokenType_getCategory((TokenType)TOKEN_TYPE_COUNT) == TOKEN_CATEGORY_SPECIAL);
+    CHECK_STR(TokenType_toString(TOKEN_LITERAL_IDENTIFIER), "IDENTIFIER");
+    CHECK_STR(TokenType_toString((TokenType)-1), "UNKNOWN");
+
+    // Every type has a name, and closing types close something
+    for (int type = 0; type < TOKEN_TYPE_COUNT; type++) {
+        CHECK(TokenType_toString((TokenType)type)[0] != '\0');
+    }
+    CHECK(TokenType_requiresClosing(TOKEN_SCOPE_BEGIN));
+    CHECK(!TokenType_requiresClosing(TOKEN_LITERAL_INTEGER));
+}
+
+int main(void) {
+    TEST_RUN(test_precedence_matches_operators);
+    TEST_RUN(test_precedence_edges);
+    TEST_RUN(test_operator_tables);
+    TEST_RUN(test_token_type_tables);
+    return Test_finish("classify");
+}
@@ -0,0 +1,287 @@
+// Constant folding: each expression folds to the value and type C gives
+// it, the cases C leaves undefined stay unfolded, a constant condition
+// converts its selected arm to the arms' common type, literals are read
+// the way C spells them and values convert the way C converts them.
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/parser/expr_parser.h"
+#include "core/ast/validator/ast_validator.h"
+#include "compiler/optimizer/fold/const_fold.h"
+#include "test.h"
+#include <stdlib.h>
+
+// Expected outcome of one expression: the root's value, or NOT_FOLDED
+typedef enum { NOT_FOLDED, INT, UINT, FLOAT } Expect;
+
+typedef struct FoldCase {
+    const char* source;
+    Expect expect;
+    int bit_width;
+    int64_t integer;
+    double real;
+} FoldCase;
+
+static const FoldCase arithmetic_cases[] = {
+    { "2 + 3 * 4", INT, 32, 14, 0 },
+    { "(1 + 2) * (3 + 4) - 5", INT, 32, 16, 0 },
+    { "2147483647 + 1", INT, 32, INT32_MIN, 0 },
+    { "-2147483647 - 1", INT, 32, INT32_MIN, 0 },
+    { "-(-2147483647 - 1)", INT, 32, INT32_MIN, 0 },
+    { "4294967295u + 1", UINT, 32, 0, 0 },
+    { "0xFFFFFFFF", UINT, 32, 4294967295ll, 0 },
+    { "3000000000", INT, 64, 3000000000ll, 0 },
+    { "9223372036854775807 + 1", INT, 64, INT64_MIN, 0 },
+    { "18446744073709551615u * 2", UINT, 64, -2, 0 },
+    { "-1 < 0u", INT, 32, 0, 0 },
+    { "-1L < 0u", INT, 32, 1, 0 },
+    { "-1 + 0u", UINT, 32, 4294967295ll, 0 },
+    { "1 << 31", INT, 32, INT32_MIN, 0 },
+    { "1L << 32", INT, 64, 4294967296ll, 0 },
+    { "1 << 2L", INT, 32, 4, 0 },
+    { "-8 >> 1", INT, 32, -4, 0 },
+    { "0x80000000 >> 4", UINT, 32, 0x08000000, 0 },
+    { "-7 / 2", INT, 32, -3, 0 },
+    { "-7 % 2", INT, 32, -1, 0 },
+    { "4294967295u / 2", UINT, 32, 2147483647, 0 },
+    { "~0", INT, 32, -1, 0 },
+    { "~0u", UINT, 32, 4294967295ll, 0 },
+    { "0b101 | 0x10 ^ 3 & 6", INT, 32, 0x17, 0 },
+    { "!5", INT, 32, 0, 0 },
+    { "!0.0", INT, 32, 1, 0 },
+    { "'a' + 1", INT, 32, 98, 0 },
+    { "'\\n' * 2", INT, 32, 20, 0 },
+    { "3 > 2 == 1", INT, 32, 1, 0 },
+    { "1, 2 + 3", INT, 32, 5, 0 },
+    { "1.5 * 2", FLOAT, 0, 0, 3.0 },
+    { "7 / 2.0", FLOAT, 0, 0, 3.5 },
+    { "-0x1p-2", FLOAT, 0, 0, -0.25 },
+    { "1 == 1.0f", INT, 32, 1, 0 },
+    { "4294967295u + 1.0", FLOAT, 0, 0, 4294967296.0 },
+};
+
+static const FoldCase undefined_cases[] = {
+    { "1 << 32", NOT_FOLDED, 0, 0, 0 },
+    { "1 << -1", NOT_FOLDED, 0, 0, 0 },
+    { "7 / 0", NOT_FOLDED, 0, 0, 0 },
+    { "7 % 0", NOT_FOLDED, 0, 0, 0 },
+    { "(-2147483647 - 1) / -1", NOT_FOLDED, 0, 0, 0 },
+    { "(-2147483647 - 1) % -1", NOT_FOLDED, 0, 0, 0 },
+    { "1.0 / 0.0", NOT_FOLDED, 0, 0, 0 },
+    { "1e308 * 10", NOT_FOLDED, 0, 0, 0 },
+    { "1.5 % 2", NOT_FOLDED, 0, 0, 0 },
+    { "1.5 << 2", NOT_FOLDED, 0, 0, 0 },
+    { "x, 3", NOT_FOLDED, 0, 0, 0 },
+    { "a * 4 + 16", NOT_FOLDED, 0, 0, 0 },
+    { "x = 2 + 3", NOT_FOLDED, 0, 0, 0 },
+    { "x++ + 1", NOT_FOLDED, 0, 0, 0 },
+};
+
+static const FoldCase logical_cases[] = {
+    { "0 && x", INT, 32, 0, 0 },
+    { "1 || x", INT, 32, 1, 0 },
+    { "1 && x", NOT_FOLDED, 0, 0, 0 },
+    { "2 && 0.5", INT, 32, 1, 0 },
+};
+
+// The result of ?: has the arms' common type whichever arm is selected,
+// so an arm that is not a constant leaves the type unknown
+static const FoldCase conditional_cases[] = {
+    { "1 ? 2 : 3.0", FLOAT, 0, 0, 2.0 },
+    { "0 ? 2.5 : 7", FLOAT, 0, 0, 7.0 },
+    { "(1 ? 2 : 3.0) / 4", FLOAT, 0, 0, 0.5 },
+    { "0 ? 1u : -1", UINT, 32, 4294967295ll, 0 },
+    { "1 ? -1 : 0u", UINT, 32, 4294967295ll, 0 },
+    { "1 ? 'a' : 2", INT, 32, 97, 0 },
+    { "1 ? 5 : 2L", INT, 64, 5, 0 },
+    { "0 ? 1 : 2 + 3", INT, 32, 5, 0 },
+    { "1 ? 10 : y", NOT_FOLDED, 0, 0, 0 },
+    { "0 ? x : 20 + 2", NOT_FOLDED, 0, 0, 0 },
+    { "1 ? x : 2", NOT_FOLDED, 0, 0, 0 },
+    { "c ? 1 : 2", NOT_FOLDED, 0, 0, 0 },
+};
+
+static void Lex(const char* source, size_t length, StringInterner* interner, TokenBuffer* tokens) {
+    TokenBuffer_clear(tokens);
+    Lexer* lexer = Lexer_createFromBuffer(source, length, "const_fold");
+    Lexer_setInterner(lexer, interner);
+    Lexer_fillBuffer(lexer, tokens);
+    Lexer_destroy(lexer);
+    // Drop the trailing EOF
+    if (tokens->count && tokens->types[tokens->count - 1] == TOKEN_EOF) tokens->count--;
+}
+
+static bool FoldsAsExpected(const FoldCase* test, ExprParser* parser, ConstantFolder* folder) {
+    StringInterner* interner = StringInterner_create();
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    AstPool* pool = AstPool_create(0);
+
+    Lex(test->source, strlen(test->source), interner, tokens);
+    AstNodeId root = ExprParser_build(parser, tokens, 0, tokens->count, pool);
+    bool ok = root != AST_NODE_NONE && ConstantFolder_run(folder, pool, tokens);
+
+    const LiteralValue* value = ok ? ConstantFolder_value(folder, root) : NULL;
+    const AstNode* node = ok ? AstPool_node(pool, root) : NULL;
+    if (!ok) {
+        // Falls through to the message
+    } else if (test->expect == NOT_FOLDED) {
+        ok = !value && node->kind != AST_NODE_LITERAL;
+    } else if (test->expect == FLOAT) {
+        ok = value && value->type == VAL_FLOAT && value->data.float_val == test->real;
+    } else {
+        ok = value && value->type == VAL_INTEGER && value->data.int_val == test->integer &&
+             value->bit_width == test->bit_width && value->is_unsigned == (test->expect == UINT);
+    }
+    // A folded root is a literal node
+    ok = ok && (!value || node->kind == AST_NODE_LITERAL);
+
+    if (!ok) {
+        char* text = value ? ValueToString(value) : NULL;
+        fprintf(stderr, "    fold %-28s -> %s\n", test->source, text ? text : "not folded");
+        free(text);
+    }
+    AstPool_destroy(pool);
+    TokenBuffer_destroy(tokens);
+    StringInterner_destroy(interner);
+    return ok;
+}
+
+static void CheckCases(const FoldCase* cases, size_t count) {
+    ExprParser* parser = ExprParser_create();
+    ConstantFolder* folder = ConstantFolder_create();
+    for (size_t i = 0; i < count; i++) CHECK(FoldsAsExpected(&cases[i], parser, folder));
+    ConstantFolder_destroy(folder);
+    ExprParser_destroy(parser);
+}
+
+static void test_arithmetic_follows_c(void) {
+    CheckCases(arithmetic_cases, sizeof(arithmetic_cases) / sizeof(arithmetic_cases[0]));
+}
+
+static void test_undefined_results_stay_unfolded(void) {
+    CheckCases(undefined_cases, sizeof(undefined_cases) / sizeof(undefined_cases[0]));
+}
+
+static void test_logical_operators_short_circuit(void) {
+    CheckCases(logical_cases, sizeof(logical_cases) / sizeof(logical_cases[0]));
+}
+
+static void test_conditional_takes_common_type(void) {
+    CheckCases(conditional_cases, sizeof(conditional_cases) / sizeof(conditional_cases[0]));
+}
+
+// Folded statements of a larger source still validate, and every
+// constant subtree is folded
+static void test_folded_trees_validate(void) {
+    enum { STATEMENTS = 2000 };
+    char* source = (char*)malloc(STATEMENTS * 64);
+    size_t used = 0;
+    for (unsigned i = 0; i < STATEMENTS; i++) {
+        unsigned k = i % 100;
+        used += (size_t)sprintf(source + used, i % 2 ? "v%u = %u * 4 + 16;\n" : "v%u = a * 4 + 16 * %u - (%u << 2);\n",
+                                k, k, k);
+    }
+
+    StringInterner* interner = StringInterner_create();
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    AstPool* pool = AstPool_create(0);
+    ExprParser* parser = ExprParser_create();
+    ConstantFolder* folder = ConstantFolder_create();
+    AstValidator* validator = AstValidator_create(NULL);
+    AstNodeId roots[STATEMENTS];
+    Lex(source, used, interner, tokens);
+
+    uint32_t root_count = 0, start = 0;
+    for (uint32_t i = 0; i < tokens->count && root_count < STATEMENTS; i++) {
+        if (tokens->types[i] != TOKEN_PUNCT_SEMICOLON) continue;
+        AstNodeId root = ExprParser_build(parser, tokens, start, i, pool);
+        if (root != AST_NODE_NONE) roots[root_count++] = root;
+        start = i + 1;
+    }
+    CHECK(root_count == STATEMENTS);
+    CHECK(ConstantFolder_run(folder, pool, tokens));
+    CHECK(folder->folded == STATEMENTS * 2);
+    AstValidator_run(validator, pool, tokens, roots, root_count);
+    CHECK(validator->diagnostic_count == 0);
+
+    AstValidator_destroy(validator);
+    ConstantFolder_destroy(folder);
+    ExprParser_destroy(parser);
+    AstPool_destroy(pool);
+    TokenBuffer_destroy(tokens);
+    StringInterner_destroy(interner);
+    free(source);
+}
+
+static bool ReadsAs(TokenType type, const char* text, ValueType expect, int64_t integer) {
+    LiteralValue value;
+    memset(&value, 0, sizeof(value));
+    bool ok = ParseLiteralValue(&value, type, text, strlen(text)) && value.type == expect;
+    if (ok && expect == VAL_CHAR) ok = value.data.char_val == (char)integer;
+    if (ok && expect == VAL_INTEGER) ok = value.data.int_val == integer;
+    if (ok && expect == VAL_STRING) ok = strcmp(value.data.string_val, "a\tb\"") == 0;
+    if (value.type == VAL_STRING) free(value.data.string_val);
+    return ok;
+}
+
+static void test_literal_spellings(void) {
+    CHECK(ReadsAs(TOKEN_LITERAL_CHAR, "'\\n'", VAL_CHAR, '\n'));
+    CHECK(ReadsAs(TOKEN_LITERAL_CHAR, "'\\x41'", VAL_CHAR, 'A'));
+    CHECK(ReadsAs(TOKEN_LITERAL_STRING, "\"a\\tb\\\"\"", VAL_STRING, 0));
+    CHECK(ReadsAs(TOKEN_LITERAL_INTEGER, "0777", VAL_INTEGER, 511));
+    CHECK(ReadsAs(TOKEN_LITERAL_INTEGER, "0x10ull", VAL_INTEGER, 16));
+
+    LiteralValue rejected;
+    memset(&rejected, 0, sizeof(rejected));
+    CHECK(!ParseLiteralValue(&rejected, TOKEN_LITERAL_INTEGER, "99999999999999999999", 20));
+    CHECK(!ParseLiteralValue(&rejected, TOKEN_LITERAL_INTEGER, "12uu", 4));
+}
+
+static void test_value_conversions(void) {
+    LiteralValue value;
+
+    memset(&value, 0, sizeof(value));
+    value.type = VAL_FLOAT;
+    value.data.float_val = -3.99;
+    CHECK(ConvertValue(&value, VAL_INTEGER) && value.data.int_val == -3);
+
+    // Out of range for the target width: unchanged
+    value.type = VAL_FLOAT;
+    value.data.float_val = 1e20;
+    value.bit_width = 32;
+    CHECK(!ConvertValue(&value, VAL_INTEGER) && value.type == VAL_FLOAT);
+
+    memset(&value, 0, sizeof(value));
+    value.type = VAL_INTEGER;
+    value.data.int_val = 300;
+    CHECK(ConvertValue(&value, VAL_CHAR) && value.data.char_val == 44);
+
+    // Only a zero integer is a null pointer constant
+    value.type = VAL_INTEGER;
+    value.data.int_val = 1;
+    CHECK(!ConvertValue(&value, VAL_NULL));
+    value.data.int_val = 0;
+    CHECK(ConvertValue(&value, VAL_NULL) && value.type == VAL_NULL);
+
+    memset(&value, 0, sizeof(value));
+    value.type = VAL_BOOL;
+    value.data.bool_val = true;
+    CHECK(ConvertValue(&value, VAL_FLOAT) && value.data.float_val == 1.0);
+
+    memset(&value, 0, sizeof(value));
+    value.type = VAL_INTEGER;
+    value.data.int_val = -1;
+    value.is_unsigned = true;
+    value.bit_width = 64;
+    CHECK(ConvertValue(&value, VAL_STRING) && strcmp(value.data.string_val, "18446744073709551615") == 0);
+    CHECK(ConvertValue(&value, VAL_BOOL) && value.data.bool_val);
+}
+
+int main(void) {
+    TEST_RUN(test_arithmetic_follows_c);
+    TEST_RUN(test_undefined_results_stay_unfolded);
+    TEST_RUN(test_logical_operators_short_circuit);
+    TEST_RUN(test_conditional_takes_common_type);
+    TEST_RUN(test_folded_trees_validate);
+    TEST_RUN(test_literal_spellings);
+    TEST_RUN(test_value_conversions);
+    return Test_finish("const_fold");
+}
@@ -0,0 +1,167 @@
+// CompileDriver: expression files compile and declare their globals,
+// C declarations, definitions and directives are passed over with one
+// note instead of failing the file, real syntax errors still fail it,
+// diagnostics print in source order, and many files on several threads
+// keep their results in input order.
+#include "compiler/driver/driver.h"
+#include "test.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct TempFile {
+    char path[64];
+} TempFile;
+
+static void TempFile_write(TempFile* file, const char* text) {
+    strcpy(file->path, "/tmp/gosilang_test_driver_XXXXXX");
+    int fd = mkstemp(file->path);
+    CHECK(fd >= 0 && write(fd, text, strlen(text)) == (ssize_t)strlen(text));
+    close(fd);
+}
+
+// Compiles one file and returns the driver holding its result
+static CompileDriver* CompileOne(const char* text, bool* ok) {
+    TempFile file;
+    TempFile_write(&file, text);
+    CompileOptions options = { .threads = 1, .validate = true, .fold = true };
+    CompileDriver* driver = CompileDriver_create(&options);
+    const char* paths[] = { file.path };
+    *ok = CompileDriver_run(driver, paths, 1);
+    unlink(file.path);
+    return driver;
+}
+
+static bool HasMessage(const CompileResult* result, const char* text) {
+    return result->messages && strstr(result->messages, text) != NULL;
+}
+
+static bool MessagesInOrder(const CompileResult* result, const char* first, const char* second) {
+    const char* a = result->messages ? strstr(result->messages, first) : NULL;
+    const char* b = result->messages ? strstr(result->messages, second) : NULL;
+    return a && b && a < b;
+}
+
+static void test_expressions_declare_globals(void) {
+    bool ok;
+    CompileDriver* driver = CompileOne("x = 1 + 2; y = x * 3; x = 9; (a + b) * c;", &ok);
+    const CompileResult* result = &driver->results[0];
+    CHECK(ok && result->ok);
+    CHECK(result->statements == 4 && result->skipped == 0 && result->errors == 0);
+    CHECK(result->globals == 2 && result->folded == 1);
+    CHECK(result->messages == NULL);
+
+    SymbolTableEntry* x = SharedScope_find(driver->globals, "x", 1, Lexeme_hash("x", 1));
+    CHECK(x && x->value.type == VAL_INTEGER && x->value.data.int_val == 3);
+    CompileDriver_destroy(driver);
+}
+
+static void test_c_declarations_are_passed_over(void) {
+    static const char* const text =
+        "#include <stdio.h>\n"
+        "#define N 10\n"
+        "typedef unsigned long size_type;\n"
+        "struct point { int x, y; };\n"
+        "enum color { RED, GREEN };\n"
+        "static const int limit = 4 * N;\n"
+        "size_type count;\n"
+        "Future* spawn(WorkPool* pool, int n);\n"
+        "Node *head = 0, *tail;\n"
+        "__attribute__((noinline)) static int area(int w, int h) {\n"
+        "    int a = w * h;\n"
+        "    if (a > 0) { return a; }\n"
+        "    return 0;\n"
+        "}\n"
+        "x = 1 + 2;\n"
+        "y = x * 3;\n";
+    bool ok;
+    CompileDriver* driver = CompileOne(text, &ok);
+    const CompileResult* result = &driver->results[0];
+    CHECK(ok && result->ok && result->errors == 0);
+    CHECK(result->statements == 2);
+    CHECK(result->skipped == 10);
+    CHECK(result->globals == 2);
+    CHECK(HasMessage(result, ":1:1: note: passed over 10 declarations"));
+    CompileDriver_destroy(driver);
+}
+
+// Expressions that look like declarations only at first glance
+static void test_expressions_that_start_like_declarations(void) {
+    bool ok;
+    CompileDriver* driver = CompileOne("a * b + c; p * q * 2; n = sizeof x; m = -k;", &ok);
+    const CompileResult* result = &driver->results[0];
+    CHECK(ok && result->statements == 4 && result->skipped == 0);
+    CompileDriver_destroy(driver);
+}
+
+static void test_syntax_errors_still_fail(void) {
+    bool ok;
+    CompileDriver* driver = CompileOne("int x;\nx = 1 +;\ny = (2;\n", &ok);
+    const CompileResult* result = &driver->results[0];
+    CHECK(!ok && !result->ok);
+    CHECK(result->errors == 2 && result->skipped == 1);
+    CHECK(HasMessage(result, ":2:7: error: expected an operand"));
+    CHECK(HasMessage(result, "note: passed over 1 declarations"));
+    CompileDriver_destroy(driver);
+
+    // Lexer errors, syntax errors and notes print in source order
+    driver = CompileOne("int x;\nx = 1 +;\ny = 2 @ 3;\n", &ok);
+    result = &driver->results[0];
+    CHECK(!ok && result->errors >= 2);
+    CHECK(MessagesInOrder(result, ":1:1: note:", ":2:7: error:"));
+    CHECK(MessagesInOrder(result, ":2:7: error:", ":3:7: error: invalid token"));
+    CompileDriver_destroy(driver);
+
+    // A file that cannot be read fails alone
+    CompileOptions options = { .threads = 1 };
+    driver = CompileDriver_create(&options);
+    const char* paths[] = { "/nonexistent/gosilang_test.c" };
+    CHECK(!CompileDriver_run(driver, paths, 1));
+    CHECK(HasMessage(&driver->results[0], "error: cannot read file"));
+    CompileDriver_destroy(driver);
+}
+
+static void test_many_files_in_order(void) {
+    enum { FILES = 24 };
+    TempFile files[FILES];
+    const char* paths[FILES];
+    char text[128];
+    for (int i = 0; i < FILES; i++) {
+        snprintf(text, sizeof(text), "int unused_%d;\nshared = %d;\nonly_%d = %d * 2;\n%s", i, i, i, i,
+                 i == 7 ? "broken = ;\n" : "");
+        TempFile_write(&files[i], text);
+        paths[i] = files[i].path;
+    }
+
+    static const uint32_t thread_counts[] = { 1, 2, 4 };
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        CompileOptions options = { .threads = thread_counts[t], .max_in_flight = 3, .validate = true, .fold = true };
+        CompileDriver* driver = CompileDriver_create(&options);
+        CHECK(!CompileDriver_run(driver, paths, FILES));
+
+        uint32_t globals = 0, wrong = 0;
+        for (int i = 0; i < FILES; i++) {
+            const CompileResult* result = &driver->results[i];
+            globals += result->globals;
+            if (result->path != paths[i] || result->ok != (i != 7) || result->skipped != 1) wrong++;
+        }
+        CHECK(wrong == 0);
+        CHECK(globals == FILES + 1);   // Every only_N and one file's shared
+        CompileDriver_destroy(driver);
+    }
+    for (int i = 0; i < FILES; i++) unlink(files[i].path);
+}
+
+static void test_phase_names(void) {
+    CHECK_STR(CompilePhase_toString(COMPILE_PHASE_PARSE), "parse");
+    CHECK_STR(CompilePhase_toString(COMPILE_PHASE_COUNT), "unknown");
+}
+
+int main(void) {
+    TEST_RUN(test_expressions_declare_globals);
+    TEST_RUN(test_c_declarations_are_passed_over);
+    TEST_RUN(test_expressions_that_start_like_declarations);
+    TEST_RUN(test_syntax_errors_still_fail);
+    TEST_RUN(test_many_files_in_order);
+    TEST_RUN(test_phase_names);
+    return Test_finish("driver");
+}
@@ -0,0 +1,106 @@
+// Shunting-yard parser: postfix order for precedence, associativity,
+// unary and postfix operators, grouping and ternaries, and the errors
+// reported for malformed input.
+#include "core/parser/expr_parser.h"
+#include "core/tokenizer/lexer/lexer.h"
+#include "test.h"
+
+typedef struct Parsed {
+    char postfix[256];
+    const char* error;
+} Parsed;
+
+// Lexes text and renders the parser's postfix output, prefix operators
+// marked with a trailing 'u'
+static Parsed Parse(ExprParser* parser, const char* text) {
+    Parsed parsed = { "", NULL };
+    Lexer* lexer = Lexer_createFromBuffer(text, strlen(text), "expr");
+    TokenBuffer* buffer = TokenBuffer_create(0);
+    Lexer_fillBuffer(lexer, buffer);
+
+    if (!ExprParser_parse(parser, buffer, 0, buffer->count - 1)) {
+        parsed.error = parser->error ? parser->error : "unknown";
+    } else {
+        size_t used = 0;
+        for (uint32_t i = 0; i < parser->output_count; i++) {
+            const ExprItem* item = &parser->output[i];
+            uint32_t length = buffer->lengths[item->token];
+            used += (size_t)snprintf(parsed.postfix + used, sizeof(parsed.postfix) - used, "%s%.*s%s",
+                                     i ? " " : "", (int)length, TokenBuffer_value(buffer, item->token),
+                                     item->kind == EXPR_ITEM_PREFIX ? "u" : "");
+        }
+    }
+    TokenBuffer_destroy(buffer);
+    Lexer_destroy(lexer);
+    return parsed;
+}
+
+static void CheckPostfix(ExprParser* parser, const char* text, const char* expected) {
+    Parsed parsed = Parse(parser, text);
+    if (parsed.error) fprintf(stderr, "'%s': %s\n", text, parsed.error);
+    CHECK_STR(parsed.postfix, expected);
+}
+
+static void test_precedence_and_associativity(void) {
+    ExprParser* parser = ExprParser_create();
+    CheckPostfix(parser, "a + b * c", "a b c * +");
+    CheckPostfix(parser, "a * b + c", "a b * c +");
+    CheckPostfix(parser, "a - b - c", "a b - c -");
+    CheckPostfix(parser, "a = b = c", "a b c = =");
+    CheckPostfix(parser, "a << 1 < b == c & d ^ e | f && g || h",
+                 "a 1 << b < c == d & e ^ f | g && h ||");
+    CheckPostfix(parser, "a += b ? c : d", "a b c d ? +=");
+    CheckPostfix(parser, "a, b = c", "a b c = ,");
+    ExprParser_destroy(parser);
+}
+
+static void test_unary_and_grouping(void) {
+    ExprParser* parser = ExprParser_create();
+    CheckPostfix(parser, "-a * b", "a -u b *");
+    CheckPostfix(parser, "!~x", "x ~u !u");
+    CheckPostfix(parser, "*p + &q", "p *u q &u +");
+    CheckPostfix(parser, "a - -b", "a b -u -");
+    CheckPostfix(parser, "(a + b) * c", "a b + c *");
+    CheckPostfix(parser, "((a))", "a");
+    CheckPostfix(parser, "x++ + ++y", "x ++ y ++u +");
+    CheckPostfix(parser, "a.b->c", "a b . c ->");
+    CheckPostfix(parser, "a ? b : c ? d : e", "a b c d e ? ?");
+    CheckPostfix(parser, "(a ? b : c) + 1", "a b c ? 1 +");
+    ExprParser_destroy(parser);
+}
+
+static void test_errors(void) {
+    ExprParser* parser = ExprParser_create();
+    const char* malformed[] = { "", "a +", "(a", "a)", "a b", "/ a", "a ? b", "a : b", "()", "a ? : b" };
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        Parsed parsed = Parse(parser, malformed[i]);
+        if (!parsed.error) fprintf(stderr, "'%s' parsed as '%s'\n", malformed[i], parsed.postfix);
+        CHECK(parsed.error != NULL);
+    }
+
+    // The parser is reusable after an error
+    CheckPostfix(parser, "a + b", "a b +");
+    ExprParser_destroy(parser);
+}
+
+static void test_deep_nesting(void) {
+    // Grows the operator stack well past its initial capacity
+    char text[4096];
+    size_t used = 0;
+    for (int i = 0; i < 1000; i++) text[used++] = '(';
+    text[used++] = 'x';
+    for (int i = 0; i < 1000; i++) text[used++] = ')';
+    text[used] = '\0';
+    ExprParser* parser = ExprParser_create();
+    CheckPostfix(parser, text, "x");
+    CHECK(parser->stack_capacity >= 1000);
+    ExprParser_destroy(parser);
+}
+
+int main(void) {
+    TEST_RUN(test_precedence_and_associativity);
+    TEST_RUN(test_unary_and_grouping);
+    TEST_RUN(test_errors);
+    TEST_RUN(test_deep_nesting);
+    return Test_finish("expr_parser");
+}
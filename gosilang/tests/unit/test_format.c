@@ -0,0 +1,263 @@
+// Formatting: StringBuffer starts in caller storage and moves to the
+// heap when it outgrows it, failures are sticky, integers match
+// snprintf, doubles read back as themselves in as few digits as %g
+// needs, values format as ValueToString did, and the token dump is byte
+// for byte Token_print's output across its write chunks.
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/tokenizer/symbols/sym_format.h"
+#include "test.h"
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t NextRandom(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void test_buffer_growth(void) {
+    char storage[8];
+    StringBuffer buffer;
+    StringBuffer_initWith(&buffer, storage, sizeof(storage));
+    CHECK(StringBuffer_appendString(&buffer, "abc") == 3);
+    CHECK(StringBuffer_appendChar(&buffer, '-') == 1);
+    CHECK(buffer.data == storage && !buffer.heap);
+    CHECK_STR(buffer.data, "abc-");
+
+    // Outgrowing the caller's array copies the text to the heap
+    CHECK(StringBuffer_appendInt(&buffer, -1234567) == 8);
+    CHECK(buffer.data != storage && buffer.heap);
+    CHECK_STR(buffer.data, "abc--1234567");
+
+    char* text = StringBuffer_detach(&buffer);
+    CHECK_STR(text, "abc--1234567");
+    CHECK(buffer.data == NULL && buffer.length == 0);
+    free(text);
+
+    // Detaching a buffer still in caller storage copies it out
+    StringBuffer_initWith(&buffer, storage, sizeof(storage));
+    StringBuffer_appendUint(&buffer, 42);
+    text = StringBuffer_detach(&buffer);
+    CHECK(text && text != storage);
+    CHECK_STR(text, "42");
+    free(text);
+
+    // A zeroed buffer is empty and detaches to ""
+    StringBuffer empty;
+    memset(&empty, 0, sizeof(empty));
+    text = StringBuffer_detach(&empty);
+    CHECK_STR(text, "");
+    free(text);
+}
+
+static void test_failure_is_sticky(void) {
+    StringBuffer buffer;
+    StringBuffer_init(&buffer);
+    StringBuffer_appendString(&buffer, "kept");
+    CHECK(!StringBuffer_reserve(&buffer, SIZE_MAX / 2));
+    CHECK(buffer.failed);
+    CHECK(StringBuffer_appendString(&buffer, "x") == 0);
+    CHECK(buffer.length == 4);
+    CHECK(StringBuffer_detach(&buffer) == NULL);
+
+    // Clearing starts over
+    StringBuffer_clear(&buffer);
+    CHECK(!buffer.failed && StringBuffer_appendChar(&buffer, 'y') == 1);
+    CHECK_STR(buffer.data, "y");
+    StringBuffer_free(&buffer);
+}
+
+static void test_integers_match_snprintf(void) {
+    static const int64_t edges[] = { 0, 1, -1, 9, 10, 99, 100, -100, 12345, INT32_MAX, INT32_MIN,
+                                     INT64_MAX, INT64_MIN, 1000000000000000000ll };
+    size_t edge_count = sizeof(edges) / sizeof(edges[0]);
+    char out[FORMAT_INT_MAX + 1], expected[32];
+    int wrong = 0;
+    for (size_t i = 0; i < edge_count + 20000; i++) {
+        int64_t value = i < edge_count ? edges[i] : (int64_t)NextRandom() >> (i % 64);
+        out[FormatInt64(out, value)] = '\0';
+        snprintf(expected, sizeof(expected), "%" PRId64, value);
+        if (strcmp(out, expected) != 0) wrong++;
+        out[FormatUint64(out, (uint64_t)value)] = '\0';
+        snprintf(expected, sizeof(expected), "%" PRIu64, (uint64_t)value);
+        if (strcmp(out, expected) != 0) wrong++;
+    }
+    CHECK(wrong == 0);
+}
+
+// Significant digits of a %g or FormatDouble spelling
+static int SignificantDigits(const char* text) {
+    int digits = 0, trailing_zeros = 0;
+    bool leading = true;
+    for (const char* p = text; *p && *p != 'e'; p++) {
+        if (*p < '0' || *p > '9') continue;
+        if (leading && *p == '0') continue;
+        leading = false;
+        digits++;
+        trailing_zeros = *p == '0' ? trailing_zeros + 1 : 0;
+    }
+    return digits - trailing_zeros;
+}
+
+static bool IsShortest(double value) {
+    char out[FORMAT_DOUBLE_MAX + 1];
+    out[FormatDouble(out, value)] = '\0';
+
+    char shortest[40];
+    for (int precision = 1; precision <= 17; precision++) {
+        snprintf(shortest, sizeof(shortest), "%.*g", precision, value);
+        if (strtod(shortest, NULL) == value) break;
+    }
+    bool ok = strtod(out, NULL) == value && SignificantDigits(out) <= SignificantDigits(shortest) &&
+              (strchr(out, '.') || strchr(out, 'e'));
+    if (!ok) fprintf(stderr, "    %.17g formatted as %s, shortest is %s\n", value, out, shortest);
+    return ok;
+}
+
+static void test_doubles_are_shortest(void) {
+    static const double doubles[] = { 0.0, -0.0, 1.0, -2.5, 0.1, 0.2 + 0.1, 3.14, 1e-5, 1.5e-7, 1e15, 1e16,
+                                      123456789012345.6, 1e300, 5e-324, 2.2250738585072014e-308,
+                                      1.7976931348623157e308, 9007199254740993.0, 1.0 / 3.0 };
+    for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++) CHECK(IsShortest(doubles[i]));
+
+    char out[FORMAT_DOUBLE_MAX + 1];
+    out[FormatDouble(out, 3.14)] = '\0';
+    CHECK_STR(out, "3.14");
+    out[FormatDouble(out, 2.0)] = '\0';
+    CHECK(strtod(out, NULL) == 2.0 && strchr(out, '.'));
+
+    // Random bit patterns and values with few decimals
+    int wrong = 0;
+    for (int i = 0; i < 20000; i++) {
+        uint64_t bits = NextRandom();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if (value - value != 0.0) continue;     // NaN or infinite
+        if (!IsShortest(value)) wrong++;
+        if (!IsShortest((double)(int64_t)(bits % 2000001 - 1000000) / 1000.0)) wrong++;
+    }
+    CHECK(wrong == 0);
+}
+
+static void test_values(void) {
+    LiteralValue value;
+    memset(&value, 0, sizeof(value));
+    StringBuffer buffer;
+    StringBuffer_init(&buffer);
+
+    value.type = VAL_INTEGER;
+    value.data.int_val = -1;
+    FormatValue(&buffer, &value);
+    StringBuffer_appendChar(&buffer, ' ');
+    value.is_unsigned = true;
+    value.bit_width = 64;
+    FormatValue(&buffer, &value);
+    StringBuffer_appendChar(&buffer, ' ');
+
+    memset(&value, 0, sizeof(value));
+    value.type = VAL_FLOAT;
+    value.data.float_val = 0.5;
+    FormatValue(&buffer, &value);
+    StringBuffer_appendChar(&buffer, ' ');
+    value.type = VAL_CHAR;
+    value.data.char_val = 'q';
+    FormatValue(&buffer, &value);
+    StringBuffer_appendChar(&buffer, ' ');
+    value.type = VAL_BOOL;
+    value.data.bool_val = false;
+    FormatValue(&buffer, &value);
+    StringBuffer_appendChar(&buffer, ' ');
+    value.type = VAL_NULL;
+    FormatValue(&buffer, &value);
+    StringBuffer_appendChar(&buffer, ' ');
+    value.type = VAL_STRING;
+    value.data.string_val = "text";
+    FormatValue(&buffer, &value);
+    CHECK_STR(buffer.data, "-1 18446744073709551615 0.5 'q' false null text");
+    CHECK(FormatValue(&buffer, NULL) == 0);
+
+    // ValueToString builds on FormatValue
+    value.type = VAL_BOOL;
+    value.data.bool_val = true;
+    char* text = ValueToString(&value);
+    CHECK_STR(text, "true");
+    free(text);
+    StringBuffer_free(&buffer);
+}
+
+static char* ReadAll(FILE* file, size_t* length) {
+    fflush(file);
+    long size = ftell(file);
+    char* data = (char*)malloc((size_t)size + 1);
+    rewind(file);
+    *length = fread(data, 1, (size_t)size, file);
+    data[*length] = '\0';
+    return data;
+}
+
+// More tokens than one dump chunk holds, over many lines
+static void test_dump_matches_token_print(void) {
+    StringBuffer source;
+    StringBuffer_init(&source);
+    for (int i = 0; i < 1500; i++) {
+        StringBuffer_appendString(&source, "total_");
+        StringBuffer_appendInt(&source, i);
+        StringBuffer_appendString(&source, " = alpha * 4 + 1.5e-3; // note\n");
+    }
+    SourceFile* file = SourceFile_fromBuffer(source.data, source.length, "format");
+    Lexer* lexer = Lexer_createFromSource(file);
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    Lexer_fillBuffer(lexer, tokens);
+    Lexer_destroy(lexer);
+    CHECK(tokens->count > TOKEN_DUMP_CHUNK_TOKENS);
+
+    FILE* printed = tmpfile();
+    FILE* dumped = tmpfile();
+    Token token;
+    for (uint32_t i = 0; i < tokens->count; i++) {
+        TokenBuffer_get(tokens, i, &token);
+        Token_print(&token, printed);
+        fputc('\n', printed);
+    }
+    CHECK(TokenBuffer_dump(tokens, fileno(dumped)));
+    fseek(dumped, 0, SEEK_END);
+    size_t printed_length, dumped_length;
+    char* printed_text = ReadAll(printed, &printed_length);
+    char* dumped_text = ReadAll(dumped, &dumped_length);
+    CHECK(printed_length == dumped_length && memcmp(printed_text, dumped_text, printed_length) == 0);
+
+    // One token and a range of them format the same way
+    StringBuffer one, range;
+    StringBuffer_init(&one);
+    StringBuffer_init(&range);
+    TokenBuffer_get(tokens, 11, &token);
+    Token_format(&token, &one);
+    StringBuffer_appendChar(&one, '\n');
+    TokenBuffer_format(tokens, 11, 12, &range);
+    CHECK_STR(range.data, one.data);
+    CHECK(strstr(one.data, "value='alpha'") && strstr(one.data, "line=2, col=11}"));
+
+    StringBuffer_free(&range);
+    StringBuffer_free(&one);
+    free(printed_text);
+    free(dumped_text);
+    fclose(printed);
+    fclose(dumped);
+    TokenBuffer_destroy(tokens);
+    SourceFile_close(file);
+    StringBuffer_free(&source);
+}
+
+int main(void) {
+    TEST_RUN(test_buffer_growth);
+    TEST_RUN(test_failure_is_sticky);
+    TEST_RUN(test_integers_match_snprintf);
+    TEST_RUN(test_doubles_are_shortest);
+    TEST_RUN(test_values);
+    TEST_RUN(test_dump_matches_token_print);
+    return Test_finish("format");
+}
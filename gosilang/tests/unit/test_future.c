@@ -0,0 +1,163 @@
+// Futures: whenAll over spawned tasks, failures passing through
+// continuations and sets, a long chain released as it is built,
+// whenAny over promises resolved from another thread, continuations of
+// completed futures and empty sets, on pools of 1 to 4 threads.
+#include "runtime/concurrency/futures/future.h"
+#include "test.h"
+#include <stdlib.h>
+
+#define VALUE(n) ((void*)(uintptr_t)(n))
+#define NUMBER(value) ((uintptr_t)(value))
+
+static const uint32_t thread_counts[] = { 1, 2, 4 };
+
+static FutureResult Square(void* data) {
+    return FutureResult_ok(VALUE(NUMBER(data) * NUMBER(data)));
+}
+
+static FutureResult Fail(void* data) {
+    return FutureResult_error(data);
+}
+
+static FutureResult Nothing(void* data) {
+    return FutureResult_ok(data);
+}
+
+static FutureResult Increment(FutureResult input, void* data) {
+    (void)data;
+    return input.ok ? FutureResult_ok(VALUE(NUMBER(input.value) + 1)) : input;
+}
+
+static void CheckWhenAll(WorkPool* pool) {
+    enum { TASKS = 1000 };
+    Future* futures[TASKS];
+    for (uint32_t i = 0; i < TASKS; i++) futures[i] = Future_spawn(pool, Square, VALUE(i));
+    Future* all = Future_whenAll(pool, futures, TASKS);
+    FutureResult result = Future_wait(all);
+    CHECK(result.ok && Future_isReady(all));
+
+    uint64_t sum = 0;
+    uint32_t unready = 0;
+    for (uint32_t i = 0; i < TASKS; i++) {
+        if (!Future_isReady(futures[i])) unready++;
+        sum += NUMBER(Future_wait(futures[i]).value);
+        Future_release(futures[i]);
+    }
+    CHECK(unready == 0);
+    CHECK(sum == (uint64_t)(TASKS - 1) * TASKS * (2 * TASKS - 1) / 6);
+    Future_release(all);
+}
+
+static void test_when_all(void) {
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        WorkPool* pool = WorkPool_create(thread_counts[t]);
+        CheckWhenAll(pool);
+        WorkPool_destroy(pool);
+    }
+}
+
+static void test_failures_propagate(void) {
+    WorkPool* pool = WorkPool_create(2);
+    Future* failed = Future_spawn(pool, Fail, VALUE(7));
+    Future* passed = Future_then(failed, Increment, NULL);
+    Future* fine = Future_spawn(pool, Square, VALUE(3));
+    Future* pair[] = { fine, passed };
+    Future* both = Future_whenAll(pool, pair, 2);
+
+    FutureResult result = Future_wait(passed);
+    CHECK(!result.ok && NUMBER(result.value) == 7);
+    CHECK(!Future_wait(both).ok);
+    result = Future_wait(fine);
+    CHECK(result.ok && NUMBER(result.value) == 9);
+
+    Future_release(failed);
+    Future_release(passed);
+    Future_release(fine);
+    Future_release(both);
+    WorkPool_destroy(pool);
+}
+
+// Each link is released as soon as the next one exists, so the chain
+// is kept alive only by the runtime's references
+static void test_long_chain(void) {
+    enum { CHAIN_LENGTH = 10000 };
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        WorkPool* pool = WorkPool_create(thread_counts[t]);
+        Future* chain = Future_spawn(pool, Nothing, VALUE(0));
+        for (uint32_t i = 0; i < CHAIN_LENGTH; i++) {
+            Future* next = Future_then(chain, Increment, NULL);
+            Future_release(chain);
+            chain = next;
+        }
+        FutureResult result = Future_wait(chain);
+        CHECK(result.ok && NUMBER(result.value) == CHAIN_LENGTH);
+        Future_release(chain);
+        WorkPool_destroy(pool);
+    }
+}
+
+enum { ANY_PROMISES = 16, FIRST_PROMISE = 11 };
+
+// Resolves the first promise, then the others
+static void* ResolveAll(void* argument) {
+    Future** promises = (Future**)argument;
+    Future_resolve(promises[FIRST_PROMISE], FutureResult_ok(VALUE(100 + FIRST_PROMISE)));
+    for (uint32_t i = 0; i < ANY_PROMISES; i++) {
+        if (i != FIRST_PROMISE) Future_resolve(promises[i], FutureResult_ok(VALUE(100 + i)));
+    }
+    return NULL;
+}
+
+static void test_when_any_of_promises(void) {
+    WorkPool* pool = WorkPool_create(2);
+    Future* promises[ANY_PROMISES];
+    for (uint32_t i = 0; i < ANY_PROMISES; i++) promises[i] = Future_promise(pool);
+    Future* any = Future_whenAny(pool, promises, ANY_PROMISES);
+    Future* after = Future_then(any, Increment, NULL);
+    CHECK(Future_winner(any) == FUTURE_NO_WINNER);
+
+    pthread_t resolver;
+    CHECK(pthread_create(&resolver, NULL, ResolveAll, promises) == 0);
+    FutureResult result = Future_wait(after);
+    CHECK(result.ok && NUMBER(result.value) == 100 + FIRST_PROMISE + 1);
+    CHECK(Future_winner(any) == FIRST_PROMISE);
+    pthread_join(resolver, NULL);
+
+    for (uint32_t i = 0; i < ANY_PROMISES; i++) Future_release(promises[i]);
+    Future_release(after);
+    Future_release(any);
+    WorkPool_destroy(pool);
+}
+
+static void test_completed_inputs_and_empty_sets(void) {
+    WorkPool* pool = WorkPool_create(2);
+    Future* resolved = Future_promise(pool);
+    CHECK(!Future_isReady(resolved));
+    Future_resolve(resolved, FutureResult_ok(VALUE(41)));
+    CHECK(Future_isReady(resolved));
+
+    // A continuation of a completed future starts at once
+    Future* late = Future_then(resolved, Increment, NULL);
+    CHECK(NUMBER(Future_wait(late).value) == 42);
+
+    // Nothing to wait for: whenAll succeeds, whenAny has no winner
+    Future* none_all = Future_whenAll(pool, NULL, 0);
+    Future* none_any = Future_whenAny(pool, NULL, 0);
+    CHECK(Future_wait(none_all).ok);
+    CHECK(!Future_wait(none_any).ok && Future_winner(none_any) == FUTURE_NO_WINNER);
+
+    Future_release(resolved);
+    Future_release(late);
+    Future_release(none_all);
+    Future_release(none_any);
+    WorkPool_destroy(pool);
+}
+
+int main(void) {
+    TEST_RUN(test_when_all);
+    TEST_RUN(test_failures_propagate);
+    TEST_RUN(test_long_chain);
+    TEST_RUN(test_when_any_of_promises);
+    TEST_RUN(test_completed_inputs_and_empty_sets);
+    return Test_finish("future");
+}
@@ -0,0 +1,334 @@
+// Incremental re-lexing and re-parsing: Lexer_relexBuffer against a
+// fresh lex, edits within a token's lookahead, and IncrementalParser
+// documents checked against a full lex and parse after random edits,
+// edits across blocks, an unclosed comment and emptying the document.
+#include "core/parser/incremental_parser.h"
+#include "test.h"
+#include <stdlib.h>
+
+static TokenBuffer* LexAll(const char* text, size_t length) {
+    Lexer* lexer = Lexer_createFromBuffer(text, length, "incremental");
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    Lexer_fillBuffer(lexer, tokens);
+    Lexer_destroy(lexer);
+    return tokens;
+}
+
+static bool SameTokens(const TokenBuffer* a, const TokenBuffer* b) {
+    uint32_t n = a->count;
+    return n == b->count && memcmp(a->types, b->types, n) == 0 &&
+           memcmp(a->offsets, b->offsets, n * sizeof(uint32_t)) == 0 &&
+           memcmp(a->lengths, b->lengths, n * sizeof(uint32_t)) == 0 &&
+           memcmp(a->attributes, b->attributes, n * sizeof(uint16_t)) == 0;
+}
+
+// Applies an edit to text in place and relexes buffer to match
+static bool Relex(char* text, size_t* length, TokenBuffer* buffer, size_t offset, size_t removed,
+                  const char* inserted, TokenEdit* change) {
+    size_t count = strlen(inserted);
+    memmove(text + offset + count, text + offset + removed, *length - offset - removed);
+    memcpy(text + offset, inserted, count);
+    *length = *length - removed + count;
+
+    Lexer* lexer = Lexer_createFromBuffer(text, *length, "incremental");
+    TextEdit edit = { offset, removed, count };
+    bool ok = Lexer_relexBuffer(lexer, buffer, &edit, change);
+    Lexer_destroy(lexer);
+    return ok;
+}
+
+static void test_relex_small_edits(void) {
+    char text[256] = "a = b + 1; /* note */ c = \"s\";";
+    size_t length = strlen(text);
+    TokenBuffer* buffer = LexAll(text, length);
+    TokenEdit change;
+
+    // b -> bee: the replaced range covers the token and the count holds
+    CHECK(Relex(text, &length, buffer, 4, 1, "bee", &change));
+    CHECK(change.first <= 2 && change.first + change.removed >= 3 && change.removed == change.inserted);
+    TokenBuffer* fresh = LexAll(text, length);
+    CHECK(SameTokens(buffer, fresh));
+    TokenBuffer_destroy(fresh);
+
+    // '+' becomes '<', which grows into '<<=' through the lookahead
+    CHECK(Relex(text, &length, buffer, 8, 1, "<", &change));
+    CHECK(Relex(text, &length, buffer, 9, 0, "<", &change));
+    CHECK(Relex(text, &length, buffer, 10, 0, "=", &change));
+    fresh = LexAll(text, length);
+    CHECK(SameTokens(buffer, fresh));
+    CHECK(fresh->types[3] == TOKEN_EXPR_ASSIGNMENT && fresh->lengths[3] == 3);
+    TokenBuffer_destroy(fresh);
+
+    // Opening a comment swallows tokens, and closing one gives them back
+    CHECK(Relex(text, &length, buffer, 0, 0, "/*", &change));
+    fresh = LexAll(text, length);
+    CHECK(SameTokens(buffer, fresh));
+    TokenBuffer_destroy(fresh);
+    CHECK(Relex(text, &length, buffer, 0, 2, "", &change));
+    fresh = LexAll(text, length);
+    CHECK(SameTokens(buffer, fresh));
+    TokenBuffer_destroy(fresh);
+
+    // A string opened at the end runs to the end of input
+    CHECK(Relex(text, &length, buffer, length, 0, " \"open", &change));
+    fresh = LexAll(text, length);
+    CHECK(SameTokens(buffer, fresh));
+    TokenBuffer_destroy(fresh);
+
+    TextEdit outside = { length + 1, 0, 0 };
+    Lexer* lexer = Lexer_createFromBuffer(text, length, "incremental");
+    CHECK(!Lexer_relexBuffer(lexer, buffer, &outside, &change));
+    Lexer_destroy(lexer);
+    TokenBuffer_destroy(buffer);
+}
+
+static void test_relex_random_edits(void) {
+    static const char bytes[] = "ab1 +-*/<=;\"'\n\\(";
+    srand(18);
+    char text[4096];
+    size_t length = 0;
+    for (int i = 0; i < 40; i++) length += (size_t)sprintf(text + length, "x%d = y << %d; // c\n", i, i);
+    TokenBuffer* buffer = LexAll(text, length);
+
+    uint32_t wrong = 0;
+    for (int e = 0; e < 2000; e++) {
+        size_t offset = length ? (size_t)rand() % length : 0;
+        size_t removed = (size_t)(rand() % 3);
+        if (removed > length - offset) removed = length - offset;
+        char inserted[3] = { bytes[rand() % (sizeof(bytes) - 1)], bytes[rand() % (sizeof(bytes) - 1)], 0 };
+        if (rand() % 2) inserted[1] = 0;
+        if (length + 2 >= sizeof(text)) inserted[0] = 0;
+
+        TokenEdit change;
+        CHECK(Relex(text, &length, buffer, offset, removed, inserted, &change));
+        TokenBuffer* fresh = LexAll(text, length);
+        if (!SameTokens(buffer, fresh)) wrong++;
+        TokenBuffer_destroy(fresh);
+    }
+    CHECK(wrong == 0);
+    TokenBuffer_destroy(buffer);
+}
+
+// A whole-text reference, split at every ';' as the blocks do
+typedef struct Reference {
+    TokenBuffer* tokens;
+    AstPool* pool;
+    ParsedStatement* statements;
+    uint32_t statement_count;
+} Reference;
+
+static void BuildReference(Reference* ref, const char* text, size_t length, ExprParser* parser) {
+    Lexer* lexer = Lexer_createFromBuffer(text, length, "reference");
+    lexer->skip_comments = true;
+    ref->tokens = TokenBuffer_create(0);
+    Lexer_fillBuffer(lexer, ref->tokens);
+    Lexer_destroy(lexer);
+    ref->tokens->count--;
+
+    ref->pool = AstPool_create(0);
+    ref->statements = (ParsedStatement*)malloc((ref->tokens->count + 1) * sizeof(ParsedStatement));
+    ref->statement_count = 0;
+    uint32_t start = 0;
+    for (uint32_t i = 0; i <= ref->tokens->count; i++) {
+        bool end = i == ref->tokens->count;
+        if (!end && ref->tokens->types[i] != TOKEN_PUNCT_SEMICOLON) continue;
+        if (end && start == i) break;
+        ParsedStatement* statement = &ref->statements[ref->statement_count++];
+        statement->begin = start;
+        statement->end = i;
+        statement->root = start < i ? ExprParser_build(parser, ref->tokens, start, i, ref->pool) : AST_NODE_NONE;
+        start = i + 1;
+    }
+}
+
+static void FreeReference(Reference* ref) {
+    TokenBuffer_destroy(ref->tokens);
+    AstPool_destroy(ref->pool);
+    free(ref->statements);
+}
+
+static bool SameTree(const AstPool* a, AstNodeId x, uint32_t token_base, const AstPool* b, AstNodeId y) {
+    if (x == AST_NODE_NONE || y == AST_NODE_NONE) return x == y;
+    const AstNode* p = &a->nodes[x];
+    const AstNode* q = &b->nodes[y];
+    if (p->kind != q->kind || p->op != q->op || p->token + token_base != q->token ||
+        p->child_count != q->child_count) {
+        return false;
+    }
+    for (uint32_t i = 0; i < p->child_count; i++) {
+        if (!SameTree(a, a->children[p->first_child + i], token_base, b, b->children[q->first_child + i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool MatchesFullParse(const IncrementalParser* doc, const char* text, size_t length) {
+    ExprParser* parser = ExprParser_create();
+    Reference ref;
+    BuildReference(&ref, text, length, parser);
+    bool ok = doc->length == length && doc->block_count > 0;
+
+    uint32_t token_base = 0, statement = 0;
+    size_t base = 0;
+    for (uint32_t b = 0; ok && b < doc->block_count; b++) {
+        const SourceBlock* block = doc->blocks[b];
+        const TokenBuffer* tokens = block->tokens;
+        ok = base + block->length <= length && memcmp(block->text, text + base, block->length) == 0 &&
+             token_base + tokens->count <= ref.tokens->count;
+        for (uint32_t i = 0; ok && i < tokens->count; i++) {
+            uint32_t g = token_base + i;
+            ok = tokens->types[i] == ref.tokens->types[g] && tokens->offsets[i] + base == ref.tokens->offsets[g] &&
+                 tokens->lengths[i] == ref.tokens->lengths[g];
+        }
+        for (uint32_t s = 0; ok && s < block->statement_count; s++, statement++) {
+            const ParsedStatement* mine = &block->statements[s];
+            const ParsedStatement* theirs = &ref.statements[statement];
+            ok = statement < ref.statement_count && mine->begin + token_base == theirs->begin &&
+                 mine->end + token_base == theirs->end &&
+                 SameTree(block->pool, mine->root, token_base, ref.pool, theirs->root);
+        }
+        token_base += tokens->count;
+        base += block->length;
+    }
+    ok = ok && base == length && token_base == ref.tokens->count && statement == ref.statement_count;
+    FreeReference(&ref);
+    ExprParser_destroy(parser);
+    return ok;
+}
+
+// A document of several blocks, and its text kept alongside
+typedef struct Document {
+    IncrementalParser* doc;
+    char* text;
+    size_t length;
+    size_t capacity;
+} Document;
+
+static void Document_open(Document* d, size_t lines) {
+    static const char* const source_lines[] = {
+        "total_%d = alpha * 4 + beta / 2;\n",
+        "// running total %d\n",
+        "flag_%d = (count > limit) ? first : second;\n",
+        "/* block %d */ ratio = 1.5e-3 * weight + .25;\n",
+    };
+    d->capacity = lines * 64 + 65536;
+    d->text = (char*)malloc(d->capacity);
+    d->length = 0;
+    for (size_t i = 0; i < lines; i++) {
+        d->length += (size_t)sprintf(d->text + d->length, source_lines[i % 4], (int)i);
+    }
+    d->doc = IncrementalParser_create(d->text, d->length, NULL);
+}
+
+static bool Document_edit(Document* d, size_t offset, size_t removed, const char* inserted, size_t count) {
+    bool ok = IncrementalParser_edit(d->doc, offset, removed, inserted, count);
+    memmove(d->text + offset + count, d->text + offset + removed, d->length - offset - removed);
+    memcpy(d->text + offset, inserted, count);
+    d->length = d->length - removed + count;
+    return ok;
+}
+
+static void Document_close(Document* d) {
+    IncrementalParser_destroy(d->doc);
+    free(d->text);
+}
+
+static void test_document_starts_in_blocks(void) {
+    Document d;
+    Document_open(&d, 2000);
+    CHECK(d.doc != NULL);
+    CHECK(d.doc->block_count > 4);
+    CHECK(MatchesFullParse(d.doc, d.text, d.length));
+
+    size_t base;
+    uint32_t last = IncrementalParser_findBlock(d.doc, d.length - 1, &base);
+    CHECK(last == d.doc->block_count - 1 && base + d.doc->blocks[last]->length == d.length);
+    CHECK(IncrementalParser_findBlock(d.doc, 0, &base) == 0 && base == 0);
+    CHECK(!IncrementalParser_edit(d.doc, d.length + 1, 0, "x", 1));
+    CHECK(!IncrementalParser_edit(d.doc, 0, d.length + 1, "", 0));
+    CHECK(!IncrementalParser_edit(d.doc, 0, 0, NULL, 1));
+    Document_close(&d);
+}
+
+static void test_edit_reuses_other_statements(void) {
+    Document d;
+    Document_open(&d, 2000);
+
+    // alpha -> alphabet in the first line
+    CHECK(Document_edit(&d, 12, 0, "bet", 3));
+    CHECK(d.doc->reparsed_statements == 1 && d.doc->rebuilt_blocks == 0);
+    CHECK(d.doc->relexed_tokens <= 2);
+    CHECK(MatchesFullParse(d.doc, d.text, d.length));
+
+    // A new statement in the middle of a line
+    CHECK(Document_edit(&d, 12, 0, "; x", 3));
+    CHECK(d.doc->reparsed_statements == 2);
+    CHECK(MatchesFullParse(d.doc, d.text, d.length));
+    Document_close(&d);
+}
+
+static void test_random_edits_match_full_parse(void) {
+    static const char bytes[] = "a1 +*;()/\n\"";
+    srand(1018);
+    Document d;
+    Document_open(&d, 1500);
+    uint32_t wrong = 0;
+    for (int e = 0; e < 3000; e++) {
+        size_t offset = d.length ? (size_t)rand() % d.length : 0;
+        size_t removed = 0, inserted = 0;
+        char byte = bytes[rand() % (sizeof(bytes) - 1)];
+        switch (rand() % 3) {
+            case 0: inserted = 1; break;
+            case 1: removed = d.length ? 1 : 0; break;
+            default: removed = d.length ? 1 : 0; inserted = 1; break;
+        }
+        CHECK(Document_edit(&d, offset, removed, &byte, inserted));
+        if (e % 100 == 99 && !MatchesFullParse(d.doc, d.text, d.length)) wrong++;
+    }
+    CHECK(wrong == 0);
+    CHECK(MatchesFullParse(d.doc, d.text, d.length));
+    Document_close(&d);
+}
+
+static void test_edits_across_blocks(void) {
+    Document d;
+    Document_open(&d, 3000);
+    uint32_t blocks = d.doc->block_count;
+
+    // Cut a range spanning several blocks, then paste a large one
+    size_t from = d.doc->blocks[0]->length / 2;
+    size_t span = d.doc->blocks[1]->length + d.doc->blocks[2]->length;
+    char* saved = (char*)malloc(span);
+    memcpy(saved, d.text + from, span);
+    CHECK(Document_edit(&d, from, span, "", 0));
+    CHECK(d.doc->block_count < blocks);
+    CHECK(MatchesFullParse(d.doc, d.text, d.length));
+    CHECK(Document_edit(&d, from, 0, saved, span));
+    CHECK(MatchesFullParse(d.doc, d.text, d.length));
+    free(saved);
+
+    // An unclosed comment near the start, then closing it
+    size_t start = (size_t)(strchr(d.text + 100, '\n') - d.text) + 1;
+    CHECK(Document_edit(&d, start, 0, "/*", 2));
+    CHECK(MatchesFullParse(d.doc, d.text, d.length));
+    CHECK(Document_edit(&d, start, 2, "", 0));
+    CHECK(MatchesFullParse(d.doc, d.text, d.length));
+
+    // Emptying the document and typing into it again
+    CHECK(Document_edit(&d, 0, d.length, "", 0));
+    CHECK(d.length == 0 && MatchesFullParse(d.doc, d.text, d.length));
+    CHECK(Document_edit(&d, 0, 0, "a = b;\n", 7));
+    CHECK(MatchesFullParse(d.doc, d.text, d.length));
+    Document_close(&d);
+}
+
+int main(void) {
+    TEST_RUN(test_relex_small_edits);
+    TEST_RUN(test_relex_random_edits);
+    TEST_RUN(test_document_starts_in_blocks);
+    TEST_RUN(test_edit_reuses_other_statements);
+    TEST_RUN(test_random_edits_match_full_parse);
+    TEST_RUN(test_edits_across_blocks);
+    return Test_finish("incremental");
+}
@@ -0,0 +1,167 @@
+// StringInterner: reserved ids and their hashed lookup, deduplication,
+// growth across many lexemes with stable ids and pointers, and refusal
+// when the slot table cannot grow.
+#include "core/tokenizer/symbols/sym_intern.h"
+#include "test.h"
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define GROWTH_LEXEMES 100000
+
+static void test_reserved(void) {
+    StringInterner* interner = StringInterner_create();
+    CHECK(interner != NULL);
+    CHECK(interner->count == LEXEME_RESERVED_COUNT);
+    CHECK(StringInterner_intern(interner, "+", 1) == LEXEME_PLUS);
+    CHECK(StringInterner_intern(interner, "<<=", 3) == LEXEME_SHL_ASSIGN);
+    CHECK(StringInterner_intern(interner, "...", 3) == LEXEME_ELLIPSIS);
+    CHECK(StringInterner_find(interner, "true", 4) == LEXEME_TRUE);
+    CHECK(Lexeme_findReserved("null", 4) == LEXEME_NULL);
+    CHECK(Lexeme_findReserved("nul", 3) == LEXEME_NONE);
+
+    OperatorType op;
+    CHECK(Lexeme_toOperator(LEXEME_SHL, &op) && op == OP_SHIFT_LEFT);
+    CHECK(!Lexeme_toOperator(LEXEME_SEMICOLON, &op));
+    CHECK(Lexeme_fromOperator(OP_SHIFT_LEFT) == LEXEME_SHL);
+    StringInterner_destroy(interner);
+}
+
+// Every reserved spelling is found again, and nothing close to one is
+static void test_reserved_lookup(void) {
+    const ReservedTable* table = ReservedTable_get();
+    uint32_t wrong = 0, longest_probe = 0;
+    char text[RESERVED_MAX_LENGTH + 2];
+    for (LexemeId id = 1; id < LEXEME_RESERVED_COUNT; id++) {
+        uint32_t length;
+        const char* spelling = Lexeme_getReserved(id, &length);
+        if (length > RESERVED_MAX_LENGTH || Lexeme_findReserved(spelling, length) != id) wrong++;
+
+        uint32_t probe = 0;
+        uint32_t slot = ReservedTable_slot(spelling, length);
+        for (; table->slots[slot] != id; slot = (slot + 1) & (RESERVED_TABLE_SIZE - 1)) probe++;
+        if (probe > longest_probe) longest_probe = probe;
+
+        // No reserved spelling ends in 'x' or contains '$'
+        memcpy(text, spelling, length);
+        text[length] = 'x';
+        if (Lexeme_findReserved(text, length + 1) != LEXEME_NONE) wrong++;
+        text[length - 1] = '$';
+        if (Lexeme_findReserved(text, length) != LEXEME_NONE) wrong++;
+    }
+    CHECK(wrong == 0);
+    CHECK(longest_probe <= 4);
+    CHECK(Lexeme_findReserved("", 0) == LEXEME_NONE);
+    CHECK(Lexeme_findReserved("_Static_asserts", 15) == LEXEME_NONE);
+    CHECK(Lexeme_findReserved("whilex", 5) == LEXEME_KEYWORD_FIRST + KW_WHILE);
+
+    // Keyword and operator spellings come from the same lists
+    uint32_t mismatched = 0;
+    for (int kw = 0; kw < KEYWORD_TYPE_COUNT; kw++) {
+        KeywordType found;
+        const char* spelling = GetKeywordString((KeywordType)kw);
+        LexemeId id = Lexeme_findReserved(spelling, strlen(spelling));
+        if (!Lexeme_toKeyword(id, &found) || found != (KeywordType)kw) mismatched++;
+    }
+    for (int op = 0; op < OPERATOR_TYPE_COUNT; op++) {
+        LexemeId id = Lexeme_fromOperator((OperatorType)op);
+        if (op != OP_CONDITIONAL && strcmp(Lexeme_getReserved(id, NULL), GetOperatorString((OperatorType)op)) != 0) {
+            mismatched++;
+        }
+    }
+    CHECK(mismatched == 0);
+}
+
+static void test_deduplication(void) {
+    StringInterner* interner = StringInterner_create();
+    char buffer[] = "counter_and_more";
+    LexemeId id = StringInterner_intern(interner, buffer, 7);
+    CHECK(id >= LEXEME_RESERVED_COUNT);
+    CHECK(StringInterner_intern(interner, "counter", 7) == id);
+    CHECK(StringInterner_intern(interner, "counte", 6) != id);
+
+    uint32_t length = 0;
+    CHECK_STR(StringInterner_get(interner, id, &length), "counter");
+    CHECK(length == 7);
+    CHECK(StringInterner_get(interner, LEXEME_NONE, NULL) == NULL);
+    CHECK(StringInterner_get(interner, interner->count, NULL) == NULL);
+
+    // Empty and embedded NUL lexemes are distinct entries
+    LexemeId empty = StringInterner_intern(interner, "", 0);
+    LexemeId nul = StringInterner_intern(interner, "a\0b", 3);
+    CHECK(empty != LEXEME_NONE && nul != LEXEME_NONE && empty != nul);
+    CHECK(StringInterner_intern(interner, "a", 1) != nul);
+    CHECK(StringInterner_intern(NULL, "a", 1) == LEXEME_NONE);
+    CHECK(StringInterner_intern(interner, NULL, 1) == LEXEME_NONE);
+    StringInterner_destroy(interner);
+}
+
+static void test_growth(void) {
+    StringInterner* interner = StringInterner_create();
+    LexemeId* ids = (LexemeId*)malloc(GROWTH_LEXEMES * sizeof(LexemeId));
+    const char** pointers = (const char**)malloc(GROWTH_LEXEMES * sizeof(char*));
+    char name[32];
+    for (int i = 0; i < GROWTH_LEXEMES; i++) {
+        int length = snprintf(name, sizeof(name), "name_%d", i);
+        ids[i] = StringInterner_intern(interner, name, (size_t)length);
+        pointers[i] = StringInterner_get(interner, ids[i], NULL);
+        CHECK(ids[i] == (LexemeId)(LEXEME_RESERVED_COUNT + i));
+    }
+    CHECK(interner->count == LEXEME_RESERVED_COUNT + GROWTH_LEXEMES);
+    CHECK(interner->count * 2 <= interner->slot_mask + 1);
+
+    // Ids and text survived every resize of the tables
+    int wrong = 0;
+    for (int i = 0; i < GROWTH_LEXEMES; i++) {
+        int length = snprintf(name, sizeof(name), "name_%d", i);
+        if (StringInterner_find(interner, name, (size_t)length) != ids[i]) wrong++;
+        if (StringInterner_get(interner, ids[i], NULL) != pointers[i] || strcmp(pointers[i], name) != 0) wrong++;
+    }
+    CHECK(wrong == 0);
+    CHECK(StringInterner_find(interner, "name_x", 6) == LEXEME_NONE);
+
+    free(pointers);
+    free(ids);
+    StringInterner_destroy(interner);
+}
+
+// Interns under an address space limit until an allocation fails. The
+// failure must return LEXEME_NONE and leave every earlier lexeme
+// findable; a table that filled up instead would make lookups spin.
+static void test_growth_failure(void) {
+    pid_t child = fork();
+    if (child == 0) {
+        StringInterner* interner = StringInterner_create();
+        struct rlimit limit = { 256u << 20, 256u << 20 };
+        if (!interner || setrlimit(RLIMIT_AS, &limit) != 0) _exit(2);
+        alarm(60);
+
+        char name[32];
+        uint32_t interned = 0;
+        for (;;) {
+            int length = snprintf(name, sizeof(name), "n%u", interned);
+            if (StringInterner_intern(interner, name, (size_t)length) == LEXEME_NONE) break;
+            interned++;
+        }
+        for (uint32_t i = 0; i < interned; i++) {
+            int length = snprintf(name, sizeof(name), "n%u", i);
+            if (StringInterner_find(interner, name, (size_t)length) != LEXEME_RESERVED_COUNT + i) _exit(1);
+        }
+        int length = snprintf(name, sizeof(name), "n%u", interned);
+        _exit(StringInterner_find(interner, name, (size_t)length) == LEXEME_NONE ? 0 : 1);
+    }
+
+    int status = -1;
+    CHECK(child > 0 && waitpid(child, &status, 0) == child);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main(void) {
+    TEST_RUN(test_reserved);
+    TEST_RUN(test_reserved_lookup);
+    TEST_RUN(test_deduplication);
+    TEST_RUN(test_growth);
+    TEST_RUN(test_growth_failure);
+    return Test_finish("intern");
+}
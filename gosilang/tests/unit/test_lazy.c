@@ -0,0 +1,192 @@
+// Lazy values: the function runs once on first use and never again, a
+// failed run is retried by the next access, a thread arriving during
+// the run parks and then sees the value, and many threads forcing a
+// shared set of lazies run each function exactly once.
+#include "runtime/concurrency/lazy/lazy.h"
+#include "test.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define VALUE(n) ((void*)(uintptr_t)(n))
+
+typedef struct Counted {
+    atomic_uint calls;
+    uint32_t failures;          // Runs that fail before one succeeds
+} Counted;
+
+static bool Compute(void* data, void** value) {
+    Counted* counted = (Counted*)data;
+    unsigned calls = atomic_fetch_add(&counted->calls, 1);
+    if (calls < counted->failures) return false;
+    *value = VALUE(100 + calls);
+    return true;
+}
+
+static void test_runs_once(void) {
+    Counted counted = { 0, 0 };
+    Lazy lazy;
+    Lazy_init(&lazy, Compute, &counted);
+    CHECK(!Lazy_isReady(&lazy));
+
+    void* value = NULL;
+    CHECK(Lazy_get(&lazy, &value) && value == VALUE(100));
+    CHECK(Lazy_isReady(&lazy));
+    for (int i = 0; i < 10; i++) {
+        value = NULL;
+        CHECK(Lazy_get(&lazy, &value) && value == VALUE(100));
+    }
+    CHECK(atomic_load(&counted.calls) == 1);
+}
+
+static void test_failure_is_retried(void) {
+    Counted counted = { 0, 2 };
+    Lazy lazy;
+    Lazy_init(&lazy, Compute, &counted);
+    void* value = NULL;
+    CHECK(!Lazy_get(&lazy, &value) && !Lazy_isReady(&lazy));
+    CHECK(!Lazy_get(&lazy, &value));
+    CHECK(Lazy_get(&lazy, &value) && value == VALUE(102));
+    CHECK(Lazy_get(&lazy, &value) && value == VALUE(102));
+    CHECK(atomic_load(&counted.calls) == 3);
+}
+
+static bool Constant(void* data, void** value) {
+    *value = data;
+    return true;
+}
+
+static void test_static_initialiser(void) {
+    static Lazy lazy = LAZY_INIT(Constant, VALUE(42));
+    void* value = NULL;
+    CHECK(Lazy_get(&lazy, &value) && value == VALUE(42));
+}
+
+// The function holds its run until the other thread has marked the
+// state word waited on, so that thread is known to park
+typedef struct Parking {
+    Lazy lazy;
+    atomic_uint calls;
+    void* seen;
+    bool got;
+} Parking;
+
+static bool WaitForParker(void* data, void** value) {
+    Parking* parking = (Parking*)data;
+    atomic_fetch_add(&parking->calls, 1);
+    struct timespec pause = { 0, 100000 };
+    for (int i = 0; i < 20000 && atomic_load(&parking->lazy.state) != LAZY_WAITING; i++) nanosleep(&pause, NULL);
+    *value = VALUE(7);
+    return true;
+}
+
+static void* ForceParked(void* argument) {
+    Parking* parking = (Parking*)argument;
+    while (atomic_load(&parking->lazy.state) != LAZY_RUNNING) {}
+    parking->got = Lazy_get(&parking->lazy, &parking->seen);
+    return NULL;
+}
+
+static void test_arrivals_park_until_ready(void) {
+    Parking parking;
+    Lazy_init(&parking.lazy, WaitForParker, &parking);
+    atomic_init(&parking.calls, 0);
+    parking.seen = NULL;
+    parking.got = false;
+
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, ForceParked, &parking) == 0);
+    void* value = NULL;
+    CHECK(Lazy_get(&parking.lazy, &value) && value == VALUE(7));
+    pthread_join(thread, NULL);
+    CHECK(parking.got && parking.seen == VALUE(7));
+    CHECK(atomic_load(&parking.calls) == 1);
+}
+
+// Threads force a shared set of lazies, each starting at a different
+// one; some functions are slow enough that others park on them and
+// some fail their first run
+enum { LAZY_COUNT = 20000, SLOW_EVERY = 2000, FAIL_EVERY = 500, THREADS = 8 };
+
+typedef struct Slot {
+    Lazy lazy;
+    atomic_uint calls;
+    uint32_t index;
+} Slot;
+
+static bool ComputeSlot(void* data, void** value) {
+    Slot* slot = (Slot*)data;
+    unsigned calls = atomic_fetch_add(&slot->calls, 1);
+    if (slot->index % SLOW_EVERY == 0) {
+        struct timespec pause = { 0, 2000000 };
+        nanosleep(&pause, NULL);
+    }
+    if (slot->index % FAIL_EVERY == 7 && calls == 0) return false;
+    *value = VALUE(slot->index * 3 + 1);
+    return true;
+}
+
+typedef struct ForceJob {
+    Slot* slots;
+    uint32_t first;
+    uint32_t wrong;
+    uint32_t failures;
+} ForceJob;
+
+static void* ForceAll(void* argument) {
+    ForceJob* job = (ForceJob*)argument;
+    for (uint32_t i = 0; i < LAZY_COUNT; i++) {
+        Slot* slot = &job->slots[(job->first + i) % LAZY_COUNT];
+        void* value;
+        // A failed run is retried by whoever forces next
+        bool ok = Lazy_get(&slot->lazy, &value);
+        if (!ok) {
+            job->failures++;
+            ok = Lazy_get(&slot->lazy, &value);
+        }
+        if (!ok || value != VALUE(slot->index * 3 + 1)) job->wrong++;
+    }
+    return NULL;
+}
+
+static void test_concurrent_first_use(void) {
+    Slot* slots = (Slot*)calloc(LAZY_COUNT, sizeof(Slot));
+    for (uint32_t i = 0; i < LAZY_COUNT; i++) {
+        slots[i].index = i;
+        atomic_init(&slots[i].calls, 0);
+        Lazy_init(&slots[i].lazy, ComputeSlot, &slots[i]);
+    }
+
+    ForceJob jobs[THREADS];
+    pthread_t threads[THREADS];
+    for (uint32_t t = 0; t < THREADS; t++) {
+        jobs[t] = (ForceJob){ slots, t * (LAZY_COUNT / THREADS), 0, 0 };
+        CHECK(pthread_create(&threads[t], NULL, ForceAll, &jobs[t]) == 0);
+    }
+    uint32_t wrong = 0, failures = 0;
+    for (uint32_t t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        wrong += jobs[t].wrong;
+        failures += jobs[t].failures;
+    }
+    CHECK(wrong == 0);
+    CHECK(failures == LAZY_COUNT / FAIL_EVERY);
+
+    uint32_t miscounted = 0;
+    for (uint32_t i = 0; i < LAZY_COUNT; i++) {
+        unsigned expected = i % FAIL_EVERY == 7 ? 2 : 1;
+        if (atomic_load(&slots[i].calls) != expected || !Lazy_isReady(&slots[i].lazy)) miscounted++;
+    }
+    CHECK(miscounted == 0);
+    free(slots);
+}
+
+int main(void) {
+    TEST_RUN(test_runs_once);
+    TEST_RUN(test_failure_is_retried);
+    TEST_RUN(test_static_initialiser);
+    TEST_RUN(test_arrivals_park_until_ready);
+    TEST_RUN(test_concurrent_first_use);
+    return Test_finish("lazy");
+}
@@ -0,0 +1,195 @@
+// Parallel lexing: chunked runs give the serial token stream, ids and
+// error count for any chunk and thread count, including splits inside
+// block comments and after continued or CRLF lines, and the serial
+// fallbacks produce the same stream.
+#include "core/tokenizer/lexer/lex_parallel.h"
+#include "test.h"
+#include <stdlib.h>
+
+#define SOURCE_BYTES (4u * 1024 * 1024 + 12345)
+
+// Code, CRLF lines, continued lines and stray bytes, with block
+// comments full of quotes and '//' large enough to hold several splits
+static char* Generate(size_t* length) {
+    static const char* const code[] = {
+        "int f_%d(int a) { return a * 4 + 0x1F; }\n",
+        "s_%d = \"quote \\\" and // not a comment\";\r\n",
+        "#define M_%d(x) \\\n    ((x) + 1)\n",
+        "x_%d = 'c' @ 1.5e-3; // line comment \"\n",
+    };
+    static const char* const comment[] = {
+        "  it's %d \"unbalanced\n",
+        "  y = z // %d\n",
+        "  ** %d \\\n",
+    };
+    char* data = (char*)malloc(SOURCE_BYTES + (1u << 20));
+    size_t used = 0;
+    for (int i = 0; used < SOURCE_BYTES; i++) {
+        if (i % 5000 == 2500) {
+            used += (size_t)sprintf(data + used, "/* big comment\n");
+            for (int j = 0; j < 40000; j++) used += (size_t)sprintf(data + used, comment[j % 3], j);
+            used += (size_t)sprintf(data + used, "*/ after_%d = 1;\n", i);
+        }
+        used += (size_t)sprintf(data + used, code[i % 4], i);
+    }
+    *length = used;
+    return data;
+}
+
+static bool SameTokens(const TokenBuffer* a, const TokenBuffer* b) {
+    uint32_t n = a->count;
+    return n == b->count && memcmp(a->types, b->types, n) == 0 &&
+           memcmp(a->categories, b->categories, n) == 0 &&
+           memcmp(a->offsets, b->offsets, n * sizeof(uint32_t)) == 0 &&
+           memcmp(a->lengths, b->lengths, n * sizeof(uint32_t)) == 0 &&
+           memcmp(a->lexemes, b->lexemes, n * sizeof(LexemeId)) == 0 &&
+           memcmp(a->attributes, b->attributes, n * sizeof(uint16_t)) == 0;
+}
+
+typedef struct Run {
+    TokenBuffer* tokens;
+    StringInterner* interner;
+    int errors;
+    size_t appended;
+} Run;
+
+// chunks 0 lexes serially, -1 through Lexer_fillBufferParallel
+static Run Lex(const char* data, size_t length, WorkPool* pool, int chunks, bool intern, bool skip_comments) {
+    Run run = { TokenBuffer_create(0), intern ? StringInterner_create() : NULL, 0, 0 };
+    Lexer* lexer = Lexer_createFromBuffer(data, length, "parallel");
+    Lexer_setInterner(lexer, run.interner);
+    lexer->skip_comments = skip_comments;
+    if (chunks > 0) {
+        run.appended = Lexer_fillBufferChunks(lexer, run.tokens, pool, (size_t)chunks);
+    } else if (chunks < 0) {
+        run.appended = Lexer_fillBufferParallel(lexer, run.tokens, pool);
+    } else {
+        run.appended = Lexer_fillBuffer(lexer, run.tokens);
+    }
+    run.errors = lexer->error_count;
+    Lexer_destroy(lexer);
+    return run;
+}
+
+static void Run_free(Run* run) {
+    TokenBuffer_destroy(run->tokens);
+    StringInterner_destroy(run->interner);
+}
+
+static void CheckMatches(const char* data, size_t length, WorkPool* pool, int chunks, bool intern,
+                         bool skip_comments) {
+    Run serial = Lex(data, length, NULL, 0, intern, skip_comments);
+    Run parallel = Lex(data, length, pool, chunks, intern, skip_comments);
+    CHECK(SameTokens(serial.tokens, parallel.tokens));
+    CHECK(serial.errors == parallel.errors && serial.errors > 0);
+    CHECK(parallel.appended == parallel.tokens->count);
+    if (intern) CHECK(serial.interner->count == parallel.interner->count);
+    Run_free(&parallel);
+    Run_free(&serial);
+}
+
+static void test_chunks_match_serial(void) {
+    size_t length;
+    char* data = Generate(&length);
+    static const uint32_t thread_counts[] = { 1, 2, 4 };
+    static const int chunk_counts[] = { 2, 3, 7, 16 };
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        WorkPool* pool = WorkPool_create(thread_counts[t]);
+        for (size_t c = 0; c < sizeof(chunk_counts) / sizeof(chunk_counts[0]); c++) {
+            CheckMatches(data, length, pool, chunk_counts[c], false, false);
+        }
+        WorkPool_destroy(pool);
+    }
+    free(data);
+}
+
+static void test_interning_and_skipped_comments(void) {
+    size_t length;
+    char* data = Generate(&length);
+    WorkPool* pool = WorkPool_create(3);
+    CheckMatches(data, length, pool, 9, true, false);
+    CheckMatches(data, length, pool, 9, false, true);
+    CheckMatches(data, length, pool, 9, true, true);
+    WorkPool_destroy(pool);
+    free(data);
+}
+
+// Every split in a file that is one comment lands inside it
+static void test_input_inside_one_comment(void) {
+    size_t length = LEX_PARALLEL_MIN_CHUNK * 6;
+    char* data = (char*)malloc(length + 64);
+    memcpy(data, "a /*", 4);
+    for (size_t i = 4; i < length; i++) data[i] = i % 40 == 39 ? '\n' : "x\"'/ "[i % 5];
+    memcpy(data + length - 4, "*/ b", 4);
+    WorkPool* pool = WorkPool_create(2);
+
+    Run serial = Lex(data, length, NULL, 0, false, false);
+    Run parallel = Lex(data, length, pool, 6, false, false);
+    CHECK(serial.tokens->count == 4);
+    CHECK(SameTokens(serial.tokens, parallel.tokens));
+    Run_free(&parallel);
+    Run_free(&serial);
+    WorkPool_destroy(pool);
+    free(data);
+}
+
+static void test_started_lexer_continues(void) {
+    size_t length;
+    char* data = Generate(&length);
+    WorkPool* pool = WorkPool_create(2);
+
+    // The first tokens come one at a time, the rest in chunks
+    Run serial = Lex(data, length, NULL, 0, false, false);
+    Lexer* lexer = Lexer_createFromBuffer(data, length, "parallel");
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    TokenSpan span;
+    for (int i = 0; i < 100; i++) {
+        Lexer_nextSpan(lexer, &span);
+        TokenBuffer_append(tokens, (TokenType)span.type, span.offset, span.length, span.lexeme);
+    }
+    Lexer_fillBufferChunks(lexer, tokens, pool, 5);
+    CHECK(tokens->count == serial.tokens->count);
+    CHECK(memcmp(tokens->offsets, serial.tokens->offsets, tokens->count * sizeof(uint32_t)) == 0);
+    CHECK(memcmp(tokens->types, serial.tokens->types, tokens->count) == 0);
+    CHECK(lexer->done && Lexer_fillBufferChunks(lexer, tokens, pool, 5) == 0);
+
+    Lexer_destroy(lexer);
+    TokenBuffer_destroy(tokens);
+    Run_free(&serial);
+    WorkPool_destroy(pool);
+    free(data);
+}
+
+// Small input, a NULL pool or a single thread lex serially; on a
+// machine with one CPU so does every pool
+static void test_fallbacks_match_serial(void) {
+    size_t length;
+    char* data = Generate(&length);
+    WorkPool* single = WorkPool_create(1);
+    WorkPool* pool = WorkPool_create(4);
+
+    CheckMatches(data, LEX_PARALLEL_MIN_CHUNK + 1000, pool, -1, false, false);
+    CheckMatches(data, length, NULL, -1, false, false);
+    CheckMatches(data, length, single, -1, false, false);
+    CheckMatches(data, length, pool, -1, true, false);
+    CheckMatches(data, length, NULL, 8, false, false);
+    CheckMatches(data, LEX_PARALLEL_MIN_CHUNK, pool, 8, false, false);
+
+    Run empty = Lex("", 0, pool, 4, false, false);
+    CHECK(empty.tokens->count == 1 && empty.tokens->types[0] == TOKEN_EOF);
+    Run_free(&empty);
+    CHECK(Lexer_fillBufferParallel(NULL, NULL, pool) == 0);
+
+    WorkPool_destroy(pool);
+    WorkPool_destroy(single);
+    free(data);
+}
+
+int main(void) {
+    TEST_RUN(test_chunks_match_serial);
+    TEST_RUN(test_interning_and_skipped_comments);
+    TEST_RUN(test_input_inside_one_comment);
+    TEST_RUN(test_started_lexer_continues);
+    TEST_RUN(test_fallbacks_match_serial);
+    return Test_finish("lex_parallel");
+}
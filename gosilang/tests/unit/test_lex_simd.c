@@ -0,0 +1,135 @@
+// SIMD scanning kernels: every supported level must agree with the
+// scalar kernels, newline counts included, on inputs of every length
+// and alignment, and must not read past the end of the input. Inputs
+// end at a guard page, so a kernel reading too far faults.
+#include "core/tokenizer/lexer/lex_simd.h"
+#include "core/tokenizer/lexer/lexer.h"
+#include "test.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define MAX_LENGTH 100
+#define ROUNDS 2000
+
+static uint32_t random_state = 12345;
+
+static uint32_t NextRandom(void) {
+    random_state = random_state * 1103515245u + 12345u;
+    return random_state >> 8;
+}
+
+// Mostly identifier, space and comment bytes so runs are long enough to
+// cross vector widths
+static char RandomByte(void) {
+    static const char alphabet[] = "ab_Z09 \t\n\r*/*/x";
+    uint32_t r = NextRandom();
+    if (r % 16 == 0) return (char)(r >> 4);
+    return alphabet[(r >> 4) % (sizeof(alphabet) - 1)];
+}
+
+static bool SameNewlines(const LexNewlines* a, const LexNewlines* b) {
+    return a->count == b->count && a->last == b->last;
+}
+
+static void test_kernels_match_scalar(void) {
+    long page = sysconf(_SC_PAGESIZE);
+    char* pages = (char*)mmap(NULL, (size_t)page * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(pages != MAP_FAILED);
+    if (pages == MAP_FAILED) return;
+    CHECK(mprotect(pages + page, (size_t)page, PROT_NONE) == 0);
+    char* guard = pages + page;
+
+    const LexSimdKernels* scalar = LexSimd_getKernels(LEX_SIMD_SCALAR);
+    CHECK(scalar != NULL && LexSimd_getKernels(LEX_SIMD_BEST) != NULL);
+    LexSimdLevel levels[] = { LEX_SIMD_SSE2, LEX_SIMD_AVX2 };
+    for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+        const LexSimdKernels* kernels = LexSimd_getKernels(levels[l]);
+        CHECK((kernels != NULL) == LexSimd_isSupported(levels[l]));
+        if (!kernels) continue;
+
+        uint32_t mismatches = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            size_t length = NextRandom() % (MAX_LENGTH + 1);
+            char* p = guard - length;
+            for (size_t i = 0; i < length; i++) p[i] = RandomByte();
+            const char* end = guard;
+
+            LexNewlines a = { 0, NULL }, b = { 0, NULL };
+            if (kernels->skipWhitespace(p, end, &a) != scalar->skipWhitespace(p, end, &b) ||
+                !SameNewlines(&a, &b)) {
+                mismatches++;
+            }
+            if (kernels->scanIdentifier(p, end) != scalar->scanIdentifier(p, end)) mismatches++;
+
+            a = (LexNewlines){ 0, NULL };
+            b = (LexNewlines){ 0, NULL };
+            if (kernels->findCommentEnd(p, end, &a) != scalar->findCommentEnd(p, end, &b) ||
+                !SameNewlines(&a, &b)) {
+                mismatches++;
+            }
+            if (kernels->findLineEnd(p, end) != scalar->findLineEnd(p, end)) mismatches++;
+        }
+        if (mismatches) fprintf(stderr, "%s: %u mismatches\n", kernels->name, mismatches);
+        CHECK(mismatches == 0);
+    }
+    munmap(pages, (size_t)page * 2);
+}
+
+// A comment terminator split across a vector boundary
+static void test_comment_end_at_boundaries(void) {
+    const LexSimdKernels* best = LexSimd_getKernels(LEX_SIMD_BEST);
+    char text[80];
+    for (size_t star = 0; star + 1 < sizeof(text); star++) {
+        memset(text, 'x', sizeof(text));
+        text[star] = '*';
+        text[star + 1] = '/';
+        LexNewlines lines = { 0, NULL };
+        CHECK(best->findCommentEnd(text, text + sizeof(text), &lines) == text + star);
+    }
+
+    // A lone '*' as the last byte is not a terminator
+    memset(text, ' ', sizeof(text));
+    text[sizeof(text) - 1] = '*';
+    LexNewlines lines = { 0, NULL };
+    CHECK(best->findCommentEnd(text, text + sizeof(text), &lines) == text + sizeof(text));
+}
+
+// Every level lexes the same tokens
+static void test_lexer_levels(void) {
+    const char* text = "long_identifier_name_over_thirty_two_bytes   \n\n\t/* multi\nline\ncomment */ x // tail\ny";
+    LexSimdLevel levels[] = { LEX_SIMD_SCALAR, LEX_SIMD_SSE2, LEX_SIMD_AVX2 };
+    Token reference[16];
+    int reference_count = 0;
+    for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+        Lexer* lexer = Lexer_createFromBuffer(text, strlen(text), "levels");
+        if (!Lexer_setSimdLevel(lexer, levels[l])) {
+            Lexer_destroy(lexer);
+            continue;
+        }
+        Token token;
+        int count = 0;
+        while (Lexer_next(lexer, &token) && token.type != TOKEN_EOF && count < 16) {
+            if (l == 0) {
+                reference[count] = token;
+            } else {
+                CHECK(token.type == reference[count].type && token.offset == reference[count].offset &&
+                      token.length == reference[count].length &&
+                      token.line_number == reference[count].line_number &&
+                      token.column_number == reference[count].column_number);
+            }
+            count++;
+        }
+        if (l == 0) reference_count = count;
+        CHECK(count == reference_count && count == 5);
+        Lexer_destroy(lexer);
+    }
+}
+
+int main(void) {
+    TEST_RUN(test_kernels_match_scalar);
+    TEST_RUN(test_comment_end_at_boundaries);
+    TEST_RUN(test_lexer_levels);
+    return Test_finish("lex_simd");
+}
@@ -0,0 +1,237 @@
+// Lexer: token types, spellings and positions, comments, errors, chunked
+// descriptor input, interned values, spans and the token ring.
+#include "core/tokenizer/lexer/lexer.h"
+#include "test.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+static const char sample[] =
+    "int x = 0x1F + 3.5e2; // hi\n"
+    "/* c\n"
+    "*/ s = \"a\\n\" 'c' x<<=2 ... @";
+
+typedef struct Expected {
+    TokenType type;
+    const char* text;
+    int line;
+    int column;
+} Expected;
+
+static const Expected sample_tokens[] = {
+    { TOKEN_TYPE_INT, "int", 1, 1 },
+    { TOKEN_LITERAL_IDENTIFIER, "x", 1, 5 },
+    { TOKEN_EXPR_ASSIGNMENT, "=", 1, 7 },
+    { TOKEN_LITERAL_INTEGER, "0x1F", 1, 9 },
+    { TOKEN_EXPR_BINARY, "+", 1, 14 },
+    { TOKEN_LITERAL_FLOAT, "3.5e2", 1, 16 },
+    { TOKEN_PUNCT_SEMICOLON, ";", 1, 21 },
+    { TOKEN_COMMENT_SINGLE, "// hi", 1, 23 },
+    { TOKEN_COMMENT_MULTI, "/* c\n*/", 2, 1 },
+    { TOKEN_LITERAL_IDENTIFIER, "s", 3, 4 },
+    { TOKEN_EXPR_ASSIGNMENT, "=", 3, 6 },
+    { TOKEN_LITERAL_STRING, "\"a\\n\"", 3, 8 },
+    { TOKEN_LITERAL_CHAR, "'c'", 3, 14 },
+    { TOKEN_LITERAL_IDENTIFIER, "x", 3, 18 },
+    { TOKEN_EXPR_ASSIGNMENT, "<<=", 3, 19 },
+    { TOKEN_LITERAL_INTEGER, "2", 3, 22 },
+    { TOKEN_PUNCT_ELLIPSIS, "...", 3, 24 },
+    { TOKEN_ERROR, "@", 3, 28 },
+};
+#define SAMPLE_COUNT (sizeof(sample_tokens) / sizeof(sample_tokens[0]))
+
+static bool TokenMatches(const Token* token, const Expected* expected) {
+    size_t length = strlen(expected->text);
+    return token->type == expected->type && token->length == length &&
+           memcmp(token->value, expected->text, length) == 0 && token->line_number == expected->line &&
+           token->column_number == expected->column;
+}
+
+// Lexes to EOF, checking each token against sample_tokens as it comes,
+// since descriptor input may reuse the window on the next call
+static uint32_t CheckSample(Lexer* lexer, bool skip_comments) {
+    uint32_t matched = 0, seen = 0, index = 0;
+    Token token;
+    while (Lexer_next(lexer, &token) && token.type != TOKEN_EOF) {
+        while (skip_comments && index < SAMPLE_COUNT &&
+               (sample_tokens[index].type == TOKEN_COMMENT_SINGLE ||
+                sample_tokens[index].type == TOKEN_COMMENT_MULTI)) {
+            index++;
+        }
+        if (index < SAMPLE_COUNT && TokenMatches(&token, &sample_tokens[index])) matched++;
+        index++;
+        seen++;
+    }
+    CHECK(token.type == TOKEN_EOF && token.value == NULL);
+    CHECK(seen == matched);
+    return matched;
+}
+
+static void test_buffer_tokens(void) {
+    Lexer* lexer = Lexer_createFromBuffer(sample, strlen(sample), "sample");
+    CHECK(CheckSample(lexer, false) == SAMPLE_COUNT);
+    CHECK(lexer->error_count == 1);
+
+    // Nothing follows EOF
+    Token token;
+    CHECK(!Lexer_next(lexer, &token));
+    Lexer_destroy(lexer);
+}
+
+static void test_skip_comments(void) {
+    Lexer* lexer = Lexer_createFromBuffer(sample, strlen(sample), "sample");
+    lexer->skip_comments = true;
+    CHECK(CheckSample(lexer, true) == SAMPLE_COUNT - 2);
+    Lexer_destroy(lexer);
+}
+
+static void test_descriptor_chunks(void) {
+    // Chunks shorter than some tokens force refills mid-token
+    for (size_t chunk = 1; chunk <= 16; chunk++) {
+        FILE* file = tmpfile();
+        fwrite(sample, 1, strlen(sample), file);
+        fflush(file);
+        rewind(file);
+        Lexer* lexer = Lexer_createFromFd(fileno(file), chunk, "sample");
+        CHECK(lexer != NULL);
+        if (lexer) CHECK(CheckSample(lexer, false) == SAMPLE_COUNT);
+        Lexer_destroy(lexer);
+        fclose(file);
+    }
+}
+
+static void test_unterminated(void) {
+    const char* inputs[] = { "\"open", "/* open", "'x" };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        Lexer* lexer = Lexer_createFromBuffer(inputs[i], strlen(inputs[i]), "bad");
+        lexer->quiet = false;
+        Token token;
+        bool error = false;
+        while (Lexer_next(lexer, &token) && token.type != TOKEN_EOF) {
+            if (token.type == TOKEN_ERROR) error = true;
+        }
+        CHECK(error);
+        CHECK(token.type == TOKEN_EOF);
+        Lexer_destroy(lexer);
+    }
+}
+
+static void test_interned_values(void) {
+    const char* text = "alpha beta alpha + beta";
+    StringInterner* interner = StringInterner_create();
+    Lexer* lexer = Lexer_createFromBuffer(text, strlen(text), "interned");
+    Lexer_setInterner(lexer, interner);
+
+    Token tokens[5];
+    for (int i = 0; i < 5; i++) Lexer_next(lexer, &tokens[i]);
+    CHECK(tokens[0].lexeme >= LEXEME_RESERVED_COUNT && tokens[0].lexeme == tokens[2].lexeme);
+    CHECK(tokens[1].lexeme == tokens[4].lexeme && tokens[0].lexeme != tokens[1].lexeme);
+    CHECK(tokens[0].value == tokens[2].value);
+    CHECK(tokens[3].lexeme == LEXEME_PLUS);
+    CHECK_STR(tokens[1].value, "beta");
+
+    Lexer_destroy(lexer);
+    StringInterner_destroy(interner);
+}
+
+static void test_spans(void) {
+    SourceFile* source = SourceFile_fromBuffer(sample, strlen(sample), "sample");
+    Lexer* lexer = Lexer_createFromSource(source);
+    uint32_t matched = 0, count = 0;
+    TokenSpan span;
+    while (Lexer_nextSpan(lexer, &span) && span.type != TOKEN_EOF) {
+        Token token;
+        TokenSpan_toToken(&span, source, &token);
+        CHECK(token.line_number == 0);
+        // Spans carry no position; the source looks it up
+        SourceFile_locate(source, token.offset, &token.line_number, &token.column_number);
+        if (count < SAMPLE_COUNT && TokenMatches(&token, &sample_tokens[count])) matched++;
+        count++;
+    }
+    CHECK(count == SAMPLE_COUNT && matched == SAMPLE_COUNT);
+    Lexer_destroy(lexer);
+    SourceFile_close(source);
+}
+
+static void test_ring(void) {
+    CHECK(TokenRing_create(0) == NULL);
+    TokenRing* ring = TokenRing_create(3);
+    CHECK(ring->mask == 3);
+
+    const char* text = "a b c d e f";
+    Lexer* lexer = Lexer_createFromBuffer(text, strlen(text), "ring");
+    CHECK(Lexer_fill(lexer, ring) == 4);
+    CHECK(TokenRing_isFull(ring) && TokenRing_count(ring) == 4);
+    CHECK(TokenRing_peek(ring, 3) && TokenRing_peek(ring, 3)->value[0] == 'd');
+    CHECK(TokenRing_peek(ring, 4) == NULL);
+
+    Token token;
+    CHECK(TokenRing_pop(ring, &token) && token.value[0] == 'a');
+    CHECK(!TokenRing_push(ring, &token) || TokenRing_count(ring) == 4);
+
+    // Draining and refilling wraps head and tail around the ring
+    while (TokenRing_pop(ring, &token)) {
+    }
+    CHECK(TokenRing_count(ring) == 0 && !TokenRing_pop(ring, &token));
+    Lexer_fill(lexer, ring);
+    CHECK(TokenRing_peek(ring, 0) && TokenRing_peek(ring, 0)->value[0] == 'e');
+
+    Lexer_destroy(lexer);
+    TokenRing_destroy(ring);
+}
+
+// Every queued value survives the window refills of later tokens
+static bool RingMatches(const TokenRing* ring, uint32_t first) {
+    char name[32];
+    for (uint32_t i = 0; i < TokenRing_count(ring); i++) {
+        const Token* token = TokenRing_peek(ring, i);
+        if (token->type == TOKEN_EOF) continue;
+        snprintf(name, sizeof(name), (first + i) % 3 ? "ident_%u" : "\"text %u\"", first + i);
+        if (token->length != strlen(name) || strncmp(token->value, name, token->length) != 0) return false;
+    }
+    return true;
+}
+
+static void test_ring_descriptor_chunks(void) {
+    char text[1024];
+    size_t length = 0;
+    for (uint32_t i = 0; i < 40; i++) {
+        length += (size_t)snprintf(text + length, sizeof(text) - length,
+                                   i % 3 ? "ident_%u " : "\"text %u\" ", i);
+    }
+    int fds[2];
+    CHECK(pipe(fds) == 0 && write(fds[1], text, length) == (ssize_t)length);
+    close(fds[1]);
+
+    Lexer* lexer = Lexer_createFromFd(fds[0], 16, "pipe");
+    TokenRing* ring = TokenRing_create(16);
+    CHECK(Lexer_fill(lexer, ring) == 16 && RingMatches(ring, 0));
+
+    // A popped value lasts until the next fill, queued ones beyond it
+    Token token;
+    for (int i = 0; i < 5; i++) TokenRing_pop(ring, &token);
+    CHECK(strcmp(token.value, "ident_4") == 0);
+    CHECK(Lexer_fill(lexer, ring) == 5 && RingMatches(ring, 5));
+
+    uint32_t first = 5;
+    while (TokenRing_count(ring) > 0) {
+        while (TokenRing_pop(ring, NULL)) first++;
+        Lexer_fill(lexer, ring);
+        CHECK(RingMatches(ring, first));
+    }
+    CHECK(first == 41);   // Forty tokens and the EOF
+    TokenRing_destroy(ring);
+    Lexer_destroy(lexer);
+    close(fds[0]);
+}
+
+int main(void) {
+    TEST_RUN(test_buffer_tokens);
+    TEST_RUN(test_skip_comments);
+    TEST_RUN(test_descriptor_chunks);
+    TEST_RUN(test_unterminated);
+    TEST_RUN(test_interned_values);
+    TEST_RUN(test_spans);
+    TEST_RUN(test_ring);
+    TEST_RUN(test_ring_descriptor_chunks);
+    return Test_finish("lexer");
+}
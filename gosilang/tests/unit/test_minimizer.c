@@ -0,0 +1,298 @@
+// Dfa_minimize: merging, dead and unreachable states, the empty
+// language, accept labels and signatures, canonical numbering, and a
+// randomized check against the original language and a naive
+// (Moore) minimality test.
+#include "core/minimizer/minimizer.h"
+#include "test.h"
+#include <stdlib.h>
+
+#define RANDOM_DFAS 3000
+#define RANDOM_MAX_STATES 12
+#define RANDOM_MAX_SYMBOLS 3
+
+static Dfa* Build(uint32_t states, uint32_t symbols, const uint32_t* table, const uint32_t* accepts) {
+    Dfa* dfa = Dfa_create(states, symbols);
+    for (uint32_t s = 0; s < states; s++) {
+        dfa->accepts[s] = accepts[s];
+        for (uint32_t a = 0; a < symbols; a++) Dfa_setTransition(dfa, s, a, table[s * symbols + a]);
+    }
+    return dfa;
+}
+
+#define N DFA_NO_STATE
+
+static void test_merges_equivalent_states(void) {
+    // (a|b)*b over {a, b}, with the 'seen b' state split in two
+    static const uint32_t table[] = {
+        0, 1,
+        0, 2,
+        0, 1,
+    };
+    static const uint32_t accepts[] = { 0, 1, 1 };
+    Dfa* dfa = Build(3, 2, table, accepts);
+    uint32_t map[3];
+    Dfa* min = Dfa_minimize(dfa, NULL, map);
+    CHECK(min && min->state_count == 2 && min->start == 0);
+    CHECK(map[0] == 0 && map[1] == map[2] && map[1] == 1);
+    CHECK(Dfa_next(min, 0, 0) == 0 && Dfa_next(min, 0, 1) == 1 && Dfa_next(min, 1, 0) == 0);
+    CHECK(min->accepts[1] == 1 && min->accepts[0] == 0);
+    Dfa_destroy(min);
+    Dfa_destroy(dfa);
+}
+
+static void test_drops_dead_and_unreachable_states(void) {
+    // 0 -a-> 1 (accept); 0 -b-> 2, a non-accepting loop that never
+    // accepts; 3 is an explicit error sink; 4 is unreachable
+    static const uint32_t table[] = {
+        1, 2,
+        3, 3,
+        2, 2,
+        3, 3,
+        1, 0,
+    };
+    static const uint32_t accepts[] = { 0, 1, 0, 0, 1 };
+    Dfa* dfa = Build(5, 2, table, accepts);
+    uint32_t map[5];
+    Dfa* min = Dfa_minimize(dfa, NULL, map);
+    CHECK(min && min->state_count == 2);
+    CHECK(Dfa_next(min, 0, 0) == 1 && Dfa_next(min, 0, 1) == N);
+    CHECK(Dfa_next(min, 1, 0) == N && Dfa_next(min, 1, 1) == N);
+    CHECK(map[2] == N && map[3] == N && map[4] == N);
+    Dfa_destroy(min);
+    Dfa_destroy(dfa);
+}
+
+static void test_empty_language(void) {
+    // Nothing is ever accepted: one rejecting state with no transitions
+    static const uint32_t table[] = { 1, 0, 1, 1 };
+    static const uint32_t accepts[] = { 0, 0 };
+    Dfa* dfa = Build(2, 2, table, accepts);
+    uint32_t map[2];
+    Dfa* min = Dfa_minimize(dfa, NULL, map);
+    CHECK(min && min->state_count == 1 && min->accepts[0] == 0);
+    CHECK(Dfa_next(min, 0, 0) == N && Dfa_next(min, 0, 1) == N);
+    CHECK(map[0] == N && map[1] == N);
+    Dfa_destroy(min);
+    Dfa_destroy(dfa);
+
+    CHECK(Dfa_minimize(NULL, NULL, NULL) == NULL);
+    Dfa* bad_start = Dfa_create(1, 1);
+    bad_start->start = 5;
+    CHECK(Dfa_minimize(bad_start, NULL, NULL) == NULL);
+    Dfa_destroy(bad_start);
+}
+
+static void test_labels_and_signatures(void) {
+    // 1 and 2 behave alike but accept different things
+    static const uint32_t table[] = { 1, 2, N, N, N, N };
+    static const uint32_t accepts[] = { 0, 7, 9 };
+    Dfa* dfa = Build(3, 2, table, accepts);
+    Dfa* min = Dfa_minimize(dfa, NULL, NULL);
+    CHECK(min->state_count == 3);
+    Dfa_destroy(min);
+
+    // Same labels merge unless the signatures differ
+    dfa->accepts[2] = 7;
+    min = Dfa_minimize(dfa, NULL, NULL);
+    CHECK(min->state_count == 2);
+    Dfa_destroy(min);
+    uint32_t signatures[] = { 0, 1, 2 };
+    min = Dfa_minimize(dfa, signatures, NULL);
+    CHECK(min->state_count == 3);
+    Dfa_destroy(min);
+    Dfa_destroy(dfa);
+
+    // Dead states are dropped even when their signatures differ from
+    // the sink's and from each other
+    static const uint32_t dead_table[] = {
+        1, 2,
+        N, N,
+        3, 2,
+        2, 3,
+    };
+    static const uint32_t dead_accepts[] = { 0, 1, 0, 0 };
+    uint32_t dead_signatures[] = { 0, 0, 5, 6 };
+    uint32_t map[4];
+    dfa = Build(4, 2, dead_table, dead_accepts);
+    min = Dfa_minimize(dfa, dead_signatures, map);
+    CHECK(min->state_count == 2);
+    CHECK(Dfa_next(min, 0, 0) == 1 && Dfa_next(min, 0, 1) == N);
+    CHECK(map[2] == N && map[3] == N);
+    Dfa_destroy(min);
+    Dfa_destroy(dfa);
+}
+
+static bool SameTables(const Dfa* a, const Dfa* b) {
+    if (a->state_count != b->state_count || a->symbol_count != b->symbol_count || a->start != b->start) return false;
+    size_t cells = (size_t)a->state_count * a->symbol_count;
+    return memcmp(a->transitions, b->transitions, cells * sizeof(uint32_t)) == 0 &&
+           memcmp(a->accepts, b->accepts, a->state_count * sizeof(uint32_t)) == 0;
+}
+
+static uint32_t random_state = 99;
+
+static uint32_t NextRandom(uint32_t bound) {
+    random_state = random_state * 1103515245u + 12345u;
+    return (random_state >> 8) % bound;
+}
+
+static Dfa* RandomDfa(void) {
+    uint32_t states = 1 + NextRandom(RANDOM_MAX_STATES);
+    uint32_t symbols = 1 + NextRandom(RANDOM_MAX_SYMBOLS);
+    Dfa* dfa = Dfa_create(states, symbols);
+    dfa->start = NextRandom(states);
+    for (uint32_t s = 0; s < states; s++) {
+        dfa->accepts[s] = NextRandom(4) == 0 ? 1 + NextRandom(2) : 0;
+        for (uint32_t a = 0; a < symbols; a++) {
+            Dfa_setTransition(dfa, s, a, NextRandom(5) == 0 ? N : NextRandom(states));
+        }
+    }
+    return dfa;
+}
+
+// Walks the product of both automata; every reachable pair must agree
+// on what it accepts, with a missing state accepting nothing
+static bool SameLanguage(const Dfa* a, const Dfa* b) {
+    uint32_t width = b->state_count + 1;
+    size_t pairs = (size_t)(a->state_count + 1) * width;
+    bool* seen = (bool*)calloc(pairs, sizeof(bool));
+    uint32_t* queue = (uint32_t*)malloc(pairs * 2 * sizeof(uint32_t));
+    uint32_t head = 0, tail = 0;
+    bool same = true;
+    queue[tail++] = a->start;
+    queue[tail++] = b->start;
+    seen[(size_t)a->start * width + b->start] = true;
+    while (head < tail && same) {
+        uint32_t p = queue[head++], q = queue[head++];
+        uint32_t pa = p == N ? 0 : a->accepts[p];
+        uint32_t qa = q == N ? 0 : b->accepts[q];
+        if (pa != qa) same = false;
+        for (uint32_t s = 0; s < a->symbol_count; s++) {
+            uint32_t np = p == N ? N : Dfa_next(a, p, s);
+            uint32_t nq = q == N ? N : Dfa_next(b, q, s);
+            size_t key = (size_t)(np == N ? a->state_count : np) * width + (nq == N ? b->state_count : nq);
+            if (!seen[key]) {
+                seen[key] = true;
+                queue[tail++] = np;
+                queue[tail++] = nq;
+            }
+        }
+    }
+    free(queue);
+    free(seen);
+    return same;
+}
+
+// Moore refinement on the result plus an explicit sink: the automaton
+// is minimal when every state ends in its own block, none with the sink
+static bool IsMinimal(const Dfa* dfa) {
+    uint32_t n = dfa->state_count, k = dfa->symbol_count, sink = n;
+    uint32_t* block = (uint32_t*)malloc((n + 1) * sizeof(uint32_t));
+    uint32_t* next = (uint32_t*)malloc((n + 1) * sizeof(uint32_t));
+    for (uint32_t s = 0; s < n; s++) block[s] = dfa->accepts[s];
+    block[sink] = 0;
+
+    uint32_t blocks = 0;
+    for (;;) {
+        // Two states share a new block when they shared the old one and
+        // every transition leads to the same old block
+        uint32_t count = 0;
+        for (uint32_t s = 0; s <= n; s++) {
+            next[s] = N;
+            for (uint32_t t = 0; t < s && next[s] == N; t++) {
+                bool same = block[s] == block[t];
+                for (uint32_t a = 0; a < k && same; a++) {
+                    uint32_t ns = s == sink ? sink : Dfa_next(dfa, s, a);
+                    uint32_t nt = t == sink ? sink : Dfa_next(dfa, t, a);
+                    same = block[ns == N ? sink : ns] == block[nt == N ? sink : nt];
+                }
+                if (same) next[s] = next[t];
+            }
+            if (next[s] == N) next[s] = count++;
+        }
+        memcpy(block, next, (n + 1) * sizeof(uint32_t));
+        if (count == blocks) break;
+        blocks = count;
+    }
+
+    bool minimal = blocks == n + 1 || (n == 1 && dfa->accepts[0] == 0 && blocks == 1);
+    free(next);
+    free(block);
+    return minimal;
+}
+
+static void test_random_automata(void) {
+    // The checker itself rejects a split state and a dead state
+    static const uint32_t split[] = { 0, 1, 0, 2, 0, 1 };
+    static const uint32_t split_accepts[] = { 0, 1, 1 };
+    static const uint32_t dead[] = { 1, 0, 1, 1 };
+    static const uint32_t dead_accepts[] = { 1, 0 };
+    Dfa* check = Build(3, 2, split, split_accepts);
+    CHECK(!IsMinimal(check));
+    Dfa_destroy(check);
+    check = Build(2, 2, dead, dead_accepts);
+    CHECK(!IsMinimal(check));
+    Dfa_destroy(check);
+
+    uint32_t wrong_language = 0, not_minimal = 0, not_canonical = 0;
+    for (int i = 0; i < RANDOM_DFAS; i++) {
+        Dfa* dfa = RandomDfa();
+        Dfa* min = Dfa_minimize(dfa, NULL, NULL);
+        if (!SameLanguage(dfa, min)) wrong_language++;
+        if (!IsMinimal(min)) not_minimal++;
+
+        // Minimizing the minimized automaton changes nothing
+        Dfa* again = Dfa_minimize(min, NULL, NULL);
+        if (!SameTables(min, again)) not_canonical++;
+        Dfa_destroy(again);
+        Dfa_destroy(min);
+        Dfa_destroy(dfa);
+    }
+    CHECK(wrong_language == 0);
+    CHECK(not_minimal == 0);
+    CHECK(not_canonical == 0);
+}
+
+static void test_renumbering_gives_same_table(void) {
+    // The same automaton with its states permuted
+    for (int i = 0; i < 200; i++) {
+        Dfa* dfa = RandomDfa();
+        uint32_t n = dfa->state_count, k = dfa->symbol_count;
+        uint32_t* permutation = (uint32_t*)malloc(n * sizeof(uint32_t));
+        for (uint32_t s = 0; s < n; s++) permutation[s] = s;
+        for (uint32_t s = n; s > 1; s--) {
+            uint32_t j = NextRandom(s);
+            uint32_t swap = permutation[s - 1];
+            permutation[s - 1] = permutation[j];
+            permutation[j] = swap;
+        }
+        Dfa* shuffled = Dfa_create(n, k);
+        shuffled->start = permutation[dfa->start];
+        for (uint32_t s = 0; s < n; s++) {
+            shuffled->accepts[permutation[s]] = dfa->accepts[s];
+            for (uint32_t a = 0; a < k; a++) {
+                uint32_t to = Dfa_next(dfa, s, a);
+                Dfa_setTransition(shuffled, permutation[s], a, to == N ? N : permutation[to]);
+            }
+        }
+
+        Dfa* a = Dfa_minimize(dfa, NULL, NULL);
+        Dfa* b = Dfa_minimize(shuffled, NULL, NULL);
+        CHECK(SameTables(a, b));
+        Dfa_destroy(a);
+        Dfa_destroy(b);
+        Dfa_destroy(shuffled);
+        Dfa_destroy(dfa);
+        free(permutation);
+    }
+}
+
+int main(void) {
+    TEST_RUN(test_merges_equivalent_states);
+    TEST_RUN(test_drops_dead_and_unreachable_states);
+    TEST_RUN(test_empty_language);
+    TEST_RUN(test_labels_and_signatures);
+    TEST_RUN(test_random_automata);
+    TEST_RUN(test_renumbering_gives_same_table);
+    return Test_finish("minimizer");
+}
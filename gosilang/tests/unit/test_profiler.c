@@ -0,0 +1,147 @@
+// Profiler: timers and counters record nothing while off and exactly
+// what was recorded while on, blocks from many threads merge, and
+// SIGPROF sampling walks frame pointers out of the interrupted function
+// into collapsed stacks that account for every sample.
+#include "runtime/debug/profiler/profiler.h"
+#include "test.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double CpuSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void test_names(void) {
+    CHECK_STR(ProfileTimer_toString(PROFILE_TIMER_LEX), "lex");
+    CHECK_STR(ProfileTimer_toString(PROFILE_TIMER_COUNT), "unknown");
+    CHECK_STR(ProfileCounter_toString(PROFILE_COUNTER_DAG_NODES), "dag nodes");
+    CHECK_STR(ProfileCounter_toString((ProfileCounter)-1), "unknown");
+}
+
+static void Scoped(void) {
+    PROFILE_SCOPE(PROFILE_TIMER_PARSE);
+    PROFILE_COUNT(PROFILE_COUNTER_FOLDED, 2);
+}
+
+static void test_records_only_while_on(void) {
+    ProfileTotals before, after;
+    Profiler_totals(&before);
+    for (int i = 0; i < 1000; i++) Scoped();
+    PROFILE_TIME(PROFILE_TIMER_FOLD, 5);
+    Profiler_totals(&after);
+    CHECK(after.timer_calls[PROFILE_TIMER_PARSE] == before.timer_calls[PROFILE_TIMER_PARSE]);
+    CHECK(after.counters[PROFILE_COUNTER_FOLDED] == before.counters[PROFILE_COUNTER_FOLDED]);
+    CHECK(after.timer_ns[PROFILE_TIMER_FOLD] == before.timer_ns[PROFILE_TIMER_FOLD]);
+
+    Profiler_setTiming(true);
+    for (int i = 0; i < 1000; i++) Scoped();
+    PROFILE_TIME(PROFILE_TIMER_FOLD, 5);
+    Profiler_setTiming(false);
+    Profiler_totals(&after);
+    CHECK(after.timer_calls[PROFILE_TIMER_PARSE] == before.timer_calls[PROFILE_TIMER_PARSE] + 1000);
+    CHECK(after.counters[PROFILE_COUNTER_FOLDED] == before.counters[PROFILE_COUNTER_FOLDED] + 2000);
+    CHECK(after.timer_ns[PROFILE_TIMER_FOLD] == before.timer_ns[PROFILE_TIMER_FOLD] + 5);
+    CHECK(after.timer_calls[PROFILE_TIMER_FOLD] == before.timer_calls[PROFILE_TIMER_FOLD] + 1);
+}
+
+enum { RECORD_THREADS = 8, RECORDS_PER_THREAD = 20000 };
+
+static void* RecordMany(void* argument) {
+    (void)argument;
+    for (int i = 0; i < RECORDS_PER_THREAD; i++) {
+        PROFILE_SCOPE(PROFILE_TIMER_LEX);
+        PROFILE_COUNT(PROFILE_COUNTER_TOKENS, (uint64_t)i);
+    }
+    return NULL;
+}
+
+// Blocks outlive their threads and are summed when read
+static void test_threads_merge(void) {
+    ProfileTotals before, after;
+    Profiler_totals(&before);
+    Profiler_setTiming(true);
+    pthread_t threads[RECORD_THREADS];
+    for (int t = 0; t < RECORD_THREADS; t++) CHECK(pthread_create(&threads[t], NULL, RecordMany, NULL) == 0);
+    for (int t = 0; t < RECORD_THREADS; t++) pthread_join(threads[t], NULL);
+    Profiler_setTiming(false);
+
+    Profiler_totals(&after);
+    CHECK(after.threads == before.threads + RECORD_THREADS);
+    CHECK(after.timer_calls[PROFILE_TIMER_LEX] - before.timer_calls[PROFILE_TIMER_LEX] ==
+          (uint64_t)RECORD_THREADS * RECORDS_PER_THREAD);
+    CHECK(after.counters[PROFILE_COUNTER_TOKENS] - before.counters[PROFILE_COUNTER_TOKENS] ==
+          (uint64_t)RECORD_THREADS * RECORDS_PER_THREAD * (RECORDS_PER_THREAD - 1) / 2);
+}
+
+// Exported, so dladdr can name them, and kept out of line, so each has
+// its own frame
+__attribute__((noinline)) uint64_t profiler_test_hot_loop(double seconds) {
+    uint64_t x = 1;
+    double end = CpuSeconds() + seconds;
+    while (CpuSeconds() < end) {
+        for (int i = 0; i < 10000; i++) x = x * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    return x;
+}
+
+__attribute__((noinline)) uint64_t profiler_test_outer(double seconds) {
+    return profiler_test_hot_loop(seconds) + 1;
+}
+
+static void* BurnThread(void* argument) {
+    *(uint64_t*)argument = profiler_test_outer(0.1);
+    return NULL;
+}
+
+static void test_sampled_stacks(void) {
+    CHECK(Profiler_startSampling(1000, 0));
+    CHECK(!Profiler_startSampling(1000, 0));
+    uint64_t burned = 0;
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, BurnThread, &burned) == 0);
+    uint64_t here = profiler_test_outer(0.2);
+    pthread_join(thread, NULL);
+    Profiler_stopSampling();
+    CHECK(burned != 0 && here != 0);
+
+    FILE* stream = tmpfile();
+    uint64_t written = Profiler_writeCollapsed(stream);
+    CHECK(written > 0 && written == Profiler_samples() - Profiler_dropped());
+
+    // Every line is "outer;...;leaf count" and the counts add up. The
+    // walk reaches past the sampled function into its caller.
+    rewind(stream);
+    char line[8192];
+    uint64_t counted = 0, hot = 0, walked = 0;
+    bool well_formed = true;
+    while (fgets(line, sizeof(line), stream)) {
+        char* space = strrchr(line, ' ');
+        unsigned long long count = space ? strtoull(space + 1, NULL, 10) : 0;
+        well_formed = well_formed && space && space > line && count > 0;
+        counted += count;
+        if (strstr(line, "profiler_test_hot_loop")) hot += count;
+        if (strstr(line, "profiler_test_outer;profiler_test_hot_loop")) walked += count;
+    }
+    fclose(stream);
+    CHECK(well_formed);
+    CHECK(counted == written);
+    CHECK(hot > 0);
+    CHECK(walked > hot / 2);
+
+    // The ring is drained
+    stream = tmpfile();
+    CHECK(Profiler_writeCollapsed(stream) == 0);
+    fclose(stream);
+}
+
+int main(void) {
+    TEST_RUN(test_names);
+    TEST_RUN(test_records_only_while_on);
+    TEST_RUN(test_threads_merge);
+    TEST_RUN(test_sampled_stacks);
+    Profiler_shutdown();
+    return Test_finish("profiler");
+}
@@ -0,0 +1,175 @@
+// SharedInterner and SharedScope: reserved ids match a StringInterner,
+// names round-trip, threads interning the same names in different
+// orders agree on one id per name, a local interner publishes into the
+// shared one, and a scope keeps the first of two declarations.
+#include "core/tokenizer/symbols/sym_shared.h"
+#include "test.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+#define SHARED_THREADS 4
+#define SHARED_NAMES 5000
+
+static void test_reserved_ids(void) {
+    SharedInterner* interner = SharedInterner_create();
+    CHECK(interner != NULL);
+    CHECK(SharedInterner_count(interner) == LEXEME_RESERVED_COUNT);
+    CHECK(SharedInterner_find(interner, "while", 5) == LEXEME_KEYWORD_FIRST + KW_WHILE);
+    CHECK(SharedInterner_intern(interner, "+", 1) == LEXEME_PLUS);
+    CHECK(SharedInterner_intern(interner, "<<=", 3) == LEXEME_SHL_ASSIGN);
+    CHECK(SharedInterner_find(interner, "true", 4) == LEXEME_TRUE);
+    CHECK(SharedInterner_count(interner) == LEXEME_RESERVED_COUNT);
+    SharedInterner_destroy(interner);
+}
+
+static void test_intern_round_trip(void) {
+    SharedInterner* interner = SharedInterner_create();
+    char buffer[] = "counter_and_more";
+    CHECK(SharedInterner_find(interner, "counter", 7) == LEXEME_NONE);
+    LexemeId id = SharedInterner_intern(interner, buffer, 7);
+    CHECK(id >= LEXEME_RESERVED_COUNT);
+    CHECK(SharedInterner_intern(interner, "counter", 7) == id);
+    CHECK(SharedInterner_find(interner, "counter", 7) == id);
+    CHECK(SharedInterner_intern(interner, "counte", 6) != id);
+
+    uint32_t length = 0;
+    CHECK_STR(SharedInterner_get(interner, id, &length), "counter");
+    CHECK(length == 7);
+    CHECK(SharedInterner_count(interner) == LEXEME_RESERVED_COUNT + 2);
+    SharedInterner_destroy(interner);
+}
+
+typedef struct InternJob {
+    SharedInterner* interner;
+    uint32_t offset;
+    LexemeId ids[SHARED_NAMES];
+} InternJob;
+
+// Interns every name, starting at a different one on each thread
+static void* InternNames(void* arg) {
+    InternJob* job = (InternJob*)arg;
+    char name[32];
+    for (uint32_t i = 0; i < SHARED_NAMES; i++) {
+        uint32_t n = (i + job->offset) % SHARED_NAMES;
+        int length = snprintf(name, sizeof(name), "name_%u", n);
+        job->ids[n] = SharedInterner_intern(job->interner, name, (size_t)length);
+    }
+    return NULL;
+}
+
+static void test_concurrent_interning(void) {
+    SharedInterner* interner = SharedInterner_create();
+    InternJob* jobs = (InternJob*)calloc(SHARED_THREADS, sizeof(InternJob));
+    pthread_t threads[SHARED_THREADS];
+    for (uint32_t t = 0; t < SHARED_THREADS; t++) {
+        jobs[t].interner = interner;
+        jobs[t].offset = t * (SHARED_NAMES / SHARED_THREADS);
+        pthread_create(&threads[t], NULL, InternNames, &jobs[t]);
+    }
+    for (uint32_t t = 0; t < SHARED_THREADS; t++) pthread_join(threads[t], NULL);
+
+    uint32_t disagree = 0, wrong = 0;
+    char name[32];
+    for (uint32_t n = 0; n < SHARED_NAMES; n++) {
+        for (uint32_t t = 1; t < SHARED_THREADS; t++) {
+            if (jobs[t].ids[n] != jobs[0].ids[n]) disagree++;
+        }
+        snprintf(name, sizeof(name), "name_%u", n);
+        const char* text = SharedInterner_get(interner, jobs[0].ids[n], NULL);
+        if (jobs[0].ids[n] < LEXEME_RESERVED_COUNT || !text || strcmp(text, name) != 0) wrong++;
+    }
+    CHECK(disagree == 0 && wrong == 0);
+    CHECK(SharedInterner_count(interner) == LEXEME_RESERVED_COUNT + SHARED_NAMES);
+    free(jobs);
+    SharedInterner_destroy(interner);
+}
+
+static void test_publish_local_interner(void) {
+    SharedInterner* interner = SharedInterner_create();
+    LexemeId existing = SharedInterner_intern(interner, "beta", 4);
+
+    StringInterner* local = StringInterner_create();
+    LexemeId alpha = StringInterner_intern(local, "alpha", 5);
+    LexemeId beta = StringInterner_intern(local, "beta", 4);
+    LexemeId* map = (LexemeId*)malloc(local->count * sizeof(LexemeId));
+    CHECK(SharedInterner_publish(interner, local, map));
+
+    CHECK(map[LEXEME_PLUS] == LEXEME_PLUS);
+    CHECK(map[beta] == existing);
+    CHECK(map[alpha] == SharedInterner_find(interner, "alpha", 5));
+    CHECK_STR(SharedInterner_get(interner, map[alpha], NULL), "alpha");
+    CHECK(SharedInterner_count(interner) == LEXEME_RESERVED_COUNT + 2);
+
+    free(map);
+    StringInterner_destroy(local);
+    SharedInterner_destroy(interner);
+}
+
+static void test_scope_add_and_find(void) {
+    SharedScope* scope = SharedScope_create();
+    CHECK(scope != NULL && SharedScope_count(scope) == 0);
+
+    SymbolTableEntry* x = CreateSymbol("x", TOKEN_LITERAL_IDENTIFIER);
+    CHECK(SharedScope_add(scope, x));
+    CHECK(SharedScope_add(scope, CreateSymbol("y", TOKEN_LITERAL_IDENTIFIER)));
+    CHECK(SharedScope_find(scope, "x", 1, Lexeme_hash("x", 1)) == x);
+    CHECK(SharedScope_find(scope, "z", 1, Lexeme_hash("z", 1)) == NULL);
+
+    // A redeclaration leaves the first symbol and its owner in place
+    SymbolTableEntry* again = CreateSymbol("x", TOKEN_LITERAL_IDENTIFIER);
+    CHECK(!SharedScope_add(scope, again));
+    CHECK(SharedScope_find(scope, "x", 1, Lexeme_hash("x", 1)) == x);
+    CHECK(SharedScope_count(scope) == 2);
+    DestroySymbol(again);
+    SharedScope_destroy(scope);
+}
+
+typedef struct DeclareJob {
+    SharedScope* scope;
+    uint32_t added;
+} DeclareJob;
+
+// Every thread declares the same names; each is added once
+static void* DeclareNames(void* arg) {
+    DeclareJob* job = (DeclareJob*)arg;
+    char name[32];
+    for (uint32_t n = 0; n < SHARED_NAMES; n++) {
+        snprintf(name, sizeof(name), "global_%u", n);
+        SymbolTableEntry* symbol = CreateSymbol(name, TOKEN_LITERAL_IDENTIFIER);
+        if (SharedScope_add(job->scope, symbol)) {
+            job->added++;
+        } else {
+            DestroySymbol(symbol);
+        }
+    }
+    return NULL;
+}
+
+static void test_concurrent_declarations(void) {
+    SharedScope* scope = SharedScope_create();
+    DeclareJob jobs[SHARED_THREADS] = { 0 };
+    pthread_t threads[SHARED_THREADS];
+    for (uint32_t t = 0; t < SHARED_THREADS; t++) {
+        jobs[t].scope = scope;
+        pthread_create(&threads[t], NULL, DeclareNames, &jobs[t]);
+    }
+    uint32_t added = 0;
+    for (uint32_t t = 0; t < SHARED_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        added += jobs[t].added;
+    }
+    CHECK(added == SHARED_NAMES);
+    CHECK(SharedScope_count(scope) == SHARED_NAMES);
+    CHECK(SharedScope_find(scope, "global_4999", 11, Lexeme_hash("global_4999", 11)) != NULL);
+    SharedScope_destroy(scope);
+}
+
+int main(void) {
+    TEST_RUN(test_reserved_ids);
+    TEST_RUN(test_intern_round_trip);
+    TEST_RUN(test_concurrent_interning);
+    TEST_RUN(test_publish_local_interner);
+    TEST_RUN(test_scope_add_and_find);
+    TEST_RUN(test_concurrent_declarations);
+    return Test_finish("shared");
+}
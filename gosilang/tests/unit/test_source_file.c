@@ -0,0 +1,111 @@
+// SourceFile: mapped, empty and piped input, offsets to line and column,
+// line text, and a lexer reading spans straight from a mapping.
+#include "core/tokenizer/source/source_file.h"
+#include "core/tokenizer/lexer/lexer.h"
+#include "test.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+static const char text[] = "first line\n\nthird\nlast, no newline";
+
+static char* WriteTemp(const char* data, size_t length) {
+    static char path[64];
+    strcpy(path, "/tmp/gosi_source_XXXXXX");
+    int fd = mkstemp(path);
+    if (fd < 0) return NULL;
+    if (write(fd, data, length) != (ssize_t)length) {
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    return path;
+}
+
+static void test_mapped_file(void) {
+    char* path = WriteTemp(text, strlen(text));
+    CHECK(path != NULL);
+    SourceFile* source = SourceFile_open(path);
+    CHECK(source != NULL && source->mapped);
+    CHECK(source->size == strlen(text) && memcmp(source->data, text, source->size) == 0);
+    CHECK_STR(source->path, path);
+    SourceFile_close(source);
+    unlink(path);
+
+    CHECK(SourceFile_open("/nonexistent/gosi/source") == NULL);
+    CHECK(SourceFile_open(NULL) == NULL);
+}
+
+static void test_empty_file(void) {
+    char* path = WriteTemp("", 0);
+    SourceFile* source = SourceFile_open(path);
+    CHECK(source != NULL && source->size == 0 && !source->mapped);
+
+    int line = 0, column = 0;
+    CHECK(SourceFile_locate(source, 0, &line, &column) && line == 1 && column == 1);
+    size_t length = 99;
+    CHECK(SourceFile_lineText(source, 1, &length) != NULL && length == 0);
+    SourceFile_close(source);
+    unlink(path);
+}
+
+// Pipes cannot be mapped and are read into memory instead
+static void test_pipe(void) {
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    CHECK(write(fds[1], text, strlen(text)) == (ssize_t)strlen(text));
+    close(fds[1]);
+    char path[32];
+    snprintf(path, sizeof(path), "/dev/fd/%d", fds[0]);
+    SourceFile* source = SourceFile_open(path);
+    CHECK(source != NULL && !source->mapped && source->owned != NULL);
+    CHECK(source && source->size == strlen(text) && memcmp(source->data, text, source->size) == 0);
+    SourceFile_close(source);
+    close(fds[0]);
+}
+
+static void test_positions(void) {
+    SourceFile* source = SourceFile_fromBuffer(text, strlen(text), "text");
+    int line = 0, column = 0;
+    CHECK(SourceFile_locate(source, 0, &line, &column) && line == 1 && column == 1);
+    CHECK(SourceFile_locate(source, 10, &line, &column) && line == 1 && column == 11);
+    CHECK(SourceFile_locate(source, 11, &line, &column) && line == 2 && column == 1);
+    CHECK(SourceFile_locate(source, 12, &line, &column) && line == 3 && column == 1);
+    CHECK(SourceFile_locate(source, strlen(text), &line, &column) && line == 4);
+    CHECK(!SourceFile_locate(source, strlen(text) + 1, &line, &column));
+    CHECK(source->line_count == 4);
+
+    size_t length = 0;
+    const char* third = SourceFile_lineText(source, 3, &length);
+    CHECK(third && length == 5 && memcmp(third, "third", 5) == 0);
+    CHECK(SourceFile_lineText(source, 2, &length) && length == 0);
+    CHECK(SourceFile_lineText(source, 4, &length) && length == strlen("last, no newline"));
+    CHECK(SourceFile_lineText(source, 5, &length) == NULL);
+    CHECK(SourceFile_lineText(source, 0, &length) == NULL);
+    SourceFile_close(source);
+
+    CHECK(SourceFile_fromBuffer(NULL, 1, "bad") == NULL);
+}
+
+// Identifier spans point into the mapping itself
+static void test_lexing_mapped_source(void) {
+    char* path = WriteTemp(text, strlen(text));
+    SourceFile* source = SourceFile_open(path);
+    Lexer* lexer = Lexer_createFromSource(source);
+    TokenSpan span;
+    CHECK(Lexer_nextSpan(lexer, &span) && span.type == TOKEN_LITERAL_IDENTIFIER);
+    Token token;
+    TokenSpan_toToken(&span, source, &token);
+    CHECK(token.value == source->data && token.length == 5);
+    Lexer_destroy(lexer);
+    SourceFile_close(source);
+    unlink(path);
+}
+
+int main(void) {
+    TEST_RUN(test_mapped_file);
+    TEST_RUN(test_empty_file);
+    TEST_RUN(test_pipe);
+    TEST_RUN(test_positions);
+    TEST_RUN(test_lexing_mapped_source);
+    return Test_finish("source_file");
+}
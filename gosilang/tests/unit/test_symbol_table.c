@@ -0,0 +1,82 @@
+// Scope symbol tables: lookup through parents, shadowing, redeclaration,
+// growth of a scope's slot table and hashed lookups of unterminated names.
+#include "core/tokenizer/symbols/sym_value.h"
+#include "core/tokenizer/symbols/sym_intern.h"
+#include "test.h"
+
+#define MANY_SYMBOLS 5000
+
+static void test_lookup_and_shadowing(void) {
+    ScopeLevel* global = CreateScope(NULL);
+    ScopeLevel* inner = CreateScope(global);
+    CHECK(global->level == 0 && inner->level == 1);
+    CHECK(FindSymbol(inner, "x") == NULL);
+    CHECK(FindLocalSymbol(inner, "x") == NULL);
+
+    SymbolTableEntry* outer_x = CreateSymbol("x", TOKEN_LITERAL_IDENTIFIER);
+    SymbolTableEntry* y = CreateSymbol("y", TOKEN_LITERAL_IDENTIFIER);
+    CHECK(AddSymbol(global, outer_x));
+    CHECK(AddSymbol(global, y));
+    CHECK(FindSymbol(inner, "x") == outer_x);
+    CHECK(FindLocalSymbol(inner, "x") == NULL);
+
+    // An inner declaration shadows the outer one
+    SymbolTableEntry* inner_x = CreateSymbol("x", TOKEN_LITERAL_IDENTIFIER);
+    CHECK(AddSymbol(inner, inner_x));
+    CHECK(FindSymbol(inner, "x") == inner_x);
+    CHECK(FindSymbol(global, "x") == outer_x);
+    CHECK(FindSymbol(inner, "y") == y);
+
+    // Redeclaring in the same scope is refused and leaves the table alone
+    SymbolTableEntry* again = CreateSymbol("x", TOKEN_LITERAL_IDENTIFIER);
+    CHECK(!AddSymbol(inner, again));
+    CHECK(inner->symbol_count == 1 && FindSymbol(inner, "x") == inner_x);
+    DestroySymbol(again);
+
+    CHECK(!AddSymbol(NULL, y));
+    CHECK(!AddSymbol(inner, NULL));
+    DestroyScope(inner);
+    DestroyScope(global);
+}
+
+static void test_growth(void) {
+    ScopeLevel* scope = CreateScope(NULL);
+    char name[32];
+    for (int i = 0; i < MANY_SYMBOLS; i++) {
+        snprintf(name, sizeof(name), "symbol%d", i);
+        CHECK(AddSymbol(scope, CreateSymbol(name, TOKEN_LITERAL_IDENTIFIER)));
+    }
+    CHECK(scope->symbol_count == MANY_SYMBOLS);
+    CHECK(scope->symbol_count * 2 <= scope->slot_mask + 1);
+
+    int missing = 0;
+    for (int i = 0; i < MANY_SYMBOLS; i++) {
+        snprintf(name, sizeof(name), "symbol%d", i);
+        SymbolTableEntry* entry = FindLocalSymbol(scope, name);
+        if (!entry || strcmp(entry->name, name) != 0) missing++;
+    }
+    CHECK(missing == 0);
+    CHECK(FindSymbol(scope, "symbol") == NULL);
+    DestroyScope(scope);
+}
+
+static void test_hashed_lookup(void) {
+    ScopeLevel* scope = CreateScope(NULL);
+    SymbolTableEntry* count = CreateSymbol("count", TOKEN_LITERAL_IDENTIFIER);
+    AddSymbol(scope, count);
+
+    // Names inside a source buffer are not NUL terminated
+    const char* source = "countdown";
+    CHECK(FindSymbolHashed(scope, source, 5, Lexeme_hash(source, 5)) == count);
+    CHECK(FindSymbolHashed(scope, source, 9, Lexeme_hash(source, 9)) == NULL);
+    CHECK(FindSymbolHashed(scope, source, 4, Lexeme_hash(source, 4)) == NULL);
+    CHECK(FindSymbolHashed(scope, NULL, 0, 0) == NULL);
+    DestroyScope(scope);
+}
+
+int main(void) {
+    TEST_RUN(test_lookup_and_shadowing);
+    TEST_RUN(test_growth);
+    TEST_RUN(test_hashed_lookup);
+    return Test_finish("symbol_table");
+}
@@ -0,0 +1,89 @@
+// TokenArena: alignment, block chaining, reuse after reset and arena
+// copies of tokens.
+#include "core/tokenizer/symbols/sym_arena.h"
+#include "core/tokenizer/symbols/sym_intern.h"
+#include "test.h"
+#include <stdint.h>
+
+static void test_alignment(void) {
+    TokenArena* arena = TokenArena_create(256);
+    CHECK(arena != NULL);
+    for (size_t align = 1; align <= 64; align <<= 1) {
+        TokenArena_alloc(arena, 1, 1);
+        void* p = TokenArena_alloc(arena, 3, align);
+        CHECK(p != NULL && ((uintptr_t)p & (align - 1)) == 0);
+    }
+    CHECK(TokenArena_alloc(arena, 0, 8) == NULL);
+    CHECK(TokenArena_alloc(NULL, 8, 8) == NULL);
+    TokenArena_destroy(arena);
+}
+
+static void test_oversized_allocation(void) {
+    TokenArena* arena = TokenArena_create(64);
+    unsigned char* big = (unsigned char*)TokenArena_alloc(arena, 1000, 16);
+    CHECK(big != NULL);
+    memset(big, 0xab, 1000);
+    CHECK(arena->bytes_reserved >= 64 + 1000);
+
+    // The block after the oversized one still takes ordinary allocations
+    CHECK(TokenArena_alloc(arena, 32, 8) != NULL);
+    TokenArena_destroy(arena);
+}
+
+static void test_reset_reuses_blocks(void) {
+    TokenArena* arena = TokenArena_create(128);
+    for (int i = 0; i < 100; i++) {
+        CHECK(Token_createInArena(arena, TOKEN_LITERAL_IDENTIFIER, "name") != NULL);
+    }
+    CHECK(arena->token_count == 100);
+    size_t reserved = arena->bytes_reserved;
+    CHECK(reserved > 128);
+
+    TokenArena_reset(arena);
+    CHECK(arena->token_count == 0);
+    for (int i = 0; i < 100; i++) {
+        Token_createInArena(arena, TOKEN_LITERAL_IDENTIFIER, "name");
+    }
+    CHECK(arena->bytes_reserved == reserved);
+    TokenArena_destroy(arena);
+}
+
+static void test_strndup(void) {
+    TokenArena* arena = TokenArena_create(0);
+    char* copy = TokenArena_strndup(arena, "abcdef", 3);
+    CHECK_STR(copy, "abc");
+    CHECK(TokenArena_strndup(arena, NULL, 3) == NULL);
+    CHECK_STR(TokenArena_strndup(arena, "", 0), "");
+    TokenArena_destroy(arena);
+}
+
+static void test_copy_token(void) {
+    TokenArena* arena = TokenArena_create(0);
+    StringInterner* interner = StringInterner_create();
+
+    Token* plain = Token_createInArena(arena, TOKEN_LITERAL_STRING, "text");
+    plain->line_number = 7;
+    Token* copy = Token_copyInArena(arena, plain);
+    CHECK(copy != NULL && copy != plain);
+    CHECK_STR(copy->value, "text");
+    CHECK(copy->value != plain->value);
+    CHECK(copy->length == 4 && copy->line_number == 7 && copy->type == TOKEN_LITERAL_STRING);
+
+    // Interned values are shared rather than copied
+    Token* interned = Token_createInterned(interner, TOKEN_LITERAL_IDENTIFIER, "shared", 6);
+    Token* shared = Token_copyInArena(arena, interned);
+    CHECK(shared->value == interned->value && shared->lexeme == interned->lexeme);
+
+    Token_destroy(interned);
+    StringInterner_destroy(interner);
+    TokenArena_destroy(arena);
+}
+
+int main(void) {
+    TEST_RUN(test_alignment);
+    TEST_RUN(test_oversized_allocation);
+    TEST_RUN(test_reset_reuses_blocks);
+    TEST_RUN(test_strndup);
+    TEST_RUN(test_copy_token);
+    return Test_finish("token_arena");
+}
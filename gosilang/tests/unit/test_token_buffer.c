@@ -0,0 +1,125 @@
+// TokenBuffer: growth, values resolved from text, interner or reserved
+// spellings, attribute packing with saturated depths, and the
+// TokenContext cursor over a buffer.
+#include "core/tokenizer/symbols/sym_buffer.h"
+#include "core/tokenizer/lexer/lexer.h"
+#include "test.h"
+
+static void test_growth(void) {
+    TokenBuffer* buffer = TokenBuffer_create(2);
+    CHECK(buffer->capacity == 2);
+    for (uint32_t i = 0; i < 5000; i++) {
+        CHECK(TokenBuffer_append(buffer, TOKEN_LITERAL_INTEGER, i * 2, 1, 0) == i);
+    }
+    CHECK(buffer->count == 5000 && buffer->capacity >= 5000);
+    CHECK(buffer->offsets[4999] == 9998 && buffer->categories[0] == TokenType_getCategory(TOKEN_LITERAL_INTEGER));
+
+    TokenBuffer_clear(buffer);
+    CHECK(buffer->count == 0 && buffer->capacity >= 5000);
+    CHECK(TokenBuffer_type(buffer, 0) == TOKEN_EOF);
+    CHECK(TokenBuffer_value(buffer, 0) == NULL);
+    TokenBuffer_destroy(buffer);
+}
+
+static void test_values(void) {
+    const char* text = "total += limit;";
+    StringInterner* interner = StringInterner_create();
+    Lexer* lexer = Lexer_createFromBuffer(text, strlen(text), "values");
+    TokenBuffer* buffer = TokenBuffer_create(0);
+    CHECK(Lexer_fillBuffer(lexer, buffer) == 5);
+
+    // Uninterned values point into the text, reserved ones at their spelling
+    CHECK(TokenBuffer_value(buffer, 0) == text);
+    CHECK_STR(TokenBuffer_value(buffer, 1), "+=");
+    CHECK(TokenBuffer_type(buffer, 3) == TOKEN_PUNCT_SEMICOLON);
+    CHECK(TokenBuffer_type(buffer, 4) == TOKEN_EOF && TokenBuffer_value(buffer, 4) == NULL);
+    Lexer_destroy(lexer);
+
+    // With an interner every identifier is a lexeme id
+    TokenBuffer_clear(buffer);
+    lexer = Lexer_createFromBuffer(text, strlen(text), "values");
+    Lexer_setInterner(lexer, interner);
+    Lexer_fillBuffer(lexer, buffer);
+    CHECK(buffer->lexemes[2] >= LEXEME_RESERVED_COUNT);
+    CHECK_STR(TokenBuffer_value(buffer, 2), "limit");
+
+    Token token;
+    CHECK(TokenBuffer_get(buffer, 2, &token));
+    CHECK(token.type == TOKEN_LITERAL_IDENTIFIER && token.offset == 9 && token.length == 5);
+    CHECK(!TokenBuffer_get(buffer, buffer->count, &token));
+
+    Lexer_destroy(lexer);
+    TokenBuffer_destroy(buffer);
+    StringInterner_destroy(interner);
+}
+
+static void test_push_tokens(void) {
+    Token* a = Token_create(TOKEN_LITERAL_IDENTIFIER, "a");
+    Token* b = Token_create(TOKEN_LITERAL_IDENTIFIER, "b");
+    a->next = b;
+    b->attributes.is_const = true;
+    b->attributes.pointer_level = 2;
+
+    TokenBuffer* buffer = TokenBuffer_create(0);
+    CHECK(TokenBuffer_pushList(buffer, a) == 2);
+    Token token;
+    TokenBuffer_get(buffer, 1, &token);
+    CHECK(token.attributes.is_const && token.attributes.pointer_level == 2);
+    TokenBuffer_destroy(buffer);
+    Token_destroy(a);
+    Token_destroy(b);
+}
+
+static void test_attribute_packing(void) {
+    TokenAttributes attrs;
+    memset(&attrs, 0, sizeof(attrs));
+    attrs.is_volatile = true;
+    attrs.is_extern = true;
+    attrs.is_signed = false;
+    attrs.pointer_level = 3;
+    attrs.array_dimensions = 40;
+
+    uint16_t bits = TokenAttributes_pack(&attrs);
+    TokenAttributes back;
+    TokenAttributes_unpack(bits, &back);
+    CHECK(!back.is_const && back.is_volatile && !back.is_static && back.is_extern && !back.is_signed);
+    CHECK(back.pointer_level == 3);
+    CHECK(back.array_dimensions == TOKEN_ATTR_DEPTH_MASK);
+
+    attrs.pointer_level = -1;
+    attrs.is_signed = true;
+    TokenAttributes_unpack(TokenAttributes_pack(&attrs), &back);
+    CHECK(back.pointer_level == 0 && back.is_signed);
+    CHECK(TokenAttributes_pack(NULL) == 0);
+}
+
+static void test_context(void) {
+    TokenBuffer* buffer = TokenBuffer_create(0);
+    TokenBuffer_append(buffer, TOKEN_LITERAL_IDENTIFIER, 0, 1, 0);
+    TokenBuffer_append(buffer, TOKEN_PUNCT_SEMICOLON, 1, 1, LEXEME_SEMICOLON);
+
+    TokenContext* context = TokenContext_create(buffer);
+    CHECK(TokenContext_peek(context, 0) == TOKEN_LITERAL_IDENTIFIER);
+    CHECK(TokenContext_peek(context, 1) == TOKEN_PUNCT_SEMICOLON);
+    CHECK(TokenContext_peek(context, 2) == TOKEN_EOF);
+    CHECK(TokenContext_peek(context, -1) == TOKEN_EOF);
+    CHECK(TokenContext_advance(context));
+    CHECK(!TokenContext_advance(context));
+    CHECK(!TokenContext_advance(context));
+
+    TokenContext_setError(context, "first");
+    TokenContext_setError(context, "second");
+    CHECK(context->error_count == 2);
+    CHECK_STR(context->error_message, "second");
+    TokenContext_destroy(context);
+    TokenBuffer_destroy(buffer);
+}
+
+int main(void) {
+    TEST_RUN(test_growth);
+    TEST_RUN(test_values);
+    TEST_RUN(test_push_tokens);
+    TEST_RUN(test_attribute_packing);
+    TEST_RUN(test_context);
+    return Test_finish("token_buffer");
+}
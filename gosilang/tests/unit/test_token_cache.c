@@ -0,0 +1,378 @@
+// TokenCache: XXH64 vectors, a round trip of tokens, lexemes and every
+// kind of symbol record, stale and damaged entries refused, writers
+// racing on one key, and the driver reusing a file's declarations.
+#include "compiler/driver/driver.h"
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/tokenizer/symbols/sym_cache.h"
+#include "test.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define OPTIONS (TOKEN_CACHE_SKIP_COMMENTS | TOKEN_CACHE_INTERNED)
+
+static const char source[] = "int area(int width, int height);\n"
+                             "struct point { int x; int y; };\n"
+                             "enum color { RED, GREEN };\n"
+                             "scale = 1.5; /* comment */ name = \"gosi\"; on = true;\n";
+
+typedef struct Entry {
+    StringInterner* interner;
+    TokenBuffer* tokens;
+    ScopeLevel* scopes[2];
+    FunctionSignature* function;
+    StructDefinition* record;
+    EnumDefinition* colors;
+    SymbolTables tables;
+} Entry;
+
+static SymbolTableEntry* Declare(ScopeLevel* scope, const char* name, TokenType type) {
+    SymbolTableEntry* symbol = CreateSymbol(name, type);
+    if (symbol && !AddSymbol(scope, symbol)) {
+        DestroySymbol(symbol);
+        return NULL;
+    }
+    return symbol;
+}
+
+// The tokens of source and symbol tables standing in for what symbol
+// collection would find in it
+static void Entry_build(Entry* e, const char* text, size_t length) {
+    memset(e, 0, sizeof(*e));
+    e->interner = StringInterner_create();
+    e->tokens = TokenBuffer_create(0);
+    Lexer* lexer = Lexer_createFromBuffer(text, length, "cache");
+    lexer->skip_comments = true;
+    Lexer_setInterner(lexer, e->interner);
+    Lexer_fillBuffer(lexer, e->tokens);
+    Lexer_destroy(lexer);
+
+    ScopeLevel* global = CreateScope(NULL);
+    e->scopes[0] = global;
+    SymbolTableEntry* scale = Declare(global, "scale", TOKEN_LITERAL_FLOAT);
+    scale->value.type = VAL_FLOAT;
+    scale->value.data.float_val = 1.5;
+    SymbolTableEntry* name = Declare(global, "name", TOKEN_LITERAL_STRING);
+    name->value.type = VAL_STRING;
+    name->value.data.string_val = strdup("gosi");
+    SymbolTableEntry* on = Declare(global, "on", TOKEN_LITERAL_BOOL);
+    on->value.type = VAL_BOOL;
+    on->value.data.bool_val = true;
+    SymbolTableEntry* red = Declare(global, "RED", TOKEN_LITERAL_INTEGER);
+    red->value.type = VAL_INTEGER;
+    red->value.data.int_val = -7;
+    red->value.is_unsigned = false;
+    red->value.bit_width = 32;
+    red->attributes.is_const = true;
+    Declare(global, "area", TOKEN_LITERAL_IDENTIFIER);
+
+    e->function = CreateFunction("area", TOKEN_TYPE_INT);
+    AddParameter(e->function, "width", TOKEN_TYPE_INT);
+    AddParameter(e->function, "height", TOKEN_TYPE_INT);
+    e->function->scope = CreateScope(global);
+    e->scopes[1] = e->function->scope;
+    Declare(e->scopes[1], "width", TOKEN_TYPE_INT);
+
+    e->record = CreateStruct("point", false);
+    AddStructMember(e->record, "x", TOKEN_TYPE_INT)->offset = 0;
+    AddStructMember(e->record, "y", TOKEN_TYPE_INT)->offset = 4;
+    e->record->total_size = 8;
+    e->colors = CreateEnum("color");
+    AddEnumValue(e->colors, "RED", 0);
+    AddEnumValue(e->colors, "GREEN", 1);
+
+    e->tables = (SymbolTables){ .scopes = e->scopes, .scope_count = 2,
+                                .functions = &e->function, .function_count = 1,
+                                .structs = &e->record, .struct_count = 1,
+                                .enums = &e->colors, .enum_count = 1 };
+}
+
+static void Entry_free(Entry* e) {
+    DestroyFunction(e->function);   // Takes its scope with it
+    DestroyStruct(e->record);
+    DestroyEnum(e->colors);
+    DestroyScope(e->scopes[0]);
+    TokenBuffer_destroy(e->tokens);
+    StringInterner_destroy(e->interner);
+}
+
+static void EntryPath(char* path, size_t size, const char* directory, uint64_t key) {
+    snprintf(path, size, "%s/%016llx%s", directory, (unsigned long long)key, TOKEN_CACHE_EXTENSION);
+}
+
+static void RemoveDirectory(const char* directory) {
+    DIR* dir = opendir(directory);
+    struct dirent* item;
+    char path[512];
+    while (dir && (item = readdir(dir))) {
+        if (item->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", directory, item->d_name);
+        unlink(path);
+    }
+    if (dir) closedir(dir);
+    rmdir(directory);
+}
+
+static uint32_t CountFiles(const char* directory) {
+    DIR* dir = opendir(directory);
+    struct dirent* item;
+    uint32_t count = 0;
+    while (dir && (item = readdir(dir))) count += item->d_name[0] != '.';
+    if (dir) closedir(dir);
+    return count;
+}
+
+static void test_hash_vectors(void) {
+    const char* sentence = "Nobody inspects the spammish repetition";
+    CHECK(TokenCache_hash("", 0, 0) == 0xEF46DB3751D8E999ull);
+    CHECK(TokenCache_hash("abc", 3, 0) == 0x44BC2CF5AD770999ull);
+    CHECK(TokenCache_hash(sentence, strlen(sentence), 0) == 0xFBCEA83C8A378BF1ull);
+    CHECK(TokenCache_key(source, sizeof(source) - 1, OPTIONS) != TokenCache_key(source, sizeof(source) - 1, 0));
+}
+
+static void test_round_trip(void) {
+    char directory[] = "/tmp/gosilang_test_cache_XXXXXX";
+    CHECK(mkdtemp(directory) != NULL);
+    size_t length = sizeof(source) - 1;
+    Entry e;
+    Entry_build(&e, source, length);
+    uint64_t key = TokenCache_key(source, length, OPTIONS);
+    CHECK(TokenCache_write(directory, key, e.tokens, e.interner, &e.tables));
+
+    TokenCache* cache = TokenCache_open(directory, key, source, length);
+    CHECK(cache != NULL);
+    if (!cache) {
+        Entry_free(&e);
+        RemoveDirectory(directory);
+        return;
+    }
+
+    // Tokens and lexemes, read through the mapped interner
+    const TokenBuffer* tokens = &cache->tokens;
+    CHECK(tokens->count == e.tokens->count && tokens->text == source);
+    CHECK(memcmp(tokens->types, e.tokens->types, tokens->count) == 0);
+    CHECK(memcmp(tokens->offsets, e.tokens->offsets, tokens->count * sizeof(uint32_t)) == 0);
+    CHECK(memcmp(tokens->lexemes, e.tokens->lexemes, tokens->count * sizeof(LexemeId)) == 0);
+    CHECK(cache->interner.count == e.interner->count);
+    CHECK(StringInterner_find(&cache->interner, "height", 6) == StringInterner_find(e.interner, "height", 6));
+    CHECK_STR(TokenBuffer_value(tokens, 1), "area");
+
+    // Symbols, found from the function's scope outwards
+    CHECK(cache->scope_count == 2 && cache->scopes[1].parent == 0);
+    CHECK(TokenCache_findSymbol(cache, 1, "width", 5) != NULL);
+    CHECK(TokenCache_findSymbol(cache, 0, "width", 5) == NULL);
+    const CachedSymbol* red = TokenCache_findSymbol(cache, 1, "RED", 3);
+    CHECK(red && red->value_type == VAL_INTEGER && red->value.int_val == -7);
+
+    SymbolTableEntry* loaded = TokenCache_loadSymbol(cache, red);
+    CHECK(loaded && loaded->value.data.int_val == -7 && loaded->value.bit_width == 32 && loaded->attributes.is_const);
+    DestroySymbol(loaded);
+    loaded = TokenCache_loadSymbol(cache, TokenCache_findSymbol(cache, 0, "name", 4));
+    CHECK(loaded && loaded->value.type == VAL_STRING);
+    if (loaded) CHECK_STR(loaded->value.data.string_val, "gosi");
+    DestroySymbol(loaded);
+    loaded = TokenCache_loadSymbol(cache, TokenCache_findSymbol(cache, 0, "scale", 5));
+    CHECK(loaded && loaded->value.type == VAL_FLOAT && loaded->value.data.float_val == 1.5);
+    DestroySymbol(loaded);
+    loaded = TokenCache_loadSymbol(cache, TokenCache_findSymbol(cache, 0, "on", 2));
+    CHECK(loaded && loaded->value.type == VAL_BOOL && loaded->value.data.bool_val);
+    DestroySymbol(loaded);
+
+    // Functions, structs and enums with their runs
+    CHECK(cache->function_count == 1 && cache->parameter_count == 2 && cache->functions[0].scope == 1);
+    CHECK_STR(TokenCache_string(cache, cache->parameters[cache->functions[0].first_parameter + 1].name), "height");
+    CHECK(cache->struct_count == 1 && cache->structs[0].total_size == 8 && cache->members[1].offset == 4);
+    CHECK(cache->enum_count == 1 && cache->enum_values[1].value == 1);
+    CHECK_STR(TokenCache_string(cache, cache->enum_values[1].name), "GREEN");
+
+    TokenCache_close(cache);
+    Entry_free(&e);
+    RemoveDirectory(directory);
+}
+
+static bool Misses(const char* directory, uint64_t key, const char* text, size_t size) {
+    TokenCache* cache = TokenCache_open(directory, key, text, size);
+    TokenCache_close(cache);
+    return cache == NULL;
+}
+
+// Overwrites one value in a section of an entry's file
+static void Patch(const char* path, TokenCacheSection section, uint32_t element, const void* value, size_t size) {
+    FILE* file = fopen(path, "r+b");
+    TokenCacheHeader header;
+    CHECK(file && fread(&header, sizeof(header), 1, file) == 1);
+    if (!file) return;
+    fseek(file, (long)(header.sections[section].offset + (uint64_t)element * size), SEEK_SET);
+    CHECK(fwrite(value, size, 1, file) == 1);
+    fclose(file);
+}
+
+// Overwrites a run of 32-bit values in a section of an entry's file
+static void Fill(const char* path, TokenCacheSection section, uint32_t first, uint32_t count, uint32_t value) {
+    for (uint32_t i = 0; i < count; i++) {
+        Patch(path, section, first + i, &value, sizeof(value));
+    }
+}
+
+static void test_stale_and_damaged_entries(void) {
+    char directory[] = "/tmp/gosilang_test_cache_XXXXXX";
+    CHECK(mkdtemp(directory) != NULL);
+    char text[sizeof(source)];
+    memcpy(text, source, sizeof(source));
+    size_t length = sizeof(source) - 1;
+    Entry e;
+    Entry_build(&e, text, length);
+    uint64_t key = TokenCache_key(text, length, OPTIONS);
+    char path[512];
+    EntryPath(path, sizeof(path), directory, key);
+
+    // An edited source or other options have another key
+    CHECK(TokenCache_write(directory, key, e.tokens, e.interner, &e.tables));
+    CHECK(!Misses(directory, key, text, length));
+    text[3] ^= 1;
+    CHECK(Misses(directory, TokenCache_key(text, length, OPTIONS), text, length));
+    text[3] ^= 1;
+    CHECK(Misses(directory, TokenCache_key(text, length, TOKEN_CACHE_INTERNED), text, length));
+    CHECK(Misses(directory, key + 1, text, length));
+
+    // Token spans are checked against the source they are opened with
+    CHECK(Misses(directory, key, text, length - 10));
+    CHECK(Misses(directory, key, NULL, length));
+
+    // A lexeme id, offset, length or type the entry cannot hold
+    uint32_t last = e.tokens->count - 2;
+    struct {
+        TokenCacheSection section;
+        uint32_t value;
+        size_t size;
+    } const damage[] = {
+        { TOKEN_CACHE_TOKEN_LEXEMES, e.interner->count, sizeof(LexemeId) },
+        { TOKEN_CACHE_TOKEN_OFFSETS, (uint32_t)length + 1, sizeof(uint32_t) },
+        { TOKEN_CACHE_TOKEN_LENGTHS, (uint32_t)length, sizeof(uint32_t) },
+        { TOKEN_CACHE_TOKEN_LENGTHS, UINT32_MAX, sizeof(uint32_t) },
+        { TOKEN_CACHE_TOKEN_TYPES, TOKEN_TYPE_COUNT, sizeof(uint8_t) },
+    };
+    for (size_t d = 0; d < sizeof(damage) / sizeof(damage[0]); d++) {
+        CHECK(TokenCache_write(directory, key, e.tokens, e.interner, &e.tables));
+        uint8_t byte = (uint8_t)damage[d].value;
+        Patch(path, damage[d].section, last, damage[d].size == 1 ? (const void*)&byte : (const void*)&damage[d].value,
+              damage[d].size);
+        CHECK(Misses(directory, key, text, length));
+    }
+
+    // Hash tables with no empty slot, where a lookup would probe forever
+    CHECK(TokenCache_write(directory, key, e.tokens, e.interner, &e.tables));
+    Fill(path, TOKEN_CACHE_LEXEME_SLOTS, 0, e.interner->slot_mask + 1, LEXEME_PLUS);
+    CHECK(Misses(directory, key, text, length));
+
+    CHECK(TokenCache_write(directory, key, e.tokens, e.interner, &e.tables));
+    TokenCache* cache = TokenCache_open(directory, key, text, length);
+    CHECK(cache && cache->scope_count && cache->scopes[0].symbol_count);
+    CachedScope scope = cache ? cache->scopes[0] : (CachedScope){ 0 };
+    TokenCache_close(cache);
+    Fill(path, TOKEN_CACHE_SCOPE_SLOTS, scope.first_slot, scope.slot_mask + 1, scope.first_symbol + 1);
+    CHECK(Misses(directory, key, text, length));
+
+    // Cut short
+    CHECK(TokenCache_write(directory, key, e.tokens, e.interner, &e.tables));
+    FILE* file = fopen(path, "rb");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    CHECK(truncate(path, size - 8) == 0 && Misses(directory, key, text, length));
+    CHECK(truncate(path, 16) == 0 && Misses(directory, key, text, length));
+
+    Entry_free(&e);
+    RemoveDirectory(directory);
+}
+
+// Threads writing one key while others open it: every open sees a whole
+// entry or none, and no temporary file is left behind
+typedef struct Race {
+    const char* directory;
+    uint64_t key;
+    const Entry* entry;
+    atomic_uint broken;
+} Race;
+
+static void* Writer(void* argument) {
+    Race* race = (Race*)argument;
+    for (int i = 0; i < 50; i++) {
+        if (!TokenCache_write(race->directory, race->key, race->entry->tokens, race->entry->interner,
+                              &race->entry->tables)) {
+            atomic_fetch_add(&race->broken, 1);
+        }
+        TokenCache* cache = TokenCache_open(race->directory, race->key, source, sizeof(source) - 1);
+        if (!cache || cache->tokens.count != race->entry->tokens->count) atomic_fetch_add(&race->broken, 1);
+        TokenCache_close(cache);
+    }
+    return NULL;
+}
+
+static void test_racing_writers(void) {
+    char directory[] = "/tmp/gosilang_test_cache_XXXXXX";
+    CHECK(mkdtemp(directory) != NULL);
+    Entry e;
+    Entry_build(&e, source, sizeof(source) - 1);
+    Race race = { directory, TokenCache_key(source, sizeof(source) - 1, OPTIONS), &e, 0 };
+
+    pthread_t threads[6];
+    for (int t = 0; t < 6; t++) pthread_create(&threads[t], NULL, Writer, &race);
+    for (int t = 0; t < 6; t++) pthread_join(threads[t], NULL);
+    CHECK(atomic_load(&race.broken) == 0);
+    CHECK(CountFiles(directory) == 1);
+
+    Entry_free(&e);
+    RemoveDirectory(directory);
+}
+
+// A second driver reads the file's tokens and declarations from the
+// entry the first one wrote, and declares the same globals
+static void test_driver_reuses_declarations(void) {
+    char directory[] = "/tmp/gosilang_test_cache_XXXXXX";
+    char file[] = "/tmp/gosilang_test_unit_XXXXXX";
+    CHECK(mkdtemp(directory) != NULL);
+    int fd = mkstemp(file);
+    static const char text[] = "a = 1 + 2; b = a * 2; a = 5; c = 2.5; b = 0;";
+    CHECK(fd >= 0 && write(fd, text, sizeof(text) - 1) == (ssize_t)(sizeof(text) - 1));
+    close(fd);
+    const char* paths[] = { file };
+    CompileOptions options = { .threads = 1, .cache_dir = directory, .validate = true, .fold = true };
+
+    for (int run = 0; run < 2; run++) {
+        CompileDriver* driver = CompileDriver_create(&options);
+        CHECK(CompileDriver_run(driver, paths, 1));
+        CHECK(driver->results[0].cached == (run == 1));
+        CHECK(driver->results[0].globals == 3);
+
+        SymbolTableEntry* a = SharedScope_find(driver->globals, "a", 1, Lexeme_hash("a", 1));
+        CHECK(a && a->value.type == VAL_INTEGER && a->value.data.int_val == 3);
+        SymbolTableEntry* c = SharedScope_find(driver->globals, "c", 1, Lexeme_hash("c", 1));
+        CHECK(c && c->value.type == VAL_FLOAT && c->value.data.float_val == 2.5);
+        CHECK(SharedScope_find(driver->globals, "b", 1, Lexeme_hash("b", 1)) != NULL);
+        CompileDriver_destroy(driver);
+        CHECK(CountFiles(directory) == 1);
+    }
+
+    // Without folding the values are not constants, so the entry differs
+    options.fold = false;
+    CompileDriver* driver = CompileDriver_create(&options);
+    CHECK(CompileDriver_run(driver, paths, 1) && !driver->results[0].cached);
+    SymbolTableEntry* a = SharedScope_find(driver->globals, "a", 1, Lexeme_hash("a", 1));
+    CHECK(a && a->value.type == VAL_NULL);
+    CompileDriver_destroy(driver);
+    CHECK(CountFiles(directory) == 2);
+
+    unlink(file);
+    RemoveDirectory(directory);
+}
+
+int main(void) {
+    TEST_RUN(test_hash_vectors);
+    TEST_RUN(test_round_trip);
+    TEST_RUN(test_stale_and_damaged_entries);
+    TEST_RUN(test_racing_writers);
+    TEST_RUN(test_driver_reuses_declarations);
+    return Test_finish("token_cache");
+}
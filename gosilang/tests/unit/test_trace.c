@@ -0,0 +1,129 @@
+// Trace: channel masks, ring wrap-around and truncation, environment
+// configuration, and whole lines from concurrent writers.
+#include "core/trace/trace.h"
+#include "test.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+#define WRITER_THREADS 4
+#define LINES_PER_WRITER 2000
+
+static size_t DumpRing(char* out, size_t size) {
+    FILE* stream = tmpfile();
+    size_t written = Trace_dumpRing(stream);
+    rewind(stream);
+    size_t read = fread(out, 1, size - 1, stream);
+    out[read] = '\0';
+    fclose(stream);
+    return written == read ? read : 0;
+}
+
+static void test_channels(void) {
+    CHECK(Trace_setRing(4096));
+    Trace_enable(TRACE_PARSER);
+    CHECK(Trace_isEnabled(TRACE_PARSER) && !Trace_isEnabled(TRACE_LEXER));
+    TRACE(TRACE_LEXER, "dropped %d", 1);
+    TRACE(TRACE_PARSER, "kept %d", 2);
+    Trace_disable(TRACE_PARSER);
+    TRACE(TRACE_PARSER, "dropped %d", 3);
+
+    char out[4096];
+    DumpRing(out, sizeof(out));
+    if (GOSI_TRACE_ENABLED) {
+        CHECK_STR(out, "[parser] kept 2\n");
+    } else {
+        CHECK_STR(out, "");
+    }
+    Trace_shutdown();
+}
+
+static void test_ring_wrap(void) {
+    CHECK(Trace_setRing(64));
+    for (int i = 0; i < 20; i++) Trace_emit(TRACE_LEXER, "line %02d", i);
+
+    // Only complete lines survive, newest last
+    char out[128];
+    size_t length = DumpRing(out, sizeof(out));
+    CHECK(length > 0 && length <= 64);
+    CHECK(length >= 8 && strcmp(out + length - 8, "line 19\n") == 0);
+    CHECK(strncmp(out, "[lexer] line ", 13) == 0);
+    Trace_shutdown();
+}
+
+static void test_truncation(void) {
+    CHECK(Trace_setRing(4 * TRACE_MESSAGE_SIZE));
+    char long_text[2 * TRACE_MESSAGE_SIZE];
+    memset(long_text, 'x', sizeof(long_text) - 1);
+    long_text[sizeof(long_text) - 1] = '\0';
+    Trace_emit(TRACE_SYMBOLS, "%s", long_text);
+
+    char out[4 * TRACE_MESSAGE_SIZE + 1];
+    size_t length = DumpRing(out, sizeof(out));
+    CHECK(length == TRACE_MESSAGE_SIZE - 1 && out[length - 1] == '\n');
+    CHECK(strncmp(out, "[symbols] xxx", 13) == 0);
+    Trace_shutdown();
+}
+
+static void test_environment(void) {
+    setenv("GOSILANG_TRACE", "lexer,symbols,bogus", 1);
+    setenv("GOSILANG_TRACE_SINK", "ring:1024", 1);
+    CHECK(Trace_configureFromEnv());
+    CHECK(Trace_isEnabled(TRACE_LEXER) && Trace_isEnabled(TRACE_SYMBOLS) && !Trace_isEnabled(TRACE_PARSER));
+    Trace_emit(TRACE_LEXER, "to the ring");
+    char out[1024];
+    CHECK(DumpRing(out, sizeof(out)) > 0);
+    Trace_shutdown();
+
+    setenv("GOSILANG_TRACE", "", 1);
+    CHECK(!Trace_configureFromEnv());
+    unsetenv("GOSILANG_TRACE");
+    unsetenv("GOSILANG_TRACE_SINK");
+    CHECK(!Trace_isEnabled(TRACE_ALL));
+}
+
+static void* WriteLines(void* argument) {
+    int writer = (int)(intptr_t)argument;
+    for (int i = 0; i < LINES_PER_WRITER; i++) {
+        Trace_emit(TRACE_PARSER, "writer %d line %d end", writer, i);
+    }
+    return NULL;
+}
+
+static void test_concurrent_writers(void) {
+    FILE* stream = tmpfile();
+    CHECK(Trace_setSink(TRACE_SINK_FILE, stream));
+    pthread_t threads[WRITER_THREADS];
+    for (int t = 0; t < WRITER_THREADS; t++) {
+        pthread_create(&threads[t], NULL, WriteLines, (void*)(intptr_t)t);
+    }
+    for (int t = 0; t < WRITER_THREADS; t++) pthread_join(threads[t], NULL);
+    Trace_shutdown();
+
+    // Every line arrives whole and each writer's lines stay in order
+    rewind(stream);
+    int next[WRITER_THREADS] = { 0 };
+    int lines = 0, broken = 0;
+    char line[128];
+    while (fgets(line, sizeof(line), stream)) {
+        int writer, index;
+        char end[8];
+        if (sscanf(line, "[parser] writer %d line %d %7s", &writer, &index, end) != 3 || strcmp(end, "end") != 0 ||
+            writer < 0 || writer >= WRITER_THREADS || index != next[writer]) {
+            broken++;
+            continue;
+        }
+        next[writer]++;
+        lines++;
+    }
+    fclose(stream);
+    CHECK(broken == 0 && lines == WRITER_THREADS * LINES_PER_WRITER);
+}
+
+int main(void) {
+    TEST_RUN(test_channels);
+    TEST_RUN(test_ring_wrap);
+    TEST_RUN(test_truncation);
+    TEST_RUN(test_environment);
+    TEST_RUN(test_concurrent_writers);
+    return Test_finish("trace");
+}
@@ -0,0 +1,141 @@
+// Token transitions: well formed C passes, the pairs the relation
+// exists to reject are found at the right token, comments are
+// transparent, and the blocked batch scan agrees with a pair-by-pair
+// reference on random streams.
+#include "core/tokenizer/lexer/lexer.h"
+#include "core/tokenizer/symbols/sym_transition.h"
+#include "test.h"
+#include <stdlib.h>
+
+static TokenBuffer* Lex(const char* text) {
+    Lexer* lexer = Lexer_createFromBuffer(text, strlen(text), "transitions");
+    TokenBuffer* tokens = TokenBuffer_create(0);
+    Lexer_fillBuffer(lexer, tokens);
+    Lexer_destroy(lexer);
+    return tokens;
+}
+
+// Positions of rejects in text, or -1 when it passes
+static int64_t FirstReject(const char* text) {
+    TokenBuffer* tokens = Lex(text);
+    uint32_t position;
+    uint32_t found = TokenBuffer_checkTransitions(tokens, 0, tokens->count, &position, 1);
+    TokenBuffer_destroy(tokens);
+    return found ? (int64_t)position : -1;
+}
+
+static void test_well_formed_code_passes(void) {
+    static const char* const sources[] = {
+        "int main(void) { return 0; }",
+        "static const char* name = \"x\" \"y\";",
+        "struct point { int x, y; } p = { .x = 1, [0] = 2 };",
+        "for (i = 0; i < n; i++) { if (a[i] > 0) continue; else break; }",
+        "x = c ? -y : *p->q++;",
+        "do { n--; } while (n);",
+        "switch (k) { case 1: f(&v, sizeof(int)); default: ; }",
+        "void f(int, ...);",
+        "a = b; // trailing comment",
+        "#include <stdio.h>\nint x;",
+        "",
+    };
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        int64_t reject = FirstReject(sources[i]);
+        if (reject >= 0) fprintf(stderr, "    \"%s\" rejected at token %lld\n", sources[i], (long long)reject);
+        CHECK(reject < 0);
+    }
+}
+
+static void test_garbage_is_rejected_where_it_starts(void) {
+    CHECK(FirstReject("x = 1 2;") == 3);
+    CHECK(FirstReject("x . ;") == 2);
+    CHECK(FirstReject("if x;") == 1);
+    CHECK(FirstReject("a + ;") == 2);
+    CHECK(FirstReject("break x;") == 1);
+    CHECK(FirstReject("f(...;") == 3);
+    CHECK(FirstReject("; 5 .") == 2);
+
+    // Comments between the two tokens do not hide the reject
+    CHECK(FirstReject("x = 1 /* gap */ // more\n 2;") == 5);
+
+    // Input that stops mid-expression is rejected at the lexer's EOF
+    TokenBuffer* tokens = Lex("a = b +");
+    uint32_t position;
+    CHECK(TokenBuffer_checkTransitions(tokens, 0, tokens->count, &position, 1) == 1);
+    CHECK(position == tokens->count - 1 && tokens->types[position] == TOKEN_EOF);
+
+    // A range ending before the buffer does is not checked for an end
+    CHECK(TokenBuffer_checkTransitions(tokens, 0, 2, &position, 1) == 0);
+    CHECK(TokenBuffer_checkTransitions(tokens, 0, tokens->count, NULL, 1) == 0);
+    CHECK(TokenBuffer_checkTransitions(tokens, 0, tokens->count, &position, 0) == 0);
+    TokenBuffer_destroy(tokens);
+}
+
+static void test_single_pairs(void) {
+    CHECK(TokenType_isValidTransition(TOKEN_LITERAL_IDENTIFIER, TOKEN_EXPR_BINARY));
+    CHECK(!TokenType_isValidTransition(TOKEN_LITERAL_INTEGER, TOKEN_LITERAL_INTEGER));
+    CHECK(TokenType_isValidTransition(TOKEN_STMT_IF, TOKEN_PAREN_OPEN));
+    CHECK(!TokenType_isValidTransition(TOKEN_STMT_IF, TOKEN_LITERAL_IDENTIFIER));
+
+    // Comments go anywhere; nothing is followed by an error token
+    CHECK(TokenType_isValidTransition(TOKEN_STMT_IF, TOKEN_COMMENT_SINGLE));
+    CHECK(!TokenType_isValidTransition(TOKEN_LITERAL_IDENTIFIER, TOKEN_ERROR));
+    CHECK(TokenType_isValidTransition(TOKEN_ERROR, TOKEN_LITERAL_INTEGER));
+    CHECK(TokenTransitions_isTransparent(TokenTransitions_get(), TOKEN_COMMENT_MULTI));
+    CHECK(!TokenTransitions_isTransparent(TokenTransitions_get(), TOKEN_PUNCT_SEMICOLON));
+
+    CHECK(!TokenType_isValidTransition((TokenType)TOKEN_TYPE_COUNT, TOKEN_EOF));
+    CHECK(!TokenType_isValidTransition(TOKEN_EOF, (TokenType)-1));
+}
+
+// The same check, one TokenType_isValidTransition call per pair
+static uint32_t CheckPairwise(const TokenBuffer* tokens, uint32_t* positions, uint32_t max_positions) {
+    const TokenTransitions* transitions = TokenTransitions_get();
+    TokenType previous = TOKEN_PUNCT_SEMICOLON;
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < tokens->count && found < max_positions; i++) {
+        TokenType type = (TokenType)tokens->types[i];
+        if (type >= TOKEN_TYPE_COUNT) type = TOKEN_ERROR;
+        if (!TokenType_isValidTransition(previous, type)) positions[found++] = i;
+        if (!TokenTransitions_isTransparent(transitions, type)) previous = type;
+    }
+    if (found < max_positions && !TokenType_isValidTransition(previous, TOKEN_EOF)) {
+        positions[found++] = tokens->count;
+    }
+    return found;
+}
+
+static void test_batch_matches_pairwise(void) {
+    srand(16);
+    TokenBuffer* tokens = Lex("x");
+    uint32_t batch[4096], reference[4096];
+    for (int round = 0; round < 50; round++) {
+        // Lengths around the block size, with few or many bad types
+        uint32_t count = (uint32_t)(rand() % (4 * TOKEN_TRANSITION_BLOCK)) + 1;
+        TokenBuffer_clear(tokens);
+        for (uint32_t i = 0; i < count; i++) {
+            TokenType type = (round % 2) ? (TokenType)(rand() % TOKEN_TYPE_COUNT)
+                                         : (i % 2 ? TOKEN_EXPR_BINARY : TOKEN_LITERAL_IDENTIFIER);
+            TokenBuffer_append(tokens, type, 0, 0, 0);
+        }
+        if (round % 4 == 0) tokens->types[rand() % count] = 255;
+
+        uint32_t found = TokenBuffer_checkTransitions(tokens, 0, tokens->count, batch, 4096);
+        uint32_t expected = CheckPairwise(tokens, reference, 4096);
+        CHECK(found == expected);
+        CHECK(memcmp(batch, reference, found * sizeof(uint32_t)) == 0);
+
+        // A cap keeps the first positions
+        uint32_t capped = TokenBuffer_checkTransitions(tokens, 0, tokens->count, batch, 3);
+        CHECK(capped == (expected < 3 ? expected : 3));
+        CHECK(memcmp(batch, reference, capped * sizeof(uint32_t)) == 0);
+    }
+    TokenBuffer_destroy(tokens);
+}
+
+int main(void) {
+    TEST_RUN(test_well_formed_code_passes);
+    TEST_RUN(test_garbage_is_rejected_where_it_starts);
+    TEST_RUN(test_single_pairs);
+    TEST_RUN(test_batch_matches_pairwise);
+    return Test_finish("transitions");
+}
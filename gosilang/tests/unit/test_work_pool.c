@@ -0,0 +1,202 @@
+// WorkPool: deque order and growth, thieves racing the owner, groups of
+// tasks that submit more tasks, detached tasks, and units finished from
+// outside the pool while its waiter destroys it.
+#include "runtime/concurrency/pool/work_pool.h"
+#include "test.h"
+#include <stdlib.h>
+
+static void test_deque_order_and_growth(void) {
+    WorkDeque deque;
+    CHECK(WorkDeque_init(&deque, 3));
+    CHECK(WorkDeque_pop(&deque) == NULL && WorkDeque_steal(&deque) == NULL);
+
+    // Past the initial capacity several times over
+    WorkTask tasks[100];
+    for (int i = 0; i < 100; i++) CHECK(WorkDeque_push(&deque, &tasks[i]));
+    CHECK(WorkDeque_steal(&deque) == &tasks[0]);
+    CHECK(WorkDeque_steal(&deque) == &tasks[1]);
+    CHECK(WorkDeque_pop(&deque) == &tasks[99]);
+    CHECK(WorkDeque_pop(&deque) == &tasks[98]);
+
+    uint32_t taken = 4;
+    while (WorkDeque_pop(&deque)) taken++;
+    CHECK(taken == 100);
+    CHECK(WorkDeque_steal(&deque) == NULL);
+    WorkDeque_destroy(&deque);
+}
+
+// The owner pushes and pops while thieves steal; every task is taken
+// exactly once
+enum { RACE_TASKS = 200000, THIEVES = 3 };
+
+typedef struct Race {
+    WorkDeque deque;
+    WorkTask* tasks;
+    atomic_uint* taken;
+    atomic_bool done;
+} Race;
+
+static void* Thief(void* argument) {
+    Race* race = (Race*)argument;
+    while (!atomic_load(&race->done)) {
+        WorkTask* task = WorkDeque_steal(&race->deque);
+        if (task) atomic_fetch_add(&race->taken[task - race->tasks], 1);
+    }
+    return NULL;
+}
+
+static void test_deque_race(void) {
+    Race race;
+    CHECK(WorkDeque_init(&race.deque, 4));
+    race.tasks = (WorkTask*)calloc(RACE_TASKS, sizeof(WorkTask));
+    race.taken = (atomic_uint*)calloc(RACE_TASKS, sizeof(atomic_uint));
+    atomic_init(&race.done, false);
+
+    pthread_t thieves[THIEVES];
+    for (int t = 0; t < THIEVES; t++) pthread_create(&thieves[t], NULL, Thief, &race);
+    for (uint32_t i = 0; i < RACE_TASKS; i++) {
+        WorkDeque_push(&race.deque, &race.tasks[i]);
+        if (i % 3 == 0) {
+            WorkTask* task = WorkDeque_pop(&race.deque);
+            if (task) atomic_fetch_add(&race.taken[task - race.tasks], 1);
+        }
+    }
+    WorkTask* task;
+    while ((task = WorkDeque_pop(&race.deque))) atomic_fetch_add(&race.taken[task - race.tasks], 1);
+    atomic_store(&race.done, true);
+    for (int t = 0; t < THIEVES; t++) pthread_join(thieves[t], NULL);
+
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < RACE_TASKS; i++) {
+        if (atomic_load(&race.taken[i]) != 1) wrong++;
+    }
+    CHECK(wrong == 0);
+    free(race.taken);
+    free(race.tasks);
+    WorkDeque_destroy(&race.deque);
+}
+
+// A binary tree of tasks: each splits its range until it is small and
+// sums it, so most tasks are submitted from inside other tasks
+typedef struct SumTask {
+    WorkTask task;
+    WorkPool* pool;
+    WorkGroup* group;
+    uint32_t begin, end;
+    atomic_ullong* total;
+} SumTask;
+
+static void Sum(void* data) {
+    SumTask* job = (SumTask*)data;
+    while (job->end - job->begin > 64) {
+        uint32_t middle = job->begin + (job->end - job->begin) / 2;
+        SumTask* half = (SumTask*)malloc(sizeof(SumTask));
+        *half = *job;
+        half->begin = middle;
+        WorkTask_init(&half->task, Sum, half);
+        WorkPool_submit(job->pool, job->group, &half->task);
+        job->end = middle;
+    }
+    unsigned long long sum = 0;
+    for (uint32_t i = job->begin; i < job->end; i++) sum += i;
+    atomic_fetch_add(job->total, sum);
+    free(job);
+}
+
+static void test_groups_of_nested_tasks(void) {
+    static const uint32_t thread_counts[] = { 1, 2, 4, 0 };
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        WorkPool* pool = WorkPool_create(thread_counts[t]);
+        CHECK(pool != NULL);
+        if (!pool) continue;
+        CHECK(WorkPool_threadCount(pool) >= 1);
+        if (thread_counts[t]) CHECK(WorkPool_threadCount(pool) == thread_counts[t]);
+
+        for (int round = 0; round < 5; round++) {
+            enum { COUNT = 1000000 };
+            WorkGroup group;
+            WorkGroup_init(&group);
+            atomic_ullong total;
+            atomic_init(&total, 0);
+            SumTask* root = (SumTask*)malloc(sizeof(SumTask));
+            *root = (SumTask){ .pool = pool, .group = &group, .begin = 0, .end = COUNT, .total = &total };
+            WorkTask_init(&root->task, Sum, root);
+            WorkPool_submit(pool, &group, &root->task);
+            WorkPool_wait(pool, &group);
+            CHECK(atomic_load(&total) == (unsigned long long)COUNT * (COUNT - 1) / 2);
+            CHECK(WorkGroup_pending(&group) == 0);
+        }
+
+        // Waiting on an empty group returns at once
+        WorkGroup empty;
+        WorkGroup_init(&empty);
+        WorkPool_wait(pool, &empty);
+        WorkPool_destroy(pool);
+    }
+}
+
+typedef struct Detached {
+    WorkTask task;
+    atomic_uint* runs;
+} Detached;
+
+static void RunDetached(void* data) {
+    Detached* job = (Detached*)data;
+    atomic_fetch_add(job->runs, 1);
+    free(job);
+}
+
+static void test_detached_tasks_finish_before_destroy(void) {
+    atomic_uint runs;
+    atomic_init(&runs, 0);
+    WorkPool* pool = WorkPool_create(3);
+    for (int i = 0; i < 1000; i++) {
+        Detached* job = (Detached*)malloc(sizeof(Detached));
+        job->runs = &runs;
+        WorkTask_init(&job->task, RunDetached, job);
+        WorkPool_detach(pool, &job->task);
+    }
+    WorkPool_destroy(pool);
+    CHECK(atomic_load(&runs) == 1000);
+}
+
+typedef struct OutsideUnit {
+    WorkPool* pool;
+    WorkGroup* group;
+    uint32_t delay;
+} OutsideUnit;
+
+static void* FinishOutside(void* argument) {
+    OutsideUnit* unit = (OutsideUnit*)argument;
+    for (volatile uint32_t i = 0; i < unit->delay; i++) {}
+    WorkPool_done(unit->pool, unit->group);
+    return NULL;
+}
+
+// The waiter destroys the pool as soon as the unit is done, whether it
+// was asleep or still looking for tasks when the unit finished, so the
+// finishing thread must not touch the pool after its last decrement
+static void test_pool_destroyed_after_last_unit(void) {
+    for (uint32_t round = 0; round < 400; round++) {
+        WorkPool* pool = WorkPool_create(2);
+        WorkGroup group;
+        WorkGroup_init(&group);
+        WorkGroup_add(&group, 1);
+        OutsideUnit unit = { pool, &group, (round % 4) * 20000 };
+        pthread_t thread;
+        CHECK(pthread_create(&thread, NULL, FinishOutside, &unit) == 0);
+        WorkPool_wait(pool, &group);
+        CHECK(atomic_load(&group.pending) == 0);     // No sleeper mark left either
+        WorkPool_destroy(pool);
+        pthread_join(thread, NULL);
+    }
+}
+
+int main(void) {
+    TEST_RUN(test_deque_order_and_growth);
+    TEST_RUN(test_deque_race);
+    TEST_RUN(test_groups_of_nested_tasks);
+    TEST_RUN(test_detached_tasks_finish_before_destroy);
+    TEST_RUN(test_pool_destroyed_after_last_unit);
+    return Test_finish("work_pool");
+}